@@ -9,6 +9,8 @@
 //
 // == To Build ==
 // Compile main.c and obj_parser.c and link against glfw3, glew, and opengl for your compiler
+// sphere.obj is cooked into sphere.obj.mesh on the first run, with ../common/include/apg_mesh.h
+// obj_bench.c is a standalone benchmark for the .obj parser, see the build line at its top
 // Makefiles for Windows mingw-gcc 64-bit and gcc 64-bit Linux are provided
 // so eg `mingw32-make -f Makefile.win64` or `make -f Makefile.lin64`
 // OSX - should be similar to Linux except `-framework OpenGL` instead of a library
@@ -23,6 +25,11 @@
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#define APG_MESH_IMPLEMENTATION
+#include "apg_mesh.h"
 #include "linmath.h"
 #include "obj_parser.h"
 #include <GL/glew.h>
@@ -49,6 +56,38 @@ GLuint g_tex_pano;
 int g_fb_width = VP_WIDTH; // hack
 int g_fb_height = VP_HEIGHT;
 
+// parses an obj file and writes it as an apg_mesh file, for apg_mesh_open_cached()
+int cook_obj(const char* obj_fn, const char* mesh_fn,
+	const apg_mesh_source_t* source, void* user) {
+	float *vps = NULL, *vts = NULL, *vns = NULL;
+	int pcount = 0, ok;
+	apg_mesh_desc_t desc;
+	(void)user;
+	// the obj parser splits big files over job threads. they're only needed while loading
+	apg_jobs_init(0);
+	ok = load_obj_file(obj_fn, &vps, &vts, &vns, &pcount);
+	apg_jobs_free();
+	if (ok) {
+		memset(&desc, 0, sizeof(desc));
+		desc.n_vertices = (uint32_t)pcount;
+		desc.n_streams = 3;
+		desc.streams[0].attrib = APG_MESH_POSITION;
+		desc.streams[0].n_comps = 3;
+		desc.streams[0].data_ptr = vps;
+		desc.streams[1].attrib = APG_MESH_TEXCOORD;
+		desc.streams[1].n_comps = 2;
+		desc.streams[1].data_ptr = vts;
+		desc.streams[2].attrib = APG_MESH_NORMAL;
+		desc.streams[2].n_comps = 3;
+		desc.streams[2].data_ptr = vns;
+		ok = apg_mesh_write(mesh_fn, &desc, source);
+	}
+	free(vps);
+	free(vts);
+	free(vns);
+	return ok;
+}
+
 int main(int argc, char** argv){
 	int pcount = 0;
 	GLuint g_vao_tri;
@@ -98,8 +137,18 @@ int main(int argc, char** argv){
 	}
 	init_shaders();
 	{ // geometry
-		float *vps, *vts, *vns;
-		load_obj_file("sphere.obj", &vps, &vts, &vns, &pcount);
+		// sphere.obj is parsed once, into sphere.obj.mesh, which later runs map
+		// directly. it's cooked again if sphere.obj changes
+		apg_mesh_t sphere;
+		const float *vps, *vts;
+		if (!apg_mesh_open_cached("sphere.obj", "sphere.obj.mesh", cook_obj, NULL,
+			&sphere)) {
+			fprintf(stderr, "ERROR: could not load sphere.obj\n");
+			return 1;
+		}
+		vps = (const float*)apg_mesh_stream(&sphere, APG_MESH_POSITION, NULL, NULL);
+		vts = (const float*)apg_mesh_stream(&sphere, APG_MESH_TEXCOORD, NULL, NULL);
+		pcount = (int)sphere.n_vertices;
 		assert (vps);
 		assert (vts);
 		assert (pcount > 0);
@@ -109,16 +158,13 @@ int main(int argc, char** argv){
 		glGenBuffers(2, vbos);
 		glBindBuffer(GL_ARRAY_BUFFER, vbos[0]);
 		glBufferData(GL_ARRAY_BUFFER, pcount * 3 * sizeof (float), vps, GL_STATIC_DRAW);
-		free(vps);
-		vps = NULL;
 		glEnableVertexAttribArray (0);
 		glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 		glBindBuffer(GL_ARRAY_BUFFER, vbos[1]);
 		glBufferData(GL_ARRAY_BUFFER, pcount * 2 * sizeof (float), vts, GL_STATIC_DRAW);
-		free(vts);
-		vts = NULL;
 		glEnableVertexAttribArray (1);
 		glVertexAttribPointer (1, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+		apg_mesh_close(&sphere);
 	}
 	const char* op_fns[6] = {
 		"forward.png",
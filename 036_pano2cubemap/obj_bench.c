@@ -0,0 +1,182 @@
+//
+// Benchmark for load_obj_file(): the mapped, chunked parser on one thread and
+// on every core, against the fgets() and sscanf() loader it replaced, which is
+// kept below as sscanf_load_obj_file(). All three must give the same mesh.
+// Anton Gerdelan, antongerdelan.net
+//
+// Build:
+//   gcc -O2 -std=c99 -D_POSIX_C_SOURCE=200809L obj_bench.c obj_parser.c -lm -lpthread -o obj_bench
+// Run:
+//   ./obj_bench [n_rings]
+//
+// Writes a UV sphere with n_rings x n_rings vertices (default 1000, about 180MB)
+// to obj_bench.obj, then reads it back with each loader.
+//
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "obj_parser.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_FILE "obj_bench.obj"
+
+typedef struct mesh_t {
+	float *points, *tex_coords, *normals;
+	int point_count;
+} mesh_t;
+
+static bool write_sphere (const char* file_name, int n) {
+	FILE* fp = fopen (file_name, "w");
+	int i, j;
+	if (!fp) {
+		return false;
+	}
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			double theta = 3.14159265358979 * i / (n - 1);
+			double phi = 2.0 * 3.14159265358979 * j / n;
+			double x = sin (theta) * cos (phi), y = cos (theta);
+			double z = sin (theta) * sin (phi);
+			fprintf (fp, "v %f %f %f\nvt %f %f\nvn %g %g %g\n", x, y, z,
+				(double)j / n, (double)i / (n - 1), x, y, z);
+		}
+	}
+	for (i = 0; i < n - 1; i++) {
+		for (j = 0; j < n; j++) {
+			int a = i * n + j + 1, b = i * n + (j + 1) % n + 1;
+			fprintf (fp, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", a, a, a, a + n, a + n,
+				a + n, b, b, b);
+			fprintf (fp, "f %i/%i/%i %i/%i/%i %i/%i/%i\n", b, b, b, a + n, a + n,
+				a + n, b + n, b + n, b + n);
+		}
+	}
+	return 0 == fclose (fp);
+}
+
+// the line-by-line loader, as it was before the chunked parser, without its
+// printouts or error messages
+static bool sscanf_load_obj_file (const char* file_name, mesh_t* mesh) {
+	float *vp, *vt, *vn;
+	int vp_count = 0, vt_count = 0, vn_count = 0, face_count = 0;
+	int cvp = 0, cvt = 0, cvn = 0, i;
+	char line[1024];
+	FILE* fp = fopen (file_name, "r");
+	if (!fp) {
+		return false;
+	}
+	while (fgets (line, 1024, fp)) {
+		if (line[0] == 'v') {
+			vp_count += line[1] == ' ';
+			vt_count += line[1] == 't';
+			vn_count += line[1] == 'n';
+		} else if (line[0] == 'f') {
+			face_count++;
+		}
+	}
+	vp = (float*)malloc (vp_count * 3 * sizeof (float));
+	vt = (float*)malloc (vt_count * 2 * sizeof (float));
+	vn = (float*)malloc (vn_count * 3 * sizeof (float));
+	mesh->points = (float*)malloc (3 * face_count * 3 * sizeof (float));
+	mesh->tex_coords = (float*)malloc (3 * face_count * 2 * sizeof (float));
+	mesh->normals = (float*)malloc (3 * face_count * 3 * sizeof (float));
+	mesh->point_count = 0;
+	rewind (fp);
+	while (fgets (line, 1024, fp)) {
+		if (line[0] == 'v' && line[1] == ' ') {
+			float* v = &vp[cvp++ * 3];
+			v[0] = v[1] = v[2] = 0.0f;
+			sscanf (line, "v %f %f %f", &v[0], &v[1], &v[2]);
+		} else if (line[0] == 'v' && line[1] == 't') {
+			float* v = &vt[cvt++ * 2];
+			v[0] = v[1] = 0.0f;
+			sscanf (line, "vt %f %f", &v[0], &v[1]);
+		} else if (line[0] == 'v' && line[1] == 'n') {
+			float* v = &vn[cvn++ * 3];
+			v[0] = v[1] = v[2] = 0.0f;
+			sscanf (line, "vn %f %f %f", &v[0], &v[1], &v[2]);
+		} else if (line[0] == 'f') {
+			int idx[9] = { 0 };
+			sscanf (line, "f %i/%i/%i %i/%i/%i %i/%i/%i", &idx[0], &idx[1],
+				&idx[2], &idx[3], &idx[4], &idx[5], &idx[6], &idx[7], &idx[8]);
+			for (i = 0; i < 3; i++) {
+				int pc = mesh->point_count++;
+				memcpy (&mesh->points[pc * 3], &vp[(idx[i * 3] - 1) * 3],
+					3 * sizeof (float));
+				memcpy (&mesh->tex_coords[pc * 2], &vt[(idx[i * 3 + 1] - 1) * 2],
+					2 * sizeof (float));
+				memcpy (&mesh->normals[pc * 3], &vn[(idx[i * 3 + 2] - 1) * 3],
+					3 * sizeof (float));
+			}
+		}
+	}
+	fclose (fp);
+	free (vp);
+	free (vt);
+	free (vn);
+	return true;
+}
+
+static bool meshes_equal (const mesh_t* a, const mesh_t* b) {
+	size_t n = (size_t)a->point_count;
+	return a->point_count == b->point_count &&
+		0 == memcmp (a->points, b->points, n * 3 * sizeof (float)) &&
+		0 == memcmp (a->tex_coords, b->tex_coords, n * 2 * sizeof (float)) &&
+		0 == memcmp (a->normals, b->normals, n * 3 * sizeof (float));
+}
+
+static void free_mesh (mesh_t* mesh) {
+	free (mesh->points);
+	free (mesh->tex_coords);
+	free (mesh->normals);
+	memset (mesh, 0, sizeof (mesh_t));
+}
+
+int main (int argc, char** argv) {
+	int n_rings = argc > 1 ? atoi (argv[1]) : 1000;
+	double mb, t0, s;
+	mesh_t ref, mesh;
+	bool ok = true;
+	int pass;
+
+	n_rings = n_rings < 3 ? 3 : n_rings;
+	apg_time_init ();
+	if (!write_sphere (BENCH_FILE, n_rings)) {
+		fprintf (stderr, "ERROR: could not write %s\n", BENCH_FILE);
+		return 1;
+	}
+	mb = apg_file_size (BENCH_FILE) / (1024.0 * 1024.0);
+
+	t0 = apg_time_s ();
+	if (!sscanf_load_obj_file (BENCH_FILE, &ref)) {
+		return 1;
+	}
+	s = apg_time_s () - t0;
+	printf ("%.1fMB, %i points\n", mb, ref.point_count);
+	printf ("fgets + sscanf:       %7.3fs %8.1f MB/s\n", s, mb / s);
+
+	for (pass = 0; pass < 2 && ok; pass++) {
+		int n_threads = 1;
+		if (pass > 0) {
+			if (!apg_jobs_init (0)) {
+				break;
+			}
+			n_threads = apg_jobs_n_threads ();
+		}
+		t0 = apg_time_s ();
+		ok = load_obj_file (BENCH_FILE, &mesh.points, &mesh.tex_coords,
+			&mesh.normals, &mesh.point_count);
+		s = apg_time_s () - t0;
+		ok = ok && meshes_equal (&ref, &mesh);
+		printf ("load_obj_file %2i thr: %7.3fs %8.1f MB/s %s\n", n_threads, s,
+			mb / s, ok ? "same" : "DIFFERENT");
+		free_mesh (&mesh);
+	}
+
+	apg_jobs_free ();
+	free_mesh (&ref);
+	remove (BENCH_FILE);
+	return ok ? 0 : 1;
+}
@@ -3,11 +3,329 @@
 // Anton Gerdelan 22 Dec 2014
 // antongerdelan.net
 //
+// The file is mapped into memory and split into chunks of whole lines, which
+// are parsed on the apg.h job threads if apg_jobs_init() has been called, or on
+// this thread if not. A first pass counts each chunk's v, vt, vn, and f lines,
+// so each chunk knows where its first point and face go. Numbers are scanned by
+// hand rather than with sscanf(), which looks up the locale on every call, but
+// give the same values.
+//
 #include "obj_parser.h"
+#include "apg.h"
+#include <float.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#define CHUNK_SZ (1 << 20) // bytes per chunk, rounded up to the end of a line
+
+enum { LINE_VP, LINE_VT, LINE_VN, LINE_F, LINE_KIND_MAX };
+
+typedef enum obj_error_t {
+	OBJ_OK = 0, OBJ_ERROR_SLASHES, OBJ_ERROR_VP, OBJ_ERROR_VT, OBJ_ERROR_VN
+} obj_error_t;
+
+typedef struct obj_chunk_t {
+	size_t start, end; // byte offsets. chunks start at the start of a line
+	// lines of each kind in the chunk after the first pass. then the index of
+	// the chunk's first line of each kind
+	int first[LINE_KIND_MAX];
+	obj_error_t error; // first bad face in the chunk, and the index it's about
+	int error_value;
+} obj_chunk_t;
+
+typedef struct obj_job_t {
+	const char* data;
+	obj_chunk_t* chunks;
+	int counts[LINE_KIND_MAX];
+	float *vp, *vt, *vn;
+	int* face_indices; // vp, vt, vn for each corner of each face, from 0
+	float *points, *tex_coords, *normals;
+} obj_job_t;
+
+static const double pow10_table[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+	1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+}; // all exact in a double
+
+// the whitespace scanf() skips. lines never contain a '\n'
+static int is_space (char c) {
+	return ' ' == c || '\t' == c || '\r' == c || '\v' == c || '\f' == c;
+}
+
+static int line_kind (const char* line, const char* eol) {
+	char c = line + 1 < eol ? line[1] : '\0';
+	if (line[0] == 'v') {
+		if (c == ' ') {
+			return LINE_VP;
+		} else if (c == 't') {
+			return LINE_VT;
+		} else if (c == 'n') {
+			return LINE_VN;
+		}
+	} else if (line[0] == 'f') {
+		return LINE_F;
+	}
+	return LINE_KIND_MAX;
+}
+
+// strtof() on a copy of the token, for anything parse_float() can't convert
+// exactly
+static const char* parse_float_slow (const char* ptr, const char* end,
+	float* f) {
+	char token[64];
+	char* token_end = NULL;
+	int len = 0;
+	while (ptr + len < end && len < 63 && !is_space (ptr[len])) {
+		token[len] = ptr[len];
+		len++;
+	}
+	token[len] = '\0';
+	*f = strtof (token, &token_end);
+	return token_end == token ? NULL : ptr + (token_end - token);
+}
+
+// skips spaces and parses a float as sscanf "%f" does, returning a pointer past
+// it, or NULL if there isn't one. up to 19 significant digits with a small
+// exponent are an exact integer times or over an exact power of ten, which
+// rounds correctly to double (Clinger's fast path), and then to float unless it
+// is exactly halfway between two floats. the rest goes to strtof()
+static const char* parse_float (const char* ptr, const char* end, float* f) {
+	const char* p;
+	unsigned long long mantissa = 0;
+	int negative = 0, n_digits = 0, n_significant = 0, exp10 = 0;
+	unsigned long long bits;
+	double d;
+
+	while (ptr < end && is_space (*ptr)) {
+		ptr++;
+	}
+	p = ptr;
+	if (p < end && ('-' == *p || '+' == *p)) {
+		negative = '-' == *p++;
+	}
+	for (; p < end && *p >= '0' && *p <= '9'; p++, n_digits++) {
+		if (mantissa || '0' != *p) {
+			mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+			n_significant++;
+		}
+	}
+	if (p < end && '.' == *p) {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, n_digits++, exp10--) {
+			if (mantissa || '0' != *p) {
+				mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+				n_significant++;
+			}
+		}
+	}
+	if (!n_digits) {
+		return parse_float_slow (ptr, end, f);
+	}
+	// like glibc's scanf, an 'e' and sign without digits are consumed, and ignored
+	if (p < end && ('e' == *p || 'E' == *p)) {
+		int e_negative = 0, e = 0;
+		p++;
+		if (p < end && ('-' == *p || '+' == *p)) {
+			e_negative = '-' == *p++;
+		}
+		for (; p < end && *p >= '0' && *p <= '9'; p++) {
+			if (e < 10000) {
+				e = e * 10 + (*p - '0');
+			}
+		}
+		exp10 += e_negative ? -e : e;
+	}
+	if (n_significant > 19 || (p < end && ('x' == *p || 'X' == *p))) {
+		return parse_float_slow (ptr, end, f);
+	}
+	if (0 == mantissa) {
+		*f = negative ? -0.0f : 0.0f;
+		return p;
+	}
+	if (mantissa >= (1ull << 53) || exp10 < -22 || exp10 > 22) {
+		return parse_float_slow (ptr, end, f);
+	}
+	d = exp10 < 0 ? (double)mantissa / pow10_table[-exp10] :
+		(double)mantissa * pow10_table[exp10];
+	memcpy (&bits, &d, sizeof (bits));
+	if (d < FLT_MIN || d > FLT_MAX || 0x10000000u == (bits & 0x1FFFFFFFu)) {
+		return parse_float_slow (ptr, end, f);
+	}
+	*f = (float)(negative ? -d : d);
+	return p;
+}
+
+static int digit_value (char c) {
+	return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+		c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+}
+
+// skips spaces and parses an int as sscanf "%i" does, so 0x12 is hex and 012 is
+// octal. too-large numbers saturate
+static const char* parse_int (const char* ptr, const char* end, int* i) {
+	long long v = 0;
+	int negative = 0, base = 10, n_digits = 0;
+
+	while (ptr < end && is_space (*ptr)) {
+		ptr++;
+	}
+	if (ptr < end && ('-' == *ptr || '+' == *ptr)) {
+		negative = '-' == *ptr++;
+	}
+	if (ptr < end && '0' == *ptr) {
+		base = 8;
+		if (ptr + 2 < end && ('x' == ptr[1] || 'X' == ptr[1]) &&
+			digit_value (ptr[2]) < 16) {
+			base = 16;
+			ptr += 2;
+		}
+	}
+	for (; ptr < end; ptr++, n_digits++) {
+		int digit = digit_value (*ptr);
+		if (digit >= base) {
+			break;
+		}
+		if (v <= 0x7FFFFFFF) {
+			v = v * base + digit;
+		}
+	}
+	if (!n_digits) {
+		return NULL;
+	}
+	v = v > 0x7FFFFFFF ? 0x7FFFFFFF : v;
+	*i = negative ? -(int)v : (int)v;
+	return ptr;
+}
+
+static void count_lines (int64_t begin, int64_t end, void* arg) {
+	obj_job_t* job = (obj_job_t*)arg;
+	int64_t c;
+	for (c = begin; c < end; c++) {
+		obj_chunk_t* chunk = &job->chunks[c];
+		const char* line = job->data + chunk->start;
+		const char* chunk_end = job->data + chunk->end;
+		while (line < chunk_end) {
+			const char* eol = memchr (line, '\n', chunk_end - line);
+			int kind;
+			eol = eol ? eol : chunk_end;
+			kind = line_kind (line, eol);
+			if (kind < LINE_KIND_MAX) {
+				chunk->first[kind]++;
+			}
+			line = eol + 1;
+		}
+	}
+}
+
+// reads "f vp/vt/vn vp/vt/vn vp/vt/vn" into 9 indices from 0, checking them in
+// the same order as the sscanf() loader did. indices that don't parse are
+// left at 0, which is out of range
+static obj_error_t parse_face (const obj_job_t* job, const char* line,
+	const char* eol, int* indices, int* error_value) {
+	const char* p = line + 1;
+	int values[9] = { 0 };
+	int slash_count = 0;
+	int i;
+
+	for (i = 0; line + i < eol; i++) {
+		if (line[i] == '/') {
+			slash_count++;
+		}
+	}
+	if (slash_count != 6) {
+		return OBJ_ERROR_SLASHES;
+	}
+	for (i = 0; i < 9 && p; i++) {
+		p = parse_int (p, eol, &values[i]);
+		if (p && i % 3 != 2) {
+			p = p < eol && '/' == *p ? p + 1 : NULL;
+		}
+	}
+	for (i = 0; i < 3; i++) {
+		int vp = values[i * 3] - 1, vt = values[i * 3 + 1] - 1;
+		int vn = values[i * 3 + 2] - 1;
+		if (vp < 0 || vp >= job->counts[LINE_VP]) {
+			return OBJ_ERROR_VP;
+		}
+		if (vt < 0 || vt >= job->counts[LINE_VT]) {
+			*error_value = values[i * 3 + 1];
+			return OBJ_ERROR_VT;
+		}
+		if (vn < 0 || vn >= job->counts[LINE_VN]) {
+			return OBJ_ERROR_VN;
+		}
+		indices[i * 3] = vp;
+		indices[i * 3 + 1] = vt;
+		indices[i * 3 + 2] = vn;
+	}
+	return OBJ_OK;
+}
+
+static void parse_lines (int64_t begin, int64_t end, void* arg) {
+	obj_job_t* job = (obj_job_t*)arg;
+	int64_t c;
+	for (c = begin; c < end; c++) {
+		obj_chunk_t* chunk = &job->chunks[c];
+		const char* line = job->data + chunk->start;
+		const char* chunk_end = job->data + chunk->end;
+		float* vp = job->vp + (size_t)chunk->first[LINE_VP] * 3;
+		float* vt = job->vt + (size_t)chunk->first[LINE_VT] * 2;
+		float* vn = job->vn + (size_t)chunk->first[LINE_VN] * 3;
+		int* face = job->face_indices + (size_t)chunk->first[LINE_F] * 9;
+		while (line < chunk_end) {
+			const char* eol = memchr (line, '\n', chunk_end - line);
+			const char* p;
+			eol = eol ? eol : chunk_end;
+			switch (line_kind (line, eol)) {
+			case LINE_VP:
+				vp[0] = vp[1] = vp[2] = 0.0f;
+				p = parse_float (line + 1, eol, &vp[0]);
+				p = p ? parse_float (p, eol, &vp[1]) : NULL;
+				p = p ? parse_float (p, eol, &vp[2]) : NULL;
+				vp += 3;
+				break;
+			case LINE_VT:
+				vt[0] = vt[1] = 0.0f;
+				p = parse_float (line + 2, eol, &vt[0]);
+				p = p ? parse_float (p, eol, &vt[1]) : NULL;
+				vt += 2;
+				break;
+			case LINE_VN:
+				vn[0] = vn[1] = vn[2] = 0.0f;
+				p = parse_float (line + 2, eol, &vn[0]);
+				p = p ? parse_float (p, eol, &vn[1]) : NULL;
+				p = p ? parse_float (p, eol, &vn[2]) : NULL;
+				vn += 3;
+				break;
+			case LINE_F:
+				chunk->error = parse_face (job, line, eol, face,
+					&chunk->error_value);
+				if (chunk->error != OBJ_OK) {
+					return;
+				}
+				face += 9;
+				break;
+			default: break;
+			}
+			line = eol + 1;
+		}
+	}
+}
+
+static void copy_faces (int64_t begin, int64_t end, void* arg) {
+	obj_job_t* job = (obj_job_t*)arg;
+	int64_t pc;
+	for (pc = begin * 3; pc < end * 3; pc++) {
+		const int* indices = &job->face_indices[pc * 3];
+		memcpy (&job->points[pc * 3], &job->vp[indices[0] * 3],
+			3 * sizeof (float));
+		memcpy (&job->tex_coords[pc * 2], &job->vt[indices[1] * 2],
+			2 * sizeof (float));
+		memcpy (&job->normals[pc * 3], &job->vn[indices[2] * 3],
+			3 * sizeof (float));
+	}
+}
+
 bool load_obj_file  (
 	const char* file_name,
 	float** points,
@@ -15,147 +333,125 @@ bool load_obj_file  (
 	float** normals,
 	int* point_count
 ) {
-	FILE* fp = NULL;
-	float* unsorted_vp_array = NULL;
-	float* unsorted_vt_array = NULL;
-	float* unsorted_vn_array = NULL;
-	int current_unsorted_vp = 0;
-	int current_unsorted_vt = 0;
-	int current_unsorted_vn = 0;
-	int unsorted_vp_count = 0;
-	int unsorted_vt_count = 0;
-	int unsorted_vn_count = 0;
-	int face_count = 0;
-	int i;
-	char line[1024];
+	apg_file_t record;
+	obj_job_t job;
+	obj_chunk_t* chunks = NULL;
+	int n_chunks = 0, first[LINE_KIND_MAX] = { 0 };
+	int i, k;
+	bool ok = true;
+
+	*points = *tex_coords = *normals = NULL;
+	*point_count = 0;
+	if (!apg_file_map (file_name, &record)) {
+		// empty files can't be mapped, but they are valid, with no points
+		FILE* fp = fopen (file_name, "r");
+		if (!fp) {
+			fprintf (stderr, "ERROR: could not find file %s\n", file_name);
+			return false;
+		}
+		fclose (fp);
+		record.data_ptr = NULL;
+		record.sz = 0;
+	}
+	memset (&job, 0, sizeof (job));
+	job.data = (const char*)record.data_ptr;
 
-	fp = fopen (file_name, "r");
-	if (!fp) {
-		fprintf (stderr, "ERROR: could not find file %s\n", file_name);
+	// split the file into chunks of whole lines
+	chunks = (obj_chunk_t*)calloc (record.sz / CHUNK_SZ + 2, sizeof (obj_chunk_t));
+	if (!chunks) {
+		fprintf (stderr, "ERROR: out of memory reading %s\n", file_name);
+		apg_file_unmap (&record);
 		return false;
 	}
-	
+	while (chunks[n_chunks].start < record.sz) {
+		size_t end = chunks[n_chunks].start + CHUNK_SZ;
+		if (end < record.sz) {
+			const char* eol = memchr (job.data + end, '\n', record.sz - end);
+			end = eol ? (size_t)(eol - job.data) + 1 : record.sz;
+		} else {
+			end = record.sz;
+		}
+		chunks[n_chunks++].end = end;
+		chunks[n_chunks].start = end;
+	}
+	job.chunks = chunks;
+
 	// first count points in file so we know how much mem to allocate
-	*point_count = 0;
-	while (fgets (line, 1024, fp)) {
-		if (line[0] == 'v') {
-			if (line[1] == ' ') {
-				unsorted_vp_count++;
-			} else if (line[1] == 't') {
-				unsorted_vt_count++;
-			} else if (line[1] == 'n') {
-				unsorted_vn_count++;
-			}
-		} else if (line[0] == 'f') {
-			face_count++;
+	apg_jobs_parallel_for (0, n_chunks, 1, count_lines, &job);
+	for (i = 0; i < n_chunks; i++) {
+		for (k = 0; k < LINE_KIND_MAX; k++) {
+			int n = chunks[i].first[k];
+			chunks[i].first[k] = first[k];
+			first[k] += n;
 		}
 	}
+	memcpy (job.counts, first, sizeof (first));
 	printf ("found %i vp %i vt %i vn unique in obj. allocating memory...\n",
-		unsorted_vp_count, unsorted_vt_count, unsorted_vn_count);
-	unsorted_vp_array = (float*)malloc (unsorted_vp_count * 3 * sizeof (float));
-	unsorted_vt_array = (float*)malloc (unsorted_vt_count * 2 * sizeof (float));
-	unsorted_vn_array = (float*)malloc (unsorted_vn_count * 3 * sizeof (float));
-	*points = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	*tex_coords = (float*)malloc (3 * face_count * 2 * sizeof (float));
-	*normals = (float*)malloc (3 * face_count * 3 * sizeof (float));
-	printf ("allocated %i bytes for mesh\n", (int)(3 * face_count * 8 *
+		job.counts[LINE_VP], job.counts[LINE_VT], job.counts[LINE_VN]);
+	job.vp = (float*)malloc (job.counts[LINE_VP] * 3 * sizeof (float) + 1);
+	job.vt = (float*)malloc (job.counts[LINE_VT] * 2 * sizeof (float) + 1);
+	job.vn = (float*)malloc (job.counts[LINE_VN] * 3 * sizeof (float) + 1);
+	job.face_indices = (int*)malloc (job.counts[LINE_F] * 9 * sizeof (int) + 1);
+	*points = (float*)malloc (3 * job.counts[LINE_F] * 3 * sizeof (float));
+	*tex_coords = (float*)malloc (3 * job.counts[LINE_F] * 2 * sizeof (float));
+	*normals = (float*)malloc (3 * job.counts[LINE_F] * 3 * sizeof (float));
+	printf ("allocated %i bytes for mesh\n", (int)(3 * job.counts[LINE_F] * 8 *
 		sizeof (float)));
-	
-	rewind (fp);
-	while (fgets (line, 1024, fp)) {
-		// vertex
-		if (line[0] == 'v') {
-		
-			// vertex point
-			if (line[1] == ' ') {
-				float x, y, z;
-				x = y = z = 0.0f;
-				sscanf (line, "v %f %f %f", &x, &y, &z);
-				unsorted_vp_array[current_unsorted_vp * 3] = x;
-				unsorted_vp_array[current_unsorted_vp * 3 + 1] = y;
-				unsorted_vp_array[current_unsorted_vp * 3 + 2] = z;
-				current_unsorted_vp++;
-				
-			// vertex texture coordinate
-			} else if (line[1] == 't') {
-				float s, t;
-				s = t = 0.0f;
-				sscanf (line, "vt %f %f", &s, &t);
-				unsorted_vt_array[current_unsorted_vt * 2] = s;
-				unsorted_vt_array[current_unsorted_vt * 2 + 1] = t;
-				current_unsorted_vt++;
-				
-			// vertex normal
-			} else if (line[1] == 'n') {
-				float x, y, z;
-				x = y = z = 0.0f;
-				sscanf (line, "vn %f %f %f", &x, &y, &z);
-				unsorted_vn_array[current_unsorted_vn * 3] = x;
-				unsorted_vn_array[current_unsorted_vn * 3 + 1] = y;
-				unsorted_vn_array[current_unsorted_vn * 3 + 2] = z;
-				current_unsorted_vn++;
-			}
-			
-		// faces
-		} else if (line[0] == 'f') {
-			int vp[3], vt[3], vn[3], len;
-			int slashCount = 0;
-			// work out if using quads instead of triangles and print a warning
-			
-			len = strlen (line);
-			for (i = 0; i < len; i++) {
-				if (line[i] == '/') {
-					slashCount++;
-				}
-			}
-			if (slashCount != 6) {
+	if (!job.vp || !job.vt || !job.vn || !job.face_indices ||
+		(job.counts[LINE_F] && (!*points || !*tex_coords || !*normals))) {
+		fprintf (stderr, "ERROR: out of memory reading %s\n", file_name);
+		ok = false;
+	}
+
+	if (ok) {
+		apg_jobs_parallel_for (0, n_chunks, 1, parse_lines, &job);
+		// report the first bad face in the file, as the line-by-line loader did
+		for (i = 0; i < n_chunks && ok; i++) {
+			switch (chunks[i].error) {
+			case OBJ_OK: break;
+			case OBJ_ERROR_SLASHES:
 				fprintf (
 					stderr,
 					"ERROR: file contains quads or does not match v vp/vt/vn layout - \
 					make sure exported mesh is triangulated and contains vertex points, \
 					texture coordinates, and normals\n"
 				);
-				return false;
-			}
-
-			sscanf (line, "f %i/%i/%i %i/%i/%i %i/%i/%i",
-			 &vp[0], &vt[0], &vn[0], &vp[1], &vt[1], &vn[1], &vp[2], &vt[2], &vn[2]);
-			/* start reading points into a buffer. order is -1 because obj starts
-			   from 1, not 0 */
-			// NB: assuming all indices are valid
-			for (i = 0; i < 3; i++) {
-				int pc = *point_count;
-				if ((vp[i] - 1 < 0) || (vp[i] - 1 >= unsorted_vp_count)) {
-					fprintf (stderr, "ERROR: invalid vertex position index in face\n");
-					return false;
-				}
-				if ((vt[i] - 1 < 0) || (vt[i] - 1 >= unsorted_vt_count)) {
-					fprintf (stderr, "ERROR: invalid texture coord index %i in face.\n",
-						vt[i]);
-					return false;
-				}
-				if ((vn[i] - 1 < 0) || (vn[i] - 1 >= unsorted_vn_count)) {
-					printf ("ERROR: invalid vertex normal index in face\n");
-					return false;
-				}
-				// note - parentheses needed for C array dereferencing w/ptr
-				(*points)[pc * 3] = unsorted_vp_array[(vp[i] - 1) * 3];
-				(*points)[pc * 3 + 1] = unsorted_vp_array[(vp[i] - 1) * 3 + 1];
-				(*points)[pc * 3 + 2] = unsorted_vp_array[(vp[i] - 1) * 3 + 2];
-				(*tex_coords)[pc * 2] = unsorted_vt_array[(vt[i] - 1) * 2];
-				(*tex_coords)[pc * 2 + 1] = unsorted_vt_array[(vt[i] - 1) * 2 + 1];
-				(*normals)[pc * 3] = unsorted_vn_array[(vn[i] - 1) * 3];
-				(*normals)[pc * 3 + 1] = unsorted_vn_array[(vn[i] - 1) * 3 + 1];
-				(*normals)[pc * 3 + 2] = unsorted_vn_array[(vn[i] - 1) * 3 + 2];
-				// ++ doesnt work here for deref, need brackets or it increments ptr
-				(*point_count)++;
+				ok = false;
+				break;
+			case OBJ_ERROR_VP:
+				fprintf (stderr, "ERROR: invalid vertex position index in face\n");
+				ok = false;
+				break;
+			case OBJ_ERROR_VT:
+				fprintf (stderr, "ERROR: invalid texture coord index %i in face.\n",
+					chunks[i].error_value);
+				ok = false;
+				break;
+			case OBJ_ERROR_VN:
+				printf ("ERROR: invalid vertex normal index in face\n");
+				ok = false;
+				break;
 			}
 		}
 	}
-	fclose (fp);
-	free (unsorted_vp_array);
-	free (unsorted_vn_array);
-	free (unsorted_vt_array);
-	printf ("allocated %i points\n", *point_count);
-	return true;
+	if (ok) {
+		job.points = *points;
+		job.tex_coords = *tex_coords;
+		job.normals = *normals;
+		apg_jobs_parallel_for (0, job.counts[LINE_F], 1 << 14, copy_faces, &job);
+		*point_count = job.counts[LINE_F] * 3;
+		printf ("allocated %i points\n", *point_count);
+	} else {
+		free (*points);
+		free (*tex_coords);
+		free (*normals);
+		*points = *tex_coords = *normals = NULL;
+	}
+	free (job.vp);
+	free (job.vt);
+	free (job.vn);
+	free (job.face_indices);
+	free (chunks);
+	apg_file_unmap (&record);
+	return ok;
 }
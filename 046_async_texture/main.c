@@ -223,9 +223,7 @@ int main() {
   glClearColor( 0.2, 0.2, 0.2, 1.0 );
   while ( !glfwWindowShouldClose( g_window ) ) {
     glfwPollEvents();
-    worker_pool_update(); // fire callbacks for any finished threads, and free up workers
-    // this means jobs can never be processed in less than this frequency...hmm...
-    // could also queue 'done' jobs and keep going
+    worker_pool_update(); // fire callbacks for any jobs finished since last frame. workers don't wait for this.
 
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
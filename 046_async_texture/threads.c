@@ -5,177 +5,311 @@
 #include <pthread.h> // could move into platform file for Windows support
 #include <unistd.h>  // not portable TODO
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#define MAX_JOBS_IN_QUEUE 64
-#define MAX_WORKERS 7
-#define WORKER_SLEEP_MICRO_S 100000 // 0.1s
+#define MAX_WORKERS 64
+#define INITIAL_QUEUE_CAPACITY 64 // queues double in size when full
 
 typedef struct worker_t {
   int own_idx;
   pthread_t thread;
-
-  job_description_t job;
-
-  pthread_mutex_t mutex;
-  bool shutdown;
-  bool finished_job;
 } worker_t;
 
+// growable ring buffer of jobs. only accessed with the pool mutex held.
 typedef struct job_queue_t {
-  pthread_mutex_t mutex;
-  job_description_t data[MAX_JOBS_IN_QUEUE];
+  job_description_t* data;
+  int capacity;
   int n;
   int start_idx;
-  bool shutting_down;
 } job_queue_t;
 
 typedef struct worker_pool_t {
-  job_queue_t job_queue;
+  pthread_mutex_t mutex;        // protects everything below
+  pthread_cond_t job_available; // signalled on push and on shutdown
+  job_queue_t job_queue;        // waiting to be started by a worker
+  job_queue_t finished_queue;   // waiting for worker_pool_update() to call on_finished_cb on the main thread
   worker_t workers[MAX_WORKERS];
+  int n_workers;
+  bool shutting_down;
 } worker_pool_t;
 
 static worker_pool_t _g_pool;
 
+#ifdef WORKER_POOL_LATENCY_BENCH
+static void _bench_job_completed( void* args );
+#endif
+
+// call with the pool mutex held. returns false if out of memory.
+static bool _queue_push( job_queue_t* queue, job_description_t job ) {
+  if ( queue->n >= queue->capacity ) {
+    int new_capacity            = queue->capacity > 0 ? queue->capacity * 2 : INITIAL_QUEUE_CAPACITY;
+    job_description_t* new_data    = malloc( sizeof( job_description_t ) * new_capacity );
+    if ( !new_data ) { return false; }
+    // unwrap the ring into the start of the new buffer
+    for ( int i = 0; i < queue->n; i++ ) { new_data[i] = queue->data[( queue->start_idx + i ) % queue->capacity]; }
+    free( queue->data );
+    queue->data      = new_data;
+    queue->capacity  = new_capacity;
+    queue->start_idx = 0;
+  }
+  int end_idx          = ( queue->start_idx + queue->n ) % queue->capacity;
+  queue->data[end_idx] = job;
+  queue->n++;
+  return true;
+}
+
+// call with the pool mutex held
+static bool _queue_pop( job_queue_t* queue, job_description_t* job ) {
+  if ( queue->n <= 0 ) { return false; }
+  *job             = queue->data[queue->start_idx];
+  queue->start_idx = ( queue->start_idx + 1 ) % queue->capacity;
+  queue->n--;
+  return true;
+}
+
+static void _queue_free( job_queue_t* queue ) {
+  free( queue->data );
+  *queue = ( job_queue_t ){ .n = 0 };
+}
+
 static void* _worker_thread_sr( void* arg ) {
   int worker_idx = *( (int*)arg );
 
+  pthread_mutex_lock( &_g_pool.mutex );
   while ( 1 ) {
-    // check if threads are shutting down and break loop
-    bool shutdown = false;
-    bool finished = false;
-    pthread_mutex_lock( &_g_pool.workers[worker_idx].mutex );
-    shutdown = _g_pool.workers[worker_idx].shutdown;
-    finished = _g_pool.workers[worker_idx].finished_job;
-    pthread_mutex_unlock( &_g_pool.workers[worker_idx].mutex );
-    if ( shutdown ) { break; }
-    // wait for main thread to fire acknowledgement callback
-    if ( finished ) {
-      usleep( WORKER_SLEEP_MICRO_S );
-      continue;
-    }
+    // sleep until there's work. the loop guards against spurious wakeups.
+    while ( !_g_pool.shutting_down && 0 == _g_pool.job_queue.n ) { pthread_cond_wait( &_g_pool.job_available, &_g_pool.mutex ); }
+    if ( _g_pool.shutting_down ) { break; }
 
-    // look for job
-    memset( &_g_pool.workers[worker_idx].job, 0, sizeof( job_description_t ) );
-    bool got_job = worker_pool_pop_job( &_g_pool.workers[worker_idx].job );
-    if ( got_job ) {
-      _g_pool.workers[worker_idx].job.job_function_ptr( worker_idx, _g_pool.workers[worker_idx].job.job_function_args );
+    job_description_t job;
+    bool got_job = _queue_pop( &_g_pool.job_queue, &job );
+    assert( got_job );
+    pthread_mutex_unlock( &_g_pool.mutex );
 
-      pthread_mutex_lock( &_g_pool.workers[worker_idx].mutex );
-      _g_pool.workers[worker_idx].finished_job = true;
-      pthread_mutex_unlock( &_g_pool.workers[worker_idx].mutex );
-      continue;
-    }
+    job.job_function_ptr( worker_idx, job.job_function_args );
+#ifdef WORKER_POOL_LATENCY_BENCH
+    _bench_job_completed( job.job_function_args ); // after the job returns, before it waits in the completion queue
+#endif
 
-    // TODO(Anton) wake on signal that a job has entered the queue
-    // otherwise sleep
-    usleep( WORKER_SLEEP_MICRO_S );
+    // hand the result to the main thread and go straight on to the next job without waiting for acknowledgement
+    pthread_mutex_lock( &_g_pool.mutex );
+    if ( !_queue_push( &_g_pool.finished_queue, job ) ) { fprintf( stderr, "ERROR: out of memory queueing finished job `%s`\n", job.name ); }
   }
+  pthread_mutex_unlock( &_g_pool.mutex );
   return NULL;
 }
 
+static int _n_logical_cpus() {
+  long n = sysconf( _SC_NPROCESSORS_ONLN );
+  return n > 0 ? (int)n : 1;
+}
+
 void worker_pool_init() {
-  int ret = pthread_mutex_init( &_g_pool.job_queue.mutex, NULL );
+  int ret = pthread_mutex_init( &_g_pool.mutex, NULL );
+  assert( 0 == ret );
+  ret = pthread_cond_init( &_g_pool.job_available, NULL );
   assert( 0 == ret );
+  _g_pool.shutting_down = false;
 
-  for ( int i = 0; i < MAX_WORKERS; i++ ) {
+  // one worker per logical CPU, leaving one for the main thread
+  _g_pool.n_workers = _n_logical_cpus() - 1;
+  if ( _g_pool.n_workers < 1 ) { _g_pool.n_workers = 1; }
+  if ( _g_pool.n_workers > MAX_WORKERS ) { _g_pool.n_workers = MAX_WORKERS; }
+
+  for ( int i = 0; i < _g_pool.n_workers; i++ ) {
     _g_pool.workers[i].own_idx = i;
     int ret                    = pthread_create( &_g_pool.workers[i].thread, NULL, _worker_thread_sr, &_g_pool.workers[i].own_idx );
     assert( 0 == ret );
-    ret = pthread_mutex_init( &_g_pool.workers[i].mutex, NULL );
-    assert( 0 == ret );
-
-    _g_pool.workers[i].own_idx = i;
   }
 }
 
 void worker_pool_free() {
-  int ret = pthread_mutex_destroy( &_g_pool.job_queue.mutex );
-  assert( 0 == ret );
-
-  for ( int i = 0; i < MAX_WORKERS; i++ ) {
-    pthread_mutex_lock( &_g_pool.workers[i].mutex );
-    _g_pool.workers[i].shutdown = true;
-    pthread_mutex_unlock( &_g_pool.workers[i].mutex );
+  pthread_mutex_lock( &_g_pool.mutex );
+  _g_pool.shutting_down = true;
+  pthread_cond_broadcast( &_g_pool.job_available );
+  pthread_mutex_unlock( &_g_pool.mutex );
 
-    ret = pthread_join( _g_pool.workers[i].thread, NULL );
-    assert( 0 == ret );
-
-    ret = pthread_mutex_destroy( &_g_pool.workers[i].mutex );
+  for ( int i = 0; i < _g_pool.n_workers; i++ ) {
+    int ret = pthread_join( _g_pool.workers[i].thread, NULL );
     assert( 0 == ret );
   }
+  _g_pool.n_workers = 0;
+
+  if ( _g_pool.job_queue.n > 0 ) { printf( "WARNING: worker pool freed with %i jobs not started\n", _g_pool.job_queue.n ); }
+  _queue_free( &_g_pool.job_queue );
+  _queue_free( &_g_pool.finished_queue );
+  int ret = pthread_cond_destroy( &_g_pool.job_available );
+  assert( 0 == ret );
+  ret = pthread_mutex_destroy( &_g_pool.mutex );
+  assert( 0 == ret );
 }
 
+int worker_pool_n_workers() { return _g_pool.n_workers; }
+
 bool worker_pool_push_job( job_description_t job ) {
-  printf( "pushing job `%s` to queue\n", job.name );
-  pthread_mutex_lock( &_g_pool.job_queue.mutex );
-  {
-    if ( _g_pool.job_queue.n >= MAX_JOBS_IN_QUEUE ) { return false; }
-    int end_idx                     = ( _g_pool.job_queue.start_idx + _g_pool.job_queue.n ) % MAX_JOBS_IN_QUEUE;
-    _g_pool.job_queue.data[end_idx] = job;
-    _g_pool.job_queue.n++;
-    printf( "jobs queued = %i\n", _g_pool.job_queue.n );
-  }
-  pthread_mutex_unlock( &_g_pool.job_queue.mutex );
-  return true;
+  pthread_mutex_lock( &_g_pool.mutex );
+  bool pushed = _queue_push( &_g_pool.job_queue, job );
+  if ( pushed ) { pthread_cond_signal( &_g_pool.job_available ); } // wake exactly one sleeping worker, if any
+  pthread_mutex_unlock( &_g_pool.mutex );
+  return pushed;
 }
 
 bool worker_pool_pop_job( job_description_t* job ) {
   assert( job );
 
-  bool got_job = false;
-
-  // fetch job off queue
-  pthread_mutex_lock( &_g_pool.job_queue.mutex );
-  if ( _g_pool.job_queue.n > 0 ) {
-    *job                        = _g_pool.job_queue.data[_g_pool.job_queue.start_idx];
-    _g_pool.job_queue.start_idx = ( _g_pool.job_queue.start_idx + 1 ) % MAX_JOBS_IN_QUEUE;
-    _g_pool.job_queue.n--;
-    got_job = true;
-    printf( "job queue is now reduced to %i\n", _g_pool.job_queue.n );
-  }
-  pthread_mutex_unlock( &_g_pool.job_queue.mutex );
+  pthread_mutex_lock( &_g_pool.mutex );
+  bool got_job = _queue_pop( &_g_pool.job_queue, job );
+  pthread_mutex_unlock( &_g_pool.mutex );
 
   return got_job;
 }
 
 void worker_pool_update() {
-  for ( int i = 0; i < MAX_WORKERS; i++ ) {
-    bool finished = false;
-    pthread_mutex_lock( &_g_pool.workers[i].mutex );
-    if ( _g_pool.workers[i].finished_job ) {
-      finished                        = true;
-      _g_pool.workers[i].finished_job = false; // let thread get another job
-    }
-    pthread_mutex_unlock( &_g_pool.workers[i].mutex );
-    if ( finished ) { _g_pool.workers[i].job.on_finished_cb( _g_pool.workers[i].job.name, _g_pool.workers[i].job.job_function_args ); }
+  while ( 1 ) {
+    // pop one at a time so callbacks run without the lock held and may push new jobs
+    job_description_t job;
+    pthread_mutex_lock( &_g_pool.mutex );
+    bool got_job = _queue_pop( &_g_pool.finished_queue, &job );
+    pthread_mutex_unlock( &_g_pool.mutex );
+    if ( !got_job ) { break; }
+    if ( job.on_finished_cb ) { job.on_finished_cb( job.name, job.job_function_args ); }
   }
 }
 
+#if defined( WORKER_POOL_UNIT_TEST ) || defined( WORKER_POOL_LATENCY_BENCH )
+#include <time.h>
+
+static double _time_s() {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
 #ifdef WORKER_POOL_UNIT_TEST
 // unit tests app for threads.c
-void test_job_function_ptr( int worker_idx ) {
-  printf( "starting job on worker_idx %i\n", worker_idx );
-  sleep( 10 );
+static void test_job_function_ptr( int worker_idx, void* args ) {
+  printf( "starting job %i on worker_idx %i\n", *(int*)args, worker_idx );
+  usleep( 20000 );
 }
 
-void test_on_finished_cb( const char* name ) { printf( "job `%s` is done -- can access memory it wrote\n", name ); }
+static void test_on_finished_cb( const char* name, void* args ) {
+  ( *(int*)args ) = -1;
+  printf( "job `%s` is done -- can access memory it wrote\n", name );
+}
 
 int main() {
   worker_pool_init();
+  printf( "%i workers\n", worker_pool_n_workers() );
 
-  for ( int i = 0; i < 20; i++ ) {
-    job_description_t job;
-    job.job_function_ptr = test_job_function_ptr;
-    job.on_finished_cb   = test_on_finished_cb;
+  // more jobs than the initial queue capacity to test growth
+  enum { n_jobs = INITIAL_QUEUE_CAPACITY * 3 };
+  static int job_ids[n_jobs];
+  for ( int i = 0; i < n_jobs; i++ ) {
+    job_ids[i]            = i;
+    job_description_t job = { 0 };
+    job.job_function_ptr  = test_job_function_ptr;
+    job.job_function_args = &job_ids[i];
+    job.on_finished_cb    = test_on_finished_cb;
     snprintf( job.name, 16, "job %i", i );
-    if ( !worker_pool_push_job( job ) ) { printf( "WARNING: could not queue job %i - queue full\n", i ); }
-    sleep( 1 );
+    if ( !worker_pool_push_job( job ) ) { printf( "WARNING: could not queue job %i\n", i ); }
+  }
+
+  int n_done     = 0;
+  double start_s = _time_s();
+  while ( n_done < n_jobs && _time_s() - start_s < 60.0 ) {
     worker_pool_update();
+    n_done = 0;
+    for ( int i = 0; i < n_jobs; i++ ) { n_done += job_ids[i] == -1 ? 1 : 0; }
+    usleep( 1000 );
   }
+  printf( "%i/%i jobs finished in %.2fs\n", n_done, n_jobs, _time_s() - start_s );
 
   printf( "freeing worker pool...\n" );
   worker_pool_free();
   printf( "~~Fin!~~\n" );
+  return n_done == n_jobs ? 0 : 1;
+}
+#endif
+
+#ifdef WORKER_POOL_LATENCY_BENCH
+/* Measures push-to-start, push-to-complete, and push-to-callback latency for near-empty jobs,
+   first one job at a time (wakeup latency of an idle pool) then in bursts (queue contention).
+   gcc -O2 -DWORKER_POOL_LATENCY_BENCH threads.c -o latency_bench -lpthread && ./latency_bench
+*/
+#define BENCH_N_JOBS 2000
+#define BENCH_BURST 32
+
+typedef struct bench_job_t {
+  double pushed_s, started_s, completed_s, callback_s;
+} bench_job_t;
+
+static void _bench_job( int worker_idx, void* args ) {
+  (void)worker_idx;
+  bench_job_t* bj = (bench_job_t*)args;
+  bj->started_s   = _time_s();
+}
+
+// called by the worker itself once _bench_job() has returned.
+static void _bench_job_completed( void* args ) { ( (bench_job_t*)args )->completed_s = _time_s(); }
+
+static void _bench_finished_cb( const char* name, void* args ) {
+  (void)name;
+  ( (bench_job_t*)args )->callback_s = _time_s();
+}
+
+static int _cmp_double( const void* a, const void* b ) {
+  double da = *(const double*)a, db = *(const double*)b;
+  return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static void _print_stats( const char* label, double* samples, int n ) {
+  qsort( samples, n, sizeof( double ), _cmp_double );
+  double sum = 0.0;
+  for ( int i = 0; i < n; i++ ) { sum += samples[i]; }
+  printf( "  %-18s mean %8.1fus  p50 %8.1fus  p99 %8.1fus  max %8.1fus\n", label, sum / n * 1e6, samples[n / 2] * 1e6, samples[n * 99 / 100] * 1e6, samples[n - 1] * 1e6 );
+}
+
+static void _run_bench( const char* title, int burst ) {
+  static bench_job_t jobs[BENCH_N_JOBS];
+  static double start_lat[BENCH_N_JOBS], complete_lat[BENCH_N_JOBS], callback_lat[BENCH_N_JOBS];
+  memset( jobs, 0, sizeof( jobs ) );
+
+  for ( int first = 0; first < BENCH_N_JOBS; first += burst ) {
+    int last = first + burst < BENCH_N_JOBS ? first + burst : BENCH_N_JOBS;
+    for ( int i = first; i < last; i++ ) {
+      job_description_t job = { .job_function_ptr = _bench_job, .job_function_args = &jobs[i], .on_finished_cb = _bench_finished_cb };
+      jobs[i].pushed_s      = _time_s();
+      worker_pool_push_job( job );
+    }
+    // the main thread polls as it would in a frame loop, just without the frame
+    bool all_done = false;
+    while ( !all_done ) {
+      worker_pool_update();
+      all_done = true;
+      for ( int i = first; i < last; i++ ) {
+        if ( 0.0 == jobs[i].callback_s ) { all_done = false; }
+      }
+    }
+    usleep( 200 ); // let workers go back to sleep so the next burst measures a wakeup
+  }
+  for ( int i = 0; i < BENCH_N_JOBS; i++ ) {
+    start_lat[i]    = jobs[i].started_s - jobs[i].pushed_s;
+    complete_lat[i] = jobs[i].completed_s - jobs[i].pushed_s;
+    callback_lat[i] = jobs[i].callback_s - jobs[i].pushed_s;
+  }
+  printf( "%s (%i jobs, bursts of %i)\n", title, BENCH_N_JOBS, burst );
+  _print_stats( "push->start", start_lat, BENCH_N_JOBS );
+  _print_stats( "push->complete", complete_lat, BENCH_N_JOBS );
+  _print_stats( "push->callback", callback_lat, BENCH_N_JOBS );
+}
+
+int main() {
+  worker_pool_init();
+  printf( "%i workers\n", worker_pool_n_workers() );
+  _run_bench( "single jobs", 1 );
+  _run_bench( "bursts", BENCH_BURST );
+  worker_pool_free();
   return 0;
 }
 #endif
@@ -1,11 +1,14 @@
 /* Copyright Anton Gerdelan <antongdl@protonmail.com>. 2019
 Design:
-  7 threads + main thread ( 1 per logical CPU on a typical 4-core machine )
+  1 thread per logical CPU, minus 1 for the main thread
   threads persist until worker_pool_free is called
-  threads consume jobs from queue until no jobs exist in queue
-  threads halt when finished a job until worker_pool_update() is called to clear finished jobs ( allows on_finished callback on main thread )
+  idle threads sleep on a condition variable and are woken as soon as a job is pushed
+  finished jobs go onto a completion queue, and the thread moves straight on to the next job
+  worker_pool_update() drains the completion queue, calling each on_finished callback on the main thread
+  job and completion queues grow as needed
 
 Tests: define WORKER_POOL_UNIT_TEST to include a main() running a test program in threads.c
+Bench: define WORKER_POOL_LATENCY_BENCH to include a main() measuring push-to-start, push-to-complete and push-to-callback latency in threads.c
 */
 
 #pragma once
@@ -34,11 +37,14 @@ void worker_pool_init();
 // signals all threads to stop, waits until current jobs done, cleans up threads.
 void worker_pool_free();
 
-// returns false if queue was full
+// returns false if the queue couldn't grow to fit the job ( out of memory )
 bool worker_pool_push_job( job_description_t job );
 
 // returns true if a job existed to be popped from the queue
 bool worker_pool_pop_job( job_description_t* job );
 
-// checks for finished jobs
+// calls on_finished_cb for every job finished since the last call. on_finished_cb may be NULL.
 void worker_pool_update();
+
+// number of worker threads started by worker_pool_init()
+int worker_pool_n_workers();
@@ -0,0 +1,114 @@
+/* Benchmark for apg_tga.h: file sizes and read times of each image type, and reading RGB with the swap and flip fused into the row copy
+against reading BGR then calling apg_tga_bgr_to_rgb().
+Author:   Anton Gerdelan  antongerdelan.net
+Licence:  See apg_tga.h
+
+Build:
+  gcc -O2 tga_bench.c -o tga_bench
+  gcc -O2 -DAPG_TGA_NO_SIMD tga_bench.c -o tga_bench_c  - for the plain C swap.
+Run:
+  ./tga_bench [side]
+
+Makes a side x side (default 4096) render-like image: flat background, with noisy shapes over a third of it. Times are the best of
+several reads from memory, so they don't include the disk. Every read must match the image written.
+*/
+
+#define APG_TGA_IMPLEMENTATION
+#include "../common/include/apg_tga.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_REPEATS 5
+
+static double _time_s( void ) {
+  struct timespec ts;
+  timespec_get( &ts, TIME_UTC );
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t _xorshift( uint32_t* state_ptr ) {
+  uint32_t x = *state_ptr;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state_ptr = x;
+}
+
+/* Background, and discs of one of 64 noisy colours, so the colour-mapped types fit in 256 colours. */
+static void _make_image( uint8_t* img_ptr, uint32_t side, uint32_t n ) {
+  uint32_t state = 0x12345678;
+  for ( uint32_t y = 0; y < side; y++ ) {
+    for ( uint32_t x = 0; x < side; x++ ) {
+      uint8_t* px_ptr = &img_ptr[( (size_t)y * side + x ) * n];
+      int32_t dx = (int32_t)( x % 512 ) - 256, dy = (int32_t)( y % 512 ) - 256;
+      uint32_t c = dx * dx + dy * dy < 160 * 160 ? 1 + ( ( x / 512 + y / 512 ) * 8 + ( _xorshift( &state ) & 7 ) ) % 63 : 0;
+      px_ptr[0]  = (uint8_t)( c * 4 );
+      if ( n < 3 ) { continue; }
+      px_ptr[1] = (uint8_t)( c * 37 );
+      px_ptr[2] = (uint8_t)( 0x77 + c * 11 );
+      if ( 4 == n ) { px_ptr[3] = 0xFF; }
+    }
+  }
+}
+
+/* RETURNS the best time of several reads of the file, checking each against ref_ptr. */
+static double _read( const uint8_t* file_ptr, size_t sz, unsigned int flags, bool separate_swap, const uint8_t* ref_ptr, size_t img_sz, bool* ok_ptr ) {
+  double best_s = 1e9;
+  for ( int rep = 0; rep < N_REPEATS && *ok_ptr; rep++ ) {
+    unsigned int w = 0, h = 0, n = 0;
+    double t         = _time_s();
+    uint8_t* img_ptr = apg_tga_read_mem( file_ptr, sz, &w, &h, &n, flags );
+    if ( img_ptr && separate_swap ) { apg_tga_bgr_to_rgb( img_ptr, w, h, n ); }
+    double s = _time_s() - t;
+    best_s   = s < best_s ? s : best_s;
+    *ok_ptr  = img_ptr && 0 == memcmp( img_ptr, ref_ptr, img_sz );
+    free( img_ptr );
+  }
+  return best_s;
+}
+
+int main( int argc, char** argv ) {
+  uint32_t side = argc > 1 ? (uint32_t)atoi( argv[1] ) : 4096;
+  const struct {
+    const char* name;
+    unsigned int type, n;
+  } types[] = { { "true colour", APG_TGA_TYPE_TRUE_COLOUR, 3 }, { "RLE true colour", APG_TGA_TYPE_RLE_TRUE_COLOUR, 3 },
+    { "true colour BGRA", APG_TGA_TYPE_TRUE_COLOUR, 4 }, { "RLE BGRA", APG_TGA_TYPE_RLE_TRUE_COLOUR, 4 }, { "mapped", APG_TGA_TYPE_MAPPED, 3 },
+    { "RLE mapped", APG_TGA_TYPE_RLE_MAPPED, 3 }, { "grey", APG_TGA_TYPE_GREY, 1 }, { "RLE grey", APG_TGA_TYPE_RLE_GREY, 1 } };
+  bool ok = side >= 512 && side <= 0xFFFF;
+  printf( "%ux%u\n%-18s %10s %9s %9s\n", side, side, "type", "MB", "write ms", "read MP/s" );
+  for ( size_t i = 0; i < sizeof( types ) / sizeof( types[0] ) && ok; i++ ) {
+    size_t img_sz    = (size_t)side * side * types[i].n, sz = 0;
+    uint8_t* img_ptr = malloc( img_sz );
+    uint8_t* rgb_ptr = malloc( img_sz );
+    if ( !img_ptr || !rgb_ptr ) { return 1; }
+    _make_image( img_ptr, side, types[i].n );
+    double t          = _time_s();
+    uint8_t* file_ptr = apg_tga_write_mem( img_ptr, side, side, types[i].n, types[i].type, &sz );
+    double write_s    = _time_s() - t;
+    if ( !file_ptr ) {
+      fprintf( stderr, "ERROR: could not write %s\n", types[i].name );
+      return 1;
+    }
+    double s = _read( file_ptr, sz, 0, false, img_ptr, img_sz, &ok );
+    printf( "%-18s %10.2f %9.1f %9.1f %s\n", types[i].name, sz / ( 1024.0 * 1024.0 ), write_s * 1000.0, (double)side * side / s * 1e-6, ok ? "" : "DIFFERENT" );
+    if ( types[i].n >= 3 && ok ) {
+      /* The written image has its origin at the top, so APG_TGA_FLIP gives rows bottom-up. */
+      size_t row_sz = (size_t)side * types[i].n;
+      for ( uint32_t y = 0; y < side; y++ ) { memcpy( &rgb_ptr[( side - 1 - y ) * row_sz], &img_ptr[y * row_sz], row_sz ); }
+      apg_tga_bgr_to_rgb( rgb_ptr, side, side, types[i].n );
+      double fused_s = _read( file_ptr, sz, APG_TGA_RGB | APG_TGA_FLIP, false, rgb_ptr, img_sz, &ok );
+      double sep_s   = _read( file_ptr, sz, APG_TGA_FLIP, true, rgb_ptr, img_sz, &ok );
+      printf( "  RGB + flip: fused %.1f MP/s, then apg_tga_bgr_to_rgb() %.1f MP/s: %.2fx %s\n", (double)side * side / fused_s * 1e-6,
+        (double)side * side / sep_s * 1e-6, sep_s / fused_s, ok ? "" : "DIFFERENT" );
+    }
+    free( file_ptr );
+    free( rgb_ptr );
+    free( img_ptr );
+  }
+  return ok ? 0 : 1;
+}
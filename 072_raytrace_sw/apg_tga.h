@@ -1,6 +1,6 @@
 /*==============================================================
 Single-Header TGA image file reader/writer
-Language: C89
+Language: C89 header, C99 implementation.
 Author:   Anton Gerdelan - @capnramses
 Contact:  <antonofnote@gmail.com>
 Website:  https://github.com/capnramses/apg - antongerdelan.net/
@@ -10,38 +10,81 @@ Instructions:
 1. Include this header in one, and only one, source file.
 2. #define APG_TGA_IMPLEMENTATION above #include "apg_tga.h"
 3.
-int w,h,n;
+unsigned int w,h,n;
 uint8_t* img_ptr = apg_tga_read_file("my_file.tga", &w, &h, &n, 0);
 
 // ... use the BGR or BGRA (when n == 4) image memory here ...
 
 free( img_ptr );
 
+Pass APG_TGA_RGB in the flags to get RGB or RGBA instead, and APG_TGA_FLIP to flip the rows. Both are done as each row is copied out of
+the file, 5 or 4 pixels at a time with SSE2, so there is no second pass over the image as with apg_tga_bgr_to_rgb().
+#define APG_TGA_NO_SIMD to use plain C, which gives the same results.
+Colour-mapped images are read as the BGR[A] colours from their map. Greyscale images are read with n == 1.
+
+To write run-length encoded, or with a colour map, give an image type:
+apg_tga_write_file_type("my_file.tga", bgr_img_ptr, w, h, n, APG_TGA_TYPE_RLE_TRUE_COLOUR);
+or apg_tga_write_mem() to get the file in memory.
+
+Define APG_TGA_DEBUG_OUTPUT to get extra information printed to stdout.
+
 Limitations:
-* Only reads/writes true colour uncompressed BGR and BGRA images.
+* Reads and writes 8-bit greyscale, and 24 and 32-bit BGR and BGRA, uncompressed or RLE. 15 and 16-bit colour isn't supported.
+* Reads 8 and 16-bit colour-mapped images with a 24 or 32-bit colour map, uncompressed or RLE. Writes 8-bit ones, of up to 256 colours.
+* Note - There are inconsistent vertical flip conventions between users of TGA. We do our best here.
 
 Todo:
-* fuzzing
 * could allow malloc/free override
-* could add a separate function or parameter to convert RGB<->BGR
 
 History:
-09/09/2019 - first version.
-24/09/2019 - published to apg repository.
-14/11/2019 - fixes for MSVC warnings (CPP compat)
+09/09/2019 - First version.
+24/09/2019 - Published to apg repository.
+14/11/2019 - Fixes for MSVC warnings (CPP compat)
+06/04/2020 - Tidy-up between repos. Added BGR<->RGB utility function. Bugfix: Writing. Y direction for GIMP etc. APG_TGA_DEBUG_OUTPUT option.
+19/10/2026 - Reads and writes RLE, colour-mapped, and greyscale images. APG_TGA_RGB flag, with the swap and flip in one SSE2 pass.
+             apg_tga_read_mem(), apg_tga_write_file_type(), and apg_tga_write_mem(). Header alpha bits are now only set for BGRA.
 ==============================================================*/
 
 #ifndef APG_TGA_H
 #define APG_TGA_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* returns a pointer to tightly-packed 8-bpp BGR memory, or NULL on error or unsupported TGA subtype. */
-unsigned char* apg_tga_read_file( const char* filename, int* w, int* h, int* n, int vert_flip );
-/* returns 1 on success, 0 on error */
-unsigned int apg_tga_write_file( const char* filename, unsigned char* bgr_img_ptr, int w, int h, int n );
+/* Flags for reading. 0 gives BGR[A] with the file's first row first, unless its origin is 0, which is bottom-up, so it is flipped. */
+#define APG_TGA_FLIP 1 /* Always flip the rows. As the old vert_flip parameter. */
+#define APG_TGA_RGB 2  /* RGB[A] rather than BGR[A]. */
+
+/* Image types, as stored in the file header. */
+#define APG_TGA_TYPE_MAPPED 1          /* Colour-mapped. Up to 256 colours when writing. */
+#define APG_TGA_TYPE_TRUE_COLOUR 2     /* BGR or BGRA. */
+#define APG_TGA_TYPE_GREY 3            /* 1 channel. */
+#define APG_TGA_TYPE_RLE_MAPPED 9      /* Run-length encoded versions of the above. */
+#define APG_TGA_TYPE_RLE_TRUE_COLOUR 10
+#define APG_TGA_TYPE_RLE_GREY 11
+
+/* RETURNS A pointer to tightly-packed 8-bpp BGR or BGRA memory, or NULL on error or unsupported TGA subtype. */
+unsigned char* apg_tga_read_file( const char* filename, unsigned int* w, unsigned int* h, unsigned int* n, unsigned int flags );
+/* As apg_tga_read_file() for a file already in memory. */
+unsigned char* apg_tga_read_mem( const unsigned char* data_ptr, size_t sz, unsigned int* w, unsigned int* h, unsigned int* n, unsigned int flags );
+
+/* Writes an uncompressed true colour image, or a greyscale one when n == 1.
+RETURNS 1 on success, 0 on error. */
+unsigned int apg_tga_write_file( const char* filename, unsigned char* bgr_img_ptr, unsigned int w, unsigned int h, unsigned int n );
+/* Writes with one of the APG_TGA_TYPE_ image types. Greyscale types take n == 1, others 3 or 4. Rows are written in the given order.
+RETURNS 1 on success, 0 on error, including more than 256 colours for a colour-mapped type. */
+unsigned int apg_tga_write_file_type(
+  const char* filename, const unsigned char* bgr_img_ptr, unsigned int w, unsigned int h, unsigned int n, unsigned int image_type );
+/* As apg_tga_write_file_type(), into memory.
+RETURNS A buffer holding the whole file, with its size in bytes in sz_ptr, to be released with free(), or NULL on error. */
+unsigned char* apg_tga_write_mem( const unsigned char* bgr_img_ptr, unsigned int w, unsigned int h, unsigned int n, unsigned int image_type, size_t* sz_ptr );
+
+/* Flips BGR[A] to RGB[A] or vice versa
+RETURNS 1 on success, 0 on error. */
+unsigned int apg_tga_bgr_to_rgb( unsigned char* img_ptr, unsigned int w, unsigned int h, unsigned int n );
 
 #ifdef __cplusplus
 }
@@ -53,11 +96,21 @@ End of Header
 ==============================================================*/
 
 #ifdef APG_TGA_IMPLEMENTATION
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) ) && !defined( APG_TGA_NO_SIMD )
+#define _APG_TGA_SSE2
+#include <emmintrin.h>
+#endif
+
+#define _APG_TGA_MAX_PACKET 128 /* pixels in one RLE or raw packet. */
+#define _APG_TGA_MAX_COLOURS 256
+#define _APG_TGA_HASH_SZ 1024 /* slots in the table of colours used when writing a colour map. */
+
 #pragma pack( push, 1 )
 struct tga_header_t {
   uint8_t id_length;       /* bytes in the image ID field. */
@@ -72,7 +125,26 @@ struct tga_header_t {
   uint16_t x_origin, y_origin; /* absolute coordinate of lower-left corner for displays where origin is at the lower left */
   uint16_t w, h;               /* img dims in pixels */
   uint8_t bpp;
-  uint8_t img_descriptor; /* bits 3-0 give the alpha channel depth, bits 5-8 give direction */
+  uint8_t img_descriptor;
+  /* bits 3-0 give the alpha channel depth, bits 5-8 give direction
+
+from http://www.gamers.org/dEngine/quake3/TGA.txt:
+|   17   |     1  |  Image Descriptor Byte.                                    |
+|        |        |  Bits 3-0 - number of attribute bits associated with each  |
+|        |        |             pixel.                                         |
+|        |        |  Bit 4    - reserved.  Must be set to 0.                   |
+|        |        |  Bit 5    - screen origin bit.                             | <-- important for eg GIMP
+|        |        |             0 = Origin in lower left-hand corner.          |
+|        |        |             1 = Origin in upper left-hand corner.          |
+|        |        |             Must be 0 for Truevision images.               |
+|        |        |  Bits 7-6 - Data storage interleaving flag.                |
+|        |        |             00 = non-interleaved.                          |
+|        |        |             01 = two-way (even/odd) interleaving.          |
+|        |        |             10 = four way interleaving.                    |
+|        |        |             11 = reserved.                                 |
+|        |        |  This entire byte should be set to 0.  Don't ask me.       |
+
+  */
 };
 #pragma pack( pop )
 
@@ -81,11 +153,248 @@ struct file_record_t {
   size_t sz; /* in bytes */
 };
 
-unsigned char* apg_tga_read_file( const char* filename, int* w, int* h, int* n, int vert_flip ) {
+/* Where decoded pixels go. Pixels arrive in the file's order, and rows are written top-down or flipped. */
+struct _apg_tga_decoder_t {
+  uint8_t* img_ptr;
+  const uint8_t* map_ptr; /* colour map, already in the output's channel order, n bytes an entry. NULL unless colour-mapped. */
+  uint32_t map_first, map_len;
+  uint32_t w, h, n;
+  uint32_t pixel_sz; /* bytes per pixel in the file. */
+  uint32_t x, y;     /* next pixel, in the file's order. */
+  bool flip, swap;
+};
+
+/* Copies n_pixels pixels of n == 3 or 4 bytes, swapping the first and third byte of each. src_ptr may be the same as dst_ptr. */
+static void _apg_tga_swap_copy( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n_pixels, uint32_t n ) {
+  uint32_t i = 0;
+#ifdef _APG_TGA_SSE2
+  /* Each byte moves 2 places down, 2 places up, or stays put. With 3 bytes a pixel, 16 bytes hold 5 pixels and the first byte of a
+  sixth, which is left as it was, so the next load still finds it when working in place. */
+  if ( 3 == n ) {
+    const __m128i lo = _mm_setr_epi8( -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, 0 );
+    const __m128i hi = _mm_setr_epi8( 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0 );
+    const __m128i mid = _mm_setr_epi8( 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, -1 );
+    for ( ; i + 6 <= n_pixels; i += 5 ) {
+      __m128i x = _mm_loadu_si128( (const __m128i*)&src_ptr[i * 3] );
+      x = _mm_or_si128( _mm_and_si128( x, mid ), _mm_or_si128( _mm_and_si128( _mm_srli_si128( x, 2 ), lo ), _mm_and_si128( _mm_slli_si128( x, 2 ), hi ) ) );
+      _mm_storeu_si128( (__m128i*)&dst_ptr[i * 3], x );
+    }
+  } else {
+    const __m128i lo  = _mm_set1_epi32( 0x000000FF );
+    const __m128i hi  = _mm_set1_epi32( 0x00FF0000 );
+    const __m128i mid = _mm_set1_epi32( (int)0xFF00FF00 );
+    for ( ; i + 4 <= n_pixels; i += 4 ) {
+      __m128i x = _mm_loadu_si128( (const __m128i*)&src_ptr[i * 4] );
+      x = _mm_or_si128( _mm_and_si128( x, mid ), _mm_or_si128( _mm_and_si128( _mm_srli_si128( x, 2 ), lo ), _mm_and_si128( _mm_slli_si128( x, 2 ), hi ) ) );
+      _mm_storeu_si128( (__m128i*)&dst_ptr[i * 4], x );
+    }
+  }
+#endif
+  for ( ; i < n_pixels; i++ ) {
+    const uint8_t* s_ptr = &src_ptr[i * n];
+    uint8_t* d_ptr       = &dst_ptr[i * n];
+    uint8_t b            = s_ptr[0];
+    d_ptr[0]             = s_ptr[2];
+    d_ptr[1]             = s_ptr[1];
+    d_ptr[2]             = b;
+    if ( 4 == n ) { d_ptr[3] = s_ptr[3]; }
+  }
+}
+
+/* Writes the n-byte pixel at px_ptr n_pixels times, doubling the filled span with each copy. */
+static void _apg_tga_fill( const uint8_t* px_ptr, uint8_t* dst_ptr, uint32_t n_pixels, uint32_t n ) {
+  size_t done_sz = n, total_sz = (size_t)n_pixels * n;
+  if ( 1 == n ) {
+    memset( dst_ptr, px_ptr[0], n_pixels );
+    return;
+  }
+  memcpy( dst_ptr, px_ptr, n );
+  while ( done_sz < total_sz ) {
+    size_t sz = done_sz < total_sz - done_sz ? done_sz : total_sz - done_sz;
+    memcpy( &dst_ptr[done_sz], dst_ptr, sz );
+    done_sz += sz;
+  }
+}
+
+/* Converts n_pixels pixels from the file's format into dst_ptr, which is within one row of the image.
+RETURNS false if a colour map index is outside the map. */
+static bool _apg_tga_convert( const struct _apg_tga_decoder_t* dec_ptr, const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n_pixels ) {
+  if ( dec_ptr->map_ptr ) {
+    for ( uint32_t i = 0; i < n_pixels; i++ ) {
+      uint32_t idx = 1 == dec_ptr->pixel_sz ? src_ptr[i] : (uint32_t)src_ptr[i * 2] | (uint32_t)src_ptr[i * 2 + 1] << 8;
+      idx -= dec_ptr->map_first;
+      if ( idx >= dec_ptr->map_len ) { return false; } /* also catches indices below the first entry, which wrap around. */
+      /* constant sizes, so each copy is one or two moves. */
+      if ( 3 == dec_ptr->n ) {
+        memcpy( &dst_ptr[i * 3], &dec_ptr->map_ptr[idx * 3], 3 );
+      } else {
+        memcpy( &dst_ptr[i * 4], &dec_ptr->map_ptr[idx * 4], 4 );
+      }
+    }
+  } else if ( dec_ptr->swap ) {
+    _apg_tga_swap_copy( src_ptr, dst_ptr, n_pixels, dec_ptr->n );
+  } else {
+    memcpy( dst_ptr, src_ptr, (size_t)n_pixels * dec_ptr->n );
+  }
+  return true;
+}
+
+static uint8_t* _apg_tga_dst( const struct _apg_tga_decoder_t* dec_ptr ) {
+  uint32_t row = dec_ptr->flip ? dec_ptr->h - 1 - dec_ptr->y : dec_ptr->y;
+  return &dec_ptr->img_ptr[( (size_t)row * dec_ptr->w + dec_ptr->x ) * dec_ptr->n];
+}
+
+static void _apg_tga_advance( struct _apg_tga_decoder_t* dec_ptr, uint32_t n_pixels ) {
+  dec_ptr->x += n_pixels;
+  if ( dec_ptr->x == dec_ptr->w ) {
+    dec_ptr->x = 0;
+    dec_ptr->y++;
+  }
+}
+
+/* Decodes n_pixels consecutive pixels, which may run over several rows, and no further than the end of the image. */
+static bool _apg_tga_decode_raw( struct _apg_tga_decoder_t* dec_ptr, const uint8_t* src_ptr, uint32_t n_pixels ) {
+  while ( n_pixels > 0 ) {
+    uint32_t n_row = dec_ptr->w - dec_ptr->x < n_pixels ? dec_ptr->w - dec_ptr->x : n_pixels;
+    if ( !_apg_tga_convert( dec_ptr, src_ptr, _apg_tga_dst( dec_ptr ), n_row ) ) { return false; }
+    src_ptr += (size_t)n_row * dec_ptr->pixel_sz;
+    n_pixels -= n_row;
+    _apg_tga_advance( dec_ptr, n_row );
+  }
+  return true;
+}
+
+/* Decodes one pixel repeated n_pixels times. */
+static bool _apg_tga_decode_run( struct _apg_tga_decoder_t* dec_ptr, const uint8_t* src_ptr, uint32_t n_pixels ) {
+  uint8_t px[4];
+  if ( !_apg_tga_convert( dec_ptr, src_ptr, px, 1 ) ) { return false; }
+  while ( n_pixels > 0 ) {
+    uint32_t n_row = dec_ptr->w - dec_ptr->x < n_pixels ? dec_ptr->w - dec_ptr->x : n_pixels;
+    _apg_tga_fill( px, _apg_tga_dst( dec_ptr ), n_row, dec_ptr->n );
+    n_pixels -= n_row;
+    _apg_tga_advance( dec_ptr, n_row );
+  }
+  return true;
+}
+
+unsigned char* apg_tga_read_mem( const unsigned char* data_ptr, size_t sz, unsigned int* w, unsigned int* h, unsigned int* n, unsigned int flags ) {
+  struct tga_header_t hdr;
+  struct _apg_tga_decoder_t dec;
+  uint8_t* map_ptr = NULL;
+  size_t colour_map_offset = 0, img_data_offset = 0, map_entry_sz = 0;
+  uint32_t base_type = 0;
+  bool rle = false, ok = true;
+
+  if ( !data_ptr || !w || !h || !n || sz < sizeof( struct tga_header_t ) ) { return NULL; }
+  memcpy( &hdr, data_ptr, sizeof( struct tga_header_t ) );
+#ifdef APG_TGA_DEBUG_OUTPUT
+  printf( " |-id_length: %u\n", hdr.id_length );
+  printf( " |-colour_map_type: %u\n", hdr.colour_map_type );
+  printf( " |-image_type: %u\n", hdr.image_type );
+  printf( " |-colour_map_first_entry_idx: %u\n", hdr.colour_map_first_entry_idx );
+  printf( " |-colour_map_length: %u\n", hdr.colour_map_length );
+  printf( " |-colour_map_bpp: %u\n", hdr.colour_map_bpp );
+  printf( " |-x_origin: %u\n", hdr.x_origin );
+  printf( " |-y_origin: %u\n", hdr.y_origin );
+  printf( " |-w: %u\n", hdr.w );
+  printf( " |-h: %u\n", hdr.h );
+  printf( " |-bpp: %u\n", hdr.bpp );
+  printf( " |-img_descriptor: %u\n", hdr.img_descriptor );
+#endif
+  memset( &dec, 0, sizeof( struct _apg_tga_decoder_t ) );
+  rle       = hdr.image_type >= APG_TGA_TYPE_RLE_MAPPED;
+  base_type = rle ? hdr.image_type - 8u : hdr.image_type;
+  if ( base_type < APG_TGA_TYPE_MAPPED || base_type > APG_TGA_TYPE_GREY || hdr.image_type > APG_TGA_TYPE_RLE_GREY ) { return NULL; }
+  if ( 0 == hdr.w || 0 == hdr.h || hdr.bpp % 8 > 0 ) { return NULL; }
+  colour_map_offset = sizeof( struct tga_header_t ) + hdr.id_length;
+  img_data_offset   = colour_map_offset;
+  map_entry_sz      = ( hdr.colour_map_bpp + 7u ) / 8u;
+  if ( hdr.colour_map_bpp > 0 && hdr.colour_map_length > 0 ) { img_data_offset += hdr.colour_map_length * map_entry_sz; }
+  if ( img_data_offset > sz ) { return NULL; }
+
+  dec.w        = hdr.w;
+  dec.h        = hdr.h;
+  dec.pixel_sz = hdr.bpp / 8u;
+  if ( APG_TGA_TYPE_MAPPED == base_type ) {
+    if ( 1 != hdr.colour_map_type || ( 8 != hdr.bpp && 16 != hdr.bpp ) || ( 24 != hdr.colour_map_bpp && 32 != hdr.colour_map_bpp ) ||
+         0 == hdr.colour_map_length ) {
+      return NULL;
+    }
+    dec.n = (uint32_t)map_entry_sz;
+  } else if ( APG_TGA_TYPE_TRUE_COLOUR == base_type ) {
+    if ( 24 != hdr.bpp && 32 != hdr.bpp ) { return NULL; }
+    dec.n = dec.pixel_sz;
+  } else {
+    if ( 8 != hdr.bpp ) { return NULL; }
+    dec.n = 1;
+  }
+  dec.swap = ( flags & APG_TGA_RGB ) && dec.n >= 3;
+  /* vertical flip so 0,0 is bottom-left */
+  dec.flip = 0 == hdr.y_origin || ( flags & APG_TGA_FLIP );
+  if ( !rle && (size_t)dec.w * dec.h * dec.pixel_sz > sz - img_data_offset ) { return NULL; }
+  /* a packet covers at most 128 pixels, so a file too short to cover the image is rejected before its memory is allocated. */
+  if ( rle && (size_t)dec.w * dec.h > ( sz - img_data_offset ) / ( 1 + dec.pixel_sz ) * _APG_TGA_MAX_PACKET ) { return NULL; }
+
+  if ( APG_TGA_TYPE_MAPPED == base_type ) {
+    map_ptr = (uint8_t*)malloc( hdr.colour_map_length * map_entry_sz );
+    if ( !map_ptr ) { return NULL; }
+    if ( dec.swap ) {
+      _apg_tga_swap_copy( &data_ptr[colour_map_offset], map_ptr, hdr.colour_map_length, dec.n );
+    } else {
+      memcpy( map_ptr, &data_ptr[colour_map_offset], hdr.colour_map_length * map_entry_sz );
+    }
+    dec.map_ptr   = map_ptr;
+    dec.map_first = hdr.colour_map_first_entry_idx;
+    dec.map_len   = hdr.colour_map_length;
+    dec.swap      = false;
+  }
+  dec.img_ptr = (uint8_t*)malloc( (size_t)dec.w * dec.h * dec.n );
+  if ( !dec.img_ptr ) {
+    free( map_ptr );
+    return NULL;
+  }
+
+  if ( !rle ) {
+    ok = _apg_tga_decode_raw( &dec, &data_ptr[img_data_offset], dec.w * dec.h );
+  } else {
+    /* Each packet is a byte, with the top bit set for a run of one pixel repeated, then 1 to 128 pixels. Packets may cross rows. */
+    const uint8_t* src_ptr = &data_ptr[img_data_offset];
+    const uint8_t* end_ptr = &data_ptr[sz];
+    while ( ok && dec.y < dec.h ) {
+      uint32_t n_left = ( dec.h - dec.y ) * dec.w - dec.x, n_pixels = 0;
+      bool run        = false;
+      size_t packet_sz = 0;
+      if ( src_ptr >= end_ptr ) {
+        ok = false;
+        break;
+      }
+      run       = *src_ptr & 0x80;
+      n_pixels  = ( *src_ptr & 0x7F ) + 1u;
+      packet_sz = ( run ? 1u : n_pixels ) * dec.pixel_sz;
+      src_ptr++;
+      if ( (size_t)( end_ptr - src_ptr ) < packet_sz ) {
+        ok = false;
+        break;
+      }
+      n_pixels = n_pixels < n_left ? n_pixels : n_left;
+      ok       = run ? _apg_tga_decode_run( &dec, src_ptr, n_pixels ) : _apg_tga_decode_raw( &dec, src_ptr, n_pixels );
+      src_ptr += packet_sz;
+    }
+  }
+  free( map_ptr );
+  if ( !ok ) {
+    free( dec.img_ptr );
+    return NULL;
+  }
+  *w = dec.w;
+  *h = dec.h;
+  *n = dec.n;
+  return dec.img_ptr;
+}
+
+unsigned char* apg_tga_read_file( const char* filename, unsigned int* w, unsigned int* h, unsigned int* n, unsigned int flags ) {
   struct file_record_t record;
-  uint8_t* img_ptr     = NULL;
-  size_t img_id_offset = 0, colour_map_offset = 0, img_data_offset = 0, img_data_sz = 0;
-  int vflip = 0;
+  uint8_t* img_ptr = NULL;
 
   if ( !filename || !w || !h || !n ) { return NULL; }
   {
@@ -93,105 +402,187 @@ unsigned char* apg_tga_read_file( const char* filename, int* w, int* h, int* n,
     if ( !fptr ) { return NULL; }
     fseek( fptr, 0L, SEEK_END );
     record.sz   = (size_t)ftell( fptr );
-    record.data = (uint8_t*)malloc( record.sz );
+    record.data = (uint8_t*)malloc( record.sz ? record.sz : 1 );
     if ( !record.data ) {
       fclose( fptr );
       return NULL;
     }
     rewind( fptr );
-    size_t nr = fread( record.data, record.sz, 1, fptr );
+    size_t nr = record.sz ? fread( record.data, record.sz, 1, fptr ) : 0;
     fclose( fptr );
-    if ( nr != 1 ) { return NULL; }
-  }
-  {
-    struct tga_header_t* hdr_ptr;
-
-    if ( record.sz < sizeof( struct tga_header_t ) ) {
+    if ( nr != 1 ) {
       free( record.data );
       return NULL;
     }
-    hdr_ptr           = (struct tga_header_t*)record.data;
-    *w                = hdr_ptr->w;
-    *h                = hdr_ptr->h;
-    *n                = 32 == hdr_ptr->bpp ? 4 : 3;
-    img_id_offset     = sizeof( struct tga_header_t );
-    colour_map_offset = img_id_offset + hdr_ptr->id_length;
-    img_data_offset   = colour_map_offset;
-    if ( hdr_ptr->colour_map_bpp % 8 > 0 || hdr_ptr->bpp % 8 > 0 || hdr_ptr->bpp == 0 ) {
-      free( record.data );
-      return NULL;
+  }
+#ifdef APG_TGA_DEBUG_OUTPUT
+  printf( "TGA hdr for `%s`\n", filename );
+#endif
+  img_ptr = apg_tga_read_mem( record.data, record.sz, w, h, n, flags );
+  free( record.data );
+  return img_ptr;
+}
+
+static bool _apg_tga_same( const uint8_t* a_ptr, const uint8_t* b_ptr, uint32_t pixel_sz ) {
+  switch ( pixel_sz ) {
+  case 1: return a_ptr[0] == b_ptr[0];
+  case 3: return a_ptr[0] == b_ptr[0] && a_ptr[1] == b_ptr[1] && a_ptr[2] == b_ptr[2];
+  default: return 0 == memcmp( a_ptr, b_ptr, 4 );
+  }
+}
+
+/* Encodes one row into packets, which don't cross rows, as some readers expect.
+RETURNS the number of bytes written, at most w * ( pixel_sz + 1 ), as every packet holds at least one pixel. */
+static size_t _apg_tga_encode_row( const uint8_t* src_ptr, uint32_t w, uint32_t pixel_sz, uint8_t* dst_ptr ) {
+  uint8_t* start_ptr = dst_ptr;
+  uint32_t x         = 0;
+  while ( x < w ) {
+    uint32_t count = 1;
+    while ( x + count < w && count < _APG_TGA_MAX_PACKET && _apg_tga_same( &src_ptr[( x + count ) * pixel_sz], &src_ptr[x * pixel_sz], pixel_sz ) ) { count++; }
+    if ( count > 1 ) {
+      *dst_ptr++ = ( uint8_t )( 0x80 | ( count - 1 ) );
+      memcpy( dst_ptr, &src_ptr[x * pixel_sz], pixel_sz );
+      dst_ptr += pixel_sz;
+      x += count;
+      continue;
     }
-    /* only supporting RGB right now */
-    if ( hdr_ptr->colour_map_bpp > 0 && hdr_ptr->colour_map_length > 0 ) {
-      img_data_offset = img_data_offset + ( hdr_ptr->colour_map_length * hdr_ptr->colour_map_bpp ) / 8;
+    /* A raw packet stops where the next two pixels are the same, so they can start a run. */
+    while ( x + count < w && count < _APG_TGA_MAX_PACKET &&
+            !( x + count + 1 < w && _apg_tga_same( &src_ptr[( x + count ) * pixel_sz], &src_ptr[( x + count + 1 ) * pixel_sz], pixel_sz ) ) ) {
+      count++;
     }
-    /* check if file too small for data */
-    img_data_sz = hdr_ptr->w * hdr_ptr->h * *n;
-    if ( img_data_sz + img_data_offset > record.sz ) {
-      free( record.data );
-      return NULL;
+    *dst_ptr++ = ( uint8_t )( count - 1 );
+    memcpy( dst_ptr, &src_ptr[x * pixel_sz], (size_t)count * pixel_sz );
+    dst_ptr += (size_t)count * pixel_sz;
+    x += count;
+  }
+  return (size_t)( dst_ptr - start_ptr );
+}
+
+/* Finds the distinct colours of an image, writing an 8-bit index per pixel to indices_ptr and each colour to map_ptr.
+RETURNS the number of colours, or 0 if there are more than 256. */
+static uint32_t _apg_tga_map_colours( const uint8_t* img_ptr, size_t n_pixels, uint32_t n, uint8_t* indices_ptr, uint8_t* map_ptr ) {
+  uint32_t keys[_APG_TGA_HASH_SZ];
+  uint8_t slots[_APG_TGA_HASH_SZ];
+  bool used[_APG_TGA_HASH_SZ];
+  uint32_t n_colours = 0, prev_colour = 0;
+  uint8_t prev_idx   = 0;
+  memset( used, 0, sizeof( used ) );
+  for ( size_t i = 0; i < n_pixels; i++ ) {
+    uint32_t colour = 0, slot = 0;
+    memcpy( &colour, &img_ptr[i * n], n );
+    if ( i > 0 && colour == prev_colour ) {
+      indices_ptr[i] = prev_idx;
+      continue;
     }
-    /* only supports truecolour uncompressed */
-    if ( 2 != hdr_ptr->image_type ) {
-      free( record.data );
-      return NULL;
+    slot = ( colour * 2654435761u ) >> 22;
+    while ( used[slot] && keys[slot] != colour ) { slot = ( slot + 1 ) & ( _APG_TGA_HASH_SZ - 1 ); }
+    if ( !used[slot] ) {
+      if ( n_colours == _APG_TGA_MAX_COLOURS ) { return 0; }
+      used[slot]  = true;
+      keys[slot]  = colour;
+      slots[slot] = (uint8_t)n_colours;
+      memcpy( &map_ptr[n_colours++ * n], &colour, n );
     }
-    /* vertical flip so 0,0 is top-left */
-    if ( 0 == hdr_ptr->y_origin ) { vflip = 1; }
+    indices_ptr[i] = prev_idx = slots[slot];
+    prev_colour    = colour;
   }
-  {
-    img_ptr = (uint8_t*)malloc( img_data_sz );
-    if ( !img_ptr ) {
-      free( record.data );
+  return n_colours;
+}
+
+unsigned char* apg_tga_write_mem( const unsigned char* bgr_img_ptr, unsigned int w, unsigned int h, unsigned int n, unsigned int image_type, size_t* sz_ptr ) {
+  struct tga_header_t hdr;
+  uint8_t map[_APG_TGA_MAX_COLOURS * 4];
+  const uint8_t* pixels_ptr = bgr_img_ptr;
+  uint8_t *indices_ptr = NULL, *file_ptr = NULL;
+  uint32_t n_colours = 0, pixel_sz = n, base_type = image_type & ~8u;
+  size_t bound_sz = 0, sz = 0;
+
+  if ( !bgr_img_ptr || !sz_ptr || 0 == w || 0 == h || w > 0xFFFF || h > 0xFFFF ) { return NULL; }
+  if ( image_type != base_type && image_type != base_type + 8u ) { return NULL; }
+  if ( APG_TGA_TYPE_GREY == base_type ) {
+    if ( 1 != n ) { return NULL; }
+  } else if ( APG_TGA_TYPE_MAPPED != base_type && APG_TGA_TYPE_TRUE_COLOUR != base_type ) {
+    return NULL;
+  } else if ( 3 != n && 4 != n ) {
+    return NULL;
+  }
+  if ( APG_TGA_TYPE_MAPPED == base_type ) {
+    indices_ptr = (uint8_t*)malloc( (size_t)w * h );
+    if ( !indices_ptr ) { return NULL; }
+    n_colours = _apg_tga_map_colours( bgr_img_ptr, (size_t)w * h, n, indices_ptr, map );
+    if ( 0 == n_colours ) {
+      free( indices_ptr );
       return NULL;
     }
+    pixels_ptr = indices_ptr;
+    pixel_sz   = 1;
   }
-  if ( vert_flip ) { vflip = !vflip; }
-  if ( vflip ) {
-    size_t row_stride = *w * *n;
-    int row;
-    for ( row = 0; row < *h; row++ ) {
-      uint8_t* src_ptr = record.data + img_data_offset + row * row_stride;
-      uint8_t* dst_ptr = img_ptr + ( *h - row - 1 ) * row_stride;
-      memcpy( dst_ptr, src_ptr, row_stride );
-    }
+
+  memset( &hdr, 0, sizeof( struct tga_header_t ) );
+  hdr.colour_map_type   = n_colours ? 1 : 0;
+  hdr.image_type        = (uint8_t)image_type;
+  hdr.colour_map_length = (uint16_t)n_colours;
+  hdr.colour_map_bpp    = n_colours ? ( uint8_t )( 8 * n ) : 0;
+  hdr.w                 = (uint16_t)w;
+  hdr.h                 = (uint16_t)h;
+  hdr.y_origin          = (uint16_t)h;
+  hdr.bpp               = ( uint8_t )( 8 * pixel_sz );
+  hdr.img_descriptor    = 0x20 | ( 4 == n ? 8 : 0 ); /* NOTE(Anton) if wrong, eg set to zero, then image may be upside-down.
+  bits 3-0 give the alpha channel depth, bits 5-8 give direction */
+
+  bound_sz = sizeof( struct tga_header_t ) + n_colours * n + (size_t)h * (size_t)w * ( pixel_sz + ( image_type != base_type ? 1 : 0 ) );
+  file_ptr = (uint8_t*)malloc( bound_sz );
+  if ( !file_ptr ) {
+    free( indices_ptr );
+    return NULL;
+  }
+  memcpy( file_ptr, &hdr, sizeof( struct tga_header_t ) );
+  sz = sizeof( struct tga_header_t );
+  memcpy( &file_ptr[sz], map, n_colours * n );
+  sz += n_colours * n;
+  if ( image_type == base_type ) {
+    memcpy( &file_ptr[sz], pixels_ptr, (size_t)w * h * pixel_sz );
+    sz += (size_t)w * h * pixel_sz;
   } else {
-    memcpy( img_ptr, &record.data[img_data_offset], img_data_sz );
+    for ( uint32_t y = 0; y < h; y++ ) { sz += _apg_tga_encode_row( &pixels_ptr[(size_t)y * w * pixel_sz], w, pixel_sz, &file_ptr[sz] ); }
   }
-  free( record.data );
-  return img_ptr;
+  free( indices_ptr );
+  *sz_ptr = sz;
+  return file_ptr;
 }
 
-unsigned int apg_tga_write_file( const char* filename, unsigned char* bgr_img_ptr, int w, int h, int n ) {
-  struct tga_header_t hdr;
+unsigned int apg_tga_write_file_type(
+  const char* filename, const unsigned char* bgr_img_ptr, unsigned int w, unsigned int h, unsigned int n, unsigned int image_type ) {
+  size_t sz = 0, nw = 0;
+  uint8_t* file_ptr = NULL;
+  FILE* fptr        = NULL;
 
-  if ( !filename || !bgr_img_ptr ) { return 0; }
+  if ( !filename ) { return 0; }
+  file_ptr = apg_tga_write_mem( bgr_img_ptr, w, h, n, image_type, &sz );
+  if ( !file_ptr ) { return 0; }
+  fptr = fopen( filename, "wb" );
+  if ( !fptr ) {
+    free( file_ptr );
+    return 0;
+  }
+  nw = fwrite( file_ptr, sz, 1, fptr );
+  free( file_ptr );
+  if ( 0 != fclose( fptr ) || 1 != nw ) { return 0; }
+  return 1;
+}
 
-  {
-    memset( &hdr, 0, sizeof( struct tga_header_t ) );
-    hdr.image_type = 2;
-    hdr.w          = (uint16_t)w;
-    hdr.h          = (uint16_t)h;
-    hdr.y_origin   = (uint16_t)h;
-    hdr.bpp        = (uint8_t)(8 * n);
+unsigned int apg_tga_write_file( const char* filename, unsigned char* bgr_img_ptr, unsigned int w, unsigned int h, unsigned int n ) {
+  return apg_tga_write_file_type( filename, bgr_img_ptr, w, h, n, 1 == n ? APG_TGA_TYPE_GREY : APG_TGA_TYPE_TRUE_COLOUR );
+}
+
+unsigned int apg_tga_bgr_to_rgb( unsigned char* img_ptr, unsigned int w, unsigned int h, unsigned int n ) {
+  if ( !img_ptr || !w || !h || !n ) { return 0; }
+  if ( n != 3 && n != 4 ) { return 0; }
+  for ( unsigned int y = 0; y < h; y++ ) {
+    uint8_t* row_ptr = &img_ptr[(size_t)y * w * n];
+    _apg_tga_swap_copy( row_ptr, row_ptr, w, n );
   }
-  {
-    size_t nw     = 0;
-    size_t img_sz = w * h * n;
-    FILE* fptr    = fopen( filename, "wb" );
-    if ( !fptr ) { return 0; }
-    nw = fwrite( &hdr, sizeof( struct tga_header_t ), 1, fptr );
-    if ( 1 != nw ) {
-      fclose( fptr );
-      return 0;
-    }
-    nw = fwrite( bgr_img_ptr, img_sz, 1, fptr );
-    if ( 1 != nw ) {
-      fclose( fptr );
-      return 0;
-    }
-    fclose( fptr );
-  };
   return 1;
 }
 
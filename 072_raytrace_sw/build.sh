@@ -0,0 +1,2 @@
+#!/bin/bash
+gcc -O2 -g -Wall -D_POSIX_C_SOURCE=200809L main.c bvh.c trace.c path.c apg_ply.c -lm -pthread
@@ -0,0 +1,449 @@
+#include "bvh.h"
+#include "apg.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COST_TRAVERSAL 1.0f   // cost of visiting an interior node, relative to testing one group of ISECT_WIDTH triangles.
+#define JOB_MIN_TRIS 4096     // subtrees at least this big are built as separate jobs.
+#define MAX_DEPTH ( BVH_STACK_SZ - 1 ) // traversal pushes at most one node per level, so deeper nodes are made leaves.
+#define NODE_ALIGN 64
+
+/*=================================================================================================
+BUILD
+=================================================================================================*/
+typedef struct aabb_t {
+  float min[3], max[3];
+} aabb_t;
+
+// one triangle during the build: its bounds, and its index in the input. 32 bytes, and partitioned in place as nodes are split,
+// so binning a node reads its triangles in order. centres are kept doubled, as min + max, which orders and bins them the same way.
+typedef struct build_ref_t {
+  float min[3];
+  uint32_t tri_idx;
+  float max[3];
+  uint32_t pad;
+} build_ref_t;
+
+typedef struct bin_t {
+  aabb_t box;
+  int n;
+} bin_t;
+
+typedef struct build_t {
+  build_ref_t* refs_ptr;
+  bvh_node_t* nodes_ptr; // 2 * n_tris slots. descendants of a node with n triangles fit in the 2n - 2 slots given to it.
+} build_t;
+
+typedef struct build_task_t {
+  build_t* build_ptr;
+  aabb_t box, centres;
+  uint32_t node_idx, region, first, n;
+  int depth;
+} build_task_t;
+
+static const aabb_t _empty_aabb = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+static void _grow_aabb( aabb_t* a, const aabb_t* b ) {
+  for ( int i = 0; i < 3; i++ ) {
+    a->min[i] = MIN( a->min[i], b->min[i] );
+    a->max[i] = MAX( a->max[i], b->max[i] );
+  }
+}
+
+static void _grow_aabb_point( aabb_t* a, const float* p ) {
+  for ( int i = 0; i < 3; i++ ) {
+    a->min[i] = MIN( a->min[i], p[i] );
+    a->max[i] = MAX( a->max[i], p[i] );
+  }
+}
+
+static void _grow_aabb_ref( aabb_t* a, const build_ref_t* r ) {
+  for ( int i = 0; i < 3; i++ ) {
+    a->min[i] = MIN( a->min[i], r->min[i] );
+    a->max[i] = MAX( a->max[i], r->max[i] );
+  }
+}
+
+// half the surface area, which is all the heuristic needs.
+static float _half_area( const aabb_t* a ) {
+  float dx = a->max[0] - a->min[0], dy = a->max[1] - a->min[1], dz = a->max[2] - a->min[2];
+  return dx < 0.0f ? 0.0f : dx * dy + dy * dz + dz * dx;
+}
+
+static float _node_half_area( const bvh_node_t* node_ptr ) {
+  aabb_t box;
+  memcpy( box.min, node_ptr->min, sizeof( box.min ) );
+  memcpy( box.max, node_ptr->max, sizeof( box.max ) );
+  return _half_area( &box );
+}
+
+static int _bin_of( float centre, float min, float scale, int n_bins ) { return MIN( MAX( (int)( ( centre - min ) * scale ), 0 ), n_bins - 1 ); }
+
+static int _n_groups( int n_tris ) { return ( n_tris + ISECT_WIDTH - 1 ) / ISECT_WIDTH; }
+
+static void _make_leaf( bvh_node_t* node_ptr, uint32_t first, uint32_t n ) {
+  node_ptr->left_first = first;
+  node_ptr->n_tris     = n;
+}
+
+static void _build_task( void* arg_ptr );
+
+// box and centres are the bounds of the node's triangles and of their centres, worked out by the parent's binning.
+static void _build_node( build_t* b, aabb_t box, aabb_t centres, uint32_t node_idx, uint32_t region, uint32_t first, uint32_t n, int depth ) {
+  bvh_node_t* node_ptr = &b->nodes_ptr[node_idx];
+  memcpy( node_ptr->min, box.min, sizeof( box.min ) );
+  memcpy( node_ptr->max, box.max, sizeof( box.max ) );
+  if ( n < 2 || depth >= MAX_DEPTH ) {
+    _make_leaf( node_ptr, first, n );
+    return;
+  }
+
+  // bin along every axis with some spread of centres in one pass over the triangles, then find the cheapest split between bins.
+  // small nodes get at most a bin per triangle, which finds much the same splits for less sweeping.
+  bin_t bins[3][BVH_BINS];
+  float scales[3];
+  int n_bins = (int)MIN( n, BVH_BINS );
+  for ( int axis = 0; axis < 3; axis++ ) {
+    float extent = centres.max[axis] - centres.min[axis];
+    scales[axis] = extent > 0.0f ? n_bins / extent : 0.0f;
+    for ( int i = 0; i < n_bins; i++ ) { bins[axis][i] = ( bin_t ){ .box = _empty_aabb, .n = 0 }; }
+  }
+  for ( uint32_t i = first; i < first + n; i++ ) {
+    const build_ref_t* r = &b->refs_ptr[i];
+    for ( int axis = 0; axis < 3; axis++ ) {
+      if ( 0.0f == scales[axis] ) { continue; }
+      bin_t* bin_ptr = &bins[axis][_bin_of( r->min[axis] + r->max[axis], centres.min[axis], scales[axis], n_bins )];
+      _grow_aabb_ref( &bin_ptr->box, r );
+      bin_ptr->n++;
+    }
+  }
+  float best_cost = FLT_MAX;
+  int best_axis = -1, best_split = 0;
+  for ( int axis = 0; axis < 3; axis++ ) {
+    if ( 0.0f == scales[axis] ) { continue; }
+    // sweep from the right for the area and count right of each split, then from the left
+    float right_cost[BVH_BINS];
+    aabb_t right = _empty_aabb;
+    int n_right  = 0;
+    for ( int i = n_bins - 1; i > 0; i-- ) {
+      _grow_aabb( &right, &bins[axis][i].box );
+      n_right += bins[axis][i].n;
+      right_cost[i] = _half_area( &right ) * _n_groups( n_right );
+    }
+    aabb_t left = _empty_aabb;
+    int n_left  = 0;
+    for ( int i = 0; i < n_bins - 1; i++ ) {
+      _grow_aabb( &left, &bins[axis][i].box );
+      n_left += bins[axis][i].n;
+      float cost = _half_area( &left ) * _n_groups( n_left ) + right_cost[i + 1];
+      if ( n_left > 0 && n_left < (int)n && cost < best_cost ) {
+        best_cost  = cost;
+        best_axis  = axis;
+        best_split = i;
+      }
+    }
+  }
+
+  // a leaf costs a test per group. splitting costs a traversal step, then each side's tests weighted by the chance of a ray hitting it.
+  float area       = _half_area( &box );
+  float leaf_cost  = (float)_n_groups( n );
+  float split_cost = best_axis >= 0 && area > 0.0f ? COST_TRAVERSAL + best_cost / area : FLT_MAX;
+  if ( split_cost >= leaf_cost && n <= BVH_MAX_LEAF_TRIS ) {
+    _make_leaf( node_ptr, first, n );
+    return;
+  }
+
+  // partition, and find the children's centre bounds on the way. their boxes are the merged bins on each side of the split.
+  build_task_t tasks[2];
+  uint32_t n_left = n / 2; // if every centre is in the same place, and there are too many for one leaf, split by index.
+  for ( int s = 0; s < 2; s++ ) { tasks[s].box = tasks[s].centres = _empty_aabb; }
+  if ( best_axis >= 0 ) {
+    int64_t i = first, j = (int64_t)first + n - 1;
+    while ( i <= j ) {
+      const build_ref_t* r = &b->refs_ptr[i];
+      if ( _bin_of( r->min[best_axis] + r->max[best_axis], centres.min[best_axis], scales[best_axis], n_bins ) <= best_split ) {
+        i++;
+      } else {
+        build_ref_t tmp = b->refs_ptr[i];
+        b->refs_ptr[i]  = b->refs_ptr[j];
+        b->refs_ptr[j]  = tmp;
+        j--;
+      }
+    }
+    n_left = (uint32_t)( i - first );
+    for ( int i = 0; i < n_bins; i++ ) { _grow_aabb( &tasks[i > best_split].box, &bins[best_axis][i].box ); }
+  }
+  assert( n_left > 0 && n_left < n );
+  for ( uint32_t i = first; i < first + n; i++ ) {
+    const build_ref_t* r = &b->refs_ptr[i];
+    float centre[3]      = { r->min[0] + r->max[0], r->min[1] + r->max[1], r->min[2] + r->max[2] };
+    _grow_aabb_point( &tasks[i >= first + n_left].centres, centre );
+    if ( best_axis < 0 ) { _grow_aabb_ref( &tasks[i >= first + n_left].box, r ); }
+  }
+
+  // the children take the first 2 slots of this node's region. the left child's descendants come next, then the right child's.
+  node_ptr->left_first  = region;
+  node_ptr->n_tris      = 0;
+  uint32_t right_region = region + 2 + 2 * n_left - 2;
+  tasks[0]              = ( build_task_t ){ b, tasks[0].box, tasks[0].centres, region, region + 2, first, n_left, depth + 1 };
+  tasks[1]              = ( build_task_t ){ b, tasks[1].box, tasks[1].centres, region + 1, right_region, first + n_left, n - n_left, depth + 1 };
+  if ( apg_jobs_n_threads() > 1 && n_left >= JOB_MIN_TRIS && n - n_left >= JOB_MIN_TRIS ) {
+    apg_job_counter_t done = { 0 };
+    apg_jobs_run( _build_task, &tasks[0], &done );
+    _build_task( &tasks[1] );
+    apg_jobs_wait( &done );
+  } else {
+    _build_task( &tasks[0] );
+    _build_task( &tasks[1] );
+  }
+}
+
+static void _build_task( void* arg_ptr ) {
+  build_task_t* t = (build_task_t*)arg_ptr;
+  _build_node( t->build_ptr, t->box, t->centres, t->node_idx, t->region, t->first, t->n, t->depth );
+}
+
+// copy the tree out of its sparse build regions, depth-first, with each pair of children starting on an even index.
+static bool _flatten( bvh_t* bvh_ptr, const bvh_node_t* src_ptr ) {
+  typedef struct flatten_item_t {
+    uint32_t dst, depth;
+  } flatten_item_t;
+  flatten_item_t stack[BVH_STACK_SZ * 2];
+
+  // a binary tree with every leaf non-empty has 2 * leaves - 1 nodes
+  int n_leaves = 0, sp = 0;
+  uint32_t src_stack[BVH_STACK_SZ * 2];
+  src_stack[sp++] = 0;
+  while ( sp > 0 ) {
+    const bvh_node_t* node_ptr = &src_ptr[src_stack[--sp]];
+    if ( node_ptr->n_tris ) {
+      n_leaves++;
+    } else {
+      src_stack[sp++] = node_ptr->left_first + 1;
+      src_stack[sp++] = node_ptr->left_first;
+    }
+  }
+  bvh_ptr->n_leaves      = n_leaves;
+  bvh_ptr->n_nodes       = 2 * n_leaves - 1;
+  bvh_ptr->nodes_mem_ptr = malloc( sizeof( bvh_node_t ) * ( bvh_ptr->n_nodes + 1 ) + NODE_ALIGN );
+  if ( !bvh_ptr->nodes_mem_ptr ) { return false; }
+  bvh_ptr->nodes_ptr = (bvh_node_t*)( ( (uintptr_t)bvh_ptr->nodes_mem_ptr + NODE_ALIGN - 1 ) & ~(uintptr_t)( NODE_ALIGN - 1 ) );
+
+  bvh_node_t* dst_ptr = bvh_ptr->nodes_ptr;
+  float root_area     = _node_half_area( &src_ptr[0] );
+  uint32_t next       = 2;
+  dst_ptr[0]          = src_ptr[0];
+  dst_ptr[1]          = ( bvh_node_t ){ .n_tris = 0 };
+  bvh_ptr->max_depth  = 0;
+  bvh_ptr->sah_cost   = 0.0f;
+  sp                  = 0;
+  stack[sp++]         = ( flatten_item_t ){ 0, 0 };
+  while ( sp > 0 ) {
+    flatten_item_t item  = stack[--sp];
+    bvh_node_t* node_ptr = &dst_ptr[item.dst];
+    float p_hit          = root_area > 0.0f ? _node_half_area( node_ptr ) / root_area : 1.0f;
+    bvh_ptr->max_depth   = MAX( bvh_ptr->max_depth, (int)item.depth );
+    if ( node_ptr->n_tris ) {
+      bvh_ptr->sah_cost += p_hit * _n_groups( node_ptr->n_tris );
+      continue;
+    }
+    bvh_ptr->sah_cost += p_hit * COST_TRAVERSAL;
+    uint32_t src_left    = node_ptr->left_first;
+    dst_ptr[next]        = src_ptr[src_left];
+    dst_ptr[next + 1]    = src_ptr[src_left + 1];
+    node_ptr->left_first = next;
+    // push the right child first so the left child's subtree is laid out next
+    stack[sp++] = ( flatten_item_t ){ next + 1, item.depth + 1 };
+    stack[sp++] = ( flatten_item_t ){ next, item.depth + 1 };
+    next += 2;
+  }
+  assert( (int)next == bvh_ptr->n_nodes + 1 );
+  return true;
+}
+
+bool bvh_build( bvh_t* bvh_ptr, const float* positions_ptr, int n_tris ) {
+  assert( bvh_ptr && positions_ptr );
+  *bvh_ptr = ( bvh_t ){ .n_tris = 0 };
+  if ( n_tris <= 0 ) { return false; }
+
+  build_t b             = ( build_t ){ .refs_ptr = NULL };
+  b.refs_ptr            = malloc( sizeof( build_ref_t ) * n_tris );
+  b.nodes_ptr           = malloc( sizeof( bvh_node_t ) * 2 * n_tris );
+  bool ok               = b.refs_ptr && b.nodes_ptr;
+  if ( ok ) {
+    aabb_t box = _empty_aabb, centres = _empty_aabb;
+    for ( int t = 0; t < n_tris; t++ ) {
+      aabb_t tri_box = _empty_aabb;
+      for ( int v = 0; v < 3; v++ ) { _grow_aabb_point( &tri_box, &positions_ptr[t * 9 + v * 3] ); }
+      float centre[3] = { tri_box.min[0] + tri_box.max[0], tri_box.min[1] + tri_box.max[1], tri_box.min[2] + tri_box.max[2] };
+      b.refs_ptr[t]   = ( build_ref_t ){ .tri_idx = (uint32_t)t };
+      memcpy( b.refs_ptr[t].min, tri_box.min, sizeof( tri_box.min ) );
+      memcpy( b.refs_ptr[t].max, tri_box.max, sizeof( tri_box.max ) );
+      _grow_aabb( &box, &tri_box );
+      _grow_aabb_point( &centres, centre );
+    }
+    _build_node( &b, box, centres, 0, 1, 0, n_tris, 0 );
+    ok = _flatten( bvh_ptr, b.nodes_ptr );
+  }
+  if ( ok ) {
+    for ( int i = 0; i < bvh_ptr->n_nodes + 1; i++ ) { bvh_ptr->n_groups += _n_groups( bvh_ptr->nodes_ptr[i].n_tris ); }
+    bvh_ptr->tri_groups_ptr = malloc( sizeof( isect_tris_t ) * bvh_ptr->n_groups );
+    bvh_ptr->tri_idxs_ptr   = malloc( sizeof( uint32_t ) * ISECT_WIDTH * bvh_ptr->n_groups );
+    ok                      = bvh_ptr->tri_groups_ptr && bvh_ptr->tri_idxs_ptr;
+  }
+  if ( ok ) {
+    // copy each leaf's triangles into groups of its own, and point the leaf at its first group instead of its first reference
+    uint32_t group = 0;
+    for ( int i = 0; i < bvh_ptr->n_nodes + 1; i++ ) {
+      bvh_node_t* node_ptr = &bvh_ptr->nodes_ptr[i];
+      if ( !node_ptr->n_tris ) { continue; }
+      for ( uint32_t j = 0; j < node_ptr->n_tris; j += ISECT_WIDTH ) {
+        isect_tris_t* tris_ptr = &bvh_ptr->tri_groups_ptr[group + j / ISECT_WIDTH];
+        isect_tris_clear( tris_ptr );
+        for ( int lane = 0; lane < ISECT_WIDTH; lane++ ) {
+          uint32_t* idx_ptr = &bvh_ptr->tri_idxs_ptr[( group + j / ISECT_WIDTH ) * ISECT_WIDTH + lane];
+          *idx_ptr          = UINT32_MAX;
+          if ( j + lane >= node_ptr->n_tris ) { continue; }
+          *idx_ptr       = b.refs_ptr[node_ptr->left_first + j + lane].tri_idx;
+          const float* p = &positions_ptr[(size_t)*idx_ptr * 9];
+          isect_tris_set( tris_ptr, lane, ( vec3 ){ p[0], p[1], p[2] }, ( vec3 ){ p[3], p[4], p[5] }, ( vec3 ){ p[6], p[7], p[8] } );
+        }
+      }
+      node_ptr->left_first = group;
+      group += _n_groups( node_ptr->n_tris );
+    }
+    bvh_ptr->n_tris = n_tris;
+  } else {
+    bvh_free( bvh_ptr );
+  }
+  free( b.refs_ptr );
+  free( b.nodes_ptr );
+  return ok;
+}
+
+void bvh_free( bvh_t* bvh_ptr ) {
+  if ( !bvh_ptr ) { return; }
+  free( bvh_ptr->nodes_mem_ptr );
+  free( bvh_ptr->tri_groups_ptr );
+  free( bvh_ptr->tri_idxs_ptr );
+  *bvh_ptr = ( bvh_t ){ .n_tris = 0 };
+}
+
+/*=================================================================================================
+TRAVERSAL
+=================================================================================================*/
+// slab test. returns the distance the ray enters the box, clipped to [t_min, t_max), or FLT_MAX if it misses.
+static inline float _ray_box( const bvh_node_t* node_ptr, vec3 origin, vec3 inv_dir, float t_min, float t_max ) {
+  float tx0 = ( node_ptr->min[0] - origin.x ) * inv_dir.x, tx1 = ( node_ptr->max[0] - origin.x ) * inv_dir.x;
+  float ty0 = ( node_ptr->min[1] - origin.y ) * inv_dir.y, ty1 = ( node_ptr->max[1] - origin.y ) * inv_dir.y;
+  float tz0 = ( node_ptr->min[2] - origin.z ) * inv_dir.z, tz1 = ( node_ptr->max[2] - origin.z ) * inv_dir.z;
+  float t0 = MAX( MAX( MIN( tx0, tx1 ), MIN( ty0, ty1 ) ), MAX( MIN( tz0, tz1 ), t_min ) );
+  float t1 = MIN( MIN( MAX( tx0, tx1 ), MAX( ty0, ty1 ) ), MIN( MAX( tz0, tz1 ), t_max ) );
+  return t0 <= t1 ? t0 : FLT_MAX;
+}
+
+// zero components get a huge reciprocal of the right sign, rather than infinity, so the slab test never multiplies 0 by infinity.
+static vec3 _inv_dir( vec3 dir ) {
+  const float big = 1e30f;
+  return ( vec3 ){ .x = fabsf( dir.x ) > 0.0f ? 1.0f / dir.x : copysignf( big, dir.x ),
+    .y                = fabsf( dir.y ) > 0.0f ? 1.0f / dir.y : copysignf( big, dir.y ),
+    .z                = fabsf( dir.z ) > 0.0f ? 1.0f / dir.z : copysignf( big, dir.z ) };
+}
+
+typedef struct stack_item_t {
+  uint32_t node_idx;
+  float t; // where the ray enters the node. skipped when popped if a nearer hit has been found since.
+} stack_item_t;
+
+bool bvh_intersect( const bvh_t* bvh_ptr, ray_t ray, float t_min, float t_max, bvh_hit_t* hit_ptr ) {
+  assert( bvh_ptr && hit_ptr );
+  const bvh_node_t* nodes_ptr = bvh_ptr->nodes_ptr;
+  vec3 inv_dir                = _inv_dir( ray.direction );
+  float closest               = t_max, best_u = 0.0f, best_v = 0.0f;
+  uint32_t best_tri           = UINT32_MAX;
+  stack_item_t stack[BVH_STACK_SZ];
+  int sp = 0;
+  if ( !nodes_ptr || FLT_MAX == _ray_box( &nodes_ptr[0], ray.origin, inv_dir, t_min, t_max ) ) { return false; }
+
+  uint32_t node_idx = 0;
+  for ( ;; ) {
+    const bvh_node_t* node_ptr = &nodes_ptr[node_idx];
+    if ( node_ptr->n_tris ) {
+      for ( uint32_t g = node_ptr->left_first; g < node_ptr->left_first + _n_groups( node_ptr->n_tris ); g++ ) {
+        float ts[ISECT_WIDTH], us[ISECT_WIDTH], vs[ISECT_WIDTH];
+        uint32_t mask = isect_ray_tris( &bvh_ptr->tri_groups_ptr[g], ray.origin, ray.direction, t_min, closest, ts, us, vs );
+        // lanes in order, keeping the first of equal hits, as testing the triangles one at a time would
+        for ( int lane = 0; mask; lane++, mask >>= 1 ) {
+          if ( !( mask & 1 ) || ts[lane] >= closest ) { continue; }
+          closest  = ts[lane];
+          best_u   = us[lane];
+          best_v   = vs[lane];
+          best_tri = g * ISECT_WIDTH + lane;
+        }
+      }
+    } else {
+      uint32_t near_idx = node_ptr->left_first, far_idx = near_idx + 1;
+      float t_near = _ray_box( &nodes_ptr[near_idx], ray.origin, inv_dir, t_min, closest );
+      float t_far  = _ray_box( &nodes_ptr[far_idx], ray.origin, inv_dir, t_min, closest );
+      if ( t_far < t_near ) {
+        float tmp_t    = t_near;
+        uint32_t tmp_i = near_idx;
+        t_near = t_far, near_idx = far_idx;
+        t_far = tmp_t, far_idx = tmp_i;
+      }
+      if ( t_near != FLT_MAX ) {
+        if ( t_far != FLT_MAX ) {
+          assert( sp < BVH_STACK_SZ );
+          stack[sp++] = ( stack_item_t ){ far_idx, t_far };
+        }
+        node_idx = near_idx;
+        continue;
+      }
+    }
+    // pop the next node the ray could still hit something nearer in
+    while ( sp > 0 && stack[sp - 1].t >= closest ) { sp--; }
+    if ( 0 == sp ) { break; }
+    node_idx = stack[--sp].node_idx;
+  }
+  if ( UINT32_MAX == best_tri ) { return false; }
+  *hit_ptr = ( bvh_hit_t ){ .t = closest, .u = best_u, .v = best_v, .tri_idx = bvh_ptr->tri_idxs_ptr[best_tri] };
+  return true;
+}
+
+bool bvh_occluded( const bvh_t* bvh_ptr, ray_t ray, float t_min, float t_max ) {
+  assert( bvh_ptr );
+  const bvh_node_t* nodes_ptr = bvh_ptr->nodes_ptr;
+  vec3 inv_dir                = _inv_dir( ray.direction );
+  uint32_t stack[BVH_STACK_SZ];
+  int sp = 0;
+  if ( !nodes_ptr || FLT_MAX == _ray_box( &nodes_ptr[0], ray.origin, inv_dir, t_min, t_max ) ) { return false; }
+
+  uint32_t node_idx = 0;
+  for ( ;; ) {
+    const bvh_node_t* node_ptr = &nodes_ptr[node_idx];
+    if ( node_ptr->n_tris ) {
+      for ( uint32_t g = node_ptr->left_first; g < node_ptr->left_first + _n_groups( node_ptr->n_tris ); g++ ) {
+        float ts[ISECT_WIDTH], us[ISECT_WIDTH], vs[ISECT_WIDTH];
+        if ( isect_ray_tris( &bvh_ptr->tri_groups_ptr[g], ray.origin, ray.direction, t_min, t_max, ts, us, vs ) ) { return true; }
+      }
+    } else {
+      uint32_t left_idx = node_ptr->left_first;
+      bool hit_left     = FLT_MAX != _ray_box( &nodes_ptr[left_idx], ray.origin, inv_dir, t_min, t_max );
+      bool hit_right    = FLT_MAX != _ray_box( &nodes_ptr[left_idx + 1], ray.origin, inv_dir, t_min, t_max );
+      if ( hit_left || hit_right ) {
+        if ( hit_left && hit_right ) {
+          assert( sp < BVH_STACK_SZ );
+          stack[sp++] = left_idx + 1;
+        }
+        node_idx = hit_left ? left_idx : left_idx + 1;
+        continue;
+      }
+    }
+    if ( 0 == sp ) { break; }
+    node_idx = stack[--sp];
+  }
+  return false;
+}
@@ -0,0 +1,65 @@
+/* Bounding volume hierarchy over a triangle soup, for the CPU ray tracer in 072_raytrace_sw.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  Binned surface area heuristic. Each node's triangle centroids are sorted into BVH_BINS bins along each axis, and the split between bins
+  with the lowest estimated cost is taken, or a leaf is made if splitting doesn't pay. Triangles are costed in whole groups of
+  ISECT_WIDTH, as they are tested, so leaves tend towards multiples of the group size. Subtrees with enough triangles are built as
+  apg.h jobs if apg_jobs_init() has been called, otherwise on the calling thread. The tree doesn't depend on the thread count.
+
+Layout:
+  Nodes are 32 bytes, flattened into one array. The two children of a node are always next to each other, starting at an even index, so
+  a traversal testing both children's boxes touches one 64-byte cache line. Node 1 is unused padding for this.
+  Triangles are copied into leaf order, in SoA groups of ISECT_WIDTH (see isect.h), as a vertex and two edges ready for Moller-Trumbore.
+  Each leaf starts a new group, and spare lanes at the end of a leaf are filled with NaN, which never hits.
+
+Traversal:
+  Stack-based and front-to-back: the nearer child is visited first and the farther one pushed, and anything starting beyond the
+  closest hit so far is skipped. Leaves test one ray against a whole group of triangles at once with isect_ray_tris().
+*/
+
+#pragma once
+#include "apg_maths.h"
+#include "isect.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BVH_BINS 16
+#define BVH_MAX_LEAF_TRIS 8 // leaves bigger than this are split even when the heuristic says not to.
+#define BVH_STACK_SZ 64
+
+typedef struct bvh_node_t {
+  float min[3];
+  uint32_t left_first; // leaf: first group in bvh_t.tri_groups_ptr. interior: index of the left child, the right child is left_first + 1.
+  float max[3];
+  uint32_t n_tris; // 0 for interior nodes.
+} bvh_node_t;
+
+typedef struct bvh_t {
+  bvh_node_t* nodes_ptr; // 64-byte aligned. nodes_ptr[0] is the root.
+  isect_tris_t* tri_groups_ptr; // in leaf order.
+  uint32_t* tri_idxs_ptr;       // per lane of tri_groups_ptr: the triangle's index in the input, or UINT32_MAX for a spare lane.
+  void* nodes_mem_ptr;          // the allocation nodes_ptr is aligned within.
+  int n_nodes, n_leaves, n_tris, n_groups, max_depth;
+  float sah_cost; // estimated traversal cost of the whole tree, relative to testing one group of triangles. for comparing builds.
+} bvh_t;
+
+typedef struct ray_t {
+  vec3 origin, direction; // direction doesn't have to be normalised. t is measured in its lengths.
+} ray_t;
+
+typedef struct bvh_hit_t {
+  float t, u, v; // distance along the ray, and barycentric coordinates of vertices 1 and 2.
+  uint32_t tri_idx; // index of the triangle in the input.
+} bvh_hit_t;
+
+// build over n_tris triangles in positions_ptr, 9 floats per triangle. returns false if out of memory or the input is empty.
+bool bvh_build( bvh_t* bvh_ptr, const float* positions_ptr, int n_tris );
+
+void bvh_free( bvh_t* bvh_ptr );
+
+// closest hit with t in [t_min, t_max). returns false on a miss, in which case hit_ptr is unchanged.
+bool bvh_intersect( const bvh_t* bvh_ptr, ray_t ray, float t_min, float t_max, bvh_hit_t* hit_ptr );
+
+// true if anything is hit with t in [t_min, t_max). stops at the first hit, so cheaper than bvh_intersect() for shadow rays.
+bool bvh_occluded( const bvh_t* bvh_ptr, ray_t ray, float t_min, float t_max );
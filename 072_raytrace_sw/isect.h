@@ -0,0 +1,298 @@
+/* Ray-triangle and ray-sphere intersection, one at a time and ISECT_WIDTH at a time, for 072_raytrace_sw.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Scalar versions of each test are the reference. The wide versions test:
+  isect_ray_tris()       - one ray against ISECT_WIDTH triangles.
+  isect_ray_spheres()    - one ray against ISECT_WIDTH spheres.
+  isect_packet_tri()     - a packet of ISECT_WIDTH rays against one triangle.
+  isect_packet_sphere()  - a packet of ISECT_WIDTH rays against one sphere.
+Primitives and packets are stored SoA, one lane per primitive or ray, and each wide test returns a bit mask of lanes that hit, with bit i
+for lane i, and writes per-lane results for all lanes. Results for lanes that hit match the scalar tests bit-for-bit: the wide tests do the
+same IEEE operations in the same order, including a true divide and square root rather than the approximate reciprocal instructions.
+That holds as long as the compiler doesn't contract the scalar arithmetic into fused multiply-adds, which GCC and Clang only do when
+targeting an FMA instruction set (e.g. -march=native), and not with -ffp-contract=off. With contraction, triangle results agree to within
+ISECT_EPSILON relative to the size of the scene. Sphere distances near tangency can differ by more, as the discriminant cancels, and
+grazing hits can differ.
+
+ISECT_WIDTH is 8 with AVX (compile with -mavx or -march=native), 4 with SSE2, which every x86-64 compiler enables by default, and 4 lanes
+of plain C, tested lane by lane, otherwise or if ISECT_NO_SIMD is defined.
+
+Tests are two-sided, and rays with NaN components miss. Unused lanes of a batch should be filled with NaN, which never hits; see
+isect_tris_clear() and isect_spheres_clear().
+*/
+
+#pragma once
+#include "apg_maths.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined( __AVX__ ) && !defined( ISECT_NO_SIMD )
+#define ISECT_AVX
+#include <immintrin.h>
+#define ISECT_WIDTH 8
+#elif ( defined( __SSE2__ ) || defined( _M_X64 ) ) && !defined( ISECT_NO_SIMD )
+#define ISECT_SSE2
+#include <emmintrin.h>
+#define ISECT_WIDTH 4
+#else
+#define ISECT_WIDTH 4
+#endif
+
+#define ISECT_EPSILON 1e-5f // relative tolerance between scalar and wide results when FMA contraction is on. see above.
+
+// ISECT_WIDTH triangles as a vertex and two edges each, ready for Moller-Trumbore. [axis][lane].
+typedef struct isect_tris_t {
+  float v0[3][ISECT_WIDTH], e1[3][ISECT_WIDTH], e2[3][ISECT_WIDTH];
+} isect_tris_t;
+
+typedef struct isect_spheres_t {
+  float centre[3][ISECT_WIDTH], radius[ISECT_WIDTH];
+} isect_spheres_t;
+
+// ISECT_WIDTH rays. directions should be normalised for the sphere tests.
+typedef struct isect_packet_t {
+  float origin[3][ISECT_WIDTH], direction[3][ISECT_WIDTH];
+} isect_packet_t;
+
+/*=================================================================================================
+SCALAR
+=================================================================================================*/
+// Moller-Trumbore, as ray_tri_test() in 074_slabs, taking edges e1 = v1 - v0 and e2 = v2 - v0. true for a hit with t in [t_min, t_max),
+// in which case t, u and v are written. u and v are the barycentric coordinates of vertices 1 and 2.
+static inline bool isect_ray_tri(
+  vec3 origin, vec3 dir, vec3 v0, vec3 e1, vec3 e2, float t_min, float t_max, float* t_ptr, float* u_ptr, float* v_ptr ) {
+  vec3 q        = cross_vec3( dir, e2 );
+  float det     = dot_vec3( q, e1 );
+  float det_inv = 1.0f / det;
+  if ( !( det != 0.0f ) ) { return false; } // parallel to the triangle's plane
+  vec3 s  = sub_vec3_vec3( origin, v0 );
+  float u = det_inv * dot_vec3( s, q );
+  if ( !( u >= 0.0f && u <= 1.0f ) ) { return false; }
+  vec3 r  = cross_vec3( s, e1 );
+  float v = det_inv * dot_vec3( dir, r );
+  if ( !( v >= 0.0f && u + v <= 1.0f ) ) { return false; }
+  float t = det_inv * dot_vec3( e2, r );
+  if ( !( t >= t_min && t < t_max ) ) { return false; }
+  *t_ptr = t;
+  *u_ptr = u;
+  *v_ptr = v;
+  return true;
+}
+
+// as ray_sphere_test() in 074_slabs, for a normalised direction. true if the ray's line hits the sphere, in which case the distances it enters
+// and leaves are written. either can be negative.
+static inline bool isect_ray_sphere( vec3 origin, vec3 dir, vec3 centre, float radius, float* t_near_ptr, float* t_far_ptr ) {
+  vec3 omc   = sub_vec3_vec3( origin, centre );
+  float b    = dot_vec3( dir, omc );
+  float c    = dot_vec3( omc, omc ) - radius * radius;
+  float disc = b * b - c;
+  if ( !( disc >= 0.0f ) ) { return false; }
+  float sqrt_part = sqrtf( disc );
+  *t_near_ptr     = -b - sqrt_part;
+  *t_far_ptr      = -b + sqrt_part;
+  return true;
+}
+
+/*=================================================================================================
+BATCH SETUP
+=================================================================================================*/
+static inline void isect_tris_clear( isect_tris_t* tris_ptr ) {
+  float* f_ptr = &tris_ptr->v0[0][0];
+  for ( int i = 0; i < (int)( sizeof( isect_tris_t ) / sizeof( float ) ); i++ ) { f_ptr[i] = NAN; }
+}
+
+static inline void isect_tris_set( isect_tris_t* tris_ptr, int lane, vec3 v0, vec3 v1, vec3 v2 ) {
+  vec3 e1 = sub_vec3_vec3( v1, v0 ), e2 = sub_vec3_vec3( v2, v0 );
+  for ( int a = 0; a < 3; a++ ) {
+    tris_ptr->v0[a][lane] = ( &v0.x )[a];
+    tris_ptr->e1[a][lane] = ( &e1.x )[a];
+    tris_ptr->e2[a][lane] = ( &e2.x )[a];
+  }
+}
+
+static inline void isect_spheres_clear( isect_spheres_t* spheres_ptr ) {
+  float* f_ptr = &spheres_ptr->centre[0][0];
+  for ( int i = 0; i < (int)( sizeof( isect_spheres_t ) / sizeof( float ) ); i++ ) { f_ptr[i] = NAN; }
+}
+
+static inline void isect_spheres_set( isect_spheres_t* spheres_ptr, int lane, vec3 centre, float radius ) {
+  for ( int a = 0; a < 3; a++ ) { spheres_ptr->centre[a][lane] = ( &centre.x )[a]; }
+  spheres_ptr->radius[lane] = radius;
+}
+
+static inline void isect_packet_set( isect_packet_t* packet_ptr, int lane, vec3 origin, vec3 dir ) {
+  for ( int a = 0; a < 3; a++ ) {
+    packet_ptr->origin[a][lane]    = ( &origin.x )[a];
+    packet_ptr->direction[a][lane] = ( &dir.x )[a];
+  }
+}
+
+/*=================================================================================================
+WIDE
+=================================================================================================*/
+#if defined( ISECT_AVX ) || defined( ISECT_SSE2 )
+
+#ifdef ISECT_AVX
+typedef __m256 isect_vf_t;
+static inline isect_vf_t _isect_load( const float* p ) { return _mm256_loadu_ps( p ); }
+static inline void _isect_store( float* p, isect_vf_t a ) { _mm256_storeu_ps( p, a ); }
+static inline isect_vf_t _isect_set1( float f ) { return _mm256_set1_ps( f ); }
+static inline isect_vf_t _isect_add( isect_vf_t a, isect_vf_t b ) { return _mm256_add_ps( a, b ); }
+static inline isect_vf_t _isect_sub( isect_vf_t a, isect_vf_t b ) { return _mm256_sub_ps( a, b ); }
+static inline isect_vf_t _isect_mul( isect_vf_t a, isect_vf_t b ) { return _mm256_mul_ps( a, b ); }
+static inline isect_vf_t _isect_div( isect_vf_t a, isect_vf_t b ) { return _mm256_div_ps( a, b ); }
+static inline isect_vf_t _isect_sqrt( isect_vf_t a ) { return _mm256_sqrt_ps( a ); }
+static inline isect_vf_t _isect_and( isect_vf_t a, isect_vf_t b ) { return _mm256_and_ps( a, b ); }
+static inline isect_vf_t _isect_xor( isect_vf_t a, isect_vf_t b ) { return _mm256_xor_ps( a, b ); }
+static inline isect_vf_t _isect_ge( isect_vf_t a, isect_vf_t b ) { return _mm256_cmp_ps( a, b, _CMP_GE_OQ ); }
+static inline isect_vf_t _isect_le( isect_vf_t a, isect_vf_t b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ); }
+static inline isect_vf_t _isect_lt( isect_vf_t a, isect_vf_t b ) { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+static inline isect_vf_t _isect_neq( isect_vf_t a, isect_vf_t b ) { return _mm256_cmp_ps( a, b, _CMP_NEQ_UQ ); } // true for NaN, like !=
+static inline uint32_t _isect_mask( isect_vf_t a ) { return (uint32_t)_mm256_movemask_ps( a ); }
+#else
+typedef __m128 isect_vf_t;
+static inline isect_vf_t _isect_load( const float* p ) { return _mm_loadu_ps( p ); }
+static inline void _isect_store( float* p, isect_vf_t a ) { _mm_storeu_ps( p, a ); }
+static inline isect_vf_t _isect_set1( float f ) { return _mm_set1_ps( f ); }
+static inline isect_vf_t _isect_add( isect_vf_t a, isect_vf_t b ) { return _mm_add_ps( a, b ); }
+static inline isect_vf_t _isect_sub( isect_vf_t a, isect_vf_t b ) { return _mm_sub_ps( a, b ); }
+static inline isect_vf_t _isect_mul( isect_vf_t a, isect_vf_t b ) { return _mm_mul_ps( a, b ); }
+static inline isect_vf_t _isect_div( isect_vf_t a, isect_vf_t b ) { return _mm_div_ps( a, b ); }
+static inline isect_vf_t _isect_sqrt( isect_vf_t a ) { return _mm_sqrt_ps( a ); }
+static inline isect_vf_t _isect_and( isect_vf_t a, isect_vf_t b ) { return _mm_and_ps( a, b ); }
+static inline isect_vf_t _isect_xor( isect_vf_t a, isect_vf_t b ) { return _mm_xor_ps( a, b ); }
+static inline isect_vf_t _isect_ge( isect_vf_t a, isect_vf_t b ) { return _mm_cmpge_ps( a, b ); }
+static inline isect_vf_t _isect_le( isect_vf_t a, isect_vf_t b ) { return _mm_cmple_ps( a, b ); }
+static inline isect_vf_t _isect_lt( isect_vf_t a, isect_vf_t b ) { return _mm_cmplt_ps( a, b ); }
+static inline isect_vf_t _isect_neq( isect_vf_t a, isect_vf_t b ) { return _mm_cmpneq_ps( a, b ); } // true for NaN, like !=
+static inline uint32_t _isect_mask( isect_vf_t a ) { return (uint32_t)_mm_movemask_ps( a ); }
+#endif
+
+typedef struct _isect_vec3_t {
+  isect_vf_t x, y, z;
+} _isect_vec3_t;
+
+static inline _isect_vec3_t _isect_splat3( vec3 v ) { return ( _isect_vec3_t ){ _isect_set1( v.x ), _isect_set1( v.y ), _isect_set1( v.z ) }; }
+static inline _isect_vec3_t _isect_load3( const float ( *p )[ISECT_WIDTH] ) {
+  return ( _isect_vec3_t ){ _isect_load( p[0] ), _isect_load( p[1] ), _isect_load( p[2] ) };
+}
+
+static inline _isect_vec3_t _isect_sub3( _isect_vec3_t a, _isect_vec3_t b ) {
+  return ( _isect_vec3_t ){ _isect_sub( a.x, b.x ), _isect_sub( a.y, b.y ), _isect_sub( a.z, b.z ) };
+}
+
+// same order of operations as dot_vec3() and cross_vec3(), so results round the same way.
+static inline isect_vf_t _isect_dot3( _isect_vec3_t a, _isect_vec3_t b ) {
+  return _isect_add( _isect_add( _isect_mul( a.x, b.x ), _isect_mul( a.y, b.y ) ), _isect_mul( a.z, b.z ) );
+}
+
+static inline _isect_vec3_t _isect_cross3( _isect_vec3_t a, _isect_vec3_t b ) {
+  return ( _isect_vec3_t ){ _isect_sub( _isect_mul( a.y, b.z ), _isect_mul( a.z, b.y ) ), _isect_sub( _isect_mul( a.z, b.x ), _isect_mul( a.x, b.z ) ),
+    _isect_sub( _isect_mul( a.x, b.y ), _isect_mul( a.y, b.x ) ) };
+}
+
+// the body of isect_ray_tri() for a lane of rays against a lane of triangles. returns the hit mask.
+static inline uint32_t _isect_tri_wide( _isect_vec3_t origin, _isect_vec3_t dir, _isect_vec3_t v0, _isect_vec3_t e1, _isect_vec3_t e2, isect_vf_t t_min,
+  isect_vf_t t_max, float* t_ptr, float* u_ptr, float* v_ptr ) {
+  const isect_vf_t zero = _isect_set1( 0.0f ), one = _isect_set1( 1.0f );
+  _isect_vec3_t q       = _isect_cross3( dir, e2 );
+  isect_vf_t det        = _isect_dot3( q, e1 );
+  isect_vf_t det_inv    = _isect_div( one, det );
+  _isect_vec3_t s       = _isect_sub3( origin, v0 );
+  isect_vf_t u          = _isect_mul( det_inv, _isect_dot3( s, q ) );
+  _isect_vec3_t r       = _isect_cross3( s, e1 );
+  isect_vf_t v          = _isect_mul( det_inv, _isect_dot3( dir, r ) );
+  isect_vf_t t          = _isect_mul( det_inv, _isect_dot3( e2, r ) );
+  isect_vf_t hit        = _isect_and( _isect_neq( det, zero ), _isect_and( _isect_ge( u, zero ), _isect_le( u, one ) ) );
+  hit                   = _isect_and( hit, _isect_and( _isect_ge( v, zero ), _isect_le( _isect_add( u, v ), one ) ) );
+  hit                   = _isect_and( hit, _isect_and( _isect_ge( t, t_min ), _isect_lt( t, t_max ) ) );
+  _isect_store( t_ptr, t );
+  _isect_store( u_ptr, u );
+  _isect_store( v_ptr, v );
+  return _isect_mask( hit );
+}
+
+static inline uint32_t _isect_sphere_wide(
+  _isect_vec3_t origin, _isect_vec3_t dir, _isect_vec3_t centre, isect_vf_t radius, float* t_near_ptr, float* t_far_ptr ) {
+  _isect_vec3_t omc    = _isect_sub3( origin, centre );
+  isect_vf_t b         = _isect_dot3( dir, omc );
+  isect_vf_t c         = _isect_sub( _isect_dot3( omc, omc ), _isect_mul( radius, radius ) );
+  isect_vf_t disc      = _isect_sub( _isect_mul( b, b ), c );
+  isect_vf_t hit       = _isect_ge( disc, _isect_set1( 0.0f ) );
+  isect_vf_t sqrt_part = _isect_sqrt( disc );
+  isect_vf_t neg_b     = _isect_xor( b, _isect_set1( -0.0f ) );
+  _isect_store( t_near_ptr, _isect_sub( neg_b, sqrt_part ) );
+  _isect_store( t_far_ptr, _isect_add( neg_b, sqrt_part ) );
+  return _isect_mask( hit );
+}
+
+#endif /* ISECT_AVX || ISECT_SSE2 */
+
+// one ray against ISECT_WIDTH triangles. lane i of t, u and v is only meaningful if bit i of the result is set.
+static inline uint32_t isect_ray_tris(
+  const isect_tris_t* tris_ptr, vec3 origin, vec3 dir, float t_min, float t_max, float* t_ptr, float* u_ptr, float* v_ptr ) {
+#if defined( ISECT_AVX ) || defined( ISECT_SSE2 )
+  _isect_vec3_t v0 = _isect_load3( tris_ptr->v0 ), e1 = _isect_load3( tris_ptr->e1 ), e2 = _isect_load3( tris_ptr->e2 );
+  return _isect_tri_wide( _isect_splat3( origin ), _isect_splat3( dir ), v0, e1, e2, _isect_set1( t_min ), _isect_set1( t_max ), t_ptr, u_ptr, v_ptr );
+#else
+  uint32_t mask = 0;
+  for ( int i = 0; i < ISECT_WIDTH; i++ ) {
+    vec3 v0 = ( vec3 ){ tris_ptr->v0[0][i], tris_ptr->v0[1][i], tris_ptr->v0[2][i] };
+    vec3 e1 = ( vec3 ){ tris_ptr->e1[0][i], tris_ptr->e1[1][i], tris_ptr->e1[2][i] };
+    vec3 e2 = ( vec3 ){ tris_ptr->e2[0][i], tris_ptr->e2[1][i], tris_ptr->e2[2][i] };
+    if ( isect_ray_tri( origin, dir, v0, e1, e2, t_min, t_max, &t_ptr[i], &u_ptr[i], &v_ptr[i] ) ) { mask |= 1u << i; }
+  }
+  return mask;
+#endif
+}
+
+// one ray against ISECT_WIDTH spheres.
+static inline uint32_t isect_ray_spheres( const isect_spheres_t* spheres_ptr, vec3 origin, vec3 dir, float* t_near_ptr, float* t_far_ptr ) {
+#if defined( ISECT_AVX ) || defined( ISECT_SSE2 )
+  return _isect_sphere_wide(
+    _isect_splat3( origin ), _isect_splat3( dir ), _isect_load3( spheres_ptr->centre ), _isect_load( spheres_ptr->radius ), t_near_ptr, t_far_ptr );
+#else
+  uint32_t mask = 0;
+  for ( int i = 0; i < ISECT_WIDTH; i++ ) {
+    vec3 centre = ( vec3 ){ spheres_ptr->centre[0][i], spheres_ptr->centre[1][i], spheres_ptr->centre[2][i] };
+    if ( isect_ray_sphere( origin, dir, centre, spheres_ptr->radius[i], &t_near_ptr[i], &t_far_ptr[i] ) ) { mask |= 1u << i; }
+  }
+  return mask;
+#endif
+}
+
+// ISECT_WIDTH rays against one triangle. t_max_ptr is per ray, usually its closest hit so far.
+static inline uint32_t isect_packet_tri(
+  const isect_packet_t* packet_ptr, vec3 v0, vec3 e1, vec3 e2, float t_min, const float* t_max_ptr, float* t_ptr, float* u_ptr, float* v_ptr ) {
+#if defined( ISECT_AVX ) || defined( ISECT_SSE2 )
+  _isect_vec3_t origins = _isect_load3( packet_ptr->origin ), dirs = _isect_load3( packet_ptr->direction );
+  return _isect_tri_wide(
+    origins, dirs, _isect_splat3( v0 ), _isect_splat3( e1 ), _isect_splat3( e2 ), _isect_set1( t_min ), _isect_load( t_max_ptr ), t_ptr, u_ptr, v_ptr );
+#else
+  uint32_t mask = 0;
+  for ( int i = 0; i < ISECT_WIDTH; i++ ) {
+    vec3 origin = ( vec3 ){ packet_ptr->origin[0][i], packet_ptr->origin[1][i], packet_ptr->origin[2][i] };
+    vec3 dir    = ( vec3 ){ packet_ptr->direction[0][i], packet_ptr->direction[1][i], packet_ptr->direction[2][i] };
+    if ( isect_ray_tri( origin, dir, v0, e1, e2, t_min, t_max_ptr[i], &t_ptr[i], &u_ptr[i], &v_ptr[i] ) ) { mask |= 1u << i; }
+  }
+  return mask;
+#endif
+}
+
+// ISECT_WIDTH rays against one sphere.
+static inline uint32_t isect_packet_sphere( const isect_packet_t* packet_ptr, vec3 centre, float radius, float* t_near_ptr, float* t_far_ptr ) {
+#if defined( ISECT_AVX ) || defined( ISECT_SSE2 )
+  return _isect_sphere_wide(
+    _isect_load3( packet_ptr->origin ), _isect_load3( packet_ptr->direction ), _isect_splat3( centre ), _isect_set1( radius ), t_near_ptr, t_far_ptr );
+#else
+  uint32_t mask = 0;
+  for ( int i = 0; i < ISECT_WIDTH; i++ ) {
+    vec3 origin = ( vec3 ){ packet_ptr->origin[0][i], packet_ptr->origin[1][i], packet_ptr->origin[2][i] };
+    vec3 dir    = ( vec3 ){ packet_ptr->direction[0][i], packet_ptr->direction[1][i], packet_ptr->direction[2][i] };
+    if ( isect_ray_sphere( origin, dir, centre, radius, &t_near_ptr[i], &t_far_ptr[i] ) ) { mask |= 1u << i; }
+  }
+  return mask;
+#endif
+}
@@ -0,0 +1,251 @@
+/* Microbenchmark and cross-check for the intersection kernels in isect.h: scalar, one ray against ISECT_WIDTH primitives, and packets of ISECT_WIDTH rays.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L isect_bench.c -lm -pthread -o isect_bench           (SSE2, 4-wide)
+  gcc -O2 -mavx -D_POSIX_C_SOURCE=200809L isect_bench.c -lm -pthread -o isect_bench     (AVX, 8-wide)
+  gcc -O2 -DISECT_NO_SIMD -D_POSIX_C_SOURCE=200809L isect_bench.c -lm -pthread -o isect_bench   (plain C, lane by lane)
+Run:
+  ./isect_bench
+
+Every ray is tested against every primitive of a random scene with each kernel. `Mtests/s` counts ray-primitive tests, whatever the width.
+Each wide result is compared with the scalar test of the same ray and primitive: `mismatches` counts hits that differ and t, u or v values
+that aren't bit-identical, and `max diff` is the largest difference in t, u or v where both hit, relative to the scene size. Both should be
+0, and the run fails otherwise. Building for an FMA target such as -march=native lets the compiler contract the scalar arithmetic, see
+isect.h. Then triangles are only checked to within ISECT_EPSILON and spheres aren't checked; add -ffp-contract=off for identical results.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "isect.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_RAYS ( 64 * ISECT_WIDTH )
+#define N_PRIMS ( 512 * ISECT_WIDTH )
+#define N_REPEATS 5
+#define SCENE_SZ 10.0f
+
+#ifdef __FMA__
+// the scalar tests may have been contracted into fused multiply-adds. triangles stay within ISECT_EPSILON. sphere distances near tangency
+// don't, as the discriminant cancels, so they are reported but not checked.
+#define TRI_TOLERANCE ISECT_EPSILON
+#define SPHERE_TOLERANCE FLT_MAX
+#else
+#define TRI_TOLERANCE 0.0f
+#define SPHERE_TOLERANCE 0.0f
+#endif
+
+static vec3 _tri_vs[N_PRIMS][3], _tri_edges[N_PRIMS][2], _sphere_centres[N_PRIMS], _origins[N_RAYS], _dirs[N_RAYS];
+static float _sphere_radii[N_PRIMS];
+static isect_tris_t _tris_soa[N_PRIMS / ISECT_WIDTH];
+static isect_spheres_t _spheres_soa[N_PRIMS / ISECT_WIDTH];
+static isect_packet_t _packets[N_RAYS / ISECT_WIDTH];
+
+// results [ray][prim], written when a kernel is run with record set, but not when it is timed. the scalar tests fill the reference set,
+// and every wide test fills the other, to compare.
+typedef struct result_t {
+  float a, b, c; // t, u, v for triangles. t_near, t_far for spheres.
+  bool hit;
+} result_t;
+static result_t _ref[N_RAYS][N_PRIMS], _wide[N_RAYS][N_PRIMS];
+
+static int _count_bits( uint32_t mask ) {
+  int n = 0;
+  for ( ; mask; mask &= mask - 1 ) { n++; }
+  return n;
+}
+
+static float _rand_f( float min, float max ) { return min + ( max - min ) * ( (float)rand() / (float)RAND_MAX ); }
+static vec3 _rand_vec3( float min, float max ) { return ( vec3 ){ _rand_f( min, max ), _rand_f( min, max ), _rand_f( min, max ) }; }
+
+static void _gen_scene( void ) {
+  srand( 1 );
+  for ( int i = 0; i < N_PRIMS; i++ ) {
+    vec3 centre   = _rand_vec3( 0.0f, SCENE_SZ );
+    _tri_vs[i][0] = add_vec3_vec3( centre, _rand_vec3( -1.0f, 1.0f ) );
+    _tri_vs[i][1] = add_vec3_vec3( centre, _rand_vec3( -1.0f, 1.0f ) );
+    _tri_vs[i][2] = add_vec3_vec3( centre, _rand_vec3( -1.0f, 1.0f ) );
+    if ( 0 == i % 64 ) { _tri_vs[i][2] = add_vec3_vec3( _tri_vs[i][0], mult_vec3_f( sub_vec3_vec3( _tri_vs[i][1], _tri_vs[i][0] ), 0.5f ) ); } // degenerate
+    _tri_edges[i][0]   = sub_vec3_vec3( _tri_vs[i][1], _tri_vs[i][0] );
+    _tri_edges[i][1]   = sub_vec3_vec3( _tri_vs[i][2], _tri_vs[i][0] );
+    _sphere_centres[i] = _rand_vec3( 0.0f, SCENE_SZ );
+    _sphere_radii[i]   = _rand_f( 0.1f, 1.0f );
+    if ( 0 == i % ISECT_WIDTH ) {
+      isect_tris_clear( &_tris_soa[i / ISECT_WIDTH] );
+      isect_spheres_clear( &_spheres_soa[i / ISECT_WIDTH] );
+    }
+    isect_tris_set( &_tris_soa[i / ISECT_WIDTH], i % ISECT_WIDTH, _tri_vs[i][0], _tri_vs[i][1], _tri_vs[i][2] );
+    isect_spheres_set( &_spheres_soa[i / ISECT_WIDTH], i % ISECT_WIDTH, _sphere_centres[i], _sphere_radii[i] );
+  }
+  for ( int i = 0; i < N_RAYS; i++ ) {
+    _origins[i] = _rand_vec3( -SCENE_SZ * 0.5f, SCENE_SZ * 1.5f );
+    _dirs[i]    = normalise_vec3( sub_vec3_vec3( _rand_vec3( 0.0f, SCENE_SZ ), _origins[i] ) );
+    isect_packet_set( &_packets[i / ISECT_WIDTH], i % ISECT_WIDTH, _origins[i], _dirs[i] );
+  }
+}
+
+static int64_t _scalar_tris( bool record ) {
+  int64_t n_hits = 0;
+  for ( int r = 0; r < N_RAYS; r++ ) {
+    for ( int p = 0; p < N_PRIMS; p++ ) {
+      result_t res = ( result_t ){ .hit = false };
+      res.hit      = isect_ray_tri( _origins[r], _dirs[r], _tri_vs[p][0], _tri_edges[p][0], _tri_edges[p][1], 0.0f, FLT_MAX, &res.a, &res.b, &res.c );
+      n_hits += res.hit;
+      if ( record ) { _ref[r][p] = res; }
+    }
+  }
+  return n_hits;
+}
+
+static int64_t _wide_tris( bool record ) {
+  int64_t n_hits = 0;
+  for ( int r = 0; r < N_RAYS; r++ ) {
+    for ( int g = 0; g < N_PRIMS / ISECT_WIDTH; g++ ) {
+      float ts[ISECT_WIDTH], us[ISECT_WIDTH], vs[ISECT_WIDTH];
+      uint32_t mask = isect_ray_tris( &_tris_soa[g], _origins[r], _dirs[r], 0.0f, FLT_MAX, ts, us, vs );
+      n_hits += _count_bits( mask );
+      if ( !record ) { continue; }
+      for ( int lane = 0; lane < ISECT_WIDTH; lane++ ) {
+        _wide[r][g * ISECT_WIDTH + lane] = ( result_t ){ ts[lane], us[lane], vs[lane], ( mask >> lane ) & 1 };
+      }
+    }
+  }
+  return n_hits;
+}
+
+static int64_t _packet_tris( bool record ) {
+  int64_t n_hits = 0;
+  float t_maxs[ISECT_WIDTH];
+  for ( int lane = 0; lane < ISECT_WIDTH; lane++ ) { t_maxs[lane] = FLT_MAX; }
+  for ( int k = 0; k < N_RAYS / ISECT_WIDTH; k++ ) {
+    for ( int p = 0; p < N_PRIMS; p++ ) {
+      float ts[ISECT_WIDTH], us[ISECT_WIDTH], vs[ISECT_WIDTH];
+      uint32_t mask = isect_packet_tri( &_packets[k], _tri_vs[p][0], _tri_edges[p][0], _tri_edges[p][1], 0.0f, t_maxs, ts, us, vs );
+      n_hits += _count_bits( mask );
+      if ( !record ) { continue; }
+      for ( int lane = 0; lane < ISECT_WIDTH; lane++ ) {
+        _wide[k * ISECT_WIDTH + lane][p] = ( result_t ){ ts[lane], us[lane], vs[lane], ( mask >> lane ) & 1 };
+      }
+    }
+  }
+  return n_hits;
+}
+
+static int64_t _scalar_spheres( bool record ) {
+  int64_t n_hits = 0;
+  for ( int r = 0; r < N_RAYS; r++ ) {
+    for ( int p = 0; p < N_PRIMS; p++ ) {
+      result_t res = ( result_t ){ .hit = false };
+      res.hit      = isect_ray_sphere( _origins[r], _dirs[r], _sphere_centres[p], _sphere_radii[p], &res.a, &res.b );
+      n_hits += res.hit;
+      if ( record ) { _ref[r][p] = res; }
+    }
+  }
+  return n_hits;
+}
+
+static int64_t _wide_spheres( bool record ) {
+  int64_t n_hits = 0;
+  for ( int r = 0; r < N_RAYS; r++ ) {
+    for ( int g = 0; g < N_PRIMS / ISECT_WIDTH; g++ ) {
+      float t_nears[ISECT_WIDTH], t_fars[ISECT_WIDTH];
+      uint32_t mask = isect_ray_spheres( &_spheres_soa[g], _origins[r], _dirs[r], t_nears, t_fars );
+      n_hits += _count_bits( mask );
+      if ( !record ) { continue; }
+      for ( int lane = 0; lane < ISECT_WIDTH; lane++ ) {
+        _wide[r][g * ISECT_WIDTH + lane] = ( result_t ){ t_nears[lane], t_fars[lane], 0.0f, ( mask >> lane ) & 1 };
+      }
+    }
+  }
+  return n_hits;
+}
+
+static int64_t _packet_spheres( bool record ) {
+  int64_t n_hits = 0;
+  for ( int k = 0; k < N_RAYS / ISECT_WIDTH; k++ ) {
+    for ( int p = 0; p < N_PRIMS; p++ ) {
+      float t_nears[ISECT_WIDTH], t_fars[ISECT_WIDTH];
+      uint32_t mask = isect_packet_sphere( &_packets[k], _sphere_centres[p], _sphere_radii[p], t_nears, t_fars );
+      n_hits += _count_bits( mask );
+      if ( !record ) { continue; }
+      for ( int lane = 0; lane < ISECT_WIDTH; lane++ ) {
+        _wide[k * ISECT_WIDTH + lane][p] = ( result_t ){ t_nears[lane], t_fars[lane], 0.0f, ( mask >> lane ) & 1 };
+      }
+    }
+  }
+  return n_hits;
+}
+
+// compares _wide with _ref. only values of hits are compared, as misses leave the scalar outputs unwritten. a tolerance of 0 means bit-identical,
+// otherwise the largest difference in values where both hit is checked.
+static bool _compare( float tolerance, int64_t* n_mismatches_ptr, float* max_diff_ptr ) {
+  *n_mismatches_ptr = 0;
+  *max_diff_ptr     = 0.0f;
+  for ( int r = 0; r < N_RAYS; r++ ) {
+    for ( int p = 0; p < N_PRIMS; p++ ) {
+      const result_t *ref_ptr = &_ref[r][p], *wide_ptr = &_wide[r][p];
+      if ( ref_ptr->hit != wide_ptr->hit ) { ( *n_mismatches_ptr )++; }
+      if ( !ref_ptr->hit || !wide_ptr->hit ) { continue; }
+      float ref_vals[3] = { ref_ptr->a, ref_ptr->b, ref_ptr->c }, wide_vals[3] = { wide_ptr->a, wide_ptr->b, wide_ptr->c };
+      if ( 0 != memcmp( ref_vals, wide_vals, sizeof( ref_vals ) ) ) { ( *n_mismatches_ptr )++; }
+      for ( int i = 0; i < 3; i++ ) { *max_diff_ptr = MAX( *max_diff_ptr, fabsf( ref_vals[i] - wide_vals[i] ) / SCENE_SZ ); }
+    }
+  }
+  return 0.0f == tolerance ? 0 == *n_mismatches_ptr : *max_diff_ptr <= tolerance;
+}
+
+typedef int64_t ( *kernel_func_t )( bool record );
+
+// best time of N_REPEATS runs, and the number of hits.
+static double _time_kernel( kernel_func_t func, int64_t* n_hits_ptr ) {
+  double best = 1e9;
+  for ( int i = 0; i < N_REPEATS; i++ ) {
+    double t0   = apg_time_s();
+    *n_hits_ptr = func( false );
+    best        = MIN( best, apg_time_s() - t0 );
+  }
+  return best;
+}
+
+static bool _bench( const char* prim_name, kernel_func_t scalar_func, kernel_func_t wide_func, kernel_func_t packet_func, float tolerance ) {
+  const double n_tests = (double)N_RAYS * N_PRIMS;
+  int64_t n_hits       = 0;
+  double scalar_s      = _time_kernel( scalar_func, &n_hits );
+  scalar_func( true );
+  printf( "%-9s %-22s %10.1f %8s %9lli %12s %10s\n", prim_name, "scalar", n_tests / scalar_s / 1e6, "1.00x", (long long)n_hits, "-", "-" );
+
+  bool all_ok                    = true;
+  const char* names[2]           = { "1 ray x N prims", "N-ray packet x 1 prim" };
+  const kernel_func_t funcs[2]   = { wide_func, packet_func };
+  for ( int k = 0; k < 2; k++ ) {
+    int64_t n_mismatches = 0;
+    float max_diff       = 0.0f;
+    double wide_s        = _time_kernel( funcs[k], &n_hits );
+    funcs[k]( true );
+    bool ok = _compare( tolerance, &n_mismatches, &max_diff );
+    printf( "%-9s %-22s %10.1f %7.2fx %9lli %12lli %10.2g%s\n", prim_name, names[k], n_tests / wide_s / 1e6, scalar_s / wide_s, (long long)n_hits,
+      (long long)n_mismatches, max_diff, ok ? "" : "  FAIL" );
+    all_ok = all_ok && ok;
+  }
+  return all_ok;
+}
+
+int main( void ) {
+  apg_time_init();
+  _gen_scene();
+#if defined( ISECT_AVX )
+  const char* isa_str = "AVX";
+#elif defined( ISECT_SSE2 )
+  const char* isa_str = "SSE2";
+#else
+  const char* isa_str = "plain C";
+#endif
+  printf( "ISECT_WIDTH %i (%s). %i rays x %i primitives, best of %i\n", ISECT_WIDTH, isa_str, N_RAYS, N_PRIMS, N_REPEATS );
+  printf( "%-9s %-22s %10s %8s %9s %12s %10s\n", "prim", "kernel", "Mtests/s", "speedup", "hits", "mismatches", "max diff" );
+  bool ok = _bench( "triangle", _scalar_tris, _wide_tris, _packet_tris, TRI_TOLERANCE );
+  ok      = _bench( "sphere", _scalar_spheres, _wide_spheres, _packet_spheres, SPHERE_TOLERANCE ) && ok;
+  return ok ? 0 : 1;
+}
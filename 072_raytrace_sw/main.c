@@ -1,38 +1,48 @@
-#define APG_TGA_IMPLEMENTATION
+/* CPU ray tracer.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Run:
+  ./a.out             - a single sphere, traced with one ray per pixel.
+  ./a.out mesh.ply    - a triangle mesh, traced through a BVH on every core. prints build time and rays per second.
+  ./a.out -p mesh.ply [max_spp]
+                      - the mesh path traced progressively, up to max_spp samples per pixel (default 256), with soft sky light and
+                        bounced light. checkpoints to out.tga and out.pathstate every 10 seconds, and resumes from out.pathstate if it was
+                        saved from the same mesh, so an interrupted render can be restarted with the same command.
+Each writes out.tga.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
 #include "apg_tga.h"
+#include "apg_ply.h"
+#include "bvh.h"
+#include "path.h"
+#include "trace.h"
 #include <assert.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define W 256
 #define H 256
-
-typedef struct vec3_t {
-  float x, y, z;
-} vec3_t;
-
-typedef struct ray_t {
-  vec3_t origin;
-  vec3_t direction;
-} ray_t;
+#define MESH_W 1024
+#define MESH_H 768
 
 typedef struct sphere_t {
-  vec3_t centre;
+  vec3 centre;
   float radius;
   uint8_t colour[3]; // BGR
 } sphere_t;
 
-float dot_vec3( vec3_t a, vec3_t b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
-vec3_t sub_vec3( vec3_t a, vec3_t b ) { return ( vec3_t ){ .x = a.x - b.x, .y = a.y - b.y, .z = a.z - b.z }; }
-
 // return true if ray intersected sphere
 bool ray_sphere_test( ray_t ray, sphere_t sphere, float* t0, float* t1 ) {
   assert( t0 && t1 );
 
-  vec3_t omc           = sub_vec3( ray.origin, sphere.centre );
+  vec3 omc             = sub_vec3_vec3( ray.origin, sphere.centre );
   float b              = dot_vec3( ray.direction, omc );
   float c              = dot_vec3( omc, omc ) - sphere.radius * sphere.radius;
   float bit_under_sqrt = b * b - c;
@@ -50,7 +60,7 @@ void set_pixel( uint8_t* image, int x, int y, const uint8_t* colour ) {
   memcpy( &image[idx], colour, sizeof( uint8_t ) * 3 );
 }
 
-int main() {
+static int _sphere_demo( void ) {
   uint8_t* image = calloc( W * H * sizeof( uint8_t ) * 3, 1 );
   assert( image );
   uint8_t background_colour[3] = { 0x77, 0x77, 0x77 };
@@ -61,23 +71,134 @@ int main() {
     }
   }
 
-  sphere_t sphere = ( sphere_t ){ .centre = ( vec3_t ){ .x = 128, .y = 128, .z = 128 }, .radius = 64, .colour = { 0xFF, 0, 0 } };
+  sphere_t sphere = ( sphere_t ){ .centre = ( vec3 ){ .x = 128, .y = 128, .z = 128 }, .radius = 64, .colour = { 0xFF, 0, 0 } };
 
   for ( int y = 0; y < H; y++ ) {
     for ( int x = 0; x < W; x++ ) {
-      ray_t ray = ( ray_t ){ .origin = ( vec3_t ){ .x = x, .y = y, .z = 0 }, .direction = ( vec3_t ){ .x = 0, .y = 0, .z = 1 } };
+      ray_t ray = ( ray_t ){ .origin = ( vec3 ){ .x = x, .y = y, .z = 0 }, .direction = ( vec3 ){ .x = 0, .y = 0, .z = 1 } };
       float t0 = 0.0f, t1 = 0.0f;
       bool hit = ray_sphere_test( ray, sphere, &t0, &t1 );
       if ( hit ) { set_pixel( image, x, y, sphere.colour ); }
     }
   }
 
-  if ( !apg_tga_write_file( "out.tga", image, W, H, 3 ) ) {
+  if ( !apg_tga_write_file_type( "out.tga", image, W, H, 3, APG_TGA_TYPE_RLE_TRUE_COLOUR ) ) {
     fprintf( stderr, "ERROR writing output file\n" );
     return 1;
   }
 
   free( image );
-  printf( "Program halt.\n" );
   return 0;
 }
+
+static int _mesh_demo( const char* filename ) {
+  apg_ply_t ply = apg_ply_read( filename );
+  if ( !ply.loaded || 3 != ply.n_positions_comps || ply.n_vertices < 3 ) {
+    fprintf( stderr, "ERROR: could not load triangles from `%s`\n", filename );
+    apg_ply_delete( &ply );
+    return 1;
+  }
+  if ( !apg_jobs_init( 0 ) ) { fprintf( stderr, "WARNING: could not start job threads. tracing on this thread only\n" ); }
+
+  int n_tris = ply.n_vertices / 3;
+  bvh_t bvh  = ( bvh_t ){ .n_tris = 0 };
+  double t0  = apg_time_s();
+  if ( !bvh_build( &bvh, ply.positions_ptr, n_tris ) ) {
+    fprintf( stderr, "ERROR: out of memory building BVH\n" );
+    apg_ply_delete( &ply );
+    apg_jobs_free();
+    return 1;
+  }
+  double build_s = apg_time_s() - t0;
+  printf( "%i triangles. BVH of %i nodes built in %.1f ms\n", n_tris, bvh.n_nodes, build_s * 1000.0 );
+
+  const bvh_node_t* root_ptr = &bvh.nodes_ptr[0];
+  vec3 extent                = ( vec3 ){ root_ptr->max[0] - root_ptr->min[0], root_ptr->max[1] - root_ptr->min[1], root_ptr->max[2] - root_ptr->min[2] };
+  trace_scene_t scene        = ( trace_scene_t ){ .bvh_ptr = &bvh, .positions_ptr = ply.positions_ptr, .background = { 0x77, 0x77, 0x77 } };
+  scene.colours_ptr          = 3 == ply.n_colours_comps ? ply.colours_ptr : NULL;
+  scene.light_dir            = normalise_vec3( ( vec3 ){ 0.4f, 1.0f, 0.3f } );
+  scene.epsilon              = length_vec3( extent ) * 1e-5f;
+  trace_camera_t cam         = trace_camera_frame_bvh( &bvh, ( vec3 ){ 1.0f, 0.8f, 1.5f }, 60.0f, MESH_W, MESH_H );
+  trace_stats_t stats        = ( trace_stats_t ){ .n_primary_rays = 0 };
+  uint8_t* image             = malloc( MESH_W * MESH_H * 3 );
+  int ret                    = 1;
+  t0                         = apg_time_s();
+  if ( image && trace_render( &scene, &cam, image, MESH_W, MESH_H, &stats ) ) {
+    double trace_s = apg_time_s() - t0;
+    printf( "%ix%i traced in %.1f ms on %i threads: %.2f Mrays/s\n", MESH_W, MESH_H, trace_s * 1000.0, MAX( apg_jobs_n_threads(), 1 ),
+      ( stats.n_primary_rays + stats.n_shadow_rays ) / trace_s / 1e6 );
+    // rows are traced top-first, which is the order apg_tga writes them in
+    ret = apg_tga_write_file_type( "out.tga", image, MESH_W, MESH_H, 3, APG_TGA_TYPE_RLE_TRUE_COLOUR ) ? 0 : 1;
+    if ( ret ) { fprintf( stderr, "ERROR writing output file\n" ); }
+  } else {
+    fprintf( stderr, "ERROR: out of memory tracing\n" );
+  }
+
+  free( image );
+  bvh_free( &bvh );
+  apg_ply_delete( &ply );
+  apg_jobs_free();
+  return ret;
+}
+
+static int _path_demo( const char* filename, int max_spp ) {
+  apg_ply_t ply = apg_ply_read( filename );
+  if ( !ply.loaded || 3 != ply.n_positions_comps || ply.n_vertices < 3 ) {
+    fprintf( stderr, "ERROR: could not load triangles from `%s`\n", filename );
+    apg_ply_delete( &ply );
+    return 1;
+  }
+  if ( !apg_jobs_init( 0 ) ) { fprintf( stderr, "WARNING: could not start job threads. tracing on this thread only\n" ); }
+
+  bvh_t bvh = ( bvh_t ){ .n_tris = 0 };
+  if ( !bvh_build( &bvh, ply.positions_ptr, ply.n_vertices / 3 ) ) {
+    fprintf( stderr, "ERROR: out of memory building BVH\n" );
+    apg_ply_delete( &ply );
+    apg_jobs_free();
+    return 1;
+  }
+  const bvh_node_t* root_ptr = &bvh.nodes_ptr[0];
+  vec3 extent                = ( vec3 ){ root_ptr->max[0] - root_ptr->min[0], root_ptr->max[1] - root_ptr->min[1], root_ptr->max[2] - root_ptr->min[2] };
+  trace_scene_t scene        = ( trace_scene_t ){ .bvh_ptr = &bvh, .positions_ptr = ply.positions_ptr, .background = { 0x77, 0x77, 0x77 } };
+  scene.colours_ptr          = 3 == ply.n_colours_comps ? ply.colours_ptr : NULL;
+  scene.light_dir            = normalise_vec3( ( vec3 ){ 0.4f, 1.0f, 0.3f } );
+  scene.epsilon              = length_vec3( extent ) * 1e-5f;
+  trace_camera_t cam         = trace_camera_frame_bvh( &bvh, ( vec3 ){ 1.0f, 0.8f, 1.5f }, 60.0f, MESH_W, MESH_H );
+  path_settings_t settings   = path_default_settings();
+  settings.max_spp           = MAX( max_spp, settings.min_spp );
+  settings.image_filename    = "out.tga";
+  settings.state_filename    = "out.pathstate";
+  path_render_t render;
+  int ret = 1;
+  if ( path_render_init( &render, &scene, &cam, MESH_W, MESH_H ) ) {
+    if ( path_load_state( &render, settings.state_filename ) ) {
+      printf( "resuming from `%s`: %.1f samples per pixel so far\n", settings.state_filename, (double)render.stats.n_samples / ( MESH_W * MESH_H ) );
+    }
+    path_stats_t stats;
+    ret           = path_render_progressive( &render, &settings, &stats ) ? 0 : 1;
+    int n_threads = MAX( apg_jobs_n_threads(), 1 );
+    printf( "%i passes in %.1f s on %i threads: %.0f samples/s (%.0f per core), %.2f Mrays/s. %i checkpoints took %.1f ms\n", stats.n_passes,
+      stats.render_s, n_threads, stats.n_samples / stats.render_s, stats.n_samples / stats.render_s / n_threads, stats.n_rays / stats.render_s / 1e6,
+      stats.n_checkpoints, stats.checkpoint_s * 1000.0 );
+  } else {
+    fprintf( stderr, "ERROR: out of memory path tracing\n" );
+  }
+
+  path_render_free( &render );
+  bvh_free( &bvh );
+  apg_ply_delete( &ply );
+  apg_jobs_free();
+  return ret;
+}
+
+int main( int argc, char** argv ) {
+  apg_time_init();
+  int ret = 0;
+  if ( argc > 2 && 0 == strcmp( argv[1], "-p" ) ) {
+    ret = _path_demo( argv[2], argc > 3 ? atoi( argv[3] ) : 256 );
+  } else {
+    ret = argc > 1 ? _mesh_demo( argv[1] ) : _sphere_demo();
+  }
+  if ( 0 == ret ) { printf( "Program halt.\n" ); }
+  return ret;
+}
@@ -0,0 +1,533 @@
+#include "path.h"
+#include "apg.h"
+#define APG_TGA_IMPLEMENTATION // here rather than in main.c, so path_bench links it too.
+#include "apg_tga.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PASS_SPP 4                // samples per pixel a tile of average error gets in a pass, once past min_spp.
+#define MAX_PASS_SPP 16           // cap for the noisiest tiles.
+#define DEFAULT_ALBEDO 0.8f       // for meshes without vertex colours.
+#define RR_MIN_BOUNCE 2           // Russian roulette from this bounce on.
+#define ERROR_LUMINANCE_FLOOR 0.01f // stops nearly black tiles from reporting huge relative errors.
+#define GAMMA 2.2f
+#define STATE_MAGIC "APGPATH1"
+
+typedef struct tile_job_t {
+  path_render_t* render_ptr;
+  const path_settings_t* settings_ptr;
+  int tile_idx, n_new; // samples per pixel to add this pass.
+  int64_t n_rays;
+} tile_job_t;
+
+typedef struct state_header_t {
+  char magic[8];
+  uint32_t w, h, tile_sz, n_tiles;
+  uint64_t scene_hash;
+  path_stats_t stats;
+} state_header_t;
+
+// a copy of the image and state at the end of a pass, written out while the next pass is traced.
+typedef struct snapshot_t {
+  uint8_t* bgr_ptr;
+  float* accum_ptr;
+  path_tile_t* tiles_ptr;
+  path_stats_t stats;
+} snapshot_t;
+
+path_settings_t path_default_settings( void ) {
+  return ( path_settings_t ){ .min_spp = 8, .max_spp = 1024, .target_error = 0.01f, .max_bounces = 4, .checkpoint_interval_s = 10.0 };
+}
+
+static int _n_tiles( const path_render_t* render_ptr ) { return render_ptr->n_tiles_x * render_ptr->n_tiles_y; }
+
+static uint64_t _fnv1a( uint64_t hash, const void* data_ptr, size_t sz ) {
+  const uint8_t* bytes_ptr = (const uint8_t*)data_ptr;
+  for ( size_t i = 0; i < sz; i++ ) { hash = ( hash ^ bytes_ptr[i] ) * 0x100000001b3ull; }
+  return hash;
+}
+
+bool path_render_init( path_render_t* render_ptr, const trace_scene_t* scene_ptr, const trace_camera_t* cam_ptr, int w, int h ) {
+  assert( render_ptr && scene_ptr && scene_ptr->bvh_ptr && cam_ptr && w > 0 && h > 0 );
+  *render_ptr = ( path_render_t ){ .scene_ptr = scene_ptr, .cam = *cam_ptr, .w = w, .h = h };
+  render_ptr->n_tiles_x = ( w + PATH_TILE_SZ - 1 ) / PATH_TILE_SZ;
+  render_ptr->n_tiles_y = ( h + PATH_TILE_SZ - 1 ) / PATH_TILE_SZ;
+  render_ptr->accum_ptr = calloc( (size_t)w * h * 4, sizeof( float ) );
+  render_ptr->tiles_ptr = malloc( sizeof( path_tile_t ) * _n_tiles( render_ptr ) );
+  render_ptr->jobs_ptr  = malloc( sizeof( tile_job_t ) * _n_tiles( render_ptr ) );
+  if ( !render_ptr->accum_ptr || !render_ptr->tiles_ptr || !render_ptr->jobs_ptr ) {
+    path_render_free( render_ptr );
+    return false;
+  }
+  for ( int i = 0; i < _n_tiles( render_ptr ); i++ ) { render_ptr->tiles_ptr[i] = ( path_tile_t ){ .n_samples = 0, .error = FLT_MAX }; }
+
+  uint64_t hash          = 0xcbf29ce484222325ull;
+  hash                   = _fnv1a( hash, scene_ptr->positions_ptr, sizeof( float ) * 9 * (size_t)scene_ptr->bvh_ptr->n_tris );
+  hash                   = _fnv1a( hash, cam_ptr, sizeof( trace_camera_t ) );
+  hash                   = _fnv1a( hash, &w, sizeof( w ) );
+  hash                   = _fnv1a( hash, &h, sizeof( h ) );
+  render_ptr->scene_hash = hash;
+  return true;
+}
+
+void path_render_free( path_render_t* render_ptr ) {
+  if ( !render_ptr ) { return; }
+  free( render_ptr->accum_ptr );
+  free( render_ptr->tiles_ptr );
+  free( render_ptr->jobs_ptr );
+  *render_ptr = ( path_render_t ){ .w = 0 };
+}
+
+/*=================================================================================================
+SAMPLING
+=================================================================================================*/
+// lowbias32 integer hash, by Chris Wellons.
+static uint32_t _hash_u32( uint32_t x ) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+// PCG-RXS-M-XS 32-bit. a uniform float in [0, 1).
+static float _rand01( uint32_t* state_ptr ) {
+  uint32_t s = *state_ptr = *state_ptr * 747796405u + 2891336453u;
+  uint32_t w = ( ( s >> ( ( s >> 28u ) + 4u ) ) ^ s ) * 277803737u;
+  return ( ( ( w >> 22u ) ^ w ) >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+// cosine-weighted direction in the hemisphere around unit normal n, with an orthonormal basis from Duff et al. 2017.
+static vec3 _cosine_hemisphere( vec3 n, uint32_t* rng_ptr ) {
+  float sign = copysignf( 1.0f, n.z );
+  float a    = -1.0f / ( sign + n.z );
+  float b    = n.x * n.y * a;
+  vec3 t     = ( vec3 ){ 1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x };
+  vec3 bt    = ( vec3 ){ b, sign + n.y * n.y * a, -n.y };
+  float u1 = _rand01( rng_ptr ), u2 = _rand01( rng_ptr );
+  float r = sqrtf( u1 ), phi = 2.0f * (float)M_PI * u2;
+  vec3 dir = add_vec3_vec3( mult_vec3_f( t, r * cosf( phi ) ), mult_vec3_f( bt, r * sinf( phi ) ) );
+  return normalise_vec3( add_vec3_vec3( dir, mult_vec3_f( n, sqrtf( MAX( 1.0f - u1, 0.0f ) ) ) ) );
+}
+
+static float _luminance( vec3 rgb ) { return 0.2126f * rgb.x + 0.7152f * rgb.y + 0.0722f * rgb.z; }
+
+static vec3 _mult_vec3_vec3( vec3 a, vec3 b ) { return ( vec3 ){ a.x * b.x, a.y * b.y, a.z * b.z }; }
+
+// the background colour is for display, so it's linearised here, to come back out unchanged where nothing is hit.
+static vec3 _sky_radiance( const trace_scene_t* scene_ptr ) {
+  const uint8_t* bgr = scene_ptr->background;
+  return ( vec3 ){ powf( bgr[2] / 255.0f, GAMMA ), powf( bgr[1] / 255.0f, GAMMA ), powf( bgr[0] / 255.0f, GAMMA ) };
+}
+
+static vec3 _radiance( const trace_scene_t* scene_ptr, vec3 sky, ray_t ray, int max_bounces, uint32_t* rng_ptr, int64_t* n_rays_ptr ) {
+  vec3 sum = ( vec3 ){ 0.0f, 0.0f, 0.0f }, throughput = ( vec3 ){ 1.0f, 1.0f, 1.0f };
+  for ( int bounce = 0;; bounce++ ) {
+    bvh_hit_t hit;
+    ( *n_rays_ptr )++;
+    if ( !bvh_intersect( scene_ptr->bvh_ptr, ray, 0.0f, FLT_MAX, &hit ) ) {
+      sum = add_vec3_vec3( sum, _mult_vec3_vec3( throughput, sky ) );
+      break;
+    }
+    const float* p = &scene_ptr->positions_ptr[hit.tri_idx * 9];
+    vec3 e1        = ( vec3 ){ p[3] - p[0], p[4] - p[1], p[5] - p[2] };
+    vec3 e2        = ( vec3 ){ p[6] - p[0], p[7] - p[1], p[8] - p[2] };
+    vec3 normal    = normalise_vec3( cross_vec3( e1, e2 ) );
+    if ( dot_vec3( normal, ray.direction ) > 0.0f ) { normal = mult_vec3_f( normal, -1.0f ); } // triangles are two-sided
+    vec3 albedo = ( vec3 ){ DEFAULT_ALBEDO, DEFAULT_ALBEDO, DEFAULT_ALBEDO };
+    if ( scene_ptr->colours_ptr ) {
+      const float* c = &scene_ptr->colours_ptr[hit.tri_idx * 9];
+      float w0       = 1.0f - hit.u - hit.v;
+      albedo         = mult_vec3_f( ( vec3 ){ c[0] * w0 + c[3] * hit.u + c[6] * hit.v, c[1] * w0 + c[4] * hit.u + c[7] * hit.v,
+                                 c[2] * w0 + c[5] * hit.u + c[8] * hit.v },
+        1.0f / 255.0f );
+    }
+    vec3 hit_pos = add_vec3_vec3( ray.origin, mult_vec3_f( ray.direction, hit.t ) );
+    vec3 origin  = add_vec3_vec3( hit_pos, mult_vec3_f( normal, scene_ptr->epsilon ) );
+
+    // direct light from the sun. the sky is only found by bouncing into it.
+    float n_dot_l = dot_vec3( normal, scene_ptr->light_dir );
+    if ( n_dot_l > 0.0f ) {
+      ( *n_rays_ptr )++;
+      ray_t shadow = ( ray_t ){ .origin = origin, .direction = scene_ptr->light_dir };
+      if ( !bvh_occluded( scene_ptr->bvh_ptr, shadow, 0.0f, FLT_MAX ) ) {
+        sum = add_vec3_vec3( sum, mult_vec3_f( _mult_vec3_vec3( throughput, albedo ), n_dot_l ) ); //
+      }
+    }
+    if ( bounce == max_bounces ) { break; }
+
+    // a diffuse bounce sampled in proportion to the cosine term, which cancels with its probability, leaving the albedo
+    throughput = _mult_vec3_vec3( throughput, albedo );
+    if ( bounce >= RR_MIN_BOUNCE ) {
+      float survive = MIN( MAX( throughput.x, MAX( throughput.y, throughput.z ) ), 0.95f );
+      if ( _rand01( rng_ptr ) >= survive ) { break; }
+      throughput = mult_vec3_f( throughput, 1.0f / survive );
+    }
+    ray = ( ray_t ){ .origin = origin, .direction = _cosine_hemisphere( normal, rng_ptr ) };
+  }
+  return sum;
+}
+
+/*=================================================================================================
+SCHEDULING
+=================================================================================================*/
+static bool _tile_finished( const path_tile_t* tile_ptr, const path_settings_t* settings_ptr ) {
+  if ( tile_ptr->n_samples >= settings_ptr->max_spp ) { return true; }
+  return tile_ptr->n_samples >= settings_ptr->min_spp && tile_ptr->error < settings_ptr->target_error;
+}
+
+static void _tile_rect( const path_render_t* render_ptr, int tile_idx, int* x0_ptr, int* y0_ptr, int* x1_ptr, int* y1_ptr ) {
+  *x0_ptr = ( tile_idx % render_ptr->n_tiles_x ) * PATH_TILE_SZ;
+  *y0_ptr = ( tile_idx / render_ptr->n_tiles_x ) * PATH_TILE_SZ;
+  *x1_ptr = MIN( *x0_ptr + PATH_TILE_SZ, render_ptr->w );
+  *y1_ptr = MIN( *y0_ptr + PATH_TILE_SZ, render_ptr->h );
+}
+
+// the relative error of a tile's mean luminance: the standard error of each pixel's mean, from the variance of its samples, averaged
+// over the tile and divided by the tile's mean luminance.
+static float _tile_error( const path_render_t* render_ptr, int tile_idx ) {
+  int n = render_ptr->tiles_ptr[tile_idx].n_samples;
+  if ( n < 2 ) { return FLT_MAX; }
+  int x0, y0, x1, y1;
+  _tile_rect( render_ptr, tile_idx, &x0, &y0, &x1, &y1 );
+  double var_sum = 0.0, mean_sum = 0.0;
+  for ( int y = y0; y < y1; y++ ) {
+    for ( int x = x0; x < x1; x++ ) {
+      const float* a_ptr = &render_ptr->accum_ptr[( (size_t)y * render_ptr->w + x ) * 4];
+      double sum         = _luminance( ( vec3 ){ a_ptr[0], a_ptr[1], a_ptr[2] } );
+      double variance    = MAX( ( a_ptr[3] - sum * sum / n ) / ( n - 1 ), 0.0 );
+      var_sum += variance / n;
+      mean_sum += sum / n;
+    }
+  }
+  int n_pixels = ( x1 - x0 ) * ( y1 - y0 );
+  return (float)( sqrt( var_sum / n_pixels ) / ( mean_sum / n_pixels + ERROR_LUMINANCE_FLOOR ) );
+}
+
+static void _tile_job( void* arg_ptr ) {
+  tile_job_t* job_ptr            = (tile_job_t*)arg_ptr;
+  path_render_t* render_ptr      = job_ptr->render_ptr;
+  const trace_scene_t* scene_ptr = render_ptr->scene_ptr;
+  path_tile_t* tile_ptr          = &render_ptr->tiles_ptr[job_ptr->tile_idx];
+  vec3 sky                       = _sky_radiance( scene_ptr );
+  int x0, y0, x1, y1;
+  _tile_rect( render_ptr, job_ptr->tile_idx, &x0, &y0, &x1, &y1 );
+  for ( int y = y0; y < y1; y++ ) {
+    for ( int x = x0; x < x1; x++ ) {
+      uint32_t pixel_idx = (uint32_t)( y * render_ptr->w + x );
+      float* a_ptr       = &render_ptr->accum_ptr[(size_t)pixel_idx * 4];
+      for ( int s = tile_ptr->n_samples; s < tile_ptr->n_samples + job_ptr->n_new; s++ ) {
+        uint32_t rng = _hash_u32( pixel_idx ^ _hash_u32( (uint32_t)s + 0x9e3779b9u ) );
+        ray_t ray    = trace_camera_ray( &render_ptr->cam, x + _rand01( &rng ), y + _rand01( &rng ), render_ptr->w, render_ptr->h );
+        vec3 rgb     = _radiance( scene_ptr, sky, ray, job_ptr->settings_ptr->max_bounces, &rng, &job_ptr->n_rays );
+        float lum    = _luminance( rgb );
+        a_ptr[0] += rgb.x;
+        a_ptr[1] += rgb.y;
+        a_ptr[2] += rgb.z;
+        a_ptr[3] += lum * lum;
+      }
+    }
+  }
+  tile_ptr->n_samples += job_ptr->n_new;
+  tile_ptr->error = _tile_error( render_ptr, job_ptr->tile_idx );
+}
+
+static int _compare_jobs_by_error( const void* a_ptr, const void* b_ptr ) {
+  const tile_job_t *a = (const tile_job_t*)a_ptr, *b = (const tile_job_t*)b_ptr;
+  float error_a = a->render_ptr->tiles_ptr[a->tile_idx].error, error_b = b->render_ptr->tiles_ptr[b->tile_idx].error;
+  if ( error_a != error_b ) { return error_a > error_b ? -1 : 1; }
+  return a->tile_idx - b->tile_idx; // keeps the order deterministic
+}
+
+// fills the job list for the next pass, noisiest tiles first. returns the number of jobs.
+static int _schedule_pass( path_render_t* render_ptr, const path_settings_t* settings_ptr ) {
+  assert( settings_ptr->min_spp >= 2 && settings_ptr->max_spp >= settings_ptr->min_spp );
+  tile_job_t* jobs_ptr = (tile_job_t*)render_ptr->jobs_ptr;
+  int n_jobs = 0, n_errors = 0;
+  double error_sum = 0.0;
+  render_ptr->stats.n_tiles_finished = 0;
+  for ( int i = 0; i < _n_tiles( render_ptr ); i++ ) {
+    const path_tile_t* tile_ptr = &render_ptr->tiles_ptr[i];
+    if ( _tile_finished( tile_ptr, settings_ptr ) ) {
+      render_ptr->stats.n_tiles_finished++;
+      continue;
+    }
+    jobs_ptr[n_jobs++] = ( tile_job_t ){ .render_ptr = render_ptr, .settings_ptr = settings_ptr, .tile_idx = i };
+    if ( tile_ptr->n_samples >= settings_ptr->min_spp ) {
+      error_sum += tile_ptr->error;
+      n_errors++;
+    }
+  }
+  // samples double up to min_spp, for a quick first look, then go in proportion to the tile's error
+  float mean_error = n_errors > 0 ? (float)( error_sum / n_errors ) : 1.0f;
+  for ( int i = 0; i < n_jobs; i++ ) {
+    const path_tile_t* tile_ptr = &render_ptr->tiles_ptr[jobs_ptr[i].tile_idx];
+    int n                       = tile_ptr->n_samples;
+    if ( n < settings_ptr->min_spp ) {
+      jobs_ptr[i].n_new = MAX( 1, MIN( n, settings_ptr->min_spp - n ) );
+    } else {
+      float share       = mean_error > 0.0f ? tile_ptr->error / mean_error : 1.0f;
+      jobs_ptr[i].n_new = (int)CLAMP( lroundf( PASS_SPP * share ), 1, MAX_PASS_SPP );
+    }
+    jobs_ptr[i].n_new = MIN( jobs_ptr[i].n_new, settings_ptr->max_spp - n );
+  }
+  qsort( jobs_ptr, n_jobs, sizeof( tile_job_t ), _compare_jobs_by_error );
+  return n_jobs;
+}
+
+// queues the pass's jobs. the first are stolen first by idle threads, so the noisiest tiles start first.
+static void _launch_pass( path_render_t* render_ptr, int n_jobs, apg_job_counter_t* counter_ptr ) {
+  tile_job_t* jobs_ptr = (tile_job_t*)render_ptr->jobs_ptr;
+  for ( int i = 0; i < n_jobs; i++ ) { apg_jobs_run( _tile_job, &jobs_ptr[i], counter_ptr ); }
+}
+
+static void _finish_pass( path_render_t* render_ptr, int n_jobs ) {
+  const tile_job_t* jobs_ptr = (const tile_job_t*)render_ptr->jobs_ptr;
+  for ( int i = 0; i < n_jobs; i++ ) {
+    int x0, y0, x1, y1;
+    _tile_rect( render_ptr, jobs_ptr[i].tile_idx, &x0, &y0, &x1, &y1 );
+    render_ptr->stats.n_samples += (int64_t)( x1 - x0 ) * ( y1 - y0 ) * jobs_ptr[i].n_new;
+    render_ptr->stats.n_rays += jobs_ptr[i].n_rays;
+  }
+  render_ptr->stats.n_passes++;
+}
+
+int path_render_pass( path_render_t* render_ptr, const path_settings_t* settings_ptr ) {
+  assert( render_ptr && settings_ptr );
+  int n_jobs = _schedule_pass( render_ptr, settings_ptr );
+  if ( 0 == n_jobs ) { return 0; }
+  apg_job_counter_t done = { 0 };
+  _launch_pass( render_ptr, n_jobs, &done );
+  apg_jobs_wait( &done );
+  _finish_pass( render_ptr, n_jobs );
+  return n_jobs;
+}
+
+/*=================================================================================================
+OUTPUT
+=================================================================================================*/
+void path_resolve_bgr( const path_render_t* render_ptr, uint8_t* bgr_ptr ) {
+  assert( render_ptr && bgr_ptr );
+  for ( int y = 0; y < render_ptr->h; y++ ) {
+    for ( int x = 0; x < render_ptr->w; x++ ) {
+      int tile_idx       = ( y / PATH_TILE_SZ ) * render_ptr->n_tiles_x + x / PATH_TILE_SZ;
+      int n              = render_ptr->tiles_ptr[tile_idx].n_samples;
+      const float* a_ptr = &render_ptr->accum_ptr[( (size_t)y * render_ptr->w + x ) * 4];
+      uint8_t* out_ptr   = &bgr_ptr[( (size_t)y * render_ptr->w + x ) * 3];
+      for ( int c = 0; c < 3; c++ ) {
+        float linear   = n > 0 ? a_ptr[2 - c] / n : 0.0f;
+        out_ptr[c]     = (uint8_t)CLAMP( powf( linear, 1.0f / GAMMA ) * 255.0f + 0.5f, 0.0f, 255.0f );
+      }
+    }
+  }
+}
+
+static bool _has_extension( const char* filename, const char* ext ) {
+  size_t len = strlen( filename ), ext_len = strlen( ext );
+  if ( len < ext_len ) { return false; }
+  for ( size_t i = 0; i < ext_len; i++ ) {
+    char c = filename[len - ext_len + i];
+    if ( ( c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c ) != ext[i] ) { return false; }
+  }
+  return true;
+}
+
+// files are written beside their destination then renamed over it, so an interrupted write never leaves a broken checkpoint.
+static FILE* _open_temp( const char* filename, char* tmp_filename, size_t tmp_sz ) {
+  int n = snprintf( tmp_filename, tmp_sz, "%s.tmp", filename );
+  if ( n < 0 || (size_t)n >= tmp_sz ) { return NULL; }
+  return fopen( tmp_filename, "wb" );
+}
+
+static bool _close_temp( FILE* fptr, bool ok, const char* tmp_filename, const char* filename ) {
+  ok = ( 0 == fclose( fptr ) ) && ok;
+  bool renamed = ok && 0 == rename( tmp_filename, filename );
+#ifdef _WIN32
+  if ( ok && !renamed ) {
+    remove( filename ); // rename() doesn't replace an existing file on Windows
+    renamed = 0 == rename( tmp_filename, filename );
+  }
+#endif
+  ok = renamed;
+  if ( !ok ) {
+    fprintf( stderr, "ERROR: writing `%s`\n", filename );
+    remove( tmp_filename );
+  }
+  return ok;
+}
+
+bool path_write_image( const char* filename, const uint8_t* bgr_ptr, int w, int h ) {
+  assert( filename && bgr_ptr && w > 0 && h > 0 );
+  char tmp_filename[1024];
+  FILE* fptr = _open_temp( filename, tmp_filename, sizeof( tmp_filename ) );
+  if ( !fptr ) {
+    fprintf( stderr, "ERROR: opening `%s` for writing\n", filename );
+    return false;
+  }
+  bool ok = true;
+  if ( _has_extension( filename, ".ppm" ) ) {
+    uint8_t* row_ptr = malloc( (size_t)w * 3 );
+    ok               = NULL != row_ptr && fprintf( fptr, "P6\n%i %i\n255\n", w, h ) > 0;
+    for ( int y = 0; ok && y < h; y++ ) {
+      const uint8_t* src_ptr = &bgr_ptr[(size_t)y * w * 3];
+      for ( int x = 0; x < w; x++ ) {
+        row_ptr[x * 3 + 0] = src_ptr[x * 3 + 2];
+        row_ptr[x * 3 + 1] = src_ptr[x * 3 + 1];
+        row_ptr[x * 3 + 2] = src_ptr[x * 3 + 0];
+      }
+      ok = 1 == fwrite( row_ptr, (size_t)w * 3, 1, fptr );
+    }
+    free( row_ptr );
+  } else {
+    // run-length encoded, with the top row first, so the flat sky and background of a render shrink to a few bytes a row
+    size_t sz         = 0;
+    uint8_t* file_ptr = apg_tga_write_mem( bgr_ptr, (unsigned int)w, (unsigned int)h, 3, APG_TGA_TYPE_RLE_TRUE_COLOUR, &sz );
+    ok                = NULL != file_ptr && 1 == fwrite( file_ptr, sz, 1, fptr );
+    free( file_ptr );
+  }
+  return _close_temp( fptr, ok, tmp_filename, filename );
+}
+
+static bool _write_state(
+  const char* filename, const path_render_t* render_ptr, const path_stats_t* stats_ptr, const path_tile_t* tiles_ptr, const float* accum_ptr ) {
+  char tmp_filename[1024];
+  FILE* fptr = _open_temp( filename, tmp_filename, sizeof( tmp_filename ) );
+  if ( !fptr ) {
+    fprintf( stderr, "ERROR: opening `%s` for writing\n", filename );
+    return false;
+  }
+  state_header_t header = ( state_header_t ){ .w = (uint32_t)render_ptr->w, .h = (uint32_t)render_ptr->h, .tile_sz = PATH_TILE_SZ };
+  memcpy( header.magic, STATE_MAGIC, sizeof( header.magic ) );
+  header.n_tiles    = (uint32_t)_n_tiles( render_ptr );
+  header.scene_hash = render_ptr->scene_hash;
+  header.stats      = *stats_ptr;
+  bool ok           = 1 == fwrite( &header, sizeof( header ), 1, fptr );
+  ok                = ok && 1 == fwrite( tiles_ptr, sizeof( path_tile_t ) * header.n_tiles, 1, fptr );
+  ok                = ok && 1 == fwrite( accum_ptr, sizeof( float ) * 4 * (size_t)render_ptr->w * render_ptr->h, 1, fptr );
+  return _close_temp( fptr, ok, tmp_filename, filename );
+}
+
+bool path_save_state( const path_render_t* render_ptr, const char* filename ) {
+  assert( render_ptr && filename );
+  return _write_state( filename, render_ptr, &render_ptr->stats, render_ptr->tiles_ptr, render_ptr->accum_ptr );
+}
+
+bool path_load_state( path_render_t* render_ptr, const char* filename ) {
+  assert( render_ptr && filename );
+  FILE* fptr = fopen( filename, "rb" );
+  if ( !fptr ) { return false; }
+  state_header_t header;
+  size_t n_tiles = (size_t)_n_tiles( render_ptr ), n_floats = (size_t)render_ptr->w * render_ptr->h * 4;
+  bool ok                = 1 == fread( &header, sizeof( header ), 1, fptr ) && 0 == memcmp( header.magic, STATE_MAGIC, sizeof( header.magic ) );
+  ok                     = ok && header.w == (uint32_t)render_ptr->w && header.h == (uint32_t)render_ptr->h && header.tile_sz == PATH_TILE_SZ;
+  ok                     = ok && header.n_tiles == n_tiles && header.scene_hash == render_ptr->scene_hash;
+  path_tile_t* tiles_ptr = ok ? malloc( sizeof( path_tile_t ) * n_tiles ) : NULL;
+  float* accum_ptr       = ok ? malloc( sizeof( float ) * n_floats ) : NULL;
+  ok                     = ok && tiles_ptr && accum_ptr;
+  ok                     = ok && 1 == fread( tiles_ptr, sizeof( path_tile_t ) * n_tiles, 1, fptr );
+  ok                     = ok && 1 == fread( accum_ptr, sizeof( float ) * n_floats, 1, fptr );
+  for ( size_t i = 0; ok && i < n_tiles; i++ ) { ok = tiles_ptr[i].n_samples >= 0; }
+  fclose( fptr );
+  if ( ok ) {
+    memcpy( render_ptr->tiles_ptr, tiles_ptr, sizeof( path_tile_t ) * n_tiles );
+    memcpy( render_ptr->accum_ptr, accum_ptr, sizeof( float ) * n_floats );
+    render_ptr->stats = header.stats;
+  }
+  free( tiles_ptr );
+  free( accum_ptr );
+  return ok;
+}
+
+/*=================================================================================================
+PROGRESSIVE
+=================================================================================================*/
+static void _take_snapshot( const path_render_t* render_ptr, const path_settings_t* settings_ptr, snapshot_t* snap_ptr ) {
+  if ( settings_ptr->image_filename ) { path_resolve_bgr( render_ptr, snap_ptr->bgr_ptr ); }
+  if ( settings_ptr->state_filename ) {
+    memcpy( snap_ptr->accum_ptr, render_ptr->accum_ptr, sizeof( float ) * 4 * (size_t)render_ptr->w * render_ptr->h );
+    memcpy( snap_ptr->tiles_ptr, render_ptr->tiles_ptr, sizeof( path_tile_t ) * _n_tiles( render_ptr ) );
+  }
+  snap_ptr->stats = render_ptr->stats;
+}
+
+static bool _write_snapshot( const path_render_t* render_ptr, const path_settings_t* settings_ptr, const snapshot_t* snap_ptr ) {
+  bool ok = true;
+  if ( settings_ptr->image_filename ) { ok = path_write_image( settings_ptr->image_filename, snap_ptr->bgr_ptr, render_ptr->w, render_ptr->h ) && ok; }
+  if ( settings_ptr->state_filename ) {
+    ok = _write_state( settings_ptr->state_filename, render_ptr, &snap_ptr->stats, snap_ptr->tiles_ptr, snap_ptr->accum_ptr ) && ok;
+  }
+  return ok;
+}
+
+bool path_render_progressive( path_render_t* render_ptr, const path_settings_t* settings_ptr, path_stats_t* stats_ptr ) {
+  assert( render_ptr && settings_ptr );
+  path_stats_t start = render_ptr->stats;
+  bool checkpoints   = settings_ptr->image_filename || settings_ptr->state_filename;
+  snapshot_t snap    = ( snapshot_t ){ .bgr_ptr = NULL };
+  if ( checkpoints ) {
+    snap.bgr_ptr   = malloc( (size_t)render_ptr->w * render_ptr->h * 3 );
+    snap.accum_ptr = malloc( sizeof( float ) * 4 * (size_t)render_ptr->w * render_ptr->h );
+    snap.tiles_ptr = malloc( sizeof( path_tile_t ) * _n_tiles( render_ptr ) );
+    if ( !snap.bgr_ptr || !snap.accum_ptr || !snap.tiles_ptr ) {
+      fprintf( stderr, "WARNING: out of memory for checkpoints. rendering without them\n" );
+      checkpoints = false;
+    }
+  }
+
+  double t_start = apg_time_s(), t_prev = t_start, t_checkpoint = t_start;
+  bool pending = false, ok = true;
+  for ( ;; ) {
+    int n_jobs = _schedule_pass( render_ptr, settings_ptr );
+    if ( 0 == n_jobs ) { break; }
+    apg_job_counter_t done = { 0 };
+    _launch_pass( render_ptr, n_jobs, &done );
+    // the workers are busy with the pass, so write the last checkpoint meanwhile, then help with what's left of the pass
+    if ( pending ) {
+      double t0 = apg_time_s();
+      ok        = _write_snapshot( render_ptr, settings_ptr, &snap ) && ok;
+      pending   = false;
+      render_ptr->stats.checkpoint_s += apg_time_s() - t0;
+    }
+    apg_jobs_wait( &done );
+    _finish_pass( render_ptr, n_jobs );
+
+    double now = apg_time_s();
+    render_ptr->stats.render_s += now - t_prev;
+    t_prev                      = now;
+    bool out_of_time            = settings_ptr->time_limit_s > 0.0 && now - t_start >= settings_ptr->time_limit_s;
+    bool checkpoint_due         = settings_ptr->checkpoint_interval_s > 0.0 && now - t_checkpoint >= settings_ptr->checkpoint_interval_s;
+    if ( checkpoints && checkpoint_due && !out_of_time ) {
+      _take_snapshot( render_ptr, settings_ptr, &snap );
+      render_ptr->stats.n_checkpoints++;
+      pending      = true;
+      t_checkpoint = apg_time_s();
+      render_ptr->stats.checkpoint_s += t_checkpoint - now;
+    }
+    if ( out_of_time ) { break; }
+  }
+  // the final checkpoint supersedes any still pending, and there are no workers left to overlap it with
+  if ( checkpoints ) {
+    double t0 = apg_time_s();
+    render_ptr->stats.n_checkpoints++;
+    _take_snapshot( render_ptr, settings_ptr, &snap );
+    ok = _write_snapshot( render_ptr, settings_ptr, &snap ) && ok;
+    render_ptr->stats.checkpoint_s += apg_time_s() - t0;
+  }
+  render_ptr->stats.render_s += apg_time_s() - t_prev;
+
+  if ( stats_ptr ) {
+    const path_stats_t* s_ptr = &render_ptr->stats;
+    *stats_ptr = ( path_stats_t ){ .n_samples = s_ptr->n_samples - start.n_samples, .n_rays = s_ptr->n_rays - start.n_rays,
+      .n_passes = s_ptr->n_passes - start.n_passes, .n_checkpoints = s_ptr->n_checkpoints - start.n_checkpoints, .n_tiles_finished = s_ptr->n_tiles_finished,
+      .render_s = s_ptr->render_s - start.render_s, .checkpoint_s = s_ptr->checkpoint_s - start.checkpoint_s };
+  }
+  free( snap.bgr_ptr );
+  free( snap.accum_ptr );
+  free( snap.tiles_ptr );
+  return ok;
+}
@@ -0,0 +1,90 @@
+/* Progressive path tracing of a triangle mesh through a BVH, for 072_raytrace_sw.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Each pixel accumulates a running sum of radiance samples in a float buffer, and the image is the mean. Surfaces are diffuse, coloured by
+the mesh's vertex colours, lit by a directional sun with an explicit shadow ray at every bounce, and by a uniform sky in the scene's
+background colour. Paths end at the sky, after max_bounces, or by Russian roulette.
+
+Scheduling:
+  The image is cut into PATH_TILE_SZ square tiles. All pixels in a tile have the same sample count, and each tile tracks an estimate of
+  the relative error of its mean, from the variance of its pixels' luminance samples. Rendering proceeds in passes. Each pass gives every
+  tile that isn't finished some more samples as a job on the apg.h job system, ordered and weighted by error, so noisy tiles start first
+  and get more samples per pass. A tile is finished at max_spp, or once past min_spp with an error below target_error.
+
+Determinism and resuming:
+  Each sample's random numbers are seeded from its pixel and sample index, so the image doesn't depend on the thread count or the order
+  tiles run in. path_save_state() writes the accumulation buffer and tile counts at the end of a pass. Rendering from a state loaded with
+  path_load_state() carries on, with the same settings, exactly as if it had never stopped.
+
+Checkpoints:
+  path_render_progressive() copies the image and state at the end of a pass every checkpoint_interval_s, then writes them to disk on the
+  calling thread while the worker threads trace the next pass. Writes go to a temporary file, renamed into place when complete.
+*/
+
+#pragma once
+#include "bvh.h"
+#include "trace.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PATH_TILE_SZ 16
+
+typedef struct path_settings_t {
+  int min_spp;                  // samples per pixel every tile gets before its error estimate is trusted.
+  int max_spp;                  // samples per pixel no tile goes beyond.
+  float target_error;           // tiles whose estimated relative error falls below this are finished. 0 to take every tile to max_spp.
+  int max_bounces;              // diffuse bounces after the first hit.
+  double time_limit_s;          // path_render_progressive() stops after the pass that crosses this. 0 for no limit.
+  double checkpoint_interval_s; // 0 to only checkpoint when finished.
+  const char* image_filename;   // checkpoint image, .tga or .ppm. NULL for none.
+  const char* state_filename;   // checkpoint state, for path_load_state(). NULL for none.
+} path_settings_t;
+
+typedef struct path_tile_t {
+  int n_samples; // per pixel, so far.
+  float error;   // estimated relative error of the tile's mean luminance. FLT_MAX until there are 2 samples.
+} path_tile_t;
+
+typedef struct path_stats_t {
+  int64_t n_samples, n_rays; // pixel samples, and rays of all kinds.
+  int n_passes, n_checkpoints, n_tiles_finished;
+  double render_s;     // wall-clock time in path_render_progressive().
+  double checkpoint_s; // time the calling thread spent on checkpoints rather than tracing: copying state, and writing it while workers traced.
+} path_stats_t;
+
+typedef struct path_render_t {
+  const trace_scene_t* scene_ptr;
+  trace_camera_t cam;
+  int w, h, n_tiles_x, n_tiles_y;
+  float* accum_ptr;       // per pixel: sums of R, G and B samples, and of squared sample luminance. linear, 0-1 for a white surface in full sun.
+  path_tile_t* tiles_ptr; // n_tiles_x * n_tiles_y.
+  uint64_t scene_hash;    // of the triangles, camera and image size. saved states only load into a render with the same hash.
+  void* jobs_ptr;         // per tile, for the pass in flight.
+  path_stats_t stats;     // totals since path_render_init(), carried through saved states.
+} path_render_t;
+
+// max_spp 1024, min_spp 8, target_error 0.01, 4 bounces, checkpoints every 10 seconds, no time limit, no files.
+path_settings_t path_default_settings( void );
+
+// allocates buffers for a w x h image, all tiles at 0 samples. the scene and its BVH must outlive the render. returns false if out of memory.
+bool path_render_init( path_render_t* render_ptr, const trace_scene_t* scene_ptr, const trace_camera_t* cam_ptr, int w, int h );
+
+void path_render_free( path_render_t* render_ptr );
+
+// one pass over the unfinished tiles, on every apg.h job thread, as described above. returns the number of tiles traced, 0 when finished.
+int path_render_pass( path_render_t* render_ptr, const path_settings_t* settings_ptr );
+
+// passes until every tile is finished or the time limit passes, with checkpoints. stats_ptr may be NULL, else gets the stats for this call.
+// returns false if a checkpoint couldn't be written.
+bool path_render_progressive( path_render_t* render_ptr, const path_settings_t* settings_ptr, path_stats_t* stats_ptr );
+
+// the current mean of each pixel, gamma corrected and clamped, into a w x h BGR image with the top row first.
+void path_resolve_bgr( const path_render_t* render_ptr, uint8_t* bgr_ptr );
+
+// writes a BGR image with the top row first. the format is chosen by the extension: .ppm for binary PPM, otherwise RLE TGA.
+bool path_write_image( const char* filename, const uint8_t* bgr_ptr, int w, int h );
+
+bool path_save_state( const path_render_t* render_ptr, const char* filename );
+
+// returns false, leaving the render unchanged, if the file is missing, corrupt, or was saved from a different scene, camera or image size.
+bool path_load_state( path_render_t* render_ptr, const char* filename );
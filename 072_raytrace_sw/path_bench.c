@@ -0,0 +1,138 @@
+/* Headless benchmark for progressive path tracing: samples per second, per core, and the cost of checkpoints.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L path_bench.c path.c bvh.c trace.c apg_ply.c -lm -pthread -o path_bench
+Run:
+  ./path_bench [mesh.ply ...]
+
+With no arguments it uses the PLY models in the repo, plus a generated terrain. Each mesh is framed in a RES x RES view and path traced to
+SPP samples per pixel with target_error 0, so every tile gets the same work and runs are comparable. Each run is timed twice: without
+checkpoints, then with an image and state checkpoint after every pass, written to the working directory then deleted, to show what checkpointing costs.
+`samples/s` counts pixel samples, `per core` divides that by the job threads, and `Mrays/s` counts every ray, of any kind.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "apg_maths.h"
+#include "apg_ply.h"
+#include "bvh.h"
+#include "path.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RES 512
+#define SPP 32
+
+static const char* _default_meshes[] = { "../076_sw_rasteriser/cage.ply", "../057_sphere_doubler/uv_sphere.ply", "../089_voxedit_edges/spruce.ply",
+  "../106_voxedit2/torch.ply" };
+
+// n_quads x n_quads grid of rolling hills, coloured by height
+static apg_ply_t _gen_terrain( int n_quads ) {
+  int n_verts       = n_quads * n_quads * 6;
+  apg_ply_t ply     = ( apg_ply_t ){ .n_vertices = n_verts, .n_positions_comps = 3, .n_colours_comps = 3, .loaded = 1 };
+  ply.positions_ptr = malloc( sizeof( float ) * 3 * n_verts );
+  ply.colours_ptr   = malloc( sizeof( float ) * 3 * n_verts );
+  if ( !ply.positions_ptr || !ply.colours_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  int v = 0;
+  for ( int row = 0; row < n_quads; row++ ) {
+    for ( int col = 0; col < n_quads; col++ ) {
+      int corners[6][2] = { { col, row }, { col + 1, row + 1 }, { col + 1, row }, { col, row }, { col, row + 1 }, { col + 1, row + 1 } };
+      for ( int c = 0; c < 6; c++, v++ ) {
+        float x      = 20.0f * corners[c][0] / n_quads - 10.0f, z = 20.0f * corners[c][1] / n_quads - 10.0f;
+        float y      = sinf( x * 0.7f ) * cosf( z * 0.5f ) * 1.5f + sinf( x * 3.1f + z * 2.3f ) * 0.2f;
+        float* p_ptr = &ply.positions_ptr[v * 3];
+        float* c_ptr = &ply.colours_ptr[v * 3];
+        p_ptr[0] = x, p_ptr[1] = y, p_ptr[2] = z;
+        c_ptr[0] = 80.0f + y * 50.0f, c_ptr[1] = 150.0f + y * 40.0f, c_ptr[2] = 80.0f;
+      }
+    }
+  }
+  return ply;
+}
+
+static bool _render( const char* name, const trace_scene_t* scene_ptr, const trace_camera_t* cam_ptr, bool checkpoints ) {
+  path_render_t render;
+  if ( !path_render_init( &render, scene_ptr, cam_ptr, RES, RES ) ) {
+    fprintf( stderr, "ERROR: out of memory path tracing `%s`\n", name );
+    return false;
+  }
+  path_settings_t settings = path_default_settings();
+  settings.min_spp         = SPP;
+  settings.max_spp         = SPP;
+  settings.target_error    = 0.0f;
+  if ( checkpoints ) {
+    settings.checkpoint_interval_s = 1e-9;
+    settings.image_filename        = "path_bench.tga";
+    settings.state_filename        = "path_bench.pathstate";
+  }
+  path_stats_t stats;
+  bool ok       = path_render_progressive( &render, &settings, &stats );
+  int n_threads = MAX( apg_jobs_n_threads(), 1 );
+  printf( "%-36s %11s %7i %9.2f %11.0f %9.0f %8.2f %6i %8.1f\n", name, checkpoints ? "every pass" : "none", stats.n_passes, stats.render_s,
+    stats.n_samples / stats.render_s, stats.n_samples / stats.render_s / n_threads, stats.n_rays / stats.render_s / 1e6, stats.n_checkpoints,
+    stats.checkpoint_s * 1000.0 );
+  path_render_free( &render );
+  if ( checkpoints ) {
+    remove( settings.image_filename );
+    remove( settings.state_filename );
+  }
+  return ok;
+}
+
+static bool _bench_mesh( const char* name, const apg_ply_t* ply_ptr ) {
+  if ( 3 != ply_ptr->n_positions_comps || ply_ptr->n_vertices < 3 ) {
+    fprintf( stderr, "WARNING: skipping `%s`, which doesn't have 3D positions\n", name );
+    return true;
+  }
+  bvh_t bvh = ( bvh_t ){ .n_tris = 0 };
+  if ( !bvh_build( &bvh, ply_ptr->positions_ptr, ply_ptr->n_vertices / 3 ) ) {
+    fprintf( stderr, "ERROR: out of memory building BVH for `%s`\n", name );
+    return false;
+  }
+  const bvh_node_t* root_ptr = &bvh.nodes_ptr[0];
+  vec3 extent                = ( vec3 ){ root_ptr->max[0] - root_ptr->min[0], root_ptr->max[1] - root_ptr->min[1], root_ptr->max[2] - root_ptr->min[2] };
+  trace_scene_t scene        = ( trace_scene_t ){ .bvh_ptr = &bvh, .positions_ptr = ply_ptr->positions_ptr, .background = { 0x77, 0x77, 0x77 } };
+  scene.colours_ptr          = 3 == ply_ptr->n_colours_comps ? ply_ptr->colours_ptr : NULL;
+  scene.light_dir            = normalise_vec3( ( vec3 ){ 0.4f, 1.0f, 0.3f } );
+  scene.epsilon              = length_vec3( extent ) * 1e-5f;
+  trace_camera_t cam         = trace_camera_frame_bvh( &bvh, ( vec3 ){ 1.0f, 0.8f, 1.5f }, 60.0f, RES, RES );
+  bool ok                    = _render( name, &scene, &cam, false );
+  ok                         = _render( name, &scene, &cam, true ) && ok;
+  bvh_free( &bvh );
+  return ok;
+}
+
+int main( int argc, char** argv ) {
+  apg_time_init();
+  if ( !apg_jobs_init( 0 ) ) { return 1; }
+  printf( "%i threads, %ix%i pixels, %i samples per pixel\n", apg_jobs_n_threads(), RES, RES, SPP );
+  printf( "%-36s %11s %7s %9s %11s %9s %8s %6s %8s\n", "mesh", "checkpoints", "passes", "seconds", "samples/s", "per core", "Mrays/s", "chkpts",
+    "chkpt ms" );
+
+  bool all_ok = true;
+  int n_files = argc > 1 ? argc - 1 : (int)( sizeof( _default_meshes ) / sizeof( _default_meshes[0] ) );
+  for ( int i = 0; i < n_files; i++ ) {
+    const char* filename = argc > 1 ? argv[i + 1] : _default_meshes[i];
+    apg_ply_t ply        = apg_ply_read( filename );
+    if ( !ply.loaded ) {
+      fprintf( stderr, "WARNING: skipping `%s`\n", filename );
+      continue;
+    }
+    all_ok = _bench_mesh( filename, &ply ) && all_ok;
+    apg_ply_delete( &ply );
+  }
+  if ( argc < 2 ) {
+    apg_ply_t terrain = _gen_terrain( 256 );
+    if ( terrain.loaded ) { all_ok = _bench_mesh( "generated terrain", &terrain ) && all_ok; }
+    apg_ply_delete( &terrain );
+  }
+
+  apg_jobs_free();
+  return all_ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "trace.h"
+#include "apg.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AMBIENT 0.2f
+
+trace_camera_t trace_camera_look_at( vec3 pos, vec3 target, vec3 up, float fovy_deg, float aspect ) {
+  float half_h = tanf( fovy_deg * 0.5f * ONE_DEG_IN_RAD );
+  vec3 forward = normalise_vec3( sub_vec3_vec3( target, pos ) );
+  vec3 right   = normalise_vec3( cross_vec3( forward, up ) );
+  vec3 true_up = cross_vec3( right, forward );
+  return ( trace_camera_t ){ .pos = pos, .forward = forward, .right = mult_vec3_f( right, half_h * aspect ), .up = mult_vec3_f( true_up, half_h ) };
+}
+
+ray_t trace_camera_ray( const trace_camera_t* cam_ptr, float x, float y, int w, int h ) {
+  float sx = x / w * 2.0f - 1.0f, sy = 1.0f - y / h * 2.0f;
+  vec3 dir = add_vec3_vec3( cam_ptr->forward, add_vec3_vec3( mult_vec3_f( cam_ptr->right, sx ), mult_vec3_f( cam_ptr->up, sy ) ) );
+  return ( ray_t ){ .origin = cam_ptr->pos, .direction = normalise_vec3( dir ) };
+}
+
+trace_camera_t trace_camera_frame_bvh( const bvh_t* bvh_ptr, vec3 dir, float fovy_deg, int w, int h ) {
+  assert( bvh_ptr && bvh_ptr->nodes_ptr );
+  const bvh_node_t* root_ptr = &bvh_ptr->nodes_ptr[0];
+  vec3 min                   = ( vec3 ){ root_ptr->min[0], root_ptr->min[1], root_ptr->min[2] };
+  vec3 max                   = ( vec3 ){ root_ptr->max[0], root_ptr->max[1], root_ptr->max[2] };
+  vec3 centre                = mult_vec3_f( add_vec3_vec3( min, max ), 0.5f );
+  float radius               = length_vec3( sub_vec3_vec3( max, centre ) );
+  // fit the bounding sphere to the narrower of the horizontal and vertical fields of view
+  float half_fovy = fovy_deg * 0.5f * ONE_DEG_IN_RAD;
+  float half_fovx = atanf( tanf( half_fovy ) * w / h );
+  float dist      = radius / sinf( MIN( half_fovx, half_fovy ) );
+  vec3 pos        = add_vec3_vec3( centre, mult_vec3_f( normalise_vec3( dir ), dist ) );
+  return trace_camera_look_at( pos, centre, ( vec3 ){ 0.0f, 1.0f, 0.0f }, fovy_deg, (float)w / h );
+}
+
+typedef struct render_job_t {
+  const trace_scene_t* scene_ptr;
+  const trace_camera_t* cam_ptr;
+  uint8_t* bgr_ptr;
+  int w, h, n_tiles_x;
+  trace_stats_t* tile_stats_ptr; // per tile, summed after rendering.
+} render_job_t;
+
+static void _shade( const trace_scene_t* scene_ptr, ray_t ray, const bvh_hit_t* hit_ptr, trace_stats_t* stats_ptr, uint8_t* bgr_ptr ) {
+  const float* p = &scene_ptr->positions_ptr[hit_ptr->tri_idx * 9];
+  vec3 e1        = ( vec3 ){ p[3] - p[0], p[4] - p[1], p[5] - p[2] };
+  vec3 e2        = ( vec3 ){ p[6] - p[0], p[7] - p[1], p[8] - p[2] };
+  vec3 normal    = normalise_vec3( cross_vec3( e1, e2 ) );
+  if ( dot_vec3( normal, ray.direction ) > 0.0f ) { normal = mult_vec3_f( normal, -1.0f ); } // triangles are two-sided
+  vec3 rgb = ( vec3 ){ 255.0f, 255.0f, 255.0f };
+  if ( scene_ptr->colours_ptr ) {
+    const float* c = &scene_ptr->colours_ptr[hit_ptr->tri_idx * 9];
+    float w0       = 1.0f - hit_ptr->u - hit_ptr->v;
+    rgb            = ( vec3 ){ c[0] * w0 + c[3] * hit_ptr->u + c[6] * hit_ptr->v, c[1] * w0 + c[4] * hit_ptr->u + c[7] * hit_ptr->v,
+                 c[2] * w0 + c[5] * hit_ptr->u + c[8] * hit_ptr->v };
+  }
+  float light   = AMBIENT;
+  float n_dot_l = dot_vec3( normal, scene_ptr->light_dir );
+  if ( n_dot_l > 0.0f ) {
+    vec3 hit_pos = add_vec3_vec3( ray.origin, mult_vec3_f( ray.direction, hit_ptr->t ) );
+    ray_t shadow = ( ray_t ){ .origin = add_vec3_vec3( hit_pos, mult_vec3_f( normal, scene_ptr->epsilon ) ), .direction = scene_ptr->light_dir };
+    stats_ptr->n_shadow_rays++;
+    if ( !bvh_occluded( scene_ptr->bvh_ptr, shadow, 0.0f, FLT_MAX ) ) { light += ( 1.0f - AMBIENT ) * n_dot_l; }
+  }
+  bgr_ptr[0] = (uint8_t)CLAMP( rgb.z * light, 0.0f, 255.0f );
+  bgr_ptr[1] = (uint8_t)CLAMP( rgb.y * light, 0.0f, 255.0f );
+  bgr_ptr[2] = (uint8_t)CLAMP( rgb.x * light, 0.0f, 255.0f );
+}
+
+static void _render_tile_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const render_job_t* job_ptr = (const render_job_t*)arg_ptr;
+  for ( int64_t tile = begin; tile < end; tile++ ) {
+    trace_stats_t stats = ( trace_stats_t ){ .n_primary_rays = 0 };
+    int x0 = (int)( tile % job_ptr->n_tiles_x ) * TRACE_TILE_SZ, y0 = (int)( tile / job_ptr->n_tiles_x ) * TRACE_TILE_SZ;
+    for ( int y = y0; y < MIN( y0 + TRACE_TILE_SZ, job_ptr->h ); y++ ) {
+      for ( int x = x0; x < MIN( x0 + TRACE_TILE_SZ, job_ptr->w ); x++ ) {
+        uint8_t* bgr_ptr = &job_ptr->bgr_ptr[( (size_t)y * job_ptr->w + x ) * 3];
+        ray_t ray        = trace_camera_ray( job_ptr->cam_ptr, x + 0.5f, y + 0.5f, job_ptr->w, job_ptr->h );
+        bvh_hit_t hit;
+        stats.n_primary_rays++;
+        if ( bvh_intersect( job_ptr->scene_ptr->bvh_ptr, ray, 0.0f, FLT_MAX, &hit ) ) {
+          stats.n_hits++;
+          _shade( job_ptr->scene_ptr, ray, &hit, &stats, bgr_ptr );
+        } else {
+          memcpy( bgr_ptr, job_ptr->scene_ptr->background, 3 );
+        }
+      }
+    }
+    job_ptr->tile_stats_ptr[tile] = stats;
+  }
+}
+
+bool trace_render( const trace_scene_t* scene_ptr, const trace_camera_t* cam_ptr, uint8_t* bgr_ptr, int w, int h, trace_stats_t* stats_ptr ) {
+  assert( scene_ptr && scene_ptr->bvh_ptr && cam_ptr && bgr_ptr && w > 0 && h > 0 );
+  int n_tiles_x      = ( w + TRACE_TILE_SZ - 1 ) / TRACE_TILE_SZ, n_tiles_y = ( h + TRACE_TILE_SZ - 1 ) / TRACE_TILE_SZ;
+  render_job_t job   = ( render_job_t ){ .scene_ptr = scene_ptr, .cam_ptr = cam_ptr, .bgr_ptr = bgr_ptr, .w = w, .h = h, .n_tiles_x = n_tiles_x };
+  job.tile_stats_ptr = malloc( sizeof( trace_stats_t ) * n_tiles_x * n_tiles_y );
+  if ( !job.tile_stats_ptr ) { return false; }
+
+  apg_jobs_parallel_for( 0, n_tiles_x * n_tiles_y, 1, _render_tile_range, &job );
+
+  if ( stats_ptr ) {
+    *stats_ptr = ( trace_stats_t ){ .n_primary_rays = 0 };
+    for ( int tile = 0; tile < n_tiles_x * n_tiles_y; tile++ ) {
+      stats_ptr->n_primary_rays += job.tile_stats_ptr[tile].n_primary_rays;
+      stats_ptr->n_shadow_rays += job.tile_stats_ptr[tile].n_shadow_rays;
+      stats_ptr->n_hits += job.tile_stats_ptr[tile].n_hits;
+    }
+  }
+  free( job.tile_stats_ptr );
+  return true;
+}
@@ -0,0 +1,43 @@
+/* Tile-parallel ray tracing of a triangle mesh through a BVH, for 072_raytrace_sw.
+Author:   Anton Gerdelan  antongerdelan.net
+
+The image is cut into TRACE_TILE_SZ square tiles, and tiles are handed out with apg_jobs_parallel_for() if apg_jobs_init() has been called,
+otherwise traced on the calling thread. Each pixel fires one primary ray through its centre, and one shadow ray towards a directional light
+if it hit something, so the image doesn't depend on the thread count.
+*/
+
+#pragma once
+#include "bvh.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRACE_TILE_SZ 32
+
+// a pinhole camera.
+typedef struct trace_camera_t {
+  vec3 pos, forward, right, up; // right and up are scaled to half the image plane's width and height at distance 1.
+} trace_camera_t;
+
+typedef struct trace_scene_t {
+  const bvh_t* bvh_ptr;
+  const float* positions_ptr; // the triangles the BVH was built over, 9 floats each.
+  const float* colours_ptr;   // per vertex, 9 floats per triangle in 0-255 RGB, as apg_ply loads them. NULL for white.
+  vec3 light_dir;             // normalised, pointing towards the light.
+  float epsilon;              // how far secondary rays start off the surface, to avoid hitting it again. scale to the scene.
+  uint8_t background[3];      // BGR.
+} trace_scene_t;
+
+typedef struct trace_stats_t {
+  int64_t n_primary_rays, n_shadow_rays, n_hits;
+} trace_stats_t;
+
+trace_camera_t trace_camera_look_at( vec3 pos, vec3 target, vec3 up, float fovy_deg, float aspect );
+
+// the ray through image position (x,y) in pixels, from the top-left corner.
+ray_t trace_camera_ray( const trace_camera_t* cam_ptr, float x, float y, int w, int h );
+
+// a camera looking at the centre of the BVH's bounds from the direction `dir`, far enough away that the bounds fit in view.
+trace_camera_t trace_camera_frame_bvh( const bvh_t* bvh_ptr, vec3 dir, float fovy_deg, int w, int h );
+
+// trace every pixel of a w x h BGR image. stats_ptr may be NULL. returns false if out of memory, in which case the image is unchanged.
+bool trace_render( const trace_scene_t* scene_ptr, const trace_camera_t* cam_ptr, uint8_t* bgr_ptr, int w, int h, trace_stats_t* stats_ptr );
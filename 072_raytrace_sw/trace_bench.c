@@ -0,0 +1,167 @@
+/* Headless benchmark for the BVH ray tracer: build time and rays per second, over PLY meshes and generated multi-million-triangle meshes.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L trace_bench.c bvh.c trace.c apg_ply.c -lm -pthread -o trace_bench
+  add -mavx to test BVH leaves 8 triangles at a time rather than 4. see isect.h.
+Run:
+  ./trace_bench [mesh.ply ...]
+
+With no arguments it uses the PLY models in the repo, plus a generated 2M-triangle terrain and a 4M-triangle sphere.
+Each mesh is framed to fill a 1024x1024 view, lit by a directional light, and traced with one primary ray per pixel and a shadow ray per lit hit.
+`build ms` is bvh_build() including the copy of triangles into leaf order. `SAH` is the tree's estimated cost per ray in triangle tests,
+which is lower for better trees. `Mrays/s` counts primary and shadow rays together, and `prim Mrays/s` counts only primary rays.
+Builds and renders run on every core with the apg.h job system. Times are the best of N_REPEATS.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "apg_maths.h"
+#include "apg_ply.h"
+#include "bvh.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_REPEATS 3
+#define RES 1024
+
+static const char* _default_meshes[] = { "../076_sw_rasteriser/cage.ply", "../057_sphere_doubler/uv_sphere.ply", "../089_voxedit_edges/spruce.ply",
+  "../106_voxedit2/torch.ply" };
+
+// n_quads x n_quads grid of rolling hills, coloured by height
+static apg_ply_t _gen_terrain( int n_quads ) {
+  int n_verts       = n_quads * n_quads * 6;
+  apg_ply_t ply     = ( apg_ply_t ){ .n_vertices = n_verts, .n_positions_comps = 3, .n_colours_comps = 3, .loaded = 1 };
+  ply.positions_ptr = malloc( sizeof( float ) * 3 * n_verts );
+  ply.colours_ptr   = malloc( sizeof( float ) * 3 * n_verts );
+  if ( !ply.positions_ptr || !ply.colours_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  int v = 0;
+  for ( int row = 0; row < n_quads; row++ ) {
+    for ( int col = 0; col < n_quads; col++ ) {
+      int corners[6][2] = { { col, row }, { col + 1, row + 1 }, { col + 1, row }, { col, row }, { col, row + 1 }, { col + 1, row + 1 } };
+      for ( int c = 0; c < 6; c++, v++ ) {
+        float x      = 20.0f * corners[c][0] / n_quads - 10.0f, z = 20.0f * corners[c][1] / n_quads - 10.0f;
+        float y      = sinf( x * 0.7f ) * cosf( z * 0.5f ) * 1.5f + sinf( x * 3.1f + z * 2.3f ) * 0.2f;
+        float* p_ptr = &ply.positions_ptr[v * 3];
+        float* c_ptr = &ply.colours_ptr[v * 3];
+        p_ptr[0] = x, p_ptr[1] = y, p_ptr[2] = z;
+        c_ptr[0] = 80.0f + y * 50.0f, c_ptr[1] = 150.0f + y * 40.0f, c_ptr[2] = 80.0f;
+      }
+    }
+  }
+  return ply;
+}
+
+// a de-indexed UV sphere with n_rings * n_segs * 2 triangles, coloured by normal
+static apg_ply_t _gen_sphere( int n_rings, int n_segs ) {
+  int n_verts       = n_rings * n_segs * 6;
+  apg_ply_t ply     = ( apg_ply_t ){ .n_vertices = n_verts, .n_positions_comps = 3, .n_colours_comps = 3, .loaded = 1 };
+  ply.positions_ptr = malloc( sizeof( float ) * 3 * n_verts );
+  ply.colours_ptr   = malloc( sizeof( float ) * 3 * n_verts );
+  if ( !ply.positions_ptr || !ply.colours_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  int v = 0;
+  for ( int r = 0; r < n_rings; r++ ) {
+    for ( int s = 0; s < n_segs; s++ ) {
+      int corners[6][2] = { { r, s }, { r + 1, s }, { r + 1, s + 1 }, { r, s }, { r + 1, s + 1 }, { r, s + 1 } };
+      for ( int c = 0; c < 6; c++, v++ ) {
+        float theta  = (float)M_PI * corners[c][0] / n_rings, phi = 2.0f * (float)M_PI * corners[c][1] / n_segs;
+        float x      = sinf( theta ) * cosf( phi ), y = cosf( theta ), z = sinf( theta ) * sinf( phi );
+        float* p_ptr = &ply.positions_ptr[v * 3];
+        float* c_ptr = &ply.colours_ptr[v * 3];
+        p_ptr[0] = x * 5.0f, p_ptr[1] = y * 5.0f, p_ptr[2] = z * 5.0f;
+        c_ptr[0] = x * 127.0f + 128.0f, c_ptr[1] = y * 127.0f + 128.0f, c_ptr[2] = z * 127.0f + 128.0f;
+      }
+    }
+  }
+  return ply;
+}
+
+static bool _bench_mesh( const char* name, const apg_ply_t* ply_ptr ) {
+  if ( 3 != ply_ptr->n_positions_comps || ply_ptr->n_vertices < 3 ) {
+    fprintf( stderr, "WARNING: skipping `%s`, which doesn't have 3D positions\n", name );
+    return true;
+  }
+  int n_tris        = ply_ptr->n_vertices / 3;
+  bvh_t bvh         = ( bvh_t ){ .n_tris = 0 };
+  double best_build = 1e9;
+  for ( int i = 0; i < N_REPEATS; i++ ) {
+    bvh_free( &bvh );
+    double t0 = apg_time_s();
+    if ( !bvh_build( &bvh, ply_ptr->positions_ptr, n_tris ) ) {
+      fprintf( stderr, "ERROR: out of memory building BVH for `%s`\n", name );
+      return false;
+    }
+    best_build = MIN( best_build, apg_time_s() - t0 );
+  }
+
+  uint8_t* img_ptr = malloc( RES * RES * 3 );
+  if ( !img_ptr ) {
+    bvh_free( &bvh );
+    return false;
+  }
+  const bvh_node_t* root_ptr = &bvh.nodes_ptr[0];
+  vec3 extent                = ( vec3 ){ root_ptr->max[0] - root_ptr->min[0], root_ptr->max[1] - root_ptr->min[1], root_ptr->max[2] - root_ptr->min[2] };
+  trace_scene_t scene        = ( trace_scene_t ){ .bvh_ptr = &bvh, .positions_ptr = ply_ptr->positions_ptr, .background = { 0x77, 0x77, 0x77 } };
+  scene.colours_ptr          = 3 == ply_ptr->n_colours_comps ? ply_ptr->colours_ptr : NULL;
+  scene.light_dir            = normalise_vec3( ( vec3 ){ 0.4f, 1.0f, 0.3f } );
+  scene.epsilon              = length_vec3( extent ) * 1e-5f;
+  trace_camera_t cam         = trace_camera_frame_bvh( &bvh, ( vec3 ){ 1.0f, 0.8f, 1.5f }, 60.0f, RES, RES );
+  trace_stats_t stats        = ( trace_stats_t ){ .n_primary_rays = 0 };
+  double best_trace          = 1e9;
+  for ( int i = 0; i < N_REPEATS; i++ ) {
+    double t0 = apg_time_s();
+    if ( !trace_render( &scene, &cam, img_ptr, RES, RES, &stats ) ) {
+      fprintf( stderr, "ERROR: out of memory tracing `%s`\n", name );
+      break;
+    }
+    best_trace = MIN( best_trace, apg_time_s() - t0 );
+  }
+  int64_t n_rays = stats.n_primary_rays + stats.n_shadow_rays;
+  printf( "%-36s %8i %9.1f %8.2f %9i %5i %7.1f %9.2f %9.2f %11.2f %5.1f%%\n", name, n_tris, best_build * 1000.0, n_tris / best_build / 1e6, bvh.n_nodes,
+    bvh.max_depth, bvh.sah_cost, best_trace * 1000.0, n_rays / best_trace / 1e6, stats.n_primary_rays / best_trace / 1e6,
+    100.0 * stats.n_hits / MAX( stats.n_primary_rays, 1 ) );
+  free( img_ptr );
+  bvh_free( &bvh );
+  return true;
+}
+
+int main( int argc, char** argv ) {
+  apg_time_init();
+  if ( !apg_jobs_init( 0 ) ) { return 1; }
+  printf( "%i threads, %ix%i pixels, best of %i\n", apg_jobs_n_threads(), RES, RES, N_REPEATS );
+  printf( "%-36s %8s %9s %8s %9s %5s %7s %9s %9s %11s %6s\n", "mesh", "tris", "build ms", "Mtri/s", "nodes", "depth", "SAH", "trace ms", "Mrays/s",
+    "prim Mray/s", "hit" );
+
+  bool all_ok = true;
+  int n_files = argc > 1 ? argc - 1 : (int)( sizeof( _default_meshes ) / sizeof( _default_meshes[0] ) );
+  for ( int i = 0; i < n_files; i++ ) {
+    const char* filename = argc > 1 ? argv[i + 1] : _default_meshes[i];
+    apg_ply_t ply        = apg_ply_read( filename );
+    if ( !ply.loaded ) {
+      fprintf( stderr, "WARNING: skipping `%s`\n", filename );
+      continue;
+    }
+    all_ok = _bench_mesh( filename, &ply ) && all_ok;
+    apg_ply_delete( &ply );
+  }
+  if ( argc < 2 ) {
+    apg_ply_t terrain = _gen_terrain( 1024 );
+    if ( terrain.loaded ) { all_ok = _bench_mesh( "generated terrain", &terrain ) && all_ok; }
+    apg_ply_delete( &terrain );
+    apg_ply_t sphere = _gen_sphere( 1024, 2048 );
+    if ( sphere.loaded ) { all_ok = _bench_mesh( "generated sphere", &sphere ) && all_ok; }
+    apg_ply_delete( &sphere );
+  }
+
+  apg_jobs_free();
+  return all_ok ? 0 : 1;
+}
@@ -550,7 +550,7 @@ static inline bool ray_obb( obb_t box, vec3 ray_o, vec3 ray_d, float* t, int* fa
 // point p with respect to triangle (a, b, c)
 // returns barycentric coords u,v,w as vector components .x .y .z
 // from Christer Ericson's Real-Time Collision Detection
-vec3 barycentric( vec2 p, vec2 a, vec2 b, vec2 c ) {
+static inline vec3 barycentric( vec2 p, vec2 a, vec2 b, vec2 c ) {
   vec2 v0 = sub_vec2_vec2( b, a ), v1 = sub_vec2_vec2( c, a ), v2 = sub_vec2_vec2( p, a );
   float d00   = dot_vec2( v0, v0 );
   float d01   = dot_vec2( v0, v1 );
@@ -0,0 +1,2 @@
+#!/bin/bash
+gcc -O2 -g -Wall -DAPG_PROFILER main.c raster.c apg_ply.c -lm -pthread
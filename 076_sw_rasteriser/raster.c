@@ -0,0 +1,971 @@
+#include "raster.h"
+#include "apg.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) ) && !defined( RASTER_NO_SIMD )
+#define RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#define TRANSFORM_GRAIN 1024 // triangles per job in the transform and setup stages
+#define BIN_CHUNK_TRIS 4096  // triangles per binning chunk. fixed so the bin layout doesn't depend on the thread count.
+#define BLOCK_SZ 8           // edge core block, and hi-z cell, in pixels square.
+
+// grows *ptr to hold at least `n` elements of `elem_sz`. contents are not preserved.
+static bool _reserve( void** ptr, int* capacity_ptr, int n, size_t elem_sz ) {
+  if ( n <= *capacity_ptr ) { return true; }
+  void* new_ptr = malloc( (size_t)n * elem_sz );
+  if ( !new_ptr ) { return false; }
+  free( *ptr );
+  *ptr          = new_ptr;
+  *capacity_ptr = n;
+  return true;
+}
+
+/*=================================================================================================
+TRANSFORM
+=================================================================================================*/
+typedef struct transform_job_t {
+  const apg_ply_t* ply_ptr;
+  mat4 PVM;
+  int width, height;
+  float farc;
+  vertex_t* tris_ptr;
+} transform_job_t;
+
+static void _transform_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const transform_job_t* job_ptr = (const transform_job_t*)arg_ptr;
+  const apg_ply_t* ply_ptr       = job_ptr->ply_ptr;
+  int width = job_ptr->width, height = job_ptr->height;
+
+  for ( int64_t t = begin; t < end; t++ ) {
+    int i = (int)t * 3;
+    vec4 vertex[3];
+    float clip_w[3];
+    vec3 colourf[3] = { ( vec3 ){ .x = 1 }, ( vec3 ){ .y = 1 }, ( vec3 ){ .z = 1 } };
+    // every 3 vertices is 1 triangle's worth
+    for ( int v = 0; v < 3; v++ ) {
+      memcpy( &vertex[v].x, &ply_ptr->positions_ptr[( i + v ) * ply_ptr->n_positions_comps], sizeof( float ) * ply_ptr->n_positions_comps );
+      if ( ply_ptr->colours_ptr ) { memcpy( &colourf[v].x, &ply_ptr->colours_ptr[( i + v ) * ply_ptr->n_colours_comps], sizeof( float ) * 3 ); }
+      vertex[v].w = 1.0f;
+
+      // apply a world transformation to the geometry
+      vertex[v] = mult_mat4_vec4( job_ptr->PVM, vertex[v] );
+      clip_w[v] = vertex[v].w;
+      vertex[v].x /= vertex[v].w;
+      vertex[v].y /= vertex[v].w;
+
+      // transform into viewport space
+      vertex[v].x = vertex[v].x * width + width / 2;
+      vertex[v].y = vertex[v].y * height + height / 2;
+      vertex[v].w = job_ptr->farc - vertex[v].w;
+    }
+    // NOTE(Anton) I had to reverse abc winding order because it was rendering inside-out
+    for ( int v = 0; v < 3; v++ ) {
+      vertex_t* dst_ptr = &job_ptr->tris_ptr[i + v];
+      int src           = 2 - v;
+      dst_ptr->pos      = ( vec3 ){ .x = vertex[src].x, .y = vertex[src].y, .z = vertex[src].w };
+      dst_ptr->w        = clip_w[src];
+      dst_ptr->colour   = ( rgb_byte_t ){ .r = colourf[src].x * 255, .g = colourf[src].y * 255, .b = colourf[src].z * 255 };
+    }
+  }
+}
+
+void raster_transform_ply( const apg_ply_t* ply_ptr, mat4 PVM, int width, int height, float farc, vertex_t* tris_ptr ) {
+  assert( ply_ptr && tris_ptr );
+  APG_PROF_BEGIN( "raster_transform" );
+  transform_job_t job = ( transform_job_t ){ .ply_ptr = ply_ptr, .PVM = PVM, .width = width, .height = height, .farc = farc, .tris_ptr = tris_ptr };
+  apg_jobs_parallel_for( 0, ply_ptr->n_vertices / 3, TRANSFORM_GRAIN, _transform_range, &job );
+  APG_PROF_END();
+}
+
+/*=================================================================================================
+INDEXED VERTEX STAGE
+=================================================================================================*/
+enum { OUT_LEFT = 1, OUT_RIGHT = 2, OUT_BOTTOM = 4, OUT_TOP = 8, OUT_NEAR = 16, OUT_FAR = 32 };
+
+// same colours as _transform_range() when the PLY has none: red, green, blue at a triangle's 3 corners.
+static rgb_byte_t _ply_colour( const apg_ply_t* ply_ptr, int i ) {
+  vec3 colourf = ( vec3 ){ .x = 0 == i % 3, .y = 1 == i % 3, .z = 2 == i % 3 };
+  if ( ply_ptr->colours_ptr ) { memcpy( &colourf.x, &ply_ptr->colours_ptr[i * ply_ptr->n_colours_comps], sizeof( float ) * 3 ); }
+  return ( rgb_byte_t ){ .r = colourf.x * 255, .g = colourf.y * 255, .b = colourf.z * 255 };
+}
+
+// FNV-1a over a position and colour
+static uint32_t _hash_vertex( const float* p, rgb_byte_t c ) {
+  uint8_t bytes[15];
+  memcpy( bytes, p, 12 );
+  bytes[12] = c.r, bytes[13] = c.g, bytes[14] = c.b;
+  uint32_t h = 2166136261u;
+  for ( int i = 0; i < 15; i++ ) { h = ( h ^ bytes[i] ) * 16777619u; }
+  return h;
+}
+
+bool raster_mesh_from_ply( const apg_ply_t* ply_ptr, raster_mesh_t* mesh_ptr ) {
+  assert( ply_ptr && mesh_ptr );
+  *mesh_ptr    = ( raster_mesh_t ){ .n_tris = ply_ptr->n_vertices / 3 };
+  int n_in     = mesh_ptr->n_tris * 3;
+  int n_padded = ( n_in + 3 ) & ~3;
+  int n_slots  = 16;
+  while ( n_slots < n_in * 2 ) { n_slots *= 2; }
+  int* slots_ptr        = malloc( sizeof( int ) * n_slots );
+  mesh_ptr->xs_ptr      = calloc( (size_t)n_padded * 3, sizeof( float ) );
+  mesh_ptr->colours_ptr = malloc( sizeof( rgb_byte_t ) * MAX( n_in, 1 ) );
+  mesh_ptr->indices_ptr = malloc( sizeof( uint32_t ) * MAX( n_in, 1 ) );
+  if ( !slots_ptr || !mesh_ptr->xs_ptr || !mesh_ptr->colours_ptr || !mesh_ptr->indices_ptr ) {
+    free( slots_ptr );
+    raster_mesh_free( mesh_ptr );
+    return false;
+  }
+  memset( slots_ptr, -1, sizeof( int ) * n_slots );
+  float *xs_ptr = mesh_ptr->xs_ptr, *ys_ptr = &xs_ptr[n_padded], *zs_ptr = &xs_ptr[n_padded * 2];
+
+  for ( int i = 0; i < n_in; i++ ) {
+    float p[3] = { 0 };
+    memcpy( p, &ply_ptr->positions_ptr[i * ply_ptr->n_positions_comps], sizeof( float ) * MIN( ply_ptr->n_positions_comps, 3 ) );
+    rgb_byte_t c  = _ply_colour( ply_ptr, i );
+    uint32_t slot = _hash_vertex( p, c ) & ( n_slots - 1 );
+    for ( ;; slot = ( slot + 1 ) & ( n_slots - 1 ) ) {
+      int v = slots_ptr[slot];
+      if ( v < 0 ) {
+        v                        = mesh_ptr->n_vertices++;
+        slots_ptr[slot]          = v;
+        xs_ptr[v]                = p[0];
+        ys_ptr[v]                = p[1];
+        zs_ptr[v]                = p[2];
+        mesh_ptr->colours_ptr[v] = c;
+        mesh_ptr->indices_ptr[i] = v;
+        break;
+      }
+      const rgb_byte_t* vc_ptr = &mesh_ptr->colours_ptr[v];
+      if ( xs_ptr[v] == p[0] && ys_ptr[v] == p[1] && zs_ptr[v] == p[2] && vc_ptr->r == c.r && vc_ptr->g == c.g && vc_ptr->b == c.b ) {
+        mesh_ptr->indices_ptr[i] = v;
+        break;
+      }
+    }
+  }
+  free( slots_ptr );
+
+  // pack y and z down behind x now the vertex count is known. the gaps were zeroed by calloc, and stay zero as padding.
+  int n_vpadded = ( mesh_ptr->n_vertices + 3 ) & ~3;
+  memmove( &xs_ptr[n_vpadded], ys_ptr, sizeof( float ) * n_vpadded );
+  memmove( &xs_ptr[n_vpadded * 2], zs_ptr, sizeof( float ) * n_vpadded );
+  mesh_ptr->ys_ptr = &xs_ptr[n_vpadded];
+  mesh_ptr->zs_ptr = &xs_ptr[n_vpadded * 2];
+  return true;
+}
+
+void raster_mesh_free( raster_mesh_t* mesh_ptr ) {
+  if ( !mesh_ptr ) { return; }
+  free( mesh_ptr->xs_ptr );
+  free( mesh_ptr->colours_ptr );
+  free( mesh_ptr->indices_ptr );
+  *mesh_ptr = ( raster_mesh_t ){ .n_tris = 0 };
+}
+
+typedef struct vertex_job_t {
+  raster_vertex_stage_t* stage_ptr;
+  const raster_mesh_t* mesh_ptr;
+  mat4 PVM;
+  int width, height;
+  float farc;
+} vertex_job_t;
+
+// transform groups of 4 vertices to clip space and classify them against the frustum.
+// the viewport maps NDC -0.5..0.5 onto the screen, so that is the visible range for x and y.
+static void _transform_vertices_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const vertex_job_t* job_ptr = (const vertex_job_t*)arg_ptr;
+  const raster_mesh_t* mesh   = job_ptr->mesh_ptr;
+  const float* m              = job_ptr->PVM.m;
+  int cap                     = job_ptr->stage_ptr->vertex_capacity;
+  float* cx_ptr               = job_ptr->stage_ptr->clip_ptr;
+  float *cy_ptr               = &cx_ptr[cap], *cz_ptr = &cx_ptr[cap * 2], *cw_ptr = &cx_ptr[cap * 3];
+  uint8_t* outcodes_ptr       = job_ptr->stage_ptr->outcodes_ptr;
+  vertex_t* screen_ptr        = job_ptr->stage_ptr->screen_ptr;
+
+  float width = (float)job_ptr->width, height = (float)job_ptr->height;
+  float half_width = (float)( job_ptr->width / 2 ), half_height = (float)( job_ptr->height / 2 );
+
+  for ( int64_t group = begin; group < end; group++ ) {
+    int i = (int)group * 4;
+#ifdef RASTER_SSE2
+    __m128 x = _mm_loadu_ps( &mesh->xs_ptr[i] ), y = _mm_loadu_ps( &mesh->ys_ptr[i] ), z = _mm_loadu_ps( &mesh->zs_ptr[i] );
+    // same operation order as mult_mat4_vec4(), with w = 1, so results match the de-indexed path exactly
+    __m128 clip[4];
+    for ( int r = 0; r < 4; r++ ) {
+      clip[r] = _mm_add_ps(
+        _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( m[r] ), x ), _mm_mul_ps( _mm_set1_ps( m[4 + r] ), y ) ), _mm_mul_ps( _mm_set1_ps( m[8 + r] ), z ) ),
+        _mm_set1_ps( m[12 + r] ) );
+    }
+    _mm_storeu_ps( &cx_ptr[i], clip[0] );
+    _mm_storeu_ps( &cy_ptr[i], clip[1] );
+    _mm_storeu_ps( &cz_ptr[i], clip[2] );
+    _mm_storeu_ps( &cw_ptr[i], clip[3] );
+    __m128 half_w = _mm_mul_ps( clip[3], _mm_set1_ps( 0.5f ) ), neg_half_w = _mm_sub_ps( _mm_setzero_ps(), half_w );
+    int planes[6] = {
+      _mm_movemask_ps( _mm_cmplt_ps( clip[0], neg_half_w ) ),                              // left
+      _mm_movemask_ps( _mm_cmpgt_ps( clip[0], half_w ) ),                                  // right
+      _mm_movemask_ps( _mm_cmplt_ps( clip[1], neg_half_w ) ),                              // bottom
+      _mm_movemask_ps( _mm_cmpgt_ps( clip[1], half_w ) ),                                  // top
+      _mm_movemask_ps( _mm_cmplt_ps( clip[2], _mm_sub_ps( _mm_setzero_ps(), clip[3] ) ) ), // near
+      _mm_movemask_ps( _mm_cmpgt_ps( clip[2], clip[3] ) )                                  // far
+    };
+    // perspective divide and viewport, in the same order as _screen_vertex()
+    float sx[4], sy[4], sz[4];
+    _mm_storeu_ps( sx, _mm_add_ps( _mm_mul_ps( _mm_div_ps( clip[0], clip[3] ), _mm_set1_ps( width ) ), _mm_set1_ps( half_width ) ) );
+    _mm_storeu_ps( sy, _mm_add_ps( _mm_mul_ps( _mm_div_ps( clip[1], clip[3] ), _mm_set1_ps( height ) ), _mm_set1_ps( half_height ) ) );
+    _mm_storeu_ps( sz, _mm_sub_ps( _mm_set1_ps( job_ptr->farc ), clip[3] ) );
+    for ( int l = 0; l < 4; l++ ) {
+      uint8_t code = 0;
+      for ( int p = 0; p < 6; p++ ) { code |= ( ( planes[p] >> l ) & 1 ) << p; }
+      outcodes_ptr[i + l] = code;
+      screen_ptr[i + l]   = ( vertex_t ){
+        .pos = ( vec3 ){ .x = sx[l], .y = sy[l], .z = sz[l] }, .w = cw_ptr[i + l], .colour = mesh->colours_ptr[MIN( i + l, mesh->n_vertices - 1 )] };
+    }
+#else
+    for ( int l = i; l < i + 4; l++ ) {
+      vec4 c          = mult_mat4_vec4( job_ptr->PVM, ( vec4 ){ .x = mesh->xs_ptr[l], .y = mesh->ys_ptr[l], .z = mesh->zs_ptr[l], .w = 1.0f } );
+      cx_ptr[l]       = c.x;
+      cy_ptr[l]       = c.y;
+      cz_ptr[l]       = c.z;
+      cw_ptr[l]       = c.w;
+      float half_w    = c.w * 0.5f;
+      outcodes_ptr[l] = ( c.x < -half_w ? OUT_LEFT : 0 ) | ( c.x > half_w ? OUT_RIGHT : 0 ) | ( c.y < -half_w ? OUT_BOTTOM : 0 ) |
+                        ( c.y > half_w ? OUT_TOP : 0 ) | ( c.z < -c.w ? OUT_NEAR : 0 ) | ( c.z > c.w ? OUT_FAR : 0 );
+      screen_ptr[l]   = ( vertex_t ){ .pos = ( vec3 ){ .x = c.x / c.w * width + half_width, .y = c.y / c.w * height + half_height, .z = job_ptr->farc - c.w },
+        .w = c.w, .colour = mesh->colours_ptr[MIN( l, mesh->n_vertices - 1 )] };
+    }
+#endif
+  }
+}
+
+typedef struct clip_vertex_t {
+  float x, y, z, w, r, g, b;
+} clip_vertex_t;
+
+// perspective divide and viewport, as in _transform_range()
+static vertex_t _screen_vertex( const vertex_job_t* job_ptr, clip_vertex_t c ) {
+  vertex_t v;
+  v.pos    = ( vec3 ){ .x = c.x / c.w * job_ptr->width + job_ptr->width / 2, .y = c.y / c.w * job_ptr->height + job_ptr->height / 2, .z = job_ptr->farc - c.w };
+  v.w      = c.w;
+  v.colour = ( rgb_byte_t ){ .r = (uint8_t)c.r, .g = (uint8_t)c.g, .b = (uint8_t)c.b };
+  return v;
+}
+
+// assemble input triangle t into 0, 1, or 2 screen-space triangles. counts only if out_ptr is NULL. sets *clipped_ptr if it crossed the near plane.
+static int _assemble_triangle( const vertex_job_t* job_ptr, int t, vertex_t* out_ptr, bool* clipped_ptr ) {
+  const raster_vertex_stage_t* stage_ptr = job_ptr->stage_ptr;
+  const uint32_t* idx                    = &job_ptr->mesh_ptr->indices_ptr[t * 3];
+  const uint8_t* outcodes_ptr            = stage_ptr->outcodes_ptr;
+  *clipped_ptr                           = false;
+  if ( outcodes_ptr[idx[0]] & outcodes_ptr[idx[1]] & outcodes_ptr[idx[2]] ) { return 0; } // all outside the same plane
+  bool near = ( outcodes_ptr[idx[0]] | outcodes_ptr[idx[1]] | outcodes_ptr[idx[2]] ) & OUT_NEAR;
+  if ( !near ) {
+    // NOTE(Anton) I had to reverse abc winding order because it was rendering inside-out
+    if ( out_ptr ) {
+      for ( int v = 0; v < 3; v++ ) { out_ptr[v] = stage_ptr->screen_ptr[idx[2 - v]]; }
+    }
+    return 1;
+  }
+
+  int cap = stage_ptr->vertex_capacity;
+  clip_vertex_t in[3], poly[4];
+  for ( int v = 0; v < 3; v++ ) {
+    const float* c_ptr    = &stage_ptr->clip_ptr[idx[v]];
+    const rgb_byte_t* rgb = &job_ptr->mesh_ptr->colours_ptr[idx[v]];
+    in[v] = ( clip_vertex_t ){ .x = c_ptr[0], .y = c_ptr[cap], .z = c_ptr[cap * 2], .w = c_ptr[cap * 3], .r = rgb->r, .g = rgb->g, .b = rgb->b };
+  }
+  // Sutherland-Hodgman against the near plane, z >= -w. one vertex in front gives a triangle, two give a quad.
+  int n = 0;
+  for ( int v = 0; v < 3; v++ ) {
+    clip_vertex_t a = in[v], b = in[( v + 1 ) % 3];
+    float da = a.z + a.w, db = b.z + b.w;
+    if ( da >= 0.0f ) { poly[n++] = a; }
+    if ( ( da >= 0.0f ) != ( db >= 0.0f ) ) {
+      float f   = da / ( da - db );
+      poly[n++] = ( clip_vertex_t ){ .x = a.x + ( b.x - a.x ) * f, .y = a.y + ( b.y - a.y ) * f, .z = a.z + ( b.z - a.z ) * f, .w = a.w + ( b.w - a.w ) * f,
+        .r = a.r + ( b.r - a.r ) * f, .g = a.g + ( b.g - a.g ) * f, .b = a.b + ( b.b - a.b ) * f };
+    }
+  }
+  *clipped_ptr = true;
+  if ( out_ptr ) {
+    for ( int k = 1; k < n - 1; k++ ) {
+      out_ptr[( k - 1 ) * 3 + 0] = _screen_vertex( job_ptr, poly[k + 1] );
+      out_ptr[( k - 1 ) * 3 + 1] = _screen_vertex( job_ptr, poly[k] );
+      out_ptr[( k - 1 ) * 3 + 2] = _screen_vertex( job_ptr, poly[0] );
+    }
+  }
+  return MAX( n - 2, 0 );
+}
+
+// pass 1: per chunk of TRANSFORM_GRAIN input triangles, count output, culled, and clipped triangles.
+static void _assemble_count_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const vertex_job_t* job_ptr = (const vertex_job_t*)arg_ptr;
+  for ( int64_t chunk = begin; chunk < end; chunk++ ) {
+    int* counts_ptr = &job_ptr->stage_ptr->chunk_counts_ptr[chunk * 3];
+    int first = (int)chunk * TRANSFORM_GRAIN, last = MIN( first + TRANSFORM_GRAIN, job_ptr->mesh_ptr->n_tris );
+    counts_ptr[0] = counts_ptr[1] = counts_ptr[2] = 0;
+    for ( int t = first; t < last; t++ ) {
+      bool clipped = false;
+      int n        = _assemble_triangle( job_ptr, t, NULL, &clipped );
+      counts_ptr[0] += n;
+      counts_ptr[1] += 0 == n;
+      counts_ptr[2] += clipped;
+    }
+  }
+}
+
+// pass 2: write each chunk's triangles from its start index, so output stays in input order.
+static void _assemble_write_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const vertex_job_t* job_ptr = (const vertex_job_t*)arg_ptr;
+  for ( int64_t chunk = begin; chunk < end; chunk++ ) {
+    int dst   = job_ptr->stage_ptr->chunk_counts_ptr[chunk * 3];
+    int first = (int)chunk * TRANSFORM_GRAIN, last = MIN( first + TRANSFORM_GRAIN, job_ptr->mesh_ptr->n_tris );
+    for ( int t = first; t < last; t++ ) {
+      bool clipped = false;
+      dst += _assemble_triangle( job_ptr, t, &job_ptr->stage_ptr->tris_ptr[dst * 3], &clipped );
+    }
+  }
+}
+
+bool raster_transform_indexed( raster_vertex_stage_t* stage_ptr, const raster_mesh_t* mesh_ptr, mat4 PVM, int width, int height, float farc ) {
+  assert( stage_ptr && mesh_ptr );
+  APG_PROF_BEGIN( "raster_transform_indexed" );
+  int n_vpadded = ( mesh_ptr->n_vertices + 3 ) & ~3;
+  int n_chunks  = MAX( 1, ( mesh_ptr->n_tris + TRANSFORM_GRAIN - 1 ) / TRANSFORM_GRAIN );
+  if ( n_vpadded > stage_ptr->vertex_capacity ) {
+    // the per-vertex arrays share vertex_capacity
+    int n_floats = 0, n_screen = 0, n_outcodes = 0;
+    stage_ptr->vertex_capacity = 0;
+    if ( !_reserve( (void**)&stage_ptr->clip_ptr, &n_floats, n_vpadded * 4, sizeof( float ) ) ||
+         !_reserve( (void**)&stage_ptr->screen_ptr, &n_screen, n_vpadded, sizeof( vertex_t ) ) ||
+         !_reserve( (void**)&stage_ptr->outcodes_ptr, &n_outcodes, n_vpadded, 1 ) ) {
+      APG_PROF_END();
+      return false;
+    }
+    stage_ptr->vertex_capacity = n_vpadded;
+  }
+  if ( !_reserve( (void**)&stage_ptr->chunk_counts_ptr, &stage_ptr->chunk_counts_capacity, n_chunks * 3, sizeof( int ) ) ) {
+    APG_PROF_END();
+    return false;
+  }
+  vertex_job_t job = ( vertex_job_t ){ .stage_ptr = stage_ptr, .mesh_ptr = mesh_ptr, .PVM = PVM, .width = width, .height = height, .farc = farc };
+
+  APG_PROF_BEGIN( "vertices" );
+  apg_jobs_parallel_for( 0, n_vpadded / 4, TRANSFORM_GRAIN / 4, _transform_vertices_range, &job );
+  APG_PROF_END();
+
+  APG_PROF_BEGIN( "assemble" );
+  apg_jobs_parallel_for( 0, n_chunks, 1, _assemble_count_range, &job );
+  int total = 0;
+  stage_ptr->n_tris_culled = stage_ptr->n_tris_clipped = 0;
+  for ( int chunk = 0; chunk < n_chunks; chunk++ ) {
+    int* counts_ptr = &stage_ptr->chunk_counts_ptr[chunk * 3];
+    int count       = counts_ptr[0];
+    counts_ptr[0]   = total;
+    total += count;
+    stage_ptr->n_tris_culled += counts_ptr[1];
+    stage_ptr->n_tris_clipped += counts_ptr[2];
+  }
+  if ( !_reserve( (void**)&stage_ptr->tris_ptr, &stage_ptr->tris_capacity, MAX( total, 1 ) * 3, sizeof( vertex_t ) ) ) {
+    APG_PROF_END();
+    APG_PROF_END();
+    return false;
+  }
+  apg_jobs_parallel_for( 0, n_chunks, 1, _assemble_write_range, &job );
+  stage_ptr->n_tris = total;
+  APG_PROF_END();
+
+  APG_PROF_END();
+  return true;
+}
+
+void raster_vertex_stage_free( raster_vertex_stage_t* stage_ptr ) {
+  if ( !stage_ptr ) { return; }
+  free( stage_ptr->clip_ptr );
+  free( stage_ptr->screen_ptr );
+  free( stage_ptr->outcodes_ptr );
+  free( stage_ptr->chunk_counts_ptr );
+  free( stage_ptr->tris_ptr );
+  *stage_ptr = ( raster_vertex_stage_t ){ .n_tris = 0 };
+}
+
+/*=================================================================================================
+SERIAL RASTER
+=================================================================================================*/
+// triangle bounds, clipped to the target. max < min if the triangle is off-screen.
+static void _triangle_bounds( const vertex_t* a, const vertex_t* b, const vertex_t* c, int width, int height, int* bounds_ptr ) {
+  bounds_ptr[0] = MAX( MIN( a->pos.x, MIN( b->pos.x, c->pos.x ) ), 0 );
+  bounds_ptr[1] = MAX( MIN( a->pos.y, MIN( b->pos.y, c->pos.y ) ), 0 );
+  bounds_ptr[2] = MIN( MAX( a->pos.x, MAX( b->pos.x, c->pos.x ) ), width - 1 );
+  bounds_ptr[3] = MIN( MAX( a->pos.y, MAX( b->pos.y, c->pos.y ) ), height - 1 );
+}
+
+// fill the part of a triangle inside [min_x,max_x]x[min_y,max_y] into buffers whose top-left pixel is at (origin_x,origin_y), with `stride` pixels per row.
+// pixel coordinates are always screen-space, so the result for a pixel doesn't depend on which buffer it lands in.
+// described here: https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/rasterization-stage
+// returns true if any pixel was written.
+static bool _fill_triangle_rect( const vertex_t* a, const vertex_t* b, const vertex_t* c, int min_x, int min_y, int max_x, int max_y, uint8_t* image_ptr,
+  float* depth_ptr, int origin_x, int origin_y, int stride, int n_channels ) {
+  bool wrote = false;
+  for ( int y = min_y; y <= max_y; y++ ) {
+    for ( int x = min_x; x <= max_x; x++ ) {
+      // try barycentric instead of edge test for rasterising triangles. code for this function is in apg_maths.h
+      vec3 bary = barycentric(
+        ( vec2 ){ .x = x, .y = y }, ( vec2 ){ .x = a->pos.x, .y = a->pos.y }, ( vec2 ){ .x = b->pos.x, .y = b->pos.y }, ( vec2 ){ .x = c->pos.x, .y = c->pos.y } );
+      // written so that a zero-area triangle's NaN weights fail it too, rather than writing NaN depth over its bounds.
+      if ( !( bary.x >= 0 && bary.x < 1 && bary.y >= 0 && bary.y < 1 && bary.z >= 0 && bary.z < 1 ) ) { continue; }
+
+      int idx      = stride * ( y - origin_y ) + ( x - origin_x );
+      float depthf = ( a->pos.z * bary.x + b->pos.z * bary.y + c->pos.z * bary.z );
+      if ( depthf <= depth_ptr[idx] ) { continue; } // failed depth test
+      depth_ptr[idx] = depthf;
+      wrote          = true;
+
+      float red                       = ( a->colour.r * bary.x + b->colour.r * bary.y + c->colour.r * bary.z );
+      float green                     = ( a->colour.g * bary.x + b->colour.g * bary.y + c->colour.g * bary.z );
+      float blue                      = ( a->colour.b * bary.x + b->colour.b * bary.y + c->colour.b * bary.z );
+      image_ptr[idx * n_channels + 0] = (uint8_t)red;
+      image_ptr[idx * n_channels + 1] = (uint8_t)green;
+      image_ptr[idx * n_channels + 2] = (uint8_t)blue;
+    }
+  }
+  return wrote;
+}
+
+void raster_fill_triangle( vertex_t a, vertex_t b, vertex_t c, raster_target_t target ) {
+  assert( target.image_ptr && target.depth_ptr );
+  int bounds[4];
+  _triangle_bounds( &a, &b, &c, target.width, target.height, bounds );
+  _fill_triangle_rect( &a, &b, &c, bounds[0], bounds[1], bounds[2], bounds[3], target.image_ptr, target.depth_ptr, 0, 0, target.width, target.n_channels );
+}
+
+void raster_draw_serial( const vertex_t* tris_ptr, int n_tris, raster_target_t target ) {
+  assert( tris_ptr );
+  APG_PROF_BEGIN( "raster_draw_serial" );
+  for ( int t = 0; t < n_tris; t++ ) { raster_fill_triangle( tris_ptr[t * 3 + 0], tris_ptr[t * 3 + 1], tris_ptr[t * 3 + 2], target ); }
+  APG_PROF_END();
+}
+
+/*=================================================================================================
+HIERARCHICAL Z
+=================================================================================================*/
+#define HIZ_CELLS ( RASTER_TILE_SZ / BLOCK_SZ )
+
+// coarse depth for one tile in tile memory, with RASTER_TILE_SZ pixels per row.
+typedef struct hiz_t {
+  float zmin[HIZ_CELLS * HIZ_CELLS]; // per 8x8 block: the farthest stored depth. nothing that isn't nearer than this can pass the depth test.
+  uint64_t dirty;                    // one bit per cell written since its zmin was last computed. rescanned only when next tested.
+  const float* depth_ptr;            // the tile's depth memory.
+  int tile_w, tile_h;                // pixels of the tile inside the target. the rest of tile memory is stale and ignored.
+  int n_tris_rejected, n_blocks_tested, n_blocks_rejected;
+} hiz_t;
+
+static float _hiz_cell_zmin( hiz_t* hiz_ptr, int cx, int cy ) {
+  int cell = cy * HIZ_CELLS + cx;
+  if ( !( hiz_ptr->dirty & ( 1ull << cell ) ) ) { return hiz_ptr->zmin[cell]; }
+  hiz_ptr->dirty &= ~( 1ull << cell );
+  float zmin = FLT_MAX;
+  int x0 = cx * BLOCK_SZ, y0 = cy * BLOCK_SZ;
+#ifdef RASTER_SSE2
+  if ( x0 + BLOCK_SZ <= hiz_ptr->tile_w && y0 + BLOCK_SZ <= hiz_ptr->tile_h ) {
+    __m128 zmin4 = _mm_set1_ps( FLT_MAX );
+    for ( int y = y0; y < y0 + BLOCK_SZ; y++ ) {
+      const float* row_ptr = &hiz_ptr->depth_ptr[y * RASTER_TILE_SZ + x0];
+      zmin4                = _mm_min_ps( zmin4, _mm_min_ps( _mm_loadu_ps( row_ptr ), _mm_loadu_ps( row_ptr + 4 ) ) );
+    }
+    zmin4 = _mm_min_ps( zmin4, _mm_shuffle_ps( zmin4, zmin4, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    zmin4 = _mm_min_ps( zmin4, _mm_shuffle_ps( zmin4, zmin4, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    return hiz_ptr->zmin[cell] = _mm_cvtss_f32( zmin4 );
+  }
+#endif
+  for ( int y = y0; y < MIN( y0 + BLOCK_SZ, hiz_ptr->tile_h ); y++ ) {
+    for ( int x = x0; x < MIN( x0 + BLOCK_SZ, hiz_ptr->tile_w ); x++ ) { zmin = MIN( zmin, hiz_ptr->depth_ptr[y * RASTER_TILE_SZ + x] ); }
+  }
+  return hiz_ptr->zmin[cell] = zmin;
+}
+
+// mark the cells under a tile-relative pixel rect as written
+static void _hiz_touch_rect( hiz_t* hiz_ptr, int min_x, int min_y, int max_x, int max_y ) {
+  for ( int cy = min_y / BLOCK_SZ; cy <= max_y / BLOCK_SZ; cy++ ) {
+    for ( int cx = min_x / BLOCK_SZ; cx <= max_x / BLOCK_SZ; cx++ ) { hiz_ptr->dirty |= 1ull << ( cy * HIZ_CELLS + cx ); }
+  }
+}
+
+// stops early once a cell is known to be nearer than zmax, since the caller only needs to know whether zmax is hidden.
+static float _hiz_rect_zmin( hiz_t* hiz_ptr, float zmax, int min_x, int min_y, int max_x, int max_y ) {
+  float zmin = FLT_MAX;
+  for ( int cy = min_y / BLOCK_SZ; cy <= max_y / BLOCK_SZ; cy++ ) {
+    for ( int cx = min_x / BLOCK_SZ; cx <= max_x / BLOCK_SZ; cx++ ) {
+      zmin = MIN( zmin, _hiz_cell_zmin( hiz_ptr, cx, cy ) );
+      if ( zmin <= zmax ) { return zmin; }
+    }
+  }
+  return zmin;
+}
+
+// true if nothing at or behind depth zmax can pass against zmin. each core rounds interpolated depth a little differently,
+// so zmax gets some slack rather than trusting it to the last bit.
+static bool _hiz_hidden( float zmax, float zmin ) { return zmax + fabsf( zmax ) * 1e-5f + 1e-6f <= zmin; }
+
+/*=================================================================================================
+EDGE-FUNCTION RASTER
+=================================================================================================*/
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE ( 1 << SUBPIXEL_BITS )
+#define GUARD_BAND_PX 16384.0f  // keeps fixed-point edge coefficients within 20 bits.
+#define EDGE_CLAMP ( 1 << 30 )  // more than an 8x8 block can step an edge value, so clamping never changes a sign inside a block.
+
+typedef enum setup_mode_t { SETUP_EDGE = 0, SETUP_CULLED, SETUP_REFERENCE } setup_mode_t;
+
+typedef struct raster_setup_t {
+  int32_t edge_a[3], edge_b[3]; // E(x,y) = a*x + b*y + c over 28.4 fixed-point x,y. >= 0 is inside. edge i is opposite vertex i.
+  int64_t edge_c[3];            // includes the fill-rule bias.
+  float plane[4][3];            // 1/w, r/w, g/w, b/w: value at (x0,y0), d/dx, d/dy.
+  float x0, y0;                 // snapped position of vertex 0, where the planes are anchored.
+  float depth_bias;             // the transform stores depth as farc - w, so depth = depth_bias - w.
+  setup_mode_t mode;
+} raster_setup_t;
+
+static void _setup_edge( const vertex_t* tri_ptr, raster_setup_t* s ) {
+  const vertex_t* v[3] = { &tri_ptr[0], &tri_ptr[1], &tri_ptr[2] };
+  int64_t x[3], y[3];
+  for ( int i = 0; i < 3; i++ ) {
+    if ( !( v[i]->w > 0.0f ) || !( fabsf( v[i]->pos.x ) < GUARD_BAND_PX ) || !( fabsf( v[i]->pos.y ) < GUARD_BAND_PX ) ) {
+      s->mode = SETUP_REFERENCE;
+      return;
+    }
+    x[i] = lrintf( v[i]->pos.x * SUBPIXEL_ONE );
+    y[i] = lrintf( v[i]->pos.y * SUBPIXEL_ONE );
+  }
+  int64_t area = ( x[2] - x[1] ) * ( y[0] - y[1] ) - ( y[2] - y[1] ) * ( x[0] - x[1] );
+  if ( 0 == area ) {
+    s->mode = SETUP_CULLED;
+    return;
+  }
+  // both windings are drawn, like the barycentric core. flip to positive area.
+  if ( area < 0 ) {
+    const vertex_t* tmp_ptr = v[1];
+    int64_t tx = x[1], ty = y[1];
+    v[1] = v[2], x[1] = x[2], y[1] = y[2];
+    v[2] = tmp_ptr, x[2] = tx, y[2] = ty;
+    area = -area;
+  }
+  for ( int i = 0; i < 3; i++ ) {
+    int p = ( i + 1 ) % 3, q = ( i + 2 ) % 3;
+    int64_t a = y[p] - y[q], b = x[q] - x[p];
+    // top-left style tie break: of two triangles sharing an edge exactly one owns it, because the neighbour sees (-a,-b).
+    bool owns      = a > 0 || ( 0 == a && b > 0 );
+    s->edge_a[i]   = (int32_t)a;
+    s->edge_b[i]   = (int32_t)b;
+    s->edge_c[i]   = -( a * x[p] + b * y[p] ) - ( owns ? 0 : 1 );
+  }
+
+  // attribute planes in double, over the snapped positions the edges use
+  double fx[3], fy[3], attr[3][4];
+  for ( int i = 0; i < 3; i++ ) {
+    fx[i]      = (double)x[i] / SUBPIXEL_ONE;
+    fy[i]      = (double)y[i] / SUBPIXEL_ONE;
+    attr[i][0] = 1.0 / v[i]->w;
+    attr[i][1] = v[i]->colour.r * attr[i][0];
+    attr[i][2] = v[i]->colour.g * attr[i][0];
+    attr[i][3] = v[i]->colour.b * attr[i][0];
+  }
+  double dx1 = fx[1] - fx[0], dy1 = fy[1] - fy[0], dx2 = fx[2] - fx[0], dy2 = fy[2] - fy[0];
+  double inv_det = 1.0 / ( dx1 * dy2 - dx2 * dy1 );
+  for ( int j = 0; j < 4; j++ ) {
+    double d1      = attr[1][j] - attr[0][j], d2 = attr[2][j] - attr[0][j];
+    s->plane[j][0] = (float)attr[0][j];
+    s->plane[j][1] = (float)( ( d1 * dy2 - d2 * dy1 ) * inv_det );
+    s->plane[j][2] = (float)( ( d2 * dx1 - d1 * dx2 ) * inv_det );
+  }
+  s->x0         = (float)fx[0];
+  s->y0         = (float)fy[0];
+  s->depth_bias = v[0]->pos.z + v[0]->w;
+  s->mode       = SETUP_EDGE;
+}
+
+// shade one 8x8 block whose top-left pixel is (bx,by). e holds the edge values there. pixels outside [min_x,max_x]x[min_y,max_y] are masked out.
+// if test_edges is false the block is entirely inside the triangle and only depth is tested. returns true if any pixel was written.
+static bool _fill_block( const raster_setup_t* s, const int32_t* e, bool test_edges, int bx, int by, int min_x, int min_y, int max_x, int max_y,
+  uint8_t* image_ptr, float* depth_ptr, int origin_x, int origin_y, int stride, int n_channels ) {
+  float f_row[4]; // plane values at the block's top-left pixel
+  for ( int j = 0; j < 4; j++ ) { f_row[j] = s->plane[j][0] + s->plane[j][1] * ( bx - s->x0 ) + s->plane[j][2] * ( by - s->y0 ); }
+  int32_t step_x[3], step_y[3];
+  for ( int i = 0; i < 3; i++ ) {
+    step_x[i] = s->edge_a[i] * SUBPIXEL_ONE;
+    step_y[i] = s->edge_b[i] * SUBPIXEL_ONE;
+  }
+  int y_first = MAX( by, min_y ), y_last = MIN( by + BLOCK_SZ - 1, max_y );
+  bool wrote  = false;
+
+#ifdef RASTER_SSE2
+  const __m128 lanef  = _mm_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f );
+  const __m128 one    = _mm_set1_ps( 1.0f );
+  const __m128 zero   = _mm_setzero_ps();
+  const __m128 max255 = _mm_set1_ps( 255.0f );
+  const __m128 bias   = _mm_set1_ps( s->depth_bias );
+  __m128i e_row[3], e_step_x4[3], e_step_y[3];
+  __m128 f_vec[4], f_step_x4[4], f_step_y[4];
+  for ( int i = 0; i < 3; i++ ) {
+    e_row[i]     = _mm_setr_epi32( e[i], e[i] + step_x[i], e[i] + 2 * step_x[i], e[i] + 3 * step_x[i] );
+    e_step_x4[i] = _mm_set1_epi32( 4 * step_x[i] );
+    e_step_y[i]  = _mm_set1_epi32( step_y[i] );
+  }
+  for ( int j = 0; j < 4; j++ ) {
+    f_vec[j]     = _mm_add_ps( _mm_set1_ps( f_row[j] ), _mm_mul_ps( lanef, _mm_set1_ps( s->plane[j][1] ) ) );
+    f_step_x4[j] = _mm_set1_ps( 4.0f * s->plane[j][1] );
+    f_step_y[j]  = _mm_set1_ps( s->plane[j][2] );
+  }
+  // columns inside the clip rect, per group of 4
+  __m128i col_mask[BLOCK_SZ / 4];
+  for ( int g = 0; g < BLOCK_SZ / 4; g++ ) {
+    __m128i x   = _mm_add_epi32( _mm_set1_epi32( bx + g * 4 ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+    __m128i out = _mm_or_si128( _mm_cmplt_epi32( x, _mm_set1_epi32( min_x ) ), _mm_cmpgt_epi32( x, _mm_set1_epi32( max_x ) ) );
+    col_mask[g] = _mm_andnot_si128( out, _mm_set1_epi32( -1 ) );
+  }
+
+  for ( int y = by; y <= y_last; y++ ) {
+    if ( y >= y_first ) {
+      __m128i e0 = e_row[0], e1 = e_row[1], e2 = e_row[2];
+      __m128 inv_w = f_vec[0], rw = f_vec[1], gw = f_vec[2], bw = f_vec[3];
+      for ( int g = 0; g < BLOCK_SZ / 4; g++ ) {
+        __m128i mask = col_mask[g];
+        if ( test_edges ) { mask = _mm_and_si128( mask, _mm_cmpgt_epi32( _mm_or_si128( _mm_or_si128( e0, e1 ), e2 ), _mm_set1_epi32( -1 ) ) ); }
+        if ( _mm_movemask_epi8( mask ) ) {
+          int idx       = stride * ( y - origin_y ) + ( bx + g * 4 - origin_x );
+          __m128 w      = _mm_div_ps( one, inv_w );
+          __m128 depth  = _mm_sub_ps( bias, w );
+          __m128 stored = _mm_loadu_ps( &depth_ptr[idx] );
+          __m128 pass   = _mm_and_ps( _mm_cmpgt_ps( depth, stored ), _mm_castsi128_ps( mask ) );
+          int bits      = _mm_movemask_ps( pass );
+          if ( bits ) {
+            wrote = true;
+            _mm_storeu_ps( &depth_ptr[idx], _mm_or_ps( _mm_and_ps( pass, depth ), _mm_andnot_ps( pass, stored ) ) );
+            int32_t rgb[3][4];
+            _mm_storeu_si128( (__m128i*)rgb[0], _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( rw, w ), zero ), max255 ) ) );
+            _mm_storeu_si128( (__m128i*)rgb[1], _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( gw, w ), zero ), max255 ) ) );
+            _mm_storeu_si128( (__m128i*)rgb[2], _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( bw, w ), zero ), max255 ) ) );
+            for ( int l = 0; l < 4; l++ ) {
+              if ( !( bits & ( 1 << l ) ) ) { continue; }
+              image_ptr[( idx + l ) * n_channels + 0] = (uint8_t)rgb[0][l];
+              image_ptr[( idx + l ) * n_channels + 1] = (uint8_t)rgb[1][l];
+              image_ptr[( idx + l ) * n_channels + 2] = (uint8_t)rgb[2][l];
+            }
+          }
+        }
+        e0    = _mm_add_epi32( e0, e_step_x4[0] );
+        e1    = _mm_add_epi32( e1, e_step_x4[1] );
+        e2    = _mm_add_epi32( e2, e_step_x4[2] );
+        inv_w = _mm_add_ps( inv_w, f_step_x4[0] );
+        rw    = _mm_add_ps( rw, f_step_x4[1] );
+        gw    = _mm_add_ps( gw, f_step_x4[2] );
+        bw    = _mm_add_ps( bw, f_step_x4[3] );
+      }
+    }
+    for ( int i = 0; i < 3; i++ ) { e_row[i] = _mm_add_epi32( e_row[i], e_step_y[i] ); }
+    for ( int j = 0; j < 4; j++ ) { f_vec[j] = _mm_add_ps( f_vec[j], f_step_y[j] ); }
+  }
+#else
+  int32_t e_row[3] = { e[0], e[1], e[2] };
+  for ( int y = by; y <= y_last; y++ ) {
+    if ( y >= y_first ) {
+      int32_t e0 = e_row[0], e1 = e_row[1], e2 = e_row[2];
+      float inv_w = f_row[0], rw = f_row[1], gw = f_row[2], bw = f_row[3];
+      for ( int x = bx; x < bx + BLOCK_SZ; x++ ) {
+        if ( x >= min_x && x <= max_x && ( !test_edges || ( e0 | e1 | e2 ) >= 0 ) ) {
+          int idx      = stride * ( y - origin_y ) + ( x - origin_x );
+          float w      = 1.0f / inv_w;
+          float depthf = s->depth_bias - w;
+          if ( depthf > depth_ptr[idx] ) {
+            wrote                           = true;
+            depth_ptr[idx]                  = depthf;
+            image_ptr[idx * n_channels + 0] = (uint8_t)MIN( MAX( rw * w, 0.0f ), 255.0f );
+            image_ptr[idx * n_channels + 1] = (uint8_t)MIN( MAX( gw * w, 0.0f ), 255.0f );
+            image_ptr[idx * n_channels + 2] = (uint8_t)MIN( MAX( bw * w, 0.0f ), 255.0f );
+          }
+        }
+        e0 += step_x[0], e1 += step_x[1], e2 += step_x[2];
+        inv_w += s->plane[0][1], rw += s->plane[1][1], gw += s->plane[2][1], bw += s->plane[3][1];
+      }
+    }
+    for ( int i = 0; i < 3; i++ ) { e_row[i] += step_y[i]; }
+    for ( int j = 0; j < 4; j++ ) { f_row[j] += s->plane[j][2]; }
+  }
+#endif
+  return wrote;
+}
+
+// fill the part of a set-up triangle inside [min_x,max_x]x[min_y,max_y], block by block. blocks are aligned to (origin_x,origin_y),
+// and whole groups of 4 pixels are loaded and stored, so the buffer's width must be a multiple of BLOCK_SZ.
+// if hiz_ptr is given, the buffer is a tile, and blocks that can't get nearer than zmax, the triangle's nearest depth, are skipped.
+static void _fill_triangle_edge( const raster_setup_t* s, float zmax, hiz_t* hiz_ptr, int min_x, int min_y, int max_x, int max_y, uint8_t* image_ptr,
+  float* depth_ptr, int origin_x, int origin_y, int stride, int n_channels ) {
+  assert( stride % BLOCK_SZ == 0 && ( !hiz_ptr || RASTER_TILE_SZ == stride ) );
+  for ( int by = origin_y + ( ( min_y - origin_y ) & ~( BLOCK_SZ - 1 ) ); by <= max_y; by += BLOCK_SZ ) {
+    for ( int bx = origin_x + ( ( min_x - origin_x ) & ~( BLOCK_SZ - 1 ) ); bx <= max_x; bx += BLOCK_SZ ) {
+      int32_t e[3];
+      bool inside = true, outside = false;
+      for ( int i = 0; i < 3; i++ ) {
+        int64_t e64 = (int64_t)s->edge_a[i] * ( bx * SUBPIXEL_ONE ) + (int64_t)s->edge_b[i] * ( by * SUBPIXEL_ONE ) + s->edge_c[i];
+        e[i]        = (int32_t)MAX( MIN( e64, EDGE_CLAMP ), -EDGE_CLAMP );
+        // the edge is linear, so its extremes over the block are at corners
+        int32_t dx = s->edge_a[i] * SUBPIXEL_ONE * ( BLOCK_SZ - 1 ), dy = s->edge_b[i] * SUBPIXEL_ONE * ( BLOCK_SZ - 1 );
+        if ( e[i] + MAX( dx, 0 ) + MAX( dy, 0 ) < 0 ) { outside = true; }
+        if ( e[i] + MIN( dx, 0 ) + MIN( dy, 0 ) < 0 ) { inside = false; }
+      }
+      if ( outside ) { continue; }
+      if ( !hiz_ptr ) {
+        _fill_block( s, e, !inside, bx, by, min_x, min_y, max_x, max_y, image_ptr, depth_ptr, origin_x, origin_y, stride, n_channels );
+        continue;
+      }
+      // 1/w is linear in screen space, so its largest value over the block, the nearest depth, is at a corner
+      int cx = ( bx - origin_x ) / BLOCK_SZ, cy = ( by - origin_y ) / BLOCK_SZ;
+      float inv_w_max = s->plane[0][0] + s->plane[0][1] * ( bx - s->x0 ) + s->plane[0][2] * ( by - s->y0 ) + MAX( s->plane[0][1] * ( BLOCK_SZ - 1 ), 0.0f ) +
+                        MAX( s->plane[0][2] * ( BLOCK_SZ - 1 ), 0.0f );
+      float block_zmax = inv_w_max > 0.0f ? MIN( zmax, s->depth_bias - 1.0f / inv_w_max ) : zmax;
+      hiz_ptr->n_blocks_tested++;
+      if ( _hiz_hidden( block_zmax, _hiz_cell_zmin( hiz_ptr, cx, cy ) ) ) {
+        hiz_ptr->n_blocks_rejected++;
+        continue;
+      }
+      if ( _fill_block( s, e, !inside, bx, by, min_x, min_y, max_x, max_y, image_ptr, depth_ptr, origin_x, origin_y, stride, n_channels ) ) {
+        hiz_ptr->dirty |= 1ull << ( cy * HIZ_CELLS + cx );
+      }
+    }
+  }
+}
+
+/*=================================================================================================
+BINNED RASTER
+=================================================================================================*/
+typedef struct bin_job_t {
+  raster_binner_t* binner_ptr;
+  const vertex_t* tris_ptr;
+  int n_tris, n_chunks, n_tiles_x, n_tiles_y;
+  int max_tile_tris; // longest tile list, for sort keys.
+  raster_target_t target;
+} bin_job_t;
+
+static void _setup_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const bin_job_t* job_ptr = (const bin_job_t*)arg_ptr;
+  for ( int64_t t = begin; t < end; t++ ) {
+    const vertex_t* v = &job_ptr->tris_ptr[t * 3];
+    int* b            = &job_ptr->binner_ptr->bounds_ptr[t * 4];
+    _triangle_bounds( &v[0], &v[1], &v[2], job_ptr->target.width, job_ptr->target.height, b );
+    if ( job_ptr->binner_ptr->use_hiz || job_ptr->binner_ptr->sort_front_to_back ) {
+      job_ptr->binner_ptr->zmax_ptr[t] = MAX( v[0].pos.z, MAX( v[1].pos.z, v[2].pos.z ) );
+    }
+    if ( RASTER_CORE_EDGE != job_ptr->binner_ptr->core ) { continue; }
+    raster_setup_t* s_ptr = &job_ptr->binner_ptr->setups_ptr[t];
+    _setup_edge( v, s_ptr );
+    if ( SETUP_CULLED == s_ptr->mode ) { b[2] = b[0] - 1; } // keep it out of every bin
+  }
+}
+
+// pass 1: count triangles per tile for each chunk. bin_offsets_ptr is tile-major, so a tile's chunks sit next to each other.
+static void _bin_count_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const bin_job_t* job_ptr = (const bin_job_t*)arg_ptr;
+  int* offsets_ptr         = job_ptr->binner_ptr->bin_offsets_ptr;
+  for ( int64_t chunk = begin; chunk < end; chunk++ ) {
+    int first = (int)chunk * BIN_CHUNK_TRIS, last = MIN( first + BIN_CHUNK_TRIS, job_ptr->n_tris );
+    for ( int t = first; t < last; t++ ) {
+      const int* b = &job_ptr->binner_ptr->bounds_ptr[t * 4];
+      if ( b[2] < b[0] || b[3] < b[1] ) { continue; }
+      for ( int ty = b[1] / RASTER_TILE_SZ; ty <= b[3] / RASTER_TILE_SZ; ty++ ) {
+        for ( int tx = b[0] / RASTER_TILE_SZ; tx <= b[2] / RASTER_TILE_SZ; tx++ ) { offsets_ptr[( ty * job_ptr->n_tiles_x + tx ) * job_ptr->n_chunks + chunk]++; }
+      }
+    }
+  }
+}
+
+// pass 2: write triangle indices. each (tile, chunk) pair owns a disjoint range, so chunks don't contend.
+static void _bin_write_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const bin_job_t* job_ptr = (const bin_job_t*)arg_ptr;
+  int* offsets_ptr         = job_ptr->binner_ptr->bin_offsets_ptr;
+  int* tri_idxs_ptr        = job_ptr->binner_ptr->tri_idxs_ptr;
+  for ( int64_t chunk = begin; chunk < end; chunk++ ) {
+    int first = (int)chunk * BIN_CHUNK_TRIS, last = MIN( first + BIN_CHUNK_TRIS, job_ptr->n_tris );
+    for ( int t = first; t < last; t++ ) {
+      const int* b = &job_ptr->binner_ptr->bounds_ptr[t * 4];
+      if ( b[2] < b[0] || b[3] < b[1] ) { continue; }
+      for ( int ty = b[1] / RASTER_TILE_SZ; ty <= b[3] / RASTER_TILE_SZ; ty++ ) {
+        for ( int tx = b[0] / RASTER_TILE_SZ; tx <= b[2] / RASTER_TILE_SZ; tx++ ) {
+          tri_idxs_ptr[offsets_ptr[( ty * job_ptr->n_tiles_x + tx ) * job_ptr->n_chunks + chunk]++] = t;
+        }
+      }
+    }
+  }
+}
+
+typedef struct sort_key_t {
+  float zmax;
+  int t;
+} sort_key_t;
+
+// nearest first. ties keep submission order, so the result doesn't depend on the sort algorithm.
+static int _cmp_front_to_back( const void* a_ptr, const void* b_ptr ) {
+  const sort_key_t *a = (const sort_key_t*)a_ptr, *b = (const sort_key_t*)b_ptr;
+  if ( a->zmax != b->zmax ) { return a->zmax > b->zmax ? -1 : 1; }
+  return a->t - b->t;
+}
+
+static void _raster_tile_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const bin_job_t* job_ptr       = (const bin_job_t*)arg_ptr;
+  const raster_binner_t* bin_ptr = job_ptr->binner_ptr;
+  raster_target_t target         = job_ptr->target;
+  int n_channels                 = target.n_channels;
+
+  int thread_idx          = MAX( apg_jobs_thread_idx(), 0 );
+  uint8_t* tile_image_ptr = &bin_ptr->tile_mem_ptr[(size_t)thread_idx * RASTER_TILE_SZ * RASTER_TILE_SZ * ( n_channels + sizeof( float ) )];
+  float* tile_depth_ptr   = (float*)&tile_image_ptr[RASTER_TILE_SZ * RASTER_TILE_SZ * n_channels];
+  sort_key_t* keys_ptr    = bin_ptr->sort_front_to_back ? &( (sort_key_t*)bin_ptr->sort_mem_ptr )[(size_t)thread_idx * job_ptr->max_tile_tris] : NULL;
+  hiz_t hiz;
+
+  for ( int64_t tile = begin; tile < end; tile++ ) {
+    int start = bin_ptr->tile_starts_ptr[tile], stop = bin_ptr->tile_starts_ptr[tile + 1];
+    if ( start == stop ) { continue; }
+    int tile_x = (int)( tile % job_ptr->n_tiles_x ) * RASTER_TILE_SZ, tile_y = (int)( tile / job_ptr->n_tiles_x ) * RASTER_TILE_SZ;
+    int tile_w = MIN( RASTER_TILE_SZ, target.width - tile_x ), tile_h = MIN( RASTER_TILE_SZ, target.height - tile_y );
+
+    // load the tile so drawing over an existing image behaves the same as the serial path
+    for ( int y = 0; y < tile_h; y++ ) {
+      size_t src = (size_t)( tile_y + y ) * target.width + tile_x;
+      memcpy( &tile_image_ptr[y * RASTER_TILE_SZ * n_channels], &target.image_ptr[src * n_channels], tile_w * n_channels );
+      memcpy( &tile_depth_ptr[y * RASTER_TILE_SZ], &target.depth_ptr[src], tile_w * sizeof( float ) );
+    }
+    if ( keys_ptr ) {
+      for ( int i = start; i < stop; i++ ) {
+        int t               = bin_ptr->tri_idxs_ptr[i];
+        keys_ptr[i - start] = ( sort_key_t ){ .zmax = bin_ptr->zmax_ptr[t], .t = t };
+      }
+      qsort( keys_ptr, stop - start, sizeof( sort_key_t ), _cmp_front_to_back );
+      for ( int i = start; i < stop; i++ ) { bin_ptr->tri_idxs_ptr[i] = keys_ptr[i - start].t; }
+    }
+    hiz_t* hiz_ptr = NULL;
+    if ( bin_ptr->use_hiz ) {
+      hiz     = ( hiz_t ){ .dirty = ~0ull, .depth_ptr = tile_depth_ptr, .tile_w = tile_w, .tile_h = tile_h };
+      hiz_ptr = &hiz;
+    }
+    for ( int i = start; i < stop; i++ ) {
+      int t             = bin_ptr->tri_idxs_ptr[i];
+      const int* b      = &bin_ptr->bounds_ptr[t * 4];
+      const vertex_t* v = &job_ptr->tris_ptr[t * 3];
+      float zmax        = hiz_ptr ? bin_ptr->zmax_ptr[t] : 0.0f;
+      int min_x = MAX( b[0], tile_x ), min_y = MAX( b[1], tile_y ), max_x = MIN( b[2], tile_x + tile_w - 1 ), max_y = MIN( b[3], tile_y + tile_h - 1 );
+      if ( hiz_ptr && _hiz_hidden( zmax, _hiz_rect_zmin( hiz_ptr, zmax, min_x - tile_x, min_y - tile_y, max_x - tile_x, max_y - tile_y ) ) ) {
+        hiz.n_tris_rejected++;
+        continue;
+      }
+      if ( RASTER_CORE_EDGE == bin_ptr->core && SETUP_EDGE == bin_ptr->setups_ptr[t].mode ) {
+        _fill_triangle_edge(
+          &bin_ptr->setups_ptr[t], zmax, hiz_ptr, min_x, min_y, max_x, max_y, tile_image_ptr, tile_depth_ptr, tile_x, tile_y, RASTER_TILE_SZ, n_channels );
+      } else if ( _fill_triangle_rect( &v[0], &v[1], &v[2], min_x, min_y, max_x, max_y, tile_image_ptr, tile_depth_ptr, tile_x, tile_y, RASTER_TILE_SZ,
+                    n_channels ) &&
+                  hiz_ptr ) {
+        _hiz_touch_rect( hiz_ptr, min_x - tile_x, min_y - tile_y, max_x - tile_x, max_y - tile_y );
+      }
+    }
+    if ( hiz_ptr ) {
+      int* stats_ptr = &bin_ptr->tile_stats_ptr[tile * 3];
+      stats_ptr[0]   = hiz.n_tris_rejected;
+      stats_ptr[1]   = hiz.n_blocks_tested;
+      stats_ptr[2]   = hiz.n_blocks_rejected;
+    }
+    for ( int y = 0; y < tile_h; y++ ) {
+      size_t dst = (size_t)( tile_y + y ) * target.width + tile_x;
+      memcpy( &target.image_ptr[dst * n_channels], &tile_image_ptr[y * RASTER_TILE_SZ * n_channels], tile_w * n_channels );
+      memcpy( &target.depth_ptr[dst], &tile_depth_ptr[y * RASTER_TILE_SZ], tile_w * sizeof( float ) );
+    }
+  }
+}
+
+bool raster_draw_binned( raster_binner_t* binner_ptr, const vertex_t* tris_ptr, int n_tris, raster_target_t target ) {
+  assert( binner_ptr && tris_ptr && target.image_ptr && target.depth_ptr );
+  APG_PROF_BEGIN( "raster_draw_binned" );
+  bin_job_t job   = ( bin_job_t ){ .binner_ptr = binner_ptr, .tris_ptr = tris_ptr, .n_tris = n_tris, .target = target };
+  job.n_chunks    = MAX( 1, ( n_tris + BIN_CHUNK_TRIS - 1 ) / BIN_CHUNK_TRIS );
+  job.n_tiles_x   = ( target.width + RASTER_TILE_SZ - 1 ) / RASTER_TILE_SZ;
+  job.n_tiles_y   = ( target.height + RASTER_TILE_SZ - 1 ) / RASTER_TILE_SZ;
+  int n_tiles     = job.n_tiles_x * job.n_tiles_y;
+  int n_bins      = n_tiles * job.n_chunks;
+  int n_threads   = MAX( 1, apg_jobs_n_threads() );
+  int tile_mem_sz = RASTER_TILE_SZ * RASTER_TILE_SZ * ( target.n_channels + sizeof( float ) );
+
+  if ( !_reserve( (void**)&binner_ptr->bounds_ptr, &binner_ptr->bounds_capacity, n_tris * 4, sizeof( int ) ) ||
+       !_reserve( (void**)&binner_ptr->tile_starts_ptr, &binner_ptr->tile_starts_capacity, n_tiles + 1, sizeof( int ) ) ||
+       !_reserve( (void**)&binner_ptr->bin_offsets_ptr, &binner_ptr->offsets_capacity, n_bins, sizeof( int ) ) ||
+       !_reserve( (void**)&binner_ptr->tile_mem_ptr, &binner_ptr->n_tile_mems, n_threads * tile_mem_sz, 1 ) ||
+       ( RASTER_CORE_EDGE == binner_ptr->core &&
+         !_reserve( (void**)&binner_ptr->setups_ptr, &binner_ptr->setups_capacity, n_tris, sizeof( raster_setup_t ) ) ) ||
+       ( ( binner_ptr->use_hiz || binner_ptr->sort_front_to_back ) &&
+         !_reserve( (void**)&binner_ptr->zmax_ptr, &binner_ptr->zmax_capacity, MAX( n_tris, 1 ), sizeof( float ) ) ) ||
+       ( binner_ptr->use_hiz && !_reserve( (void**)&binner_ptr->tile_stats_ptr, &binner_ptr->tile_stats_capacity, n_tiles * 3, sizeof( int ) ) ) ) {
+    APG_PROF_END();
+    return false;
+  }
+
+  APG_PROF_BEGIN( "setup" );
+  apg_jobs_parallel_for( 0, n_tris, TRANSFORM_GRAIN, _setup_range, &job );
+  APG_PROF_END();
+
+  APG_PROF_BEGIN( "bin" );
+  memset( binner_ptr->bin_offsets_ptr, 0, sizeof( int ) * n_bins );
+  apg_jobs_parallel_for( 0, job.n_chunks, 1, _bin_count_range, &job );
+  // exclusive prefix sum over (tile, chunk) so each tile's list is contiguous and in chunk order, ie. submission order.
+  int total = 0;
+  for ( int tile = 0; tile < n_tiles; tile++ ) {
+    if ( tile > 0 ) { job.max_tile_tris = MAX( job.max_tile_tris, total - binner_ptr->tile_starts_ptr[tile - 1] ); }
+    binner_ptr->tile_starts_ptr[tile] = total;
+    for ( int chunk = 0; chunk < job.n_chunks; chunk++ ) {
+      int count                                                = binner_ptr->bin_offsets_ptr[tile * job.n_chunks + chunk];
+      binner_ptr->bin_offsets_ptr[tile * job.n_chunks + chunk] = total;
+      total += count;
+    }
+  }
+  binner_ptr->tile_starts_ptr[n_tiles] = total;
+  binner_ptr->n_tris_binned            = total;
+  job.max_tile_tris                    = MAX( job.max_tile_tris, total - binner_ptr->tile_starts_ptr[n_tiles - 1] );
+  if ( !_reserve( (void**)&binner_ptr->tri_idxs_ptr, &binner_ptr->tri_idxs_capacity, MAX( total, 1 ), sizeof( int ) ) ||
+       ( binner_ptr->sort_front_to_back &&
+         !_reserve( (void**)&binner_ptr->sort_mem_ptr, &binner_ptr->sort_mem_capacity, n_threads * MAX( job.max_tile_tris, 1 ), sizeof( sort_key_t ) ) ) ) {
+    APG_PROF_END();
+    APG_PROF_END();
+    return false;
+  }
+  apg_jobs_parallel_for( 0, job.n_chunks, 1, _bin_write_range, &job );
+  APG_PROF_END();
+
+  APG_PROF_BEGIN( "raster_tiles" );
+  if ( binner_ptr->use_hiz ) { memset( binner_ptr->tile_stats_ptr, 0, sizeof( int ) * n_tiles * 3 ); }
+  apg_jobs_parallel_for( 0, n_tiles, 1, _raster_tile_range, &job );
+  binner_ptr->n_hiz_tris_rejected = binner_ptr->n_hiz_blocks_tested = binner_ptr->n_hiz_blocks_rejected = 0;
+  for ( int tile = 0; binner_ptr->use_hiz && tile < n_tiles; tile++ ) {
+    binner_ptr->n_hiz_tris_rejected += binner_ptr->tile_stats_ptr[tile * 3 + 0];
+    binner_ptr->n_hiz_blocks_tested += binner_ptr->tile_stats_ptr[tile * 3 + 1];
+    binner_ptr->n_hiz_blocks_rejected += binner_ptr->tile_stats_ptr[tile * 3 + 2];
+  }
+  APG_PROF_END();
+
+  APG_PROF_COUNTER( "binned triangles", total );
+  APG_PROF_END();
+  return true;
+}
+
+void raster_binner_free( raster_binner_t* binner_ptr ) {
+  if ( !binner_ptr ) { return; }
+  free( binner_ptr->bounds_ptr );
+  free( binner_ptr->bin_offsets_ptr );
+  free( binner_ptr->tile_starts_ptr );
+  free( binner_ptr->tri_idxs_ptr );
+  free( binner_ptr->tile_mem_ptr );
+  free( binner_ptr->setups_ptr );
+  free( binner_ptr->zmax_ptr );
+  free( binner_ptr->tile_stats_ptr );
+  free( binner_ptr->sort_mem_ptr );
+  *binner_ptr = ( raster_binner_t ){ .core = binner_ptr->core, .use_hiz = binner_ptr->use_hiz, .sort_front_to_back = binner_ptr->sort_front_to_back };
+}
@@ -0,0 +1,124 @@
+/* Software rasteriser pipeline for 076_sw_rasteriser.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Stages:
+  1. transform - PLY vertices to screen space, 3 vertices per triangle. either:
+                 raster_transform_ply()     - every de-indexed PLY vertex, one at a time.
+                 raster_transform_indexed() - each unique vertex of a raster_mesh_t once, 4 at a time in SoA with SSE2, into a transformed-vertex buffer.
+                                              triangles are then assembled from the buffer by index: rejected if all 3 vertices are outside the
+                                              same frustum plane, and clipped against the near plane, so nothing behind the camera is drawn.
+  2. setup     - per-triangle screen bounds.
+  3. binning   - triangle indices into lists per RASTER_TILE_SZ square screen tile.
+  4. raster    - each tile rasterised independently into tile-local colour and depth buffers, then copied out.
+
+Stages 1-3 and tile rasterisation run in parallel with the apg.h job system if apg_jobs_init() has been called, otherwise on the calling thread.
+Each tile sees its triangles in submission order, so output doesn't depend on the thread count.
+
+Tile raster cores, picked with raster_binner_t.core:
+  RASTER_CORE_BARYCENTRIC - the original per-pixel float barycentric test over the bounding box. identical to raster_draw_serial().
+  RASTER_CORE_EDGE        - 28.4 fixed-point edge functions with a top-left fill rule, stepped incrementally over 8x8 blocks.
+                            blocks are trivially rejected or accepted from their corners, and the rest is tested 4 pixels at a time with SSE2.
+                            depth and colour are interpolated with perspective correction. triangles behind the camera, or outside a
+                            +-16k pixel guard band, fall back to the barycentric core.
+
+Hierarchical Z, with raster_binner_t.use_hiz:
+  each tile keeps the farthest stored depth of every 8x8 block, from the depth loaded with the tile and refreshed as blocks are written.
+  a triangle whose nearest vertex isn't nearer than every block under its bounds is skipped for that tile. the edge core also skips single
+  blocks, bounding the triangle's depth over the block from its 1/w plane. only triangles that can't pass the depth test are rejected,
+  so output is unchanged. sort_front_to_back orders each tile's list nearest-first so more is rejected, but ties then resolve differently.
+*/
+
+#pragma once
+#include "apg_maths.h"
+#include "apg_ply.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RASTER_TILE_SZ 64
+
+typedef struct rgb_byte_t {
+  uint8_t r, g, b;
+} rgb_byte_t;
+
+typedef struct vertex_t {
+  vec3 pos; // x,y in pixels. z is depth, where larger is nearer and 0 is the far clear value.
+  float w;  // clip-space w, for perspective-correct interpolation.
+  rgb_byte_t colour;
+} vertex_t;
+
+typedef struct raster_target_t {
+  uint8_t* image_ptr;
+  float* depth_ptr;
+  int width, height, n_channels;
+} raster_target_t;
+
+typedef enum raster_core_t { RASTER_CORE_BARYCENTRIC = 0, RASTER_CORE_EDGE } raster_core_t;
+
+// an indexed mesh for raster_transform_indexed(). positions are SoA, each array padded with zeros to a multiple of 4.
+typedef struct raster_mesh_t {
+  float *xs_ptr, *ys_ptr, *zs_ptr; // xs_ptr owns the allocation for all 3.
+  rgb_byte_t* colours_ptr;
+  uint32_t* indices_ptr; // 3 per triangle.
+  int n_vertices, n_tris;
+} raster_mesh_t;
+
+// transformed-vertex buffer and assembled triangles kept between draws. zero-initialise, and free with raster_vertex_stage_free().
+typedef struct raster_vertex_stage_t {
+  float* clip_ptr;        // per vertex, SoA: clip-space x[], then y[], z[], w[], each vertex_capacity long.
+  vertex_t* screen_ptr;   // per vertex: screen-space, for vertices in front of the near plane.
+  uint8_t* outcodes_ptr;  // per vertex: one bit per frustum plane the vertex is outside.
+  int* chunk_counts_ptr;  // per chunk of input triangles: output triangles (then their start index), culled, and clipped.
+  vertex_t* tris_ptr;     // output: screen-space triangles, 3 vertices each, ready for raster_draw_*().
+  int vertex_capacity, chunk_counts_capacity, tris_capacity;
+  int n_tris;                        // output triangles from the last transform.
+  int n_tris_culled, n_tris_clipped; // stats from the last transform: input triangles rejected outright, and cut by the near plane.
+} raster_vertex_stage_t;
+
+// binning and tile memory kept between draws. zero-initialise, and free with raster_binner_free().
+typedef struct raster_binner_t {
+  raster_core_t core;                // which routine rasterises each tile. set before drawing.
+  bool use_hiz;                      // hierarchical-Z rejection. set before drawing.
+  bool sort_front_to_back;           // sort each tile's triangles nearest-first. set before drawing.
+  struct raster_setup_t* setups_ptr; // per triangle edge and plane equations, for RASTER_CORE_EDGE.
+  float* zmax_ptr;                   // per triangle: nearest vertex depth, for hi-z and sorting.
+  int* bounds_ptr;                   // per triangle: min_x, min_y, max_x, max_y in pixels, clipped to the target.
+  int* bin_offsets_ptr;              // per tile, per chunk of triangles: count, then start index into tri_idxs_ptr.
+  int* tile_starts_ptr;              // per tile + 1: start of the tile's triangle list in tri_idxs_ptr.
+  int* tri_idxs_ptr;                 // every tile's triangle list, one after another.
+  int* tile_stats_ptr;               // per tile: hi-z counters, summed into the stats below.
+  uint8_t* tile_mem_ptr;             // per worker thread: one tile of colour then depth.
+  uint8_t* sort_mem_ptr;             // per worker thread: sort keys for the longest tile list.
+  int bounds_capacity, offsets_capacity, tile_starts_capacity, tri_idxs_capacity, n_tile_mems, setups_capacity;
+  int zmax_capacity, tile_stats_capacity, sort_mem_capacity;
+  // stats from the last draw
+  int n_tris_binned;         // sum of triangles over all tile bins.
+  int n_hiz_tris_rejected;   // of those, how many hi-z skipped.
+  int n_hiz_blocks_tested;   // 8x8 blocks the edge core reached with hi-z on.
+  int n_hiz_blocks_rejected; // of those, how many hi-z skipped.
+} raster_binner_t;
+
+// transform stage. writes 3 screen-space vertices per PLY triangle into tris_ptr, which must have room for ply_ptr->n_vertices.
+void raster_transform_ply( const apg_ply_t* ply_ptr, mat4 PVM, int width, int height, float farc, vertex_t* tris_ptr );
+
+// weld the de-indexed PLY vertices that share a position and colour into an indexed mesh. returns false if out of memory.
+bool raster_mesh_from_ply( const apg_ply_t* ply_ptr, raster_mesh_t* mesh_ptr );
+
+void raster_mesh_free( raster_mesh_t* mesh_ptr );
+
+// transform stage for indexed meshes. writes stage_ptr->n_tris triangles to stage_ptr->tris_ptr, with the same screen mapping as raster_transform_ply().
+// returns false if out of memory.
+bool raster_transform_indexed( raster_vertex_stage_t* stage_ptr, const raster_mesh_t* mesh_ptr, mat4 PVM, int width, int height, float farc );
+
+void raster_vertex_stage_free( raster_vertex_stage_t* stage_ptr );
+
+// rasterise one triangle into the whole target. the reference routine that the binned path must match.
+void raster_fill_triangle( vertex_t a, vertex_t b, vertex_t c, raster_target_t target );
+
+// rasterise n_tris triangles (3 vertices each) in order on the calling thread.
+void raster_draw_serial( const vertex_t* tris_ptr, int n_tris, raster_target_t target );
+
+// setup, bin, and rasterise per tile. with RASTER_CORE_BARYCENTRIC this produces the same image and depth as raster_draw_serial().
+// returns false if out of memory, in which case the target is unchanged.
+bool raster_draw_binned( raster_binner_t* binner_ptr, const vertex_t* tris_ptr, int n_tris, raster_target_t target );
+
+void raster_binner_free( raster_binner_t* binner_ptr );
@@ -0,0 +1,369 @@
+/* Headless benchmark for the software rasteriser: de-indexed vs indexed transform, serial vs binned, the barycentric vs edge-function tile cores,
+and hierarchical-Z, over PLY meshes at 512x512 to 4K.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L raster_bench.c raster.c apg_ply.c -lm -pthread -o raster_bench
+Run:
+  ./raster_bench [mesh.ply ...]
+
+With no arguments it uses the PLY models in the repo, plus a generated 256k-triangle sphere so there is at least one dense mesh,
+a generated disc of 2048 long thin wedges, where a bounding-box scan is mostly wasted, and 16 stacked grids submitted back to front,
+for depth complexity like a CAD model's.
+Each mesh is framed to fill the view, so nothing is near-clipped and the indexed transform must give the same render as the de-indexed one.
+`idx ms` is raster_transform_indexed() on the welded mesh, and `verts` is how many unique vertices welding left per de-indexed vertex.
+The binned barycentric render of the indexed triangles is compared byte-for-byte against the serial render, colour and depth.
+The edge-function core uses a different fill rule, snaps to 1/16 pixel, and interpolates with perspective correction, so it isn't expected
+to match exactly; the `diff` column is the percentage of pixels where a colour channel differs from the serial render by more than 8,
+which counts fill-rule and depth-order differences but not interpolation rounding.
+Mpix/s is covered pixels in the final image per second of raster time, for the binned barycentric and edge cores.
+
+The last two tables time the barycentric core, which main.c uses by default, and then the edge core, each with hi-z off, on, and on with
+each tile sorted front to back. They show what fraction of binned triangles hi-z rejected, and for the edge core, of reached 8x8 blocks.
+Hi-z on must match hi-z off byte-for-byte; sorting is compared with the `diff` measure.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "apg_maths.h"
+#include "apg_ply.h"
+#include "raster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_REPEATS 3
+
+typedef struct resolution_t {
+  int w, h;
+} resolution_t;
+
+static const resolution_t _resolutions[] = { { 512, 512 }, { 1024, 1024 }, { 2048, 2048 }, { 3840, 2160 } };
+
+static const char* _default_meshes[] = { "cage.ply", "../057_sphere_doubler/uv_sphere.ply", "../089_voxedit_edges/spruce.ply", "../106_voxedit2/torch.ply" };
+
+// a de-indexed UV sphere with n_rings * n_segs * 2 triangles, coloured by normal
+static apg_ply_t _gen_sphere( int n_rings, int n_segs ) {
+  int n_verts       = n_rings * n_segs * 6;
+  apg_ply_t ply     = ( apg_ply_t ){ .n_vertices = n_verts, .n_positions_comps = 3, .n_colours_comps = 3, .loaded = 1 };
+  ply.positions_ptr = malloc( sizeof( float ) * 3 * n_verts );
+  ply.colours_ptr   = malloc( sizeof( float ) * 3 * n_verts );
+  if ( !ply.positions_ptr || !ply.colours_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  int v = 0;
+  for ( int r = 0; r < n_rings; r++ ) {
+    for ( int s = 0; s < n_segs; s++ ) {
+      int corners[6][2] = { { r, s }, { r + 1, s }, { r + 1, s + 1 }, { r, s }, { r + 1, s + 1 }, { r, s + 1 } };
+      for ( int c = 0; c < 6; c++, v++ ) {
+        float theta  = (float)M_PI * corners[c][0] / n_rings, phi = 2.0f * (float)M_PI * corners[c][1] / n_segs;
+        float x      = sinf( theta ) * cosf( phi ), y = cosf( theta ), z = sinf( theta ) * sinf( phi );
+        float* p_ptr = &ply.positions_ptr[v * 3];
+        float* c_ptr = &ply.colours_ptr[v * 3];
+        p_ptr[0] = x * 5.0f, p_ptr[1] = y * 5.0f, p_ptr[2] = z * 5.0f;
+        c_ptr[0] = x * 0.5f + 0.5f, c_ptr[1] = y * 0.5f + 0.5f, c_ptr[2] = z * 0.5f + 0.5f;
+      }
+    }
+  }
+  return ply;
+}
+
+// a disc of n_wedges thin triangles fanned around the centre, coloured by angle
+static apg_ply_t _gen_fan( int n_wedges ) {
+  int n_verts       = n_wedges * 3;
+  apg_ply_t ply     = ( apg_ply_t ){ .n_vertices = n_verts, .n_positions_comps = 3, .n_colours_comps = 3, .loaded = 1 };
+  ply.positions_ptr = calloc( n_verts * 3, sizeof( float ) );
+  ply.colours_ptr   = calloc( n_verts * 3, sizeof( float ) );
+  if ( !ply.positions_ptr || !ply.colours_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  for ( int i = 0; i < n_wedges; i++ ) {
+    for ( int c = 1; c < 3; c++ ) {
+      float theta  = 2.0f * (float)M_PI * ( i + c - 1 ) / n_wedges;
+      float* p_ptr = &ply.positions_ptr[( i * 3 + c ) * 3];
+      p_ptr[0] = cosf( theta ) * 5.0f, p_ptr[1] = sinf( theta ) * 5.0f;
+    }
+    for ( int c = 0; c < 3; c++ ) {
+      float* c_ptr = &ply.colours_ptr[( i * 3 + c ) * 3];
+      c_ptr[0] = (float)i / n_wedges, c_ptr[1] = 1.0f - (float)i / n_wedges, c_ptr[2] = c * 0.5f;
+    }
+  }
+  return ply;
+}
+
+// n_layers square grids of n_quads x n_quads, stacked along z and listed farthest first, so without sorting every layer is drawn over the last
+static apg_ply_t _gen_layers( int n_layers, int n_quads ) {
+  int n_verts       = n_layers * n_quads * n_quads * 6;
+  apg_ply_t ply     = ( apg_ply_t ){ .n_vertices = n_verts, .n_positions_comps = 3, .n_colours_comps = 3, .loaded = 1 };
+  ply.positions_ptr = malloc( sizeof( float ) * 3 * n_verts );
+  ply.colours_ptr   = malloc( sizeof( float ) * 3 * n_verts );
+  if ( !ply.positions_ptr || !ply.colours_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  int v = 0;
+  for ( int l = 0; l < n_layers; l++ ) {
+    for ( int row = 0; row < n_quads; row++ ) {
+      for ( int col = 0; col < n_quads; col++ ) {
+        int corners[6][2] = { { col, row }, { col + 1, row }, { col + 1, row + 1 }, { col, row }, { col + 1, row + 1 }, { col, row + 1 } };
+        for ( int c = 0; c < 6; c++, v++ ) {
+          float* p_ptr = &ply.positions_ptr[v * 3];
+          float* c_ptr = &ply.colours_ptr[v * 3];
+          p_ptr[0] = 10.0f * corners[c][0] / n_quads - 5.0f, p_ptr[1] = 10.0f * corners[c][1] / n_quads - 5.0f, p_ptr[2] = l * 0.25f;
+          c_ptr[0] = (float)l / n_layers, c_ptr[1] = (float)corners[c][0] / n_quads, c_ptr[2] = (float)corners[c][1] / n_quads;
+        }
+      }
+    }
+  }
+  return ply;
+}
+
+// a camera that frames the mesh's bounding sphere, turned 45 degrees like main.c
+static mat4 _framing_PVM( const apg_ply_t* ply_ptr, int w, int h, float nearc, float farc ) {
+  vec3 lo = ( vec3 ){ .x = 1e30f, .y = 1e30f, .z = 1e30f }, hi = ( vec3 ){ .x = -1e30f, .y = -1e30f, .z = -1e30f };
+  for ( int i = 0; i < ply_ptr->n_vertices; i++ ) {
+    const float* p = &ply_ptr->positions_ptr[i * ply_ptr->n_positions_comps];
+    lo             = ( vec3 ){ .x = MIN( lo.x, p[0] ), .y = MIN( lo.y, p[1] ), .z = MIN( lo.z, p[2] ) };
+    hi             = ( vec3 ){ .x = MAX( hi.x, p[0] ), .y = MAX( hi.y, p[1] ), .z = MAX( hi.z, p[2] ) };
+  }
+  vec3 centre  = mult_vec3_f( add_vec3_vec3( lo, hi ), 0.5f );
+  float radius = length_vec3( sub_vec3_vec3( hi, centre ) );
+  // the viewport transform maps NDC -0.5..0.5 onto the screen, so the camera stands well back
+  mat4 P = perspective( 66.6f, w / (float)h, nearc, farc );
+  mat4 V = look_at( ( vec3 ){ .x = 0, .y = 0, .z = radius * 3.0f }, ( vec3 ){ .x = 0 }, ( vec3 ){ .y = 1.0f } );
+  mat4 M = mult_mat4_mat4( rot_y_deg_mat4( 45.0f ), translate_mat4( mult_vec3_f( centre, -1.0f ) ) );
+  return mult_mat4_mat4( mult_mat4_mat4( P, V ), M );
+}
+
+static void _bench_mesh( const char* name, const apg_ply_t* ply_ptr, raster_binner_t* binner_ptr, raster_vertex_stage_t* stage_ptr, bool* all_ok_ptr ) {
+  const float nearc  = 0.01f, farc = 1000.0f;
+  int n_tris         = ply_ptr->n_vertices / 3;
+  vertex_t* tris_ptr = malloc( sizeof( vertex_t ) * n_tris * 3 );
+  raster_mesh_t mesh = ( raster_mesh_t ){ .n_tris = 0 };
+  if ( !tris_ptr || !raster_mesh_from_ply( ply_ptr, &mesh ) ) {
+    fprintf( stderr, "ERROR: out of memory for `%s`\n", name );
+    *all_ok_ptr = false;
+    free( tris_ptr );
+    return;
+  }
+
+  for ( int r = 0; r < (int)( sizeof( _resolutions ) / sizeof( _resolutions[0] ) ); r++ ) {
+    int w            = _resolutions[r].w, h = _resolutions[r].h;
+    size_t n_pixels  = (size_t)w * h;
+    uint8_t* ref_img = calloc( n_pixels, 3 );
+    float* ref_depth = calloc( n_pixels, sizeof( float ) );
+    uint8_t* bin_img = calloc( n_pixels, 3 );
+    float* bin_depth = calloc( n_pixels, sizeof( float ) );
+    uint8_t* edg_img = calloc( n_pixels, 3 );
+    float* edg_depth = calloc( n_pixels, sizeof( float ) );
+    if ( !ref_img || !ref_depth || !bin_img || !bin_depth || !edg_img || !edg_depth ) {
+      fprintf( stderr, "ERROR: out of memory at %ix%i\n", w, h );
+      *all_ok_ptr = false;
+      goto next_resolution;
+    }
+    raster_target_t ref = ( raster_target_t ){ .image_ptr = ref_img, .depth_ptr = ref_depth, .width = w, .height = h, .n_channels = 3 };
+    raster_target_t bin = ( raster_target_t ){ .image_ptr = bin_img, .depth_ptr = bin_depth, .width = w, .height = h, .n_channels = 3 };
+    raster_target_t edg = ( raster_target_t ){ .image_ptr = edg_img, .depth_ptr = edg_depth, .width = w, .height = h, .n_channels = 3 };
+
+    double transform_s = 1e9, indexed_s = 1e9, serial_s = 1e9, binned_s = 1e9, edge_s = 1e9;
+    mat4 PVM           = _framing_PVM( ply_ptr, w, h, nearc, farc );
+    for ( int i = 0; i < N_REPEATS; i++ ) {
+      double t0 = apg_time_s();
+      raster_transform_ply( ply_ptr, PVM, w, h, farc, tris_ptr );
+      transform_s = MIN( transform_s, apg_time_s() - t0 );
+
+      t0              = apg_time_s();
+      bool indexed_ok = raster_transform_indexed( stage_ptr, &mesh, PVM, w, h, farc );
+      indexed_s       = MIN( indexed_s, apg_time_s() - t0 );
+
+      memset( ref_img, 0, n_pixels * 3 );
+      memset( ref_depth, 0, n_pixels * sizeof( float ) );
+      t0 = apg_time_s();
+      raster_draw_serial( tris_ptr, n_tris, ref );
+      serial_s = MIN( serial_s, apg_time_s() - t0 );
+
+      memset( bin_img, 0, n_pixels * 3 );
+      memset( bin_depth, 0, n_pixels * sizeof( float ) );
+      t0               = apg_time_s();
+      binner_ptr->core = RASTER_CORE_BARYCENTRIC;
+      bool binned_ok   = indexed_ok && raster_draw_binned( binner_ptr, stage_ptr->tris_ptr, stage_ptr->n_tris, bin );
+      binned_s         = MIN( binned_s, apg_time_s() - t0 );
+
+      memset( edg_img, 0, n_pixels * 3 );
+      memset( edg_depth, 0, n_pixels * sizeof( float ) );
+      t0               = apg_time_s();
+      binner_ptr->core = RASTER_CORE_EDGE;
+      bool edge_ok     = raster_draw_binned( binner_ptr, tris_ptr, n_tris, edg );
+      edge_s           = MIN( edge_s, apg_time_s() - t0 );
+      if ( !binned_ok || !edge_ok ) {
+        fprintf( stderr, "ERROR: out of memory binning\n" );
+        *all_ok_ptr = false;
+        goto next_resolution;
+      }
+    }
+    bool same       = 0 == memcmp( ref_img, bin_img, n_pixels * 3 ) && 0 == memcmp( ref_depth, bin_depth, n_pixels * sizeof( float ) );
+    size_t n_filled = 0, n_diff = 0;
+    for ( size_t i = 0; i < n_pixels; i++ ) {
+      if ( ref_depth[i] > 0.0f ) { n_filled++; }
+      for ( int c = 0; c < 3; c++ ) {
+        if ( abs( ref_img[i * 3 + c] - edg_img[i * 3 + c] ) > 8 ) {
+          n_diff++;
+          break;
+        }
+      }
+    }
+    if ( !same ) { *all_ok_ptr = false; }
+    printf( "%-36s %8i %5.2f %4ix%-4i %9.2f %8.2f %10.2f %10.2f %9.2f %8.2fx %6.2f %9.1f %9.1f %6.2f%%  %s\n", name, n_tris,
+      (double)mesh.n_vertices / MAX( n_tris * 3, 1 ), w, h, transform_s * 1000.0, indexed_s * 1000.0, serial_s * 1000.0, binned_s * 1000.0, edge_s * 1000.0,
+      serial_s / binned_s, (double)binner_ptr->n_tris_binned / MAX( n_tris, 1 ), n_filled / binned_s * 1e-6, n_filled / edge_s * 1e-6,
+      100.0 * n_diff / n_pixels, same ? "identical" : "MISMATCH" );
+
+  next_resolution:
+    free( ref_img );
+    free( ref_depth );
+    free( bin_img );
+    free( bin_depth );
+    free( edg_img );
+    free( edg_depth );
+  }
+  free( tris_ptr );
+  raster_mesh_free( &mesh );
+}
+
+static void _bench_hiz(
+  const char* name, const apg_ply_t* ply_ptr, raster_core_t core, raster_binner_t* binner_ptr, raster_vertex_stage_t* stage_ptr, bool* all_ok_ptr ) {
+  const float nearc  = 0.01f, farc = 1000.0f;
+  raster_mesh_t mesh = ( raster_mesh_t ){ .n_tris = 0 };
+  if ( !raster_mesh_from_ply( ply_ptr, &mesh ) ) {
+    fprintf( stderr, "ERROR: out of memory for `%s`\n", name );
+    *all_ok_ptr = false;
+    return;
+  }
+  for ( int r = 0; r < (int)( sizeof( _resolutions ) / sizeof( _resolutions[0] ) ); r++ ) {
+    int w           = _resolutions[r].w, h = _resolutions[r].h;
+    size_t n_pixels = (size_t)w * h;
+    uint8_t* img_ptr[3];
+    float* depth_ptr[3];
+    double best_s[3]  = { 1e9, 1e9, 1e9 };
+    int tris_rejected = 0, blocks_tested = 0, blocks_rejected = 0, sorted_tris_rejected = 0;
+    bool mem_ok       = true;
+    for ( int m = 0; m < 3; m++ ) {
+      img_ptr[m]   = calloc( n_pixels, 3 );
+      depth_ptr[m] = calloc( n_pixels, sizeof( float ) );
+      mem_ok       = mem_ok && img_ptr[m] && depth_ptr[m];
+    }
+    if ( !mem_ok || !raster_transform_indexed( stage_ptr, &mesh, _framing_PVM( ply_ptr, w, h, nearc, farc ), w, h, farc ) ) {
+      fprintf( stderr, "ERROR: out of memory at %ix%i\n", w, h );
+      *all_ok_ptr = false;
+      goto next_resolution;
+    }
+    for ( int i = 0; i < N_REPEATS; i++ ) {
+      // mode 0: hi-z off, 1: hi-z on, 2: hi-z on and sorted
+      for ( int m = 0; m < 3; m++ ) {
+        raster_target_t target = ( raster_target_t ){ .image_ptr = img_ptr[m], .depth_ptr = depth_ptr[m], .width = w, .height = h, .n_channels = 3 };
+        memset( img_ptr[m], 0, n_pixels * 3 );
+        memset( depth_ptr[m], 0, n_pixels * sizeof( float ) );
+        binner_ptr->core               = core;
+        binner_ptr->use_hiz            = m > 0;
+        binner_ptr->sort_front_to_back = m > 1;
+        double t0                      = apg_time_s();
+        if ( !raster_draw_binned( binner_ptr, stage_ptr->tris_ptr, stage_ptr->n_tris, target ) ) {
+          fprintf( stderr, "ERROR: out of memory binning\n" );
+          *all_ok_ptr = false;
+          goto next_resolution;
+        }
+        best_s[m] = MIN( best_s[m], apg_time_s() - t0 );
+        if ( 1 == m ) {
+          tris_rejected   = binner_ptr->n_hiz_tris_rejected;
+          blocks_tested   = binner_ptr->n_hiz_blocks_tested;
+          blocks_rejected = binner_ptr->n_hiz_blocks_rejected;
+        }
+        if ( 2 == m ) { sorted_tris_rejected = binner_ptr->n_hiz_tris_rejected; }
+      }
+    }
+    {
+      bool same     = 0 == memcmp( img_ptr[0], img_ptr[1], n_pixels * 3 ) && 0 == memcmp( depth_ptr[0], depth_ptr[1], n_pixels * sizeof( float ) );
+      size_t n_diff = 0;
+      for ( size_t i = 0; i < n_pixels; i++ ) {
+        for ( int c = 0; c < 3; c++ ) {
+          if ( abs( img_ptr[0][i * 3 + c] - img_ptr[2][i * 3 + c] ) > 8 ) {
+            n_diff++;
+            break;
+          }
+        }
+      }
+      if ( !same ) { *all_ok_ptr = false; }
+      double n_binned = MAX( binner_ptr->n_tris_binned, 1 );
+      printf( "%-36s %8i %4ix%-4i %9.2f %9.2f %9.2f %7.2fx %7.2fx %8.1f%% %8.1f%% %8.1f%% %6.2f%%  %s\n", name, mesh.n_tris, w, h, best_s[0] * 1000.0,
+        best_s[1] * 1000.0, best_s[2] * 1000.0, best_s[0] / best_s[1], best_s[0] / best_s[2], 100.0 * tris_rejected / n_binned,
+        100.0 * blocks_rejected / MAX( blocks_tested, 1 ), 100.0 * sorted_tris_rejected / n_binned, 100.0 * n_diff / n_pixels,
+        same ? "identical" : "MISMATCH" );
+    }
+  next_resolution:
+    for ( int m = 0; m < 3; m++ ) {
+      free( img_ptr[m] );
+      free( depth_ptr[m] );
+    }
+  }
+  binner_ptr->use_hiz = binner_ptr->sort_front_to_back = false;
+  raster_mesh_free( &mesh );
+}
+
+int main( int argc, char** argv ) {
+  apg_time_init();
+  if ( !apg_jobs_init( 0 ) ) { return 1; }
+  printf( "%i threads, %ix%i tiles, best of %i\n", apg_jobs_n_threads(), RASTER_TILE_SZ, RASTER_TILE_SZ, N_REPEATS );
+  printf( "%-36s %8s %5s %9s %9s %8s %10s %10s %9s %9s %6s %9s %9s %7s\n", "mesh", "tris", "verts", "res", "xform ms", "idx ms", "serial ms", "binned ms",
+    "edge ms", "speedup", "bins/tri", "bary Mpx/s", "edge Mpx/s", "diff>8" );
+
+  raster_binner_t binner      = ( raster_binner_t ){ .n_tris_binned = 0 };
+  raster_vertex_stage_t stage = ( raster_vertex_stage_t ){ .n_tris = 0 };
+  bool all_ok                 = true;
+  int n_files                 = argc > 1 ? argc - 1 : (int)( sizeof( _default_meshes ) / sizeof( _default_meshes[0] ) );
+  int n_meshes                = 0;
+  apg_ply_t* plys_ptr         = calloc( n_files + 3, sizeof( apg_ply_t ) );
+  const char** names_ptr      = calloc( n_files + 3, sizeof( const char* ) );
+  if ( !plys_ptr || !names_ptr ) { return 1; }
+  for ( int i = 0; i < n_files; i++ ) {
+    const char* filename = argc > 1 ? argv[i + 1] : _default_meshes[i];
+    apg_ply_t ply        = apg_ply_read( filename );
+    if ( !ply.loaded ) {
+      fprintf( stderr, "WARNING: skipping `%s`\n", filename );
+      continue;
+    }
+    names_ptr[n_meshes]  = filename;
+    plys_ptr[n_meshes++] = ply;
+  }
+  if ( argc < 2 ) {
+    names_ptr[n_meshes]  = "generated sphere";
+    plys_ptr[n_meshes++] = _gen_sphere( 256, 512 );
+    names_ptr[n_meshes]  = "generated fan";
+    plys_ptr[n_meshes++] = _gen_fan( 2048 );
+    names_ptr[n_meshes]  = "generated layers";
+    plys_ptr[n_meshes++] = _gen_layers( 16, 32 );
+  }
+
+  for ( int i = 0; i < n_meshes; i++ ) {
+    if ( plys_ptr[i].loaded ) { _bench_mesh( names_ptr[i], &plys_ptr[i], &binner, &stage, &all_ok ); }
+  }
+  for ( int c = 0; c < 2; c++ ) {
+    printf( "\nhierarchical-Z, %s core\n", 0 == c ? "barycentric" : "edge" );
+    printf( "%-36s %8s %9s %9s %9s %9s %8s %8s %9s %9s %9s %7s\n", "mesh", "tris", "res", "off ms", "hi-z ms", "sorted ms", "hi-z", "sorted", "tri rej",
+      "block rej", "sort rej", "diff>8" );
+    for ( int i = 0; i < n_meshes; i++ ) {
+      if ( plys_ptr[i].loaded ) { _bench_hiz( names_ptr[i], &plys_ptr[i], 0 == c ? RASTER_CORE_BARYCENTRIC : RASTER_CORE_EDGE, &binner, &stage, &all_ok ); }
+    }
+  }
+  for ( int i = 0; i < n_meshes; i++ ) { apg_ply_delete( &plys_ptr[i] ); }
+  free( plys_ptr );
+  free( names_ptr );
+
+  raster_binner_free( &binner );
+  raster_vertex_stage_free( &stage );
+  apg_jobs_free();
+  if ( !all_ok ) { fprintf( stderr, "ERROR: indexed binned output differed from serial, or hi-z changed the output.\n" ); }
+  return all_ok ? 0 : 1;
+}
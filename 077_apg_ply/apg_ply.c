@@ -1,11 +1,38 @@
 #include "apg_ply.h"
+#include "apg.h"
 #include <assert.h>
+#include <float.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// faces are the mesh's triangles if it's indexed, otherwise every 3 vertices.
+static int _ply_n_faces( apg_ply_t ply ) { return ply.indices_ptr ? ply.n_indices / 3 : ply.n_vertices / 3; }
+
+static uint32_t _ply_face_index( apg_ply_t ply, int face, int corner ) {
+  int i = face * 3 + corner;
+  if ( !ply.indices_ptr ) { return (uint32_t)i; }
+  return 2 == ply.index_sz ? ( (const uint16_t*)ply.indices_ptr )[i] : ( (const uint32_t*)ply.indices_ptr )[i];
+}
+
+static void _ply_write_header( FILE* fptr, apg_ply_t ply, const char* format ) {
+  fprintf( fptr, "ply\nformat %s 1.0\ncomment Exported with apg_ply by @capnramses\n", format );
+  fprintf( fptr, "element vertex %i\n", ply.n_vertices );
+
+  fprintf( fptr, "property float x\nproperty float y\nproperty float z\n" );
+  if ( 3 == ply.n_normals_comps ) { fprintf( fptr, "property float nx\nproperty float ny\nproperty float nz\n" ); }
+  if ( 4 == ply.n_colours_comps ) {
+    fprintf( fptr, "property float red\nproperty float green\nproperty float blue\nproperty float alpha\n" );
+  } else if ( 3 == ply.n_colours_comps ) {
+    fprintf( fptr, "property float red\nproperty float green\nproperty float blue\n" );
+  }
+  if ( 2 == ply.n_texcoords_comps ) { fprintf( fptr, "property float s\nproperty float t\n" ); }
+  fprintf( fptr, "element face %i\nproperty list uchar uint vertex_indices\nend_header\n", _ply_n_faces( ply ) );
+}
+
 unsigned int apg_ply_write( const char* filename, apg_ply_t ply ) {
   if ( !filename ) { return false; }
   if ( !ply.positions_ptr || ply.n_vertices <= 0 ) { return false; }
@@ -13,27 +40,14 @@ unsigned int apg_ply_write( const char* filename, apg_ply_t ply ) {
 
   FILE* fptr = fopen( filename, "w" );
   if ( !fptr ) { return false; }
-  { // HEADER
-    fprintf( fptr, "ply\nformat ascii 1.0\ncomment Exported with apg_ply by @capnramses\n" );
-    fprintf( fptr, "element vertex %i\n", ply.n_vertices );
-
-    fprintf( fptr, "property float x\nproperty float y\nproperty float z\n" );
-    if ( 3 == ply.n_normals_comps ) { fprintf( fptr, "property float nx\nproperty float ny\nproperty float nz\n" ); }
-    if ( 4 == ply.n_colours_comps ) {
-      fprintf( fptr, "property float red\nproperty float green\nproperty float blue\nalpha\n" );
-    } else if ( 3 == ply.n_colours_comps ) {
-      fprintf( fptr, "property float red\nproperty float green\nproperty float blue\n" );
-    }
-    if ( 2 == ply.n_texcoords_comps ) { fprintf( fptr, "property float s\nproperty float t\n" ); }
-    fprintf( fptr, "element face %i\nproperty list uchar uint vertex_indices\nend_header\n", ply.n_vertices / 3 );
-  }
+  _ply_write_header( fptr, ply, "ascii" );
   { // BODY
     // vertices
     for ( int v = 0; v < ply.n_vertices; v++ ) {
       fprintf( fptr, "%f %f %f", ply.positions_ptr[v * 3 + 0], ply.positions_ptr[v * 3 + 1], ply.positions_ptr[v * 3 + 2] );
       if ( 3 == ply.n_normals_comps ) { fprintf( fptr, " %f %f %f", ply.normals_ptr[v * 3 + 0], ply.normals_ptr[v * 3 + 1], ply.normals_ptr[v * 3 + 2] ); }
       if ( 4 == ply.n_colours_comps ) {
-        fprintf( fptr, " %f %f %f %f", ply.colours_ptr[v * 3 + 0], ply.colours_ptr[v * 3 + 1], ply.colours_ptr[v * 3 + 2], ply.colours_ptr[v * 3 + 3] );
+        fprintf( fptr, " %f %f %f %f", ply.colours_ptr[v * 4 + 0], ply.colours_ptr[v * 4 + 1], ply.colours_ptr[v * 4 + 2], ply.colours_ptr[v * 4 + 3] );
       } else if ( 3 == ply.n_colours_comps ) {
         fprintf( fptr, " %f %f %f", ply.colours_ptr[v * 3 + 0], ply.colours_ptr[v * 3 + 1], ply.colours_ptr[v * 3 + 2] );
       }
@@ -41,28 +55,1081 @@ unsigned int apg_ply_write( const char* filename, apg_ply_t ply ) {
       fprintf( fptr, "\n" );
     }
     // faces
-    for ( int i = 0; i < ply.n_vertices / 3; i++ ) { fprintf( fptr, "3 %i %i %i\n", i * 3, i * 3 + 1, i * 3 + 2 ); }
+    for ( int i = 0; i < _ply_n_faces( ply ); i++ ) {
+      fprintf( fptr, "3 %u %u %u\n", _ply_face_index( ply, i, 0 ), _ply_face_index( ply, i, 1 ), _ply_face_index( ply, i, 2 ) );
+    }
   }
   fclose( fptr );
   return true;
 }
 
-apg_ply_t apg_ply_read( const char* filename ) {
+static bool _ply_host_is_little_endian( void ) {
+  const uint16_t one = 1;
+  uint8_t first_byte = 0;
+  memcpy( &first_byte, &one, 1 );
+  return 1 == first_byte;
+}
+
+#define _PLY_WRITE_CHUNK 4096 // vertices or faces interleaved per fwrite().
+
+unsigned int apg_ply_write_binary( const char* filename, apg_ply_t ply ) {
+  if ( !filename ) { return false; }
+  if ( !ply.positions_ptr || ply.n_vertices <= 0 ) { return false; }
+  if ( ply.n_positions_comps != 3 ) { return false; }
+  if ( !_ply_host_is_little_endian() ) { return false; }
+
+  // streams in the order the header declares them. only the component counts _ply_write_header() writes are included.
+  const float* streams[4] = { ply.positions_ptr, ply.normals_ptr, ply.colours_ptr, ply.texcoords_ptr };
+  int n_comps[4]          = { 3, 3 == ply.n_normals_comps ? 3 : 0, 3 == ply.n_colours_comps || 4 == ply.n_colours_comps ? ply.n_colours_comps : 0,
+             2 == ply.n_texcoords_comps ? 2 : 0 };
+  int vertex_sz      = ( n_comps[0] + n_comps[1] + n_comps[2] + n_comps[3] ) * (int)sizeof( float );
+  uint8_t* chunk_ptr = malloc( (size_t)_PLY_WRITE_CHUNK * APG_MAX( vertex_sz, 13 ) );
+  if ( !chunk_ptr ) { return false; }
+  FILE* fptr = fopen( filename, "wb" );
+  if ( !fptr ) {
+    free( chunk_ptr );
+    return false;
+  }
+  _ply_write_header( fptr, ply, "binary_little_endian" );
+  bool ok = true;
+  for ( int first = 0; ok && first < ply.n_vertices; first += _PLY_WRITE_CHUNK ) {
+    int n          = APG_MIN( _PLY_WRITE_CHUNK, ply.n_vertices - first );
+    uint8_t* w_ptr = chunk_ptr;
+    for ( int v = first; v < first + n; v++ ) {
+      for ( int s = 0; s < 4; s++ ) {
+        if ( !n_comps[s] ) { continue; }
+        memcpy( w_ptr, &streams[s][(size_t)v * n_comps[s]], n_comps[s] * sizeof( float ) );
+        w_ptr += n_comps[s] * sizeof( float );
+      }
+    }
+    ok = 1 == fwrite( chunk_ptr, (size_t)n * vertex_sz, 1, fptr );
+  }
+  // faces are `uchar uint` lists, of 13 bytes each.
+  int n_faces = _ply_n_faces( ply );
+  for ( int first = 0; ok && first < n_faces; first += _PLY_WRITE_CHUNK ) {
+    int n = APG_MIN( _PLY_WRITE_CHUNK, n_faces - first );
+    for ( int i = 0; i < n; i++ ) {
+      uint32_t indices[3] = { _ply_face_index( ply, first + i, 0 ), _ply_face_index( ply, first + i, 1 ), _ply_face_index( ply, first + i, 2 ) };
+      chunk_ptr[i * 13]   = 3;
+      memcpy( &chunk_ptr[i * 13 + 1], indices, sizeof( indices ) );
+    }
+    ok = 1 == fwrite( chunk_ptr, (size_t)n * 13, 1, fptr );
+  }
+  ok = 0 == fclose( fptr ) && ok;
+  free( chunk_ptr );
+  return ok;
+}
+
+// allocates from `arena_ptr` if given, otherwise malloc()
+static void* _ply_alloc( apg_arena_t* arena_ptr, size_t sz ) { return arena_ptr ? apg_arena_alloc( arena_ptr, sz ) : malloc( sz ); }
+
+static void _ply_free( apg_arena_t* arena_ptr, void* ptr ) {
+  if ( !arena_ptr ) { free( ptr ); }
+}
+
+// binary_little_endian files are parsed from a memory mapping. the header's elements and properties are kept so that properties can be
+// found by name, in any order, and elements this reader doesn't use can be skipped.
+
+#define _PLY_MAX_ELEMENTS 16
+#define _PLY_MAX_PROPERTIES 32
+#define _PLY_MAX_NAME 64
+
+typedef enum ply_type_t {
+  PLY_TYPE_NONE = 0,
+  PLY_TYPE_INT8,
+  PLY_TYPE_UINT8,
+  PLY_TYPE_INT16,
+  PLY_TYPE_UINT16,
+  PLY_TYPE_INT32,
+  PLY_TYPE_UINT32,
+  PLY_TYPE_FLOAT32,
+  PLY_TYPE_FLOAT64,
+  PLY_TYPE_MAX
+} ply_type_t;
+
+static const char* _ply_type_names[PLY_TYPE_MAX]   = { "", "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+static const char* _ply_type_aliases[PLY_TYPE_MAX] = { "", "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+static const int _ply_type_sizes[PLY_TYPE_MAX]     = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+static const double _ply_type_maxes[PLY_TYPE_MAX]  = { 1.0, 127.0, 255.0, 32767.0, 65535.0, 2147483647.0, 4294967295.0, 1.0, 1.0 }; // for integer colours.
+
+typedef struct ply_property_t {
+  char name[_PLY_MAX_NAME];
+  ply_type_t type;       // for lists, the type of each item.
+  ply_type_t count_type; // PLY_TYPE_NONE unless this is a list.
+  int offset;            // bytes from the start of the element's item, or -1 if a list comes before this property.
+} ply_property_t;
+
+typedef struct ply_element_t {
+  char name[_PLY_MAX_NAME];
+  int64_t count;
+  ply_property_t properties[_PLY_MAX_PROPERTIES];
+  int n_properties;
+  int stride; // bytes per item, or 0 if the element has lists so items vary in size.
+} ply_element_t;
+
+typedef struct ply_header_t {
+  ply_element_t elements[_PLY_MAX_ELEMENTS];
+  int n_elements;
+  size_t body_offset; // bytes from the start of the file to the first element's data.
+} ply_header_t;
+
+// the streams of apg_ply_t, in the order of its members, and the property names for each component.
+enum { PLY_STREAM_POSITIONS, PLY_STREAM_NORMALS, PLY_STREAM_TEXCOORDS, PLY_STREAM_COLOURS, PLY_STREAM_MAX };
+static const char* _ply_stream_names[PLY_STREAM_MAX][4][3] = {
+  { { "x" }, { "y" }, { "z" } },
+  { { "nx" }, { "ny" }, { "nz" } },
+  { { "s", "u", "texture_u" }, { "t", "v", "texture_v" } },
+  { { "red", "r", "diffuse_red" }, { "green", "g", "diffuse_green" }, { "blue", "b", "diffuse_blue" }, { "alpha", "a", "diffuse_alpha" } }
+};
+
+// where each stream's components are in a vertex.
+typedef struct ply_layout_t {
+  const ply_property_t* props[PLY_STREAM_MAX][4]; // NULL for components the file doesn't have.
+  int n_comps[PLY_STREAM_MAX];
+  bool packed[PLY_STREAM_MAX]; // components are consecutive floats, so the stream can be copied or referenced as it is.
+} ply_layout_t;
+
+static ply_type_t _ply_type_from_str( const char* str ) {
+  for ( int i = 1; i < PLY_TYPE_MAX; i++ ) {
+    if ( 0 == strcmp( str, _ply_type_names[i] ) || 0 == strcmp( str, _ply_type_aliases[i] ) ) { return (ply_type_t)i; }
+  }
+  return PLY_TYPE_NONE;
+}
+
+static double _ply_get( const uint8_t* ptr, ply_type_t type ) {
+  switch ( type ) {
+  case PLY_TYPE_INT8: return (double)(int8_t)ptr[0];
+  case PLY_TYPE_UINT8: return (double)ptr[0];
+  case PLY_TYPE_INT16: {
+    int16_t v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return (double)v;
+  }
+  case PLY_TYPE_UINT16: {
+    uint16_t v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return (double)v;
+  }
+  case PLY_TYPE_INT32: {
+    int32_t v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return (double)v;
+  }
+  case PLY_TYPE_UINT32: {
+    uint32_t v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return (double)v;
+  }
+  case PLY_TYPE_FLOAT32: {
+    float v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return (double)v;
+  }
+  case PLY_TYPE_FLOAT64: {
+    double v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return v;
+  }
+  default: return 0.0;
+  }
+}
+
+// as _ply_get() for list counts and indices. returns -1 for negative or non-integer types.
+static int64_t _ply_get_int( const uint8_t* ptr, ply_type_t type ) {
+  switch ( type ) {
+  case PLY_TYPE_UINT8: return ptr[0];
+  case PLY_TYPE_UINT32: {
+    uint32_t v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return v;
+  }
+  case PLY_TYPE_INT32: {
+    int32_t v;
+    memcpy( &v, ptr, sizeof( v ) );
+    return v;
+  }
+  case PLY_TYPE_INT8:
+  case PLY_TYPE_INT16:
+  case PLY_TYPE_UINT16: {
+    double v = _ply_get( ptr, type );
+    return (int64_t)v;
+  }
+  default: return -1;
+  }
+}
+
+// copies the next line, without its line ending, into `line`. returns false at the end of the data or if the line is too long.
+static bool _ply_next_line( const uint8_t* data_ptr, size_t sz, size_t* offset_ptr, char* line, int max_len ) {
+  size_t start = *offset_ptr;
+  if ( start >= sz ) { return false; }
+  const uint8_t* end_ptr = memchr( &data_ptr[start], '\n', sz - start );
+  if ( !end_ptr ) { return false; }
+  size_t len  = (size_t)( end_ptr - &data_ptr[start] );
+  *offset_ptr = start + len + 1;
+  if ( len > 0 && '\r' == data_ptr[start + len - 1] ) { len--; }
+  if ( len >= (size_t)max_len ) { return false; }
+  memcpy( line, &data_ptr[start], len );
+  line[len] = '\0';
+  return true;
+}
+
+static bool _ply_parse_header( const uint8_t* data_ptr, size_t sz, const char* filename, ply_header_t* hdr_ptr ) {
+  memset( hdr_ptr, 0, sizeof( ply_header_t ) );
+  char line[1024];
+  size_t offset = 0;
+  if ( !_ply_next_line( data_ptr, sz, &offset, line, 1024 ) || 0 != strcmp( line, "ply" ) ) {
+    fprintf( stderr, "ERROR: 'ply' magic number missing in file `%s`\n", filename );
+    return false;
+  }
+  if ( !_ply_next_line( data_ptr, sz, &offset, line, 1024 ) || 0 != strncmp( line, "format binary_little_endian", strlen( "format binary_little_endian" ) ) ) {
+    fprintf( stderr, "ERROR: 'format binary_little_endian' missing in file `%s`\n", filename );
+    return false;
+  }
+  ply_element_t* element_ptr = NULL;
+  while ( _ply_next_line( data_ptr, sz, &offset, line, 1024 ) ) {
+    char a[_PLY_MAX_NAME] = { 0 }, b[_PLY_MAX_NAME] = { 0 }, c[_PLY_MAX_NAME] = { 0 }, d[_PLY_MAX_NAME] = { 0 };
+    long long count = 0;
+    if ( 0 == strncmp( line, "comment", strlen( "comment" ) ) || 0 == strncmp( line, "obj_info", strlen( "obj_info" ) ) ) { continue; }
+    if ( 0 == strcmp( line, "end_header" ) ) {
+      hdr_ptr->body_offset = offset;
+      return true;
+    }
+    if ( 2 == sscanf( line, "element %63s %lld", a, &count ) ) {
+      if ( hdr_ptr->n_elements >= _PLY_MAX_ELEMENTS || count < 0 ) {
+        fprintf( stderr, "ERROR: too many elements, or a negative count, in file `%s`\n", filename );
+        return false;
+      }
+      element_ptr        = &hdr_ptr->elements[hdr_ptr->n_elements++];
+      element_ptr->count = count;
+      memcpy( element_ptr->name, a, _PLY_MAX_NAME );
+      continue;
+    }
+    if ( !element_ptr ) { continue; }
+    if ( element_ptr->n_properties >= _PLY_MAX_PROPERTIES ) {
+      fprintf( stderr, "ERROR: too many properties in element `%s` in file `%s`\n", element_ptr->name, filename );
+      return false;
+    }
+    ply_property_t* prop_ptr = &element_ptr->properties[element_ptr->n_properties];
+    if ( 4 == sscanf( line, "property %63s %63s %63s %63s", a, b, c, d ) && 0 == strcmp( a, "list" ) ) {
+      prop_ptr->count_type = _ply_type_from_str( b );
+      prop_ptr->type       = _ply_type_from_str( c );
+      memcpy( prop_ptr->name, d, _PLY_MAX_NAME );
+      if ( PLY_TYPE_NONE == prop_ptr->count_type || PLY_TYPE_FLOAT32 == prop_ptr->count_type || PLY_TYPE_FLOAT64 == prop_ptr->count_type ) {
+        prop_ptr->count_type = PLY_TYPE_NONE;
+      }
+    } else if ( 2 == sscanf( line, "property %63s %63s", a, b ) ) {
+      prop_ptr->type = _ply_type_from_str( a );
+      memcpy( prop_ptr->name, b, _PLY_MAX_NAME );
+    } else {
+      continue;
+    }
+    if ( PLY_TYPE_NONE == prop_ptr->type || ( 0 == strcmp( a, "list" ) && PLY_TYPE_NONE == prop_ptr->count_type ) ) {
+      fprintf( stderr, "ERROR: unsupported property `%s` in file `%s`\n", line, filename );
+      return false;
+    }
+    // offsets and strides are known until the first list.
+    bool fixed_so_far = 0 == element_ptr->n_properties || element_ptr->stride > 0;
+    prop_ptr->offset  = fixed_so_far ? element_ptr->stride : -1;
+    if ( fixed_so_far && PLY_TYPE_NONE == prop_ptr->count_type ) {
+      element_ptr->stride += _ply_type_sizes[prop_ptr->type];
+    } else {
+      element_ptr->stride = 0;
+    }
+    element_ptr->n_properties++;
+  }
+  fprintf( stderr, "ERROR: 'end_header' missing in file `%s`\n", filename );
+  return false;
+}
+
+static const ply_element_t* _ply_find_element( const ply_header_t* hdr_ptr, const char* name ) {
+  for ( int i = 0; i < hdr_ptr->n_elements; i++ ) {
+    if ( 0 == strcmp( hdr_ptr->elements[i].name, name ) ) { return &hdr_ptr->elements[i]; }
+  }
+  return NULL;
+}
+
+// the size in bytes of one item of an element with lists, or 0 if it would run past `end_ptr`.
+static size_t _ply_item_size( const ply_element_t* element_ptr, const uint8_t* item_ptr, const uint8_t* end_ptr ) {
+  const uint8_t* ptr = item_ptr;
+  for ( int i = 0; i < element_ptr->n_properties; i++ ) {
+    const ply_property_t* prop_ptr = &element_ptr->properties[i];
+    if ( PLY_TYPE_NONE == prop_ptr->count_type ) {
+      ptr += _ply_type_sizes[prop_ptr->type];
+      continue;
+    }
+    if ( end_ptr - ptr < _ply_type_sizes[prop_ptr->count_type] ) { return 0; }
+    int64_t count = _ply_get_int( ptr, prop_ptr->count_type );
+    if ( count < 0 ) { return 0; }
+    ptr += _ply_type_sizes[prop_ptr->count_type] + count * _ply_type_sizes[prop_ptr->type];
+    if ( ptr > end_ptr ) { return 0; }
+  }
+  return ptr <= end_ptr ? (size_t)( ptr - item_ptr ) : 0;
+}
+
+// finds where each element's data starts. returns false if the data is shorter than the header says.
+static bool _ply_find_element_data( const ply_header_t* hdr_ptr, const uint8_t* data_ptr, size_t sz, const uint8_t** starts_ptr ) {
+  const uint8_t* ptr = &data_ptr[hdr_ptr->body_offset];
+  const uint8_t* end = &data_ptr[sz];
+  for ( int i = 0; i < hdr_ptr->n_elements; i++ ) {
+    const ply_element_t* element_ptr = &hdr_ptr->elements[i];
+    starts_ptr[i]                    = ptr;
+    if ( element_ptr->stride > 0 ) {
+      if ( (uint64_t)element_ptr->count > (uint64_t)( end - ptr ) / (uint64_t)element_ptr->stride ) { return false; }
+      ptr += element_ptr->count * element_ptr->stride;
+      continue;
+    }
+    if ( 0 == element_ptr->n_properties && 0 == element_ptr->count ) { continue; }
+    for ( int64_t j = 0; j < element_ptr->count; j++ ) {
+      size_t item_sz = _ply_item_size( element_ptr, ptr, end );
+      if ( !item_sz ) { return false; }
+      ptr += item_sz;
+    }
+  }
+  return true;
+}
+
+static void _ply_find_layout( const ply_element_t* vertex_ptr, ply_layout_t* layout_ptr ) {
+  memset( layout_ptr, 0, sizeof( ply_layout_t ) );
+  for ( int p = 0; p < vertex_ptr->n_properties; p++ ) {
+    const ply_property_t* prop_ptr = &vertex_ptr->properties[p];
+    if ( PLY_TYPE_NONE != prop_ptr->count_type ) { continue; }
+    for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+      for ( int c = 0; c < 4; c++ ) {
+        for ( int n = 0; n < 3; n++ ) {
+          const char* name = _ply_stream_names[s][c][n];
+          if ( name && 0 == strcmp( name, prop_ptr->name ) && !layout_ptr->props[s][c] ) {
+            layout_ptr->props[s][c] = prop_ptr;
+            layout_ptr->n_comps[s]++;
+          }
+        }
+      }
+    }
+  }
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    const ply_property_t* first_ptr = layout_ptr->props[s][0];
+    layout_ptr->packed[s]           = layout_ptr->n_comps[s] > 0 && first_ptr; // no first component, e.g. green without red, fails _ply_layout_is_valid().
+    for ( int c = 0; layout_ptr->packed[s] && c < layout_ptr->n_comps[s]; c++ ) {
+      const ply_property_t* prop_ptr = layout_ptr->props[s][c];
+      if ( !prop_ptr || PLY_TYPE_FLOAT32 != prop_ptr->type || prop_ptr->offset < 0 || prop_ptr->offset != first_ptr->offset + c * (int)sizeof( float ) ) {
+        layout_ptr->packed[s] = false;
+      }
+    }
+  }
+}
+
+// same rules as ascii files: whole vectors, and rgb or rgba colours.
+static bool _ply_layout_is_valid( const ply_layout_t* layout_ptr ) {
+  const int* n = layout_ptr->n_comps;
+  if ( ( n[PLY_STREAM_POSITIONS] != 0 && n[PLY_STREAM_POSITIONS] != 3 ) || ( n[PLY_STREAM_NORMALS] != 0 && n[PLY_STREAM_NORMALS] != 3 ) ||
+       ( n[PLY_STREAM_TEXCOORDS] != 0 && n[PLY_STREAM_TEXCOORDS] != 2 ) ||
+       ( n[PLY_STREAM_COLOURS] != 0 && n[PLY_STREAM_COLOURS] != 3 && n[PLY_STREAM_COLOURS] != 4 ) ) {
+    return false;
+  }
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    for ( int c = 0; c < n[s]; c++ ) {
+      if ( !layout_ptr->props[s][c] ) { return false; } // e.g. red, green, alpha.
+    }
+  }
+  return true;
+}
+
+// copies a vertex into `streams` at `dst_idx`, converting anything that isn't already packed floats.
+static inline void _ply_copy_vertex( const ply_layout_t* layout_ptr, const uint8_t* vertex_ptr, float* const* streams, int dst_idx ) {
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    int n = layout_ptr->n_comps[s];
+    if ( !n ) { continue; }
+    float* dst_ptr = &streams[s][(size_t)dst_idx * n];
+    if ( layout_ptr->packed[s] ) {
+      memcpy( dst_ptr, &vertex_ptr[layout_ptr->props[s][0]->offset], n * sizeof( float ) );
+      continue;
+    }
+    for ( int c = 0; c < n; c++ ) {
+      const ply_property_t* prop_ptr = layout_ptr->props[s][c];
+      double v                       = _ply_get( &vertex_ptr[prop_ptr->offset], prop_ptr->type );
+      if ( PLY_STREAM_COLOURS == s ) { v /= _ply_type_maxes[prop_ptr->type]; }
+      dst_ptr[c] = (float)v;
+    }
+  }
+}
+
+// the vertex index list property of the face element, or -1.
+static int _ply_face_indices_property( const ply_element_t* face_ptr ) {
+  for ( int i = 0; i < face_ptr->n_properties; i++ ) {
+    const ply_property_t* prop_ptr = &face_ptr->properties[i];
+    bool is_int                    = PLY_TYPE_FLOAT32 != prop_ptr->type && PLY_TYPE_FLOAT64 != prop_ptr->type;
+    bool is_indices                = 0 == strcmp( prop_ptr->name, "vertex_indices" ) || 0 == strcmp( prop_ptr->name, "vertex_index" );
+    if ( PLY_TYPE_NONE != prop_ptr->count_type && is_int && is_indices ) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// reads one face's index list, of up to 4 indices, and returns a pointer to the next face, or NULL if the face runs past `end_ptr`.
+static inline const uint8_t* _ply_read_face( const ply_element_t* face_ptr, int indices_prop, const uint8_t* ptr, const uint8_t* end_ptr, int64_t* indices,
+  int64_t* n_indices_ptr ) {
+  *n_indices_ptr = 0;
+  // most files have only `list uchar int vertex_indices`.
+  if ( 1 == face_ptr->n_properties && PLY_TYPE_UINT8 == face_ptr->properties[0].count_type &&
+       ( PLY_TYPE_INT32 == face_ptr->properties[0].type || PLY_TYPE_UINT32 == face_ptr->properties[0].type ) ) {
+    if ( ptr >= end_ptr || end_ptr - ptr - 1 < ptr[0] * 4 ) { return NULL; }
+    int count = ptr[0];
+    for ( int j = 0; j < count && j < 4; j++ ) {
+      int32_t idx;
+      memcpy( &idx, &ptr[1 + j * 4], sizeof( idx ) );
+      indices[j] = idx;
+    }
+    *n_indices_ptr = count;
+    return &ptr[1 + count * 4];
+  }
+  for ( int i = 0; i < face_ptr->n_properties; i++ ) {
+    const ply_property_t* prop_ptr = &face_ptr->properties[i];
+    int item_sz                    = _ply_type_sizes[prop_ptr->type];
+    if ( PLY_TYPE_NONE == prop_ptr->count_type ) {
+      ptr += item_sz;
+      if ( ptr > end_ptr ) { return NULL; }
+      continue;
+    }
+    int count_sz = _ply_type_sizes[prop_ptr->count_type];
+    if ( end_ptr - ptr < count_sz ) { return NULL; }
+    int64_t count = _ply_get_int( ptr, prop_ptr->count_type );
+    ptr += count_sz;
+    if ( count < 0 || count > ( end_ptr - ptr ) / item_sz ) { return NULL; }
+    if ( i == indices_prop ) {
+      *n_indices_ptr = count;
+      for ( int64_t j = 0; j < count && j < 4; j++ ) { indices[j] = _ply_get_int( &ptr[j * item_sz], prop_ptr->type ); }
+    }
+    ptr += count * item_sz;
+  }
+  return ptr;
+}
+
+// a vertex element of packed floats, one per component in stream order, as the ascii reader stores its vertices.
+static void _ply_float_element( apg_ply_t ply, ply_element_t* element_ptr ) {
+  const int n_comps[PLY_STREAM_MAX] = { ply.n_positions_comps, ply.n_normals_comps, ply.n_texcoords_comps, ply.n_colours_comps };
+  memset( element_ptr, 0, sizeof( ply_element_t ) );
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    for ( int c = 0; c < n_comps[s]; c++ ) {
+      ply_property_t* prop_ptr = &element_ptr->properties[element_ptr->n_properties++];
+      strcpy( prop_ptr->name, _ply_stream_names[s][c][0] );
+      prop_ptr->type   = PLY_TYPE_FLOAT32;
+      prop_ptr->offset = element_ptr->stride;
+      element_ptr->stride += (int)sizeof( float );
+    }
+  }
+}
+
+// MurmurHash3 (x86, 32-bit) over the bits of vertex `idx`'s components. it mixes every bit of each word, which matters because floats
+// such as grid coordinates often have all-zero low mantissas.
+static uint32_t _ply_hash_vertex( float* const* streams, const int* n_comps, int idx ) {
+  uint32_t hash = 0;
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    for ( int c = 0; c < n_comps[s]; c++ ) {
+      uint32_t k;
+      memcpy( &k, &streams[s][(size_t)idx * n_comps[s] + c], sizeof( k ) );
+      k *= 0xcc9e2d51u;
+      k = ( k << 15 ) | ( k >> 17 );
+      k *= 0x1b873593u;
+      hash ^= k;
+      hash = ( hash << 13 ) | ( hash >> 19 );
+      hash = hash * 5 + 0xe6546b64u;
+    }
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  return hash ^ ( hash >> 16 );
+}
+
+// bitwise, so -0 and 0 are different vertices, and NaNs with the same bits are the same.
+static bool _ply_vertices_equal( float* const* streams, const int* n_comps, int a, int b ) {
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    if ( n_comps[s] && 0 != memcmp( &streams[s][(size_t)a * n_comps[s]], &streams[s][(size_t)b * n_comps[s]], n_comps[s] * sizeof( float ) ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#define _PLY_CACHE_SIZE 32   // entries in the LRU cache modelled by the vertex cache optimiser.
+#define _PLY_MAX_VALENCE 64  // valence scores are tabulated up to here. vertices in more triangles than this share the last score.
+
+static float _ply_vertex_score( int cache_pos, int n_tris_left, const float* cache_scores, const float* valence_scores ) {
+  if ( 0 == n_tris_left ) { return -1.0f; } // nothing left to draw with this vertex.
+  float score = cache_pos >= 0 ? cache_scores[cache_pos] : 0.0f;
+  return score + valence_scores[APG_MIN( n_tris_left, _PLY_MAX_VALENCE - 1 )];
+}
+
+// reorders the triangles of `indices` with Tom Forsyth's algorithm. returns false, with `indices` unchanged, on running out of memory.
+static bool _ply_forsyth( uint32_t* indices, int n_indices, int n_vertices, apg_arena_t* scratch_ptr ) {
+  int n_tris = n_indices / 3;
+  if ( n_tris < 2 ) { return true; }
+  // the 3 vertices of the last triangle get a fixed score, so the next triangle doesn't just favour whichever was listed last.
+  float cache_scores[_PLY_CACHE_SIZE], valence_scores[_PLY_MAX_VALENCE];
+  for ( int i = 0; i < _PLY_CACHE_SIZE; i++ ) {
+    cache_scores[i] = i < 3 ? 0.75f : powf( 1.0f - ( i - 3 ) / (float)( _PLY_CACHE_SIZE - 3 ), 1.5f );
+  }
+  valence_scores[0] = 0.0f;
+  for ( int i = 1; i < _PLY_MAX_VALENCE; i++ ) { valence_scores[i] = 2.0f * powf( (float)i, -0.5f ); }
+
+  bool ok            = false;
+  int32_t* offsets   = _ply_alloc( scratch_ptr, sizeof( int32_t ) * ( (size_t)n_vertices + 1 ) );
+  int32_t* n_left    = _ply_alloc( scratch_ptr, sizeof( int32_t ) * n_vertices ); // triangles not yet output, for each vertex.
+  int32_t* cache_pos = _ply_alloc( scratch_ptr, sizeof( int32_t ) * n_vertices );
+  float* scores      = _ply_alloc( scratch_ptr, sizeof( float ) * n_vertices );
+  int32_t* tris_ptr  = _ply_alloc( scratch_ptr, sizeof( int32_t ) * n_indices ); // each vertex's triangles, from offsets[v], live ones first.
+  uint8_t* added_ptr = _ply_alloc( scratch_ptr, n_tris );
+  uint32_t* out_ptr  = _ply_alloc( scratch_ptr, sizeof( uint32_t ) * n_indices );
+  if ( !offsets || !n_left || !cache_pos || !scores || !tris_ptr || !added_ptr || !out_ptr ) { goto free_and_return; }
+
+  memset( n_left, 0, sizeof( int32_t ) * n_vertices );
+  memset( added_ptr, 0, n_tris );
+  for ( int i = 0; i < n_indices; i++ ) { n_left[indices[i]]++; }
+  offsets[0] = 0;
+  for ( int v = 0; v < n_vertices; v++ ) {
+    offsets[v + 1] = offsets[v] + n_left[v];
+    cache_pos[v]   = 0; // used as a fill count here.
+  }
+  for ( int i = 0; i < n_indices; i++ ) { tris_ptr[offsets[indices[i]] + cache_pos[indices[i]]++] = i / 3; }
+  for ( int v = 0; v < n_vertices; v++ ) {
+    cache_pos[v] = -1;
+    scores[v]    = _ply_vertex_score( -1, n_left[v], cache_scores, valence_scores );
+  }
+  int best_tri     = -1;
+  float best_score = -1.0f;
+  for ( int t = 0; t < n_tris; t++ ) {
+    float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    if ( score > best_score ) {
+      best_score = score;
+      best_tri   = t;
+    }
+  }
+
+  // the cache grows by up to 3 while a triangle is added, before the oldest entries drop off the end.
+  uint32_t cache[_PLY_CACHE_SIZE + 3], next_cache[_PLY_CACHE_SIZE + 3];
+  int cache_len = 0, cursor = 0;
+  for ( int out_tri = 0; out_tri < n_tris; out_tri++ ) {
+    // if no triangle touches the cache, start on the first one not yet added.
+    if ( best_tri < 0 ) {
+      while ( added_ptr[cursor] ) { cursor++; }
+      best_tri = cursor;
+    }
+    int t        = best_tri;
+    added_ptr[t] = 1;
+    int next_len = 0;
+    for ( int c = 0; c < 3; c++ ) {
+      uint32_t v               = indices[t * 3 + c];
+      out_ptr[out_tri * 3 + c] = v;
+      int32_t* list_ptr        = &tris_ptr[offsets[v]];
+      for ( int k = 0; k < n_left[v]; k++ ) {
+        if ( list_ptr[k] == t ) {
+          list_ptr[k] = list_ptr[--n_left[v]];
+          break;
+        }
+      }
+      bool dup = false;
+      for ( int k = 0; k < next_len; k++ ) { dup |= next_cache[k] == v; }
+      if ( !dup ) { next_cache[next_len++] = v; }
+    }
+    int n_new = next_len;
+    for ( int k = 0; k < cache_len; k++ ) {
+      bool in_tri = false;
+      for ( int j = 0; j < n_new; j++ ) { in_tri |= next_cache[j] == cache[k]; }
+      if ( !in_tri ) { next_cache[next_len++] = cache[k]; }
+    }
+    for ( int k = 0; k < next_len; k++ ) {
+      uint32_t v   = next_cache[k];
+      cache_pos[v] = k < _PLY_CACHE_SIZE ? k : -1;
+      scores[v]    = _ply_vertex_score( cache_pos[v], n_left[v], cache_scores, valence_scores );
+    }
+    // only triangles of vertices in the cache, or just evicted, have changed score. the best of those is next.
+    best_tri   = -1;
+    best_score = -1.0f;
+    for ( int k = 0; k < next_len; k++ ) {
+      uint32_t v = next_cache[k];
+      for ( int j = 0; j < n_left[v]; j++ ) {
+        int tt      = tris_ptr[offsets[v] + j];
+        float score = scores[indices[tt * 3]] + scores[indices[tt * 3 + 1]] + scores[indices[tt * 3 + 2]];
+        if ( score > best_score ) {
+          best_score = score;
+          best_tri   = tt;
+        }
+      }
+    }
+    cache_len = APG_MIN( next_len, _PLY_CACHE_SIZE );
+    memcpy( cache, next_cache, sizeof( uint32_t ) * cache_len );
+  }
+  memcpy( indices, out_ptr, sizeof( uint32_t ) * n_indices );
+  ok = true;
+
+free_and_return:
+  _ply_free( scratch_ptr, offsets );
+  _ply_free( scratch_ptr, n_left );
+  _ply_free( scratch_ptr, cache_pos );
+  _ply_free( scratch_ptr, scores );
+  _ply_free( scratch_ptr, tris_ptr );
+  _ply_free( scratch_ptr, added_ptr );
+  _ply_free( scratch_ptr, out_ptr );
+  return ok;
+}
+
+// vertex cache then vertex fetch order, in place. returns false, with nothing changed, on running out of memory.
+static bool _ply_optimise( float* const* streams, const int* n_comps, int n_vertices, uint32_t* indices, int n_indices, apg_arena_t* scratch_ptr ) {
+  int max_comps = 0;
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) { max_comps = APG_MAX( max_comps, n_comps[s] ); }
+  bool ok        = false;
+  int32_t* remap = _ply_alloc( scratch_ptr, sizeof( int32_t ) * n_vertices );
+  float* tmp_ptr = _ply_alloc( scratch_ptr, sizeof( float ) * max_comps * n_vertices );
+  if ( !remap || !tmp_ptr || !_ply_forsyth( indices, n_indices, n_vertices, scratch_ptr ) ) { goto free_and_return; }
+
+  // number vertices by first use. any no triangle uses go at the end.
+  memset( remap, 0xFF, sizeof( int32_t ) * n_vertices );
+  int next = 0;
+  for ( int i = 0; i < n_indices; i++ ) {
+    if ( remap[indices[i]] < 0 ) { remap[indices[i]] = next++; }
+    indices[i] = (uint32_t)remap[indices[i]];
+  }
+  for ( int v = 0; v < n_vertices; v++ ) {
+    if ( remap[v] < 0 ) { remap[v] = next++; }
+  }
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    int n = n_comps[s];
+    if ( !n ) { continue; }
+    for ( int v = 0; v < n_vertices; v++ ) { memcpy( &tmp_ptr[(size_t)remap[v] * n], &streams[s][(size_t)v * n], n * sizeof( float ) ); }
+    memcpy( streams[s], tmp_ptr, sizeof( float ) * n * n_vertices );
+  }
+  ok = true;
+
+free_and_return:
+  _ply_free( scratch_ptr, remap );
+  _ply_free( scratch_ptr, tmp_ptr );
+  return ok;
+}
+
+/* Builds ply_ptr's streams and indices from `n_corners` triangle corners, which index the `n_src` vertices at `vertices_ptr`.
+Source vertices are converted once, on first use, then welded with any identical vertex converted before, through a hash table, so
+vertices are numbered in order of first use. `corners` is rewritten with the new numbers. */
+static bool _ply_build_indexed( apg_ply_t* ply_ptr, const ply_layout_t* layout_ptr, const uint8_t* vertices_ptr, int stride, int n_src, uint32_t* corners,
+  int n_corners, unsigned int flags, apg_arena_t* arena_ptr, apg_arena_t* scratch_ptr ) {
+  const int* n_comps = layout_ptr->n_comps;
+  if ( 0 == n_corners ) { return true; } // no triangles, as with the other readers.
+  size_t table_n = 1;
+  while ( table_n < (size_t)n_src * 2 ) { table_n <<= 1; }
+  bool ok                       = false;
+  float* welded[PLY_STREAM_MAX] = { NULL };
+  int32_t* remap                = _ply_alloc( scratch_ptr, sizeof( int32_t ) * n_src );
+  int32_t* table_ptr            = _ply_alloc( scratch_ptr, sizeof( int32_t ) * table_n );
+  bool welded_ok                = true;
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    if ( n_comps[s] ) { welded[s] = _ply_alloc( scratch_ptr, sizeof( float ) * n_comps[s] * n_src ); }
+    welded_ok &= !n_comps[s] || welded[s];
+  }
+  if ( !remap || !table_ptr || !welded_ok ) { goto free_and_return; }
+  memset( remap, 0xFF, sizeof( int32_t ) * n_src );
+  memset( table_ptr, 0xFF, sizeof( int32_t ) * table_n );
+
+  int n_unique = 0;
+  for ( int i = 0; i < n_corners; i++ ) {
+    uint32_t src = corners[i];
+    if ( remap[src] < 0 ) {
+      // convert into the next free slot. it's only kept if no identical vertex is already in the table.
+      _ply_copy_vertex( layout_ptr, &vertices_ptr[(size_t)src * stride], welded, n_unique );
+      size_t slot = _ply_hash_vertex( welded, n_comps, n_unique ) & ( table_n - 1 );
+      while ( table_ptr[slot] >= 0 && !_ply_vertices_equal( welded, n_comps, table_ptr[slot], n_unique ) ) { slot = ( slot + 1 ) & ( table_n - 1 ); }
+      if ( table_ptr[slot] < 0 ) { table_ptr[slot] = n_unique++; }
+      remap[src] = table_ptr[slot];
+    }
+    corners[i] = (uint32_t)remap[src];
+  }
+  if ( ( flags & APG_PLY_OPTIMISE ) && !_ply_optimise( welded, n_comps, n_unique, corners, n_corners, scratch_ptr ) ) { goto free_and_return; }
+
+  float** dsts[PLY_STREAM_MAX] = { &ply_ptr->positions_ptr, &ply_ptr->normals_ptr, &ply_ptr->texcoords_ptr, &ply_ptr->colours_ptr };
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    if ( !n_comps[s] ) { continue; }
+    *dsts[s] = _ply_alloc( arena_ptr, sizeof( float ) * n_comps[s] * n_unique );
+    if ( !*dsts[s] ) { goto free_and_return; }
+    memcpy( *dsts[s], welded[s], sizeof( float ) * n_comps[s] * n_unique );
+  }
+  ply_ptr->index_sz    = ( flags & APG_PLY_INDICES_16 ) && n_unique <= 65536 ? 2 : 4;
+  ply_ptr->indices_ptr = _ply_alloc( arena_ptr, (size_t)ply_ptr->index_sz * n_corners );
+  if ( !ply_ptr->indices_ptr ) { goto free_and_return; }
+  if ( 2 == ply_ptr->index_sz ) {
+    for ( int i = 0; i < n_corners; i++ ) { ( (uint16_t*)ply_ptr->indices_ptr )[i] = (uint16_t)corners[i]; }
+  } else {
+    memcpy( ply_ptr->indices_ptr, corners, sizeof( uint32_t ) * n_corners );
+  }
+  ply_ptr->n_indices  = n_corners;
+  ply_ptr->n_vertices = n_unique;
+  ok                  = true;
+
+free_and_return:
+  _ply_free( scratch_ptr, remap );
+  _ply_free( scratch_ptr, table_ptr );
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) { _ply_free( scratch_ptr, welded[s] ); }
+  return ok;
+}
+
+static apg_ply_t _ply_read_binary( const char* filename, bool indexed, unsigned int flags, apg_arena_t* arena_ptr, apg_arena_t* scratch_ptr ) {
+  apg_ply_t ply                 = ( apg_ply_t ){ .loaded = 0 };
+  apg_arena_mark_t arena_mark   = apg_arena_mark( arena_ptr );
+  apg_arena_mark_t scratch_mark = apg_arena_mark( scratch_ptr );
+  apg_file_t file               = ( apg_file_t ){ .data_ptr = NULL };
+  uint32_t* corners_ptr         = NULL;
+  ply_header_t hdr;
+  ply_layout_t layout;
+  const uint8_t* starts[_PLY_MAX_ELEMENTS] = { NULL };
+
+  if ( !_ply_host_is_little_endian() ) {
+    fprintf( stderr, "ERROR: binary ply files are only supported on little-endian machines, reading `%s`\n", filename );
+    return ply;
+  }
+  if ( !apg_file_map( filename, &file ) ) {
+    fprintf( stderr, "ERROR: couldn't map ply file `%s` - is path correct?\n", filename );
+    return ply;
+  }
+  const uint8_t* data_ptr = file.data_ptr;
+  const uint8_t* end_ptr  = &data_ptr[file.sz];
+  if ( !_ply_parse_header( data_ptr, file.sz, filename, &hdr ) ) { goto free_and_return_ply; }
+  if ( !_ply_find_element_data( &hdr, data_ptr, file.sz, starts ) ) {
+    fprintf( stderr, "ERROR: file `%s` is shorter than its header says\n", filename );
+    goto free_and_return_ply;
+  }
+  const ply_element_t* vertex_ptr = _ply_find_element( &hdr, "vertex" );
+  const ply_element_t* face_ptr   = _ply_find_element( &hdr, "face" );
+  if ( !vertex_ptr || vertex_ptr->stride <= 0 || vertex_ptr->count > INT32_MAX ) {
+    fprintf( stderr, "ERROR: missing vertex element, or vertex element with lists, or too many vertices in file `%s`\n", filename );
+    goto free_and_return_ply;
+  }
+  _ply_find_layout( vertex_ptr, &layout );
+  if ( !_ply_layout_is_valid( &layout ) ) {
+    fprintf( stderr, "ERROR: unsupported count of vertex components\n" );
+    goto free_and_return_ply;
+  }
+  ply.n_positions_comps = layout.n_comps[PLY_STREAM_POSITIONS];
+  ply.n_normals_comps   = layout.n_comps[PLY_STREAM_NORMALS];
+  ply.n_texcoords_comps = layout.n_comps[PLY_STREAM_TEXCOORDS];
+  ply.n_colours_comps   = layout.n_comps[PLY_STREAM_COLOURS];
+
+  // count the vertices triangulated faces will need, and check the faces, before allocating anything.
+  int64_t n_finals = 0;
+  int indices_prop = -1;
+  if ( face_ptr ) {
+    indices_prop = _ply_face_indices_property( face_ptr );
+    if ( indices_prop < 0 ) {
+      fprintf( stderr, "ERROR: face element without a vertex_indices list in file `%s`\n", filename );
+      goto free_and_return_ply;
+    }
+    const uint8_t* ptr = starts[face_ptr - hdr.elements];
+    for ( int64_t i = 0; i < face_ptr->count; i++ ) {
+      int64_t indices[4], n_indices = 0;
+      ptr = _ply_read_face( face_ptr, indices_prop, ptr, end_ptr, indices, &n_indices );
+      if ( !ptr ) {
+        fprintf( stderr, "ERROR: file `%s` is shorter than its header says\n", filename );
+        goto free_and_return_ply;
+      }
+      if ( 3 != n_indices && 4 != n_indices ) {
+        fprintf( stderr, "ERROR: unsupported number of vertices per polygon in a face. only 3 and 4 supported\n" );
+        goto free_and_return_ply;
+      }
+      for ( int j = 0; j < n_indices; j++ ) {
+        if ( indices[j] < 0 || indices[j] >= vertex_ptr->count ) {
+          fprintf( stderr, "ERROR: face index %lli out of range in file `%s`\n", (long long)indices[j], filename );
+          goto free_and_return_ply;
+        }
+      }
+      n_finals += 4 == n_indices ? 6 : 3;
+    }
+    if ( n_finals > INT32_MAX ) {
+      fprintf( stderr, "ERROR: too many vertices after triangulating faces in file `%s`\n", filename );
+      goto free_and_return_ply;
+    }
+  }
+  // with no faces there are no triangles, as with ascii files.
+  if ( indexed && n_finals > 0 ) {
+    corners_ptr = _ply_alloc( scratch_ptr, sizeof( uint32_t ) * n_finals );
+    if ( !corners_ptr ) {
+      fprintf( stderr, "ERROR: out of memory reading file `%s`\n", filename );
+      goto free_and_return_ply;
+    }
+    const uint8_t* ptr = starts[face_ptr - hdr.elements];
+    int n              = 0;
+    for ( int64_t i = 0; i < face_ptr->count; i++ ) {
+      int64_t indices[4], n_indices = 0;
+      ptr = _ply_read_face( face_ptr, indices_prop, ptr, end_ptr, indices, &n_indices );
+      // TODO(Anton) check winding order for quad/tri
+      int64_t quad[] = { indices[0], indices[1], indices[2], indices[2], indices[3], indices[0] };
+      for ( int j = 0; j < ( 4 == n_indices ? 6 : 3 ); j++ ) { corners_ptr[n++] = (uint32_t)quad[j]; }
+    }
+    if ( !_ply_build_indexed( &ply, &layout, starts[vertex_ptr - hdr.elements], vertex_ptr->stride, (int)vertex_ptr->count, corners_ptr, n, flags, arena_ptr,
+           scratch_ptr ) ) {
+      fprintf( stderr, "ERROR: out of memory reading file `%s`\n", filename );
+      goto free_and_return_ply;
+    }
+  } else if ( n_finals > 0 ) {
+    if ( ply.n_positions_comps > 0 ) { ply.positions_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_positions_comps * n_finals ); }
+    if ( ply.n_normals_comps > 0 ) { ply.normals_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_normals_comps * n_finals ); }
+    if ( ply.n_texcoords_comps > 0 ) { ply.texcoords_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_texcoords_comps * n_finals ); }
+    if ( ply.n_colours_comps > 0 ) { ply.colours_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_colours_comps * n_finals ); }
+    if ( ( ply.n_positions_comps > 0 && !ply.positions_ptr ) || ( ply.n_normals_comps > 0 && !ply.normals_ptr ) ||
+         ( ply.n_texcoords_comps > 0 && !ply.texcoords_ptr ) || ( ply.n_colours_comps > 0 && !ply.colours_ptr ) ) {
+      fprintf( stderr, "ERROR: out of memory reading file `%s`\n", filename );
+      goto free_and_return_ply;
+    }
+    const uint8_t* vertices_ptr    = starts[vertex_ptr - hdr.elements];
+    const uint8_t* ptr             = starts[face_ptr - hdr.elements];
+    float* streams[PLY_STREAM_MAX] = { ply.positions_ptr, ply.normals_ptr, ply.texcoords_ptr, ply.colours_ptr };
+    int n                          = 0;
+    for ( int64_t i = 0; i < face_ptr->count; i++ ) {
+      int64_t indices[4], n_indices = 0;
+      ptr = _ply_read_face( face_ptr, indices_prop, ptr, end_ptr, indices, &n_indices );
+      // TODO(Anton) check winding order for quad/tri
+      int64_t corners[] = { indices[0], indices[1], indices[2], indices[2], indices[3], indices[0] };
+      for ( int j = 0; j < ( 4 == n_indices ? 6 : 3 ); j++ ) { _ply_copy_vertex( &layout, &vertices_ptr[corners[j] * vertex_ptr->stride], streams, n++ ); }
+    }
+    ply.n_vertices = (int)n_finals;
+  }
+  ply.loaded = 1;
+free_and_return_ply:
+  apg_file_unmap( &file );
+  _ply_free( scratch_ptr, corners_ptr );
+  if ( scratch_ptr ) { apg_arena_reset_to_mark( scratch_ptr, scratch_mark ); }
+  if ( !ply.loaded ) {
+    if ( !arena_ptr ) {
+      apg_ply_delete( &ply );
+    } else {
+      apg_arena_reset_to_mark( arena_ptr, arena_mark );
+      ply = ( apg_ply_t ){ .loaded = 0 };
+    }
+  }
+  return ply;
+}
+
+/* ascii bodies are parsed straight from the mapped file. The body is split into chunks of whole lines, and chunks are parsed on the apg.h
+job threads if apg_jobs_init() has been called, or on this thread if not. A first pass counts each chunk's lines, so each chunk knows
+which vertex or face its first line is. Numbers are scanned by hand rather than with sscanf(), which looks up the locale on every call,
+but give the same results. */
+
+#define _PLY_ASCII_CHUNK ( 1 << 20 ) // bytes of body per chunk, rounded up to the end of a line.
+
+static const double _ply_pow10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+  1e21, 1e22 }; // all exact in a double.
+
+// the whitespace scanf() skips, apart from line endings.
+static inline bool _ply_is_space( char c ) { return ' ' == c || '\t' == c || '\r' == c || '\v' == c || '\f' == c; }
+
+// strtof() on a copy of the token, for anything the fast path below can't convert exactly.
+static const char* _ply_parse_float_slow( const char* ptr, const char* end_ptr, float* f_ptr ) {
+  char token[64];
+  int len = 0;
+  while ( ptr + len < end_ptr && len < 63 && !_ply_is_space( ptr[len] ) && '\n' != ptr[len] ) {
+    token[len] = ptr[len];
+    len++;
+  }
+  token[len]      = '\0';
+  char* token_end = NULL;
+  *f_ptr          = strtof( token, &token_end );
+  return token_end == token ? NULL : ptr + ( token_end - token );
+}
+
+/* Skips spaces and parses a float the way sscanf( "%f" ) does, returning a pointer past it, or NULL if there isn't a number there.
+Decimal numbers with up to 19 significant digits and small exponents are done as Clinger's fast path: the digits as an exact integer,
+multiplied or divided by an exact power of ten, gives the correctly rounded double. Rounding that to float is then also correct unless
+the double landed exactly halfway between two floats, which goes to strtof(), along with inf, nan, hex floats and anything else. */
+static inline const char* _ply_parse_float( const char* ptr, const char* end_ptr, float* f_ptr ) {
+  while ( ptr < end_ptr && _ply_is_space( *ptr ) ) { ptr++; }
+  const char* p     = ptr;
+  bool negative     = false;
+  uint64_t mantissa = 0;
+  int n_digits = 0, n_significant = 0, exp10 = 0;
+  if ( p < end_ptr && ( '-' == *p || '+' == *p ) ) { negative = '-' == *p++; }
+  for ( ; p < end_ptr && *p >= '0' && *p <= '9'; p++, n_digits++ ) {
+    if ( mantissa || '0' != *p ) {
+      mantissa = mantissa * 10 + (uint64_t)( *p - '0' );
+      n_significant++;
+    }
+  }
+  if ( p < end_ptr && '.' == *p ) {
+    for ( p++; p < end_ptr && *p >= '0' && *p <= '9'; p++, n_digits++, exp10-- ) {
+      if ( mantissa || '0' != *p ) {
+        mantissa = mantissa * 10 + (uint64_t)( *p - '0' );
+        n_significant++;
+      }
+    }
+  }
+  if ( !n_digits ) { return _ply_parse_float_slow( ptr, end_ptr, f_ptr ); }
+  if ( p < end_ptr && ( 'e' == *p || 'E' == *p ) ) { // like glibc's scanf(), an 'e' and sign without digits are consumed, and ignored.
+    bool e_negative = false;
+    int e           = 0;
+    p++;
+    if ( p < end_ptr && ( '-' == *p || '+' == *p ) ) { e_negative = '-' == *p++; }
+    for ( ; p < end_ptr && *p >= '0' && *p <= '9'; p++ ) {
+      if ( e < 10000 ) { e = e * 10 + ( *p - '0' ); }
+    }
+    exp10 += e_negative ? -e : e;
+  }
+  if ( n_significant > 19 || ( p < end_ptr && ( 'x' == *p || 'X' == *p ) ) ) { return _ply_parse_float_slow( ptr, end_ptr, f_ptr ); }
+  if ( 0 == mantissa ) {
+    *f_ptr = negative ? -0.0f : 0.0f;
+    return p;
+  }
+  if ( mantissa >= ( (uint64_t)1 << 53 ) || exp10 < -22 || exp10 > 22 ) { return _ply_parse_float_slow( ptr, end_ptr, f_ptr ); }
+  double d = exp10 < 0 ? (double)mantissa / _ply_pow10[-exp10] : (double)mantissa * _ply_pow10[exp10];
+  uint64_t bits;
+  memcpy( &bits, &d, sizeof( bits ) );
+  if ( d < FLT_MIN || d > FLT_MAX || 0x10000000u == ( bits & 0x1FFFFFFFu ) ) { return _ply_parse_float_slow( ptr, end_ptr, f_ptr ); }
+  *f_ptr = (float)( negative ? -d : d );
+  return p;
+}
+
+// skips spaces and parses an unsigned int as sscanf( "%u" ) does, so a negative number wraps around. too-large numbers saturate.
+static inline const char* _ply_parse_uint( const char* ptr, const char* end_ptr, uint32_t* u_ptr ) {
+  while ( ptr < end_ptr && _ply_is_space( *ptr ) ) { ptr++; }
+  bool negative = false;
+  if ( ptr < end_ptr && ( '-' == *ptr || '+' == *ptr ) ) { negative = '-' == *ptr++; }
+  if ( ptr >= end_ptr || *ptr < '0' || *ptr > '9' ) { return NULL; }
+  uint64_t v = 0;
+  for ( ; ptr < end_ptr && *ptr >= '0' && *ptr <= '9'; ptr++ ) {
+    if ( v <= UINT32_MAX ) { v = v * 10 + (uint64_t)( *ptr - '0' ); }
+  }
+  v      = APG_MIN( v, (uint64_t)UINT32_MAX );
+  *u_ptr = negative ? 0u - (uint32_t)v : (uint32_t)v;
+  return ptr;
+}
+
+typedef enum ply_ascii_error_t { PLY_ASCII_OK = 0, PLY_ASCII_N_COMPS, PLY_ASCII_N_FACE_COMPS, PLY_ASCII_POLYGON, PLY_ASCII_INDEX } ply_ascii_error_t;
+
+typedef struct ply_ascii_job_t {
+  const char* body_ptr;
+  const size_t* chunk_starts; // n_chunks + 1 byte offsets into the body. each chunk starts at the start of a line.
+  int64_t* chunk_lines;       // lines starting in each chunk after the first pass, then the index of each chunk's first line.
+  int64_t v_count, f_count;
+  int total_n_comps;
+  float* v_list;
+  uint32_t* faces_ptr; // 4 indices per face. triangles have UINT32_MAX as their 4th.
+  ply_ascii_error_t* errors; // the first error in each chunk, and the count or index it's about.
+  uint32_t* error_values;
+} ply_ascii_job_t;
+
+static void _ply_count_lines( int64_t begin, int64_t end, void* arg_ptr ) {
+  ply_ascii_job_t* job_ptr = (ply_ascii_job_t*)arg_ptr;
+  for ( int64_t i = begin; i < end; i++ ) {
+    const char* ptr     = &job_ptr->body_ptr[job_ptr->chunk_starts[i]];
+    const char* end_ptr = &job_ptr->body_ptr[job_ptr->chunk_starts[i + 1]];
+    int64_t n           = 0;
+    for ( ; ptr < end_ptr; n++ ) {
+      const char* eol_ptr = memchr( ptr, '\n', end_ptr - ptr );
+      ptr                 = eol_ptr ? eol_ptr + 1 : end_ptr;
+    }
+    job_ptr->chunk_lines[i] = n;
+  }
+}
+
+// returns the error, if any, for the vertex or face on the line from ptr to end_ptr.
+static inline ply_ascii_error_t _ply_parse_ascii_line( const ply_ascii_job_t* job_ptr, int64_t line, const char* ptr, const char* end_ptr,
+  uint32_t* value_ptr ) {
+  if ( line < job_ptr->v_count ) {
+    float comps[12]; // x y z nx ny nz s t r g b a
+    int n                = 0;
+    const char* next_ptr = ptr;
+    while ( n < 12 && NULL != ( next_ptr = _ply_parse_float( next_ptr, end_ptr, &comps[n] ) ) ) { n++; }
+    if ( n != job_ptr->total_n_comps ) {
+      *value_ptr = (uint32_t)n;
+      return PLY_ASCII_N_COMPS;
+    }
+    for ( int col_idx = 8; col_idx < n; col_idx++ ) { comps[col_idx] /= 255.0f; } // rgba are really uchars and should be converted to floats
+    memcpy( &job_ptr->v_list[line * n], comps, n * sizeof( float ) );
+    return PLY_ASCII_OK;
+  }
+  // NOTE(Anton) assumes this format: property list uchar uint vertex_indices
+  uint32_t comps[5]    = { 0 }; // 4 0 1 2 3
+  int n                = 0;
+  const char* next_ptr = ptr;
+  while ( n < 5 && NULL != ( next_ptr = _ply_parse_uint( next_ptr, end_ptr, &comps[n] ) ) ) { n++; }
+  uint32_t n_poly_verts = comps[0];
+  if ( ( n < 2 ) || ( 4 == n_poly_verts && n != 5 ) || ( 3 == n_poly_verts && n != 4 ) ) {
+    *value_ptr = (uint32_t)n;
+    return PLY_ASCII_N_FACE_COMPS;
+  }
+  if ( 4 != n_poly_verts && 3 != n_poly_verts ) { return PLY_ASCII_POLYGON; }
+  for ( uint32_t j = 1; j <= n_poly_verts; j++ ) {
+    if ( comps[j] >= (uint64_t)job_ptr->v_count ) {
+      *value_ptr = comps[j];
+      return PLY_ASCII_INDEX;
+    }
+  }
+  uint32_t* face_ptr = &job_ptr->faces_ptr[( line - job_ptr->v_count ) * 4];
+  memcpy( face_ptr, &comps[1], sizeof( uint32_t ) * 4 );
+  if ( 3 == n_poly_verts ) { face_ptr[3] = UINT32_MAX; }
+  return PLY_ASCII_OK;
+}
+
+static void _ply_parse_ascii_chunks( int64_t begin, int64_t end, void* arg_ptr ) {
+  ply_ascii_job_t* job_ptr = (ply_ascii_job_t*)arg_ptr;
+  for ( int64_t i = begin; i < end; i++ ) {
+    const char* ptr     = &job_ptr->body_ptr[job_ptr->chunk_starts[i]];
+    const char* end_ptr = &job_ptr->body_ptr[job_ptr->chunk_starts[i + 1]];
+    job_ptr->errors[i]  = PLY_ASCII_OK;
+    for ( int64_t line = job_ptr->chunk_lines[i]; ptr < end_ptr && line < job_ptr->v_count + job_ptr->f_count; line++ ) {
+      const char* eol_ptr = memchr( ptr, '\n', end_ptr - ptr );
+      if ( !eol_ptr ) { eol_ptr = end_ptr; }
+      ply_ascii_error_t err = _ply_parse_ascii_line( job_ptr, line, ptr, eol_ptr, &job_ptr->error_values[i] );
+      if ( PLY_ASCII_OK != err ) {
+        job_ptr->errors[i] = err;
+        break;
+      }
+      ptr = eol_ptr + 1;
+    }
+  }
+}
+
+typedef struct ply_deindex_job_t {
+  const float* v_list;
+  const uint32_t* corners_ptr;
+  int total_n_comps;
+  float* streams[PLY_STREAM_MAX];
+  int n_comps[PLY_STREAM_MAX];
+} ply_deindex_job_t;
+
+static void _ply_deindex( int64_t begin, int64_t end, void* arg_ptr ) {
+  const ply_deindex_job_t* job_ptr = (const ply_deindex_job_t*)arg_ptr;
+  for ( int64_t i = begin; i < end; i++ ) {
+    const float* src_ptr = &job_ptr->v_list[(size_t)job_ptr->corners_ptr[i] * job_ptr->total_n_comps];
+    for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+      int n = job_ptr->n_comps[s];
+      if ( !n ) { continue; }
+      memcpy( &job_ptr->streams[s][i * n], src_ptr, n * sizeof( float ) );
+      src_ptr += n;
+    }
+  }
+}
+
+static apg_ply_t _apg_ply_read( const char* filename, bool indexed, unsigned int flags, apg_arena_t* arena_ptr, apg_arena_t* scratch_ptr ) {
   assert( filename );
   apg_ply_t ply = ( apg_ply_t ){ .loaded = 0 };
 
-  float *v_list = NULL, *v_finals = NULL;
-  int n_finals = 0;
+  float* v_list             = NULL;
+  uint32_t* faces_ptr       = NULL; // 4 indices per face, as read.
+  uint32_t* corners_ptr     = NULL; // the triangles' vertex indices, once quads are split.
+  size_t* chunk_starts      = NULL;
+  int64_t* chunk_lines      = NULL;
+  ply_ascii_error_t* errors = NULL;
+  uint32_t* error_values    = NULL;
+  int n_finals              = 0;
   int v_count = 0, f_count = 0;
+  apg_arena_mark_t arena_mark   = apg_arena_mark( arena_ptr );
+  apg_arena_mark_t scratch_mark = apg_arena_mark( scratch_ptr );
 
-  FILE* fptr = fopen( filename, "r" );
-  if ( !fptr ) {
+  apg_file_t file = ( apg_file_t ){ .data_ptr = NULL };
+  if ( !apg_file_map( filename, &file ) ) {
     fprintf( stderr, "ERROR: couldn't open ply file `%s` - is path correct?\n", filename );
     return ply;
   }
+  const uint8_t* data_ptr = file.data_ptr;
+  size_t offset = 0, body_offset = file.sz; // if there's no end_header then there's no body.
   char line[1024];
   { // hdr
-    if ( !fgets( line, 1024, fptr ) ) {
+    if ( !_ply_next_line( data_ptr, file.sz, &offset, line, 1024 ) ) {
       fprintf( stderr, "ERROR: 'fgets' failed reading file `%s`\n", filename );
       goto free_and_return_ply;
     }
@@ -70,15 +1137,19 @@ apg_ply_t apg_ply_read( const char* filename ) {
       fprintf( stderr, "ERROR: 'ply' magic number missing in file `%s`\n", filename );
       goto free_and_return_ply;
     }
-    if ( !fgets( line, 1024, fptr ) ) {
+    if ( !_ply_next_line( data_ptr, file.sz, &offset, line, 1024 ) ) {
       fprintf( stderr, "ERROR: 'fgets' failed reading file `%s`\n", filename );
       goto free_and_return_ply;
     }
+    if ( 0 == strncmp( line, "format binary_little_endian", strlen( "format binary_little_endian" ) ) ) {
+      apg_file_unmap( &file );
+      return _ply_read_binary( filename, indexed, flags, arena_ptr, scratch_ptr );
+    }
     if ( 0 != strncmp( line, "format ascii", strlen( "format ascii" ) ) ) {
       fprintf( stderr, "ERROR: 'format ascii' magic number missing in file `%s`\n", filename );
       goto free_and_return_ply;
     }
-    while ( fgets( line, 1024, fptr ) ) {
+    while ( _ply_next_line( data_ptr, file.sz, &offset, line, 1024 ) ) {
       if ( 0 == strncmp( line, "comment", strlen( "comment" ) ) ) { continue; }
       if ( 0 == strncmp( line, "element vertex", strlen( "element vertex" ) ) ) {
         if ( v_count ) { fprintf( stderr, "WARNING: more than 1 vertex section in ply file `%s`. Only 1 supported\n", filename ); }
@@ -112,7 +1183,10 @@ apg_ply_t apg_ply_read( const char* filename ) {
         continue;
       }
       if ( 0 == strncmp( line, "property list", strlen( "property list" ) ) ) { continue; }
-      if ( 0 == strncmp( line, "end_header", strlen( "end_header" ) ) ) { break; }
+      if ( 0 == strncmp( line, "end_header", strlen( "end_header" ) ) ) {
+        body_offset = offset;
+        break;
+      }
     } // endwhile
     if ( ( ply.n_positions_comps != 0 && ply.n_positions_comps != 3 ) || ( ply.n_texcoords_comps != 0 && ply.n_texcoords_comps != 2 ) ||
          ( ply.n_normals_comps != 0 && ply.n_normals_comps != 3 ) || ( ply.n_colours_comps != 0 && ply.n_colours_comps != 3 && ply.n_colours_comps != 4 ) ) {
@@ -121,103 +1195,225 @@ apg_ply_t apg_ply_read( const char* filename ) {
     }
   }
   int total_n_comps = ply.n_positions_comps + ply.n_texcoords_comps + ply.n_normals_comps + ply.n_colours_comps;
-  v_list            = malloc( v_count * total_n_comps * sizeof( float ) );
-  v_finals          = malloc( 6 * f_count * total_n_comps * sizeof( float ) );
   { // BODY
-    for ( int i = 0; i < v_count; i++ ) {
-      if ( !fgets( line, 1024, fptr ) ) {
-        fprintf( stderr, "ERROR: 'fgets' failed reading file `%s`\n", filename );
-        goto free_and_return_ply;
-      }
-      float comps[12]; // x y z nx ny nz s t r g b a
-      int n = sscanf( line, "%f %f %f %f %f %f %f %f %f %f %f %f", &comps[0], &comps[1], &comps[2], &comps[3], &comps[4], &comps[5], &comps[6], &comps[7],
-        &comps[8], &comps[9], &comps[10], &comps[11] );
-      if ( n != total_n_comps ) {
-        fprintf( stderr, "ERROR: expected %i vertex components, got %i\n", total_n_comps, n );
-        goto free_and_return_ply;
-      }
-      for ( int col_idx = 8; col_idx < n; col_idx++ ) { comps[col_idx] /= 255.0f; } // rgba are really uchars and should be converted to floats
-      memcpy( &v_list[i * n], comps, n * sizeof( float ) );
+    const char* body_ptr = (const char*)&data_ptr[body_offset];
+    size_t body_sz       = file.sz - body_offset;
+    int64_t max_chunks   = (int64_t)( body_sz / _PLY_ASCII_CHUNK ) + 1;
+    v_list               = _ply_alloc( scratch_ptr, (size_t)v_count * total_n_comps * sizeof( float ) );
+    faces_ptr            = _ply_alloc( scratch_ptr, (size_t)f_count * 4 * sizeof( uint32_t ) );
+    corners_ptr          = _ply_alloc( scratch_ptr, (size_t)f_count * 6 * sizeof( uint32_t ) );
+    chunk_starts         = _ply_alloc( scratch_ptr, ( max_chunks + 1 ) * sizeof( size_t ) );
+    chunk_lines          = _ply_alloc( scratch_ptr, max_chunks * sizeof( int64_t ) );
+    errors               = _ply_alloc( scratch_ptr, max_chunks * sizeof( ply_ascii_error_t ) );
+    error_values         = _ply_alloc( scratch_ptr, max_chunks * sizeof( uint32_t ) );
+    if ( !v_list || !faces_ptr || !corners_ptr || !chunk_starts || !chunk_lines || !errors || !error_values ) {
+      fprintf( stderr, "ERROR: out of memory reading file `%s`\n", filename );
+      goto free_and_return_ply;
     }
-    // faces list
-    for ( int i = 0; i < f_count; i++ ) {
-      if ( !fgets( line, 1024, fptr ) ) {
-        fprintf( stderr, "ERROR: 'fgets' failed reading file `%s`\n", filename );
-        goto free_and_return_ply;
-      }
-      // NOTE(Anton) assumes this format: property list uchar uint vertex_indices
-      uint32_t n_poly_verts = 0, a = 0, b = 0, c = 0, d = 0;
-      int n = sscanf( line, "%u %u %u %u %u", &n_poly_verts, &a, &b, &c, &d ); // 4 0 1 2 3
-      if ( ( n < 2 ) || ( 4 == n_poly_verts && n != 5 ) || ( 3 == n_poly_verts && n != 4 ) ) {
-        fprintf( stderr, "ERROR: wrong number of components (%i) scanned in face line\n", n );
-        goto free_and_return_ply;
-      }
-      // TODO(Anton) check winding order for quad/tri
-      if ( 4 == n_poly_verts || 3 == n_poly_verts ) {
-        int count          = 4 == n_poly_verts ? 6 : 3;
-        uint32_t indices[] = { a, b, c, c, d, a };
-        for ( int j = 0; j < count; j++ ) {
-          int vert_idx = indices[j];
-          memcpy( &v_finals[n_finals++ * total_n_comps], &v_list[vert_idx * total_n_comps], total_n_comps * sizeof( float ) );
-        }
-      } else {
-        fprintf( stderr, "ERROR: unsupported number of vertices per polygon in a face. only 3 and 4 supported\n" );
-        goto free_and_return_ply;
-      }
+    int64_t n_chunks = 0;
+    chunk_starts[0]  = 0;
+    while ( chunk_starts[n_chunks] < body_sz ) {
+      size_t start             = chunk_starts[n_chunks] + _PLY_ASCII_CHUNK;
+      const char* eol_ptr      = start < body_sz ? memchr( &body_ptr[start], '\n', body_sz - start ) : NULL;
+      chunk_starts[++n_chunks] = eol_ptr ? (size_t)( eol_ptr - body_ptr ) + 1 : body_sz;
     }
-  }
-  { // split finals into groups and allocate correct sizes
-    // NOTE(Anton) could just use indexed rendering but would need a quads->tris split anyway
-    if ( ply.n_positions_comps > 0 ) {
-      ply.positions_ptr = malloc( sizeof( float ) * ply.n_positions_comps * n_finals );
-      assert( ply.positions_ptr );
+    ply_ascii_job_t job = ( ply_ascii_job_t ){ .body_ptr = body_ptr, .chunk_starts = chunk_starts, .chunk_lines = chunk_lines, .v_count = v_count,
+      .f_count      = f_count, .total_n_comps = total_n_comps, .v_list = v_list, .faces_ptr = faces_ptr, .errors = errors,
+      .error_values = error_values };
+    apg_jobs_parallel_for( 0, n_chunks, 1, _ply_count_lines, &job );
+    int64_t n_lines = 0;
+    for ( int64_t i = 0; i < n_chunks; i++ ) {
+      int64_t n      = chunk_lines[i];
+      chunk_lines[i] = n_lines;
+      n_lines += n;
     }
-    if ( ply.n_normals_comps > 0 ) {
-      ply.normals_ptr = malloc( sizeof( float ) * ply.n_normals_comps * n_finals );
-      assert( ply.normals_ptr );
+    apg_jobs_parallel_for( 0, n_chunks, 1, _ply_parse_ascii_chunks, &job );
+    // report the first error in the file, as a line-by-line parse would.
+    for ( int64_t i = 0; i < n_chunks; i++ ) {
+      switch ( errors[i] ) {
+      case PLY_ASCII_OK: continue;
+      case PLY_ASCII_N_COMPS: fprintf( stderr, "ERROR: expected %i vertex components, got %i\n", total_n_comps, (int)error_values[i] ); break;
+      case PLY_ASCII_N_FACE_COMPS: fprintf( stderr, "ERROR: wrong number of components (%i) scanned in face line\n", (int)error_values[i] ); break;
+      case PLY_ASCII_POLYGON: fprintf( stderr, "ERROR: unsupported number of vertices per polygon in a face. only 3 and 4 supported\n" ); break;
+      case PLY_ASCII_INDEX: fprintf( stderr, "ERROR: face index %u out of range in file `%s`\n", error_values[i], filename ); break;
+      }
+      goto free_and_return_ply;
     }
-    if ( ply.n_texcoords_comps > 0 ) {
-      ply.texcoords_ptr = malloc( sizeof( float ) * ply.n_texcoords_comps * n_finals );
-      assert( ply.texcoords_ptr );
+    if ( n_lines < (int64_t)v_count + f_count ) {
+      fprintf( stderr, "ERROR: 'fgets' failed reading file `%s`\n", filename );
+      goto free_and_return_ply;
     }
-    if ( ply.n_colours_comps > 0 ) {
-      ply.colours_ptr = malloc( sizeof( float ) * ply.n_colours_comps * n_finals );
-      assert( ply.colours_ptr );
+    // TODO(Anton) check winding order for quad/tri
+    for ( int i = 0; i < f_count; i++ ) {
+      const uint32_t* face_ptr = &faces_ptr[i * 4];
+      uint32_t indices[]       = { face_ptr[0], face_ptr[1], face_ptr[2], face_ptr[2], face_ptr[3], face_ptr[0] };
+      int count                = UINT32_MAX == face_ptr[3] ? 3 : 6;
+      memcpy( &corners_ptr[n_finals], indices, count * sizeof( uint32_t ) );
+      n_finals += count;
     }
-    for ( int i = 0; i < n_finals; i++ ) {
-      int idx = 0;
-      if ( ply.n_positions_comps > 0 ) {
-        memcpy( &ply.positions_ptr[ply.n_positions_comps * i], &v_finals[i * total_n_comps + idx], sizeof( float ) * ply.n_positions_comps );
-        idx += ply.n_positions_comps;
-      }
-      if ( ply.n_normals_comps > 0 ) {
-        memcpy( &ply.normals_ptr[ply.n_normals_comps * i], &v_finals[i * total_n_comps + idx], sizeof( float ) * ply.n_normals_comps );
-        idx += ply.n_normals_comps;
-      }
-      if ( ply.n_texcoords_comps > 0 ) {
-        memcpy( &ply.texcoords_ptr[ply.n_texcoords_comps * i], &v_finals[i * total_n_comps + idx], sizeof( float ) * ply.n_texcoords_comps );
-        idx += ply.n_texcoords_comps;
-      }
-      if ( ply.n_colours_comps > 0 ) {
-        memcpy( &ply.colours_ptr[ply.n_colours_comps * i], &v_finals[i * total_n_comps + idx], sizeof( float ) * ply.n_colours_comps );
-        idx += ply.n_colours_comps;
-      }
+  }
+  if ( indexed ) {
+    ply_element_t vertex_element;
+    ply_layout_t layout;
+    _ply_float_element( ply, &vertex_element );
+    _ply_find_layout( &vertex_element, &layout );
+    if ( !_ply_build_indexed( &ply, &layout, (const uint8_t*)v_list, vertex_element.stride, v_count, corners_ptr, n_finals, flags, arena_ptr, scratch_ptr ) ) {
+      fprintf( stderr, "ERROR: out of memory reading file `%s`\n", filename );
+      goto free_and_return_ply;
+    }
+  } else { // split finals into groups and allocate correct sizes
+    // NOTE(Anton) could just use indexed rendering but would need a quads->tris split anyway
+    if ( ply.n_positions_comps > 0 ) { ply.positions_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_positions_comps * n_finals ); }
+    if ( ply.n_normals_comps > 0 ) { ply.normals_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_normals_comps * n_finals ); }
+    if ( ply.n_texcoords_comps > 0 ) { ply.texcoords_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_texcoords_comps * n_finals ); }
+    if ( ply.n_colours_comps > 0 ) { ply.colours_ptr = _ply_alloc( arena_ptr, sizeof( float ) * ply.n_colours_comps * n_finals ); }
+    if ( ( ply.n_positions_comps > 0 && !ply.positions_ptr ) || ( ply.n_normals_comps > 0 && !ply.normals_ptr ) ||
+         ( ply.n_texcoords_comps > 0 && !ply.texcoords_ptr ) || ( ply.n_colours_comps > 0 && !ply.colours_ptr ) ) {
+      fprintf( stderr, "ERROR: out of memory reading file `%s`\n", filename );
+      goto free_and_return_ply;
     }
+    ply_deindex_job_t job = ( ply_deindex_job_t ){ .v_list = v_list, .corners_ptr = corners_ptr, .total_n_comps = total_n_comps,
+      .streams = { ply.positions_ptr, ply.normals_ptr, ply.texcoords_ptr, ply.colours_ptr },
+      .n_comps = { ply.n_positions_comps, ply.n_normals_comps, ply.n_texcoords_comps, ply.n_colours_comps } };
+    apg_jobs_parallel_for( 0, n_finals, 1 << 16, _ply_deindex, &job );
+    ply.n_vertices = n_finals;
   }
-  ply.n_vertices = n_finals;
-  ply.loaded     = 1;
+  ply.loaded = 1;
 free_and_return_ply:
-  fclose( fptr );
-  if ( v_list ) { free( v_list ); }
-  if ( v_finals ) { free( v_finals ); }
+  apg_file_unmap( &file );
+  _ply_free( scratch_ptr, v_list );
+  _ply_free( scratch_ptr, faces_ptr );
+  _ply_free( scratch_ptr, corners_ptr );
+  _ply_free( scratch_ptr, chunk_starts );
+  _ply_free( scratch_ptr, chunk_lines );
+  _ply_free( scratch_ptr, errors );
+  _ply_free( scratch_ptr, error_values );
+  if ( scratch_ptr ) { apg_arena_reset_to_mark( scratch_ptr, scratch_mark ); }
+  if ( !ply.loaded ) {
+    if ( !arena_ptr ) {
+      apg_ply_delete( &ply );
+    } else {
+      apg_arena_reset_to_mark( arena_ptr, arena_mark );
+      ply = ( apg_ply_t ){ .loaded = 0 };
+    }
+  }
   return ply;
 }
 
+apg_ply_t apg_ply_read( const char* filename ) { return _apg_ply_read( filename, false, 0, NULL, NULL ); }
+
+apg_ply_t apg_ply_read_arena( const char* filename, apg_arena_t* arena_ptr, apg_arena_t* scratch_ptr ) {
+  assert( arena_ptr );
+  return _apg_ply_read( filename, false, 0, arena_ptr, scratch_ptr );
+}
+
+apg_ply_t apg_ply_read_indexed( const char* filename, unsigned int flags ) { return _apg_ply_read( filename, true, flags, NULL, NULL ); }
+
+int apg_ply_optimise( apg_ply_t* ply_ptr ) {
+  assert( ply_ptr );
+  if ( !ply_ptr->indices_ptr || ply_ptr->n_indices <= 0 ) { return 0; }
+  uint32_t* indices = (uint32_t*)ply_ptr->indices_ptr;
+  if ( 2 == ply_ptr->index_sz ) {
+    indices = malloc( sizeof( uint32_t ) * ply_ptr->n_indices );
+    if ( !indices ) { return 0; }
+    for ( int i = 0; i < ply_ptr->n_indices; i++ ) { indices[i] = ( (const uint16_t*)ply_ptr->indices_ptr )[i]; }
+  }
+  float* const streams[PLY_STREAM_MAX] = { ply_ptr->positions_ptr, ply_ptr->normals_ptr, ply_ptr->texcoords_ptr, ply_ptr->colours_ptr };
+  const int n_comps[PLY_STREAM_MAX]    = { ply_ptr->n_positions_comps, ply_ptr->n_normals_comps, ply_ptr->n_texcoords_comps, ply_ptr->n_colours_comps };
+  bool ok                              = _ply_optimise( streams, n_comps, ply_ptr->n_vertices, indices, ply_ptr->n_indices, NULL );
+  if ( 2 == ply_ptr->index_sz ) {
+    if ( ok ) {
+      for ( int i = 0; i < ply_ptr->n_indices; i++ ) { ( (uint16_t*)ply_ptr->indices_ptr )[i] = (uint16_t)indices[i]; }
+    }
+    free( indices );
+  }
+  return ok;
+}
+
+float apg_ply_acmr( apg_ply_t ply, int cache_size ) {
+  if ( !ply.indices_ptr || ply.n_indices < 3 || ply.n_vertices <= 0 || cache_size < 1 ) { return 0.0f; }
+  // a vertex is in the FIFO if fewer than cache_size misses have happened since it was last loaded.
+  int32_t* loaded_at = malloc( sizeof( int32_t ) * ply.n_vertices );
+  if ( !loaded_at ) { return 0.0f; }
+  for ( int v = 0; v < ply.n_vertices; v++ ) { loaded_at[v] = INT32_MIN; }
+  int32_t n_misses = 0;
+  for ( int i = 0; i < ply.n_indices; i++ ) {
+    uint32_t v = _ply_face_index( ply, i / 3, i % 3 );
+    if ( INT32_MIN == loaded_at[v] || n_misses - loaded_at[v] > cache_size ) { loaded_at[v] = n_misses++; }
+  }
+  free( loaded_at );
+  return (float)n_misses / (float)( ply.n_indices / 3 );
+}
+
 void apg_ply_delete( apg_ply_t* ply ) {
   assert( ply );
   if ( ply->positions_ptr ) { free( ply->positions_ptr ); }
   if ( ply->normals_ptr ) { free( ply->normals_ptr ); }
   if ( ply->texcoords_ptr ) { free( ply->texcoords_ptr ); }
   if ( ply->colours_ptr ) { free( ply->colours_ptr ); }
+  if ( ply->indices_ptr ) { free( ply->indices_ptr ); }
   *ply = ( apg_ply_t ){ .loaded = 0 };
 }
+
+int apg_ply_view_open( const char* filename, apg_ply_view_t* view_ptr ) {
+  assert( filename && view_ptr );
+  *view_ptr       = ( apg_ply_view_t ){ .vertices_ptr = NULL };
+  apg_file_t file = ( apg_file_t ){ .data_ptr = NULL };
+  ply_header_t hdr;
+  ply_layout_t layout;
+  const uint8_t* starts[_PLY_MAX_ELEMENTS] = { NULL };
+
+  if ( !_ply_host_is_little_endian() ) { return 0; }
+  if ( !apg_file_map( filename, &file ) ) {
+    fprintf( stderr, "ERROR: couldn't map ply file `%s` - is path correct?\n", filename );
+    return 0;
+  }
+  if ( !_ply_parse_header( file.data_ptr, file.sz, filename, &hdr ) || !_ply_find_element_data( &hdr, file.data_ptr, file.sz, starts ) ) {
+    apg_file_unmap( &file );
+    return 0;
+  }
+  const ply_element_t* vertex_ptr = _ply_find_element( &hdr, "vertex" );
+  const ply_element_t* face_ptr   = _ply_find_element( &hdr, "face" );
+  if ( !vertex_ptr || vertex_ptr->stride <= 0 || vertex_ptr->count > INT32_MAX || ( face_ptr && face_ptr->count > INT32_MAX ) ) {
+    fprintf( stderr, "ERROR: missing vertex element, or vertex element with lists, or too many vertices in file `%s`\n", filename );
+    apg_file_unmap( &file );
+    return 0;
+  }
+  _ply_find_layout( vertex_ptr, &layout );
+  int* offsets[PLY_STREAM_MAX] = { &view_ptr->positions_offset, &view_ptr->normals_offset, &view_ptr->texcoords_offset, &view_ptr->colours_offset };
+  int* n_comps[PLY_STREAM_MAX] = { &view_ptr->n_positions_comps, &view_ptr->n_normals_comps, &view_ptr->n_texcoords_comps, &view_ptr->n_colours_comps };
+  bool valid                   = _ply_layout_is_valid( &layout );
+  for ( int s = 0; s < PLY_STREAM_MAX; s++ ) {
+    bool usable = valid && layout.packed[s];
+    *offsets[s] = usable ? layout.props[s][0]->offset : -1;
+    *n_comps[s] = usable ? layout.n_comps[s] : 0;
+  }
+  view_ptr->vertices_ptr  = starts[vertex_ptr - hdr.elements];
+  view_ptr->n_vertices    = (int)vertex_ptr->count;
+  view_ptr->vertex_stride = vertex_ptr->stride;
+  if ( face_ptr ) {
+    view_ptr->n_faces = (int)face_ptr->count;
+    // the common `list uchar int vertex_indices` on its own gives 13 bytes per triangle. check every face is a triangle.
+    const ply_property_t* prop_ptr = &face_ptr->properties[0];
+    bool tris                      = 1 == face_ptr->n_properties && PLY_TYPE_UINT8 == prop_ptr->count_type && 4 == _ply_type_sizes[prop_ptr->type] &&
+                PLY_TYPE_FLOAT32 != prop_ptr->type && _ply_face_indices_property( face_ptr ) == 0;
+    const uint8_t* faces_ptr = starts[face_ptr - hdr.elements];
+    if ( tris && (uint64_t)face_ptr->count * 13 <= (uint64_t)( (const uint8_t*)file.data_ptr + file.sz - faces_ptr ) ) {
+      for ( int64_t i = 0; tris && i < face_ptr->count; i++ ) { tris = 3 == faces_ptr[i * 13]; }
+      if ( tris ) {
+        view_ptr->faces_ptr   = faces_ptr;
+        view_ptr->face_stride = 13;
+      }
+    }
+  }
+  view_ptr->map_ptr = file.data_ptr;
+  view_ptr->map_sz  = file.sz;
+  return 1;
+}
+
+void apg_ply_view_close( apg_ply_view_t* view_ptr ) {
+  if ( !view_ptr ) { return; }
+  apg_file_t file = ( apg_file_t ){ .data_ptr = view_ptr->map_ptr, .sz = view_ptr->map_sz };
+  apg_file_unmap( &file );
+  *view_ptr = ( apg_ply_view_t ){ .vertices_ptr = NULL };
+}
@@ -1,15 +1,27 @@
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Limitations
-* Components are optional, but the order is fixed.
+/* Formats
+* ascii and binary_little_endian files are read. binary_big_endian files are not.
+* ascii bodies are parsed from the mapped file, split over the apg.h job threads if apg_jobs_init() has been called.
+* apg_ply_write() writes ascii, and apg_ply_write_binary() writes binary_little_endian. Both write float properties, and index indexed meshes.
+
+Limitations
+* In ascii files components are optional, but the order is fixed.
   The following is valid:
   x, y, s, t, red, green, blue.
   But the following is not valid:
   s, t, x, y, z
+* Binary files may have properties in any order and of any type, and extra properties, which are skipped.
+  Integer colours are scaled to 0-1 by their type's maximum, so a uchar 255 is 1.0. Other integers are converted as they are.
+  Texture coordinates may be named s, t or u, v, or texture_u, texture_v, and colours red, green, blue, alpha or r, g, b, a, or diffuse_red etc.
+  Face index lists may have any integer count and index types.
+* Binary files are read on little-endian machines only.
 * Edges are ignored.
 * Custom material sections are ignored.
 * Comments are discarded.
@@ -28,15 +40,77 @@ typedef struct apg_ply_t {
   int n_texcoords_comps;
   int n_colours_comps;
   int loaded; // 1 if there were no errors
+  // indexed meshes only, from apg_ply_read_indexed(). otherwise indices_ptr is NULL, and every 3 vertices make a triangle.
+  void* indices_ptr; // triangle list of n_indices indices into the streams: uint16_t if index_sz is 2, or uint32_t if it's 4.
+  int n_indices;
+  int index_sz;
 } apg_ply_t;
 
+// flags for apg_ply_read_indexed().
+#define APG_PLY_OPTIMISE 1   // reorder the mesh with apg_ply_optimise() after reading.
+#define APG_PLY_INDICES_16 2 // use 16-bit indices if there are no more than 65536 vertices.
+
 unsigned int apg_ply_write( const char* filename, apg_ply_t ply );
 
+// as apg_ply_write() but writes a binary_little_endian file, which is several times smaller and much faster to read.
+unsigned int apg_ply_write_binary( const char* filename, apg_ply_t ply );
+
 // on failure the returned ply has .loaded = 0
 apg_ply_t apg_ply_read( const char* filename );
 
+struct apg_arena_t;
+
+// as apg_ply_read() but the returned buffers are allocated from `arena_ptr`, so a whole level's meshes can be released with one reset.
+// temporary working memory comes from `scratch_ptr`, and is released before returning, or from malloc() if `scratch_ptr` is NULL.
+// don't call apg_ply_delete() on the result. on failure anything allocated from either arena is rolled back.
+apg_ply_t apg_ply_read_arena( const char* filename, struct apg_arena_t* arena_ptr, struct apg_arena_t* scratch_ptr );
+
+// as apg_ply_read() but returns each distinct vertex once, with an index buffer. quads are still split into triangles. vertices with
+// identical components are merged, even if the file lists them separately, and vertices no face uses are dropped. vertices are numbered
+// in order of first use. `flags` is any combination of APG_PLY_* flags.
+apg_ply_t apg_ply_read_indexed( const char* filename, unsigned int flags );
+
+/* Reorders an indexed mesh for the GPU's post-transform vertex cache, then for vertex fetch:
+1. Triangles are reordered with Tom Forsyth's "Linear-Speed Vertex Cache Optimisation", which greedily picks the next triangle by the
+   scores of its vertices: higher for vertices in the last few triangles, and for vertices with few triangles left, so they're finished off.
+   It models a 32-entry LRU cache, which also suits smaller FIFO caches. It runs in linear time.
+2. Vertices are renumbered in the order the new index buffer first uses them, and the streams are permuted to match, so vertex reads
+   walk forward through memory.
+Returns 0 if `ply_ptr` isn't indexed, or on running out of memory, in which case the mesh is unchanged. */
+int apg_ply_optimise( apg_ply_t* ply_ptr );
+
+// the average cache miss ratio of an indexed mesh: vertices transformed per triangle, simulating a FIFO post-transform cache of
+// `cache_size` entries as in most GPUs. 3.0 means no reuse, and about 0.5 is the best possible for large regular meshes. returns 0 if not indexed.
+float apg_ply_acmr( apg_ply_t ply, int cache_size );
+
 void apg_ply_delete( apg_ply_t* ply );
 
+/* A binary_little_endian file mapped into memory and used in place, with nothing copied or converted.
+Vertices are interleaved as they are in the file, vertex_stride bytes apart. A stream's offset is the byte offset of its first component
+from the start of each vertex, or -1 if the file doesn't have it, or stores it as anything other than consecutive floats in the usual order:
+x y z, nx ny nz, s t, red green blue [alpha]. In that case its n_*_comps is 0 too, and apg_ply_read() can convert it instead.
+Floats in the file aren't necessarily 4-byte aligned, so read them with memcpy() on strict-alignment CPUs.
+
+faces_ptr is set if every face is a triangle stored as a uchar count of 3 followed by three 4-byte indices, so face_stride is 13, and
+otherwise it's NULL. Checking the counts reads through the face data, but nothing is copied. Indices aren't checked against n_vertices.
+Unlike apg_ply_read() this also gives access to point clouds, which have no faces. */
+typedef struct apg_ply_view_t {
+  const unsigned char* vertices_ptr;
+  const unsigned char* faces_ptr;
+  int n_vertices, vertex_stride;
+  int positions_offset, normals_offset, texcoords_offset, colours_offset;
+  int n_positions_comps, n_normals_comps, n_texcoords_comps, n_colours_comps;
+  int n_faces, face_stride;
+  void* map_ptr; // the whole mapped file, used by apg_ply_view_close().
+  size_t map_sz;
+} apg_ply_view_t;
+
+// maps `filename` and fills in `view_ptr`. returns 0 on failure, including for ascii files, with `view_ptr` zeroed.
+int apg_ply_view_open( const char* filename, apg_ply_view_t* view_ptr );
+
+// unmaps the file. pointers from the view are invalid after this.
+void apg_ply_view_close( apg_ply_view_t* view_ptr );
+
 #ifdef __cplusplus
 }
 #endif
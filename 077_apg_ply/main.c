@@ -7,6 +7,9 @@
 - DONE export to custom vxl type with palette indices
 */
 
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
 #include "apg_maths.h"
 #include "apg_pixfont.h"
 #include "apg_ply.h"
@@ -33,7 +36,10 @@ int main( int argc, char** argv ) {
 
   mesh_t mesh;
   {
+    // ascii files are parsed on every core. the threads are only needed while loading.
+    if ( !apg_jobs_init( 0 ) ) { fprintf( stderr, "WARNING: could not start job threads. loading on this thread only\n" ); }
     apg_ply_t ply = apg_ply_read( argv[1] );
+    apg_jobs_free();
     if ( !ply.loaded ) {
       fprintf( stderr, "ERROR loading `%s` ply\n", argv[1] );
       return 1;
@@ -0,0 +1,314 @@
+/* Size and decode-speed benchmark for apg_mesh.h's quantised streams and delta codec.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -I ../common/include mesh_codec_bench.c apg_ply.c -lm -pthread -o mesh_codec_bench
+Run:
+  ./mesh_codec_bench [n_vertices | input.ply]
+
+Generates a terrain grid of about n_vertices (default 4M) with positions, normals, and texture coordinates, or reads input.ply with
+apg_ply_read_indexed(), then reorders it with apg_ply_optimise() as mesh_cook -indexed does. The mesh is stored each of these ways:
+  float              the streams as apg_ply_read_indexed() returns them. 32 bytes per vertex for the grid.
+  quantised          16-bit positions and texture coordinates within their bounds, and octahedral normals at 2x16 bits, or at 2x8 bits.
+and each of those again with the streams and indices delta encoded. `B/vertex` is the vertex streams' bytes per vertex, and `B/tri` the
+index buffer's bytes per triangle. Decoding is timed on one thread, best of several runs, and `GB/s` is of decoded output. `max error`
+is the largest position error as a fraction of the bounds, and the largest normal error in degrees. Encoded data must decode exactly.
+Build with -DAPG_MESH_NO_SIMD to time the plain C decoder.
+
+Finally the smallest version is written with apg_mesh_write() and opened, decoded, and compared with what was written.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#define APG_MESH_IMPLEMENTATION
+#include "apg_mesh.h"
+#include "apg_ply.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESH_FN "mesh_codec_bench.mesh"
+#define MIN_TIMING_S 0.25 // decodes are repeated for at least this long.
+
+typedef struct packed_stream_t {
+  apg_mesh_stream_desc_t desc;
+  void* data_ptr;
+  uint32_t stride;
+} packed_stream_t;
+
+// the ways of storing the mesh.
+typedef enum pack_t { PACK_FLOAT = 0, PACK_QUANTISED, PACK_QUANTISED_OCT8, PACK_MAX } pack_t;
+static const char* _pack_names[PACK_MAX] = { "float", "quantised", "quantised, oct 2x8" };
+
+static volatile uint32_t _sink; // keeps decodes from being optimised away.
+
+static float _height( float x, float y ) { return 2.0f * sinf( x * 0.37f ) * cosf( y * 0.23f ) + 0.5f * sinf( x * 1.7f + y * 1.3f ); }
+
+// a height field of side x side vertices 1/8 apart, with analytic normals and texture coordinates across the whole grid.
+static apg_ply_t _gen_terrain( int side ) {
+  apg_ply_t ply         = ( apg_ply_t ){ .n_vertices = side * side, .n_positions_comps = 3, .n_normals_comps = 3, .n_texcoords_comps = 2 };
+  ply.n_indices         = 6 * ( side - 1 ) * ( side - 1 );
+  ply.index_sz          = 4;
+  ply.positions_ptr     = malloc( sizeof( float ) * 3 * ply.n_vertices );
+  ply.normals_ptr       = malloc( sizeof( float ) * 3 * ply.n_vertices );
+  ply.texcoords_ptr     = malloc( sizeof( float ) * 2 * ply.n_vertices );
+  uint32_t* indices_ptr = malloc( sizeof( uint32_t ) * ply.n_indices );
+  ply.indices_ptr       = indices_ptr;
+  if ( !ply.positions_ptr || !ply.normals_ptr || !ply.texcoords_ptr || !indices_ptr ) {
+    apg_ply_delete( &ply );
+    return ply;
+  }
+  for ( int j = 0; j < side; j++ ) {
+    for ( int i = 0; i < side; i++ ) {
+      int v = j * side + i;
+      float x = i / 8.0f, y = j / 8.0f, e = 0.01f;
+      float dx = ( _height( x + e, y ) - _height( x - e, y ) ) / ( 2.0f * e ), dy = ( _height( x, y + e ) - _height( x, y - e ) ) / ( 2.0f * e );
+      float len                     = sqrtf( dx * dx + dy * dy + 1.0f );
+      ply.positions_ptr[v * 3 + 0]  = x;
+      ply.positions_ptr[v * 3 + 1]  = y;
+      ply.positions_ptr[v * 3 + 2]  = _height( x, y );
+      ply.normals_ptr[v * 3 + 0]    = -dx / len;
+      ply.normals_ptr[v * 3 + 1]    = -dy / len;
+      ply.normals_ptr[v * 3 + 2]    = 1.0f / len;
+      ply.texcoords_ptr[v * 2 + 0]  = i / (float)( side - 1 );
+      ply.texcoords_ptr[v * 2 + 1]  = j / (float)( side - 1 );
+    }
+  }
+  uint32_t* idx_ptr = indices_ptr;
+  for ( int j = 0; j < side - 1; j++ ) {
+    for ( int i = 0; i < side - 1; i++ ) {
+      uint32_t a = j * side + i, b = a + 1, c = a + side, d = c + 1;
+      uint32_t tris[6] = { a, b, d, a, d, c };
+      memcpy( idx_ptr, tris, sizeof( tris ) );
+      idx_ptr += 6;
+    }
+  }
+  ply.loaded = 1;
+  return ply;
+}
+
+// fills in streams for one way of storing the mesh. RETURNS the number of streams.
+static int _pack( apg_ply_t ply, pack_t pack, packed_stream_t* streams ) {
+  int n = 0;
+  const struct {
+    int attrib, n_comps;
+    const float* data_ptr;
+  } srcs[3] = { { APG_MESH_POSITION, ply.n_positions_comps, ply.positions_ptr }, { APG_MESH_NORMAL, ply.n_normals_comps, ply.normals_ptr },
+    { APG_MESH_TEXCOORD, ply.n_texcoords_comps, ply.texcoords_ptr } };
+  for ( int i = 0; i < 3; i++ ) {
+    if ( !srcs[i].n_comps ) { continue; }
+    packed_stream_t* s_ptr = &streams[n++];
+    *s_ptr                 = ( packed_stream_t ){ .desc = { srcs[i].attrib, APG_MESH_F32, srcs[i].n_comps, srcs[i].data_ptr } };
+    if ( PACK_FLOAT == pack ) {
+      s_ptr->stride = sizeof( float ) * srcs[i].n_comps;
+      continue;
+    }
+    if ( APG_MESH_NORMAL == srcs[i].attrib && 3 == srcs[i].n_comps ) {
+      int bits          = PACK_QUANTISED_OCT8 == pack ? 8 : 16;
+      s_ptr->stride     = bits / 4;
+      s_ptr->data_ptr   = malloc( (size_t)s_ptr->stride * ply.n_vertices );
+      s_ptr->desc       = ( apg_mesh_stream_desc_t ){
+        .attrib = APG_MESH_NORMAL, .type = 8 == bits ? APG_MESH_I8 : APG_MESH_I16, .n_comps = 2, .data_ptr = s_ptr->data_ptr, .quant = APG_MESH_QUANT_OCT };
+      if ( s_ptr->data_ptr ) { apg_mesh_encode_octahedral( srcs[i].data_ptr, 3, ply.n_vertices, bits, s_ptr->data_ptr ); }
+    } else {
+      s_ptr->stride   = 2 * srcs[i].n_comps;
+      s_ptr->data_ptr = malloc( (size_t)s_ptr->stride * ply.n_vertices );
+      s_ptr->desc     = ( apg_mesh_stream_desc_t ){
+        .attrib = srcs[i].attrib, .type = APG_MESH_U16, .n_comps = srcs[i].n_comps, .data_ptr = s_ptr->data_ptr, .quant = APG_MESH_QUANT_UNORM };
+      if ( s_ptr->data_ptr ) {
+        apg_mesh_quantise_unorm(
+          srcs[i].data_ptr, srcs[i].n_comps, srcs[i].n_comps, ply.n_vertices, 16, s_ptr->data_ptr, s_ptr->desc.range_min, s_ptr->desc.range_extent );
+      }
+    }
+    if ( !s_ptr->data_ptr ) { return -1; }
+  }
+  return n;
+}
+
+static void _free_packed( packed_stream_t* streams, int n ) {
+  for ( int i = 0; i < n; i++ ) { free( streams[i].data_ptr ); }
+}
+
+// largest position error as a fraction of the bounds, and largest normal error in degrees, after dequantising.
+static void _max_errors( apg_ply_t ply, const packed_stream_t* streams, int n_streams, double* pos_err_ptr, double* normal_err_ptr ) {
+  *pos_err_ptr = *normal_err_ptr = 0.0;
+  float* floats_ptr              = malloc( sizeof( float ) * 4 * ply.n_vertices );
+  if ( !floats_ptr ) { return; }
+  for ( int i = 0; i < n_streams; i++ ) {
+    const apg_mesh_stream_desc_t* d_ptr = &streams[i].desc;
+    if ( APG_MESH_QUANT_NONE == d_ptr->quant ) { continue; }
+    apg_mesh_stream_t info = ( apg_mesh_stream_t ){ .type = d_ptr->type, .n_comps = d_ptr->n_comps, .quant = d_ptr->quant };
+    memcpy( info.range_min, d_ptr->range_min, sizeof( info.range_min ) );
+    memcpy( info.range_extent, d_ptr->range_extent, sizeof( info.range_extent ) );
+    apg_mesh_dequantise( &info, d_ptr->data_ptr, ply.n_vertices, floats_ptr );
+    for ( int v = 0; v < ply.n_vertices; v++ ) {
+      if ( APG_MESH_POSITION == d_ptr->attrib ) {
+        for ( int c = 0; c < d_ptr->n_comps; c++ ) {
+          double err   = fabs( floats_ptr[v * d_ptr->n_comps + c] - ply.positions_ptr[v * ply.n_positions_comps + c] );
+          *pos_err_ptr = APG_MAX( *pos_err_ptr, err / APG_MAX( d_ptr->range_extent[c], 1e-30f ) );
+        }
+      } else if ( APG_MESH_NORMAL == d_ptr->attrib ) { // angle from the cross product, which is precise for small angles.
+        const float *a = &ply.normals_ptr[v * 3], *b = &floats_ptr[v * 3];
+        double cx = (double)a[1] * b[2] - (double)a[2] * b[1], cy = (double)a[2] * b[0] - (double)a[0] * b[2], cz = (double)a[0] * b[1] - (double)a[1] * b[0];
+        double dot     = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+        double degs    = atan2( sqrt( cx * cx + cy * cy + cz * cz ), dot ) * 180.0 / 3.14159265358979;
+        *normal_err_ptr = APG_MAX( *normal_err_ptr, degs );
+      }
+    }
+  }
+  free( floats_ptr );
+}
+
+// encodes the streams and indices, times decoding them, and checks they decode exactly. RETURNS false on a mismatch.
+static bool _bench_codec( apg_ply_t ply, const packed_stream_t* streams, int n_streams, const char* label ) {
+  size_t raw_sz = 0, enc_sz = 0, max_stream_sz = 0;
+  void* enc_ptrs[APG_MESH_MAX_STREAMS] = { NULL };
+  size_t enc_szs[APG_MESH_MAX_STREAMS] = { 0 };
+  bool ok                              = true;
+  double t                             = apg_time_s();
+  for ( int i = 0; ok && i < n_streams; i++ ) {
+    size_t bound = apg_mesh_encode_vertex_buffer_bound( ply.n_vertices, streams[i].stride );
+    enc_ptrs[i]  = malloc( bound );
+    ok           = NULL != enc_ptrs[i];
+    if ( ok ) {
+      const void* src_ptr = streams[i].desc.data_ptr;
+      uint32_t comp_sz    = (uint32_t)apg_mesh_type_sz( streams[i].desc.type );
+      enc_szs[i]          = apg_mesh_encode_vertex_buffer( enc_ptrs[i], bound, src_ptr, ply.n_vertices, streams[i].stride, comp_sz );
+      raw_sz += (size_t)streams[i].stride * ply.n_vertices;
+      enc_sz += enc_szs[i];
+      max_stream_sz = APG_MAX( max_stream_sz, (size_t)streams[i].stride * ply.n_vertices );
+    }
+  }
+  size_t idx_bound = apg_mesh_encode_index_buffer_bound( ply.n_indices );
+  void* idx_enc    = malloc( idx_bound );
+  size_t idx_sz    = idx_enc ? apg_mesh_encode_index_buffer( idx_enc, idx_bound, ply.indices_ptr, ply.n_indices, ply.index_sz ) : 0;
+  double enc_s     = apg_time_s() - t;
+  size_t idx_raw   = (size_t)ply.n_indices * ply.index_sz;
+  void* dec_ptr    = malloc( APG_MAX( max_stream_sz, idx_raw ) );
+  ok               = ok && idx_sz && dec_ptr;
+
+  // decode everything, repeatedly, keeping the fastest pass.
+  double best_vtx_s = 1e30, best_idx_s = 1e30, spent = 0.0;
+  for ( int pass = 0; ok && ( pass < 3 || spent < MIN_TIMING_S ); pass++ ) {
+    t = apg_time_s();
+    for ( int i = 0; ok && i < n_streams; i++ ) {
+      uint32_t comp_sz = (uint32_t)apg_mesh_type_sz( streams[i].desc.type );
+      ok               = apg_mesh_decode_vertex_buffer( dec_ptr, ply.n_vertices, streams[i].stride, comp_sz, enc_ptrs[i], enc_szs[i] );
+      ok               = ok && ( pass > 0 || 0 == memcmp( dec_ptr, streams[i].desc.data_ptr, (size_t)streams[i].stride * ply.n_vertices ) );
+      _sink += ( (const uint8_t*)dec_ptr )[0];
+    }
+    double vtx_s = apg_time_s() - t;
+    t            = apg_time_s();
+    ok           = ok && apg_mesh_decode_index_buffer( dec_ptr, ply.n_indices, ply.index_sz, idx_enc, idx_sz );
+    ok           = ok && ( pass > 0 || 0 == memcmp( dec_ptr, ply.indices_ptr, idx_raw ) );
+    double idx_s = apg_time_s() - t;
+    best_vtx_s   = APG_MIN( best_vtx_s, vtx_s );
+    best_idx_s   = APG_MIN( best_idx_s, idx_s );
+    spent += vtx_s + idx_s;
+  }
+  double n_tris = ply.n_indices / 3.0;
+  printf( "  %-28s %8.2f %8.2f %8.1f ms %8.2f GB/s %8.2f GB/s %s\n", label, (double)enc_sz / ply.n_vertices, idx_sz / n_tris, enc_s * 1000.0,
+    raw_sz / best_vtx_s / 1e9, idx_raw / best_idx_s / 1e9, ok ? "" : "DIFFERENT" );
+  for ( int i = 0; i < n_streams; i++ ) { free( enc_ptrs[i] ); }
+  free( idx_enc );
+  free( dec_ptr );
+  return ok;
+}
+
+// writes, opens, and decodes a compressed mesh file. RETURNS false if it doesn't come back as written.
+static bool _bench_file( apg_ply_t ply, packed_stream_t* streams, int n_streams ) {
+  apg_mesh_desc_t desc = ( apg_mesh_desc_t ){ .n_vertices = (uint32_t)ply.n_vertices, .n_streams = n_streams };
+  for ( int i = 0; i < n_streams; i++ ) {
+    desc.streams[i]       = streams[i].desc;
+    desc.streams[i].codec = APG_MESH_CODEC_DELTA;
+  }
+  desc.indices_ptr = ply.indices_ptr;
+  desc.n_indices   = (uint32_t)ply.n_indices;
+  desc.index_sz    = ply.index_sz;
+  desc.index_codec = APG_MESH_CODEC_DELTA;
+  if ( !apg_mesh_write( MESH_FN, &desc, NULL ) ) { return false; }
+
+  double t = apg_time_s();
+  apg_mesh_t mesh;
+  bool ok             = apg_mesh_open( MESH_FN, 0, &mesh );
+  size_t decoded_sz   = 0;
+  void* decoded[APG_MESH_MAX_STREAMS + 1] = { NULL };
+  for ( int i = 0; ok && i < n_streams; i++ ) {
+    const apg_mesh_stream_t* s_ptr = &mesh.streams_ptr[i];
+    decoded[i]                     = malloc( (size_t)s_ptr->stride * mesh.n_vertices );
+    ok                             = decoded[i] && apg_mesh_decode_stream( &mesh, s_ptr, decoded[i] );
+    decoded_sz += (size_t)s_ptr->stride * mesh.n_vertices;
+  }
+  decoded[APG_MESH_MAX_STREAMS] = ok ? malloc( (size_t)mesh.n_indices * mesh.index_sz ) : NULL;
+  ok                            = ok && decoded[APG_MESH_MAX_STREAMS] && apg_mesh_decode_indices( &mesh, decoded[APG_MESH_MAX_STREAMS] );
+  double s                      = apg_time_s() - t;
+  for ( int i = 0; ok && i < n_streams; i++ ) { ok = 0 == memcmp( decoded[i], streams[i].desc.data_ptr, (size_t)streams[i].stride * ply.n_vertices ); }
+  ok = ok && 0 == memcmp( decoded[APG_MESH_MAX_STREAMS], ply.indices_ptr, (size_t)ply.n_indices * ply.index_sz );
+  decoded_sz += (size_t)mesh.n_indices * mesh.index_sz;
+  printf( "  %-28s %8.1f MB, open and decode in %.1f ms to %.1f MB: %s\n", "apg_mesh_write()", apg_file_size( MESH_FN ) / ( 1024.0 * 1024.0 ),
+    s * 1000.0, decoded_sz / ( 1024.0 * 1024.0 ), ok ? "matches" : "DIFFERS" );
+  for ( int i = 0; i <= APG_MESH_MAX_STREAMS; i++ ) { free( decoded[i] ); }
+  apg_mesh_close( &mesh );
+  remove( MESH_FN );
+  return ok;
+}
+
+int main( int argc, char** argv ) {
+  apg_time_init();
+  int n_target = 4 * 1000 * 1000;
+  apg_ply_t ply;
+  double t = apg_time_s();
+  if ( argc > 1 && strstr( argv[1], ".ply" ) ) {
+    ply = apg_ply_read_indexed( argv[1], APG_PLY_OPTIMISE );
+    printf( "%s: ", argv[1] );
+  } else {
+    if ( argc > 1 ) { n_target = APG_MAX( atoi( argv[1] ), 4 ); }
+    int side = (int)sqrt( (double)n_target );
+    ply      = _gen_terrain( side );
+    if ( ply.loaded && !apg_ply_optimise( &ply ) ) { apg_ply_delete( &ply ); }
+    printf( "%ix%i terrain: ", side, side );
+  }
+  if ( !ply.loaded || !ply.indices_ptr || !ply.n_positions_comps ) {
+    fprintf( stderr, "ERROR: no indexed mesh to compress\n" );
+    return 1;
+  }
+  printf( "%i vertices, %i triangles, made and optimised in %.1f s\n", ply.n_vertices, ply.n_indices / 3, apg_time_s() - t );
+  printf( "  %-28s %8s %8s %11s %13s %13s\n", "", "B/vertex", "B/tri", "encode", "decode vtx", "decode idx" );
+
+  bool ok = true;
+  packed_stream_t smallest[APG_MESH_MAX_STREAMS];
+  int n_smallest = 0;
+  for ( int pack = 0; ok && pack < PACK_MAX; pack++ ) {
+    packed_stream_t streams[APG_MESH_MAX_STREAMS];
+    int n_streams = _pack( ply, (pack_t)pack, streams );
+    if ( n_streams < 0 ) {
+      ok = false;
+      break;
+    }
+    size_t vertex_sz = 0;
+    for ( int i = 0; i < n_streams; i++ ) { vertex_sz += streams[i].stride; }
+    double pos_err = 0.0, normal_err = 0.0;
+    _max_errors( ply, streams, n_streams, &pos_err, &normal_err );
+    printf( "  %-28s %8.2f %8.2f", _pack_names[pack], (double)vertex_sz, 3.0 * ply.index_sz );
+    if ( PACK_FLOAT != pack ) {
+      printf( "   max error %.2g of bounds, %.4f degrees", pos_err, normal_err );
+    }
+    printf( "\n" );
+    char label[64];
+    snprintf( label, sizeof( label ), "%s, delta", _pack_names[pack] );
+    ok = _bench_codec( ply, streams, n_streams, label );
+    if ( PACK_QUANTISED_OCT8 == pack ) {
+      memcpy( smallest, streams, sizeof( smallest ) );
+      n_smallest = n_streams;
+    } else {
+      _free_packed( streams, n_streams );
+    }
+  }
+  ok = ok && _bench_file( ply, smallest, n_smallest );
+  _free_packed( smallest, n_smallest );
+  apg_ply_delete( &ply );
+  if ( !ok ) { fprintf( stderr, "ERROR: a mesh didn't decode as encoded\n" ); }
+  return ok ? 0 : 1;
+}
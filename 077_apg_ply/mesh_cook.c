@@ -0,0 +1,126 @@
+/* Offline cook step: converts PLY files into apg_mesh.h files, which load with apg_mesh_open() by mapping, with no parsing.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -I ../common/include mesh_cook.c apg_ply.c -lm -pthread -o mesh_cook
+Run:
+  ./mesh_cook [-indexed] [-compress] input.ply [output.mesh]
+
+The output defaults to the input's name with ".mesh" appended, which is the name the demos look for next to their PLY files, so a
+cooked mesh is picked up by apg_mesh_open_cached() without being cooked again. The source's size, time, and hash are recorded, so a
+later edit to the PLY file makes the cache stale. With -indexed the mesh is read with apg_ply_read_indexed(), optimised for the vertex
+cache, and stored with an index buffer, 16-bit where it fits. Otherwise every 3 vertices make a triangle, as from apg_ply_read().
+Ascii files are parsed on every core. With -compress, positions, texture coordinates, and colours are quantised to 16 bits within
+their bounds, normals are stored octahedral at 2x16 bits, and the streams and indices are delta encoded. That is about a third of the
+size; apg_mesh_decode_stream() and apg_mesh_decode_indices() unpack it at load, and the shader dequantises with the stream's range.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#define APG_MESH_IMPLEMENTATION
+#include "apg_mesh.h"
+#include "apg_ply.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct cook_opts_t {
+  bool indexed, compress;
+} cook_opts_t;
+
+static int _cook_ply( const char* src_filename, const char* mesh_filename, const apg_mesh_source_t* source_ptr, void* user_ptr ) {
+  const cook_opts_t* opts_ptr = (const cook_opts_t*)user_ptr;
+  apg_ply_t ply = opts_ptr->indexed ? apg_ply_read_indexed( src_filename, APG_PLY_OPTIMISE | APG_PLY_INDICES_16 ) : apg_ply_read( src_filename );
+  if ( !ply.loaded ) { return 0; }
+  apg_mesh_desc_t desc = ( apg_mesh_desc_t ){ .n_vertices = (uint32_t)ply.n_vertices };
+  const struct {
+    int attrib, n_comps;
+    const float* data_ptr;
+  } streams[] = { { APG_MESH_POSITION, ply.n_positions_comps, ply.positions_ptr }, { APG_MESH_NORMAL, ply.n_normals_comps, ply.normals_ptr },
+    { APG_MESH_TEXCOORD, ply.n_texcoords_comps, ply.texcoords_ptr }, { APG_MESH_COLOUR, ply.n_colours_comps, ply.colours_ptr } };
+  void* packed_ptrs[4] = { NULL };
+  int ok               = 1;
+  for ( int i = 0; i < 4 && ok; i++ ) {
+    if ( !streams[i].n_comps ) { continue; }
+    apg_mesh_stream_desc_t* s_ptr = &desc.streams[desc.n_streams++];
+    *s_ptr = ( apg_mesh_stream_desc_t ){ .attrib = streams[i].attrib, .type = APG_MESH_F32, .n_comps = streams[i].n_comps, .data_ptr = streams[i].data_ptr };
+    if ( !opts_ptr->compress ) { continue; }
+    s_ptr->codec = APG_MESH_CODEC_DELTA;
+    bool oct     = APG_MESH_NORMAL == streams[i].attrib && 3 == streams[i].n_comps;
+    packed_ptrs[i] = malloc( (size_t)ply.n_vertices * sizeof( uint16_t ) * ( oct ? 2 : streams[i].n_comps ) );
+    if ( !packed_ptrs[i] ) {
+      ok = 0;
+      break;
+    }
+    s_ptr->data_ptr = packed_ptrs[i];
+    if ( oct ) {
+      apg_mesh_encode_octahedral( streams[i].data_ptr, 3, (uint32_t)ply.n_vertices, 16, packed_ptrs[i] );
+      s_ptr->type    = APG_MESH_I16;
+      s_ptr->n_comps = 2;
+      s_ptr->quant   = APG_MESH_QUANT_OCT;
+    } else {
+      apg_mesh_quantise_unorm( streams[i].data_ptr, streams[i].n_comps, streams[i].n_comps, (uint32_t)ply.n_vertices, 16, packed_ptrs[i],
+        s_ptr->range_min, s_ptr->range_extent );
+      s_ptr->type  = APG_MESH_U16;
+      s_ptr->quant = APG_MESH_QUANT_UNORM;
+    }
+  }
+  desc.indices_ptr = ply.indices_ptr;
+  desc.n_indices   = (uint32_t)ply.n_indices;
+  desc.index_sz    = ply.index_sz;
+  desc.index_codec = opts_ptr->compress && ply.n_indices ? APG_MESH_CODEC_DELTA : APG_MESH_CODEC_NONE;
+  ok               = ok && apg_mesh_write( mesh_filename, &desc, source_ptr );
+  for ( int i = 0; i < 4; i++ ) { free( packed_ptrs[i] ); }
+  apg_ply_delete( &ply );
+  return ok;
+}
+
+int main( int argc, char** argv ) {
+  const char *src_filename = NULL, *mesh_filename = NULL;
+  cook_opts_t opts = ( cook_opts_t ){ .indexed = false };
+  for ( int i = 1; i < argc; i++ ) {
+    if ( 0 == strcmp( argv[i], "-indexed" ) ) {
+      opts.indexed = true;
+    } else if ( 0 == strcmp( argv[i], "-compress" ) ) {
+      opts.compress = true;
+    } else if ( !src_filename ) {
+      src_filename = argv[i];
+    } else {
+      mesh_filename = argv[i];
+    }
+  }
+  if ( !src_filename ) {
+    printf( "Usage: %s [-indexed] [-compress] input.ply [output.mesh]\n", argv[0] );
+    return 0;
+  }
+  char default_filename[1024];
+  if ( !mesh_filename ) {
+    snprintf( default_filename, sizeof( default_filename ), "%s.mesh", src_filename );
+    mesh_filename = default_filename;
+  }
+
+  apg_time_init();
+  if ( !apg_jobs_init( 0 ) ) { fprintf( stderr, "WARNING: could not start job threads. cooking on this thread only\n" ); }
+  double t = apg_time_s();
+  apg_mesh_source_t source;
+  bool ok = apg_mesh_source_info( src_filename, 1, &source ) && _cook_ply( src_filename, mesh_filename, &source, &opts );
+  apg_jobs_free();
+  if ( !ok ) {
+    fprintf( stderr, "ERROR: could not cook `%s` into `%s`\n", src_filename, mesh_filename );
+    return 1;
+  }
+  apg_mesh_t mesh;
+  if ( !apg_mesh_open( mesh_filename, 0, &mesh ) ) {
+    fprintf( stderr, "ERROR: cooked `%s` does not open\n", mesh_filename );
+    return 1;
+  }
+  const apg_mesh_header_t* hdr_ptr = mesh.header_ptr;
+  printf( "cooked `%s` into `%s` in %.1f ms\n", src_filename, mesh_filename, ( apg_time_s() - t ) * 1000.0 );
+  printf( "  %u vertices, %u streams, %u indices of %u bytes. %llu bytes in all\n", hdr_ptr->n_vertices, hdr_ptr->n_streams, hdr_ptr->n_indices,
+    hdr_ptr->index_sz, (unsigned long long)hdr_ptr->file_sz );
+  printf( "  bounds (%g %g %g) to (%g %g %g)\n", hdr_ptr->bounds_min[0], hdr_ptr->bounds_min[1], hdr_ptr->bounds_min[2], hdr_ptr->bounds_max[0],
+    hdr_ptr->bounds_max[1], hdr_ptr->bounds_max[2] );
+  apg_mesh_close( &mesh );
+  return 0;
+}
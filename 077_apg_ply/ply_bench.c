@@ -0,0 +1,315 @@
+/* Load-time benchmark for binary and ascii PLY files, on a generated scan-sized mesh.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -I ../common/include ply_bench.c apg_ply.c -lm -pthread -o ply_bench
+Run:
+  ./ply_bench [n_vertices] [-ascii]
+
+Writes a grid mesh of about n_vertices (default 10M) shared vertices, with two triangles per grid square, laid out as range scans
+usually are: `float x y z confidence intensity` vertices and `list uchar int vertex_indices` faces. A second copy adds `uchar red green
+blue`, so its colours go through the per-property conversion rather than the packed float copy. Each is then read with apg_ply_read(),
+which triangulates into unindexed streams, and opened with apg_ply_view_open(), which only maps the file; the view's time includes
+summing every position, to touch all the vertex data. With -ascii an `x y z` ascii copy is also written and read, on this thread and
+then on every core through the apg.h job system, and its positions are checked against the binary file's. Files are written to the
+working directory and deleted afterwards. They are read from a warm page cache, so this measures parsing rather than disk bandwidth.
+
+Two small files with a later component of a stream but not its first, `green blue` without `red` and `y z` without `x`, must be
+rejected by apg_ply_read() and given no streams by apg_ply_view_open().
+
+The grid is then read with apg_ply_read_indexed(), which keeps each vertex once, with and without APG_PLY_OPTIMISE, and the memory of
+both results is compared. `ACMR` is the average cache miss ratio, vertices transformed per triangle, for FIFO post-transform caches of 16
+and 32 entries, simulated by apg_ply_acmr(). It's shown for the file's row-by-row order, for the same triangles shuffled, as a mesh
+exported in an arbitrary order might be, and for both after apg_ply_optimise(), then for cage.ply if it's in the working directory.
+The optimised grid is written with apg_ply_write_binary() and read back, and must come back identical.
+
+Finally the optimised grid is cooked into an apg_mesh.h file and opened with apg_mesh_open(), which maps it and checks its hash, and
+with APG_MESH_NO_VERIFY ("unverified"), timed with a sum of every position as for the view. Both must match the mesh that was cooked.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#define APG_MESH_IMPLEMENTATION
+#include "apg_mesh.h"
+#include "apg_ply.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCAN_FN "ply_bench_scan.ply"
+#define COLOUR_FN "ply_bench_colour.ply"
+#define MESH_FN "ply_bench.mesh"
+#define ASCII_FN "ply_bench_ascii.ply"
+#define INDEXED_FN "ply_bench_indexed.ply"
+#define MISSING_FN "ply_bench_missing.ply"
+
+// grid positions are multiples of 1/64, which ascii's 6 decimal places store exactly.
+static void _grid_position( int side, int idx, float* xyz ) {
+  int i  = idx % side, j = idx / side;
+  xyz[0] = i / 64.0f;
+  xyz[1] = j / 64.0f;
+  xyz[2] = ( ( i * 7 + j * 3 ) % 64 ) / 64.0f;
+}
+
+static bool _write_grid( const char* filename, int side, bool colours, bool ascii ) {
+  FILE* f = fopen( filename, ascii ? "w" : "wb" );
+  if ( !f ) { return false; }
+  int n_vertices = side * side, n_faces = 2 * ( side - 1 ) * ( side - 1 );
+  fprintf( f, "ply\nformat %s 1.0\nelement vertex %i\n", ascii ? "ascii" : "binary_little_endian", n_vertices );
+  fprintf( f, "property float x\nproperty float y\nproperty float z\n" );
+  if ( !ascii ) { fprintf( f, "property float confidence\nproperty float intensity\n" ); }
+  if ( colours ) { fprintf( f, "property uchar red\nproperty uchar green\nproperty uchar blue\n" ); }
+  fprintf( f, "element face %i\nproperty list uchar int vertex_indices\nend_header\n", n_faces );
+  bool ok = true;
+  for ( int v = 0; ok && v < n_vertices; v++ ) {
+    float vertex[5] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.5f };
+    _grid_position( side, v, vertex );
+    if ( ascii ) {
+      ok = fprintf( f, "%f %f %f\n", vertex[0], vertex[1], vertex[2] ) > 0;
+      continue;
+    }
+    uint8_t rgb[3] = { (uint8_t)( v % side ), (uint8_t)( v / side ), 128 };
+    ok             = 1 == fwrite( vertex, sizeof( vertex ), 1, f ) && ( !colours || 1 == fwrite( rgb, 3, 1, f ) );
+  }
+  for ( int j = 0; ok && j < side - 1; j++ ) {
+    for ( int i = 0; ok && i < side - 1; i++ ) {
+      int32_t a = j * side + i, b = a + 1, c = a + side, d = c + 1;
+      int32_t tris[2][3] = { { a, b, d }, { a, d, c } };
+      for ( int t = 0; ok && t < 2; t++ ) {
+        if ( ascii ) {
+          ok = fprintf( f, "3 %i %i %i\n", tris[t][0], tris[t][1], tris[t][2] ) > 0;
+          continue;
+        }
+        uint8_t n = 3;
+        ok        = 1 == fwrite( &n, 1, 1, f ) && 1 == fwrite( tris[t], sizeof( tris[t] ), 1, f );
+      }
+    }
+  }
+  return 0 == fclose( f ) && ok;
+}
+
+// float components after a missing first one used to be checked for packing against the missing one's offset.
+static bool _check_missing_first_components( void ) {
+  const char* props_strs[2] = { "property float x\nproperty float y\nproperty float z\nproperty float green\nproperty float blue\n", "property float y\nproperty float z\n" };
+  const int n_floats[2]     = { 5, 2 };
+  bool ok                   = true;
+  for ( int i = 0; i < 2; i++ ) {
+    FILE* f = fopen( MISSING_FN, "wb" );
+    if ( !f ) { return false; }
+    float vertex[5] = { 0.0f };
+    fprintf( f, "ply\nformat binary_little_endian 1.0\nelement vertex 1\n%selement face 0\nproperty list uchar int vertex_indices\nend_header\n", props_strs[i] );
+    bool written  = 1 == fwrite( vertex, sizeof( float ) * n_floats[i], 1, f );
+    written       = 0 == fclose( f ) && written;
+    apg_ply_t ply = apg_ply_read( MISSING_FN );
+    apg_ply_view_t view;
+    bool opened   = apg_ply_view_open( MISSING_FN, &view );
+    bool rejected = !ply.loaded && ( !opened || ( view.positions_offset < 0 && view.colours_offset < 0 ) );
+    if ( opened ) { apg_ply_view_close( &view ); }
+    apg_ply_delete( &ply );
+    ok = ok && written && rejected;
+  }
+  remove( MISSING_FN );
+  printf( "  missing first components %s\n", ok ? "rejected" : "NOT REJECTED" );
+  return ok;
+}
+
+static void _print_acmr( const char* label, apg_ply_t ply ) {
+  printf( "  %-28s %10.3f %10.3f\n", label, apg_ply_acmr( ply, 16 ), apg_ply_acmr( ply, 32 ) );
+}
+
+static size_t _mesh_bytes( apg_ply_t ply ) {
+  int n_comps = ply.n_positions_comps + ply.n_normals_comps + ply.n_texcoords_comps + ply.n_colours_comps;
+  return sizeof( float ) * n_comps * ply.n_vertices + (size_t)ply.index_sz * ply.n_indices;
+}
+
+// Fisher-Yates over whole triangles, so each keeps its winding.
+static void _shuffle_triangles( apg_ply_t ply ) {
+  uint32_t* indices = (uint32_t*)ply.indices_ptr;
+  apg_srand( 1 );
+  for ( int t = ply.n_indices / 3 - 1; t > 0; t-- ) {
+    int r = ( ( apg_rand() << 15 ) | apg_rand() ) % ( t + 1 );
+    for ( int c = 0; c < 3; c++ ) {
+      uint32_t tmp       = indices[t * 3 + c];
+      indices[t * 3 + c] = indices[r * 3 + c];
+      indices[r * 3 + c] = tmp;
+    }
+  }
+}
+
+// every triangle corner of the indexed mesh has the position of the matching unindexed vertex.
+static bool _same_triangles( apg_ply_t indexed, apg_ply_t unindexed ) {
+  if ( !indexed.loaded || 4 != indexed.index_sz || indexed.n_indices != unindexed.n_vertices ) { return false; }
+  for ( int i = 0; i < indexed.n_indices; i++ ) {
+    uint32_t v = ( (const uint32_t*)indexed.indices_ptr )[i];
+    if ( 0 != memcmp( &indexed.positions_ptr[v * 3], &unindexed.positions_ptr[i * 3], sizeof( float ) * 3 ) ) { return false; }
+  }
+  return true;
+}
+
+static void _print_read( const char* label, const char* filename, double s, int n_vertices ) {
+  double mb = apg_file_size( filename ) / ( 1024.0 * 1024.0 );
+  printf( "  %-28s %10.1f ms %9.1f MB/s %10.2f M output vertices/s\n", label, s * 1000.0, mb / s, n_vertices / s / 1e6 );
+}
+
+static volatile double _sink; // keeps position sums from being optimised away.
+
+static bool _bench_cooked( apg_ply_t ply ) {
+  apg_mesh_desc_t desc = ( apg_mesh_desc_t ){ .n_vertices = (uint32_t)ply.n_vertices, .n_streams = 1 };
+  desc.streams[0]      = ( apg_mesh_stream_desc_t ){
+    .attrib = APG_MESH_POSITION, .type = APG_MESH_F32, .n_comps = ply.n_positions_comps, .data_ptr = ply.positions_ptr };
+  desc.indices_ptr     = ply.indices_ptr;
+  desc.n_indices       = (uint32_t)ply.n_indices;
+  desc.index_sz        = ply.index_sz;
+  double t             = apg_time_s();
+  if ( !apg_mesh_write( MESH_FN, &desc, NULL ) ) { return false; }
+  printf( "  %-28s %10.1f ms %9.1f MB\n", "apg_mesh_write()", ( apg_time_s() - t ) * 1000.0, apg_file_size( MESH_FN ) / ( 1024.0 * 1024.0 ) );
+
+  bool ok = true;
+  for ( int pass = 0; pass < 2; pass++ ) {
+    apg_mesh_t mesh;
+    double sum = 0.0;
+    t          = apg_time_s();
+    if ( !apg_mesh_open( MESH_FN, 0 == pass ? 0 : APG_MESH_NO_VERIFY, &mesh ) ) {
+      ok = false;
+      break;
+    }
+    const float* positions_ptr = apg_mesh_stream( &mesh, APG_MESH_POSITION, NULL, NULL );
+    if ( 1 == pass ) {
+      for ( uint32_t i = 0; i < mesh.n_vertices * 3; i++ ) { sum += positions_ptr[i]; }
+    }
+    _print_read( 0 == pass ? "apg_mesh_open()" : "apg_mesh_open() unverified", MESH_FN, apg_time_s() - t, (int)mesh.n_vertices );
+    _sink += sum;
+    ok = ok && mesh.n_vertices == (uint32_t)ply.n_vertices && mesh.n_indices == (uint32_t)ply.n_indices &&
+         0 == memcmp( positions_ptr, ply.positions_ptr, sizeof( float ) * 3 * ply.n_vertices ) &&
+         0 == memcmp( mesh.indices_ptr, ply.indices_ptr, (size_t)ply.index_sz * ply.n_indices );
+    apg_mesh_close( &mesh );
+  }
+  printf( "  cooked mesh %s\n", ok ? "matches" : "DIFFERS" );
+  remove( MESH_FN );
+  return ok;
+}
+
+int main( int argc, char** argv ) {
+  int n_target    = 10 * 1000 * 1000;
+  bool with_ascii = false;
+  for ( int i = 1; i < argc; i++ ) {
+    if ( 0 == strcmp( argv[i], "-ascii" ) ) {
+      with_ascii = true;
+    } else {
+      n_target = APG_MAX( atoi( argv[i] ), 4 );
+    }
+  }
+  apg_time_init();
+  int side = (int)sqrt( (double)n_target );
+  double t = apg_time_s();
+  if ( !_write_grid( SCAN_FN, side, false, false ) || !_write_grid( COLOUR_FN, side, true, false ) ||
+       ( with_ascii && !_write_grid( ASCII_FN, side, false, true ) ) ) {
+    fprintf( stderr, "ERROR: writing test files\n" );
+    return 1;
+  }
+  printf( "%ix%i grid: %i vertices, %i triangles. files written in %.1f s\n", side, side, side * side, 2 * ( side - 1 ) * ( side - 1 ), apg_time_s() - t );
+  printf( "  %-28s %10.1f MB, %.1f MB\n", "binary sizes", apg_file_size( SCAN_FN ) / ( 1024.0 * 1024.0 ), apg_file_size( COLOUR_FN ) / ( 1024.0 * 1024.0 ) );
+  if ( with_ascii ) { printf( "  %-28s %10.1f MB\n", "ascii size", apg_file_size( ASCII_FN ) / ( 1024.0 * 1024.0 ) ); }
+
+  bool ok     = true;
+  t           = apg_time_s();
+  apg_ply_t a = apg_ply_read( SCAN_FN );
+  _print_read( "apg_ply_read() binary", SCAN_FN, apg_time_s() - t, a.n_vertices );
+  ok = a.loaded && 3 == a.n_positions_comps && 0 == a.n_colours_comps;
+
+  t           = apg_time_s();
+  apg_ply_t b = apg_ply_read( COLOUR_FN );
+  _print_read( "apg_ply_read() binary + rgb", COLOUR_FN, apg_time_s() - t, b.n_vertices );
+  ok = ok && b.loaded && 3 == b.n_colours_comps && b.n_vertices == a.n_vertices &&
+       0 == memcmp( a.positions_ptr, b.positions_ptr, sizeof( float ) * 3 * a.n_vertices );
+  apg_ply_delete( &b );
+
+  t = apg_time_s();
+  apg_ply_view_t view;
+  double sum = 0.0;
+  if ( apg_ply_view_open( SCAN_FN, &view ) && view.positions_offset >= 0 ) {
+    for ( int v = 0; v < view.n_vertices; v++ ) {
+      float xyz[3];
+      memcpy( xyz, &view.vertices_ptr[(size_t)v * view.vertex_stride + view.positions_offset], sizeof( xyz ) );
+      sum += xyz[0] + xyz[1] + xyz[2];
+    }
+    _print_read( "apg_ply_view_open() + sum", SCAN_FN, apg_time_s() - t, view.n_vertices );
+    ok = ok && NULL != view.faces_ptr && 2 * ( side - 1 ) * ( side - 1 ) == view.n_faces;
+    apg_ply_view_close( &view );
+  } else {
+    ok = false;
+  }
+
+  ok = _check_missing_first_components() && ok;
+
+  { // indexed
+    t             = apg_time_s();
+    apg_ply_t ind = apg_ply_read_indexed( SCAN_FN, 0 );
+    _print_read( "apg_ply_read_indexed()", SCAN_FN, apg_time_s() - t, ind.n_vertices );
+    t             = apg_time_s();
+    apg_ply_t opt = apg_ply_read_indexed( SCAN_FN, APG_PLY_OPTIMISE );
+    _print_read( "apg_ply_read_indexed() + opt", SCAN_FN, apg_time_s() - t, opt.n_vertices );
+    ok = ok && ind.n_vertices == side * side && opt.n_vertices == side * side && _same_triangles( ind, a );
+    printf( "  %-28s %10.1f MB indexed, %.1f MB unindexed\n", "memory", _mesh_bytes( ind ) / ( 1024.0 * 1024.0 ),
+      sizeof( float ) * 3 * a.n_vertices / ( 1024.0 * 1024.0 ) );
+    printf( "  %-28s %10s %10s\n", "ACMR", "FIFO 16", "FIFO 32" );
+    _print_acmr( "file order", ind );
+    _print_acmr( "file order, optimised", opt );
+    if ( ind.loaded ) {
+      _shuffle_triangles( ind );
+      _print_acmr( "shuffled", ind );
+      t  = apg_time_s();
+      ok = ok && apg_ply_optimise( &ind );
+      printf( "  %-28s %10.1f ms\n", "apg_ply_optimise()", ( apg_time_s() - t ) * 1000.0 );
+      _print_acmr( "shuffled, optimised", ind );
+    }
+    apg_ply_t cage = apg_ply_read_indexed( "cage.ply", 0 );
+    if ( cage.loaded ) {
+      printf( "  cage.ply: %i vertices, %i triangles\n", cage.n_vertices, cage.n_indices / 3 );
+      _print_acmr( "file order", cage );
+      ok = ok && apg_ply_optimise( &cage );
+      _print_acmr( "optimised", cage );
+    }
+    apg_ply_delete( &cage );
+
+    // the optimised mesh's vertices are already in first-use order, so reading it back reproduces it exactly.
+    apg_ply_t back = ( apg_ply_t ){ .loaded = 0 };
+    if ( apg_ply_write_binary( INDEXED_FN, opt ) ) { back = apg_ply_read_indexed( INDEXED_FN, 0 ); }
+    bool match = back.loaded && back.n_vertices == opt.n_vertices && back.n_indices == opt.n_indices &&
+                 0 == memcmp( back.positions_ptr, opt.positions_ptr, sizeof( float ) * 3 * opt.n_vertices ) &&
+                 0 == memcmp( back.indices_ptr, opt.indices_ptr, sizeof( uint32_t ) * opt.n_indices );
+    printf( "  indexed write and read back %s\n", match ? "match" : "DIFFER" );
+    ok = ok && match;
+    apg_ply_delete( &back );
+
+    ok = ok && _bench_cooked( opt );
+    apg_ply_delete( &opt );
+    apg_ply_delete( &ind );
+    remove( INDEXED_FN );
+  }
+
+  if ( with_ascii ) {
+    // the ascii body is parsed in parallel once apg_jobs_init() has been called.
+    for ( int pass = 0; pass < 2; pass++ ) {
+      if ( 1 == pass && !apg_jobs_init( 0 ) ) { break; }
+      char label[64];
+      snprintf( label, sizeof( label ), "apg_ply_read() ascii, %i thr", APG_MAX( apg_jobs_n_threads(), 1 ) );
+      t           = apg_time_s();
+      apg_ply_t c = apg_ply_read( ASCII_FN );
+      _print_read( label, ASCII_FN, apg_time_s() - t, c.n_vertices );
+      bool match = c.loaded && c.n_vertices == a.n_vertices && 0 == memcmp( a.positions_ptr, c.positions_ptr, sizeof( float ) * 3 * a.n_vertices );
+      printf( "  ascii and binary positions %s\n", match ? "match" : "DIFFER" );
+      ok = ok && match;
+      apg_ply_delete( &c );
+    }
+    apg_jobs_free();
+  }
+  apg_ply_delete( &a );
+  remove( SCAN_FN );
+  remove( COLOUR_FN );
+  if ( with_ascii ) { remove( ASCII_FN ); }
+  if ( !ok ) { fprintf( stderr, "ERROR: a file didn't load as expected (position sum %f)\n", sum ); }
+  return ok ? 0 : 1;
+}
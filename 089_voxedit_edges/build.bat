@@ -1,4 +1,4 @@
-gcc -g -Wfatal-errors -DGLEW_STATIC ^
+gcc -g -Wfatal-errors -DGLEW_STATIC -DAPG_PROFILER ^
 main.c voxels.c apg_ply.c apg_pixfont.c gl_utils.c input.c camera.c ^
 -I ..\common\include\ -L ..\common\win64_gcc\ ^
 ..\common\src\GL\glew.c ..\common\win64_gcc\libglfw3dll.a ^
@@ -1,4 +1,4 @@
 #!/bin/bash
-gcc -Wall -Wextra -Wfatal-errors -pedantic -g \
+gcc -Wall -Wextra -Wfatal-errors -pedantic -g -DAPG_PROFILER \
 main.c voxels.c apg_ply.c apg_pixfont.c camera.c input.c gl_utils.c \
-../common/src/GL/glew.c -I../common/include/ -lm -lglfw -lGL
+../common/src/GL/glew.c -I../common/include/ -lm -lglfw -lGL -pthread
@@ -6,6 +6,9 @@ TODO
     - and also save a .apgvox file or so
 */
 
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
 #include "apg_maths.h"
 #include "apg_pixfont.h"
 #include "apg_ply.h"
@@ -23,11 +26,15 @@ TODO
 // exports to a PLY, baking the correct colours from the palette
 bool export_voxel_ply( const char* filename, const chunk_t* chunk ) {
   assert( filename && chunk );
+  APG_PROF_BEGIN( "export_voxel_ply" );
 
   // load latest v of palette
   uint32_t w, h, n;
   uint8_t* palette_img = apg_tga_read_file( "palette.tga", &w, &h, &n, 0 );
-  if ( !palette_img ) { return false; }
+  if ( !palette_img ) {
+    APG_PROF_END();
+    return false;
+  }
 
   // fetch buffers of vertex data
   chunk_vertex_data_t vertex_data = chunk_gen_vertex_data( chunk );
@@ -58,6 +65,7 @@ bool export_voxel_ply( const char* filename, const chunk_t* chunk ) {
   }
 
   // write
+  APG_PROF_BEGIN( "apg_ply_write" );
   uint32_t r = apg_ply_write( filename, ( apg_ply_t ){ //
                                           .positions_ptr     = vertex_data.positions_ptr,
                                           .n_normals_comps   = vertex_data.n_vn_comps,
@@ -69,11 +77,13 @@ bool export_voxel_ply( const char* filename, const chunk_t* chunk ) {
                                           .n_colours_comps   = 3,
                                           .n_texcoords_comps = 0,
                                           .n_edges_comps     = 4 } );
+  APG_PROF_END();
 
   // free mem
   free( colours_buffer );
   chunk_free_vertex_data( &vertex_data );
   free( palette_img );
+  APG_PROF_END();
 
   if ( r != 1 ) { return false; } // error writing but still free mem first
 
@@ -82,11 +92,14 @@ bool export_voxel_ply( const char* filename, const chunk_t* chunk ) {
 
 int main() {
   texture_t palette_tex;
+  apg_time_init();
   if ( !start_gl( "Voxedit by Anton Gerdelan" ) ) { return 1; }
   init_input();
   {
     int w, h, n;
+    APG_PROF_BEGIN( "load_palette" );
     uint8_t* palette_img = apg_tga_read_file( "palette.tga", &w, &h, &n, 0 );
+    APG_PROF_END();
     if ( !palette_img ) { return 1; }
     palette_tex = create_texture_from_mem( palette_img, w, h, n, false, false, true );
     assert( palette_tex.handle_gl );
@@ -237,8 +250,20 @@ int main() {
   int picked_x = -1, picked_y = -1, picked_z = -1, picked_face = -1, picked_chunk_id = -1;
   bool picked = false;
 
+  // scratch for re-meshing after edits. big enough for the worst-case chunk, so no per-edit malloc/free.
+  apg_frame_alloc_t frame_alloc;
+  {
+    size_t max_chunk_mesh_sz = (size_t)CHUNK_X * CHUNK_Y * CHUNK_Z *
+                               ( VOXEL_CUBE_VP_BYTES + VOXEL_CUBE_VN_BYTES + VOXEL_CUBE_VPICKING_BYTES + VOXEL_CUBE_VPALIDX_BYTES + VOXEL_CUBE_VEDGE_BYTES );
+    if ( !apg_frame_alloc_init( &frame_alloc, max_chunk_mesh_sz + APG_KILOBYTES( 1 ) ) ) {
+      fprintf( stderr, "ERROR: allocating frame scratch memory\n" );
+      return 1;
+    }
+  }
+
   vec2 text_scale = ( vec2 ){ .x = 1, .y = 1 }, text_pos = ( vec2 ){ .x = 0 };
   while ( !should_window_close() ) {
+    apg_frame_alloc_swap( &frame_alloc );
     int fb_width = 0, fb_height = 0, win_width = 0, win_height = 0;
     double mouse_x = 0, mouse_y = 0;
     double curr_time = get_time_s();
@@ -278,11 +303,13 @@ int main() {
         chunk_free( &chunk_b );
         chunk_b = chunk_generate_flat();
         {
-          chunk_vertex_data_t vertex_data = chunk_gen_vertex_data( &chunk_b );
-          chunk_mesh = create_mesh_from_mem( vertex_data.positions_ptr, vertex_data.n_vp_comps, vertex_data.palette_indices_ptr, vertex_data.n_vpalidx_comps,
-            vertex_data.picking_ptr, vertex_data.n_vpicking_comps, vertex_data.normals_ptr, vertex_data.n_vn_comps, vertex_data.edges_ptr,
-            vertex_data.n_vedge_comps, vertex_data.n_vertices );
-          chunk_free_vertex_data( &vertex_data );
+          chunk_vertex_data_t vertex_data = chunk_gen_vertex_data_arena( &chunk_b, apg_frame_arena( &frame_alloc ) );
+          if ( vertex_data.positions_ptr ) { // keep drawing the old mesh if the frame arena was too small
+            delete_mesh( &chunk_mesh );
+            chunk_mesh = create_mesh_from_mem( vertex_data.positions_ptr, vertex_data.n_vp_comps, vertex_data.palette_indices_ptr, vertex_data.n_vpalidx_comps,
+              vertex_data.picking_ptr, vertex_data.n_vpicking_comps, vertex_data.normals_ptr, vertex_data.n_vn_comps, vertex_data.edges_ptr,
+              vertex_data.n_vedge_comps, vertex_data.n_vertices );
+          }
         }
       }
 
@@ -304,14 +331,14 @@ int main() {
           changed = set_block_type_in_chunk( &chunk_b, picked_x, picked_y, picked_z, BLOCK_TYPE_AIR );
         }
         if ( changed ) {
-          // TODO(Anton) reuse a scratch buffer to avoid mallocs
-          chunk_vertex_data_t vertex_data = chunk_gen_vertex_data( &chunk_b );
-          // TODO(Anton) and reuse the previous VBOs
-          delete_mesh( &chunk_mesh );
-          chunk_mesh = create_mesh_from_mem( vertex_data.positions_ptr, vertex_data.n_vp_comps, vertex_data.palette_indices_ptr, vertex_data.n_vpalidx_comps,
-            vertex_data.picking_ptr, vertex_data.n_vpicking_comps, vertex_data.normals_ptr, vertex_data.n_vn_comps, vertex_data.edges_ptr,
-            vertex_data.n_vedge_comps, vertex_data.n_vertices );
-          chunk_free_vertex_data( &vertex_data );
+          chunk_vertex_data_t vertex_data = chunk_gen_vertex_data_arena( &chunk_b, apg_frame_arena( &frame_alloc ) );
+          // TODO(Anton) reuse the previous VBOs
+          if ( vertex_data.positions_ptr ) { // keep drawing the old mesh if the frame arena was too small
+            delete_mesh( &chunk_mesh );
+            chunk_mesh = create_mesh_from_mem( vertex_data.positions_ptr, vertex_data.n_vp_comps, vertex_data.palette_indices_ptr, vertex_data.n_vpalidx_comps,
+              vertex_data.picking_ptr, vertex_data.n_vpicking_comps, vertex_data.normals_ptr, vertex_data.n_vn_comps, vertex_data.edges_ptr,
+              vertex_data.n_vedge_comps, vertex_data.n_vertices );
+          }
         }
       }
       bool cam_fwd = false, cam_bk = false, cam_left = false, cam_rgt = false, turn_left = false, turn_right = false;
@@ -427,7 +454,9 @@ int main() {
 
       uint8_t data[4] = { 0, 0, 0, 0 };
       // TODO(Anton) this is blocking cpu/gpu sync and can stall. to speed up use the 2-PBO method perhaps.
+      APG_PROF_BEGIN( "picking_read_pixels" );
       read_pixels( x + w / 2, y + h / 2, 1, 1, 4, data );
+      APG_PROF_END();
       picked = picked_colour_to_voxel_idx( data[0], data[1], data[2], data[3], &picked_x, &picked_y, &picked_z, &picked_face, &picked_chunk_id );
       if ( picked ) {
         sprintf( hovered_voxel_str, "chunk_id=%i voxel=(%i,%i,%i) face=%i", picked_chunk_id, picked_x, picked_y, picked_z, picked_face );
@@ -437,9 +466,17 @@ int main() {
 
       bind_framebuffer( NULL );
     }
+    APG_PROF_BEGIN( "swap_buffer" );
     swap_buffer();
+    APG_PROF_END();
+    APG_PROF_FRAME_END();
   }
 
+  apg_prof_print_frame_stats( stdout );
+  if ( !apg_prof_write_chrome_trace( "trace.json" ) ) { fprintf( stderr, "ERROR: writing trace.json\n" ); }
+  apg_prof_free();
+
+  apg_frame_alloc_free( &frame_alloc );
   chunk_free( &chunk_b );
   free( fps_img_mem );
   delete_mesh( &chunk_mesh );
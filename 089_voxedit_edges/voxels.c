@@ -1,4 +1,5 @@
 #include "voxels.h"
+#include "apg.h"
 #include "apg_tga.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -289,7 +290,7 @@ static void _memcpy_face_picking( int x, int y, int z, int face_idx, float* dest
   uint32_t c    = face_idx;        // up 0-5
   float buff[3] = { a / 255.0f, b / 255.0f, c / 255.0f };
   // per the 6 vertices in this face
-  assert( curr_float + VOXEL_VPICKING_COMPS * VOXEL_FACE_VERTS < max_floats );
+  assert( curr_float + VOXEL_VPICKING_COMPS * VOXEL_FACE_VERTS <= max_floats );
   for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) { memcpy( &dest[curr_float + v * VOXEL_VPICKING_COMPS], buff, sizeof( float ) * VOXEL_VPICKING_COMPS ); }
 }
 
@@ -308,7 +309,7 @@ static void _memcpy_face_normals( const chunk_t* chunk, int x, int y, int z, int
   }
   bool sunlit = is_voxel_face_exposed_to_sun( chunk, x, y, z, face_idx );
   if ( sunlit ) { buff[3] = 1.0f; }
-  assert( curr_float + VOXEL_VN_COMPS * VOXEL_FACE_VERTS < max_floats );
+  assert( curr_float + VOXEL_VN_COMPS * VOXEL_FACE_VERTS <= max_floats );
   for ( int v = 0; v < VOXEL_FACE_VERTS; v++ ) { memcpy( &dest[curr_float + v * VOXEL_VN_COMPS], buff, sizeof( float ) * VOXEL_VN_COMPS ); }
 }
 
@@ -531,30 +532,92 @@ static void _memcpy_face_edges( const chunk_t* chunk, int x, int y, int z, int f
     }
     bool sunlit = is_voxel_face_exposed_to_sun( chunk, x, y, z, face_idx );
     if ( sunlit ) { buff[3] = 1.0f; }
-    assert( curr_float + VOXEL_VN_COMPS * VOXEL_FACE_VERTS < max_floats );
+    assert( curr_float + VOXEL_VN_COMPS * VOXEL_FACE_VERTS <= max_floats );
     */
 }
 
-chunk_vertex_data_t chunk_gen_vertex_data( const chunk_t* chunk ) {
+// a face is drawn if its neighbour is air or outside the chunk
+static bool _is_face_exposed( const chunk_t* chunk, int x, int y, int z, int face_idx ) {
+  // clang-format off
+  static const int xs[6] = { -1,  1,  0,  0,  0,  0 };
+  static const int ys[6] = {  0,  0, -1,  1,  0,  0 };
+  static const int zs[6] = {  0,  0,  0,  0, -1,  1 };
+  // clang-format on
+  block_type_t neighbour_block_type;
+  bool ret = get_block_type_in_chunk( chunk, x + xs[face_idx], y + ys[face_idx], z + zs[face_idx], &neighbour_block_type );
+  return !ret || neighbour_block_type == BLOCK_TYPE_AIR;
+}
+
+static uint32_t _popcount32( uint32_t v ) {
+  v = v - ( ( v >> 1 ) & 0x55555555u );
+  v = ( v & 0x33333333u ) + ( ( v >> 2 ) & 0x33333333u );
+  return ( ( ( v + ( v >> 4 ) ) & 0x0F0F0F0Fu ) * 0x01010101u ) >> 24;
+}
+
+// counting pass so buffers can be allocated at their exact size instead of worst-case-then-realloc.
+// each row along x is packed into a bitmask of non-air voxels, so a face is exposed where our bit is set and the neighbouring row's (or shifted) bit isn't.
+// that's one lookup per voxel here rather than repeating _fill_vertex_data()'s six neighbour lookups.
+static uint32_t _count_exposed_faces( const chunk_t* chunk ) {
+  assert( CHUNK_X <= 32 );
+  uint32_t rows[CHUNK_Y][CHUNK_Z];
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      uint32_t mask = 0;
+      for ( int x = 0; x < CHUNK_X; x++ ) {
+        block_type_t our_block_type = 0;
+        get_block_type_in_chunk( chunk, x, y, z, &our_block_type );
+        if ( our_block_type != BLOCK_TYPE_AIR ) { mask |= 1u << x; }
+      }
+      rows[y][z] = mask;
+    }
+  }
+
+  // outside the chunk counts as air, so missing rows are 0 and shifted-in bits are 0
+  uint32_t n_faces = 0;
+  for ( int y = 0; y < CHUNK_Y; y++ ) {
+    for ( int z = 0; z < CHUNK_Z; z++ ) {
+      uint32_t row = rows[y][z];
+      if ( !row ) { continue; }
+      uint32_t below = y > 0 ? rows[y - 1][z] : 0, above = y < CHUNK_Y - 1 ? rows[y + 1][z] : 0;
+      uint32_t north = z > 0 ? rows[y][z - 1] : 0, south = z < CHUNK_Z - 1 ? rows[y][z + 1] : 0;
+      n_faces += _popcount32( row & ~( row << 1 ) ) + _popcount32( row & ~( row >> 1 ) ); // west, east
+      n_faces += _popcount32( row & ~below ) + _popcount32( row & ~above );
+      n_faces += _popcount32( row & ~north ) + _popcount32( row & ~south );
+    }
+  }
+  return n_faces;
+}
+
+static chunk_vertex_data_t _vertex_data_for_faces( uint32_t n_faces ) {
   chunk_vertex_data_t data = ( chunk_vertex_data_t ){
     .n_vp_comps = VOXEL_VP_COMPS, .n_vpicking_comps = VOXEL_VPICKING_COMPS, .n_vn_comps = VOXEL_VN_COMPS, .n_vpalidx_comps = VOXEL_VPALIDX_COMPS, .n_vedge_comps = VOXEL_VEDGE_COMPS
   };
-  data.vp_buffer_sz       = VOXEL_CUBE_VP_BYTES * chunk->n_non_air_voxels;
-  data.vn_buffer_sz       = VOXEL_CUBE_VN_BYTES * chunk->n_non_air_voxels;
-  data.vpicking_buffer_sz = VOXEL_CUBE_VPICKING_BYTES * chunk->n_non_air_voxels;
-  data.vpalidx_buffer_sz  = VOXEL_CUBE_VPALIDX_BYTES * chunk->n_non_air_voxels;
-  data.vedge_buffer_sz    = VOXEL_CUBE_VEDGE_BYTES * chunk->n_non_air_voxels;
-
-  data.positions_ptr = malloc( data.vp_buffer_sz );
-  assert( data.positions_ptr );
-  data.palette_indices_ptr = malloc( data.vpalidx_buffer_sz );
-  assert( data.palette_indices_ptr );
-  data.picking_ptr = malloc( data.vpicking_buffer_sz );
-  assert( data.picking_ptr );
-  data.normals_ptr = malloc( data.vn_buffer_sz );
-  assert( data.normals_ptr );
-  data.edges_ptr = malloc( data.vedge_buffer_sz );
-  assert( data.edges_ptr );
+  data.n_vertices         = n_faces * VOXEL_FACE_VERTS;
+  data.vp_buffer_sz       = VOXEL_FACE_VP_BYTES * n_faces;
+  data.vn_buffer_sz       = VOXEL_FACE_VN_BYTES * n_faces;
+  data.vpicking_buffer_sz = VOXEL_FACE_VPICKING_BYTES * n_faces;
+  data.vpalidx_buffer_sz  = VOXEL_FACE_VPALIDX_BYTES * n_faces;
+  data.vedge_buffer_sz    = VOXEL_FACE_VEDGE_BYTES * n_faces;
+  return data;
+}
+
+// all five streams live in one block, positions first, so one allocation serves a mesh and freeing positions_ptr frees the lot.
+// every per-face stream size is a multiple of 4 bytes so each stream stays aligned for its floats/uints.
+static size_t _vertex_data_block_sz( const chunk_vertex_data_t* data ) {
+  return data->vp_buffer_sz + data->vpalidx_buffer_sz + data->vpicking_buffer_sz + data->vn_buffer_sz + data->vedge_buffer_sz;
+}
+
+static void _vertex_data_carve_block( chunk_vertex_data_t* data, uint8_t* block_ptr ) {
+  data->positions_ptr       = (float*)block_ptr;
+  data->palette_indices_ptr = (uint32_t*)( block_ptr += data->vp_buffer_sz );
+  data->picking_ptr         = (float*)( block_ptr += data->vpalidx_buffer_sz );
+  data->normals_ptr         = (float*)( block_ptr += data->vpicking_buffer_sz );
+  data->edges_ptr           = (float*)( block_ptr += data->vn_buffer_sz );
+}
+
+// writes vertex data for exactly `n_faces` exposed faces into buffers already allocated by the caller
+static void _fill_vertex_data( const chunk_t* chunk, uint32_t n_faces, chunk_vertex_data_t* data ) {
+  const float* faces[6] = { _west_face, _east_face, _bottom_face, _top_face, _north_face, _south_face };
 
   uint32_t total_vp_floats    = 0;
   uint32_t total_vn_floats    = 0;
@@ -569,74 +632,76 @@ chunk_vertex_data_t chunk_gen_vertex_data( const chunk_t* chunk ) {
         int floats_added_this_block = 0;
         assert( ret );
         if ( our_block_type == BLOCK_TYPE_AIR ) { continue; }
-        assert( total_vp_floats < VOXEL_CUBE_VP_FLOATS * chunk->n_non_air_voxels );
-
-        {
-          // clang-format off
-          int xs[6]             = { -1,  1,  0,  0,  0,  0 };
-          int ys[6]             = {  0,  0, -1,  1,  0,  0 };
-          int zs[6]             = {  0,  0,  0,  0, -1,  1 };
-          // clang-format on
-          const float* faces[6] = { _west_face, _east_face, _bottom_face, _top_face, _north_face, _south_face };
-          block_type_t neighbour_block_type;
-          for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
-            bool ret = get_block_type_in_chunk( chunk, x + xs[face_idx], y + ys[face_idx], z + zs[face_idx], &neighbour_block_type );
-            // if face is valid then add one face's worth of vertex data to the buffer
-            if ( !ret || neighbour_block_type == BLOCK_TYPE_AIR ) {
-              memcpy( &data.positions_ptr[total_vp_floats + floats_added_this_block], faces[face_idx], VOXEL_FACE_VP_BYTES );
-              _memcpy_face_palidx( our_block_type, &data.palette_indices_ptr[total_palindices] );
-              _memcpy_face_picking( x, y, z, face_idx, data.picking_ptr, total_vp_floats + floats_added_this_block, VOXEL_CUBE_VPICKING_FLOATS * chunk->n_non_air_voxels );
-              _memcpy_face_normals( chunk, x, y, z, face_idx, data.normals_ptr, total_vn_floats, VOXEL_CUBE_VN_FLOATS * chunk->n_non_air_voxels );
-              _memcpy_face_edges( chunk, x, y, z, face_idx, data.edges_ptr, total_vedge_floats, VOXEL_CUBE_VEDGE_FLOATS * chunk->n_non_air_voxels );
-              floats_added_this_block += VOXEL_FACE_VP_FLOATS;
-              total_vn_floats += VOXEL_FACE_VN_FLOATS;
-              total_palindices += VOXEL_FACE_VPALIDX_UINTS;
-              total_vedge_floats += VOXEL_FACE_VEDGE_FLOATS;
-            }
-          }
+
+        for ( int face_idx = 0; face_idx < 6; face_idx++ ) {
+          if ( !_is_face_exposed( chunk, x, y, z, face_idx ) ) { continue; }
+          assert( total_vp_floats + floats_added_this_block < VOXEL_FACE_VP_FLOATS * n_faces );
+          memcpy( &data->positions_ptr[total_vp_floats + floats_added_this_block], faces[face_idx], VOXEL_FACE_VP_BYTES );
+          _memcpy_face_palidx( our_block_type, &data->palette_indices_ptr[total_palindices] );
+          _memcpy_face_picking( x, y, z, face_idx, data->picking_ptr, total_vp_floats + floats_added_this_block, VOXEL_FACE_VPICKING_FLOATS * n_faces );
+          _memcpy_face_normals( chunk, x, y, z, face_idx, data->normals_ptr, total_vn_floats, VOXEL_FACE_VN_FLOATS * n_faces );
+          _memcpy_face_edges( chunk, x, y, z, face_idx, data->edges_ptr, total_vedge_floats, VOXEL_FACE_VEDGE_FLOATS * n_faces );
+          floats_added_this_block += VOXEL_FACE_VP_FLOATS;
+          total_vn_floats += VOXEL_FACE_VN_FLOATS;
+          total_palindices += VOXEL_FACE_VPALIDX_UINTS;
+          total_vedge_floats += VOXEL_FACE_VEDGE_FLOATS;
         }
 
         // assumes xyz positions are first three bytes per vertex
         for ( int i = 0; i < floats_added_this_block; i += 3 ) {
-          data.positions_ptr[total_vp_floats + i + 0] += x * 2.0f;
-          data.positions_ptr[total_vp_floats + i + 1] += y * 2.0f;
-          data.positions_ptr[total_vp_floats + i + 2] += z * 2.0f;
+          data->positions_ptr[total_vp_floats + i + 0] += x * 2.0f;
+          data->positions_ptr[total_vp_floats + i + 1] += y * 2.0f;
+          data->positions_ptr[total_vp_floats + i + 2] += z * 2.0f;
         }
         total_vp_floats += floats_added_this_block;
       } // endfor x
     }   // endfor z
   }     // endfor y
+  assert( total_vp_floats == VOXEL_FACE_VP_FLOATS * n_faces );
+}
+
+chunk_vertex_data_t chunk_gen_vertex_data( const chunk_t* chunk ) {
+  APG_PROF_BEGIN( "chunk_gen_vertex_data" );
+  uint32_t n_faces         = _count_exposed_faces( chunk );
+  chunk_vertex_data_t data = _vertex_data_for_faces( n_faces );
+
+  // +1 so an empty chunk still gets a non-NULL block, which chunk_free_vertex_data() expects
+  uint8_t* block_ptr = malloc( _vertex_data_block_sz( &data ) + 1 );
+  assert( block_ptr );
+  _vertex_data_carve_block( &data, block_ptr );
+
+  _fill_vertex_data( chunk, n_faces, &data );
+
+  APG_PROF_COUNTER( "chunk vertices", data.n_vertices );
+  APG_PROF_END();
+  return data;
+}
+
+chunk_vertex_data_t chunk_gen_vertex_data_arena( const chunk_t* chunk, apg_arena_t* arena_ptr ) {
+  assert( arena_ptr );
+  APG_PROF_BEGIN( "chunk_gen_vertex_data_arena" );
+  uint32_t n_faces         = _count_exposed_faces( chunk );
+  chunk_vertex_data_t data = _vertex_data_for_faces( n_faces );
+
+  uint8_t* block_ptr = apg_arena_alloc( arena_ptr, _vertex_data_block_sz( &data ) );
+  if ( !block_ptr ) {
+    fprintf( stderr, "ERROR: arena too small for chunk vertex data (%u faces).\n", n_faces );
+    APG_PROF_END();
+    return ( chunk_vertex_data_t ){ .n_vertices = 0 };
+  }
+  _vertex_data_carve_block( &data, block_ptr );
 
-  data.n_vp_comps         = VOXEL_VP_COMPS;
-  data.n_vertices         = total_vp_floats / VOXEL_VP_COMPS;
-  data.vp_buffer_sz       = total_vp_floats * sizeof( float );
-  data.vn_buffer_sz       = total_vn_floats * sizeof( float );
-  data.vpicking_buffer_sz = total_vp_floats * sizeof( float ); // NOTE(Anton) same as vp
-  data.vpalidx_buffer_sz  = total_palindices * sizeof( uint32_t );
-  data.vedge_buffer_sz    = total_vedge_floats * sizeof( float );
-
-  data.positions_ptr = realloc( data.positions_ptr, data.vp_buffer_sz );
-  assert( data.positions_ptr );
-  data.palette_indices_ptr = realloc( data.palette_indices_ptr, data.vpalidx_buffer_sz );
-  assert( data.palette_indices_ptr );
-  data.picking_ptr = realloc( data.picking_ptr, data.vpicking_buffer_sz );
-  assert( data.picking_ptr );
-  data.normals_ptr = realloc( data.normals_ptr, data.vn_buffer_sz );
-  assert( data.normals_ptr );
-  data.edges_ptr = realloc( data.edges_ptr, data.vedge_buffer_sz );
-  assert( data.edges_ptr );
+  _fill_vertex_data( chunk, n_faces, &data );
 
+  APG_PROF_COUNTER( "chunk vertices", data.n_vertices );
+  APG_PROF_END();
   return data;
 }
 
 void chunk_free_vertex_data( chunk_vertex_data_t* chunk_vertex_data ) {
   assert( chunk_vertex_data && chunk_vertex_data->positions_ptr );
 
-  free( chunk_vertex_data->positions_ptr );
-  free( chunk_vertex_data->palette_indices_ptr );
-  free( chunk_vertex_data->picking_ptr );
-  free( chunk_vertex_data->normals_ptr );
-  free( chunk_vertex_data->edges_ptr );
+  free( chunk_vertex_data->positions_ptr ); // the other streams are carved from the same block
   memset( chunk_vertex_data, 0, sizeof( chunk_vertex_data_t ) );
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "apg.h"
 #include "apg_maths.h"
 #include <stdbool.h>
 #include <stdio.h>
@@ -88,8 +89,13 @@ void chunk_free( chunk_t* chunk );
 
 bool chunk_write_heightmap( const char* filename, const chunk_t* chunk );
 
+// the five vertex streams share one malloc'd block starting at positions_ptr. free with chunk_free_vertex_data().
 chunk_vertex_data_t chunk_gen_vertex_data( const chunk_t* chunk );
 
+// as chunk_gen_vertex_data() but the block comes from the arena. don't call chunk_free_vertex_data() on the result; reset the arena instead.
+// returns n_vertices == 0 and NULL buffers if the arena is too small.
+chunk_vertex_data_t chunk_gen_vertex_data_arena( const chunk_t* chunk, apg_arena_t* arena_ptr );
+
 void chunk_free_vertex_data( chunk_vertex_data_t* chunk_vertex_data );
 
 bool get_block_type_in_chunk( const chunk_t* chunk, int x, int y, int z, block_type_t* block_type );
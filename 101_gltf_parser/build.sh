@@ -3,6 +3,6 @@ clang \
 -fsanitize=address \
 -Wall -Wextra -pedantic \
 -g \
-main.c apg_maths.c apg_pixfont.c apg_ply.c gfx.c gfx_gltf.c gltf.c input.c cJSON/cJSON.c glad/src/glad.c \
+main.c apg_maths.c apg_pixfont.c apg_ply.c gfx.c gfx_gltf.c gltf.c input.c glad/src/glad.c \
 -I glad/include/ \
 -lglfw -lGL -lm
@@ -31,30 +31,37 @@ static bool gltf_read_entire_file( const char* filename, _entire_file_t* record
   return true;
 }
 
-// TODO(Anton) validate array acceses
-static uint8_t* _byte_pointer_for_attrib( const gltf_t* gltf_ptr, const _entire_file_t* buffers_ptr, int attrib_accessor_idx, int* count ) {
-  if ( !gltf_ptr || attrib_accessor_idx < 0 || !buffers_ptr || !count ) { return NULL; }
+/* RETURNS a pointer to an accessor's elements, tightly packed, with the number of them in count, or NULL if the accessor is invalid or runs
+past the end of its buffer view. The pointer is straight into the buffer, e.g. the mapped .glb, unless the buffer view interleaves the
+accessor with others. Then its elements are copied out into *copy_ptr, which the caller frees. */
+static const uint8_t* _byte_pointer_for_attrib( const gltf_t* gltf_ptr, int attrib_accessor_idx, int* count, uint8_t** copy_ptr ) {
+  *copy_ptr = NULL;
+  if ( !gltf_ptr || attrib_accessor_idx < 0 || attrib_accessor_idx >= gltf_ptr->n_accessors || !count ) { return NULL; }
 
   // accessor
-  int buffer_view_idx             = gltf_ptr->accessors_ptr[attrib_accessor_idx].buffer_view_idx;
-  int accessor_byte_offset        = gltf_ptr->accessors_ptr[attrib_accessor_idx].byte_offset;
-  gltf_component_type_t comp_type = gltf_ptr->accessors_ptr[attrib_accessor_idx].component_type; // # bytes per component
-  *count                          = gltf_ptr->accessors_ptr[attrib_accessor_idx].count;
-  gltf_type_t type                = gltf_ptr->accessors_ptr[attrib_accessor_idx].type;
+  const gltf_accessor_t* accessor_ptr = &gltf_ptr->accessors_ptr[attrib_accessor_idx];
+  int buffer_view_idx                 = accessor_ptr->buffer_view_idx;
+  if ( buffer_view_idx < 0 || buffer_view_idx >= gltf_ptr->n_buffer_views ) { return NULL; }
+  int bytes_per_comp = gltf_bytes_for_component( accessor_ptr->component_type );
+  int comps_per_vert = gltf_comps_in_type( accessor_ptr->type );
+  int elem_sz        = bytes_per_comp * comps_per_vert;
 
   // buffer view
-  int buffer_idx         = gltf_ptr->buffer_views_ptr[buffer_view_idx].buffer_idx;
-  int buffer_byte_offset = gltf_ptr->buffer_views_ptr[buffer_view_idx].byte_offset;
-  // int byte_length = gltf_ptr->buffer_views_ptr[buffer_view_idx].byte_length;
-  // int byte_stride = gltf_ptr->buffer_views_ptr[buffer_view_idx].byte_stride; // NOTE(Anton) ignored until interleaved mesh found
-
-  // access the buffer
-  uint8_t* byte_ptr   = (uint8_t*)buffers_ptr[buffer_idx].data;
-  int bytes_per_comp  = gltf_bytes_for_component( comp_type );
-  int comps_per_vert  = gltf_comps_in_type( type );
-  int byte_offset     = accessor_byte_offset + buffer_byte_offset; // weird but in spec
-  uint8_t* attrib_ptr = &byte_ptr[byte_offset];
-  return attrib_ptr;
+  const gltf_buffer_view_t* bv_ptr = &gltf_ptr->buffer_views_ptr[buffer_view_idx];
+  int byte_stride                  = bv_ptr->byte_stride > 0 ? bv_ptr->byte_stride : elem_sz;
+  if ( !bv_ptr->data_ptr || elem_sz <= 0 || accessor_ptr->count < 0 || accessor_ptr->byte_offset < 0 ) { return NULL; }
+  if ( accessor_ptr->count > 0 &&
+       (int64_t)accessor_ptr->byte_offset + (int64_t)byte_stride * ( accessor_ptr->count - 1 ) + elem_sz > bv_ptr->byte_length ) {
+    return NULL;
+  }
+  *count = accessor_ptr->count;
+
+  const uint8_t* attrib_ptr = &bv_ptr->data_ptr[accessor_ptr->byte_offset]; // accessor offset is from the start of the buffer view
+  if ( byte_stride == elem_sz ) { return attrib_ptr; }
+  *copy_ptr = malloc( (size_t)elem_sz * accessor_ptr->count );
+  if ( !*copy_ptr ) { return NULL; }
+  for ( int i = 0; i < accessor_ptr->count; i++ ) { memcpy( &( *copy_ptr )[(size_t)i * elem_sz], &attrib_ptr[(size_t)i * byte_stride], elem_sz ); }
+  return *copy_ptr;
 }
 
 bool gfx_gltf_load( const char* filename, gfx_gltf_t* gfx_gltf_ptr ) {
@@ -108,68 +115,91 @@ bool gfx_gltf_load( const char* filename, gfx_gltf_t* gfx_gltf_ptr ) {
   gfx_gltf_ptr->mat_idx_for_mesh_idx_ptr = calloc( sizeof( int ), gfx_gltf_ptr->n_meshes );
   if ( !gfx_gltf_ptr->mat_idx_for_mesh_idx_ptr ) { return false; }
 
-  // load images -> textures
-  // NOTE: assumes images are all external files here
-  for ( int i = 0; i < gfx_gltf_ptr->n_textures; i++ ) {
-		if ( gfx_gltf_ptr->gltf.images_ptr[i].uri_str[0] == '\0' ) { continue; }
-    int x = 0, y = 0, comp = 0;
-    char full_path[2048];
-    strcpy( full_path, asset_path );
-    strcat( full_path, gfx_gltf_ptr->gltf.images_ptr[i].uri_str );
-    printf( "loading image %i: `%s`\n", i, full_path );
-    uint8_t* img_ptr = stbi_load( full_path, &x, &y, &comp, 0 );
-    if ( !img_ptr ) { return false; } // TODO(Anton) proper cleanup
-
-    // NB: I don't specify sRGB here as it's controlled in the shader.
-    gfx_gltf_ptr->textures_ptr[i] =
-      gfx_create_texture_from_mem( img_ptr, x, y, comp, ( gfx_texture_properties_t ){ .bilinear = true, .has_mips = true, .repeats = true } );
-    free( img_ptr );
-    if ( !gfx_gltf_ptr->textures_ptr[i].handle_gl ) { return false; }
-  }
-
   //
   // construct meshes from buffers
   //
 
+  // a .glb's buffer is already mapped. others are external files.
   for ( int i = 0; i < gfx_gltf_ptr->gltf.n_buffers; i++ ) {
+    if ( gfx_gltf_ptr->gltf.buffers_ptr[i].data_ptr ) { continue; }
     char full_path[2048];
     strcpy( full_path, asset_path );
     strcat( full_path, gfx_gltf_ptr->gltf.buffers_ptr[i].uri_str );
     printf( "loading buffer %i: `%s`\n", i, full_path );
     if ( !gltf_read_entire_file( full_path, &buffer_records_ptr[i] ) ) { return false; }
+    if ( !gltf_set_buffer_data( &gfx_gltf_ptr->gltf, i, buffer_records_ptr[i].data, buffer_records_ptr[i].sz ) ) { return false; }
+  }
+
+  // load images -> textures
+  for ( int i = 0; i < gfx_gltf_ptr->n_textures; i++ ) {
+    int x = 0, y = 0, comp = 0;
+    uint8_t* img_ptr              = NULL;
+    const gltf_image_t* image_ptr = &gfx_gltf_ptr->gltf.images_ptr[i];
+    if ( image_ptr->buffer_view_idx > -1 && image_ptr->buffer_view_idx < gfx_gltf_ptr->gltf.n_buffer_views ) {
+      const gltf_buffer_view_t* bv_ptr = &gfx_gltf_ptr->gltf.buffer_views_ptr[image_ptr->buffer_view_idx];
+      if ( !bv_ptr->data_ptr ) { continue; }
+      printf( "loading image %i from buffer view %i\n", i, image_ptr->buffer_view_idx );
+      img_ptr = stbi_load_from_memory( bv_ptr->data_ptr, bv_ptr->byte_length, &x, &y, &comp, 0 );
+    } else {
+      if ( image_ptr->uri_str[0] == '\0' ) { continue; }
+      char full_path[2048];
+      strcpy( full_path, asset_path );
+      strcat( full_path, image_ptr->uri_str );
+      printf( "loading image %i: `%s`\n", i, full_path );
+      img_ptr = stbi_load( full_path, &x, &y, &comp, 0 );
+    }
+    if ( !img_ptr ) { return false; } // TODO(Anton) proper cleanup
+
+    // NB: I don't specify sRGB here as it's controlled in the shader.
+    gfx_gltf_ptr->textures_ptr[i] =
+      gfx_create_texture_from_mem( img_ptr, x, y, comp, ( gfx_texture_properties_t ){ .bilinear = true, .has_mips = true, .repeats = true } );
+    free( img_ptr );
+    if ( !gfx_gltf_ptr->textures_ptr[i].handle_gl ) { return false; }
   }
 
   int gfx_mesh_idx = 0;
   for ( int m = 0; m < gfx_gltf_ptr->gltf.n_meshes; m++ ) {
     for ( int p = 0; p < gfx_gltf_ptr->gltf.meshes_ptr[m].n_primitives; p++ ) {
-      float* positions_ptr   = NULL;
-      float* texcoords_0_ptr = NULL;
-      float* normals_ptr     = NULL;
-      float* tangents_ptr    = NULL;
-      uint16_t* indices_ptr  = NULL; // TODO(Anton) assuming type here
+      const gltf_primitive_t* primitive_ptr = &gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p];
+      const float* positions_ptr            = NULL;
+      const float* texcoords_0_ptr          = NULL;
+      const float* normals_ptr              = NULL;
+      const uint8_t* indices_ptr            = NULL;
+      uint8_t* copies_ptr[4]                = { NULL }; // only for attributes interleaved in their buffer view
 
       int n_vertices = 0;
       int n_indices  = 0;
       // NB can get min/max here and work out a scale
-      texcoords_0_ptr = (float*)_byte_pointer_for_attrib(
-        &gfx_gltf_ptr->gltf, buffer_records_ptr, gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].attributes.texcoord_0_idx, &n_vertices );
-      normals_ptr = (float*)_byte_pointer_for_attrib(
-        &gfx_gltf_ptr->gltf, buffer_records_ptr, gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].attributes.normal_idx, &n_vertices );
-      tangents_ptr = (float*)_byte_pointer_for_attrib(
-        &gfx_gltf_ptr->gltf, buffer_records_ptr, gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].attributes.tangent_idx, &n_vertices );
-      positions_ptr = (float*)_byte_pointer_for_attrib(
-        &gfx_gltf_ptr->gltf, buffer_records_ptr, gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].attributes.position_idx, &n_vertices );
-
-      if ( gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].indices_idx > -1 ) {
-        indices_ptr =
-          (uint16_t*)_byte_pointer_for_attrib( &gfx_gltf_ptr->gltf, buffer_records_ptr, gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].indices_idx, &n_indices );
+      texcoords_0_ptr = (const float*)_byte_pointer_for_attrib( &gfx_gltf_ptr->gltf, primitive_ptr->attributes.texcoord_0_idx, &n_vertices, &copies_ptr[0] );
+      normals_ptr     = (const float*)_byte_pointer_for_attrib( &gfx_gltf_ptr->gltf, primitive_ptr->attributes.normal_idx, &n_vertices, &copies_ptr[1] );
+      positions_ptr   = (const float*)_byte_pointer_for_attrib( &gfx_gltf_ptr->gltf, primitive_ptr->attributes.position_idx, &n_vertices, &copies_ptr[2] );
+
+      gfx_indices_type_t indices_type = GFX_INDICES_TYPE_UINT16;
+      size_t index_sz                 = sizeof( uint16_t );
+      if ( primitive_ptr->indices_idx > -1 ) {
+        indices_ptr = _byte_pointer_for_attrib( &gfx_gltf_ptr->gltf, primitive_ptr->indices_idx, &n_indices, &copies_ptr[3] );
+      }
+      if ( indices_ptr ) {
+        switch ( gfx_gltf_ptr->gltf.accessors_ptr[primitive_ptr->indices_idx].component_type ) {
+        case GLTF_UNSIGNED_BYTE:
+          indices_type = GFX_INDICES_TYPE_UBYTE;
+          index_sz     = sizeof( uint8_t );
+          break;
+        case GLTF_UNSIGNED_INT:
+          indices_type = GFX_INDICES_TYPE_UINT32;
+          index_sz     = sizeof( uint32_t );
+          break;
+        default: break;
+        }
       }
 
       printf( "mesh %i n_vertices = %i n_indices= %i\n", gfx_mesh_idx, n_vertices, n_indices );
 
+      // accessor data goes straight from the buffer, or the .glb mapping, to GL.
       bool calc_tans                         = true; // TODO(Anton) heap overflow in tan code
       gfx_gltf_ptr->meshes_ptr[gfx_mesh_idx] = gfx_create_mesh_from_mem( positions_ptr, 3, texcoords_0_ptr, 2, normals_ptr, 3, NULL, 3, indices_ptr,
-        sizeof( uint16_t ) * n_indices, GFX_INDICES_TYPE_UINT16, n_vertices, false, calc_tans );
+        index_sz * n_indices, indices_type, n_vertices, false, calc_tans );
+      for ( int i = 0; i < 4; i++ ) { free( copies_ptr[i] ); }
 
       // material
       int mat_idx                               = gfx_gltf_ptr->gltf.meshes_ptr[m].primitives_ptr[p].material_idx;
@@ -180,7 +210,10 @@ bool gfx_gltf_load( const char* filename, gfx_gltf_t* gfx_gltf_ptr ) {
   }
 
   for ( int i = 0; i < gfx_gltf_ptr->gltf.n_buffers; i++ ) {
-    if ( buffer_records_ptr[i].data ) { free( buffer_records_ptr[i].data ); }
+    if ( buffer_records_ptr[i].data ) {
+      gltf_set_buffer_data( &gfx_gltf_ptr->gltf, i, NULL, 0 );
+      free( buffer_records_ptr[i].data );
+    }
   }
   free( buffer_records_ptr );
 
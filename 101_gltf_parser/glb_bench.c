@@ -0,0 +1,214 @@
+/* Benchmark for loading a .glb, which gltf_read() maps and parses in place, against the same scene as .gltf and .bin, with the .bin read
+into memory as gfx_gltf_load() does. Both then copy every accessor out once, as uploading to GL would, and must give the same bytes. The
+time to just fread() the .glb is the floor that a loader dominated by I/O gets near.
+Anton Gerdelan, antongerdelan.net
+
+Build:
+  gcc -O2 glb_bench.c gltf.c -o glb_bench
+Run:
+  ./glb_bench [n_meshes]
+
+Writes glb_bench.glb, glb_bench.gltf, and glb_bench.bin with n_meshes (default 2000, about 70MB) meshes of 1024 vertices and 512 triangles.
+Times are the best of several loads, so the files are in the OS cache, not on the disk.
+*/
+#include "gltf.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_REPEATS 5
+#define N_VERTS 1024
+#define N_INDICES 1536
+#define MESH_SZ ( N_VERTS * ( 3 + 3 + 2 ) * 4 + N_INDICES * 2 )
+
+static double _time_s( void ) {
+  struct timespec ts;
+  timespec_get( &ts, TIME_UTC );
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void _append( char** str_ptr, size_t* len_ptr, size_t* max_ptr, const char* add_str ) {
+  size_t add_len = strlen( add_str );
+  if ( *len_ptr + add_len + 1 > *max_ptr ) {
+    *max_ptr = ( *len_ptr + add_len + 1 ) * 2;
+    *str_ptr = realloc( *str_ptr, *max_ptr );
+    if ( !*str_ptr ) { exit( 1 ); }
+  }
+  memcpy( &( *str_ptr )[*len_ptr], add_str, add_len + 1 );
+  *len_ptr += add_len;
+}
+
+/* RETURNS the scene's JSON, with a bufferView per attribute, and the .bin's uri if bin_uri_str isn't NULL. */
+static char* _scene_json( int n_meshes, const char* bin_uri_str ) {
+  char* str  = NULL;
+  size_t len = 0, max = 0;
+  char tmp[512];
+  _append( &str, &len, &max, "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" );
+  for ( int i = 0; i < n_meshes; i++ ) {
+    snprintf( tmp, sizeof( tmp ), "%s%i", i ? "," : "", i );
+    _append( &str, &len, &max, tmp );
+  }
+  _append( &str, &len, &max, "]}],\n\"nodes\":[" );
+  for ( int i = 0; i < n_meshes; i++ ) {
+    snprintf( tmp, sizeof( tmp ), "%s{\"mesh\":%i,\"name\":\"node_%i\"}", i ? "," : "", i, i );
+    _append( &str, &len, &max, tmp );
+  }
+  _append( &str, &len, &max, "],\n\"meshes\":[" );
+  for ( int i = 0; i < n_meshes; i++ ) {
+    snprintf( tmp, sizeof( tmp ), "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%i,\"NORMAL\":%i,\"TEXCOORD_0\":%i},\"indices\":%i}]}", i ? "," : "", i * 4,
+      i * 4 + 1, i * 4 + 2, i * 4 + 3 );
+    _append( &str, &len, &max, tmp );
+  }
+  _append( &str, &len, &max, "],\n\"accessors\":[" );
+  for ( int i = 0; i < n_meshes * 4; i++ ) {
+    static const char* types[] = { "VEC3", "VEC3", "VEC2", "SCALAR" };
+    snprintf( tmp, sizeof( tmp ), "%s{\"bufferView\":%i,\"componentType\":%i,\"count\":%i,\"type\":\"%s\"}", i ? "," : "", i, 3 == i % 4 ? 5123 : 5126,
+      3 == i % 4 ? N_INDICES : N_VERTS, types[i % 4] );
+    _append( &str, &len, &max, tmp );
+  }
+  _append( &str, &len, &max, "],\n\"bufferViews\":[" );
+  for ( int i = 0; i < n_meshes * 4; i++ ) {
+    static const int view_szs[] = { N_VERTS * 12, N_VERTS * 12, N_VERTS * 8, N_INDICES * 2 };
+    static const int offsets[]  = { 0, N_VERTS * 12, N_VERTS * 24, N_VERTS * 32 };
+    snprintf( tmp, sizeof( tmp ), "%s{\"buffer\":0,\"byteOffset\":%i,\"byteLength\":%i}", i ? "," : "", ( i / 4 ) * MESH_SZ + offsets[i % 4], view_szs[i % 4] );
+    _append( &str, &len, &max, tmp );
+  }
+  if ( bin_uri_str ) {
+    snprintf( tmp, sizeof( tmp ), "],\n\"buffers\":[{\"byteLength\":%i,\"uri\":\"%s\"}]}\n", n_meshes * MESH_SZ, bin_uri_str );
+  } else {
+    snprintf( tmp, sizeof( tmp ), "],\n\"buffers\":[{\"byteLength\":%i}]}", n_meshes * MESH_SZ );
+  }
+  _append( &str, &len, &max, tmp );
+  return str;
+}
+
+static bool _write_u32( FILE* fp, uint32_t v ) {
+  uint8_t bytes[4] = { v & 0xFF, ( v >> 8 ) & 0xFF, ( v >> 16 ) & 0xFF, v >> 24 };
+  return 1 == fwrite( bytes, 4, 1, fp );
+}
+
+static bool _write_files( int n_meshes ) {
+  size_t bin_sz    = (size_t)n_meshes * MESH_SZ;
+  uint8_t* bin_ptr = malloc( bin_sz );
+  if ( !bin_ptr ) { return false; }
+  uint32_t state = 0x9E3779B9;
+  for ( size_t i = 0; i < bin_sz; i++ ) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    bin_ptr[i] = (uint8_t)state;
+  }
+
+  char* json_str = _scene_json( n_meshes, "glb_bench.bin" );
+  FILE* fp       = fopen( "glb_bench.gltf", "wb" );
+  bool ok        = fp && 1 == fwrite( json_str, strlen( json_str ), 1, fp );
+  ok             = fp && 0 == fclose( fp ) && ok;
+  free( json_str );
+  fp = fopen( "glb_bench.bin", "wb" );
+  ok = ok && fp && 1 == fwrite( bin_ptr, bin_sz, 1, fp );
+  ok = fp && 0 == fclose( fp ) && ok;
+
+  // header, JSON chunk padded with spaces, and BIN chunk.
+  json_str        = _scene_json( n_meshes, NULL );
+  size_t json_len = strlen( json_str ), json_pad = ( 4 - json_len % 4 ) % 4;
+  fp              = fopen( "glb_bench.glb", "wb" );
+  ok              = ok && fp && _write_u32( fp, 0x46546C67 ) && _write_u32( fp, 2 ) && _write_u32( fp, (uint32_t)( 28 + json_len + json_pad + bin_sz ) );
+  ok              = ok && _write_u32( fp, (uint32_t)( json_len + json_pad ) ) && _write_u32( fp, 0x4E4F534A ) && 1 == fwrite( json_str, json_len, 1, fp );
+  ok              = ok && json_pad == fwrite( "   ", 1, json_pad, fp );
+  ok              = ok && _write_u32( fp, (uint32_t)bin_sz ) && _write_u32( fp, 0x004E4942 ) && 1 == fwrite( bin_ptr, bin_sz, 1, fp );
+  ok              = fp && 0 == fclose( fp ) && ok;
+  free( json_str );
+  free( bin_ptr );
+  return ok;
+}
+
+/* Copies every accessor of every primitive into staging_ptr, as glBufferData() would.
+RETURNS a checksum of the copies, or 0 if an accessor didn't resolve to a pointer. */
+static uint64_t _consume( const gltf_t* gltf_ptr, uint8_t* staging_ptr ) {
+  uint64_t sum = 0;
+  for ( int m = 0; m < gltf_ptr->n_meshes; m++ ) {
+    const gltf_primitive_t* p_ptr = &gltf_ptr->meshes_ptr[m].primitives_ptr[0];
+    int idxs[4]                   = { p_ptr->attributes.position_idx, p_ptr->attributes.normal_idx, p_ptr->attributes.texcoord_0_idx, p_ptr->indices_idx };
+    for ( int a = 0; a < 4; a++ ) {
+      const gltf_accessor_t* acc_ptr   = &gltf_ptr->accessors_ptr[idxs[a]];
+      const gltf_buffer_view_t* bv_ptr = &gltf_ptr->buffer_views_ptr[acc_ptr->buffer_view_idx];
+      size_t sz = (size_t)acc_ptr->count * gltf_bytes_for_component( acc_ptr->component_type ) * gltf_comps_in_type( acc_ptr->type );
+      if ( !bv_ptr->data_ptr ) { return 0; }
+      memcpy( staging_ptr, &bv_ptr->data_ptr[acc_ptr->byte_offset], sz );
+      sum = sum * 31 + staging_ptr[0] + staging_ptr[sz - 1] + sz;
+    }
+  }
+  return sum;
+}
+
+int main( int argc, char** argv ) {
+  int n_meshes = argc > 1 ? atoi( argv[1] ) : 2000;
+  if ( n_meshes < 1 || !_write_files( n_meshes ) ) {
+    fprintf( stderr, "ERROR: could not write glb_bench files\n" );
+    return 1;
+  }
+  uint8_t* staging_ptr = malloc( N_VERTS * 12 );
+  if ( !staging_ptr ) { return 1; }
+
+  double best_s[3] = { 1e9, 1e9, 1e9 }, parse_s[2] = { 1e9, 1e9 };
+  uint64_t sums[2] = { 0 };
+  size_t glb_sz    = 0;
+  for ( int rep = 0; rep < N_REPEATS; rep++ ) {
+    { // .gltf and .bin
+      gltf_t gltf = ( gltf_t ){ 0 };
+      double t    = _time_s();
+      bool ok     = gltf_read( "glb_bench.gltf", &gltf ) && 1 == gltf.n_buffers;
+      double p    = _time_s();
+      void* bin   = NULL;
+      FILE* fp    = ok ? fopen( "glb_bench.bin", "rb" ) : NULL;
+      if ( fp ) {
+        bin = malloc( gltf.buffers_ptr[0].byte_length );
+        ok  = bin && 1 == fread( bin, gltf.buffers_ptr[0].byte_length, 1, fp ) && gltf_set_buffer_data( &gltf, 0, bin, gltf.buffers_ptr[0].byte_length );
+        fclose( fp );
+      }
+      sums[0]    = ok ? _consume( &gltf, staging_ptr ) : 0;
+      double s   = _time_s();
+      parse_s[0] = p - t < parse_s[0] ? p - t : parse_s[0];
+      best_s[0]  = s - t < best_s[0] ? s - t : best_s[0];
+      free( bin );
+      gltf_free( &gltf );
+    }
+    { // .glb
+      gltf_t gltf = ( gltf_t ){ 0 };
+      double t    = _time_s();
+      bool ok     = gltf_read( "glb_bench.glb", &gltf );
+      double p    = _time_s();
+      sums[1]     = ok ? _consume( &gltf, staging_ptr ) : 0;
+      double s    = _time_s();
+      parse_s[1]  = p - t < parse_s[1] ? p - t : parse_s[1];
+      best_s[1]   = s - t < best_s[1] ? s - t : best_s[1];
+      gltf_free( &gltf );
+    }
+    { // fread() of the .glb, and nothing else
+      double t = _time_s();
+      FILE* fp = fopen( "glb_bench.glb", "rb" );
+      if ( !fp ) { return 1; }
+      fseek( fp, 0L, SEEK_END );
+      glb_sz    = (size_t)ftell( fp );
+      void* ptr = malloc( glb_sz );
+      rewind( fp );
+      bool ok = ptr && 1 == fread( ptr, glb_sz, 1, fp );
+      fclose( fp );
+      free( ptr );
+      double s  = _time_s() - t;
+      best_s[2] = ok && s < best_s[2] ? s : best_s[2];
+    }
+  }
+  bool ok = 0 != sums[0] && sums[0] == sums[1];
+  printf( "%i meshes, %.1f MB .glb\n", n_meshes, glb_sz / ( 1024.0 * 1024.0 ) );
+  printf( ".gltf + .bin : %8.1f ms (JSON %.1f ms)\n", best_s[0] * 1000.0, parse_s[0] * 1000.0 );
+  printf( ".glb         : %8.1f ms (JSON %.1f ms) %.2fx faster %s\n", best_s[1] * 1000.0, parse_s[1] * 1000.0, best_s[0] / best_s[1], ok ? "" : "DIFFERENT" );
+  printf( "fread() .glb : %8.1f ms, and the .glb load takes %.2fx that\n", best_s[2] * 1000.0, best_s[1] / best_s[2] );
+  free( staging_ptr );
+  remove( "glb_bench.glb" );
+  remove( "glb_bench.gltf" );
+  remove( "glb_bench.bin" );
+  return ok ? 0 : 1;
+}
@@ -1,391 +1,652 @@
 #include "gltf.h"
-#include "cJSON/cJSON.h"
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define GLTF_MAX_DEPTH 64 // nesting of JSON objects and arrays allowed. glTF itself goes about 6 deep.
+
+#define GLTF_GLB_MAGIC 0x46546C67      // "glTF"
+#define GLTF_GLB_CHUNK_JSON 0x4E4F534A // "JSON"
+#define GLTF_GLB_CHUNK_BIN 0x004E4942  // "BIN\0"
+
+/* Maps a whole file read-only.
+RETURNS the mapping, with its size in sz_ptr, or NULL on any error, including an empty file. */
+static void* _gltf_map_file( const char* filename, size_t* sz_ptr ) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if ( INVALID_HANDLE_VALUE == file ) { return NULL; }
+  LARGE_INTEGER sz;
+  if ( !GetFileSizeEx( file, &sz ) || sz.QuadPart <= 0 || (uint64_t)sz.QuadPart > (uint64_t)SIZE_MAX ) {
+    CloseHandle( file );
+    return NULL;
+  }
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+  CloseHandle( file );
+  if ( !mapping ) { return NULL; }
+  void* ptr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  CloseHandle( mapping ); // the view keeps the mapping alive.
+  if ( !ptr ) { return NULL; }
+  *sz_ptr = (size_t)sz.QuadPart;
+  return ptr;
+#else
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 ) { return NULL; }
+  struct stat st;
+  if ( 0 != fstat( fd, &st ) || st.st_size <= 0 || (uint64_t)st.st_size > (uint64_t)SIZE_MAX ) {
+    close( fd );
+    return NULL;
+  }
+  void* ptr = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd ); // the mapping keeps the file open.
+  if ( MAP_FAILED == ptr ) { return NULL; }
+  *sz_ptr = (size_t)st.st_size;
+  return ptr;
+#endif
+}
 
-/* convenience struct and file->memory function */
-typedef struct _entire_file_t {
-  void* data;
-  size_t sz;
-} _entire_file_t;
+static void _gltf_unmap_file( void* ptr, size_t sz ) {
+#ifdef _WIN32
+  (void)sz;
+  UnmapViewOfFile( ptr );
+#else
+  munmap( ptr, sz );
+#endif
+}
+
+// .glb integers are little-endian.
+static uint32_t _gltf_u32( const uint8_t* ptr ) {
+  return (uint32_t)ptr[0] | (uint32_t)ptr[1] << 8 | (uint32_t)ptr[2] << 16 | (uint32_t)ptr[3] << 24;
+}
 
 /*
-RETURNS
-- true on success. record->data is allocated memory and must be freed by the caller.
-- false on any error. Any allocated memory is freed if false is returned */
-static bool gltf_read_entire_file( const char* filename, _entire_file_t* record ) {
-  FILE* fp = fopen( filename, "rb" );
-  if ( !fp ) { return false; }
-  fseek( fp, 0L, SEEK_END );
-  record->sz   = (size_t)ftell( fp );
-  record->data = malloc( record->sz );
-  if ( !record->data ) {
-    fclose( fp );
-    return false;
+JSON tokens, in the style of jsmn: the file is split in place into a flat array of tokens, each a range of bytes in the mapped file, with
+no copies and no allocation per value. gltf_read() then walks the array once, front to back, filling in the gltf_t structs as it goes.
+Objects and arrays hold the index of the token after their last child, so stepping to the next array element, or over a value that
+isn't wanted, is one jump, and the nth element of a big array is never searched for from the start.
+*/
+typedef enum _gltf_tok_type_t { GLTF_TOK_OBJECT, GLTF_TOK_ARRAY, GLTF_TOK_STRING, GLTF_TOK_PRIMITIVE } _gltf_tok_type_t;
+
+typedef struct _gltf_tok_t {
+  _gltf_tok_type_t type;
+  int start, end; // byte range in the JSON. strings don't include their quotes.
+  int size;       // elements in an array, or key/value pairs in an object. each key is a string token followed by its value.
+  int next;       // index of the token after this one and everything in it.
+} _gltf_tok_t;
+
+typedef struct _gltf_tokeniser_t {
+  const char* js;
+  int len, pos;
+  _gltf_tok_t* toks_ptr;
+  int n_toks, max_toks;
+} _gltf_tokeniser_t;
+
+// RETURNS the new token's index, or -1 if out of memory.
+static int _gltf_new_tok( _gltf_tokeniser_t* t_ptr, _gltf_tok_type_t type, int start ) {
+  if ( t_ptr->n_toks == t_ptr->max_toks ) {
+    _gltf_tok_t* toks_ptr = realloc( t_ptr->toks_ptr, sizeof( _gltf_tok_t ) * t_ptr->max_toks * 2 );
+    if ( !toks_ptr ) { return -1; }
+    t_ptr->toks_ptr = toks_ptr;
+    t_ptr->max_toks *= 2;
   }
-  rewind( fp );
-  size_t nr = fread( record->data, record->sz, 1, fp );
-  fclose( fp );
-  if ( 1 != nr ) { return false; }
-  return true;
+  int idx                = t_ptr->n_toks++;
+  t_ptr->toks_ptr[idx] = ( _gltf_tok_t ){ .type = type, .start = start, .end = start, .next = idx + 1 };
+  return idx;
 }
 
-// NB If I wrote my own JSON parser it could directly copy into these structs... (I end up with like 3 versions of file data in mem)
-bool gltf_read( const char* filename, gltf_t* gltf_ptr ) {
-  _entire_file_t record = { 0 };
-  bool ret              = gltf_read_entire_file( filename, &record );
-  if ( !ret ) { return false; }
+static void _gltf_skip_space( _gltf_tokeniser_t* t_ptr ) {
+  while ( t_ptr->pos < t_ptr->len ) {
+    char c = t_ptr->js[t_ptr->pos];
+    if ( ' ' != c && '\n' != c && '\r' != c && '\t' != c ) { break; }
+    t_ptr->pos++;
+  }
+}
 
-  char* json_char_ptr = (char*)record.data;
+static bool _gltf_is_delimiter( char c ) { return ' ' == c || '\n' == c || '\r' == c || '\t' == c || ',' == c || ':' == c || ']' == c || '}' == c; }
+
+// RETURNS the index of the value's token, or -1 on a syntax error or if out of memory.
+static int _gltf_tokenise_value( _gltf_tokeniser_t* t_ptr, int depth ) {
+  _gltf_skip_space( t_ptr );
+  if ( t_ptr->pos >= t_ptr->len || depth > GLTF_MAX_DEPTH ) { return -1; }
+  const char* js = t_ptr->js;
+  char c         = js[t_ptr->pos];
+
+  if ( '{' == c || '[' == c ) {
+    bool object = '{' == c;
+    char close  = object ? '}' : ']';
+    int idx     = _gltf_new_tok( t_ptr, object ? GLTF_TOK_OBJECT : GLTF_TOK_ARRAY, t_ptr->pos );
+    if ( idx < 0 ) { return -1; }
+    t_ptr->pos++;
+    _gltf_skip_space( t_ptr );
+    int size = 0;
+    if ( t_ptr->pos < t_ptr->len && close == js[t_ptr->pos] ) {
+      t_ptr->pos++;
+    } else {
+      for ( ;; ) {
+        if ( object ) {
+          _gltf_skip_space( t_ptr );
+          if ( t_ptr->pos >= t_ptr->len || '"' != js[t_ptr->pos] || _gltf_tokenise_value( t_ptr, depth + 1 ) < 0 ) { return -1; }
+          _gltf_skip_space( t_ptr );
+          if ( t_ptr->pos >= t_ptr->len || ':' != js[t_ptr->pos++] ) { return -1; }
+        }
+        if ( _gltf_tokenise_value( t_ptr, depth + 1 ) < 0 ) { return -1; }
+        size++;
+        _gltf_skip_space( t_ptr );
+        if ( t_ptr->pos >= t_ptr->len ) { return -1; }
+        c = js[t_ptr->pos++];
+        if ( close == c ) { break; }
+        if ( ',' != c ) { return -1; }
+      }
+    }
+    t_ptr->toks_ptr[idx].size = size;
+    t_ptr->toks_ptr[idx].end  = t_ptr->pos;
+    t_ptr->toks_ptr[idx].next = t_ptr->n_toks;
+    return idx;
+  }
 
-  cJSON* json_ptr = cJSON_ParseWithLength( json_char_ptr, record.sz );
-  if ( !json_ptr ) {
-    fprintf( stderr, "ERROR: gltf. cJSON_ParseWithLength\n" );
-    free( record.data );
-    return false;
+  if ( '"' == c ) {
+    int idx = _gltf_new_tok( t_ptr, GLTF_TOK_STRING, t_ptr->pos + 1 );
+    if ( idx < 0 ) { return -1; }
+    t_ptr->pos++;
+    while ( t_ptr->pos < t_ptr->len && '"' != js[t_ptr->pos] ) {
+      unsigned char ch = (unsigned char)js[t_ptr->pos];
+      if ( ch < 0x20 ) { return -1; }
+      t_ptr->pos += '\\' == ch ? 2 : 1;
+    }
+    if ( t_ptr->pos >= t_ptr->len ) { return -1; }
+    t_ptr->toks_ptr[idx].end = t_ptr->pos++;
+    return idx;
   }
 
-  // "asset"
-  cJSON* asset_ptr = cJSON_GetObjectItem( json_ptr, "asset" );
-  if ( asset_ptr ) {
-    cJSON* version_ptr = cJSON_GetObjectItem( asset_ptr, "version" );
-    if ( version_ptr ) { strncat( gltf_ptr->version_str, version_ptr->valuestring, 15 ); }
-  }
-
-  // get top-level objects
-  cJSON* scene_ptr = cJSON_GetObjectItem( json_ptr, "scene" );
-  // and arrays
-  cJSON* accessors_ptr    = cJSON_GetObjectItem( json_ptr, "accessors" );
-  cJSON* buffers_ptr      = cJSON_GetObjectItem( json_ptr, "buffers" );
-  cJSON* buffer_views_ptr = cJSON_GetObjectItem( json_ptr, "bufferViews" );
-  cJSON* images_ptr       = cJSON_GetObjectItem( json_ptr, "images" );
-  cJSON* materials_ptr    = cJSON_GetObjectItem( json_ptr, "materials" );
-  cJSON* meshes_ptr       = cJSON_GetObjectItem( json_ptr, "meshes" );
-  cJSON* nodes_ptr        = cJSON_GetObjectItem( json_ptr, "nodes" );
-  cJSON* samplers_ptr     = cJSON_GetObjectItem( json_ptr, "samplers" );
-  cJSON* scenes_ptr       = cJSON_GetObjectItem( json_ptr, "scenes" );
-  cJSON* textures_ptr     = cJSON_GetObjectItem( json_ptr, "textures" );
-
-  //
-  // count top-level array elements
-  //
-  if ( accessors_ptr && cJSON_IsArray( accessors_ptr ) ) { gltf_ptr->n_accessors = cJSON_GetArraySize( accessors_ptr ); }
-  if ( buffers_ptr && cJSON_IsArray( buffers_ptr ) ) { gltf_ptr->n_buffers = cJSON_GetArraySize( buffers_ptr ); }
-  if ( buffer_views_ptr && cJSON_IsArray( buffer_views_ptr ) ) { gltf_ptr->n_buffer_views = cJSON_GetArraySize( buffer_views_ptr ); }
-  if ( images_ptr && cJSON_IsArray( images_ptr ) ) { gltf_ptr->n_images = cJSON_GetArraySize( images_ptr ); }
-  if ( materials_ptr && cJSON_IsArray( materials_ptr ) ) { gltf_ptr->n_materials = cJSON_GetArraySize( materials_ptr ); }
-  if ( meshes_ptr && cJSON_IsArray( meshes_ptr ) ) { gltf_ptr->n_meshes = cJSON_GetArraySize( meshes_ptr ); }
-  if ( nodes_ptr && cJSON_IsArray( nodes_ptr ) ) { gltf_ptr->n_nodes = cJSON_GetArraySize( nodes_ptr ); }
-  if ( samplers_ptr && cJSON_IsArray( samplers_ptr ) ) { gltf_ptr->n_samplers = cJSON_GetArraySize( samplers_ptr ); }
-  if ( scenes_ptr && cJSON_IsArray( scenes_ptr ) ) { gltf_ptr->n_scenes = cJSON_GetArraySize( scenes_ptr ); }
-  if ( textures_ptr && cJSON_IsArray( textures_ptr ) ) { gltf_ptr->n_textures = cJSON_GetArraySize( textures_ptr ); }
-
-  //
-  // alloc structs
-  //
-  if ( gltf_ptr->n_accessors > 0 ) {
-    gltf_ptr->accessors_ptr = calloc( sizeof( gltf_accessor_t ), gltf_ptr->n_accessors );
-    assert( gltf_ptr->accessors_ptr );
-  }
-  if ( gltf_ptr->n_buffers > 0 ) {
-    gltf_ptr->buffers_ptr = calloc( sizeof( gltf_buffer_t ), gltf_ptr->n_buffers );
-    assert( gltf_ptr->buffers_ptr );
-  }
-  if ( gltf_ptr->n_buffer_views > 0 ) {
-    gltf_ptr->buffer_views_ptr = calloc( sizeof( gltf_buffer_view_t ), gltf_ptr->n_buffer_views );
-    assert( gltf_ptr->buffer_views_ptr );
-  }
-  if ( gltf_ptr->n_images > 0 ) {
-    gltf_ptr->images_ptr = calloc( sizeof( gltf_image_t ), gltf_ptr->n_images );
-    assert( gltf_ptr->images_ptr );
-  }
-  if ( gltf_ptr->n_materials > 0 ) {
-    gltf_ptr->materials_ptr = calloc( sizeof( gltf_material_t ), gltf_ptr->n_materials );
-    assert( gltf_ptr->materials_ptr );
-  }
-  if ( gltf_ptr->n_meshes > 0 ) {
-    gltf_ptr->meshes_ptr = calloc( sizeof( gltf_mesh_t ), gltf_ptr->n_meshes );
-    assert( gltf_ptr->meshes_ptr );
-    for ( int m = 0; m < gltf_ptr->n_meshes; m++ ) {
-      cJSON* mesh_ptr       = cJSON_GetArrayItem( meshes_ptr, m );
-      cJSON* primitives_ptr = cJSON_GetObjectItem( mesh_ptr, "primitives" );
-      if ( primitives_ptr && cJSON_IsArray( primitives_ptr ) ) {
-        gltf_ptr->meshes_ptr[m].n_primitives   = cJSON_GetArraySize( primitives_ptr );
-        gltf_ptr->meshes_ptr[m].primitives_ptr = calloc( sizeof( gltf_primitive_t ), gltf_ptr->meshes_ptr[m].n_primitives );
-        assert( gltf_ptr->meshes_ptr[m].primitives_ptr );
-      }
+  // a number, true, false, or null
+  int start = t_ptr->pos;
+  while ( t_ptr->pos < t_ptr->len && !_gltf_is_delimiter( js[t_ptr->pos] ) ) { t_ptr->pos++; }
+  int len = t_ptr->pos - start;
+  if ( 0 == len ) { return -1; }
+  if ( '-' != c && ( c < '0' || c > '9' ) ) {
+    if ( !( 4 == len && 0 == strncmp( &js[start], "true", 4 ) ) && !( 5 == len && 0 == strncmp( &js[start], "false", 5 ) ) &&
+         !( 4 == len && 0 == strncmp( &js[start], "null", 4 ) ) ) {
+      return -1;
     }
   }
-  if ( gltf_ptr->n_nodes > 0 ) {
-    gltf_ptr->nodes_ptr = calloc( sizeof( gltf_node_t ), gltf_ptr->n_nodes );
-    assert( gltf_ptr->nodes_ptr );
+  int idx = _gltf_new_tok( t_ptr, GLTF_TOK_PRIMITIVE, start );
+  if ( idx < 0 ) { return -1; }
+  t_ptr->toks_ptr[idx].end = t_ptr->pos;
+  return idx;
+}
+
+/* Splits len bytes of JSON into tokens. The root value is token 0.
+RETURNS an allocated array of tokens, to be freed by the caller, or NULL on a syntax error or if out of memory. */
+static _gltf_tok_t* _gltf_tokenise( const char* js, int len, int* n_toks_ptr ) {
+  _gltf_tokeniser_t tokeniser = ( _gltf_tokeniser_t ){ .js = js, .len = len, .max_toks = len / 16 + 64 };
+  tokeniser.toks_ptr          = malloc( sizeof( _gltf_tok_t ) * tokeniser.max_toks );
+  if ( !tokeniser.toks_ptr ) { return NULL; }
+  bool ok = _gltf_tokenise_value( &tokeniser, 0 ) == 0;
+  _gltf_skip_space( &tokeniser );
+  if ( !ok || tokeniser.pos != len ) {
+    fprintf( stderr, "ERROR: gltf. JSON syntax error near byte %i\n", tokeniser.pos );
+    free( tokeniser.toks_ptr );
+    return NULL;
   }
-  if ( gltf_ptr->n_samplers > 0 ) {
-    gltf_ptr->samplers_ptr = calloc( sizeof( gltf_sampler_t ), gltf_ptr->n_samplers );
-    assert( gltf_ptr->samplers_ptr );
+  *n_toks_ptr = tokeniser.n_toks;
+  return tokeniser.toks_ptr;
+}
+
+static bool _gltf_key_is( const char* js, const _gltf_tok_t* tok_ptr, const char* key ) {
+  size_t len = strlen( key );
+  return (size_t)( tok_ptr->end - tok_ptr->start ) == len && 0 == memcmp( &js[tok_ptr->start], key, len );
+}
+
+// Numbers as cJSON's valuedouble: 0 for anything that isn't a number.
+static double _gltf_double( const char* js, const _gltf_tok_t* tok_ptr ) {
+  if ( GLTF_TOK_PRIMITIVE != tok_ptr->type ) { return 0.0; }
+  char c = js[tok_ptr->start];
+  if ( '-' != c && ( c < '0' || c > '9' ) ) { return 0.0; }
+  return strtod( &js[tok_ptr->start], NULL ); // stops at the delimiter that ends every number inside the root object.
+}
+
+// Numbers as cJSON's valueint: truncated and clamped to int, with true as 1. Plain integers, which are most of glTF, skip strtod().
+static int _gltf_int( const char* js, const _gltf_tok_t* tok_ptr ) {
+  if ( GLTF_TOK_PRIMITIVE != tok_ptr->type ) { return 0; }
+  if ( 't' == js[tok_ptr->start] ) { return 1; }
+  int i       = tok_ptr->start;
+  bool neg    = '-' == js[i];
+  int64_t val = 0;
+  for ( i += neg ? 1 : 0; i < tok_ptr->end && js[i] >= '0' && js[i] <= '9' && val <= INT_MAX; i++ ) { val = val * 10 + ( js[i] - '0' ); }
+  if ( i == tok_ptr->end && i > tok_ptr->start + ( neg ? 1 : 0 ) && val <= INT_MAX ) { return (int)( neg ? -val : val ); }
+  double d = _gltf_double( js, tok_ptr );
+  return d >= INT_MAX ? INT_MAX : ( d <= INT_MIN ? INT_MIN : (int)d );
+}
+
+static int _gltf_hex4( const char* str, int len ) {
+  int val = 0;
+  for ( int i = 0; i < 4; i++ ) {
+    if ( i >= len ) { return -1; }
+    char c = str[i];
+    val *= 16;
+    if ( c >= '0' && c <= '9' ) {
+      val += c - '0';
+    } else if ( c >= 'a' && c <= 'f' ) {
+      val += c - 'a' + 10;
+    } else if ( c >= 'A' && c <= 'F' ) {
+      val += c - 'A' + 10;
+    } else {
+      return -1;
+    }
   }
-  if ( gltf_ptr->n_scenes > 0 ) {
-    gltf_ptr->scenes_ptr = calloc( sizeof( gltf_scene_t ), gltf_ptr->n_scenes );
-    assert( gltf_ptr->scenes_ptr );
+  return val;
+}
 
-    for ( int s = 0; s < gltf_ptr->n_scenes; s++ ) {
-      cJSON* scene_ptr      = cJSON_GetArrayItem( scenes_ptr, s );
-      cJSON* nodes_list_ptr = cJSON_GetObjectItem( scene_ptr, "nodes" );
-      if ( nodes_list_ptr && cJSON_IsArray( nodes_list_ptr ) ) {
-        gltf_ptr->scenes_ptr[s].n_node_idxs = cJSON_GetArraySize( nodes_list_ptr );
-        if ( gltf_ptr->scenes_ptr[s].n_node_idxs > 0 ) {
-          gltf_ptr->scenes_ptr[s].node_idxs_ptr = calloc( sizeof( int ), gltf_ptr->scenes_ptr[s].n_node_idxs );
-          assert( gltf_ptr->scenes_ptr[s].node_idxs_ptr );
+// Copies a string token into dst_str, decoding escapes, as strncat() of cJSON's valuestring into an empty dst_str would. Other tokens are ignored.
+static void _gltf_string( const char* js, const _gltf_tok_t* tok_ptr, char* dst_str, int dst_sz ) {
+  if ( GLTF_TOK_STRING != tok_ptr->type ) { return; }
+  int n = 0;
+  for ( int i = tok_ptr->start; i < tok_ptr->end && n < dst_sz - 1; ) {
+    char c = js[i++];
+    if ( '\\' != c ) {
+      dst_str[n++] = c;
+      continue;
+    }
+    c = js[i++];
+    switch ( c ) {
+    case 'b': dst_str[n++] = '\b'; break;
+    case 'f': dst_str[n++] = '\f'; break;
+    case 'n': dst_str[n++] = '\n'; break;
+    case 'r': dst_str[n++] = '\r'; break;
+    case 't': dst_str[n++] = '\t'; break;
+    case 'u': {
+      int cp = _gltf_hex4( &js[i], tok_ptr->end - i );
+      if ( cp < 0 ) { break; }
+      i += 4;
+      if ( cp >= 0xD800 && cp < 0xDC00 && i + 1 < tok_ptr->end && '\\' == js[i] && 'u' == js[i + 1] ) { // UTF-16 surrogate pair
+        int lo = _gltf_hex4( &js[i + 2], tok_ptr->end - i - 2 );
+        if ( lo >= 0xDC00 && lo < 0xE000 ) {
+          cp = 0x10000 + ( ( cp - 0xD800 ) << 10 ) + ( lo - 0xDC00 );
+          i += 6;
         }
       }
+      unsigned char utf8[4];
+      int n_bytes = 0;
+      if ( cp < 0x80 ) {
+        utf8[n_bytes++] = (unsigned char)cp;
+      } else if ( cp < 0x800 ) {
+        utf8[n_bytes++] = (unsigned char)( 0xC0 | cp >> 6 );
+        utf8[n_bytes++] = (unsigned char)( 0x80 | ( cp & 0x3F ) );
+      } else if ( cp < 0x10000 ) {
+        utf8[n_bytes++] = (unsigned char)( 0xE0 | cp >> 12 );
+        utf8[n_bytes++] = (unsigned char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+        utf8[n_bytes++] = (unsigned char)( 0x80 | ( cp & 0x3F ) );
+      } else {
+        utf8[n_bytes++] = (unsigned char)( 0xF0 | cp >> 18 );
+        utf8[n_bytes++] = (unsigned char)( 0x80 | ( ( cp >> 12 ) & 0x3F ) );
+        utf8[n_bytes++] = (unsigned char)( 0x80 | ( ( cp >> 6 ) & 0x3F ) );
+        utf8[n_bytes++] = (unsigned char)( 0x80 | ( cp & 0x3F ) );
+      }
+      for ( int b = 0; b < n_bytes && n < dst_sz - 1; b++ ) { dst_str[n++] = (char)utf8[b]; }
+    } break;
+    default: dst_str[n++] = c; break; // '"', '\\', and '/'
     }
   }
-  if ( gltf_ptr->n_textures > 0 ) {
-    gltf_ptr->textures_ptr = calloc( sizeof( gltf_texture_t ), gltf_ptr->n_textures );
-    assert( gltf_ptr->textures_ptr );
+  dst_str[n] = '\0';
+}
+
+// RETURNS a zeroed array with an element for each in the JSON array at tok_ptr, and its length in n_ptr, or NULL if it's empty or not an array.
+static void* _gltf_alloc_array( const _gltf_tok_t* tok_ptr, size_t elem_sz, int* n_ptr ) {
+  *n_ptr = GLTF_TOK_ARRAY == tok_ptr->type ? tok_ptr->size : 0;
+  if ( *n_ptr <= 0 ) { return NULL; }
+  void* array_ptr = calloc( elem_sz, *n_ptr );
+  assert( array_ptr );
+  return array_ptr;
+}
+
+// The "index" of a textureInfo object such as "normalTexture", if it has one.
+static void _gltf_read_texture_info( const char* js, const _gltf_tok_t* toks_ptr, int idx, int* texture_idx_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "index" ) ) { *texture_idx_ptr = _gltf_int( js, &toks_ptr[k + 1] ); }
   }
+}
 
-  //
-  // parse into structs
-  //
+static void _gltf_read_accessor( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_accessor_t* accessor_ptr ) {
+  static const char* type_strs[] = { "SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4" };
+  accessor_ptr->buffer_view_idx  = -1;
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    const _gltf_tok_t* key_ptr = &toks_ptr[k];
+    const _gltf_tok_t* val_ptr = &toks_ptr[k + 1];
+    if ( _gltf_key_is( js, key_ptr, "bufferView" ) ) {
+      accessor_ptr->buffer_view_idx = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "byteOffset" ) ) {
+      accessor_ptr->byte_offset = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "componentType" ) ) {
+      accessor_ptr->component_type = (gltf_component_type_t)_gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "count" ) ) {
+      accessor_ptr->count = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "name" ) ) {
+      _gltf_string( js, val_ptr, accessor_ptr->name_str, GLTF_NAME_MAX );
+    } else if ( _gltf_key_is( js, key_ptr, "type" ) ) {
+      for ( int t = 0; t < 7; t++ ) {
+        if ( _gltf_key_is( js, val_ptr, type_strs[t] ) ) { accessor_ptr->type = (gltf_type_t)t; }
+      }
+    } else if ( _gltf_key_is( js, key_ptr, "max" ) || _gltf_key_is( js, key_ptr, "min" ) ) {
+      if ( GLTF_TOK_ARRAY != val_ptr->type || 3 != val_ptr->size ) { continue; }
+      bool max       = 'a' == js[key_ptr->start + 1];
+      float* dst_ptr = max ? accessor_ptr->max : accessor_ptr->min;
+      for ( int i = 0, c = k + 2; i < 3; i++, c = toks_ptr[c].next ) { dst_ptr[i] = (float)_gltf_double( js, &toks_ptr[c] ); }
+      if ( max ) {
+        accessor_ptr->has_max = true;
+      } else {
+        accessor_ptr->has_min = true;
+      }
+    }
+  }
+}
 
-  // "scene"
-  if ( scene_ptr ) { gltf_ptr->default_scene_idx = scene_ptr->valueint; }
+static void _gltf_read_buffer( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_buffer_t* buffer_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "byteLength" ) ) {
+      buffer_ptr->byte_length = _gltf_int( js, &toks_ptr[k + 1] );
+    } else if ( _gltf_key_is( js, &toks_ptr[k], "uri" ) ) {
+      _gltf_string( js, &toks_ptr[k + 1], buffer_ptr->uri_str, GLTF_URI_MAX );
+    }
+  }
+}
 
-  // "accessors"
-  for ( int a = 0; a < gltf_ptr->n_accessors; a++ ) {
-    gltf_ptr->accessors_ptr[a].buffer_view_idx = -1;
-
-    cJSON* accessor_ptr = cJSON_GetArrayItem( accessors_ptr, a );
-
-    cJSON* buffer_view_ptr    = cJSON_GetObjectItem( accessor_ptr, "bufferView" );
-    cJSON* byte_offset_ptr    = cJSON_GetObjectItem( accessor_ptr, "byteOffset" );
-    cJSON* component_type_ptr = cJSON_GetObjectItem( accessor_ptr, "componentType" );
-    cJSON* count_ptr          = cJSON_GetObjectItem( accessor_ptr, "count" );
-    cJSON* type_ptr           = cJSON_GetObjectItem( accessor_ptr, "type" );
-    cJSON* name_ptr           = cJSON_GetObjectItem( accessor_ptr, "name" );
-    cJSON* max_ptr            = cJSON_GetObjectItem( accessor_ptr, "max" );
-    cJSON* min_ptr            = cJSON_GetObjectItem( accessor_ptr, "min" );
-    if ( buffer_view_ptr ) { gltf_ptr->accessors_ptr[a].buffer_view_idx = buffer_view_ptr->valueint; }
-    if ( byte_offset_ptr ) { gltf_ptr->accessors_ptr[a].byte_offset = byte_offset_ptr->valueint; }
-    if ( component_type_ptr ) { gltf_ptr->accessors_ptr[a].component_type = (gltf_component_type_t)component_type_ptr->valueint; }
-    if ( count_ptr ) { gltf_ptr->accessors_ptr[a].count = count_ptr->valueint; }
-    if ( max_ptr && cJSON_IsArray( max_ptr ) && ( 3 == cJSON_GetArraySize( max_ptr ) ) ) {
-      gltf_ptr->accessors_ptr[a].has_max = true;
-      gltf_ptr->accessors_ptr[a].max[0]  = (float)cJSON_GetArrayItem( max_ptr, 0 )->valuedouble;
-      gltf_ptr->accessors_ptr[a].max[1]  = (float)cJSON_GetArrayItem( max_ptr, 1 )->valuedouble;
-      gltf_ptr->accessors_ptr[a].max[2]  = (float)cJSON_GetArrayItem( max_ptr, 2 )->valuedouble;
+static void _gltf_read_buffer_view( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_buffer_view_t* bv_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    const _gltf_tok_t* key_ptr = &toks_ptr[k];
+    const _gltf_tok_t* val_ptr = &toks_ptr[k + 1];
+    if ( _gltf_key_is( js, key_ptr, "buffer" ) ) {
+      bv_ptr->buffer_idx = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "byteOffset" ) ) {
+      bv_ptr->byte_offset = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "byteLength" ) ) {
+      bv_ptr->byte_length = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "byteStride" ) ) {
+      bv_ptr->byte_stride = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "name" ) ) {
+      _gltf_string( js, val_ptr, bv_ptr->name_str, GLTF_NAME_MAX );
     }
-    if ( min_ptr && cJSON_IsArray( min_ptr ) && ( 3 == cJSON_GetArraySize( min_ptr ) ) ) {
-      gltf_ptr->accessors_ptr[a].has_min = true;
-      gltf_ptr->accessors_ptr[a].min[0]  = (float)cJSON_GetArrayItem( min_ptr, 0 )->valuedouble;
-      gltf_ptr->accessors_ptr[a].min[1]  = (float)cJSON_GetArrayItem( min_ptr, 1 )->valuedouble;
-      gltf_ptr->accessors_ptr[a].min[2]  = (float)cJSON_GetArrayItem( min_ptr, 2 )->valuedouble;
+  }
+}
+
+static void _gltf_read_image( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_image_t* image_ptr ) {
+  image_ptr->buffer_view_idx = -1;
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "bufferView" ) ) {
+      image_ptr->buffer_view_idx = _gltf_int( js, &toks_ptr[k + 1] );
+      continue;
     }
-    if ( name_ptr ) { strncat( gltf_ptr->accessors_ptr[a].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
-    if ( type_ptr ) {
-      if ( strncmp( type_ptr->valuestring, "SCALAR", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_SCALAR;
-      } else if ( strncmp( type_ptr->valuestring, "VEC2", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_VEC2;
-      } else if ( strncmp( type_ptr->valuestring, "VEC3", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_VEC3;
-      } else if ( strncmp( type_ptr->valuestring, "VEC4", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_VEC4;
-      } else if ( strncmp( type_ptr->valuestring, "MAT2", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_MAT2;
-      } else if ( strncmp( type_ptr->valuestring, "MAT3", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_MAT3;
-      } else if ( strncmp( type_ptr->valuestring, "MAT4", 10 ) == 0 ) {
-        gltf_ptr->accessors_ptr[a].type = GLTF_MAT4;
+    if ( !_gltf_key_is( js, &toks_ptr[k], "uri" ) || GLTF_TOK_STRING != toks_ptr[k + 1].type ) { continue; }
+    _gltf_string( js, &toks_ptr[k + 1], image_ptr->uri_str, GLTF_URI_MAX );
+    if ( strstr( image_ptr->uri_str, "%20" ) ) { memset( image_ptr->uri_str, 0, GLTF_URI_MAX ); } // skip URIs with escaped spaces
+    printf( "uri image: `%s`\n", image_ptr->uri_str );
+  }
+}
+
+static void _gltf_read_material( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_material_t* material_ptr ) {
+  material_ptr->normal_texture_idx                                    = -1;
+  material_ptr->occlusion_texture_idx                                 = -1;
+  material_ptr->emissive_texture_idx                                  = -1;
+  material_ptr->pbr_metallic_roughness.base_colour_texture_idx        = -1;
+  material_ptr->pbr_metallic_roughness.metallic_roughness_texture_idx = -1;
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    const _gltf_tok_t* key_ptr = &toks_ptr[k];
+    if ( _gltf_key_is( js, key_ptr, "name" ) ) {
+      _gltf_string( js, &toks_ptr[k + 1], material_ptr->name_str, GLTF_NAME_MAX );
+    } else if ( _gltf_key_is( js, key_ptr, "normalTexture" ) ) {
+      _gltf_read_texture_info( js, toks_ptr, k + 1, &material_ptr->normal_texture_idx );
+    } else if ( _gltf_key_is( js, key_ptr, "occlusionTexture" ) ) {
+      _gltf_read_texture_info( js, toks_ptr, k + 1, &material_ptr->occlusion_texture_idx );
+    } else if ( _gltf_key_is( js, key_ptr, "emissiveTexture" ) ) {
+      _gltf_read_texture_info( js, toks_ptr, k + 1, &material_ptr->emissive_texture_idx );
+    } else if ( _gltf_key_is( js, key_ptr, "alphaMode" ) ) {
+      material_ptr->alpha_blend = true;
+    } else if ( _gltf_key_is( js, key_ptr, "doubleSided" ) ) {
+      material_ptr->is_doubled_sided = true;
+    } else if ( _gltf_key_is( js, key_ptr, "pbrMetallicRoughness" ) && GLTF_TOK_OBJECT == toks_ptr[k + 1].type ) {
+      for ( int pe = 0, pk = k + 2; pe < toks_ptr[k + 1].size; pe++, pk = toks_ptr[pk + 1].next ) {
+        if ( _gltf_key_is( js, &toks_ptr[pk], "baseColorTexture" ) ) {
+          _gltf_read_texture_info( js, toks_ptr, pk + 1, &material_ptr->pbr_metallic_roughness.base_colour_texture_idx );
+        } else if ( _gltf_key_is( js, &toks_ptr[pk], "metallicRoughnessTexture" ) ) {
+          _gltf_read_texture_info( js, toks_ptr, pk + 1, &material_ptr->pbr_metallic_roughness.metallic_roughness_texture_idx );
+        }
       }
     }
-  } // endfor accessors
+  }
+}
 
-  // "buffers"
-  for ( int b = 0; b < gltf_ptr->n_buffers; b++ ) {
-    cJSON* b_ptr          = cJSON_GetArrayItem( buffers_ptr, b );
-    cJSON* byteLength_ptr = cJSON_GetObjectItem( b_ptr, "byteLength" );
-    cJSON* uri_ptr        = cJSON_GetObjectItem( b_ptr, "uri" );
-    if ( byteLength_ptr ) { gltf_ptr->buffers_ptr[b].byte_length = byteLength_ptr->valueint; }
-    if ( uri_ptr ) { strncat( gltf_ptr->buffers_ptr[b].uri_str, uri_ptr->valuestring, GLTF_URI_MAX - 1 ); }
-  } // endfor n_buffers
-
-  // "bufferViews"
-  for ( int bv = 0; bv < gltf_ptr->n_buffer_views; bv++ ) {
-    cJSON* bv_ptr = cJSON_GetArrayItem( buffer_views_ptr, bv );
-
-    cJSON* buffer_ptr     = cJSON_GetObjectItem( bv_ptr, "buffer" );
-    cJSON* byteOffset_ptr = cJSON_GetObjectItem( bv_ptr, "byteOffset" );
-    cJSON* byteLength_ptr = cJSON_GetObjectItem( bv_ptr, "byteLength" );
-    cJSON* byteStride_ptr = cJSON_GetObjectItem( bv_ptr, "byteStride" );
-    cJSON* name_ptr       = cJSON_GetObjectItem( bv_ptr, "name" );
-
-    if ( buffer_ptr ) { gltf_ptr->buffer_views_ptr[bv].buffer_idx = buffer_ptr->valueint; }
-    if ( byteOffset_ptr ) { gltf_ptr->buffer_views_ptr[bv].byte_offset = byteOffset_ptr->valueint; }
-    if ( byteLength_ptr ) { gltf_ptr->buffer_views_ptr[bv].byte_length = byteLength_ptr->valueint; }
-    if ( byteStride_ptr ) { gltf_ptr->buffer_views_ptr[bv].byte_stride = byteStride_ptr->valueint; }
-    if ( name_ptr ) { strncat( gltf_ptr->buffer_views_ptr[bv].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
-  } // endfor n_buffer_views
-
-  // "images"
-  for ( int i = 0; i < gltf_ptr->n_images; i++ ) {
-    cJSON* i_ptr   = cJSON_GetArrayItem( images_ptr, i );
-    cJSON* uri_ptr = cJSON_GetObjectItem( i_ptr, "uri" );
-
-    if ( uri_ptr ) {
-      int k = 0;
-      // if ( uri_ptr ) { strncat( gltf_ptr->images_ptr[i].uri_str, uri_ptr->valuestring, GLTF_URI_MAX - 1 ); }
-      // replace %20 with ' '
-      int len = strlen( uri_ptr->valuestring );
-      for ( int j = 0; j < len; j++ ) {
-        if ( uri_ptr->valuestring[j] == '%' && uri_ptr->valuestring[j + 1] == '2' && uri_ptr->valuestring[j + 2] == '0' ) {
-					gltf_ptr->images_ptr[i].uri_str[0] = '\0';
-					break;
-          // skip
-        } else {
-           gltf_ptr->images_ptr[i].uri_str[k++] = uri_ptr->valuestring[j];
+static void _gltf_read_primitive( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_primitive_t* primitive_ptr ) {
+  primitive_ptr->attributes.position_idx   = -1;
+  primitive_ptr->attributes.tangent_idx    = -1;
+  primitive_ptr->attributes.normal_idx     = -1;
+  primitive_ptr->attributes.texcoord_0_idx = -1;
+  primitive_ptr->material_idx              = -1;
+  primitive_ptr->indices_idx               = -1;
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    const _gltf_tok_t* key_ptr = &toks_ptr[k];
+    if ( _gltf_key_is( js, key_ptr, "material" ) ) {
+      primitive_ptr->material_idx = _gltf_int( js, &toks_ptr[k + 1] );
+    } else if ( _gltf_key_is( js, key_ptr, "indices" ) ) {
+      primitive_ptr->indices_idx = _gltf_int( js, &toks_ptr[k + 1] );
+    } else if ( _gltf_key_is( js, key_ptr, "attributes" ) && GLTF_TOK_OBJECT == toks_ptr[k + 1].type ) {
+      for ( int ae = 0, ak = k + 2; ae < toks_ptr[k + 1].size; ae++, ak = toks_ptr[ak + 1].next ) {
+        const _gltf_tok_t* attrib_ptr = &toks_ptr[ak];
+        if ( _gltf_key_is( js, attrib_ptr, "POSITION" ) ) {
+          primitive_ptr->attributes.position_idx = _gltf_int( js, &toks_ptr[ak + 1] );
+        } else if ( _gltf_key_is( js, attrib_ptr, "TANGENT" ) ) {
+          primitive_ptr->attributes.tangent_idx = _gltf_int( js, &toks_ptr[ak + 1] );
+        } else if ( _gltf_key_is( js, attrib_ptr, "NORMAL" ) ) {
+          primitive_ptr->attributes.normal_idx = _gltf_int( js, &toks_ptr[ak + 1] );
+        } else if ( _gltf_key_is( js, attrib_ptr, "TEXCOORD_0" ) ) {
+          primitive_ptr->attributes.texcoord_0_idx = _gltf_int( js, &toks_ptr[ak + 1] );
         }
       }
-			gltf_ptr->images_ptr[i].uri_str[k] = '\0';
-			printf("uri image: `%s`\n", gltf_ptr->images_ptr[i].uri_str );
     }
   }
+}
 
-  // "materials"
-  for ( int m = 0; m < gltf_ptr->n_materials; m++ ) {
-    cJSON* m_ptr                = cJSON_GetArrayItem( materials_ptr, m );
-    cJSON* name_ptr             = cJSON_GetObjectItem( m_ptr, "name" );
-    cJSON* normalTexture_ptr    = cJSON_GetObjectItem( m_ptr, "normalTexture" );
-    cJSON* occlusionTexture_ptr = cJSON_GetObjectItem( m_ptr, "occlusionTexture" );
-    cJSON* emissiveTexture_ptr  = cJSON_GetObjectItem( m_ptr, "emissiveTexture" );
-    cJSON* alphaMode_ptr        = cJSON_GetObjectItem( m_ptr, "alphaMode" );
-    cJSON* doubleSided_ptr      = cJSON_GetObjectItem( m_ptr, "doubleSided" );
-    cJSON* pbr_ptr              = cJSON_GetObjectItem( m_ptr, "pbrMetallicRoughness" );
-
-    gltf_ptr->materials_ptr[m].normal_texture_idx                                    = -1;
-    gltf_ptr->materials_ptr[m].occlusion_texture_idx                                 = -1;
-    gltf_ptr->materials_ptr[m].emissive_texture_idx                                  = -1;
-    gltf_ptr->materials_ptr[m].pbr_metallic_roughness.base_colour_texture_idx        = -1;
-    gltf_ptr->materials_ptr[m].pbr_metallic_roughness.metallic_roughness_texture_idx = -1;
-    if ( normalTexture_ptr && cJSON_HasObjectItem( normalTexture_ptr, "index" ) ) {
-      gltf_ptr->materials_ptr[m].normal_texture_idx = cJSON_GetObjectItem( normalTexture_ptr, "index" )->valueint;
+static void _gltf_read_mesh( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_mesh_t* mesh_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "name" ) ) {
+      _gltf_string( js, &toks_ptr[k + 1], mesh_ptr->name_str, GLTF_NAME_MAX );
+    } else if ( _gltf_key_is( js, &toks_ptr[k], "primitives" ) && !mesh_ptr->primitives_ptr ) {
+      mesh_ptr->primitives_ptr = _gltf_alloc_array( &toks_ptr[k + 1], sizeof( gltf_primitive_t ), &mesh_ptr->n_primitives );
+      for ( int p = 0, c = k + 2; p < mesh_ptr->n_primitives; p++, c = toks_ptr[c].next ) {
+        _gltf_read_primitive( js, toks_ptr, c, &mesh_ptr->primitives_ptr[p] );
+      }
     }
-    if ( occlusionTexture_ptr && cJSON_HasObjectItem( occlusionTexture_ptr, "index" ) ) {
-      gltf_ptr->materials_ptr[m].occlusion_texture_idx = cJSON_GetObjectItem( occlusionTexture_ptr, "index" )->valueint;
+  }
+}
+
+static void _gltf_read_node( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_node_t* node_ptr ) {
+  node_ptr->mesh_idx = -1;
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "mesh" ) ) {
+      node_ptr->mesh_idx = _gltf_int( js, &toks_ptr[k + 1] );
+    } else if ( _gltf_key_is( js, &toks_ptr[k], "name" ) ) {
+      _gltf_string( js, &toks_ptr[k + 1], node_ptr->name_str, GLTF_NAME_MAX );
     }
-    if ( emissiveTexture_ptr && cJSON_HasObjectItem( emissiveTexture_ptr, "index" ) ) {
-      gltf_ptr->materials_ptr[m].emissive_texture_idx = cJSON_GetObjectItem( emissiveTexture_ptr, "index" )->valueint;
+  }
+}
+
+static void _gltf_read_sampler( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_sampler_t* sampler_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "magFilter" ) ) {
+      sampler_ptr->mag_filter     = _gltf_int( js, &toks_ptr[k + 1] );
+      sampler_ptr->has_mag_filter = true;
+    } else if ( _gltf_key_is( js, &toks_ptr[k], "minFilter" ) ) {
+      sampler_ptr->min_filter     = _gltf_int( js, &toks_ptr[k + 1] );
+      sampler_ptr->has_min_filter = true;
     }
-    if ( alphaMode_ptr ) { gltf_ptr->materials_ptr[m].alpha_blend = true; }
-    if ( doubleSided_ptr ) { gltf_ptr->materials_ptr[m].is_doubled_sided = true; }
-    if ( name_ptr ) { strncat( gltf_ptr->materials_ptr[m].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
-    if ( pbr_ptr ) {
-      cJSON* baseColorTexture_ptr         = cJSON_GetObjectItem( pbr_ptr, "baseColorTexture" );
-      cJSON* metallicRoughnessTexture_ptr = cJSON_GetObjectItem( pbr_ptr, "metallicRoughnessTexture" );
-      if ( baseColorTexture_ptr && cJSON_HasObjectItem( baseColorTexture_ptr, "index" ) ) {
-        gltf_ptr->materials_ptr[m].pbr_metallic_roughness.base_colour_texture_idx = cJSON_GetObjectItem( baseColorTexture_ptr, "index" )->valueint;
-      }
-      if ( metallicRoughnessTexture_ptr && cJSON_HasObjectItem( metallicRoughnessTexture_ptr, "index" ) ) {
-        gltf_ptr->materials_ptr[m].pbr_metallic_roughness.metallic_roughness_texture_idx = cJSON_GetObjectItem( metallicRoughnessTexture_ptr, "index" )->valueint;
-        ;
-      }
+  }
+}
+
+static void _gltf_read_scene( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_scene_t* scene_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( !_gltf_key_is( js, &toks_ptr[k], "nodes" ) || scene_ptr->node_idxs_ptr ) { continue; }
+    scene_ptr->node_idxs_ptr = _gltf_alloc_array( &toks_ptr[k + 1], sizeof( int ), &scene_ptr->n_node_idxs );
+    for ( int n = 0, c = k + 2; n < scene_ptr->n_node_idxs; n++, c = toks_ptr[c].next ) { scene_ptr->node_idxs_ptr[n] = _gltf_int( js, &toks_ptr[c] ); }
+  }
+}
+
+static void _gltf_read_texture( const char* js, const _gltf_tok_t* toks_ptr, int idx, gltf_texture_t* texture_ptr ) {
+  if ( GLTF_TOK_OBJECT != toks_ptr[idx].type ) { return; }
+  for ( int e = 0, k = idx + 1; e < toks_ptr[idx].size; e++, k = toks_ptr[k + 1].next ) {
+    if ( _gltf_key_is( js, &toks_ptr[k], "sampler" ) ) {
+      texture_ptr->sampler_idx = _gltf_int( js, &toks_ptr[k + 1] );
+    } else if ( _gltf_key_is( js, &toks_ptr[k], "source" ) ) {
+      texture_ptr->source_idx = _gltf_int( js, &toks_ptr[k + 1] );
+    } else if ( _gltf_key_is( js, &toks_ptr[k], "name" ) ) {
+      _gltf_string( js, &toks_ptr[k + 1], texture_ptr->name_str, GLTF_NAME_MAX );
     }
   }
+}
 
-  // "meshes"
-  for ( int m = 0; m < gltf_ptr->n_meshes; m++ ) {
-    cJSON* mesh_ptr = cJSON_GetArrayItem( meshes_ptr, m );
+// Fills in gltf_ptr from len bytes of glTF JSON in one walk over its tokens. Only the first of any repeated top-level array is used.
+static bool _gltf_read_json( const char* js, int len, gltf_t* gltf_ptr ) {
+  int n_toks            = 0;
+  _gltf_tok_t* toks_ptr = _gltf_tokenise( js, len, &n_toks );
+  if ( !toks_ptr ) { return false; }
+  if ( GLTF_TOK_OBJECT != toks_ptr[0].type ) {
+    fprintf( stderr, "ERROR: gltf. JSON root is not an object\n" );
+    free( toks_ptr );
+    return false;
+  }
 
-    cJSON* name_ptr = cJSON_GetObjectItem( mesh_ptr, "name" );
-    if ( name_ptr ) { strncat( gltf_ptr->meshes_ptr[m].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+// each element of a top-level array, which is allocated and read the first time it's seen.
+#define GLTF_READ_ARRAY( array_ptr, n, read_fn )                                                                                                       \
+  if ( !gltf_ptr->array_ptr ) {                                                                                                                        \
+    gltf_ptr->array_ptr = _gltf_alloc_array( val_ptr, sizeof( *gltf_ptr->array_ptr ), &gltf_ptr->n );                                                 \
+    for ( int i = 0, c = k + 2; i < gltf_ptr->n; i++, c = toks_ptr[c].next ) { read_fn( js, toks_ptr, c, &gltf_ptr->array_ptr[i] ); }               \
+  }
 
-    cJSON* primitives_ptr = cJSON_GetObjectItem( mesh_ptr, "primitives" );
-    for ( int p = 0; p < gltf_ptr->meshes_ptr[m].n_primitives; p++ ) {
-      cJSON* primitive_ptr = cJSON_GetArrayItem( primitives_ptr, p );
-
-      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.position_idx   = -1;
-      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.tangent_idx    = -1;
-      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.normal_idx     = -1;
-      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.texcoord_0_idx = -1;
-      gltf_ptr->meshes_ptr[m].primitives_ptr[p].material_idx              = -1;
-      gltf_ptr->meshes_ptr[m].primitives_ptr[p].indices_idx               = -1;
-
-      cJSON* attributes_ptr = cJSON_GetObjectItem( primitive_ptr, "attributes" );
-      if ( attributes_ptr ) {
-        {
-          cJSON* attribute_ptr = cJSON_GetObjectItem( attributes_ptr, "POSITION" );
-          if ( attribute_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.position_idx = attribute_ptr->valueint; }
-        }
-        if ( cJSON_HasObjectItem( attributes_ptr, "TANGENT" ) ) {
-          gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.tangent_idx = cJSON_GetObjectItem( attributes_ptr, "TANGENT" )->valueint;
-        }
-        {
-          cJSON* attribute_ptr = cJSON_GetObjectItem( attributes_ptr, "NORMAL" );
-          if ( attribute_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.normal_idx = attribute_ptr->valueint; }
-        }
-        {
-          cJSON* attribute_ptr = cJSON_GetObjectItem( attributes_ptr, "TEXCOORD_0" );
-          if ( attribute_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.texcoord_0_idx = attribute_ptr->valueint; }
-        }
+  for ( int e = 0, k = 1; e < toks_ptr[0].size; e++, k = toks_ptr[k + 1].next ) {
+    const _gltf_tok_t* key_ptr = &toks_ptr[k];
+    const _gltf_tok_t* val_ptr = &toks_ptr[k + 1];
+    if ( _gltf_key_is( js, key_ptr, "asset" ) && GLTF_TOK_OBJECT == val_ptr->type ) {
+      for ( int ae = 0, ak = k + 2; ae < val_ptr->size; ae++, ak = toks_ptr[ak + 1].next ) {
+        if ( _gltf_key_is( js, &toks_ptr[ak], "version" ) ) { _gltf_string( js, &toks_ptr[ak + 1], gltf_ptr->version_str, 16 ); }
       }
-      cJSON* material_ptr = cJSON_GetObjectItem( primitive_ptr, "material" );
-      if ( material_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].material_idx = material_ptr->valueint; }
-      cJSON* indices_ptr = cJSON_GetObjectItem( primitive_ptr, "indices" );
-      if ( indices_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].indices_idx = indices_ptr->valueint; }
+    } else if ( _gltf_key_is( js, key_ptr, "scene" ) ) {
+      gltf_ptr->default_scene_idx = _gltf_int( js, val_ptr );
+    } else if ( _gltf_key_is( js, key_ptr, "accessors" ) ) {
+      GLTF_READ_ARRAY( accessors_ptr, n_accessors, _gltf_read_accessor )
+    } else if ( _gltf_key_is( js, key_ptr, "buffers" ) ) {
+      GLTF_READ_ARRAY( buffers_ptr, n_buffers, _gltf_read_buffer )
+    } else if ( _gltf_key_is( js, key_ptr, "bufferViews" ) ) {
+      GLTF_READ_ARRAY( buffer_views_ptr, n_buffer_views, _gltf_read_buffer_view )
+    } else if ( _gltf_key_is( js, key_ptr, "images" ) ) {
+      GLTF_READ_ARRAY( images_ptr, n_images, _gltf_read_image )
+    } else if ( _gltf_key_is( js, key_ptr, "materials" ) ) {
+      GLTF_READ_ARRAY( materials_ptr, n_materials, _gltf_read_material )
+    } else if ( _gltf_key_is( js, key_ptr, "meshes" ) ) {
+      GLTF_READ_ARRAY( meshes_ptr, n_meshes, _gltf_read_mesh )
+    } else if ( _gltf_key_is( js, key_ptr, "nodes" ) ) {
+      GLTF_READ_ARRAY( nodes_ptr, n_nodes, _gltf_read_node )
+    } else if ( _gltf_key_is( js, key_ptr, "samplers" ) ) {
+      GLTF_READ_ARRAY( samplers_ptr, n_samplers, _gltf_read_sampler )
+    } else if ( _gltf_key_is( js, key_ptr, "scenes" ) ) {
+      GLTF_READ_ARRAY( scenes_ptr, n_scenes, _gltf_read_scene )
+    } else if ( _gltf_key_is( js, key_ptr, "textures" ) ) {
+      GLTF_READ_ARRAY( textures_ptr, n_textures, _gltf_read_texture )
+    }
+  }
+#undef GLTF_READ_ARRAY
 
-    } // endfor n_primitives
-  }   // endfor n_meshes
+  free( toks_ptr );
+  return true;
+}
 
-  // "nodes"
-  for ( int n = 0; n < gltf_ptr->n_nodes; n++ ) {
-    gltf_ptr->nodes_ptr[n].mesh_idx = -1;
-    cJSON* node_ptr                 = cJSON_GetArrayItem( nodes_ptr, n );
-    cJSON* mesh_ptr                 = cJSON_GetObjectItem( node_ptr, "mesh" );
-    if ( mesh_ptr ) { gltf_ptr->nodes_ptr[n].mesh_idx = mesh_ptr->valueint; }
-    cJSON* name_ptr = cJSON_GetObjectItem( node_ptr, "name" );
-    if ( name_ptr ) { strncat( gltf_ptr->nodes_ptr[n].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
-  }
-
-  // samplers
-  for ( int s = 0; s < gltf_ptr->n_samplers; s++ ) {
-    cJSON* s_ptr         = cJSON_GetArrayItem( samplers_ptr, s );
-    cJSON* magFilter_ptr = cJSON_GetObjectItem( s_ptr, "magFilter" );
-    cJSON* minFilter_ptr = cJSON_GetObjectItem( s_ptr, "minFilter" );
-    if ( magFilter_ptr ) {
-      gltf_ptr->samplers_ptr[s].mag_filter     = samplers_ptr->valueint;
-      gltf_ptr->samplers_ptr[s].has_mag_filter = true;
-    }
-    if ( minFilter_ptr ) {
-      gltf_ptr->samplers_ptr[s].min_filter     = samplers_ptr->valueint;
-      gltf_ptr->samplers_ptr[s].has_min_filter = true;
+/* A .glb is a 12-byte header then chunks, each a length and a type then that many bytes. The first is the JSON, and the second, if there is
+one, the binary data of the buffer with no uri. Chunks are padded to 4 bytes, so the BIN chunk is aligned for any accessor in it. */
+static bool _gltf_read_glb( const uint8_t* glb_ptr, size_t sz, gltf_t* gltf_ptr ) {
+  if ( sz < 20 || 2 != _gltf_u32( &glb_ptr[4] ) || _gltf_u32( &glb_ptr[8] ) > sz ) {
+    fprintf( stderr, "ERROR: gltf. .glb header is not glTF 2.0 or is longer than the file\n" );
+    return false;
+  }
+  sz              = _gltf_u32( &glb_ptr[8] );
+  size_t json_len = _gltf_u32( &glb_ptr[12] );
+  if ( GLTF_GLB_CHUNK_JSON != _gltf_u32( &glb_ptr[16] ) || json_len > sz - 20 || json_len > INT_MAX ) {
+    fprintf( stderr, "ERROR: gltf. .glb has no valid JSON chunk\n" );
+    return false;
+  }
+  if ( !_gltf_read_json( (const char*)&glb_ptr[20], (int)json_len, gltf_ptr ) ) { return false; }
+
+  for ( size_t offset = 20 + ( ( json_len + 3 ) & ~(size_t)3 ); offset + 8 <= sz; ) {
+    size_t chunk_len = _gltf_u32( &glb_ptr[offset] );
+    if ( chunk_len > sz - offset - 8 ) { break; }
+    if ( GLTF_GLB_CHUNK_BIN == _gltf_u32( &glb_ptr[offset + 4] ) ) {
+      if ( gltf_ptr->n_buffers < 1 || '\0' != gltf_ptr->buffers_ptr[0].uri_str[0] || !gltf_set_buffer_data( gltf_ptr, 0, &glb_ptr[offset + 8], chunk_len ) ) {
+        fprintf( stderr, "ERROR: gltf. .glb BIN chunk does not match buffer 0\n" );
+        gltf_free( gltf_ptr );
+        return false;
+      }
+      break;
     }
+    offset += 8 + ( ( chunk_len + 3 ) & ~(size_t)3 );
   }
+  return true;
+}
 
-  // "scenes"
-  for ( int s = 0; s < gltf_ptr->n_scenes; s++ ) {
-    cJSON* scene_ptr      = cJSON_GetArrayItem( scenes_ptr, s );
-    cJSON* nodes_list_ptr = cJSON_GetObjectItem( scene_ptr, "nodes" );
-    for ( int n = 0; n < gltf_ptr->scenes_ptr[s].n_node_idxs; n++ ) {
-      gltf_ptr->scenes_ptr[s].node_idxs_ptr[n] = cJSON_GetArrayItem( nodes_list_ptr, n )->valueint;
-    }
+bool gltf_read( const char* filename, gltf_t* gltf_ptr ) {
+  size_t sz    = 0;
+  uint8_t* ptr = _gltf_map_file( filename, &sz );
+  if ( !ptr ) { return false; }
+
+  bool ret = false;
+  if ( sz >= 4 && GLTF_GLB_MAGIC == _gltf_u32( ptr ) ) {
+    ret = _gltf_read_glb( ptr, sz, gltf_ptr );
+  } else if ( sz > INT_MAX ) {
+    fprintf( stderr, "ERROR: gltf. file too large\n" );
+  } else {
+    ret = _gltf_read_json( (const char*)ptr, (int)sz, gltf_ptr );
   }
 
-  // "textures"
-  for ( int t = 0; t < gltf_ptr->n_textures; t++ ) {
-    cJSON* t_ptr       = cJSON_GetArrayItem( textures_ptr, t );
-    cJSON* sampler_ptr = cJSON_GetObjectItem( t_ptr, "sampler" );
-    cJSON* source_ptr  = cJSON_GetObjectItem( t_ptr, "source" );
-    cJSON* name_ptr    = cJSON_GetObjectItem( t_ptr, "name" );
-    if ( sampler_ptr ) { gltf_ptr->textures_ptr[t].sampler_idx = sampler_ptr->valueint; }
-    if ( source_ptr ) { gltf_ptr->textures_ptr[t].source_idx = source_ptr->valueint; }
-    if ( name_ptr ) { strncat( gltf_ptr->textures_ptr[t].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+  bool buffer_in_file = false;
+  for ( int i = 0; ret && i < gltf_ptr->n_buffers; i++ ) { buffer_in_file |= NULL != gltf_ptr->buffers_ptr[i].data_ptr; }
+  if ( buffer_in_file ) {
+    gltf_ptr->map_ptr = ptr;
+    gltf_ptr->map_sz  = sz;
+  } else {
+    _gltf_unmap_file( ptr, sz );
   }
+  return ret;
+}
 
-  cJSON_Delete( json_ptr );
-  free( record.data );
+bool gltf_set_buffer_data( gltf_t* gltf_ptr, int buffer_idx, const void* data_ptr, size_t sz ) {
+  if ( !gltf_ptr || buffer_idx < 0 || buffer_idx >= gltf_ptr->n_buffers ) { return false; }
+  gltf_buffer_t* buffer_ptr = &gltf_ptr->buffers_ptr[buffer_idx];
+  if ( data_ptr && ( buffer_ptr->byte_length < 0 || (size_t)buffer_ptr->byte_length > sz ) ) { return false; }
+  buffer_ptr->data_ptr = (const uint8_t*)data_ptr;
+  for ( int i = 0; i < gltf_ptr->n_buffer_views; i++ ) {
+    gltf_buffer_view_t* bv_ptr = &gltf_ptr->buffer_views_ptr[i];
+    if ( bv_ptr->buffer_idx != buffer_idx ) { continue; }
+    bool fits        = bv_ptr->byte_offset >= 0 && bv_ptr->byte_length >= 0 && (int64_t)bv_ptr->byte_offset + bv_ptr->byte_length <= buffer_ptr->byte_length;
+    bv_ptr->data_ptr = fits && data_ptr ? &buffer_ptr->data_ptr[bv_ptr->byte_offset] : NULL;
+  }
   return true;
 }
 
@@ -411,6 +672,7 @@ bool gltf_free( gltf_t* gltf_ptr ) {
     free( gltf_ptr->scenes_ptr );
   }
   if ( gltf_ptr->textures_ptr ) { free( gltf_ptr->textures_ptr ); }
+  if ( gltf_ptr->map_ptr ) { _gltf_unmap_file( gltf_ptr->map_ptr, gltf_ptr->map_sz ); }
 
   memset( gltf_ptr, 0, sizeof( gltf_t ) );
   return true;
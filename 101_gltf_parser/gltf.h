@@ -1,5 +1,7 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define GLTF_URI_MAX 1024
 #define GLTF_NAME_MAX 256
@@ -71,12 +73,14 @@ typedef struct gltf_buffer_view_t {
   int byte_length;
   int byte_stride; // NB: Usually this is just the size of eg the vec4 data type.
   char name_str[256];
+  const uint8_t* data_ptr; // First byte of the view once its buffer is in memory, or NULL. For a .glb this points straight into the mapped file.
 } gltf_buffer_view_t;
 
 // This struct represents an element of the top-level "buffers" array.
 typedef struct gltf_buffer_t {
   char uri_str[1024]; // e.g. "FlightHelmet.bin"
   int byte_length;    // e.g. 3227148
+  const uint8_t* data_ptr; // The buffer's bytes, from a .glb's BIN chunk or gltf_set_buffer_data(). NULL until then.
 } gltf_buffer_t;
 
 // This struct represents the "pbrMetallicRoughness" {} object within a material.
@@ -100,9 +104,10 @@ typedef struct gltf_material_t {
 } gltf_material_t;
 
 // This struct represents an element of the top-level "images" array.
-// URI to a JPG or PNG or a base64 encoded embedded image.
+// URI to a JPG or PNG or a base64 encoded embedded image, or a bufferView holding the file, as in most .glb files.
 typedef struct gltf_image_t {
   char uri_str[GLTF_URI_MAX]; // e.g. "Default_albedo.jpg"
+  int buffer_view_idx;        // -1 if the image is a URI.
 } gltf_image_t;
 
 // This struct represents an element of the top-level "textures" array.
@@ -150,9 +155,23 @@ typedef struct gltf_t {
 
   int default_scene_idx; // "scene"
   char version_str[16];  // "version"
+
+  // a .glb file stays mapped until gltf_free(), as its buffer views point into it.
+  void* map_ptr;
+  size_t map_sz;
 } gltf_t;
 
+/* Reads a .gltf, or a .glb with its JSON and BIN chunks. A .glb is memory-mapped rather than read, and parsed in place. Its buffer with no
+uri is the BIN chunk, and the data_ptr of that buffer and of its buffer views point into the mapping, so accessor data can be used without
+copying it out. Buffers in external files are left for the caller to load and pass to gltf_set_buffer_data().
+RETURNS false on any error. */
 bool gltf_read( const char* filename, gltf_t* gltf_ptr );
+
+/* Points buffer buffer_idx, and every buffer view of it that fits inside its byteLength, at data_ptr, which must stay valid while they're used.
+A NULL data_ptr clears them again.
+RETURNS false if buffer_idx is invalid or the buffer's byteLength is more than sz. */
+bool gltf_set_buffer_data( gltf_t* gltf_ptr, int buffer_idx, const void* data_ptr, size_t sz );
+
 bool gltf_free( gltf_t* gltf_ptr );
 void gltf_print( const gltf_t* gltf_ptr );
 int gltf_bytes_for_component(  gltf_component_type_t comp_type );
@@ -0,0 +1,511 @@
+/* Benchmark for gltf_read(): the single-pass tokeniser against the cJSON loader it replaced, kept below as cjson_gltf_read(), on
+generated scenes with 2500 to 160000 (or [max]) nodes and accessors. Both must fill in the same gltf_t.
+Anton Gerdelan, antongerdelan.net
+
+Build:
+  gcc -O2 gltf_bench.c gltf.c cJSON/cJSON.c -lm -o gltf_bench
+Run:
+  ./gltf_bench [max]
+
+Writes gltf_bench.gltf for each size. The cJSON loader is skipped at sizes after it takes more than 2 seconds.
+*/
+#include "gltf.h"
+#include "cJSON/cJSON.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FILE "gltf_bench.gltf"
+
+static double _time_s( void ) {
+  struct timespec ts;
+  timespec_get( &ts, TIME_UTC );
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* n nodes and accessors, n / 4 meshes and bufferViews, each mesh with 4 primitives, a few materials and textures, and one scene. */
+static bool _write_scene( const char* filename, int n ) {
+  FILE* fp = fopen( filename, "w" );
+  if ( !fp ) { return false; }
+  int n_meshes = n / 4 > 0 ? n / 4 : 1;
+  fprintf( fp, "{\n  \"asset\" : { \"generator\" : \"gltf_bench\", \"version\" : \"2.0\" },\n  \"scene\" : 0,\n" );
+  fprintf( fp, "  \"scenes\" : [ { \"name\" : \"Scene\", \"nodes\" : [" );
+  for ( int i = 0; i < n; i++ ) { fprintf( fp, "%s%i", i ? ", " : " ", i ); }
+  fprintf( fp, " ] } ],\n  \"nodes\" : [\n" );
+  for ( int i = 0; i < n; i++ ) {
+    fprintf( fp, "    { \"mesh\" : %i, \"name\" : \"node_%i\", \"translation\" : [ %g, 0.0, %g ], \"rotation\" : [ 0.0, 0.7071068, 0.0, 0.7071068 ] }%s\n",
+      i % n_meshes, i, ( i % 100 ) * 2.5, ( i / 100 ) * -2.5, i < n - 1 ? "," : "" );
+  }
+  fprintf( fp, "  ],\n  \"meshes\" : [\n" );
+  for ( int i = 0; i < n_meshes; i++ ) {
+    fprintf( fp, "    { \"name\" : \"mesh_%i\", \"primitives\" : [", i );
+    for ( int p = 0; p < 4; p++ ) {
+      int a = ( i * 4 + p ) % n;
+      fprintf( fp, "%s{ \"attributes\" : { \"POSITION\" : %i, \"NORMAL\" : %i, \"TEXCOORD_0\" : %i }, \"indices\" : %i, \"material\" : %i }", p ? ", " : " ", a,
+        ( a + 1 ) % n, ( a + 2 ) % n, ( a + 3 ) % n, i % 8 );
+    }
+    fprintf( fp, " ] }%s\n", i < n_meshes - 1 ? "," : "" );
+  }
+  fprintf( fp, "  ],\n  \"accessors\" : [\n" );
+  for ( int i = 0; i < n; i++ ) {
+    fprintf( fp,
+      "    {\n      \"bufferView\" : %i,\n      \"byteOffset\" : %i,\n      \"componentType\" : %i,\n      \"count\" : %i,\n      \"max\" : [ %g, %g, %g ],\n"
+      "      \"min\" : [ %g, %g, %g ],\n      \"type\" : \"%s\"\n    }%s\n",
+      i / 4, ( i % 4 ) * 1200, i % 4 == 3 ? 5123 : 5126, 100, 1.0 + i * 0.001, 1.5, 0.25, -1.0, -0.5, -0.125 * i, i % 4 == 3 ? "SCALAR" : "VEC3",
+      i < n - 1 ? "," : "" );
+  }
+  fprintf( fp, "  ],\n  \"bufferViews\" : [\n" );
+  for ( int i = 0; i < n_meshes; i++ ) {
+    fprintf( fp, "    { \"buffer\" : 0, \"byteLength\" : 4800, \"byteOffset\" : %i, \"name\" : \"view_%i\" }%s\n", i * 4800, i, i < n_meshes - 1 ? "," : "" );
+  }
+  fprintf( fp, "  ],\n  \"buffers\" : [ { \"byteLength\" : %i, \"uri\" : \"gltf_bench.bin\" } ],\n  \"materials\" : [\n", n_meshes * 4800 );
+  for ( int i = 0; i < 8; i++ ) {
+    fprintf( fp,
+      "    { \"name\" : \"material_%i\", \"doubleSided\" : true, \"normalTexture\" : { \"index\" : 0 }, \"pbrMetallicRoughness\" : { \"baseColorTexture\" : "
+      "{ \"index\" : 1 }, \"metallicFactor\" : 0.0 } }%s\n",
+      i, i < 7 ? "," : "" );
+  }
+  fprintf( fp, "  ],\n  \"textures\" : [ { \"sampler\" : 0, \"source\" : 0 }, { \"sampler\" : 0, \"source\" : 1, \"name\" : \"base\" } ],\n" );
+  fprintf( fp, "  \"samplers\" : [ { \"wrapS\" : 10497, \"wrapT\" : 10497 } ]\n}\n" );
+  return 0 == fclose( fp );
+}
+
+/* RETURNS true if both loaders gave the same structs. They were calloc()'d, so any padding is zero in both. */
+static bool _same( const gltf_t* a_ptr, const gltf_t* b_ptr ) {
+#define SAME_ARRAY( array_ptr, n ) \
+  ( a_ptr->n == b_ptr->n && ( 0 == a_ptr->n || 0 == memcmp( a_ptr->array_ptr, b_ptr->array_ptr, sizeof( *a_ptr->array_ptr ) * a_ptr->n ) ) )
+  if ( a_ptr->default_scene_idx != b_ptr->default_scene_idx || 0 != strcmp( a_ptr->version_str, b_ptr->version_str ) ) { return false; }
+  if ( !SAME_ARRAY( accessors_ptr, n_accessors ) || !SAME_ARRAY( buffers_ptr, n_buffers ) || !SAME_ARRAY( buffer_views_ptr, n_buffer_views ) ) { return false; }
+  if ( !SAME_ARRAY( images_ptr, n_images ) || !SAME_ARRAY( materials_ptr, n_materials ) || !SAME_ARRAY( nodes_ptr, n_nodes ) ) { return false; }
+  if ( !SAME_ARRAY( samplers_ptr, n_samplers ) || !SAME_ARRAY( textures_ptr, n_textures ) ) { return false; }
+  if ( a_ptr->n_meshes != b_ptr->n_meshes || a_ptr->n_scenes != b_ptr->n_scenes ) { return false; }
+  for ( int i = 0; i < a_ptr->n_meshes; i++ ) {
+    if ( 0 != strcmp( a_ptr->meshes_ptr[i].name_str, b_ptr->meshes_ptr[i].name_str ) ) { return false; }
+    if ( !SAME_ARRAY( meshes_ptr[i].primitives_ptr, meshes_ptr[i].n_primitives ) ) { return false; }
+  }
+  for ( int i = 0; i < a_ptr->n_scenes; i++ ) {
+    if ( !SAME_ARRAY( scenes_ptr[i].node_idxs_ptr, scenes_ptr[i].n_node_idxs ) ) { return false; }
+  }
+#undef SAME_ARRAY
+  return true;
+}
+
+// the cJSON loader, as it was before the tokeniser
+typedef struct _entire_file_t {
+  void* data;
+  size_t sz;
+} _entire_file_t;
+
+static bool read_entire_file( const char* filename, _entire_file_t* record ) {
+  FILE* fp = fopen( filename, "rb" );
+  if ( !fp ) { return false; }
+  fseek( fp, 0L, SEEK_END );
+  record->sz   = (size_t)ftell( fp );
+  record->data = malloc( record->sz );
+  if ( !record->data ) {
+    fclose( fp );
+    return false;
+  }
+  rewind( fp );
+  size_t nr = fread( record->data, record->sz, 1, fp );
+  fclose( fp );
+  if ( 1 != nr ) {
+    free( record->data );
+    return false;
+  }
+  return true;
+}
+
+static bool cjson_gltf_read( const char* filename, gltf_t* gltf_ptr ) {
+  _entire_file_t record = { 0 };
+  bool ret              = read_entire_file( filename, &record );
+  if ( !ret ) { return false; }
+
+  char* json_char_ptr = (char*)record.data;
+
+  cJSON* json_ptr = cJSON_ParseWithLength( json_char_ptr, record.sz );
+  if ( !json_ptr ) {
+    fprintf( stderr, "ERROR: gltf. cJSON_ParseWithLength\n" );
+    free( record.data );
+    return false;
+  }
+
+  // "asset"
+  cJSON* asset_ptr = cJSON_GetObjectItem( json_ptr, "asset" );
+  if ( asset_ptr ) {
+    cJSON* version_ptr = cJSON_GetObjectItem( asset_ptr, "version" );
+    if ( version_ptr ) { strncat( gltf_ptr->version_str, version_ptr->valuestring, 15 ); }
+  }
+
+  // get top-level objects
+  cJSON* scene_ptr = cJSON_GetObjectItem( json_ptr, "scene" );
+  // and arrays
+  cJSON* accessors_ptr    = cJSON_GetObjectItem( json_ptr, "accessors" );
+  cJSON* buffers_ptr      = cJSON_GetObjectItem( json_ptr, "buffers" );
+  cJSON* buffer_views_ptr = cJSON_GetObjectItem( json_ptr, "bufferViews" );
+  cJSON* images_ptr       = cJSON_GetObjectItem( json_ptr, "images" );
+  cJSON* materials_ptr    = cJSON_GetObjectItem( json_ptr, "materials" );
+  cJSON* meshes_ptr       = cJSON_GetObjectItem( json_ptr, "meshes" );
+  cJSON* nodes_ptr        = cJSON_GetObjectItem( json_ptr, "nodes" );
+  cJSON* samplers_ptr     = cJSON_GetObjectItem( json_ptr, "samplers" );
+  cJSON* scenes_ptr       = cJSON_GetObjectItem( json_ptr, "scenes" );
+  cJSON* textures_ptr     = cJSON_GetObjectItem( json_ptr, "textures" );
+
+  //
+  // count top-level array elements
+  //
+  if ( accessors_ptr && cJSON_IsArray( accessors_ptr ) ) { gltf_ptr->n_accessors = cJSON_GetArraySize( accessors_ptr ); }
+  if ( buffers_ptr && cJSON_IsArray( buffers_ptr ) ) { gltf_ptr->n_buffers = cJSON_GetArraySize( buffers_ptr ); }
+  if ( buffer_views_ptr && cJSON_IsArray( buffer_views_ptr ) ) { gltf_ptr->n_buffer_views = cJSON_GetArraySize( buffer_views_ptr ); }
+  if ( images_ptr && cJSON_IsArray( images_ptr ) ) { gltf_ptr->n_images = cJSON_GetArraySize( images_ptr ); }
+  if ( materials_ptr && cJSON_IsArray( materials_ptr ) ) { gltf_ptr->n_materials = cJSON_GetArraySize( materials_ptr ); }
+  if ( meshes_ptr && cJSON_IsArray( meshes_ptr ) ) { gltf_ptr->n_meshes = cJSON_GetArraySize( meshes_ptr ); }
+  if ( nodes_ptr && cJSON_IsArray( nodes_ptr ) ) { gltf_ptr->n_nodes = cJSON_GetArraySize( nodes_ptr ); }
+  if ( samplers_ptr && cJSON_IsArray( samplers_ptr ) ) { gltf_ptr->n_samplers = cJSON_GetArraySize( samplers_ptr ); }
+  if ( scenes_ptr && cJSON_IsArray( scenes_ptr ) ) { gltf_ptr->n_scenes = cJSON_GetArraySize( scenes_ptr ); }
+  if ( textures_ptr && cJSON_IsArray( textures_ptr ) ) { gltf_ptr->n_textures = cJSON_GetArraySize( textures_ptr ); }
+
+  //
+  // alloc structs
+  //
+  if ( gltf_ptr->n_accessors > 0 ) {
+    gltf_ptr->accessors_ptr = calloc( sizeof( gltf_accessor_t ), gltf_ptr->n_accessors );
+    assert( gltf_ptr->accessors_ptr );
+  }
+  if ( gltf_ptr->n_buffers > 0 ) {
+    gltf_ptr->buffers_ptr = calloc( sizeof( gltf_buffer_t ), gltf_ptr->n_buffers );
+    assert( gltf_ptr->buffers_ptr );
+  }
+  if ( gltf_ptr->n_buffer_views > 0 ) {
+    gltf_ptr->buffer_views_ptr = calloc( sizeof( gltf_buffer_view_t ), gltf_ptr->n_buffer_views );
+    assert( gltf_ptr->buffer_views_ptr );
+  }
+  if ( gltf_ptr->n_images > 0 ) {
+    gltf_ptr->images_ptr = calloc( sizeof( gltf_image_t ), gltf_ptr->n_images );
+    assert( gltf_ptr->images_ptr );
+  }
+  if ( gltf_ptr->n_materials > 0 ) {
+    gltf_ptr->materials_ptr = calloc( sizeof( gltf_material_t ), gltf_ptr->n_materials );
+    assert( gltf_ptr->materials_ptr );
+  }
+  if ( gltf_ptr->n_meshes > 0 ) {
+    gltf_ptr->meshes_ptr = calloc( sizeof( gltf_mesh_t ), gltf_ptr->n_meshes );
+    assert( gltf_ptr->meshes_ptr );
+    for ( int m = 0; m < gltf_ptr->n_meshes; m++ ) {
+      cJSON* mesh_ptr       = cJSON_GetArrayItem( meshes_ptr, m );
+      cJSON* primitives_ptr = cJSON_GetObjectItem( mesh_ptr, "primitives" );
+      if ( primitives_ptr && cJSON_IsArray( primitives_ptr ) ) {
+        gltf_ptr->meshes_ptr[m].n_primitives   = cJSON_GetArraySize( primitives_ptr );
+        gltf_ptr->meshes_ptr[m].primitives_ptr = calloc( sizeof( gltf_primitive_t ), gltf_ptr->meshes_ptr[m].n_primitives );
+        assert( gltf_ptr->meshes_ptr[m].primitives_ptr );
+      }
+    }
+  }
+  if ( gltf_ptr->n_nodes > 0 ) {
+    gltf_ptr->nodes_ptr = calloc( sizeof( gltf_node_t ), gltf_ptr->n_nodes );
+    assert( gltf_ptr->nodes_ptr );
+  }
+  if ( gltf_ptr->n_samplers > 0 ) {
+    gltf_ptr->samplers_ptr = calloc( sizeof( gltf_sampler_t ), gltf_ptr->n_samplers );
+    assert( gltf_ptr->samplers_ptr );
+  }
+  if ( gltf_ptr->n_scenes > 0 ) {
+    gltf_ptr->scenes_ptr = calloc( sizeof( gltf_scene_t ), gltf_ptr->n_scenes );
+    assert( gltf_ptr->scenes_ptr );
+
+    for ( int s = 0; s < gltf_ptr->n_scenes; s++ ) {
+      cJSON* scene_ptr      = cJSON_GetArrayItem( scenes_ptr, s );
+      cJSON* nodes_list_ptr = cJSON_GetObjectItem( scene_ptr, "nodes" );
+      if ( nodes_list_ptr && cJSON_IsArray( nodes_list_ptr ) ) {
+        gltf_ptr->scenes_ptr[s].n_node_idxs = cJSON_GetArraySize( nodes_list_ptr );
+        if ( gltf_ptr->scenes_ptr[s].n_node_idxs > 0 ) {
+          gltf_ptr->scenes_ptr[s].node_idxs_ptr = calloc( sizeof( int ), gltf_ptr->scenes_ptr[s].n_node_idxs );
+          assert( gltf_ptr->scenes_ptr[s].node_idxs_ptr );
+        }
+      }
+    }
+  }
+  if ( gltf_ptr->n_textures > 0 ) {
+    gltf_ptr->textures_ptr = calloc( sizeof( gltf_texture_t ), gltf_ptr->n_textures );
+    assert( gltf_ptr->textures_ptr );
+  }
+
+  //
+  // parse into structs
+  //
+
+  // "scene"
+  if ( scene_ptr ) { gltf_ptr->default_scene_idx = scene_ptr->valueint; }
+
+  // "accessors"
+  for ( int a = 0; a < gltf_ptr->n_accessors; a++ ) {
+    gltf_ptr->accessors_ptr[a].buffer_view_idx = -1;
+
+    cJSON* accessor_ptr = cJSON_GetArrayItem( accessors_ptr, a );
+
+    cJSON* buffer_view_ptr    = cJSON_GetObjectItem( accessor_ptr, "bufferView" );
+    cJSON* byte_offset_ptr    = cJSON_GetObjectItem( accessor_ptr, "byteOffset" );
+    cJSON* component_type_ptr = cJSON_GetObjectItem( accessor_ptr, "componentType" );
+    cJSON* count_ptr          = cJSON_GetObjectItem( accessor_ptr, "count" );
+    cJSON* type_ptr           = cJSON_GetObjectItem( accessor_ptr, "type" );
+    cJSON* name_ptr           = cJSON_GetObjectItem( accessor_ptr, "name" );
+    cJSON* max_ptr            = cJSON_GetObjectItem( accessor_ptr, "max" );
+    cJSON* min_ptr            = cJSON_GetObjectItem( accessor_ptr, "min" );
+    if ( buffer_view_ptr ) { gltf_ptr->accessors_ptr[a].buffer_view_idx = buffer_view_ptr->valueint; }
+    if ( byte_offset_ptr ) { gltf_ptr->accessors_ptr[a].byte_offset = byte_offset_ptr->valueint; }
+    if ( component_type_ptr ) { gltf_ptr->accessors_ptr[a].component_type = (gltf_component_type_t)component_type_ptr->valueint; }
+    if ( count_ptr ) { gltf_ptr->accessors_ptr[a].count = count_ptr->valueint; }
+    if ( max_ptr && cJSON_IsArray( max_ptr ) && ( 3 == cJSON_GetArraySize( max_ptr ) ) ) {
+      gltf_ptr->accessors_ptr[a].has_max = true;
+      gltf_ptr->accessors_ptr[a].max[0]  = (float)cJSON_GetArrayItem( max_ptr, 0 )->valuedouble;
+      gltf_ptr->accessors_ptr[a].max[1]  = (float)cJSON_GetArrayItem( max_ptr, 1 )->valuedouble;
+      gltf_ptr->accessors_ptr[a].max[2]  = (float)cJSON_GetArrayItem( max_ptr, 2 )->valuedouble;
+    }
+    if ( min_ptr && cJSON_IsArray( min_ptr ) && ( 3 == cJSON_GetArraySize( min_ptr ) ) ) {
+      gltf_ptr->accessors_ptr[a].has_min = true;
+      gltf_ptr->accessors_ptr[a].min[0]  = (float)cJSON_GetArrayItem( min_ptr, 0 )->valuedouble;
+      gltf_ptr->accessors_ptr[a].min[1]  = (float)cJSON_GetArrayItem( min_ptr, 1 )->valuedouble;
+      gltf_ptr->accessors_ptr[a].min[2]  = (float)cJSON_GetArrayItem( min_ptr, 2 )->valuedouble;
+    }
+    if ( name_ptr ) { strncat( gltf_ptr->accessors_ptr[a].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+    if ( type_ptr ) {
+      if ( strncmp( type_ptr->valuestring, "SCALAR", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_SCALAR;
+      } else if ( strncmp( type_ptr->valuestring, "VEC2", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_VEC2;
+      } else if ( strncmp( type_ptr->valuestring, "VEC3", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_VEC3;
+      } else if ( strncmp( type_ptr->valuestring, "VEC4", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_VEC4;
+      } else if ( strncmp( type_ptr->valuestring, "MAT2", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_MAT2;
+      } else if ( strncmp( type_ptr->valuestring, "MAT3", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_MAT3;
+      } else if ( strncmp( type_ptr->valuestring, "MAT4", 10 ) == 0 ) {
+        gltf_ptr->accessors_ptr[a].type = GLTF_MAT4;
+      }
+    }
+  } // endfor accessors
+
+  // "buffers"
+  for ( int b = 0; b < gltf_ptr->n_buffers; b++ ) {
+    cJSON* b_ptr          = cJSON_GetArrayItem( buffers_ptr, b );
+    cJSON* byteLength_ptr = cJSON_GetObjectItem( b_ptr, "byteLength" );
+    cJSON* uri_ptr        = cJSON_GetObjectItem( b_ptr, "uri" );
+    if ( byteLength_ptr ) { gltf_ptr->buffers_ptr[b].byte_length = byteLength_ptr->valueint; }
+    if ( uri_ptr ) { strncat( gltf_ptr->buffers_ptr[b].uri_str, uri_ptr->valuestring, GLTF_URI_MAX - 1 ); }
+  } // endfor n_buffers
+
+  // "bufferViews"
+  for ( int bv = 0; bv < gltf_ptr->n_buffer_views; bv++ ) {
+    cJSON* bv_ptr = cJSON_GetArrayItem( buffer_views_ptr, bv );
+
+    cJSON* buffer_ptr     = cJSON_GetObjectItem( bv_ptr, "buffer" );
+    cJSON* byteOffset_ptr = cJSON_GetObjectItem( bv_ptr, "byteOffset" );
+    cJSON* byteLength_ptr = cJSON_GetObjectItem( bv_ptr, "byteLength" );
+    cJSON* byteStride_ptr = cJSON_GetObjectItem( bv_ptr, "byteStride" );
+    cJSON* name_ptr       = cJSON_GetObjectItem( bv_ptr, "name" );
+
+    if ( buffer_ptr ) { gltf_ptr->buffer_views_ptr[bv].buffer_idx = buffer_ptr->valueint; }
+    if ( byteOffset_ptr ) { gltf_ptr->buffer_views_ptr[bv].byte_offset = byteOffset_ptr->valueint; }
+    if ( byteLength_ptr ) { gltf_ptr->buffer_views_ptr[bv].byte_length = byteLength_ptr->valueint; }
+    if ( byteStride_ptr ) { gltf_ptr->buffer_views_ptr[bv].byte_stride = byteStride_ptr->valueint; }
+    if ( name_ptr ) { strncat( gltf_ptr->buffer_views_ptr[bv].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+  } // endfor n_buffer_views
+
+  // "images"
+  for ( int i = 0; i < gltf_ptr->n_images; i++ ) {
+    cJSON* i_ptr   = cJSON_GetArrayItem( images_ptr, i );
+    cJSON* uri_ptr = cJSON_GetObjectItem( i_ptr, "uri" );
+
+    if ( uri_ptr ) {
+      int k = 0;
+      // if ( uri_ptr ) { strncat( gltf_ptr->images_ptr[i].uri_str, uri_ptr->valuestring, GLTF_URI_MAX - 1 ); }
+      // replace %20 with ' '
+      int len = strlen( uri_ptr->valuestring );
+      for ( int j = 0; j < len; j++ ) {
+        if ( uri_ptr->valuestring[j] == '%' && uri_ptr->valuestring[j + 1] == '2' && uri_ptr->valuestring[j + 2] == '0' ) {
+          gltf_ptr->images_ptr[i].uri_str[0] = '\0';
+          break;
+          // skip
+        } else {
+           gltf_ptr->images_ptr[i].uri_str[k++] = uri_ptr->valuestring[j];
+        }
+      }
+      gltf_ptr->images_ptr[i].uri_str[k] = '\0';
+      printf("uri image: `%s`\n", gltf_ptr->images_ptr[i].uri_str );
+    }
+  }
+
+  // "materials"
+  for ( int m = 0; m < gltf_ptr->n_materials; m++ ) {
+    cJSON* m_ptr                = cJSON_GetArrayItem( materials_ptr, m );
+    cJSON* name_ptr             = cJSON_GetObjectItem( m_ptr, "name" );
+    cJSON* normalTexture_ptr    = cJSON_GetObjectItem( m_ptr, "normalTexture" );
+    cJSON* occlusionTexture_ptr = cJSON_GetObjectItem( m_ptr, "occlusionTexture" );
+    cJSON* emissiveTexture_ptr  = cJSON_GetObjectItem( m_ptr, "emissiveTexture" );
+    cJSON* alphaMode_ptr        = cJSON_GetObjectItem( m_ptr, "alphaMode" );
+    cJSON* doubleSided_ptr      = cJSON_GetObjectItem( m_ptr, "doubleSided" );
+    cJSON* pbr_ptr              = cJSON_GetObjectItem( m_ptr, "pbrMetallicRoughness" );
+
+    gltf_ptr->materials_ptr[m].normal_texture_idx                                    = -1;
+    gltf_ptr->materials_ptr[m].occlusion_texture_idx                                 = -1;
+    gltf_ptr->materials_ptr[m].emissive_texture_idx                                  = -1;
+    gltf_ptr->materials_ptr[m].pbr_metallic_roughness.base_colour_texture_idx        = -1;
+    gltf_ptr->materials_ptr[m].pbr_metallic_roughness.metallic_roughness_texture_idx = -1;
+    if ( normalTexture_ptr && cJSON_HasObjectItem( normalTexture_ptr, "index" ) ) {
+      gltf_ptr->materials_ptr[m].normal_texture_idx = cJSON_GetObjectItem( normalTexture_ptr, "index" )->valueint;
+    }
+    if ( occlusionTexture_ptr && cJSON_HasObjectItem( occlusionTexture_ptr, "index" ) ) {
+      gltf_ptr->materials_ptr[m].occlusion_texture_idx = cJSON_GetObjectItem( occlusionTexture_ptr, "index" )->valueint;
+    }
+    if ( emissiveTexture_ptr && cJSON_HasObjectItem( emissiveTexture_ptr, "index" ) ) {
+      gltf_ptr->materials_ptr[m].emissive_texture_idx = cJSON_GetObjectItem( emissiveTexture_ptr, "index" )->valueint;
+    }
+    if ( alphaMode_ptr ) { gltf_ptr->materials_ptr[m].alpha_blend = true; }
+    if ( doubleSided_ptr ) { gltf_ptr->materials_ptr[m].is_doubled_sided = true; }
+    if ( name_ptr ) { strncat( gltf_ptr->materials_ptr[m].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+    if ( pbr_ptr ) {
+      cJSON* baseColorTexture_ptr         = cJSON_GetObjectItem( pbr_ptr, "baseColorTexture" );
+      cJSON* metallicRoughnessTexture_ptr = cJSON_GetObjectItem( pbr_ptr, "metallicRoughnessTexture" );
+      if ( baseColorTexture_ptr && cJSON_HasObjectItem( baseColorTexture_ptr, "index" ) ) {
+        gltf_ptr->materials_ptr[m].pbr_metallic_roughness.base_colour_texture_idx = cJSON_GetObjectItem( baseColorTexture_ptr, "index" )->valueint;
+      }
+      if ( metallicRoughnessTexture_ptr && cJSON_HasObjectItem( metallicRoughnessTexture_ptr, "index" ) ) {
+        gltf_ptr->materials_ptr[m].pbr_metallic_roughness.metallic_roughness_texture_idx = cJSON_GetObjectItem( metallicRoughnessTexture_ptr, "index" )->valueint;
+        ;
+      }
+    }
+  }
+
+  // "meshes"
+  for ( int m = 0; m < gltf_ptr->n_meshes; m++ ) {
+    cJSON* mesh_ptr = cJSON_GetArrayItem( meshes_ptr, m );
+
+    cJSON* name_ptr = cJSON_GetObjectItem( mesh_ptr, "name" );
+    if ( name_ptr ) { strncat( gltf_ptr->meshes_ptr[m].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+
+    cJSON* primitives_ptr = cJSON_GetObjectItem( mesh_ptr, "primitives" );
+    for ( int p = 0; p < gltf_ptr->meshes_ptr[m].n_primitives; p++ ) {
+      cJSON* primitive_ptr = cJSON_GetArrayItem( primitives_ptr, p );
+
+      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.position_idx   = -1;
+      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.tangent_idx    = -1;
+      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.normal_idx     = -1;
+      gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.texcoord_0_idx = -1;
+      gltf_ptr->meshes_ptr[m].primitives_ptr[p].material_idx              = -1;
+      gltf_ptr->meshes_ptr[m].primitives_ptr[p].indices_idx               = -1;
+
+      cJSON* attributes_ptr = cJSON_GetObjectItem( primitive_ptr, "attributes" );
+      if ( attributes_ptr ) {
+        {
+          cJSON* attribute_ptr = cJSON_GetObjectItem( attributes_ptr, "POSITION" );
+          if ( attribute_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.position_idx = attribute_ptr->valueint; }
+        }
+        if ( cJSON_HasObjectItem( attributes_ptr, "TANGENT" ) ) {
+          gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.tangent_idx = cJSON_GetObjectItem( attributes_ptr, "TANGENT" )->valueint;
+        }
+        {
+          cJSON* attribute_ptr = cJSON_GetObjectItem( attributes_ptr, "NORMAL" );
+          if ( attribute_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.normal_idx = attribute_ptr->valueint; }
+        }
+        {
+          cJSON* attribute_ptr = cJSON_GetObjectItem( attributes_ptr, "TEXCOORD_0" );
+          if ( attribute_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].attributes.texcoord_0_idx = attribute_ptr->valueint; }
+        }
+      }
+      cJSON* material_ptr = cJSON_GetObjectItem( primitive_ptr, "material" );
+      if ( material_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].material_idx = material_ptr->valueint; }
+      cJSON* indices_ptr = cJSON_GetObjectItem( primitive_ptr, "indices" );
+      if ( indices_ptr ) { gltf_ptr->meshes_ptr[m].primitives_ptr[p].indices_idx = indices_ptr->valueint; }
+
+    } // endfor n_primitives
+  }   // endfor n_meshes
+
+  // "nodes"
+  for ( int n = 0; n < gltf_ptr->n_nodes; n++ ) {
+    gltf_ptr->nodes_ptr[n].mesh_idx = -1;
+    cJSON* node_ptr                 = cJSON_GetArrayItem( nodes_ptr, n );
+    cJSON* mesh_ptr                 = cJSON_GetObjectItem( node_ptr, "mesh" );
+    if ( mesh_ptr ) { gltf_ptr->nodes_ptr[n].mesh_idx = mesh_ptr->valueint; }
+    cJSON* name_ptr = cJSON_GetObjectItem( node_ptr, "name" );
+    if ( name_ptr ) { strncat( gltf_ptr->nodes_ptr[n].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+  }
+
+  // samplers
+  for ( int s = 0; s < gltf_ptr->n_samplers; s++ ) {
+    cJSON* s_ptr         = cJSON_GetArrayItem( samplers_ptr, s );
+    cJSON* magFilter_ptr = cJSON_GetObjectItem( s_ptr, "magFilter" );
+    cJSON* minFilter_ptr = cJSON_GetObjectItem( s_ptr, "minFilter" );
+    if ( magFilter_ptr ) {
+      gltf_ptr->samplers_ptr[s].mag_filter     = samplers_ptr->valueint;
+      gltf_ptr->samplers_ptr[s].has_mag_filter = true;
+    }
+    if ( minFilter_ptr ) {
+      gltf_ptr->samplers_ptr[s].min_filter     = samplers_ptr->valueint;
+      gltf_ptr->samplers_ptr[s].has_min_filter = true;
+    }
+  }
+
+  // "scenes"
+  for ( int s = 0; s < gltf_ptr->n_scenes; s++ ) {
+    cJSON* scene_ptr      = cJSON_GetArrayItem( scenes_ptr, s );
+    cJSON* nodes_list_ptr = cJSON_GetObjectItem( scene_ptr, "nodes" );
+    for ( int n = 0; n < gltf_ptr->scenes_ptr[s].n_node_idxs; n++ ) {
+      gltf_ptr->scenes_ptr[s].node_idxs_ptr[n] = cJSON_GetArrayItem( nodes_list_ptr, n )->valueint;
+    }
+  }
+
+  // "textures"
+  for ( int t = 0; t < gltf_ptr->n_textures; t++ ) {
+    cJSON* t_ptr       = cJSON_GetArrayItem( textures_ptr, t );
+    cJSON* sampler_ptr = cJSON_GetObjectItem( t_ptr, "sampler" );
+    cJSON* source_ptr  = cJSON_GetObjectItem( t_ptr, "source" );
+    cJSON* name_ptr    = cJSON_GetObjectItem( t_ptr, "name" );
+    if ( sampler_ptr ) { gltf_ptr->textures_ptr[t].sampler_idx = sampler_ptr->valueint; }
+    if ( source_ptr ) { gltf_ptr->textures_ptr[t].source_idx = source_ptr->valueint; }
+    if ( name_ptr ) { strncat( gltf_ptr->textures_ptr[t].name_str, name_ptr->valuestring, GLTF_NAME_MAX - 1 ); }
+  }
+
+  cJSON_Delete( json_ptr );
+  free( record.data );
+  return true;
+}
+
+int main( int argc, char** argv ) {
+  int max_n         = argc > 1 ? atoi( argv[1] ) : 160000;
+  bool ok           = true, run_cjson = true;
+  printf( "%8s %9s %12s %12s %8s\n", "nodes", "MB", "cJSON ms", "tokens ms", "speedup" );
+  for ( int n = 2500; n <= max_n && ok; n *= 2 ) {
+    if ( !_write_scene( BENCH_FILE, n ) ) {
+      fprintf( stderr, "ERROR: could not write %s\n", BENCH_FILE );
+      return 1;
+    }
+    FILE* fp = fopen( BENCH_FILE, "rb" );
+    fseek( fp, 0L, SEEK_END );
+    long sz = ftell( fp );
+    fclose( fp );
+
+    gltf_t gltf = ( gltf_t ){ 0 }, ref = ( gltf_t ){ 0 };
+    double t    = _time_s();
+    ok          = gltf_read( BENCH_FILE, &gltf ) && n == gltf.n_nodes && n == gltf.n_accessors;
+    double s    = _time_s() - t;
+    printf( "%8i %9.2f ", n, sz / ( 1024.0 * 1024.0 ) );
+    if ( run_cjson ) {
+      t               = _time_s();
+      bool ref_ok     = cjson_gltf_read( BENCH_FILE, &ref );
+      double cjson_s  = _time_s() - t;
+      ok              = ok && ref_ok && _same( &gltf, &ref );
+      run_cjson       = cjson_s < 2.0;
+      printf( "%12.1f %12.1f %7.1fx %s\n", cjson_s * 1000.0, s * 1000.0, cjson_s / s, ok ? "" : "DIFFERENT" );
+      gltf_free( &ref );
+    } else {
+      printf( "%12s %12.1f %8s %s\n", "-", s * 1000.0, "", ok ? "" : "FAILED" );
+    }
+    gltf_free( &gltf );
+  }
+  remove( BENCH_FILE );
+  return ok ? 0 : 1;
+}
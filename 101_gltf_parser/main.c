@@ -31,7 +31,7 @@ gfx_texture_t cubemap_from_images() {
 
 int main( int argc, char** argv ) {
   if ( argc < 2 ) {
-    printf( "Usage ./a.out MYFILE.gltf\n" );
+    printf( "Usage ./a.out MYFILE.gltf or MYFILE.glb\n" );
     return 0;
   }
 
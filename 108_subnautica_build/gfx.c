@@ -2,6 +2,8 @@
 #include "glcontext.h"
 #include "apg_pixfont.h"
 #include "apg_ply.h"
+#define APG_MESH_IMPLEMENTATION
+#include "apg_mesh.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -728,54 +730,73 @@ bool gfx_buffer_update( gfx_buffer_t* buffer, float* data, uint32_t n_components
   return true;
 }
 
-// requires apg_ply
-gfx_mesh_t gfx_mesh_create_from_ply( const char* ply_filename ) {
-  gfx_mesh_t mesh = ( gfx_mesh_t ){ .n_vertices = 0 };
-  if ( !ply_filename ) { return mesh; }
+// cooks a ply file into an apg_mesh file. colours are converted to floats here rather than on every load.
+static int _cook_ply( const char* ply_filename, const char* mesh_filename, const apg_mesh_source_t* source_ptr, void* user_ptr ) {
+  (void)user_ptr;
   apg_ply_t ply = ( apg_ply_t ){ .n_vertices = 0 };
-  if ( !apg_ply_read( ply_filename, &ply ) ) {
-    fprintf( stderr, "ERROR reading ply mesh from file `%s`\n", ply_filename );
-    return mesh;
-  }
-  if ( !ply.n_vertices ) { return mesh; }
+  if ( !apg_ply_read( ply_filename, &ply ) ) { return 0; }
 
-  // convert colours to floats
   float* rgb_f = NULL;
   if ( ply.n_colours_comps > 0 ) {
     rgb_f = malloc( sizeof( float ) * ply.n_colours_comps * ply.n_vertices );
-    assert( rgb_f );
-    for ( uint32_t i = 0; i < ply.n_vertices; i++ ) {
-      rgb_f[i * ply.n_colours_comps + 0] = ply.colours_ptr[i * ply.n_colours_comps + 0] / 255.0f;
-      rgb_f[i * ply.n_colours_comps + 1] = ply.colours_ptr[i * ply.n_colours_comps + 1] / 255.0f;
-      rgb_f[i * ply.n_colours_comps + 2] = ply.colours_ptr[i * ply.n_colours_comps + 2] / 255.0f;
-      if ( 4 == ply.n_colours_comps ) { rgb_f[i * ply.n_colours_comps + 3] = ply.colours_ptr[i * ply.n_colours_comps + 3] / 255.0f; }
+    if ( !rgb_f ) {
+      apg_ply_free( &ply );
+      return 0;
     }
+    for ( uint32_t i = 0; i < ply.n_vertices * ply.n_colours_comps; i++ ) { rgb_f[i] = ply.colours_ptr[i] / 255.0f; }
   }
 
-  gfx_mesh_params_t params = ( gfx_mesh_params_t ){ //
-    .points_buffer    = ply.positions_ptr,
-    .n_points_comps   = ply.n_positions_comps,
-    .texcoords_buffer = ply.texcoords_ptr,
-    .n_texcoord_comps = ply.n_texcoords_comps,
-    .normals_buffer   = ply.normals_ptr,
-    .n_normal_comps   = ply.n_normals_comps,
-    .vcolours_buffer  = rgb_f,
-    .n_vcolour_comps  = ply.n_colours_comps,
-    .edges_buffer     = ply.edges_ptr,
-    .n_edge_comps     = ply.n_edges_comps,
-    .n_vertices       = ply.n_vertices
-  };
-  mesh = gfx_create_mesh_from_mem( &params );
-  if ( ply.n_vertices > 0 && ply.positions_ptr ) {
-    float biggest_value = fabs( ply.positions_ptr[0] );
-    for ( uint32_t i = 1; i < ply.n_vertices * 3; i++ ) {
-      float tmp = fabs( ply.positions_ptr[i] );
-      if ( tmp > biggest_value ) { biggest_value = tmp; }
-    }
-    mesh.bounding_radius = biggest_value;
+  apg_mesh_desc_t desc = ( apg_mesh_desc_t ){ .n_vertices = ply.n_vertices };
+  const struct {
+    int attrib, n_comps;
+    const float* data_ptr;
+  } streams[] = { { APG_MESH_POSITION, ply.n_positions_comps, ply.positions_ptr }, { APG_MESH_TEXCOORD, ply.n_texcoords_comps, ply.texcoords_ptr },
+    { APG_MESH_NORMAL, ply.n_normals_comps, ply.normals_ptr }, { APG_MESH_COLOUR, ply.n_colours_comps, rgb_f },
+    { APG_MESH_EDGE, ply.n_edges_comps, ply.edges_ptr } };
+  for ( int i = 0; i < (int)( sizeof( streams ) / sizeof( streams[0] ) ); i++ ) {
+    if ( streams[i].n_comps <= 0 || !streams[i].data_ptr ) { continue; }
+    desc.streams[desc.n_streams++] = ( apg_mesh_stream_desc_t ){
+      .attrib = streams[i].attrib, .type = APG_MESH_F32, .n_comps = streams[i].n_comps, .data_ptr = streams[i].data_ptr };
   }
+  int ok = apg_mesh_write( mesh_filename, &desc, source_ptr );
   apg_ply_free( &ply );
   free( rgb_f );
+  return ok;
+}
+
+// requires apg_ply and apg_mesh
+gfx_mesh_t gfx_mesh_create_from_ply( const char* ply_filename ) {
+  gfx_mesh_t mesh = ( gfx_mesh_t ){ .n_vertices = 0 };
+  if ( !ply_filename ) { return mesh; }
+  char mesh_filename[1024];
+  snprintf( mesh_filename, sizeof( mesh_filename ), "%s.mesh", ply_filename );
+  apg_mesh_t cooked;
+  if ( !apg_mesh_open_cached( ply_filename, mesh_filename, _cook_ply, NULL, &cooked ) ) {
+    fprintf( stderr, "ERROR reading ply mesh from file `%s`\n", ply_filename );
+    return mesh;
+  }
+  if ( !cooked.n_vertices ) {
+    apg_mesh_close( &cooked );
+    return mesh;
+  }
+
+  // the mapped streams are uploaded as they are. nothing is parsed or converted.
+  gfx_mesh_params_t params = ( gfx_mesh_params_t ){ .n_vertices = (int)cooked.n_vertices };
+  params.points_buffer     = (float*)apg_mesh_stream( &cooked, APG_MESH_POSITION, &params.n_points_comps, NULL );
+  params.texcoords_buffer  = (float*)apg_mesh_stream( &cooked, APG_MESH_TEXCOORD, &params.n_texcoord_comps, NULL );
+  params.normals_buffer    = (float*)apg_mesh_stream( &cooked, APG_MESH_NORMAL, &params.n_normal_comps, NULL );
+  params.vcolours_buffer   = (float*)apg_mesh_stream( &cooked, APG_MESH_COLOUR, &params.n_vcolour_comps, NULL );
+  params.edges_buffer      = (float*)apg_mesh_stream( &cooked, APG_MESH_EDGE, &params.n_edge_comps, NULL );
+  mesh                     = gfx_create_mesh_from_mem( &params );
+  if ( params.points_buffer ) {
+    const apg_mesh_header_t* hdr_ptr = cooked.header_ptr;
+    float biggest_value              = 0.0f;
+    for ( int i = 0; i < 3; i++ ) {
+      biggest_value = fmaxf( biggest_value, fmaxf( fabsf( hdr_ptr->bounds_min[i] ), fabsf( hdr_ptr->bounds_max[i] ) ) );
+    }
+    mesh.bounding_radius = biggest_value;
+  }
+  apg_mesh_close( &cooked );
 
   return mesh;
 }
@@ -110,7 +110,9 @@ const char* gfx_renderer_str( void );
  * Meshes
  ****************************************************************************/
 
-/** @note Requires apg_ply. */
+/** Loads a mesh through a cooked copy, ply_filename with ".mesh" appended, which is made from the ply file with apg_mesh.h the first time,
+ * and again whenever the ply file's contents change. Later loads map the cooked file and upload it directly.
+ * @note Requires apg_ply and apg_mesh. */
 gfx_mesh_t gfx_mesh_create_from_ply( const char* ply_filename );
 
 gfx_mesh_t gfx_mesh_create_empty(
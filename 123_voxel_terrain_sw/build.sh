@@ -1,2 +1,2 @@
 #!/bin/bash
-gcc main.c -g -fsanitize=address -lm -I glad/include/ glad/src/gl.c -lGL -lglfw
+gcc main.c voxel.c -g -fsanitize=address -DAPG_PROFILER -lm -pthread -I glad/include/ glad/src/gl.c -lGL -lglfw
@@ -14,22 +14,12 @@
 #include <GLFW/glfw3.h>
 #define APG_IMPLEMENTATION
 #include "apg.h"
+#include "voxel.h"
 
 
 #define SCREEN_WIDTH 320 
 #define SCREEN_HEIGHT 200
-#define MAP_N 1024
-#define SCALE_FACTOR 120.0
-
-typedef struct cam_t {
-  float x, y, height, zfar, attitude, heading;
-} cam_t;
-
-typedef struct img_t {
-  uint8_t* c_ptr, *h_ptr;
-  uint8_t pal[256 * 3];
-  int w,h;
-} img_t;
+#define LOD_STEP 0.005f
 
 void ppm_write( const char* fn, img_t img ) {
   FILE* f = fopen( fn, "wb" );
@@ -54,25 +44,6 @@ void ppm_write( const char* fn, img_t img ) {
   }
 }
 
-img_t read_cmap( const char* fn_c, const char* fn_p, const char* fn_h ) {
-  img_t img = (img_t){ .w = MAP_N, .h = MAP_N };
-  FILE* fc  = fopen( fn_c, "rb" );
-  assert( fc );
-  img.c_ptr = malloc( MAP_N * MAP_N );
-  fread( img.c_ptr, MAP_N * MAP_N, 1, fc );
-  fclose( fc );
-  FILE* fp = fopen( fn_p, "rb" );
-  assert( fp );
-  fread( img.pal, 768, 1, fp );
-  fclose( fp );
-  FILE* fh = fopen( fn_h, "rb" );
-  assert( fh );
-  img.h_ptr = malloc( MAP_N * MAP_N );
-  fread( img.h_ptr, MAP_N * MAP_N, 1, fh );
-  fclose( fh );
-  return img;
-}
-
 GLFWwindow* window;
 GLuint shader_program, vao, col_texture_handle, pal_texture_handle;
 int win_w = 320 * 4, win_h = 200 * 4;
@@ -168,10 +139,15 @@ void start_gl( void ) {
 
 
 int main() {
+  apg_time_init();
   start_gl();
+  if ( !apg_jobs_init( 0 ) ) { fprintf( stderr, "WARNING: could not start job threads. rendering on this thread only\n" ); }
 
   img_t maps = read_cmap( "map0.color", "map0.palette", "map0.height" );
   ppm_write( "out_cm.ppm", maps ); // Debug output of maps.
+  voxel_map_t map;
+  bool mret = voxel_map_from_img( &maps, &map );
+  assert( mret && "tiled map build fail" );
   img_t fb = (img_t){ .w = SCREEN_WIDTH, .h = SCREEN_HEIGHT };
   fb.c_ptr = calloc( fb.w * fb.h, 1 );
   memcpy( fb.pal, maps.pal, 256 * 3 );
@@ -185,7 +161,10 @@ int main() {
   /** do a background sky gradient */
 
   cam_t cam             = (cam_t){ .x = 512, .y = 512, .height = 70.0f, .zfar = 1600.0f, .attitude = 60.0f, .heading = 1.5 * 3.141592 }; // (= 270 deg) };
-  float terrain_h_scale = SCALE_FACTOR;
+  float lod_step        = 0.0f;
+  bool l_was_down       = false;
+  bool mips             = true;
+  bool m_was_down       = false;
 
   double prev_s            = glfwGetTime();
   double title_countdown_s = 0.2;
@@ -229,56 +208,20 @@ int main() {
     if ( glfwGetKey( window, GLFW_KEY_Q ) ) { cam.height -= 100.0f * elapsed_s; }
     if ( glfwGetKey( window, GLFW_KEY_UP ) ) { cam.attitude += 150.0 * elapsed_s; }
     if ( glfwGetKey( window, GLFW_KEY_DOWN ) ) { cam.attitude -= 150.0 * elapsed_s; }
+    bool l_down = GLFW_PRESS == glfwGetKey( window, GLFW_KEY_L );
+    if ( l_down && !l_was_down ) { lod_step = lod_step > 0.0f ? 0.0f : LOD_STEP; } // toggle distance-based step growth.
+    l_was_down  = l_down;
+    bool m_down = GLFW_PRESS == glfwGetKey( window, GLFW_KEY_M );
+    if ( m_down && !m_was_down ) { mips = !mips; } // toggle sampling far terrain from the mip chain.
+    m_was_down = m_down;
 
 
 ////////////////////////////////////////////////////////////
-    memset( fb.c_ptr, 0, SCREEN_WIDTH * SCREEN_HEIGHT );
-
-    float sinangle = sin(cam.heading);
-    float cosangle = cos(cam.heading);
-    // Left-most point of the FOV
-    float plx = cosangle * cam.zfar + sinangle * cam.zfar;
-    float ply = sinangle * cam.zfar - cosangle * cam.zfar;
-
-    // Right-most point of the FOV
-    float prx = cosangle * cam.zfar - sinangle * cam.zfar;
-    float pry = sinangle * cam.zfar + cosangle * cam.zfar;
-
-    for (int i = 0; i < SCREEN_WIDTH; i++) {
-      float delta_x   = ( plx + ( prx - plx ) / SCREEN_WIDTH * i ) / cam.zfar;
-      float delta_y   = ( ply + ( pry - ply ) / SCREEN_WIDTH * i ) / cam.zfar;
-      float ray_x     = cam.x;
-      float ray_y     = cam.y;
-      float tallest_h = SCREEN_HEIGHT;
-
-      for ( int z = 1; z < cam.zfar; z++ ) {
-        ray_x += delta_x;
-        ray_y += delta_y; // -= to face the other way around (probably what we want)
-
-        // ensure ray_x and ray_y are < map bounds by AND with 1023.
-        int map_idx = ( ( maps.w * ( (int)( ray_y ) & ( maps.w - 1 ) ) ) + ( (int)( ray_x ) & ( maps.w - 1 ) ) );
-
- 
-        // AARRGHHH my error was /cam.zfar here instead of /z --->>>>> CONFUSING VARIABLE NAMES!!!!!!!!
-        int projheight = (int)((cam.height - maps.h_ptr[map_idx]) / z * SCALE_FACTOR + cam.attitude);
-
-        // Only draw pixels if the new projected height is taller than the previous tallest height
-        if (projheight < tallest_h) {
-          // Draw pixels from previous max-height until the new projected height
-          for (int y = projheight; y < tallest_h; y++) {
-            if (y >= 0) { fb.c_ptr[(SCREEN_WIDTH * y) + i] = maps.c_ptr[map_idx]; }
-          }
-          tallest_h = projheight;
-        }
-
-        // debug cone of view
-        // int fb_idx = (fb.w * (int)( ray_y/ 6 ))  + (int)( ray_x / 6 );
-        // printf( "fb_idx %i\n", fb_idx );
-        // assert( fb_idx < fb.w * fb.h );
-        //  fb.c_ptr[fb_idx] = (uint8_t)0x19;
-      }
-    }
+    APG_PROF_BEGIN( "render_terrain" );
+    voxel_render_map( &map, cam, lod_step, mips, &fb );
+    APG_PROF_END();
 
+    APG_PROF_BEGIN( "upload_and_draw" );
     glClearColor( 0.6f, 0.6f, 0.8f, 1.0f );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
@@ -298,15 +241,25 @@ int main() {
     glBindTexture( GL_TEXTURE_2D, pal_texture_handle );
 
     glDrawArrays( GL_TRIANGLES, 0, 3 );
+    APG_PROF_END();
 
+    APG_PROF_BEGIN( "swap_buffers" );
     glfwSwapBuffers( window );
+    APG_PROF_END();
+    APG_PROF_FRAME_END();
   } // endwhile
 
+  apg_prof_print_frame_stats( stdout );
+  if ( !apg_prof_write_chrome_trace( "trace.json" ) ) { fprintf( stderr, "ERROR: writing trace.json\n" ); }
+  apg_prof_free();
+
   ppm_write( "output.ppm", fb );
   free( fb.c_ptr );
   free( maps.c_ptr );
   free( maps.h_ptr );
+  voxel_map_free( &map );
 
+  apg_jobs_free();
   glfwTerminate();
   return 0;
 }
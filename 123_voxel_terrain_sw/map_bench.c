@@ -0,0 +1,202 @@
+#ifdef __linux__
+#define _GNU_SOURCE // for syscall()
+#endif
+/* Benchmark for Voxel Space map layouts: row-major maps against tiled maps, with and without mips, at map sizes up to 8K x 8K.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L map_bench.c voxel.c -lm -pthread -o map_bench
+Run:
+  ./map_bench [n_frames]
+
+Larger maps are map0 upsampled, with bilinear heights and nearest colours, and the camera's zfar and path scaled with the map, so each
+frame covers the same terrain in more texels, as a more detailed map would. Each layout renders n_frames (default 32) along the same path
+with LOD_STEP step growth, on every core. `L1D miss/f` and `LLC miss/f` are hardware counts of L1 data cache read misses and last-level
+cache misses per frame, read with perf_event_open() on Linux. They show n/a where the counters aren't available, such as in most VMs.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "voxel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define LOD_STEP 0.005f
+
+typedef enum layout_t { LAYOUT_LINEAR, LAYOUT_TILED, LAYOUT_TILED_MIPS, LAYOUT_MAX } layout_t;
+
+static const char* _layout_names[LAYOUT_MAX] = { "row-major", "tiled", "tiled + mips" };
+static const int _map_sizes[]                = { 1024, 4096, 8192 };
+static const int _resolutions[][2]           = { { 320, 200 }, { 1920, 1080 } };
+
+typedef struct counters_t {
+  int l1d_fd, llc_fd;
+} counters_t;
+
+// counters are opened with inherit set, before apg_jobs_init() starts the worker threads, so they count all threads.
+static counters_t _counters_open( void ) {
+  counters_t counters = (counters_t){ .l1d_fd = -1, .llc_fd = -1 };
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset( &attr, 0, sizeof( attr ) );
+  attr.size           = sizeof( attr );
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.inherit        = 1;
+  attr.type           = PERF_TYPE_HW_CACHE;
+  attr.config         = PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+  counters.l1d_fd     = (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+  attr.type           = PERF_TYPE_HARDWARE;
+  attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+  counters.llc_fd     = (int)syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+#endif
+  return counters;
+}
+
+// -1 if the counter isn't available.
+static int64_t _counter_read( int fd ) {
+#ifdef __linux__
+  uint64_t value = 0;
+  if ( fd >= 0 && sizeof( value ) == read( fd, &value, sizeof( value ) ) ) { return (int64_t)value; }
+#else
+  (void)fd;
+#endif
+  return -1;
+}
+
+typedef struct upsample_job_t {
+  const img_t* src_ptr;
+  img_t* dst_ptr;
+} upsample_job_t;
+
+static void _upsample_rows( int64_t begin, int64_t end, void* arg_ptr ) {
+  const upsample_job_t* job_ptr = (const upsample_job_t*)arg_ptr;
+  const img_t* src_ptr          = job_ptr->src_ptr;
+  img_t* dst_ptr                = job_ptr->dst_ptr;
+  int mask                      = src_ptr->w - 1;
+  float ratio                   = (float)src_ptr->w / dst_ptr->w;
+  for ( int y = (int)begin; y < (int)end; y++ ) {
+    for ( int x = 0; x < dst_ptr->w; x++ ) {
+      float fx = x * ratio, fy = y * ratio;
+      int x0 = (int)fx, y0 = (int)fy;
+      float tx = fx - x0, ty = fy - y0;
+      int i00 = ( y0 & mask ) * src_ptr->w + ( x0 & mask ), i10 = ( y0 & mask ) * src_ptr->w + ( ( x0 + 1 ) & mask );
+      int i01 = ( ( y0 + 1 ) & mask ) * src_ptr->w + ( x0 & mask ), i11 = ( ( y0 + 1 ) & mask ) * src_ptr->w + ( ( x0 + 1 ) & mask );
+      float top           = src_ptr->h_ptr[i00] + ( src_ptr->h_ptr[i10] - src_ptr->h_ptr[i00] ) * tx;
+      float bottom        = src_ptr->h_ptr[i01] + ( src_ptr->h_ptr[i11] - src_ptr->h_ptr[i01] ) * tx;
+      size_t idx          = (size_t)y * dst_ptr->w + x;
+      dst_ptr->h_ptr[idx] = (uint8_t)( top + ( bottom - top ) * ty + 0.5f );
+      dst_ptr->c_ptr[idx] = src_ptr->c_ptr[( ( (int)( fy + 0.5f ) ) & mask ) * src_ptr->w + ( ( (int)( fx + 0.5f ) ) & mask )];
+    }
+  }
+}
+
+static bool _upsample( const img_t* src_ptr, int n, img_t* dst_ptr ) {
+  *dst_ptr       = (img_t){ .w = n, .h = n };
+  dst_ptr->c_ptr = malloc( (size_t)n * n );
+  dst_ptr->h_ptr = malloc( (size_t)n * n );
+  if ( !dst_ptr->c_ptr || !dst_ptr->h_ptr ) {
+    free( dst_ptr->c_ptr );
+    free( dst_ptr->h_ptr );
+    return false;
+  }
+  memcpy( dst_ptr->pal, src_ptr->pal, sizeof( dst_ptr->pal ) );
+  upsample_job_t job = (upsample_job_t){ .src_ptr = src_ptr, .dst_ptr = dst_ptr };
+  apg_jobs_parallel_for( 0, n, 16, _upsample_rows, &job );
+  return true;
+}
+
+// a loop around the map, flying at a fixed height over the terrain below, scaled to the map's size.
+static cam_t _cam_on_path( const img_t* maps_ptr, int frame, int n_frames ) {
+  float map_scale = maps_ptr->w / 1024.0f;
+  float t         = 2.0f * 3.141592f * frame / n_frames;
+  cam_t cam       = (cam_t){ .zfar = 1600.0f * map_scale, .attitude = 60.0f };
+  cam.x           = ( 512.0f + 300.0f * cosf( t ) ) * map_scale;
+  cam.y           = ( 512.0f + 300.0f * sinf( t ) ) * map_scale;
+  cam.heading     = t + 0.5f * 3.141592f;
+  cam.height      = maps_ptr->h_ptr[( (int)cam.y & ( maps_ptr->w - 1 ) ) * maps_ptr->w + ( (int)cam.x & ( maps_ptr->w - 1 ) )] + 60.0f;
+  return cam;
+}
+
+static void _print_count( int64_t count, int n_frames ) {
+  if ( count < 0 ) {
+    printf( " %11s", "n/a" );
+  } else {
+    printf( " %11.0f", (double)count / n_frames );
+  }
+}
+
+static bool _bench_map( const img_t* maps_ptr, counters_t counters, int n_frames ) {
+  voxel_map_t map;
+  double t0 = apg_time_s();
+  if ( !voxel_map_from_img( maps_ptr, &map ) ) { return false; }
+  printf( "%ix%i map: tiled map with %i levels built in %.1f ms\n", maps_ptr->w, maps_ptr->h, map.n_levels, ( apg_time_s() - t0 ) * 1000.0 );
+
+  bool ok = true;
+  for ( int r = 0; ok && r < (int)( sizeof( _resolutions ) / sizeof( _resolutions[0] ) ); r++ ) {
+    img_t fb = (img_t){ .w = _resolutions[r][0], .h = _resolutions[r][1] };
+    fb.c_ptr = malloc( (size_t)fb.w * fb.h );
+    ok       = NULL != fb.c_ptr;
+    for ( int layout = 0; ok && layout < LAYOUT_MAX; layout++ ) {
+      int64_t l1d_start = _counter_read( counters.l1d_fd ), llc_start = _counter_read( counters.llc_fd );
+      double total_s = 0.0;
+      for ( int f = 0; f < n_frames; f++ ) {
+        cam_t cam = _cam_on_path( maps_ptr, f, n_frames );
+        t0        = apg_time_s();
+        if ( LAYOUT_LINEAR == layout ) {
+          voxel_render( maps_ptr, cam, LOD_STEP, &fb );
+        } else {
+          voxel_render_map( &map, cam, LOD_STEP, LAYOUT_TILED_MIPS == layout, &fb );
+        }
+        total_s += apg_time_s() - t0;
+      }
+      int64_t l1d_end = _counter_read( counters.l1d_fd ), llc_end = _counter_read( counters.llc_fd );
+      printf( "  %-14s %4ix%-4i %9.2f", _layout_names[layout], fb.w, fb.h, total_s * 1000.0 / n_frames );
+      _print_count( l1d_start < 0 ? -1 : l1d_end - l1d_start, n_frames );
+      _print_count( llc_start < 0 ? -1 : llc_end - llc_start, n_frames );
+      printf( "\n" );
+    }
+    free( fb.c_ptr );
+  }
+  voxel_map_free( &map );
+  return ok;
+}
+
+int main( int argc, char** argv ) {
+  int n_frames = argc > 1 ? APG_MAX( atoi( argv[1] ), 1 ) : 32;
+  apg_time_init();
+  counters_t counters = _counters_open();
+  if ( !apg_jobs_init( 0 ) ) { return 1; }
+  img_t maps = read_cmap( "map0.color", "map0.palette", "map0.height" );
+
+  printf( "%i threads, %i frames per run, lod_step %.3f\n", apg_jobs_n_threads(), n_frames, LOD_STEP );
+  printf( "  %-14s %9s %9s %11s %11s\n", "layout", "res", "ms/frame", "L1D miss/f", "LLC miss/f" );
+  bool ok = true;
+  for ( int i = 0; ok && i < (int)( sizeof( _map_sizes ) / sizeof( _map_sizes[0] ) ); i++ ) {
+    if ( _map_sizes[i] == maps.w ) {
+      ok = _bench_map( &maps, counters, n_frames );
+      continue;
+    }
+    img_t big;
+    if ( !_upsample( &maps, _map_sizes[i], &big ) ) {
+      fprintf( stderr, "WARNING: out of memory for a %ix%i map\n", _map_sizes[i], _map_sizes[i] );
+      break;
+    }
+    ok = _bench_map( &big, counters, n_frames );
+    free( big.c_ptr );
+    free( big.h_ptr );
+  }
+
+  apg_jobs_free();
+  free( maps.c_ptr );
+  free( maps.h_ptr );
+  return ok ? 0 : 1;
+}
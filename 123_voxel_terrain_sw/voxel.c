@@ -0,0 +1,282 @@
+#include "voxel.h"
+#include "apg.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_MASK ( ( 1 << VOXEL_BLOCK_LOG2 ) - 1 )
+
+typedef struct render_job_t {
+  const img_t* maps_ptr;
+  const voxel_map_t* map_ptr;
+  img_t* fb_ptr;
+  cam_t cam;
+  float lod_step;
+  bool mips;
+  float plx, ply, prx, pry; // left and right-most points of the FOV.
+  float column_gap;         // distance between neighbouring columns' rays, per unit of z.
+  double scale, horizon;    // VOXEL_SCALE_FACTOR and attitude, scaled to the framebuffer's height.
+} render_job_t;
+
+typedef struct build_job_t {
+  const img_t* maps_ptr;
+  voxel_map_t* map_ptr;
+  const uint8_t* lut_ptr; // 15-bit RGB to nearest palette index.
+  int level;
+} build_job_t;
+
+img_t read_cmap( const char* fn_c, const char* fn_p, const char* fn_h ) {
+  APG_PROF_BEGIN( "read_cmap" );
+  img_t img = (img_t){ .w = MAP_N, .h = MAP_N };
+  FILE* fc  = fopen( fn_c, "rb" );
+  assert( fc );
+  img.c_ptr = malloc( MAP_N * MAP_N );
+  fread( img.c_ptr, MAP_N * MAP_N, 1, fc );
+  fclose( fc );
+  FILE* fp = fopen( fn_p, "rb" );
+  assert( fp );
+  fread( img.pal, 768, 1, fp );
+  fclose( fp );
+  FILE* fh = fopen( fn_h, "rb" );
+  assert( fh );
+  img.h_ptr = malloc( MAP_N * MAP_N );
+  fread( img.h_ptr, MAP_N * MAP_N, 1, fh );
+  fclose( fh );
+  APG_PROF_END();
+  return img;
+}
+
+static void _render_column( const render_job_t* job_ptr, int i ) {
+  const img_t* maps_ptr = job_ptr->maps_ptr;
+  img_t* fb_ptr         = job_ptr->fb_ptr;
+  cam_t cam             = job_ptr->cam;
+  float delta_x         = ( job_ptr->plx + ( job_ptr->prx - job_ptr->plx ) / fb_ptr->w * i ) / cam.zfar;
+  float delta_y         = ( job_ptr->ply + ( job_ptr->pry - job_ptr->ply ) / fb_ptr->w * i ) / cam.zfar;
+  float ray_x           = cam.x;
+  float ray_y           = cam.y;
+  int tallest_h         = fb_ptr->h;
+  int mask              = maps_ptr->w - 1;
+  float dz              = 1.0f;
+
+  for ( float z = 1.0f; z < cam.zfar; z += dz ) {
+    // 1 * delta is exact, so without LOD the ray steps exactly as the original z++ march did.
+    dz = 1.0f + z * job_ptr->lod_step;
+    ray_x += delta_x * dz;
+    ray_y += delta_y * dz;
+
+    // ensure ray_x and ray_y are < map bounds by AND with 1023.
+    int map_idx    = ( ( maps_ptr->w * ( (int)( ray_y ) & mask ) ) + ( (int)( ray_x ) & mask ) );
+    int projheight = (int)( ( cam.height - maps_ptr->h_ptr[map_idx] ) / z * job_ptr->scale + job_ptr->horizon );
+
+    // Only draw pixels if the new projected height is taller than the previous tallest height
+    if ( projheight < tallest_h ) {
+      uint8_t colour = maps_ptr->c_ptr[map_idx];
+      for ( int y = APG_MAX( projheight, 0 ); y < tallest_h; y++ ) { fb_ptr->c_ptr[( fb_ptr->w * y ) + i] = colour; }
+      tallest_h = projheight;
+      if ( tallest_h <= 0 ) { return; } // the column is full
+    }
+  }
+  for ( int y = 0; y < tallest_h; y++ ) { fb_ptr->c_ptr[( fb_ptr->w * y ) + i] = 0; }
+}
+
+static void _render_columns( int64_t begin, int64_t end, void* arg_ptr ) {
+  APG_PROF_BEGIN( "render_columns" );
+  for ( int64_t i = begin; i < end; i++ ) { _render_column( (const render_job_t*)arg_ptr, (int)i ); }
+  APG_PROF_END();
+}
+
+static render_job_t _setup_job( cam_t cam, float lod_step, img_t* fb_ptr ) {
+  float sinangle   = sin( cam.heading );
+  float cosangle   = cos( cam.heading );
+  render_job_t job = (render_job_t){ .fb_ptr = fb_ptr, .cam = cam, .lod_step = lod_step };
+  // Left-most point of the FOV
+  job.plx = cosangle * cam.zfar + sinangle * cam.zfar;
+  job.ply = sinangle * cam.zfar - cosangle * cam.zfar;
+  // Right-most point of the FOV
+  job.prx        = cosangle * cam.zfar - sinangle * cam.zfar;
+  job.pry        = sinangle * cam.zfar + cosangle * cam.zfar;
+  job.column_gap = 2.0f / fb_ptr->w;
+  job.scale      = VOXEL_SCALE_FACTOR * fb_ptr->h / VOXEL_REF_H;
+  job.horizon    = (double)cam.attitude * fb_ptr->h / VOXEL_REF_H;
+  return job;
+}
+
+// a few chunks of columns per thread, for balance: columns facing mountains finish early.
+static int _column_grain( const img_t* fb_ptr ) { return APG_MAX( fb_ptr->w / ( APG_MAX( apg_jobs_n_threads(), 1 ) * 8 ), 1 ); }
+
+void voxel_render( const img_t* maps_ptr, cam_t cam, float lod_step, img_t* fb_ptr ) {
+  assert( maps_ptr && maps_ptr->c_ptr && maps_ptr->h_ptr && fb_ptr && fb_ptr->c_ptr );
+  assert( maps_ptr->w == maps_ptr->h && 0 == ( maps_ptr->w & ( maps_ptr->w - 1 ) ) && lod_step >= 0.0f );
+
+  render_job_t job = _setup_job( cam, lod_step, fb_ptr );
+  job.maps_ptr     = maps_ptr;
+  apg_jobs_parallel_for( 0, fb_ptr->w, _column_grain( fb_ptr ), _render_columns, &job );
+}
+
+/*=================================================================================================
+TILED MAPS
+=================================================================================================*/
+// index of texel (x,y), already wrapped, in a level 1 << log2_n texels square: blocks in row order, and texels in row order in a block.
+static inline uint32_t _texel_idx( uint32_t x, uint32_t y, int log2_n ) {
+  uint32_t block = ( ( y >> VOXEL_BLOCK_LOG2 ) << ( log2_n - VOXEL_BLOCK_LOG2 ) ) + ( x >> VOXEL_BLOCK_LOG2 );
+  return ( block << ( 2 * VOXEL_BLOCK_LOG2 ) ) | ( ( y & BLOCK_MASK ) << VOXEL_BLOCK_LOG2 ) | ( x & BLOCK_MASK );
+}
+
+static void _render_column_map( const render_job_t* job_ptr, int i ) {
+  const voxel_map_t* map_ptr      = job_ptr->map_ptr;
+  img_t* fb_ptr                   = job_ptr->fb_ptr;
+  cam_t cam                       = job_ptr->cam;
+  float delta_x                   = ( job_ptr->plx + ( job_ptr->prx - job_ptr->plx ) / fb_ptr->w * i ) / cam.zfar;
+  float delta_y                   = ( job_ptr->ply + ( job_ptr->pry - job_ptr->ply ) / fb_ptr->w * i ) / cam.zfar;
+  float ray_x                     = cam.x;
+  float ray_y                     = cam.y;
+  int tallest_h                   = fb_ptr->h;
+  float dz                        = 1.0f;
+  int level                       = 0;
+  int max_level                   = job_ptr->mips ? map_ptr->n_levels - 1 : 0;
+  float next_footprint            = 2.0f; // level l is used for footprints from 2^l texels up to 2^(l+1).
+  const voxel_texel_t* texels_ptr = map_ptr->levels_ptr[0];
+  int log2_n                      = map_ptr->log2_n;
+  int mask                        = map_ptr->n - 1;
+
+  for ( float z = 1.0f; z < cam.zfar; z += dz ) {
+    dz = 1.0f + z * job_ptr->lod_step;
+    ray_x += delta_x * dz;
+    ray_y += delta_y * dz;
+
+    // the footprint only grows along the ray, so levels only step down.
+    float footprint = APG_MAX( dz, z * job_ptr->column_gap );
+    while ( level < max_level && footprint >= next_footprint ) {
+      texels_ptr = map_ptr->levels_ptr[++level];
+      next_footprint *= 2.0f;
+      log2_n--;
+      mask >>= 1;
+    }
+    voxel_texel_t texel = texels_ptr[_texel_idx( ( (int)ray_x >> level ) & mask, ( (int)ray_y >> level ) & mask, log2_n )];
+    int projheight      = (int)( ( cam.height - texel.height ) / z * job_ptr->scale + job_ptr->horizon );
+
+    if ( projheight < tallest_h ) {
+      for ( int y = APG_MAX( projheight, 0 ); y < tallest_h; y++ ) { fb_ptr->c_ptr[( fb_ptr->w * y ) + i] = texel.colour; }
+      tallest_h = projheight;
+      if ( tallest_h <= 0 ) { return; }
+    }
+  }
+  for ( int y = 0; y < tallest_h; y++ ) { fb_ptr->c_ptr[( fb_ptr->w * y ) + i] = 0; }
+}
+
+static void _render_columns_map( int64_t begin, int64_t end, void* arg_ptr ) {
+  APG_PROF_BEGIN( "render_columns_map" );
+  for ( int64_t i = begin; i < end; i++ ) { _render_column_map( (const render_job_t*)arg_ptr, (int)i ); }
+  APG_PROF_END();
+}
+
+void voxel_render_map( const voxel_map_t* map_ptr, cam_t cam, float lod_step, bool mips, img_t* fb_ptr ) {
+  assert( map_ptr && map_ptr->levels_ptr[0] && fb_ptr && fb_ptr->c_ptr && lod_step >= 0.0f );
+
+  render_job_t job = _setup_job( cam, lod_step, fb_ptr );
+  job.map_ptr      = map_ptr;
+  job.mips         = mips;
+  apg_jobs_parallel_for( 0, fb_ptr->w, _column_grain( fb_ptr ), _render_columns_map, &job );
+}
+
+static void _build_level_rows( int64_t begin, int64_t end, void* arg_ptr ) {
+  const build_job_t* job_ptr = (const build_job_t*)arg_ptr;
+  voxel_map_t* map_ptr       = job_ptr->map_ptr;
+  int log2_n                 = map_ptr->log2_n - job_ptr->level;
+  int n                      = 1 << log2_n;
+  voxel_texel_t* dst_ptr     = map_ptr->levels_ptr[job_ptr->level];
+  for ( int y = (int)begin; y < (int)end; y++ ) {
+    for ( int x = 0; x < n; x++ ) {
+      if ( 0 == job_ptr->level ) {
+        const img_t* maps_ptr              = job_ptr->maps_ptr;
+        dst_ptr[_texel_idx( x, y, log2_n )] = (voxel_texel_t){ .height = maps_ptr->h_ptr[y * n + x], .colour = maps_ptr->c_ptr[y * n + x] };
+        continue;
+      }
+      // the average of the 2x2 texels above. colours are averaged through the palette, then matched back to it.
+      const voxel_texel_t* src_ptr = map_ptr->levels_ptr[job_ptr->level - 1];
+      int height = 0, rgb[3] = { 0, 0, 0 };
+      for ( int s = 0; s < 4; s++ ) {
+        voxel_texel_t texel = src_ptr[_texel_idx( x * 2 + ( s & 1 ), y * 2 + ( s >> 1 ), log2_n + 1 )];
+        height += texel.height;
+        for ( int c = 0; c < 3; c++ ) { rgb[c] += map_ptr->pal[texel.colour * 3 + c]; }
+      }
+      int rgb15                           = ( ( ( rgb[0] / 4 ) >> 3 ) << 10 ) | ( ( ( rgb[1] / 4 ) >> 3 ) << 5 ) | ( ( rgb[2] / 4 ) >> 3 );
+      dst_ptr[_texel_idx( x, y, log2_n )] = (voxel_texel_t){ .height = ( height + 2 ) / 4, .colour = job_ptr->lut_ptr[rgb15] };
+    }
+  }
+}
+
+// nearest palette entry for each 15-bit RGB, from the centre of its 8x8x8 cell.
+static void _build_lut_range( int64_t begin, int64_t end, void* arg_ptr ) {
+  const build_job_t* job_ptr = (const build_job_t*)arg_ptr;
+  const uint8_t* pal         = job_ptr->map_ptr->pal;
+  uint8_t* lut_ptr           = (uint8_t*)job_ptr->lut_ptr;
+  for ( int64_t i = begin; i < end; i++ ) {
+    int r = ( ( i >> 10 ) << 3 ) + 4, g = ( ( ( i >> 5 ) & 31 ) << 3 ) + 4, b = ( ( i & 31 ) << 3 ) + 4;
+    int best = 0, best_dist = INT32_MAX;
+    for ( int p = 0; p < 256; p++ ) {
+      int dr = r - pal[p * 3 + 0], dg = g - pal[p * 3 + 1], db = b - pal[p * 3 + 2];
+      int dist = dr * dr + dg * dg + db * db;
+      if ( dist < best_dist ) { best = p, best_dist = dist; }
+    }
+    lut_ptr[i] = (uint8_t)best;
+  }
+}
+
+bool voxel_map_from_img( const img_t* maps_ptr, voxel_map_t* map_ptr ) {
+  assert( maps_ptr && maps_ptr->c_ptr && maps_ptr->h_ptr && map_ptr );
+  int n = maps_ptr->w;
+  if ( n != maps_ptr->h || n < ( 1 << VOXEL_BLOCK_LOG2 ) || 0 != ( n & ( n - 1 ) ) ) { return false; }
+  APG_PROF_BEGIN( "voxel_map_from_img" );
+
+  *map_ptr = (voxel_map_t){ .n = n };
+  memcpy( map_ptr->pal, maps_ptr->pal, sizeof( map_ptr->pal ) );
+  while ( ( 1 << map_ptr->log2_n ) < n ) { map_ptr->log2_n++; }
+  size_t n_texels = 0;
+  while ( map_ptr->n_levels < VOXEL_MAX_LEVELS && ( n >> map_ptr->n_levels ) >= ( 1 << VOXEL_BLOCK_LOG2 ) ) {
+    n_texels += (size_t)( n >> map_ptr->n_levels ) * ( n >> map_ptr->n_levels );
+    map_ptr->n_levels++;
+  }
+  voxel_texel_t* texels_ptr = malloc( n_texels * sizeof( voxel_texel_t ) );
+  uint8_t* lut_ptr          = malloc( 1 << 15 );
+  if ( !texels_ptr || !lut_ptr ) {
+    free( texels_ptr );
+    free( lut_ptr );
+    APG_PROF_END();
+    return false;
+  }
+  for ( int l = 0; l < map_ptr->n_levels; l++ ) {
+    map_ptr->levels_ptr[l] = texels_ptr;
+    texels_ptr += (size_t)( n >> l ) * ( n >> l );
+  }
+
+  build_job_t job = (build_job_t){ .maps_ptr = maps_ptr, .map_ptr = map_ptr, .lut_ptr = lut_ptr };
+  apg_jobs_parallel_for( 0, 1 << 15, 256, _build_lut_range, &job );
+  for ( job.level = 0; job.level < map_ptr->n_levels; job.level++ ) { apg_jobs_parallel_for( 0, n >> job.level, 16, _build_level_rows, &job ); }
+  free( lut_ptr );
+  APG_PROF_END();
+  return true;
+}
+
+void voxel_map_free( voxel_map_t* map_ptr ) {
+  if ( !map_ptr ) { return; }
+  free( map_ptr->levels_ptr[0] );
+  *map_ptr = (voxel_map_t){ .n = 0 };
+}
+
+bool voxel_write_ppm( const char* fn, const img_t* img_ptr ) {
+  assert( fn && img_ptr && img_ptr->c_ptr );
+  FILE* f = fopen( fn, "wb" );
+  if ( !f ) { return false; }
+  bool ok      = fprintf( f, "P6\n%i %i\n255\n", img_ptr->w, img_ptr->h ) > 0;
+  uint8_t* rgb = malloc( (size_t)img_ptr->w * 3 );
+  ok           = ok && rgb;
+  for ( int y = 0; ok && y < img_ptr->h; y++ ) {
+    for ( int x = 0; x < img_ptr->w; x++ ) { memcpy( &rgb[x * 3], &img_ptr->pal[img_ptr->c_ptr[y * img_ptr->w + x] * 3], 3 ); }
+    ok = 1 == fwrite( rgb, (size_t)img_ptr->w * 3, 1, f );
+  }
+  free( rgb );
+  return 0 == fclose( f ) && ok;
+}
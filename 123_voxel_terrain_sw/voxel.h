@@ -0,0 +1,69 @@
+/* Voxel Space (Comanche) terrain renderer, split out of main.c so it can also run headless.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Each screen column marches a ray over the height map from the camera out to zfar, projecting each sample's height to the screen and
+filling pixels upwards from the last, tallest, span drawn.
+
+Level of detail:
+  With lod_step 0 the march takes one map unit per step, as in the original. Otherwise the step grows with distance, dz = 1 + z * lod_step,
+  since far samples project to less than a pixel anyway. Around 0.005-0.01 cuts the steps to zfar 1600 from 1600 to a few hundred.
+
+Threads:
+  Columns don't share any state, so voxel_render() splits them over the apg.h job system if apg_jobs_init() has been called.
+
+Tiled maps and mips:
+  The march reads the maps along every heading, so with row-major maps most steps land on a different cache line, a row apart at 8K.
+  voxel_map_t interleaves height and colour in 2-byte texels, stored in 8x8 blocks of 128 bytes, so nearby samples in any direction share
+  lines. It also keeps a mip chain, down to 8x8. voxel_render_map() samples the level whose texels match the march's footprint at that
+  distance, the larger of the step and the gap between neighbouring columns, so far samples stay inside a small working set and don't
+  alias. Heights are averaged into the next level down, and colours are averaged in RGB, then matched back to the nearest palette entry.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAP_N 1024
+#define VOXEL_SCALE_FACTOR 120.0 // height projection, for the reference screen height.
+#define VOXEL_REF_H 200          // screen height the camera's scale and attitude were tuned for. taller screens scale both.
+#define VOXEL_BLOCK_LOG2 3       // tiled maps are stored in 8x8 blocks of texels.
+#define VOXEL_MAX_LEVELS 16
+
+typedef struct cam_t {
+  float x, y, height, zfar, attitude, heading;
+} cam_t;
+
+// a paletted image. for maps, h_ptr is the height map, and w and h must be equal powers of two. for framebuffers h_ptr is NULL.
+typedef struct img_t {
+  uint8_t *c_ptr, *h_ptr;
+  uint8_t pal[256 * 3];
+  int w, h;
+} img_t;
+
+typedef struct voxel_texel_t {
+  uint8_t height, colour;
+} voxel_texel_t;
+
+// a tiled map with its mip chain. level l is (n >> l) texels square.
+typedef struct voxel_map_t {
+  voxel_texel_t* levels_ptr[VOXEL_MAX_LEVELS]; // all in one allocation, owned by levels_ptr[0].
+  int n, log2_n, n_levels;
+  uint8_t pal[256 * 3];
+} voxel_map_t;
+
+// reads MAP_N x MAP_N colour index and height maps, and a 256-entry RGB palette.
+img_t read_cmap( const char* fn_c, const char* fn_p, const char* fn_h );
+
+// renders the terrain into fb's colour indices. pixels above the terrain are set to palette index 0.
+void voxel_render( const img_t* maps_ptr, cam_t cam, float lod_step, img_t* fb_ptr );
+
+// builds a tiled map, with mips, from linear height and colour maps. returns false if the maps aren't square powers of two >= 8, or out of memory.
+bool voxel_map_from_img( const img_t* maps_ptr, voxel_map_t* map_ptr );
+
+void voxel_map_free( voxel_map_t* map_ptr );
+
+// as voxel_render(), from a tiled map. with mips false only level 0 is sampled, for the same image as voxel_render() from the same maps.
+void voxel_render_map( const voxel_map_t* map_ptr, cam_t cam, float lod_step, bool mips, img_t* fb_ptr );
+
+// writes fb's colour indices through its palette to a binary PPM.
+bool voxel_write_ppm( const char* fn, const img_t* img_ptr );
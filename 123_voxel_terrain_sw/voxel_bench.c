@@ -0,0 +1,87 @@
+/* Headless benchmark for the Voxel Space renderer: ms per frame from 320x200 up to 1920x1080, without GLFW.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L voxel_bench.c voxel.c -lm -pthread -o voxel_bench
+Run:
+  ./voxel_bench [n_frames] [-ppm]
+
+Renders n_frames (default 64) along a fixed camera path, a loop over map0, at each resolution in three modes: the original one-unit march
+on one thread, the same on every core, and with LOD_STEP distance-based step growth on every core. Reports the mean and worst ms per frame.
+With -ppm every frame of the last mode is also written to frame_<w>x<h>_<n>.ppm.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "voxel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOD_STEP 0.005f
+
+static const int _resolutions[][2] = { { 320, 200 }, { 640, 400 }, { 1280, 720 }, { 1920, 1080 } };
+
+// a loop around the map, flying at a fixed height over the terrain below.
+static cam_t _cam_on_path( const img_t* maps_ptr, int frame, int n_frames ) {
+  float t     = 2.0f * 3.141592f * frame / n_frames;
+  cam_t cam   = (cam_t){ .x = 512.0f + 300.0f * cosf( t ), .y = 512.0f + 300.0f * sinf( t ), .zfar = 1600.0f, .attitude = 60.0f };
+  cam.heading = t + 0.5f * 3.141592f;
+  cam.height  = maps_ptr->h_ptr[( (int)cam.y & ( maps_ptr->w - 1 ) ) * maps_ptr->w + ( (int)cam.x & ( maps_ptr->w - 1 ) )] + 60.0f;
+  return cam;
+}
+
+static bool _bench( const img_t* maps_ptr, const char* mode, float lod_step, int n_frames, bool write_frames ) {
+  for ( int r = 0; r < (int)( sizeof( _resolutions ) / sizeof( _resolutions[0] ) ); r++ ) {
+    img_t fb = (img_t){ .w = _resolutions[r][0], .h = _resolutions[r][1] };
+    fb.c_ptr = malloc( (size_t)fb.w * fb.h );
+    if ( !fb.c_ptr ) { return false; }
+    memcpy( fb.pal, maps_ptr->pal, sizeof( fb.pal ) );
+    double total_s = 0.0, worst_s = 0.0;
+    for ( int f = 0; f < n_frames; f++ ) {
+      cam_t cam = _cam_on_path( maps_ptr, f, n_frames );
+      double t0 = apg_time_s();
+      voxel_render( maps_ptr, cam, lod_step, &fb );
+      double frame_s = apg_time_s() - t0;
+      total_s += frame_s;
+      worst_s = APG_MAX( worst_s, frame_s );
+      if ( write_frames ) {
+        char fn[256];
+        snprintf( fn, sizeof( fn ), "frame_%ix%i_%04i.ppm", fb.w, fb.h, f );
+        if ( !voxel_write_ppm( fn, &fb ) ) { fprintf( stderr, "ERROR: writing `%s`\n", fn ); }
+      }
+    }
+    printf( "%-24s %4ix%-4i %7i %9.2f %9.2f %8.1f\n", mode, fb.w, fb.h, APG_MAX( apg_jobs_n_threads(), 1 ), total_s * 1000.0 / n_frames,
+      worst_s * 1000.0, n_frames / total_s );
+    free( fb.c_ptr );
+  }
+  return true;
+}
+
+int main( int argc, char** argv ) {
+  int n_frames      = 64;
+  bool write_frames = false;
+  for ( int i = 1; i < argc; i++ ) {
+    if ( 0 == strcmp( argv[i], "-ppm" ) ) {
+      write_frames = true;
+    } else {
+      n_frames = APG_MAX( atoi( argv[i] ), 1 );
+    }
+  }
+  apg_time_init();
+  img_t maps = read_cmap( "map0.color", "map0.palette", "map0.height" );
+
+  printf( "%i frames per run\n", n_frames );
+  printf( "%-24s %9s %7s %9s %9s %8s\n", "mode", "res", "threads", "mean ms", "worst ms", "fps" );
+  bool ok = _bench( &maps, "1 unit steps", 0.0f, n_frames, false ); // before apg_jobs_init(), so on this thread only
+  if ( !apg_jobs_init( 0 ) ) { return 1; }
+  ok = ok && _bench( &maps, "1 unit steps", 0.0f, n_frames, false );
+  ok = ok && _bench( &maps, "LOD steps", LOD_STEP, n_frames, write_frames );
+  apg_jobs_free();
+
+  free( maps.c_ptr );
+  free( maps.h_ptr );
+  return ok ? 0 : 1;
+}
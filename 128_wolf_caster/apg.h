@@ -0,0 +1,2772 @@
+/* apg.h  Author's generic C utility functions.
+Author:   Anton Gerdelan  antongerdelan.net
+Licence:  See bottom of this file.
+Language: C89 interface, C99 implementation.
+
+Version History and Copyright
+-----------------------------
+  1.19.0 - 19 Oct 2026. Read-only memory-mapped files.
+  1.18.0 - 19 Oct 2026. Work-stealing job system with counters and parallel-for.
+  1.17.0 - 19 Oct 2026. Arena, double-buffered frame, and pool allocators with debug guard and poison modes.
+  1.16.0 - 19 Oct 2026. Scoped CPU profiler with per-frame stats and Chrome trace export.
+  1.15.0 - 19 Oct 2026. Asynchronous logging mode with a lock-free ring buffer and a writer thread.
+  1.14.1 - 12 Jun 2025. Removed unsafe functions like ctime().
+  1.13.1 - 16 Feb 2023. Added comments to confusing part of rand() functions.
+  1.13.0 - 16 Feb 2023. Removed scratch mem functions.
+                        Added *_r thread-safe versions of rand() functions.
+                        Typedef for seed type in header.
+  1.12   - 24 Jan 2023. C/CPP header guard. CPP example.
+  1.11   - 11 Jan 2023. Fixed a crash bug when failing to read an entire file.
+  1.10   - xx Sep 2022. Cross-platform directory/filesystem functions.
+  1.9    - 10 Jun 2022. Large file support in file I/O.
+  1.8.1  - 28 Mar 2022. Casting precision fix to gbfs.
+  1.8    - 27 Mar 2022. Greedy BFS uses 64-bit integers (suited a project I used it in).
+  1.7    - 22 Mar 2022. Greedy BFS speed improvement using bsearch & memmove suffle.
+  1.6    - 13 Mar 2022. Greedy Best-First Search first implementation.
+  1.5    - 13 Mar 2022. Tidied MSVC build. Added a .bat file for building hash_test.c.
+  1.4    - 12 Mar 2022. Hash table functions.
+  1.3    - 11 Sep 2020. Fixed apg_file_to_str() portability issue.
+  1.2    - 15 May 2020. Updated timers for multi-platform use based on Professional Programming Tools book code. Updated test code.
+  1.1    -  4 May 2020. Added custom rand() functions.
+  1.0    -  8 May 2015. First version by Anton Gerdelan.
+
+Usage Instructions
+-----------------------------
+* Just copy-paste the snippets from this file that you want to use.
+* Or, to use all of it:
+  * In one file #define APG_IMPLEMENTATION above the #include.
+  * For backtraces on Windows you need to link against -limagehlp (MinGW/GCC), or /link imagehlp.lib (MSVC/cl.exe).
+    You can exclude this by:
+
+  #define APG_IMPLEMENTATION
+  #define APG_NO_BACKTRACES
+  #include apg.h
+
+* For a C++ example see tests/cpptest.cpp
+*/
+
+#ifndef _APG_H_
+#define _APG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define _FILE_OFFSET_BITS 64 /* Required for ftello on e.g. MinGW to use 8 bytes instead of 4. This can also be defined in a compile string/build file. */
+#include <stdbool.h>
+#include <stddef.h>   /* size_t */
+#include <stdint.h>   /* types */
+#include <stdio.h>    /* FILE* */
+#include <sys/stat.h> /* File sizes and details. */
+
+/*=================================================================================================
+COMPILER HELPERS
+=================================================================================================*/
+#ifdef _WIN64
+#define APG_BUILD_PLAT_STR "Microsoft Windows (64-bit)."
+#elif _WIN32
+#define APG_BUILD_PLAT_STR "Microsoft Windows (32-bit)."
+#elif __CYGWIN__ /* _WIN32 must not be defined */
+#define APG_BUILD_PLAT_STR "Cygwin POSIX under Microsoft Windows."
+#elif __linux__
+#define APG_BUILD_PLAT_STR "Linux."
+#elif __APPLE__ /* Can add checks to detect macOS/iPhone/XCode iPhone emulators. */
+#define APG_BUILD_PLAT_STR "Apple."
+#elif __unix__ /* Also valid for Linux. __APPLE__ is also BSD. */
+#define APG_BUILD_PLAT_STR "BSD."
+#else
+#define APG_BUILD_PLAT_STR "Unknown."
+#endif
+
+#define APG_UNUSED( x ) (void)( x ) /** To suppress compiler warnings. */
+
+/** To add function deprecation across compilers. */
+#ifdef __GNUC__
+#define APG_DEPRECATED( func ) func __attribute__( ( deprecated ) )
+#elif defined( _MSC_VER )
+#define APG_DEPRECATED( func ) __declspec( deprecated ) func
+#endif
+
+/*=================================================================================================
+MATHS
+=================================================================================================*/
+/** Replacements for the deprecated min/max functions from original C spec.
+was going to have a series of GL-like functions but it was a lot of fiddly code/alternatives,
+so I'm just copying from stb.h here. as much as I dislike pre-processor directives, this makes sense.
+I believe the trick is to have all the parentheses. same deal for clamp. */
+#define APG_MIN( a, b ) ( ( a ) < ( b ) ? ( a ) : ( b ) )
+#define APG_MAX( a, b ) ( ( a ) > ( b ) ? ( a ) : ( b ) )
+#define APG_CLAMP( x, lo, hi ) ( APG_MIN( hi, APG_MAX( lo, x ) ) )
+
+/*=================================================================================================
+PSEUDO-RANDOM NUMBERS
+=================================================================================================*/
+/** Platform-consistent rand() and srand().
+ * Based on http://www.open-std.org/jtc1/sc22/wg14/www/docs/n1256.pdf pg 312
+ */
+#define APG_RAND_MAX 32767            /* Must be at least 32767 (0x7fff). Windows uses this value. */
+typedef unsigned long int apg_rand_t; /* More precision is more better. If you need exact compatibility with stdlib.h then change to `unsigned int`. */
+
+/** A drop-in replacement for srand() that works with apg_rand() and apg_randf().
+ * It is not used by apg_rand_r() and apg_randf_r().
+ * Call this function once with a seed e.g. the current time in seconds. Then you may call apg_rand() or apg_randf() any number of times.
+ *
+ * @param seed The seeding integer can be the time, to feel more random.
+ * @warning    This function is not thread safe. For use in multi-threaded applications use `apg_rand_r()` instead.
+ */
+void apg_srand( apg_rand_t seed );
+
+/** A drop-in replacement for rand() that produces a consistent result on all platforms/implementations where rand() does not.
+ * Note that it has the same interface as rand() which means it has the same problems with thread-safety and precision.
+ *
+ * @warning This function is not thread safe. For use in multi-threaded applications use `apg_rand_r()` instead.
+ */
+int apg_rand( void );
+
+/** Same as apg_rand() except returns a value between 0.0 and 1.0. */
+float apg_randf( void );
+
+/** Useful to re-seed apg_srand() later with whatever the pseudo-random sequence is up to now e.g. for saved games. */
+apg_rand_t apg_get_srand_next( void );
+
+/** A thread-safe version of rand().
+ * This function is designed to be a mostly drop-in replacement for rand_r() from stdlib.h.
+ * No calls to apg_srand( seed ) are necessary.
+ *
+ * @param seed_ptr Address of a random number sequence that you have seeded at some point.
+ *
+ * @example
+ * apg_rand_t initial_seed = time( NULL );      // Equivalent to `srand( time( NULL ) );`.
+ * apg_rand_t working_seed = initial_seed;      // In case we want to remember the original sequence start.
+ * int random_result = rand_r( &working_seed ); // Equivalent to `rand();`
+ *
+ * @warning        rand_r() uses an unsigned int pointer, but we use slightly more precision here.
+ */
+int apg_rand_r( apg_rand_t* seed_ptr );
+
+/** Same as apg_rand_r() except returns a value between 0.0 and 1.0. */
+float apg_randf_r( apg_rand_t* seed_ptr );
+/*=================================================================================================
+TIME
+=================================================================================================*/
+/** Set up for using timers. */
+void apg_time_init( void );
+
+/** Get a monotonic time value in seconds with up to nanoseconds precision.
+ * Value is some arbitrary system time but is invulnerable to clock changes.
+ * Call apg_time_init() once before calling apg_time_s().
+ */
+double apg_time_s( void );
+
+/** NOTE: for linux -D_POSIX_C_SOURCE=199309L must be defined for glibc to get nanosleep(). */
+void apg_sleep_ms( int ms );
+
+/*=================================================================================================
+PROFILER
+Scoped CPU zones timed with apg_time_s(). Each thread records into its own ring buffer of events,
+so there is no locking on the hot path. Zones nest, up to APG_PROF_MAX_DEPTH deep.
+Define APG_PROFILER to turn the APG_PROF_*() macros on. Without it they compile away to nothing.
+
+Usage:
+  apg_time_init();
+  while ( running ) {
+    APG_PROF_BEGIN( "update" );
+    ...
+    APG_PROF_END();
+    APG_PROF_COUNTER( "n_chunks", n_chunks );
+    APG_PROF_FRAME_END();                         // Aggregate this frame's stats from all threads.
+  }
+  apg_prof_print_frame_stats( stdout );
+  apg_prof_write_chrome_trace( "trace.json" );    // Open in chrome://tracing or https://ui.perfetto.dev
+  apg_prof_free();
+
+A thread takes one of APG_PROF_MAX_THREADS slots on its first event, along with an APG_PROF_MAX_EVENTS ring of 32-byte events
+(8 MB at the defaults). Slots are never reclaimed when a thread exits, only by apg_prof_free(), so a program that keeps creating
+threads runs out: after the 64th thread, new threads record nothing. Lower APG_PROF_MAX_EVENTS if the memory matters.
+
+Define these before the #include to change the defaults:
+  APG_PROF_MAX_EVENTS  Events kept per thread before the oldest are overwritten. Default 262144.
+  APG_PROF_MAX_THREADS Threads that can ever record before apg_prof_free(). Default 64.
+  APG_PROF_MAX_ZONES   Distinct zone and counter names tracked in frame stats. Default 256.
+  APG_PROF_MAX_DEPTH   Default 32.
+=================================================================================================*/
+#ifdef APG_PROFILER
+#define APG_PROF_BEGIN( name ) apg_prof_begin( name )
+#define APG_PROF_END() apg_prof_end()
+#define APG_PROF_COUNTER( name, value ) apg_prof_counter( name, (double)( value ) )
+#define APG_PROF_FRAME_END() apg_prof_frame_end()
+#define APG_PROF_THREAD_NAME( name ) apg_prof_thread_name( name )
+#else
+#define APG_PROF_BEGIN( name ) ( (void)0 )
+#define APG_PROF_END() ( (void)0 )
+#define APG_PROF_COUNTER( name, value ) ( (void)0 )
+#define APG_PROF_FRAME_END() ( (void)0 )
+#define APG_PROF_THREAD_NAME( name ) ( (void)0 )
+#endif
+
+/** Per-zone or per-counter stats, aggregated over all threads by apg_prof_frame_end(). */
+typedef struct apg_prof_stat_t {
+  const char* name;
+  bool is_counter;
+  int depth;         /* Nesting depth the zone was last seen at. 0 is top-level. */
+  uint32_t calls;    /* Times the zone ended during the last frame. */
+  double ms;         /* Inclusive time spent in the zone during the last frame, summed over threads. */
+  double max_ms;     /* Longest single call during the last frame. */
+  double avg_ms;     /* Average of `ms` over every frame since the zone was first seen. */
+  double peak_ms;    /* Worst `ms` of any frame since the zone was first seen. */
+  double value;      /* Counters only. Most recent value. */
+  double frame_t0_s; /* Start time of the first call in the last frame. Used to sort stats into call order. */
+} apg_prof_stat_t;
+
+/** Start a timed zone on the calling thread.
+ * @param name Must point to memory that outlives the profiler, usually a string literal. Pointers are compared before strings.
+ */
+void apg_prof_begin( const char* name );
+
+/** End the most recently started zone on the calling thread. */
+void apg_prof_end( void );
+
+/** Record a named value, shown as a counter track in the trace. */
+void apg_prof_counter( const char* name, double value );
+
+/** Label the calling thread in the trace output. */
+void apg_prof_thread_name( const char* name );
+
+/** Mark the end of a frame. Call from one thread only, usually the main thread.
+ * Events from every thread since the previous call are aggregated into the per-frame stats.
+ */
+void apg_prof_frame_end( void );
+
+/** Copy the most recent frame's stats, sorted in call order.
+ * @return Number of stats written to stats_ptr.
+ */
+int apg_prof_frame_stats( apg_prof_stat_t* stats_ptr, int max_stats );
+
+/** Print the most recent frame's stats as an indented tree of zones. */
+void apg_prof_print_frame_stats( FILE* stream );
+
+/** Write the events currently held in every thread's buffer as Chrome trace_event JSON.
+ * @warning Other threads should not be recording events during this call.
+ * @return  false on file error.
+ */
+bool apg_prof_write_chrome_trace( const char* filename );
+
+/** Free all per-thread buffers and stats. Other threads must have stopped recording events. */
+void apg_prof_free( void );
+
+/*=================================================================================================
+STRINGS
+=================================================================================================*/
+/** Custom strcmp variant to do a partial match avoid commonly-made == 0 bracket soup bugs.
+ * @param a,b         Input strings to compare.
+ * @param a_max,b_max Maximum lengths of a and b, respectively. Makes function robust to missing nul-terminators.
+ * @return            true if both strings are the same, or if the shorter string matches its length up to the longer string at that point.
+ *                    i.e. "ANT" "ANTON" returns true.
+ */
+bool apg_strparmatch( const char* a, const char* b, size_t a_max, size_t b_max );
+
+/** Because string.h doesn't always have strnlen() */
+size_t apg_strnlen( const char* str, size_t maxlen );
+
+/** Custom strncat() without the annoying '\0' src truncation issues.
+ * Resulting string is always '\0' truncated.
+ * @param dst_max This is the maximum length, in bytes, the destination string is allowed to grow to.
+ * @param src_max  This is the maximum number of bytes to copy from the source string.
+ */
+void apg_strncat( char* dst, const char* src, const size_t dst_max, const size_t src_max );
+
+/*=================================================================================================
+FILES
+=================================================================================================*/
+/** These defines allow support of >2GB files on different platforms. Was not required on my Linux with GCC, but was on Windows with GCC on the same hardware. */
+#ifdef _MSC_VER /* This means "if MSVC" because we prefer POSIX stuff on MINGW. */
+#define apg_fseek _fseeki64
+#define apg_ftell _ftelli64
+#define apg_stat _stat64
+#define apg_stat_t __stat64
+#else
+#define apg_fseek fseeko
+#define apg_ftell ftello
+#define apg_stat stat
+#define apg_stat_t stat
+#endif
+
+/** Represents memory loaded from a file. */
+typedef struct apg_file_t {
+  void* data_ptr;
+  size_t sz; /* Size of memory pointed to by data_ptr in bytes. */
+} apg_file_t;
+
+typedef enum apg_dirent_type_t { APG_DIRENT_NONE, APG_DIRENT_FILE, APG_DIRENT_DIR, APG_DIRENT_OTHER } apg_dirent_type_t;
+
+/** A directory entry. */
+typedef struct apg_dirent_t {
+  apg_dirent_type_t type;
+  char* path;
+} apg_dirent_t;
+
+/** Check if a path is a valid file.
+ * @return
+ * False if path is not a file.
+ * False on any error.
+ * True if path was a file.
+ */
+bool apg_is_file( const char* path );
+
+/** Check if a path is a valid directory.
+ * @return false if path is not a directory.
+ *         false on any error.
+ *         true if path was a directory.
+ */
+bool apg_is_dir( const char* path );
+
+/** Get a file's size. Supports large (multi-GB) files.
+ * @return Size in bytes of file given by filename, or -1 on error.
+ */
+int64_t apg_file_size( const char* filename );
+
+/** Get a list of items in a directory, including file and directories.
+ *
+ * @param path_ptr
+ * A directory path to scan for contents.
+ *
+ * @param list_ptr
+ * The caller must provide an address to a contents pointer. This function
+ * will allocate memory for, and populate a list, that this parameter will
+ * be pointed to `apg_free_contents_list()`.
+ *
+ * @param n_list
+ * The caller must provide the address on an integer. The number of items
+ * populated in the list will be set here. This value must be retained by
+ * the called, unmodified, as it is used to free the string memory when
+ * passed to
+ *
+ * @return
+ * On success this function returns `true`.
+ * Basic errors, such as NULL parameters, or an invalid directory path will
+ * return `false`.
+ *
+ * @warning
+ * Symlinks and hard links may not be reported as such, and are most likely
+ * still reported as directory, and file types, respectively.
+ *
+ * @warning
+ * This function allocates memory for the the items in `list_ptr`, as well as
+ * strings inside each item. Call `apg_free_contents_list()` to free the
+ * allocated memory.
+ *
+ * @note
+ * Note that the file names of contents do not include `path`, so you will need
+ * to concatenate the full path in order to access the files. The internal
+ * function `_fix_dir_slashes()` may be useful here.
+ */
+bool apg_dir_contents( const char* path_ptr, apg_dirent_t** list_ptr, int* n_list );
+
+bool apg_free_contents_list( apg_dirent_t** list_ptr, int n_list );
+
+/** Reads an entire file into memory, unaltered. Supports large (multi-GB) files.
+ *
+ * @return
+ *   true on success. In this case record->data is allocated memory and must be freed by the caller.
+ *   false on any error. Any allocated memory is freed if false is returned.
+ *
+ * @warning If you are also writing very large files, be aware some platforms (Windows) will stall if fwrite()s are not split into <=2GB chunks.
+ */
+bool apg_read_entire_file( const char* filename, apg_file_t* record );
+
+/** Loads file_name's contents into a byte array and always ends with a NULL terminator.
+ * @param max_len Maximum bytes available to write into str_ptr.
+ * @return false on any error, and if the file size + 1 exceeds max_len bytes.
+ */
+bool apg_file_to_str( const char* file_name, int64_t max_len, char* str_ptr );
+
+/** Maps a whole file into memory, read-only, rather than copying it. Pages are read from disk as they are first touched.
+ * @return
+ *   true on success. In this case record->data_ptr points to the mapped file, and must be released with apg_file_unmap(), not free().
+ *   false on any error, including empty files, which can't be mapped.
+ * @warning The mapping is undefined if the file is truncated or changed by another process while mapped.
+ */
+bool apg_file_map( const char* filename, apg_file_t* record );
+
+/** Releases a mapping made by apg_file_map(), and zeroes record. */
+void apg_file_unmap( apg_file_t* record );
+
+/*=================================================================================================
+LOG FILES
+=================================================================================================*/
+/** Make bad log args print compiler warnings. Note: MinGW does not provide good support for this. */
+#if defined( __clang__ )
+#define ATTRIB_PRINTF( fmt, args ) __attribute__( ( __format__( __printf__, fmt, args ) ) )
+#elif defined( __MINGW32__ )
+#define ATTRIB_PRINTF( fmt, args ) __attribute__( ( format( ms_printf, fmt, args ) ) )
+#elif defined( __GNUC__ )
+#define ATTRIB_PRINTF( fmt, args ) __attribute__( ( format( printf, fmt, args ) ) )
+#else
+#define ATTRIB_PRINTF( fmt, args )
+#endif
+
+/** Open/refresh a new log file and print timestamp. */
+void apg_log_start( void );
+
+/** Write a log entry. */
+void apg_log( const char* message, ... ) ATTRIB_PRINTF( 1, 2 );
+
+/** Write a log entry and print to stderr. */
+void apg_log_err( const char* message, ... ) ATTRIB_PRINTF( 1, 2 );
+
+/** Asynchronous logging mode.
+ * By default apg_log() and apg_log_err() open, write, and close the log file on the calling thread.
+ * After apg_log_async_start() is called they instead format the message into a slot in a lock-free, multi-producer ring buffer, and return.
+ * A background thread keeps the log file open and writes batches of messages, including the stderr copy for apg_log_err().
+ * If apg_start_crash_handler() is used then any messages still in the buffer are written out by the crash handler before the backtrace.
+ *
+ * Define these before the #include to change the defaults:
+ *   APG_LOG_ASYNC_SLOTS   Number of message slots in the ring buffer. Must be a power of two. Default 4096.
+ *   APG_LOG_ASYNC_MSG_MAX Maximum bytes per message, including the nul terminator. Longer messages are truncated. Default 256.
+ *
+ * @return false if the background thread could not be created. Logging then stays synchronous.
+ * @note   Call apg_log_start() first if you want a fresh log file. An atexit() handler calls apg_log_async_stop() on normal exit.
+ * @note   If the buffer is full the calling thread yields until the writer has made space, so messages are never dropped.
+ */
+bool apg_log_async_start( void );
+
+/** Write any buffered messages, stop the writer thread, and return to synchronous logging. */
+void apg_log_async_stop( void );
+
+/** Block until every message logged before this call has been written to the log file. Does nothing in synchronous mode. */
+void apg_log_flush( void );
+
+/*=================================================================================================
+BACKTRACES AND DUMPS
+=================================================================================================*/
+/** Obtain a backtrace and print it to an open file stream or eg stdout
+note: to convert trace addresses into line numbers you can use gdb:
+(gdb) info line *print_trace+0x5e
+Line 92 of "src/utils.c" starts at address 0x6c745 <print_trace+74> and ends at 0x6c762 <print_trace+103>. */
+void apg_print_trace( FILE* stream );
+
+/** Writes a backtrace on sigsegv. */
+void apg_start_crash_handler( void );
+
+#ifdef APG_UNIT_TESTS
+void apg_deliberate_sigsegv( void );
+void apg_deliberate_divzero( void );
+#endif
+
+/*=================================================================================================
+COMMAND LINE PARAMETERS
+=================================================================================================*/
+/** I learned this trick from the Doom source code. */
+int apg_check_param( const char* check );
+
+extern int g_apg_argc;
+extern char** g_apg_argv;
+
+/*=================================================================================================
+MEMORY
+=================================================================================================*/
+
+/** NB. `ULL` postfix is necessary or numbers ~4GB will be interpreted as integer constants and overflow. */
+#define APG_KILOBYTES( value ) ( ( value ) * 1024ULL )
+#define APG_MEGABYTES( value ) ( APG_KILOBYTES( value ) * 1024ULL )
+#define APG_GIGABYTES( value ) ( APG_MEGABYTES( value ) * 1024ULL )
+
+/** Memory allocators for hot paths that would otherwise malloc()/free() per call.
+ *
+ *  apg_arena_t       Bump allocator over one block. Take a mark, allocate freely, then reset to the mark to release everything after it at once.
+ *  apg_frame_alloc_t Two arenas that swap every frame. Allocations stay valid until the end of the following frame, so this frame's
+ *                    scratch can still be read while the next frame is being built (e.g. by a GPU upload or a worker thread).
+ *  apg_pool_t        Fixed-size blocks with a free-list. O(1) alloc and dealloc in any order.
+ *
+ *  None of these are thread-safe. Give each thread its own.
+ *
+ *  Debug modes. Define before the #include with APG_IMPLEMENTATION:
+ *    APG_ALLOC_GUARDS  Each allocation gets a hidden header and a trailing guard band. Overruns are detected by apg_arena_check(),
+ *                      which is also run on every reset, and by apg_pool_dealloc(), which also catches double-frees.
+ *    APG_ALLOC_POISON  New memory is filled with 0xCD and released memory with 0xDD, so reads of uninitialised or stale data stand out.
+ *                      Pool blocks are checked on alloc to catch writes after dealloc.
+ *    APG_ALLOC_DEBUG   Turns on both.
+ */
+#define APG_ARENA_ALIGN 16 /* Default alignment of arena and pool allocations. */
+
+typedef struct apg_arena_t {
+  uint8_t* base_ptr;
+  size_t sz;        /* Capacity in bytes. */
+  size_t used;      /* Bytes allocated so far, including alignment padding and any debug guards. */
+  size_t peak;      /* Highest `used` has been. Useful for tuning `sz`. */
+  size_t last_hdr;  /* APG_ALLOC_GUARDS only. Offset of the most recent allocation's header. */
+  bool owns_memory; /* False if the memory was supplied by the user in apg_arena_init_from_mem(). */
+} apg_arena_t;
+
+/** A position in an arena to roll back to with apg_arena_reset_to_mark(). */
+typedef struct apg_arena_mark_t {
+  size_t used;
+  size_t last_hdr;
+} apg_arena_mark_t;
+
+/** Allocate `sz` bytes for the arena's backing memory.
+ * @return false on out of memory, in which case the arena is left empty.
+ */
+bool apg_arena_init( apg_arena_t* arena_ptr, size_t sz );
+
+/** Use memory owned by the caller, e.g. a static or stack buffer, as the arena's backing memory. It is not freed by apg_arena_free(). */
+void apg_arena_init_from_mem( apg_arena_t* arena_ptr, void* mem_ptr, size_t sz );
+
+void apg_arena_free( apg_arena_t* arena_ptr );
+
+/** @return Address of `sz` bytes aligned to APG_ARENA_ALIGN, or NULL if the arena doesn't have room. Memory is not zeroed. */
+void* apg_arena_alloc( apg_arena_t* arena_ptr, size_t sz );
+
+/** As apg_arena_alloc() but with a specific alignment, which must be a power of two. */
+void* apg_arena_alloc_aligned( apg_arena_t* arena_ptr, size_t sz, size_t align );
+
+/** As apg_arena_alloc() but zeroes the memory. */
+void* apg_arena_calloc( apg_arena_t* arena_ptr, size_t n, size_t sz );
+
+apg_arena_mark_t apg_arena_mark( const apg_arena_t* arena_ptr );
+
+/** Release every allocation made after `mark` was taken. */
+void apg_arena_reset_to_mark( apg_arena_t* arena_ptr, apg_arena_mark_t mark );
+
+/** Release every allocation. */
+void apg_arena_reset( apg_arena_t* arena_ptr );
+
+/** Check every allocation's guard band. Always returns true unless built with APG_ALLOC_GUARDS.
+ * @return false if any allocation has been overrun. Details of the first bad allocation are printed to stderr.
+ */
+bool apg_arena_check( const apg_arena_t* arena_ptr );
+
+typedef struct apg_frame_alloc_t {
+  apg_arena_t arenas[2];
+  int curr_idx;
+} apg_frame_alloc_t;
+
+/** @param sz_per_frame Bytes available to each frame. Twice this is allocated. */
+bool apg_frame_alloc_init( apg_frame_alloc_t* frame_ptr, size_t sz_per_frame );
+
+void apg_frame_alloc_free( apg_frame_alloc_t* frame_ptr );
+
+/** @return Scratch memory that stays valid until the end of the next frame, or NULL if this frame's arena is full. */
+void* apg_frame_alloc( apg_frame_alloc_t* frame_ptr, size_t sz );
+
+/** The current frame's arena, for functions that take an apg_arena_t*. Don't reset it yourself. */
+apg_arena_t* apg_frame_arena( apg_frame_alloc_t* frame_ptr );
+
+/** Call once per frame. Switches to the other arena and releases what was allocated in it two frames ago. */
+void apg_frame_alloc_swap( apg_frame_alloc_t* frame_ptr );
+
+typedef struct apg_pool_t {
+  uint8_t* base_ptr;
+  void* free_list_ptr;
+  uint8_t* in_use_ptr; /* APG_ALLOC_GUARDS only. One byte per block to catch double-frees. */
+  size_t block_sz;     /* Size requested per block. */
+  size_t stride;       /* Bytes between blocks, including alignment padding and guards. */
+  size_t n_blocks;
+  size_t n_used;
+} apg_pool_t;
+
+/** @return false on out of memory. */
+bool apg_pool_init( apg_pool_t* pool_ptr, size_t block_sz, size_t n_blocks );
+
+void apg_pool_free( apg_pool_t* pool_ptr );
+
+/** @return An APG_ARENA_ALIGN-aligned block of `block_sz` bytes, or NULL if every block is in use. Memory is not zeroed. */
+void* apg_pool_alloc( apg_pool_t* pool_ptr );
+
+/** Return a block to the pool. `block_ptr` may be NULL. */
+void apg_pool_dealloc( apg_pool_t* pool_ptr, void* block_ptr );
+
+/*=================================================================================================
+JOB SYSTEM
+=================================================================================================*/
+/** Work-stealing job scheduler for fine-grained, nested parallelism.
+ *
+ *  Each thread has its own lock-free deque (Chase-Lev). A thread pushes and pops jobs at the bottom of its own deque, so recently spawned, cache-warm
+ *  work runs first, and idle threads steal from the top of other threads' deques. Fork-join is done with counters: every job run with a counter
+ *  increments it, and decrements it when finished. apg_jobs_wait() runs other jobs until the counter reaches zero rather than blocking, so a job may
+ *  spawn and wait for sub-jobs without deadlocking the pool.
+ *
+ *  Jobs may only be run from the thread that called apg_jobs_init(), or from inside another job.
+ *  Each thread can have up to APG_JOBS_MAX_QUEUED jobs waiting. Beyond that, apg_jobs_run() runs the job immediately on the calling thread.
+ *
+ *  apg_job_counter_t done = { 0 };
+ *  for ( int i = 0; i < n_meshes; i++ ) { apg_jobs_run( gen_mesh_job, &meshes[i], &done ); }
+ *  apg_jobs_wait( &done );
+ */
+#ifndef APG_JOBS_MAX_QUEUED
+#define APG_JOBS_MAX_QUEUED 4096 /* Per-thread deque capacity. Must be a power of two. */
+#endif
+#define APG_JOBS_MAX_THREADS 64
+
+typedef void ( *apg_job_func_t )( void* arg_ptr );
+
+/** Called with a sub-range [begin, end) of the full range given to apg_jobs_parallel_for(). */
+typedef void ( *apg_job_range_func_t )( int64_t begin, int64_t end, void* arg_ptr );
+
+/** Zero-initialise before use. Only touch it through apg_jobs_*() functions. */
+typedef struct apg_job_counter_t {
+  int64_t n_pending;
+} apg_job_counter_t;
+
+/** Start the worker threads.
+ * @param n_threads Total threads doing work, including the calling thread, so 1 means run everything on the caller.
+ *                  0 means one per logical CPU. Clamped to APG_JOBS_MAX_THREADS.
+ * @return false if already initialised, or if threads couldn't be created.
+ */
+bool apg_jobs_init( int n_threads );
+
+/** Waits for the workers to finish any running jobs, then stops them. Jobs still queued are not run. */
+void apg_jobs_free( void );
+
+/** @return Total threads doing work, including the caller of apg_jobs_init(), or 0 if not initialised. */
+int apg_jobs_n_threads( void );
+
+/** @return Index of the calling thread in the job system, from 0 to apg_jobs_n_threads() - 1. 0 is the thread that called apg_jobs_init().
+ * Handy for indexing per-thread scratch memory. -1 if called from an unrelated thread.
+ */
+int apg_jobs_thread_idx( void );
+
+/** Queue a job. If `counter_ptr` is not NULL it is incremented now, and decremented when the job has finished. */
+void apg_jobs_run( apg_job_func_t func_ptr, void* arg_ptr, apg_job_counter_t* counter_ptr );
+
+/** Run other jobs until `counter_ptr` reaches zero. */
+void apg_jobs_wait( apg_job_counter_t* counter_ptr );
+
+/** Call `func_ptr` over sub-ranges covering [begin, end), in parallel, and wait for all of them.
+ * The range is split recursively in halves, each half becoming a job that can be stolen, until a piece is no larger than `grain`.
+ * @param grain Largest sub-range passed to `func_ptr`. Pick it so one call does a few microseconds of work or more. Must be >= 1.
+ */
+void apg_jobs_parallel_for( int64_t begin, int64_t end, int64_t grain, apg_job_range_func_t func_ptr, void* arg_ptr );
+
+/*=================================================================================================
+COMPRESSION
+=================================================================================================*/
+/** Apply run-length encoding to an array of bytes pointed to by bytes_in, over size in bytes given by sz_in.
+ * The result is written to bytes_out, with output size in bytes written to sz_out.
+ * @param bytes_in  If NULL then sz_out is set to 0.
+ * @param sz_in     If 0 then sz_out is set to 0.
+ * @param bytes_out If NULL then sz_out is reported, but no memory is written to. This is useful for determining the size required for output buffer allocation.
+ * @param sz_out    Must not be NULL.
+ */
+void apg_rle_compress( const uint8_t* bytes_in, size_t sz_in, uint8_t* bytes_out, size_t* sz_out );
+void apg_rle_decompress( const uint8_t* bytes_in, size_t sz_in, uint8_t* bytes_out, size_t* sz_out );
+
+/*=================================================================================================
+HASH TABLE
+Motivation:
+ - Avoid performance-disruptive run-time memory allocation, so it's linear probing rather than chained buckets. -> It Still needs to malloc() key strings though.
+ - Allow user to check collisions and hash table capacity so user can decide on a good initial table size based on their data.
+ - Minimal aux. memory overhead.
+ - Fast and simple.
+ - Allow user to determine when to rebuild the hash-table. There should never be surprise table reallocations at run-time!
+   To explicitly allow (constrained) resizing:
+   * After a key is stored with apg_hash_store(), run apg_hash_table_auto_resize( &my_table, max_bytes ).
+
+Potential improvements:
+ - If the user program reliably retains strings as well as values, we could avoid string memory allocation during hash_store calls, and just point to external.
+ - If I also stored the hash in apg_hash_table_element_t it would avoid many potentially lengthy strcmp() calls during search.
+ - String safety isn't checked at all. strndup and strncmp could be used if the user supplies a maximum string length.
+ - Could use quadratic probing instead of liner probing.
+ ================================================================================================*/
+
+typedef struct apg_hash_table_element_t {
+  char* keystr;    /* This is either an allocated ASCII string or an integer value. */
+  void* value_ptr; /* Address of value in user code. Value data is not allocated or stored directly in the table. If NULL then element is empty. */
+} apg_hash_table_element_t;
+
+typedef struct apg_hash_table_t {
+  apg_hash_table_element_t* list_ptr;
+  uint32_t n;
+  uint32_t count_stored;
+} apg_hash_table_t;
+
+/** Allocates memory for a hash table of size `table_n`.
+ * @param table_n For a well performing table use a number somewhat larger than required space.
+ * @return A generated, empty, hash table, or an empty table ( list_ptr == NULL ) on out of memory error.
+ */
+apg_hash_table_t apg_hash_table_create( uint32_t table_n );
+
+/** Free any memory allocated to the table, including allocated key string memory. */
+void apg_hash_table_free( apg_hash_table_t* table_ptr );
+
+/** Returns a hash for a key->table mapping.
+ * Be sure to compute hash_index = hash % table_N after calling this function.
+ */
+uint32_t apg_hash( const char* keystr );
+
+/** A second hash function, using djb2 (based on http://www.cse.yorku.ca/~oz/hash.html),
+ * This is used by store and search functions on first collision for a double-hashing approach.
+ */
+uint32_t apg_hash_rehash( const char* keystr );
+
+/** Store a key-value pair in a given hash table.
+ * @param keystr        A null-terminated C string. Must not be NULL.
+ * @param value_ptr     Address of external memory to point to. Must not be NULL.
+ * @param table_ptr     Address of a hash table previously allocated with a call to apg_hash_table_create().
+ * @param collision_ptr Optional argument. If non-NULL, then the integer pointed to is set to the number of collisions incurred by this function call.
+ *                      In cases where the function returns false then the collision counter is not incremented.
+ * @return              This function returns true on success. It returns false in cases where the table is full,
+ *                      the key was already stored in the table, or the parameters are invalid.
+ */
+bool apg_hash_store( const char* keystr, void* value_ptr, apg_hash_table_t* table_ptr, uint32_t* collision_ptr );
+
+/**
+ * @return This function returns true if the key is found in the table. In this case the integer pointed to by `idx_ptr` is set to the corresponding table
+ * index. This function returns false if the table is empty, the parameters are invalid, or the key is not stored in the table.
+ */
+bool apg_hash_search( const char* keystr, apg_hash_table_t* table_ptr, uint32_t* idx_ptr, uint32_t* collision_ptr );
+
+/** Expand when hash table when >= 50% full, and double its size if so, but don't allocate a table of more than `max_bytes`.
+ *  This function could be improved in performance (at expense of brevity) by manually writing out apg_hash_store() and excluding string allocations.
+ *  This function could be upgraded into _auto_resize() which also scales down on e.g. < 25% load.
+ */
+bool apg_hash_auto_expand( apg_hash_table_t* table_ptr, size_t max_bytes );
+
+/*=================================================================================================
+GREEDY BEST-FIRST SEARCH
+=================================================================================================*/
+
+/** If a node can have more than 6 neighbours change this value to set the size of the array of neighbour keys. */
+#define APG_GBFS_NEIGHBOURS_MAX 6
+
+/** Aux. memory retained to represent a 'vertex' in the search graph. */
+typedef struct apg_gbfs_node_t {
+  int64_t parent_idx; /* Index of parent in the evaluated_nodes list. */
+  int64_t our_key;    /* Identifying key of the original node (e.g. a tile or pixel index in an array). */
+  int64_t h;          /* Distance to goal. */
+} apg_gbfs_node_t;
+
+/** Greedy best-first search.
+ * This function was designed so that no heap memory is allocated. It has some stack memory limits but that's usually fine for real-time applications.
+ * It will return false if these limits are reached for big mazes. It could be modified to use or realloc() heap memory to solve for these cases.
+ * I usually use an index or a handles as unique O(1) look-up for graph nodes/voxels/etc. But these could also have been pointers/addresses.
+ *
+ * @param start_key,target_key  The user provides initial 2 node/vertex keys, expressed as integers
+ * @param h_cb_ptr()            User-defined function to return a distance heuristic, h, for a key.
+ * @param neighs_cb_ptr()       User-defined function to pass an array of up to 6 (for now) neighbours' keys.
+ *                              It should return the count of keys in the array.
+ * @param reverse_path_ptr      Pointer to a user-created array of size `max_path_steps`.
+ *                              On success the function will write the reversed path of keys into this array.
+ * @param path_n                The number of steps in reverse_path_ptr is written to the integer at address `path_n`.
+ * @param evaluated_nodes_ptr   User-allocated array of working memory used. Size in bytes is sizeof(apg_gbfs_node_t) * evaluated_nodes_max.
+ * @param evaluated_nodes_max   Count of `apg_gbfs_node_t`s allocated to evaluated_nodes_ptr. Worst case - bounds of search domain.
+ * @param visited_set_ptr       User-allocated array of working memory used. Size in bytes is sizeof(int) * visited_set_max.
+ * @param visited_set_max       Count of `int`s allocated to evaluated_nodes_ptr. Worst case - bounds of search domain.
+ * @param queue_ptr             User-allocated array of working memory used. Size in bytes is sizeof(apg_gbfs_node_t) * queue_max.
+ * @param queue_max             Count of `apg_gbfs_node_t`s allocated to evaluated_nodes_ptr. Worst case - bounds of search domain.
+ * @return                      If a path is found the function returns `true`.
+ *                              If no path is found, or there was an error, such as array overflow, then the function returns `false`.
+ *
+ * @note I let the user supply the working sets (queue, evaluated, and visited set) memory. This allows bigger searches than using small stack arrays,
+ * and can avoid syscalls. Repeated searches can reuse any allocated memory.
+ */
+bool apg_gbfs( int64_t start_key, int64_t target_key, int64_t ( *h_cb_ptr )( int64_t key, int64_t target_key ),
+  int64_t ( *neighs_cb_ptr )( int64_t key, int64_t target_key, int64_t* neighs ), int64_t* reverse_path_ptr, int64_t* path_n, int64_t max_path_steps,
+  apg_gbfs_node_t* evaluated_nodes_ptr, int64_t evaluated_nodes_max, int64_t* visited_set_ptr, int64_t visited_set_max, apg_gbfs_node_t* queue_ptr, int64_t queue_max );
+
+/*=================================================================================================
+------------------------------------------IMPLEMENTATION------------------------------------------
+=================================================================================================*/
+#ifdef APG_IMPLEMENTATION
+#undef APG_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>   /* modff() */
+#include <signal.h> /* For crash handling. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h> /* For backtraces and timers. */
+#ifndef APG_NO_BACKTRACES
+#include <dbghelp.h> /* SymInitialize */
+#endif
+#else
+#include <execinfo.h>
+#include <pthread.h> /* For the async log writer thread and job system. */
+#include <sched.h>   /* sched_yield() */
+#include <strings.h> /* For strcasecmp. */
+#include <unistd.h>  /* Linux-only? */
+#endif
+/* includes for timers */
+#ifdef _WIN32
+#include <profileapi.h>
+#elif __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <sys/time.h>
+#endif
+/* Fix used in bgfx and imgui to get around mingw not supplying alloca.h. */
+#if defined( _MSC_VER ) || defined( __MINGW32__ )
+#include <malloc.h>
+#else
+#include <alloca.h>
+#endif
+#ifdef _MSC_VER
+/* not #if defined(_WIN32) || defined(_WIN64) because we have strncasecmp in MinGW. */
+#define strncasecmp _strnicmp
+#define strcasecmp _stricmp
+#define strdup _strdup
+#endif
+
+/*=================================================================================================
+INTERNAL THREAD AND ATOMIC HELPERS
+=================================================================================================*/
+/* Just enough of a portable wrapper for the threads used in here. GCC/Clang builtins, or Interlocked*() on MSVC. */
+#ifdef _MSC_VER
+typedef volatile LONG64 _apg_atomic_t;
+#define _apg_atomic_load( ptr ) InterlockedCompareExchange64( ( ptr ), 0, 0 )
+#define _apg_atomic_store( ptr, val ) InterlockedExchange64( ( ptr ), ( val ) )
+#define _apg_atomic_add( ptr, val ) InterlockedExchangeAdd64( ( ptr ), ( val ) )
+#define _apg_atomic_load_ptr( ptr ) InterlockedCompareExchangePointer( (PVOID volatile*)( ptr ), NULL, NULL )
+#define _apg_atomic_store_ptr( ptr, val ) InterlockedExchangePointer( (PVOID volatile*)( ptr ), ( val ) )
+static bool _apg_atomic_cas( _apg_atomic_t* ptr, int64_t expected, int64_t desired ) { return InterlockedCompareExchange64( ptr, desired, expected ) == expected; }
+#define _apg_atomic_fence() MemoryBarrier()
+#define _APG_THREAD_LOCAL __declspec( thread )
+#else
+typedef int64_t _apg_atomic_t;
+#define _apg_atomic_load( ptr ) __atomic_load_n( ( ptr ), __ATOMIC_ACQUIRE )
+#define _apg_atomic_store( ptr, val ) __atomic_store_n( ( ptr ), ( val ), __ATOMIC_RELEASE )
+#define _apg_atomic_add( ptr, val ) __atomic_fetch_add( ( ptr ), ( val ), __ATOMIC_ACQ_REL )
+#define _apg_atomic_load_ptr( ptr ) __atomic_load_n( ( ptr ), __ATOMIC_ACQUIRE )
+#define _apg_atomic_store_ptr( ptr, val ) __atomic_store_n( ( ptr ), ( val ), __ATOMIC_RELEASE )
+static bool _apg_atomic_cas( _apg_atomic_t* ptr, int64_t expected, int64_t desired ) {
+  return __atomic_compare_exchange_n( ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE );
+}
+#define _apg_atomic_fence() __atomic_thread_fence( __ATOMIC_SEQ_CST ) /* Full barrier, for store-then-load orderings that acquire/release can't give. */
+#define _APG_THREAD_LOCAL __thread
+#endif
+
+#ifdef _WIN32
+typedef HANDLE _apg_thread_t;
+#define _APG_THREAD_FUNC( name ) static DWORD WINAPI name( LPVOID arg_ptr )
+#define _APG_THREAD_RETURN return 0
+static bool _apg_thread_create( _apg_thread_t* thread_ptr, LPTHREAD_START_ROUTINE func_ptr, void* arg_ptr ) {
+  *thread_ptr = CreateThread( NULL, 0, func_ptr, arg_ptr, 0, NULL );
+  return NULL != *thread_ptr;
+}
+static void _apg_thread_join( _apg_thread_t thread ) {
+  WaitForSingleObject( thread, INFINITE );
+  CloseHandle( thread );
+}
+static void _apg_thread_yield( void ) { SwitchToThread(); }
+typedef CRITICAL_SECTION _apg_mutex_t;
+typedef CONDITION_VARIABLE _apg_cond_t;
+static void _apg_mutex_init( _apg_mutex_t* mutex_ptr ) { InitializeCriticalSection( mutex_ptr ); }
+static void _apg_mutex_destroy( _apg_mutex_t* mutex_ptr ) { DeleteCriticalSection( mutex_ptr ); }
+static void _apg_mutex_lock( _apg_mutex_t* mutex_ptr ) { EnterCriticalSection( mutex_ptr ); }
+static void _apg_mutex_unlock( _apg_mutex_t* mutex_ptr ) { LeaveCriticalSection( mutex_ptr ); }
+static void _apg_cond_init( _apg_cond_t* cond_ptr ) { InitializeConditionVariable( cond_ptr ); }
+static void _apg_cond_destroy( _apg_cond_t* cond_ptr ) { APG_UNUSED( cond_ptr ); }
+static void _apg_cond_wait( _apg_cond_t* cond_ptr, _apg_mutex_t* mutex_ptr ) { SleepConditionVariableCS( cond_ptr, mutex_ptr, INFINITE ); }
+static void _apg_cond_signal( _apg_cond_t* cond_ptr ) { WakeConditionVariable( cond_ptr ); }
+static void _apg_cond_broadcast( _apg_cond_t* cond_ptr ) { WakeAllConditionVariable( cond_ptr ); }
+static int _apg_n_logical_cpus( void ) {
+  SYSTEM_INFO info;
+  GetSystemInfo( &info );
+  return (int)info.dwNumberOfProcessors;
+}
+#else
+typedef pthread_t _apg_thread_t;
+#define _APG_THREAD_FUNC( name ) static void* name( void* arg_ptr )
+#define _APG_THREAD_RETURN return NULL
+static bool _apg_thread_create( _apg_thread_t* thread_ptr, void* ( *func_ptr )( void* ), void* arg_ptr ) {
+  return 0 == pthread_create( thread_ptr, NULL, func_ptr, arg_ptr );
+}
+static void _apg_thread_join( _apg_thread_t thread ) { pthread_join( thread, NULL ); }
+static void _apg_thread_yield( void ) { sched_yield(); }
+typedef pthread_mutex_t _apg_mutex_t;
+typedef pthread_cond_t _apg_cond_t;
+static void _apg_mutex_init( _apg_mutex_t* mutex_ptr ) { pthread_mutex_init( mutex_ptr, NULL ); }
+static void _apg_mutex_destroy( _apg_mutex_t* mutex_ptr ) { pthread_mutex_destroy( mutex_ptr ); }
+static void _apg_mutex_lock( _apg_mutex_t* mutex_ptr ) { pthread_mutex_lock( mutex_ptr ); }
+static void _apg_mutex_unlock( _apg_mutex_t* mutex_ptr ) { pthread_mutex_unlock( mutex_ptr ); }
+static void _apg_cond_init( _apg_cond_t* cond_ptr ) { pthread_cond_init( cond_ptr, NULL ); }
+static void _apg_cond_destroy( _apg_cond_t* cond_ptr ) { pthread_cond_destroy( cond_ptr ); }
+static void _apg_cond_wait( _apg_cond_t* cond_ptr, _apg_mutex_t* mutex_ptr ) { pthread_cond_wait( cond_ptr, mutex_ptr ); }
+static void _apg_cond_signal( _apg_cond_t* cond_ptr ) { pthread_cond_signal( cond_ptr ); }
+static void _apg_cond_broadcast( _apg_cond_t* cond_ptr ) { pthread_cond_broadcast( cond_ptr ); }
+static int _apg_n_logical_cpus( void ) {
+  long n = sysconf( _SC_NPROCESSORS_ONLN );
+  return n > 0 ? (int)n : 1;
+}
+#endif
+
+/*=================================================================================================
+PSEUDO-RANDOM NUMBERS IMPLEMENTATION
+=================================================================================================*/
+static apg_rand_t _srand_next = 1;
+
+void apg_srand( apg_rand_t seed ) { _srand_next = seed; }
+
+int apg_rand( void ) {
+  _srand_next = _srand_next * 1103515245 + 12345;
+  // NB: casting to uint is deliberate here, otherwise we will return negative numbers.
+  return (unsigned int)( _srand_next / ( ( APG_RAND_MAX + 1 ) * 2 ) ) % ( APG_RAND_MAX + 1 );
+}
+
+float apg_randf( void ) { return (float)apg_rand() / (float)APG_RAND_MAX; }
+
+apg_rand_t apg_get_srand_next( void ) { return _srand_next; }
+
+int apg_rand_r( apg_rand_t* seed_ptr ) {
+  assert( seed_ptr );
+  if ( !seed_ptr ) { return 0; }
+  *seed_ptr = *seed_ptr * 1103515245 + 12345;
+  // NB: casting to uint is deliberate here, otherwise we will return negative numbers.
+  return (unsigned int)( *seed_ptr / ( ( APG_RAND_MAX + 1 ) * 2 ) ) % ( APG_RAND_MAX + 1 );
+}
+
+float apg_randf_r( apg_rand_t* seed_ptr ) {
+  assert( seed_ptr );
+  if ( !seed_ptr ) { return 0.0f; }
+  return (float)apg_rand_r( seed_ptr ) / (float)APG_RAND_MAX;
+}
+
+/*=================================================================================================
+TIME IMPLEMENTATION
+=================================================================================================*/
+static uint64_t _frequency = 1000000, _offset;
+
+void apg_time_init( void ) {
+#ifdef _WIN32
+  _frequency = 1000; /* QueryPerformanceCounter default. */
+  QueryPerformanceFrequency( (LARGE_INTEGER*)&_frequency );
+  QueryPerformanceCounter( (LARGE_INTEGER*)&_offset );
+#elif __APPLE__
+  mach_timebase_info_data_t info;
+  mach_timebase_info( &info );
+  _frequency = ( info.denom * 1e9 ) / info.numer;
+  _offset    = mach_absolute_time();
+#else
+  _frequency = 1000000000; /* Nanoseconds. */
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  _offset = (uint64_t)ts.tv_sec * (uint64_t)_frequency + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+double apg_time_s( void ) {
+#ifdef _WIN32
+  uint64_t counter = 0;
+  QueryPerformanceCounter( (LARGE_INTEGER*)&counter );
+  return (double)( counter - _offset ) / _frequency;
+#elif __APPLE__
+  uint64_t counter = mach_absolute_time();
+  return (double)( counter - _offset ) / _frequency;
+#else
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  uint64_t counter = (uint64_t)ts.tv_sec * (uint64_t)_frequency + (uint64_t)ts.tv_nsec;
+  return (double)( counter - _offset ) / _frequency;
+#endif
+}
+
+/* NOTE: for linux -D_POSIX_C_SOURCE=199309L must be defined for glibc to get nanosleep() */
+void apg_sleep_ms( int ms ) {
+#ifdef _WIN32
+  Sleep( ms ); /* May not need this since using GCC on Windows and usleep() works. */
+#elif _POSIX_C_SOURCE >= 199309L
+  struct timespec ts;
+  ts.tv_sec  = ms / 1000;
+  ts.tv_nsec = ( ms % 1000 ) * 1000000;
+  nanosleep( &ts, NULL );
+#else
+  usleep( ms * 1000 );
+#endif
+}
+
+/*=================================================================================================
+PROFILER IMPLEMENTATION
+=================================================================================================*/
+#ifndef APG_PROF_MAX_EVENTS
+#define APG_PROF_MAX_EVENTS 262144
+#endif
+#ifndef APG_PROF_MAX_THREADS
+#define APG_PROF_MAX_THREADS 64
+#endif
+#ifndef APG_PROF_MAX_ZONES
+#define APG_PROF_MAX_ZONES 256
+#endif
+#ifndef APG_PROF_MAX_DEPTH
+#define APG_PROF_MAX_DEPTH 32
+#endif
+
+typedef enum _apg_prof_event_type_t { _APG_PROF_ZONE, _APG_PROF_COUNTER, _APG_PROF_FRAME } _apg_prof_event_type_t;
+
+/* Zones are recorded when they end, so a child always appears in the buffer before its parent. */
+typedef struct _apg_prof_event_t {
+  const char* name;
+  double t0_s;
+  double x; /* End time in seconds for zones, or the value for counters. */
+  int32_t depth;
+  int32_t type;
+} _apg_prof_event_t;
+
+typedef struct _apg_prof_thread_t {
+  _apg_prof_event_t* events_ptr;
+  _apg_atomic_t n_written; /* Monotonic count of events recorded. Event i lives in slot i % APG_PROF_MAX_EVENTS. */
+  int64_t n_read;          /* Aggregation cursor. Only touched by apg_prof_frame_end(). */
+  int tid;
+  int depth;
+  const char* stack_names[APG_PROF_MAX_DEPTH];
+  double stack_t0_s[APG_PROF_MAX_DEPTH];
+  char name[32];
+} _apg_prof_thread_t;
+
+static _apg_prof_thread_t* _prof_threads[APG_PROF_MAX_THREADS]; /* Published with a release store once the buffer is set up. Read with acquire. */
+static _apg_atomic_t _prof_n_threads;
+static _APG_THREAD_LOCAL _apg_prof_thread_t* _prof_tls;
+static apg_prof_stat_t _prof_stats[APG_PROF_MAX_ZONES];
+static double _prof_stats_total_ms[APG_PROF_MAX_ZONES];
+static int64_t _prof_stats_first_frame[APG_PROF_MAX_ZONES];
+static int _prof_n_stats;
+static int64_t _prof_n_frames;
+static double _prof_frame_t0_s, _prof_frame_ms;
+
+/* Lazily create the calling thread's buffer. Returns NULL if out of thread slots or memory. */
+static _apg_prof_thread_t* _apg_prof_thread( void ) {
+  if ( _prof_tls ) { return _prof_tls; }
+  int64_t idx = _apg_atomic_add( &_prof_n_threads, 1 );
+  if ( idx >= APG_PROF_MAX_THREADS ) { return NULL; }
+  _apg_prof_thread_t* thread_ptr = calloc( 1, sizeof( _apg_prof_thread_t ) );
+  if ( !thread_ptr ) { return NULL; }
+  thread_ptr->events_ptr = malloc( sizeof( _apg_prof_event_t ) * APG_PROF_MAX_EVENTS );
+  if ( !thread_ptr->events_ptr ) {
+    free( thread_ptr );
+    return NULL;
+  }
+  thread_ptr->tid = (int)idx;
+  snprintf( thread_ptr->name, sizeof( thread_ptr->name ), "thread %i", (int)idx );
+  _apg_atomic_store_ptr( &_prof_threads[idx], thread_ptr ); /* The slot stays NULL, and readers skip it, until this is visible. */
+  _prof_tls = thread_ptr;
+  return thread_ptr;
+}
+
+static void _apg_prof_record( _apg_prof_thread_t* thread_ptr, _apg_prof_event_t event ) {
+  int64_t n                                       = thread_ptr->n_written;
+  thread_ptr->events_ptr[n % APG_PROF_MAX_EVENTS] = event;
+  _apg_atomic_store( &thread_ptr->n_written, n + 1 ); /* Publish to the aggregating thread. */
+}
+
+void apg_prof_begin( const char* name ) {
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( !thread_ptr ) { return; }
+  if ( thread_ptr->depth < APG_PROF_MAX_DEPTH ) {
+    thread_ptr->stack_names[thread_ptr->depth] = name;
+    thread_ptr->stack_t0_s[thread_ptr->depth]  = apg_time_s();
+  }
+  thread_ptr->depth++; /* Still counted past the max so begin/end stay paired. */
+}
+
+void apg_prof_end( void ) {
+  double t1_s                    = apg_time_s();
+  _apg_prof_thread_t* thread_ptr = _prof_tls;
+  if ( !thread_ptr || thread_ptr->depth <= 0 ) { return; }
+  int depth = --thread_ptr->depth;
+  if ( depth >= APG_PROF_MAX_DEPTH ) { return; }
+  _apg_prof_record( thread_ptr, ( _apg_prof_event_t ){
+                                  .name = thread_ptr->stack_names[depth], .t0_s = thread_ptr->stack_t0_s[depth], .x = t1_s, .depth = depth, .type = _APG_PROF_ZONE } );
+}
+
+void apg_prof_counter( const char* name, double value ) {
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( !thread_ptr ) { return; }
+  _apg_prof_record( thread_ptr, ( _apg_prof_event_t ){ .name = name, .t0_s = apg_time_s(), .x = value, .depth = thread_ptr->depth, .type = _APG_PROF_COUNTER } );
+}
+
+void apg_prof_thread_name( const char* name ) {
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( !thread_ptr || !name ) { return; }
+  thread_ptr->name[0] = '\0';
+  apg_strncat( thread_ptr->name, name, sizeof( thread_ptr->name ) - 1, sizeof( thread_ptr->name ) - 1 );
+}
+
+static apg_prof_stat_t* _apg_prof_find_stat( const char* name, bool is_counter ) {
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    if ( _prof_stats[i].name == name && _prof_stats[i].is_counter == is_counter ) { return &_prof_stats[i]; }
+  }
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    if ( _prof_stats[i].is_counter == is_counter && 0 == strcmp( _prof_stats[i].name, name ) ) { return &_prof_stats[i]; }
+  }
+  if ( _prof_n_stats >= APG_PROF_MAX_ZONES ) { return NULL; }
+  _prof_stats_total_ms[_prof_n_stats]    = 0.0;
+  _prof_stats_first_frame[_prof_n_stats] = _prof_n_frames;
+  _prof_stats[_prof_n_stats]             = ( apg_prof_stat_t ){ .name = name, .is_counter = is_counter };
+  return &_prof_stats[_prof_n_stats++];
+}
+
+void apg_prof_frame_end( void ) {
+  double t_s = apg_time_s();
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    _prof_stats[i].calls  = 0;
+    _prof_stats[i].ms     = 0.0;
+    _prof_stats[i].max_ms = 0.0;
+  }
+
+  int64_t n_threads = APG_MIN( _apg_atomic_load( &_prof_n_threads ), APG_PROF_MAX_THREADS );
+  for ( int64_t t = 0; t < n_threads; t++ ) {
+    _apg_prof_thread_t* thread_ptr = _apg_atomic_load_ptr( &_prof_threads[t] );
+    if ( !thread_ptr ) { continue; }
+    int64_t n_written = _apg_atomic_load( &thread_ptr->n_written );
+    if ( n_written - thread_ptr->n_read > APG_PROF_MAX_EVENTS ) { thread_ptr->n_read = n_written - APG_PROF_MAX_EVENTS; } /* Lapped - oldest were overwritten. */
+    for ( int64_t i = thread_ptr->n_read; i < n_written; i++ ) {
+      const _apg_prof_event_t* e_ptr = &thread_ptr->events_ptr[i % APG_PROF_MAX_EVENTS];
+      if ( _APG_PROF_FRAME == e_ptr->type ) { continue; }
+      apg_prof_stat_t* stat_ptr = _apg_prof_find_stat( e_ptr->name, _APG_PROF_COUNTER == e_ptr->type );
+      if ( !stat_ptr ) { continue; }
+      if ( 0 == stat_ptr->calls || e_ptr->t0_s < stat_ptr->frame_t0_s ) { stat_ptr->frame_t0_s = e_ptr->t0_s; }
+      stat_ptr->calls++;
+      stat_ptr->depth = e_ptr->depth;
+      if ( _APG_PROF_COUNTER == e_ptr->type ) {
+        stat_ptr->value = e_ptr->x;
+      } else {
+        double ms = ( e_ptr->x - e_ptr->t0_s ) * 1000.0;
+        stat_ptr->ms += ms;
+        stat_ptr->max_ms = APG_MAX( stat_ptr->max_ms, ms );
+      }
+    }
+    thread_ptr->n_read = n_written;
+  }
+
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    _prof_stats_total_ms[i] += _prof_stats[i].ms;
+    _prof_stats[i].avg_ms  = _prof_stats_total_ms[i] / (double)( _prof_n_frames - _prof_stats_first_frame[i] + 1 );
+    _prof_stats[i].peak_ms = APG_MAX( _prof_stats[i].peak_ms, _prof_stats[i].ms );
+  }
+
+  /* Record the frame itself so it shows up as a parent span in the trace. The first call only starts the clock. */
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( thread_ptr && _prof_n_frames > 0 ) {
+    _apg_prof_record( thread_ptr, ( _apg_prof_event_t ){ .name = "frame", .t0_s = _prof_frame_t0_s, .x = t_s, .depth = -1, .type = _APG_PROF_FRAME } );
+  }
+  _prof_frame_ms   = ( t_s - _prof_frame_t0_s ) * 1000.0;
+  _prof_frame_t0_s = t_s;
+  _prof_n_frames++;
+}
+
+static int _apg_prof_stat_cmp( const void* a, const void* b ) {
+  const apg_prof_stat_t* a_ptr = (const apg_prof_stat_t*)a;
+  const apg_prof_stat_t* b_ptr = (const apg_prof_stat_t*)b;
+  if ( a_ptr->frame_t0_s != b_ptr->frame_t0_s ) { return a_ptr->frame_t0_s < b_ptr->frame_t0_s ? -1 : 1; }
+  return a_ptr->depth - b_ptr->depth; /* Parent and child that started on the same tick. */
+}
+
+int apg_prof_frame_stats( apg_prof_stat_t* stats_ptr, int max_stats ) {
+  if ( !stats_ptr || max_stats <= 0 ) { return 0; }
+  int n = 0;
+  for ( int i = 0; i < _prof_n_stats && n < max_stats; i++ ) {
+    if ( _prof_stats[i].calls > 0 ) { stats_ptr[n++] = _prof_stats[i]; }
+  }
+  qsort( stats_ptr, n, sizeof( apg_prof_stat_t ), _apg_prof_stat_cmp );
+  return n;
+}
+
+void apg_prof_print_frame_stats( FILE* stream ) {
+  apg_prof_stat_t stats[APG_PROF_MAX_ZONES];
+  int n = apg_prof_frame_stats( stats, APG_PROF_MAX_ZONES );
+  fprintf( stream, "frame %lli: %.3f ms\n", (long long)_prof_n_frames, _prof_frame_ms );
+  for ( int i = 0; i < n; i++ ) {
+    int indent = 2 + 2 * APG_CLAMP( stats[i].depth, 0, 16 );
+    if ( stats[i].is_counter ) {
+      fprintf( stream, "%*s%-*s = %g\n", indent, "", 40 - indent, stats[i].name, stats[i].value );
+    } else {
+      fprintf( stream, "%*s%-*s %9.3f ms  x%-5u max %8.3f  avg %8.3f  peak %8.3f\n", indent, "", 40 - indent, stats[i].name, stats[i].ms, stats[i].calls,
+        stats[i].max_ms, stats[i].avg_ms, stats[i].peak_ms );
+    }
+  }
+}
+
+static void _apg_prof_write_json_str( FILE* f_ptr, const char* str ) {
+  fputc( '"', f_ptr );
+  for ( const char* c = str; c && *c; c++ ) {
+    if ( '"' == *c || '\\' == *c ) { fputc( '\\', f_ptr ); }
+    if ( (unsigned char)*c >= 0x20 ) { fputc( *c, f_ptr ); }
+  }
+  fputc( '"', f_ptr );
+}
+
+bool apg_prof_write_chrome_trace( const char* filename ) {
+  if ( !filename ) { return false; }
+  FILE* f_ptr = fopen( filename, "w" );
+  if ( !f_ptr ) { return false; }
+
+  fprintf( f_ptr, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+  bool first        = true;
+  int64_t n_threads = APG_MIN( _apg_atomic_load( &_prof_n_threads ), APG_PROF_MAX_THREADS );
+  for ( int64_t t = 0; t < n_threads; t++ ) {
+    _apg_prof_thread_t* thread_ptr = _apg_atomic_load_ptr( &_prof_threads[t] );
+    if ( !thread_ptr ) { continue; }
+    fprintf( f_ptr, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%i,\"args\":{\"name\":", first ? "" : ",\n", thread_ptr->tid );
+    _apg_prof_write_json_str( f_ptr, thread_ptr->name );
+    fprintf( f_ptr, "}}" );
+    first = false;
+
+    int64_t n_written = _apg_atomic_load( &thread_ptr->n_written );
+    int64_t start     = APG_MAX( 0, n_written - APG_PROF_MAX_EVENTS );
+    for ( int64_t i = start; i < n_written; i++ ) {
+      const _apg_prof_event_t* e_ptr = &thread_ptr->events_ptr[i % APG_PROF_MAX_EVENTS];
+      fprintf( f_ptr, ",\n{\"name\":" );
+      _apg_prof_write_json_str( f_ptr, e_ptr->name );
+      if ( _APG_PROF_COUNTER == e_ptr->type ) {
+        fprintf( f_ptr, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%i,\"args\":{\"value\":%g}}", e_ptr->t0_s * 1e6, thread_ptr->tid, e_ptr->x );
+      } else {
+        fprintf( f_ptr, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%i}", _APG_PROF_FRAME == e_ptr->type ? "frame" : "zone",
+          e_ptr->t0_s * 1e6, ( e_ptr->x - e_ptr->t0_s ) * 1e6, thread_ptr->tid );
+      }
+    }
+  }
+  fprintf( f_ptr, "\n]}\n" );
+  return 0 == fclose( f_ptr );
+}
+
+void apg_prof_free( void ) {
+  int64_t n_threads = APG_MIN( _apg_atomic_load( &_prof_n_threads ), APG_PROF_MAX_THREADS );
+  for ( int64_t t = 0; t < n_threads; t++ ) {
+    _apg_prof_thread_t* thread_ptr = _apg_atomic_load_ptr( &_prof_threads[t] );
+    if ( !thread_ptr ) { continue; }
+    free( thread_ptr->events_ptr );
+    free( thread_ptr );
+    _apg_atomic_store_ptr( &_prof_threads[t], NULL );
+  }
+  _apg_atomic_store( &_prof_n_threads, 0 );
+  _prof_tls      = NULL; /* NOTE(Anton) only resets the calling thread's pointer. Other threads must not record again after this. */
+  _prof_n_stats  = 0;
+  _prof_n_frames = 0;
+}
+
+/*=================================================================================================
+STRINGS IMPLEMENTATION
+=================================================================================================*/
+bool apg_strparmatch( const char* a, const char* b, size_t a_max, size_t b_max ) {
+  size_t len = APG_MAX( strnlen( a, a_max ), strnlen( b, b_max ) );
+  for ( size_t i = 0; i < len; i++ ) {
+    if ( a[i] != b[i] ) { return false; }
+  }
+  return true;
+}
+
+size_t apg_strnlen( const char* str, size_t maxlen ) {
+  size_t i = 0;
+  while ( i < maxlen && str[i] ) { i++; }
+  return i;
+}
+
+void apg_strncat( char* dst, const char* src, const size_t dst_max, const size_t src_max ) {
+  assert( dst && src );
+
+  size_t dst_len      = apg_strnlen( dst, dst_max );
+  size_t src_len      = apg_strnlen( src, src_max );
+  size_t space_in_dst = dst_max - dst_len;
+
+  assert( src_len <= space_in_dst && "ERROR: Not enough space in destination string." );
+
+  dst[dst_len] = '\0'; /* Just in case it wasn't already terminated. */
+
+  if ( 0 == space_in_dst ) { return; }
+
+  size_t n = APG_MIN( space_in_dst, src_len ); /* Use src_max if smaller. */
+  memmove( &dst[dst_len], src, n );
+  size_t last_i = dst_len + n < dst_max ? dst_len + n : dst_max - 1;
+  dst[last_i]   = '\0';
+}
+
+/*=================================================================================================
+FILES IMPLEMENTATION
+=================================================================================================*/
+#ifndef _MSC_VER
+#include <dirent.h> /* Directories. */
+#endif
+#ifndef _WIN32
+#include <fcntl.h>    /* open() */
+#include <sys/mman.h> /* mmap() */
+#endif
+
+bool apg_is_file( const char* path ) {
+  struct apg_stat_t path_stat;
+  if ( 0 != apg_stat( path, &path_stat ) ) { return false; }
+#ifdef _MSC_VER
+  return path_stat.st_mode & _S_IFREG;
+#else /* POSIX */
+  return S_ISREG( path_stat.st_mode );
+#endif
+}
+
+bool apg_is_dir( const char* path ) {
+  char tmp[2048];
+  { /* Remove trailing slashes because Windows/MinGW stat() can't handle them. */
+    tmp[0] = '\0';
+    apg_strncat( tmp, path, 2047, 2047 );
+    int len = (int)strlen( tmp );
+    if ( len > 1 && tmp[len - 2] == '\\' && tmp[len - 1] == '\\' ) { tmp[len - 2] = tmp[len - 1] = '\0'; }
+    if ( len > 0 && ( tmp[len - 1] == '/' || tmp[len - 1] == '\\' ) ) { tmp[len - 1] = '\0'; }
+  }
+  struct apg_stat_t path_stat;
+  if ( 0 != apg_stat( tmp, &path_stat ) ) { return false; }
+#ifdef _MSC_VER
+  return path_stat.st_mode & _S_IFDIR;
+#else /* POSIX */
+  return S_ISDIR( path_stat.st_mode );
+#endif
+}
+
+int64_t apg_file_size( const char* filename ) {
+  struct apg_stat_t buff;
+  if ( !filename ) { return -1; }
+  int res = apg_stat( filename, &buff );
+  if ( res < 0 ) { return -1; }
+  int64_t sz = (int64_t)buff.st_size;
+  return sz;
+}
+
+/** Make sure a path string ends with a Unix-style directory slash. */
+static bool _fix_dir_slashes( char* path, int max_len ) {
+  int len = (int)strlen( path );
+  // "anton\\"
+  if ( len > 2 && path[len - 2] == '\\' && path[len - 1] == '\\' ) {
+    path[len - 2] = '/';
+    path[len - 1] = '\0';
+    // "anton\"
+  } else if ( len >= 1 && path[len - 1] == '\\' ) {
+    path[len - 1] = '/';
+    path[len]     = '\0';
+    // "anton"
+  } else if ( len >= 1 && path[len - 1] != '/' ) {
+    if ( len + 1 >= max_len ) { return false; }
+    path[len]     = '/';
+    path[len + 1] = '\0';
+  }
+  return true;
+}
+
+static int _dir_contents_count( const char* path ) {
+  char tmp[2048];
+  int count = 0;
+  if ( !path ) { return count; }
+  if ( !apg_is_dir( path ) ) { return count; }
+#ifdef _MSC_VER /* MSVC */
+  WIN32_FIND_DATA fdFile;
+  HANDLE hFind = NULL;
+  snprintf( tmp, 2048, "%s/*.*", path ); /* Specify a file mask. "*.*" means we want everything! */
+  if ( ( hFind = FindFirstFile( tmp, &fdFile ) ) == INVALID_HANDLE_VALUE ) { return count; }
+  do { count++; } while ( FindNextFile( hFind, &fdFile ) ); /* Find the next file. */
+  FindClose( hFind );                                       /* Clean-up global state. */
+#else                                                       /* POSIX (including MinGW on Windows) */
+  struct dirent* entry;
+  struct apg_stat_t path_stat;
+  DIR* folder = opendir( path );
+  if ( folder == NULL ) { return count; }
+  while ( ( entry = readdir( folder ) ) ) {
+    tmp[0] = '\0';
+    apg_strncat( tmp, path, 2045, 2045 );
+    if ( !_fix_dir_slashes( tmp, 2047 ) ) { continue; } /* Error - path string too long. */
+    apg_strncat( tmp, entry->d_name, 2047, 2047 );
+    if ( 0 != apg_stat( tmp, &path_stat ) ) { continue; }
+    if ( S_ISREG( path_stat.st_mode ) || S_ISDIR( path_stat.st_mode ) ) { count++; }
+  } // endwhile
+  closedir( folder );
+#endif
+  return count;
+}
+
+int _dir_contents_cmp( const void* a, const void* b ) {
+  apg_dirent_t* a_ptr = (apg_dirent_t*)a;
+  apg_dirent_t* b_ptr = (apg_dirent_t*)b;
+  return strcmp( a_ptr->path, b_ptr->path );
+}
+
+bool apg_dir_contents( const char* path_ptr, apg_dirent_t** list_ptr, int* n_list ) {
+  if ( !path_ptr || !list_ptr || !n_list ) { return false; }
+  if ( !apg_is_dir( path_ptr ) ) { return false; }
+
+  apg_dirent_t new_entry;
+  char tmp[2048];
+  int count = _dir_contents_count( path_ptr ); // Loop over once to let us allocate array in one go.
+  int n     = 0;
+  *n_list   = 0;
+  *list_ptr = calloc( count, sizeof( apg_dirent_t ) );
+
+#ifdef _MSC_VER /* MSVC */
+  WIN32_FIND_DATA fdFile;
+  HANDLE hFind = NULL;
+  snprintf( tmp, 2048, "%s/*.*", path_ptr ); // Specify a file mask. "*.*" means we want everything!
+  if ( ( hFind = FindFirstFile( tmp, &fdFile ) ) == INVALID_HANDLE_VALUE ) { return count; }
+  do {
+    tmp[0] = '\0';
+    apg_strncat( tmp, path_ptr, 2045, 2045 );
+    if ( !_fix_dir_slashes( tmp, 2047 ) ) { continue; } // Error - path string too long.
+    apg_strncat( tmp, fdFile.cFileName, 2047, 2047 );
+
+    new_entry.type = APG_DIRENT_FILE;
+    if ( fdFile.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) { new_entry.type = APG_DIRENT_DIR; }
+    new_entry.path     = strdup( fdFile.cFileName );
+    ( *list_ptr )[n++] = new_entry;
+  } while ( FindNextFile( hFind, &fdFile ) ); // Find the next file.
+  FindClose( hFind ); // Clean-up global state.
+#else                 /* POSIX (including MinGW on Windows) */
+  struct apg_stat_t path_stat;
+  struct dirent* entry_ptr;
+  DIR* folder = opendir( path_ptr );
+  if ( folder == NULL ) { return false; }
+
+  while ( ( entry_ptr = readdir( folder ) ) ) {
+    tmp[0] = '\0';
+    apg_strncat( tmp, path_ptr, 2045, 2045 );
+    if ( !_fix_dir_slashes( tmp, 2047 ) ) { continue; } // Error - path string too long.
+    apg_strncat( tmp, entry_ptr->d_name, 2047, 2047 );
+
+    if ( 0 != apg_stat( tmp, &path_stat ) ) { continue; }
+    new_entry.type = APG_DIRENT_OTHER;
+    if ( S_ISREG( path_stat.st_mode ) ) { new_entry.type = APG_DIRENT_FILE; }
+    if ( S_ISDIR( path_stat.st_mode ) ) { new_entry.type = APG_DIRENT_DIR; }
+    new_entry.path     = strdup( entry_ptr->d_name );
+    ( *list_ptr )[n++] = new_entry;
+  }
+  closedir( folder );
+#endif
+
+  *n_list = n;
+  // Sort in alphabetical order by default (because mostly I want to print the list).
+  qsort( *list_ptr, n, sizeof( apg_dirent_t ), _dir_contents_cmp );
+  return true;
+}
+
+bool apg_free_dir_contents_list( apg_dirent_t** list_ptr, int n_list ) {
+  if ( !list_ptr ) { return false; }
+  for ( int i = 0; i < n_list; i++ ) {
+    if ( ( *list_ptr )[i].path ) { free( ( *list_ptr )[i].path ); }
+  }
+  free( *list_ptr );
+  *list_ptr = NULL;
+
+  return true;
+}
+
+bool apg_read_entire_file( const char* filename, apg_file_t* record ) {
+  FILE* f_ptr   = NULL;
+  void* mem_ptr = NULL;
+  int64_t sz    = 0;
+
+  APG_PROF_BEGIN( "apg_read_entire_file" );
+  if ( !filename || !record ) { goto _apg_read_entire_file_fail; }
+
+  sz = apg_file_size( filename );
+  if ( sz < 0 ) { goto _apg_read_entire_file_fail; }
+
+  mem_ptr = malloc( (size_t)sz );
+  if ( !mem_ptr ) { goto _apg_read_entire_file_fail; }
+
+  f_ptr = fopen( filename, "rb" );
+  if ( !f_ptr ) { goto _apg_read_entire_file_fail; }
+  size_t nr = fread( mem_ptr, (size_t)sz, 1, f_ptr );
+  if ( 1 != nr ) { goto _apg_read_entire_file_fail; }
+  fclose( f_ptr );
+
+  record->sz       = (size_t)sz;
+  record->data_ptr = mem_ptr;
+
+  APG_PROF_COUNTER( "apg_read_entire_file bytes", sz );
+  APG_PROF_END();
+  return true;
+
+_apg_read_entire_file_fail:
+  if ( mem_ptr ) { free( mem_ptr ); }
+  APG_PROF_END();
+  return false;
+}
+
+bool apg_file_to_str( const char* filename, int64_t max_len, char* str_ptr ) {
+  if ( !filename || 0 == max_len || !str_ptr ) { return false; }
+
+  int64_t file_sz = apg_file_size( filename );
+  if ( file_sz < 0 ) { return false; }
+  if ( file_sz >= max_len - 1 ) { return false; }
+
+  FILE* fp = fopen( filename, "rb" );
+  if ( !fp ) { return false; }
+  size_t nr = fread( str_ptr, (size_t)file_sz, 1, fp );
+  fclose( fp );
+  str_ptr[file_sz] = '\0';
+  if ( 1 != nr ) { return false; }
+  return true;
+}
+
+bool apg_file_map( const char* filename, apg_file_t* record ) {
+  if ( !filename || !record ) { return false; }
+  *record    = ( apg_file_t ){ .data_ptr = NULL };
+  int64_t sz = apg_file_size( filename );
+  if ( sz <= 0 || (uint64_t)sz > (uint64_t)SIZE_MAX ) { return false; }
+
+  APG_PROF_BEGIN( "apg_file_map" );
+#ifdef _WIN32
+  HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if ( INVALID_HANDLE_VALUE == file ) {
+    APG_PROF_END();
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+  CloseHandle( file );
+  if ( !mapping ) {
+    APG_PROF_END();
+    return false;
+  }
+  void* data_ptr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  CloseHandle( mapping ); /* The view keeps the mapping alive. */
+  if ( !data_ptr ) {
+    APG_PROF_END();
+    return false;
+  }
+#else
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 ) {
+    APG_PROF_END();
+    return false;
+  }
+  void* data_ptr = mmap( NULL, (size_t)sz, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd ); /* The mapping keeps the file open. */
+  if ( MAP_FAILED == data_ptr ) {
+    APG_PROF_END();
+    return false;
+  }
+#endif
+  record->data_ptr = data_ptr;
+  record->sz       = (size_t)sz;
+  APG_PROF_END();
+  return true;
+}
+
+void apg_file_unmap( apg_file_t* record ) {
+  if ( !record || !record->data_ptr ) { return; }
+#ifdef _WIN32
+  UnmapViewOfFile( record->data_ptr );
+#else
+  munmap( record->data_ptr, record->sz );
+#endif
+  *record = ( apg_file_t ){ .data_ptr = NULL };
+}
+
+/*=================================================================================================
+LOG FILES IMPLEMENTATION
+=================================================================================================*/
+#define APG_LOG_FILE "apg.log" /* file name for log */
+
+#ifndef APG_LOG_ASYNC_SLOTS
+#define APG_LOG_ASYNC_SLOTS 4096
+#endif
+#ifndef APG_LOG_ASYNC_MSG_MAX
+#define APG_LOG_ASYNC_MSG_MAX 256
+#endif
+#define APG_LOG_ASYNC_BATCH_MAX APG_KILOBYTES( 64 ) /* Writer thread accumulates messages up to this size before each fwrite(). */
+
+/* A message slot in the ring buffer. Bounded MPSC queue based on Dmitry Vyukov's sequence-numbered array design.
+ * seq == position    -> slot is free for the producer that claims `position`.
+ * seq == position+1  -> slot holds a complete message for the writer.
+ * The writer sets seq = position + APG_LOG_ASYNC_SLOTS when done, freeing it for the next lap around the ring. */
+typedef struct _apg_log_slot_t {
+  _apg_atomic_t seq;
+  int32_t len;
+  bool to_stderr;
+  char msg[APG_LOG_ASYNC_MSG_MAX];
+} _apg_log_slot_t;
+
+typedef struct _apg_log_async_t {
+  _apg_atomic_t enqueue_pos; /* Next position for producers to claim. */
+  char _pad0[64];            /* Keep the producer and consumer cursors on separate cache lines. */
+  _apg_atomic_t dequeue_pos; /* Next position to drain. Each message is claimed with a CAS on this, so the writer and crash handler never both write it. */
+  _apg_atomic_t written_pos; /* Every message before this position is in the log file. Set after the fwrite() and fflush() of its batch. */
+  char _pad1[64];
+  _apg_atomic_t running;          /* 1 while apg_log() calls go to the ring buffer. */
+  _apg_atomic_t active_producers; /* Callers currently between checking `running` and committing their slot. */
+  _apg_atomic_t stop_requested;
+  _apg_atomic_t writer_busy; /* Held by whoever is draining the ring: the writer thread, or the crash handler. */
+  _apg_log_slot_t* slots_ptr;
+  _apg_thread_t thread;
+  FILE* file_ptr;
+  size_t batch_len;
+  char batch[APG_LOG_ASYNC_BATCH_MAX];
+} _apg_log_async_t;
+
+static _apg_log_async_t _log_async;
+
+/* Returns false if async mode is off, in which case the caller should log synchronously. */
+static bool _apg_log_async_push( bool to_stderr, const char* message, va_list argptr ) {
+  _apg_atomic_add( &_log_async.active_producers, 1 );
+  if ( !_apg_atomic_load( &_log_async.running ) ) {
+    _apg_atomic_add( &_log_async.active_producers, -1 );
+    return false;
+  }
+
+  _apg_log_slot_t* slot_ptr = NULL;
+  int64_t pos               = _apg_atomic_load( &_log_async.enqueue_pos );
+  while ( true ) {
+    slot_ptr     = &_log_async.slots_ptr[pos & ( APG_LOG_ASYNC_SLOTS - 1 )];
+    int64_t diff = _apg_atomic_load( &slot_ptr->seq ) - pos;
+    if ( 0 == diff ) {
+      if ( _apg_atomic_cas( &_log_async.enqueue_pos, pos, pos + 1 ) ) { break; }
+    } else if ( diff < 0 ) {
+      _apg_thread_yield(); /* Ring is full - the writer hasn't freed this slot from the previous lap yet. */
+    }
+    pos = _apg_atomic_load( &_log_async.enqueue_pos );
+  }
+
+  int len = vsnprintf( slot_ptr->msg, APG_LOG_ASYNC_MSG_MAX, message, argptr );
+  if ( len < 0 ) { len = 0; }
+  if ( len >= APG_LOG_ASYNC_MSG_MAX ) { len = APG_LOG_ASYNC_MSG_MAX - 1; } /* Truncated. */
+  slot_ptr->len       = len;
+  slot_ptr->to_stderr = to_stderr;
+  _apg_atomic_store( &slot_ptr->seq, pos + 1 );
+
+  _apg_atomic_add( &_log_async.active_producers, -1 );
+  return true;
+}
+
+/* Write out the batch, then publish that every message before end_pos is in the file, for apg_log_flush(). */
+static void _apg_log_async_write_batch( FILE* file_ptr, int64_t end_pos ) {
+  if ( _log_async.batch_len > 0 && file_ptr ) {
+    fwrite( _log_async.batch, _log_async.batch_len, 1, file_ptr );
+    fflush( file_ptr );
+  }
+  _log_async.batch_len = 0;
+  _apg_atomic_store( &_log_async.written_pos, end_pos );
+}
+
+/* Copy every committed message into the batch buffer, then write the batch out. Caller must hold writer_busy to use the batch.
+ * If use_batch is false each message is written straight to the file instead, and the shared batch buffer isn't touched.
+ * The crash handler can end up draining alongside a stuck writer, so each message is claimed by advancing dequeue_pos before it's written.
+ * @return Number of messages drained. */
+static int64_t _apg_log_async_drain( FILE* file_ptr, bool use_batch ) {
+  int64_t n   = 0;
+  int64_t pos = _apg_atomic_load( &_log_async.dequeue_pos );
+  while ( true ) {
+    _apg_log_slot_t* slot_ptr = &_log_async.slots_ptr[pos & ( APG_LOG_ASYNC_SLOTS - 1 )];
+    if ( _apg_atomic_load( &slot_ptr->seq ) != pos + 1 ) { break; } /* Empty, or a producer has claimed the slot but not finished formatting yet. */
+    if ( !_apg_atomic_cas( &_log_async.dequeue_pos, pos, pos + 1 ) ) { /* The crash handler and a stuck writer can both be here - the other one took it. */
+      pos = _apg_atomic_load( &_log_async.dequeue_pos );
+      continue;
+    }
+
+    if ( !use_batch ) {
+      if ( file_ptr ) { fwrite( slot_ptr->msg, (size_t)slot_ptr->len, 1, file_ptr ); }
+    } else {
+      if ( _log_async.batch_len + (size_t)slot_ptr->len > APG_LOG_ASYNC_BATCH_MAX ) { _apg_log_async_write_batch( file_ptr, pos ); }
+      memcpy( &_log_async.batch[_log_async.batch_len], slot_ptr->msg, (size_t)slot_ptr->len );
+      _log_async.batch_len += (size_t)slot_ptr->len;
+    }
+    if ( slot_ptr->to_stderr ) { fwrite( slot_ptr->msg, (size_t)slot_ptr->len, 1, stderr ); }
+
+    _apg_atomic_store( &slot_ptr->seq, pos + APG_LOG_ASYNC_SLOTS );
+    pos++;
+    n++;
+  }
+  if ( use_batch ) { _apg_log_async_write_batch( file_ptr, pos ); }
+  return n;
+}
+
+_APG_THREAD_FUNC( _apg_log_async_writer_thread ) {
+  APG_UNUSED( arg_ptr );
+  while ( !_apg_atomic_load( &_log_async.stop_requested ) ) {
+    int64_t n = 0;
+    if ( _apg_atomic_cas( &_log_async.writer_busy, 0, 1 ) ) {
+      n = _apg_log_async_drain( _log_async.file_ptr, true );
+      _apg_atomic_store( &_log_async.writer_busy, 0 );
+    }
+    if ( 0 == n ) { apg_sleep_ms( 1 ); } /* Idle. Producers never block on the writer, so polling keeps them lock-free. */
+  }
+  if ( _apg_atomic_cas( &_log_async.writer_busy, 0, 1 ) ) {
+    _apg_log_async_drain( _log_async.file_ptr, true );
+    _apg_atomic_store( &_log_async.writer_busy, 0 );
+  }
+  _APG_THREAD_RETURN;
+}
+
+#ifndef APG_NO_BACKTRACES
+/* Called from the crash handler. Switches back to synchronous logging and writes out anything still buffered.
+ * If the writer thread doesn't let go within ~100ms it's either stuck or it's the thread that crashed, so drain anyway.
+ * Messages are written one at a time, not through the batch buffer, which the writer thread may still be using.
+ * Messages the writer already claimed into its batch are left to it, so nothing is written twice. */
+static void _apg_log_async_crash_flush( void ) {
+  if ( !_apg_atomic_cas( &_log_async.running, 1, 0 ) ) { return; }
+  for ( int i = 0; i < 100; i++ ) {
+    if ( _apg_atomic_cas( &_log_async.writer_busy, 0, 1 ) ) { break; }
+    apg_sleep_ms( 1 );
+  }
+  FILE* file_ptr = fopen( APG_LOG_FILE, "a" ); /* Don't trust the writer's FILE - it may be locked by the crashed thread. */
+  if ( !file_ptr ) { return; }
+  _apg_log_async_drain( file_ptr, false );
+  fclose( file_ptr );
+}
+#endif
+
+bool apg_log_async_start( void ) {
+  static bool registered_atexit = false;
+  if ( _apg_atomic_load( &_log_async.running ) ) { return true; }
+
+  _log_async.slots_ptr = malloc( sizeof( _apg_log_slot_t ) * APG_LOG_ASYNC_SLOTS );
+  if ( !_log_async.slots_ptr ) { return false; }
+  for ( int64_t i = 0; i < APG_LOG_ASYNC_SLOTS; i++ ) { _log_async.slots_ptr[i].seq = i; }
+  _log_async.enqueue_pos = _log_async.dequeue_pos = _log_async.written_pos = 0;
+  _log_async.stop_requested = _log_async.writer_busy = 0;
+  _log_async.batch_len                                 = 0;
+
+  _log_async.file_ptr = fopen( APG_LOG_FILE, "a" );
+  if ( !_log_async.file_ptr ) {
+    fprintf( stderr, "ERROR: could not open APG_LOG_FILE %s file for appending\n", APG_LOG_FILE );
+    goto _apg_log_async_start_fail;
+  }
+  if ( !_apg_thread_create( &_log_async.thread, _apg_log_async_writer_thread, NULL ) ) { goto _apg_log_async_start_fail; }
+  if ( !registered_atexit ) { registered_atexit = ( 0 == atexit( apg_log_async_stop ) ); }
+
+  _apg_atomic_store( &_log_async.running, 1 );
+  return true;
+
+_apg_log_async_start_fail:
+  if ( _log_async.file_ptr ) { fclose( _log_async.file_ptr ); }
+  free( _log_async.slots_ptr );
+  _log_async.file_ptr  = NULL;
+  _log_async.slots_ptr = NULL;
+  return false;
+}
+
+void apg_log_async_stop( void ) {
+  if ( !_apg_atomic_cas( &_log_async.running, 1, 0 ) ) { return; }
+  while ( _apg_atomic_load( &_log_async.active_producers ) > 0 ) { _apg_thread_yield(); } /* Let in-flight callers commit their slots. */
+  _apg_atomic_store( &_log_async.stop_requested, 1 );
+  _apg_thread_join( _log_async.thread );
+  fclose( _log_async.file_ptr );
+  free( _log_async.slots_ptr );
+  _log_async.file_ptr  = NULL;
+  _log_async.slots_ptr = NULL;
+}
+
+void apg_log_flush( void ) {
+  if ( !_apg_atomic_load( &_log_async.running ) ) { return; }
+  int64_t target = _apg_atomic_load( &_log_async.enqueue_pos );
+  while ( _apg_atomic_load( &_log_async.running ) && _apg_atomic_load( &_log_async.written_pos ) < target ) { _apg_thread_yield(); }
+}
+
+void apg_log_start( void ) {
+  FILE* file = fopen( APG_LOG_FILE, "w" ); /* NOTE it was getting massive with "a" */
+  if ( !file ) {
+    fprintf( stderr, "ERROR: could not open APG_LOG_FILE log file %s for writing\n", APG_LOG_FILE );
+    return;
+  }
+  fprintf( file, "\n------------ %s log. \n", APG_LOG_FILE );
+  fclose( file );
+}
+
+void apg_log( const char* message, ... ) {
+  va_list argptr;
+  va_start( argptr, message );
+  bool queued = _apg_log_async_push( false, message, argptr );
+  va_end( argptr );
+  if ( queued ) { return; }
+
+  FILE* file = fopen( APG_LOG_FILE, "a" );
+  if ( !file ) {
+    fprintf( stderr, "ERROR: could not open APG_LOG_FILE %s file for appending\n", APG_LOG_FILE );
+    return;
+  }
+  va_start( argptr, message );
+  vfprintf( file, message, argptr );
+  va_end( argptr );
+  fclose( file );
+}
+
+void apg_log_err( const char* message, ... ) {
+  va_list argptr;
+  va_start( argptr, message );
+  bool queued = _apg_log_async_push( true, message, argptr );
+  va_end( argptr );
+  if ( queued ) { return; }
+
+  FILE* file = fopen( APG_LOG_FILE, "a" );
+  if ( !file ) {
+    fprintf( stderr, "ERROR: could not open APG_LOG_FILE %s file for appending\n", APG_LOG_FILE );
+    return;
+  }
+  va_start( argptr, message );
+  vfprintf( file, message, argptr );
+  va_end( argptr );
+  fclose( file );
+  va_start( argptr, message );
+  vfprintf( stderr, message, argptr );
+  va_end( argptr );
+}
+
+/*=================================================================================================
+BACKTRACES AND DUMPS IMPLEMENTATION
+=================================================================================================*/
+#ifndef APG_NO_BACKTRACES
+static void _crash_handler( int sig ) {
+  _apg_log_async_crash_flush();
+  switch ( sig ) {
+  case SIGSEGV: {
+    apg_log_err( "FATAL ERROR: SIGSEGV- signal %i\nOut of bounds memory access or dereferencing a null pointer:\n", sig );
+  } break;
+  case SIGABRT: {
+    apg_log_err( "FATAL ERROR: SIGABRT - signal %i\nabort or assert:\n", sig );
+  } break;
+  case SIGFPE: {
+    apg_log_err( "FATAL ERROR: SIGFPE - signal %i\nArithmetic - probably a divide-by-zero or integer overflow:\n", sig );
+  } break;
+  case SIGILL: {
+    apg_log_err( "FATAL ERROR: SIGILL - signal %i\nIllegal instruction - probably function pointer invalid or stack overflow:\n", sig );
+  } break;
+  default: {
+    apg_log_err( "FATAL ERROR: signal %i:\n", sig );
+  } break;
+  }
+  /* note(anton) sigbus didnt exist on my mingw32 gcc */
+
+  FILE* file = fopen( APG_LOG_FILE, "a" );
+  if ( file ) {
+    apg_print_trace( file );
+    fclose( file );
+  }
+  apg_print_trace( stderr );
+  exit( 1 );
+}
+
+void apg_print_trace( FILE* stream ) {
+  assert( stream );
+
+#ifdef _WIN32
+  { /* NOTE: need a .pdb to read symbols on windows. gcc just needs -g -rdynamic on linux/mac. call cv2pdb myprog.exe -- https://github.com/rainers/cv2pdb */
+    HANDLE process = GetCurrentProcess();
+    HANDLE thread  = GetCurrentThread();
+
+    CONTEXT context;
+    memset( &context, 0, sizeof( CONTEXT ) );
+    context.ContextFlags = CONTEXT_FULL;
+    RtlCaptureContext( &context );
+
+    SymInitialize( process, NULL, TRUE );
+
+    DWORD image = IMAGE_FILE_MACHINE_AMD64;
+    STACKFRAME64 stackframe;
+    ZeroMemory( &stackframe, sizeof( STACKFRAME64 ) );
+    /* NOTE(anton) this is for x64. for _M_IA64 or _M_IX86 use different names. read this for shipping: http://blog.morlad.at/blah/mingw_postmortem */
+    stackframe.AddrPC.Offset    = context.Rip;
+    stackframe.AddrPC.Mode      = AddrModeFlat;
+    stackframe.AddrFrame.Offset = context.Rsp;
+    stackframe.AddrFrame.Mode   = AddrModeFlat;
+    stackframe.AddrStack.Offset = context.Rsp;
+    stackframe.AddrStack.Mode   = AddrModeFlat;
+
+    for ( size_t i = 0; i < 25; i++ ) {
+      BOOL result = StackWalk64( image, process, thread, &stackframe, &context, NULL, SymFunctionTableAccess64, SymGetModuleBase64, NULL );
+      if ( !result ) { break; }
+
+      char buffer[sizeof( SYMBOL_INFO ) + MAX_SYM_NAME * sizeof( TCHAR )];
+      PSYMBOL_INFO symbol  = (PSYMBOL_INFO)buffer;
+      symbol->SizeOfStruct = sizeof( SYMBOL_INFO );
+      symbol->MaxNameLen   = MAX_SYM_NAME;
+
+      DWORD64 displacement = 0;
+      if ( SymFromAddr( process, stackframe.AddrPC.Offset, &displacement, symbol ) ) {
+        fprintf( stream, "[%i] %-30s - 0x%0X\n", (int)i, symbol->Name, (unsigned int)symbol->Address );
+      } else {
+        fprintf( stream, "[%i] ??\n", (int)i );
+      }
+    } /* endfor */
+    SymCleanup( process );
+  }
+#else /* TODO(anton) test on OS X */
+#define BT_BUF_SIZE 100
+  void* array[BT_BUF_SIZE];
+  int size       = backtrace( array, BT_BUF_SIZE );
+  char** strings = backtrace_symbols( array, size );
+  if ( strings == NULL ) {
+    perror( "backtrace_symbols" ); /* also print internal error to stderr */
+    exit( EXIT_FAILURE );
+  }
+  fprintf( stream, "Obtained %i stack frames.\n", size );
+  for ( int i = 0; i < size; i++ ) fprintf( stream, "%s\n", strings[i] );
+  free( strings );
+#endif
+} /* endfunc apg_print_trace() */
+
+/* to deliberately cause a sigsegv: call a function containing bad ptr: int *foo = (int*)-1; */
+void apg_start_crash_handler( void ) {
+  signal( SIGSEGV, _crash_handler );
+  signal( SIGABRT, _crash_handler ); /* assert */
+  signal( SIGILL, _crash_handler );
+  signal( SIGFPE, _crash_handler ); /* ~ int div 0 */
+  /* no sigbus on my mingw */
+}
+
+#ifdef APG_UNIT_TESTS
+void apg_deliberate_sigsegv() {
+  int* bad = (int*)-1;
+  printf( "%i\n", *bad );
+}
+
+void apg_deliberate_divzero() {
+  int a   = rand();
+  int b   = a - a;
+  int bad = a / b;
+  printf( "%i\n", bad );
+}
+#endif /* APG_UNIT_TESTS */
+#endif /* APG_BACKTRACES */
+
+/*=================================================================================================
+COMMAND LINE PARAMETERS IMPLEMENTATION
+=================================================================================================*/
+int g_apg_argc;
+char** g_apg_argv;
+
+/* Checks for given parameter in main's command-line arguments
+returns the argument number if present (1 to argc - 1)
+otherwise returns 0 */
+int apg_check_param( const char* check ) {
+  for ( int i = 1; i < g_apg_argc; i++ ) {
+    /* NOTE: the original used strcasecmp() here which is the case insenstive
+    version, but it might require strings.h instead, depending on compiler
+    it makes sense to ignore case on multi-plat command line */
+    if ( strcasecmp( check, g_apg_argv[i] ) == 0 ) { return i; }
+  }
+  return -1;
+}
+
+/*=================================================================================================
+MEMORY IMPLEMENTATION
+=================================================================================================*/
+#ifdef APG_ALLOC_DEBUG
+#define APG_ALLOC_GUARDS
+#define APG_ALLOC_POISON
+#endif
+
+#define _APG_ALLOC_NO_HDR SIZE_MAX
+#define _APG_ALLOC_GUARD_SZ 16
+#define _APG_ALLOC_GUARD_BYTE 0xFD
+#define _APG_ALLOC_UNINIT_BYTE 0xCD
+#define _APG_ALLOC_FREED_BYTE 0xDD
+#define _APG_ALLOC_MAGIC 0xA110CA7EDULL
+
+/* Hidden header placed directly before each arena allocation when APG_ALLOC_GUARDS is defined.
+ * Headers form a linked list back through the arena so apg_arena_check() can find every guard band. */
+typedef struct _apg_alloc_hdr_t {
+  size_t prev_hdr; /* Offset of the previous allocation's header, or _APG_ALLOC_NO_HDR. */
+  size_t user_sz;
+  uint64_t magic;
+  uint64_t _pad; /* Keeps the header a multiple of 16 bytes. */
+} _apg_alloc_hdr_t;
+
+static size_t _apg_align_up( size_t offset, size_t align ) { return ( offset + align - 1 ) & ~( align - 1 ); }
+
+#ifdef APG_ALLOC_GUARDS
+static bool _apg_guard_ok( const uint8_t* guard_ptr ) {
+  for ( int i = 0; i < _APG_ALLOC_GUARD_SZ; i++ ) {
+    if ( guard_ptr[i] != _APG_ALLOC_GUARD_BYTE ) { return false; }
+  }
+  return true;
+}
+#endif
+
+bool apg_arena_init( apg_arena_t* arena_ptr, size_t sz ) {
+  if ( !arena_ptr ) { return false; }
+  *arena_ptr = ( apg_arena_t ){ .last_hdr = _APG_ALLOC_NO_HDR };
+  if ( 0 == sz ) { return false; }
+  arena_ptr->base_ptr = malloc( sz );
+  if ( !arena_ptr->base_ptr ) { return false; }
+  arena_ptr->sz          = sz;
+  arena_ptr->owns_memory = true;
+#ifdef APG_ALLOC_POISON
+  memset( arena_ptr->base_ptr, _APG_ALLOC_FREED_BYTE, sz );
+#endif
+  return true;
+}
+
+void apg_arena_init_from_mem( apg_arena_t* arena_ptr, void* mem_ptr, size_t sz ) {
+  if ( !arena_ptr ) { return; }
+  *arena_ptr = ( apg_arena_t ){ .base_ptr = (uint8_t*)mem_ptr, .sz = mem_ptr ? sz : 0, .last_hdr = _APG_ALLOC_NO_HDR };
+}
+
+void apg_arena_free( apg_arena_t* arena_ptr ) {
+  if ( !arena_ptr ) { return; }
+  if ( arena_ptr->owns_memory ) { free( arena_ptr->base_ptr ); }
+  *arena_ptr = ( apg_arena_t ){ .last_hdr = _APG_ALLOC_NO_HDR };
+}
+
+void* apg_arena_alloc_aligned( apg_arena_t* arena_ptr, size_t sz, size_t align ) {
+  if ( !arena_ptr || !arena_ptr->base_ptr || 0 == align || ( align & ( align - 1 ) ) ) { return NULL; }
+  /* Align the absolute address, not just the offset, in case user-supplied memory isn't aligned. */
+  uintptr_t base = (uintptr_t)arena_ptr->base_ptr;
+#ifdef APG_ALLOC_GUARDS
+  align           = APG_MAX( align, sizeof( _apg_alloc_hdr_t ) );
+  size_t user_off = _apg_align_up( base + arena_ptr->used + sizeof( _apg_alloc_hdr_t ), align ) - base;
+  size_t end_off  = user_off + sz + _APG_ALLOC_GUARD_SZ;
+#else
+  size_t user_off = _apg_align_up( base + arena_ptr->used, align ) - base;
+  size_t end_off  = user_off + sz;
+#endif
+  if ( end_off > arena_ptr->sz || end_off < arena_ptr->used ) { return NULL; } /* Out of space, or size_t overflow. */
+
+  uint8_t* user_ptr = &arena_ptr->base_ptr[user_off];
+#ifdef APG_ALLOC_GUARDS
+  size_t hdr_off = user_off - sizeof( _apg_alloc_hdr_t );
+  _apg_alloc_hdr_t hdr = ( _apg_alloc_hdr_t ){ .prev_hdr = arena_ptr->last_hdr, .user_sz = sz, .magic = _APG_ALLOC_MAGIC };
+  memcpy( &arena_ptr->base_ptr[hdr_off], &hdr, sizeof( _apg_alloc_hdr_t ) );
+  memset( &user_ptr[sz], _APG_ALLOC_GUARD_BYTE, _APG_ALLOC_GUARD_SZ );
+  arena_ptr->last_hdr = hdr_off;
+#endif
+#ifdef APG_ALLOC_POISON
+  memset( user_ptr, _APG_ALLOC_UNINIT_BYTE, sz );
+#endif
+  arena_ptr->used = end_off;
+  arena_ptr->peak = APG_MAX( arena_ptr->peak, end_off );
+  return user_ptr;
+}
+
+void* apg_arena_alloc( apg_arena_t* arena_ptr, size_t sz ) { return apg_arena_alloc_aligned( arena_ptr, sz, APG_ARENA_ALIGN ); }
+
+void* apg_arena_calloc( apg_arena_t* arena_ptr, size_t n, size_t sz ) {
+  if ( sz && n > SIZE_MAX / sz ) { return NULL; }
+  void* mem_ptr = apg_arena_alloc( arena_ptr, n * sz );
+  if ( mem_ptr ) { memset( mem_ptr, 0, n * sz ); }
+  return mem_ptr;
+}
+
+apg_arena_mark_t apg_arena_mark( const apg_arena_t* arena_ptr ) {
+  if ( !arena_ptr ) { return ( apg_arena_mark_t ){ .last_hdr = _APG_ALLOC_NO_HDR }; }
+  return ( apg_arena_mark_t ){ .used = arena_ptr->used, .last_hdr = arena_ptr->last_hdr };
+}
+
+void apg_arena_reset_to_mark( apg_arena_t* arena_ptr, apg_arena_mark_t mark ) {
+  if ( !arena_ptr || mark.used > arena_ptr->used ) { return; }
+#ifdef APG_ALLOC_GUARDS
+  bool guards_ok = apg_arena_check( arena_ptr );
+  assert( guards_ok && "arena allocation overrun" );
+  APG_UNUSED( guards_ok );
+#endif
+#ifdef APG_ALLOC_POISON
+  memset( &arena_ptr->base_ptr[mark.used], _APG_ALLOC_FREED_BYTE, arena_ptr->used - mark.used );
+#endif
+  arena_ptr->used     = mark.used;
+  arena_ptr->last_hdr = mark.last_hdr;
+}
+
+void apg_arena_reset( apg_arena_t* arena_ptr ) { apg_arena_reset_to_mark( arena_ptr, ( apg_arena_mark_t ){ .used = 0, .last_hdr = _APG_ALLOC_NO_HDR } ); }
+
+bool apg_arena_check( const apg_arena_t* arena_ptr ) {
+  if ( !arena_ptr ) { return false; }
+#ifdef APG_ALLOC_GUARDS
+  for ( size_t hdr_off = arena_ptr->last_hdr; hdr_off != _APG_ALLOC_NO_HDR; ) {
+    _apg_alloc_hdr_t hdr;
+    memcpy( &hdr, &arena_ptr->base_ptr[hdr_off], sizeof( _apg_alloc_hdr_t ) );
+    size_t user_off = hdr_off + sizeof( _apg_alloc_hdr_t );
+    if ( hdr.magic != _APG_ALLOC_MAGIC ) {
+      fprintf( stderr, "ERROR: arena allocation header at offset %zu was overwritten. Underrun, or overrun of the previous allocation.\n", hdr_off );
+      return false;
+    }
+    if ( !_apg_guard_ok( &arena_ptr->base_ptr[user_off + hdr.user_sz] ) ) {
+      fprintf( stderr, "ERROR: arena allocation of %zu bytes at offset %zu was overrun.\n", hdr.user_sz, user_off );
+      return false;
+    }
+    hdr_off = hdr.prev_hdr;
+  }
+#endif
+  return true;
+}
+
+bool apg_frame_alloc_init( apg_frame_alloc_t* frame_ptr, size_t sz_per_frame ) {
+  if ( !frame_ptr ) { return false; }
+  *frame_ptr = ( apg_frame_alloc_t ){ .curr_idx = 0 };
+  if ( !apg_arena_init( &frame_ptr->arenas[0], sz_per_frame ) ) { return false; }
+  if ( !apg_arena_init( &frame_ptr->arenas[1], sz_per_frame ) ) {
+    apg_arena_free( &frame_ptr->arenas[0] );
+    return false;
+  }
+  return true;
+}
+
+void apg_frame_alloc_free( apg_frame_alloc_t* frame_ptr ) {
+  if ( !frame_ptr ) { return; }
+  apg_arena_free( &frame_ptr->arenas[0] );
+  apg_arena_free( &frame_ptr->arenas[1] );
+}
+
+void* apg_frame_alloc( apg_frame_alloc_t* frame_ptr, size_t sz ) {
+  if ( !frame_ptr ) { return NULL; }
+  return apg_arena_alloc( &frame_ptr->arenas[frame_ptr->curr_idx], sz );
+}
+
+apg_arena_t* apg_frame_arena( apg_frame_alloc_t* frame_ptr ) {
+  if ( !frame_ptr ) { return NULL; }
+  return &frame_ptr->arenas[frame_ptr->curr_idx];
+}
+
+void apg_frame_alloc_swap( apg_frame_alloc_t* frame_ptr ) {
+  if ( !frame_ptr ) { return; }
+  frame_ptr->curr_idx ^= 1;
+  apg_arena_reset( &frame_ptr->arenas[frame_ptr->curr_idx] );
+}
+
+bool apg_pool_init( apg_pool_t* pool_ptr, size_t block_sz, size_t n_blocks ) {
+  if ( !pool_ptr ) { return false; }
+  *pool_ptr = ( apg_pool_t ){ .block_sz = block_sz };
+  if ( 0 == block_sz || 0 == n_blocks ) { return false; }
+  size_t stride = APG_MAX( block_sz, sizeof( void* ) ); /* Free blocks store the free-list's next pointer in their first bytes. */
+#ifdef APG_ALLOC_GUARDS
+  stride += _APG_ALLOC_GUARD_SZ;
+  pool_ptr->in_use_ptr = calloc( n_blocks, 1 );
+  if ( !pool_ptr->in_use_ptr ) { return false; }
+#endif
+  stride = _apg_align_up( stride, APG_ARENA_ALIGN );
+  if ( n_blocks > SIZE_MAX / stride ) { goto _apg_pool_init_fail; }
+  pool_ptr->base_ptr = malloc( stride * n_blocks ); /* malloc() alignment is enough for APG_ARENA_ALIGN on 64-bit platforms. */
+  if ( !pool_ptr->base_ptr ) { goto _apg_pool_init_fail; }
+  pool_ptr->stride   = stride;
+  pool_ptr->n_blocks = n_blocks;
+
+  /* Thread the free-list through the blocks in address order so the first allocations are contiguous. */
+  for ( size_t i = 0; i < n_blocks; i++ ) {
+    uint8_t* block_ptr = &pool_ptr->base_ptr[i * stride];
+#ifdef APG_ALLOC_POISON
+    memset( block_ptr, _APG_ALLOC_FREED_BYTE, block_sz );
+#endif
+#ifdef APG_ALLOC_GUARDS
+    memset( &block_ptr[APG_MAX( block_sz, sizeof( void* ) )], _APG_ALLOC_GUARD_BYTE, _APG_ALLOC_GUARD_SZ );
+#endif
+    void* next_ptr = i + 1 < n_blocks ? &pool_ptr->base_ptr[( i + 1 ) * stride] : NULL;
+    memcpy( block_ptr, &next_ptr, sizeof( void* ) );
+  }
+  pool_ptr->free_list_ptr = pool_ptr->base_ptr;
+  return true;
+
+_apg_pool_init_fail:
+  free( pool_ptr->in_use_ptr );
+  *pool_ptr = ( apg_pool_t ){ .block_sz = 0 };
+  return false;
+}
+
+void apg_pool_free( apg_pool_t* pool_ptr ) {
+  if ( !pool_ptr ) { return; }
+  free( pool_ptr->base_ptr );
+  free( pool_ptr->in_use_ptr );
+  *pool_ptr = ( apg_pool_t ){ .block_sz = 0 };
+}
+
+void* apg_pool_alloc( apg_pool_t* pool_ptr ) {
+  if ( !pool_ptr || !pool_ptr->free_list_ptr ) { return NULL; }
+  uint8_t* block_ptr = (uint8_t*)pool_ptr->free_list_ptr;
+  memcpy( &pool_ptr->free_list_ptr, block_ptr, sizeof( void* ) );
+  pool_ptr->n_used++;
+#ifdef APG_ALLOC_POISON
+  for ( size_t i = sizeof( void* ); i < pool_ptr->block_sz; i++ ) {
+    if ( block_ptr[i] != _APG_ALLOC_FREED_BYTE ) {
+      fprintf( stderr, "ERROR: pool block %zu was written to after it was deallocated.\n", (size_t)( block_ptr - pool_ptr->base_ptr ) / pool_ptr->stride );
+      assert( false && "pool write after dealloc" );
+      break;
+    }
+  }
+  memset( block_ptr, _APG_ALLOC_UNINIT_BYTE, pool_ptr->block_sz );
+#endif
+#ifdef APG_ALLOC_GUARDS
+  pool_ptr->in_use_ptr[( block_ptr - pool_ptr->base_ptr ) / pool_ptr->stride] = 1;
+#endif
+  return block_ptr;
+}
+
+void apg_pool_dealloc( apg_pool_t* pool_ptr, void* block_ptr ) {
+  if ( !pool_ptr || !block_ptr ) { return; }
+  uint8_t* byte_ptr = (uint8_t*)block_ptr;
+  assert( byte_ptr >= pool_ptr->base_ptr && byte_ptr < pool_ptr->base_ptr + pool_ptr->stride * pool_ptr->n_blocks && "block is not from this pool" );
+#ifdef APG_ALLOC_GUARDS
+  size_t block_idx = (size_t)( byte_ptr - pool_ptr->base_ptr ) / pool_ptr->stride;
+  if ( !pool_ptr->in_use_ptr[block_idx] ) {
+    fprintf( stderr, "ERROR: pool block %zu was deallocated twice.\n", block_idx );
+    assert( false && "pool double dealloc" );
+    return;
+  }
+  if ( !_apg_guard_ok( &byte_ptr[APG_MAX( pool_ptr->block_sz, sizeof( void* ) )] ) ) {
+    fprintf( stderr, "ERROR: pool block %zu of %zu bytes was overrun.\n", block_idx, pool_ptr->block_sz );
+    assert( false && "pool block overrun" );
+  }
+  pool_ptr->in_use_ptr[block_idx] = 0;
+#endif
+#ifdef APG_ALLOC_POISON
+  memset( byte_ptr, _APG_ALLOC_FREED_BYTE, pool_ptr->block_sz );
+#endif
+  memcpy( byte_ptr, &pool_ptr->free_list_ptr, sizeof( void* ) );
+  pool_ptr->free_list_ptr = byte_ptr;
+  pool_ptr->n_used--;
+}
+
+/*=================================================================================================
+JOB SYSTEM IMPLEMENTATION
+=================================================================================================*/
+#define _APG_JOBS_IDLE_SPINS 64 /* Failed attempts to find work before a worker goes to sleep. */
+
+typedef struct _apg_job_t {
+  apg_job_func_t func_ptr;
+  apg_job_range_func_t range_func_ptr; /* If set, this is a piece of an apg_jobs_parallel_for() and func_ptr is unused. */
+  void* arg_ptr;
+  apg_job_counter_t* counter_ptr;
+  int64_t begin, end, grain;
+} _apg_job_t;
+
+/* Chase-Lev work-stealing deque, as in "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013, with a fixed-size ring.
+ * Only the owning thread touches `bottom`. Thieves race on `top` with a CAS. Top and bottom are kept on separate cache lines. */
+typedef struct _apg_jobs_deque_t {
+  _apg_atomic_t top;
+  uint8_t _pad_top[64 - sizeof( _apg_atomic_t )];
+  _apg_atomic_t bottom;
+  uint8_t _pad_bottom[64 - sizeof( _apg_atomic_t )];
+  _apg_job_t jobs[APG_JOBS_MAX_QUEUED];
+} _apg_jobs_deque_t;
+
+typedef struct _apg_jobs_t {
+  _apg_jobs_deque_t* deques_ptr; /* One per thread. Index 0 belongs to the thread that called apg_jobs_init(). */
+  _apg_thread_t threads[APG_JOBS_MAX_THREADS];
+  int thread_idxs[APG_JOBS_MAX_THREADS];
+  int n_threads;
+  _apg_atomic_t running;
+  _apg_atomic_t n_queued;   /* Jobs sitting in any deque. Lets idle workers decide to sleep without scanning every deque. */
+  _apg_atomic_t n_sleeping; /* Workers blocked on wake_cond. Pushers only take the mutex when this is non-zero. */
+  _apg_mutex_t sleep_mutex;
+  _apg_cond_t wake_cond;
+} _apg_jobs_t;
+
+static _apg_jobs_t _jobs;
+static _APG_THREAD_LOCAL int _jobs_thread_idx = -1;
+static _APG_THREAD_LOCAL uint32_t _jobs_steal_seed; /* xorshift state for picking a victim. */
+
+static bool _apg_jobs_deque_push( _apg_jobs_deque_t* deque_ptr, const _apg_job_t* job_ptr ) {
+  int64_t b = _apg_atomic_load( &deque_ptr->bottom );
+  int64_t t = _apg_atomic_load( &deque_ptr->top );
+  if ( b - t >= APG_JOBS_MAX_QUEUED ) { return false; }
+  deque_ptr->jobs[b & ( APG_JOBS_MAX_QUEUED - 1 )] = *job_ptr;
+  _apg_atomic_store( &deque_ptr->bottom, b + 1 ); /* Release, so a thief that sees the new bottom also sees the job. */
+  return true;
+}
+
+static bool _apg_jobs_deque_pop( _apg_jobs_deque_t* deque_ptr, _apg_job_t* job_ptr ) {
+  int64_t b = _apg_atomic_load( &deque_ptr->bottom ) - 1;
+  _apg_atomic_store( &deque_ptr->bottom, b );
+  _apg_atomic_fence(); /* The bottom store must be visible before top is read, or a thief and the owner could both take the last job. */
+  int64_t t = _apg_atomic_load( &deque_ptr->top );
+  if ( t > b ) { /* Empty. */
+    _apg_atomic_store( &deque_ptr->bottom, b + 1 );
+    return false;
+  }
+  *job_ptr = deque_ptr->jobs[b & ( APG_JOBS_MAX_QUEUED - 1 )];
+  if ( t < b ) { return true; } /* More than one job left, so no thief can be after this one. */
+  bool won = _apg_atomic_cas( &deque_ptr->top, t, t + 1 ); /* Last job. Race any thieves for it. */
+  _apg_atomic_store( &deque_ptr->bottom, b + 1 );
+  return won;
+}
+
+static bool _apg_jobs_deque_steal( _apg_jobs_deque_t* deque_ptr, _apg_job_t* job_ptr ) {
+  int64_t t = _apg_atomic_load( &deque_ptr->top );
+  _apg_atomic_fence();
+  int64_t b = _apg_atomic_load( &deque_ptr->bottom );
+  if ( t >= b ) { return false; }
+  /* Copy before claiming. If the CAS fails someone else took it and the copy, which may be torn, is thrown away. */
+  _apg_job_t job = deque_ptr->jobs[t & ( APG_JOBS_MAX_QUEUED - 1 )];
+  if ( !_apg_atomic_cas( &deque_ptr->top, t, t + 1 ) ) { return false; }
+  *job_ptr = job;
+  return true;
+}
+
+static bool _apg_jobs_take( int thread_idx, _apg_job_t* job_ptr ) {
+  if ( _apg_jobs_deque_pop( &_jobs.deques_ptr[thread_idx], job_ptr ) ) {
+    _apg_atomic_add( &_jobs.n_queued, -1 );
+    return true;
+  }
+  if ( _jobs.n_threads < 2 ) { return false; }
+  /* Start at a random victim so thieves spread out instead of all hitting thread 0. */
+  _jobs_steal_seed ^= _jobs_steal_seed << 13;
+  _jobs_steal_seed ^= _jobs_steal_seed >> 17;
+  _jobs_steal_seed ^= _jobs_steal_seed << 5;
+  int first = (int)( _jobs_steal_seed % (uint32_t)_jobs.n_threads );
+  for ( int i = 0; i < _jobs.n_threads; i++ ) {
+    int victim = ( first + i ) % _jobs.n_threads;
+    if ( victim == thread_idx ) { continue; }
+    if ( _apg_jobs_deque_steal( &_jobs.deques_ptr[victim], job_ptr ) ) {
+      _apg_atomic_add( &_jobs.n_queued, -1 );
+      return true;
+    }
+  }
+  return false;
+}
+
+static void _apg_jobs_execute( const _apg_job_t* job_ptr );
+
+static void _apg_jobs_push( const _apg_job_t* job_ptr ) {
+  int thread_idx = _jobs_thread_idx;
+  if ( _jobs.n_threads < 2 || thread_idx < 0 || !_apg_jobs_deque_push( &_jobs.deques_ptr[thread_idx], job_ptr ) ) {
+    _apg_jobs_execute( job_ptr ); /* Single-threaded, called from an unknown thread, or the deque is full. */
+    return;
+  }
+  _apg_atomic_add( &_jobs.n_queued, 1 );
+  _apg_atomic_fence(); /* Pairs with the fence in the worker's sleep path so a push can't slip between its check and its wait. */
+  if ( _apg_atomic_load( &_jobs.n_sleeping ) > 0 ) {
+    _apg_mutex_lock( &_jobs.sleep_mutex );
+    _apg_cond_signal( &_jobs.wake_cond );
+    _apg_mutex_unlock( &_jobs.sleep_mutex );
+  }
+}
+
+static void _apg_jobs_execute( const _apg_job_t* job_ptr ) {
+  if ( job_ptr->range_func_ptr ) {
+    /* Split off the upper half as a stealable job until what's left fits in one grain. */
+    int64_t begin = job_ptr->begin, end = job_ptr->end;
+    while ( end - begin > job_ptr->grain ) {
+      int64_t mid      = begin + ( end - begin ) / 2;
+      _apg_job_t upper = *job_ptr;
+      upper.begin      = mid;
+      upper.end        = end;
+      _apg_atomic_add( (_apg_atomic_t*)&job_ptr->counter_ptr->n_pending, 1 );
+      _apg_jobs_push( &upper );
+      end = mid;
+    }
+    job_ptr->range_func_ptr( begin, end, job_ptr->arg_ptr );
+  } else {
+    job_ptr->func_ptr( job_ptr->arg_ptr );
+  }
+  if ( job_ptr->counter_ptr ) { _apg_atomic_add( (_apg_atomic_t*)&job_ptr->counter_ptr->n_pending, -1 ); }
+}
+
+_APG_THREAD_FUNC( _apg_jobs_worker ) {
+  int thread_idx   = *(int*)arg_ptr;
+  _jobs_thread_idx = thread_idx;
+  _jobs_steal_seed = 2463534242u + (uint32_t)thread_idx * 7919u;
+  int n_idle_spins = 0;
+  while ( _apg_atomic_load( &_jobs.running ) ) {
+    _apg_job_t job;
+    if ( _apg_jobs_take( thread_idx, &job ) ) {
+      _apg_jobs_execute( &job );
+      n_idle_spins = 0;
+      continue;
+    }
+    if ( ++n_idle_spins < _APG_JOBS_IDLE_SPINS ) {
+      _apg_thread_yield();
+      continue;
+    }
+    _apg_mutex_lock( &_jobs.sleep_mutex );
+    _apg_atomic_add( &_jobs.n_sleeping, 1 );
+    _apg_atomic_fence();
+    while ( _apg_atomic_load( &_jobs.running ) && 0 == _apg_atomic_load( &_jobs.n_queued ) ) { _apg_cond_wait( &_jobs.wake_cond, &_jobs.sleep_mutex ); }
+    _apg_atomic_add( &_jobs.n_sleeping, -1 );
+    _apg_mutex_unlock( &_jobs.sleep_mutex );
+    n_idle_spins = 0;
+  }
+  _APG_THREAD_RETURN;
+}
+
+bool apg_jobs_init( int n_threads ) {
+  if ( _jobs.n_threads > 0 ) { return false; }
+  if ( n_threads <= 0 ) { n_threads = _apg_n_logical_cpus(); }
+  n_threads = APG_CLAMP( n_threads, 1, APG_JOBS_MAX_THREADS );
+
+  _jobs.deques_ptr = calloc( n_threads, sizeof( _apg_jobs_deque_t ) );
+  if ( !_jobs.deques_ptr ) { return false; }
+  _apg_atomic_store( &_jobs.running, 1 );
+  _apg_atomic_store( &_jobs.n_queued, 0 );
+  _apg_atomic_store( &_jobs.n_sleeping, 0 );
+  _apg_mutex_init( &_jobs.sleep_mutex );
+  _apg_cond_init( &_jobs.wake_cond );
+  _jobs_thread_idx = 0;
+  _jobs_steal_seed = 2463534242u;
+  _jobs.n_threads  = n_threads; /* Set before any worker starts, as they read it to pick victims. */
+  for ( int i = 1; i < n_threads; i++ ) {
+    _jobs.thread_idxs[i] = i;
+    if ( !_apg_thread_create( &_jobs.threads[i], _apg_jobs_worker, &_jobs.thread_idxs[i] ) ) {
+      fprintf( stderr, "ERROR: creating job system worker thread %i.\n", i );
+      _jobs.n_threads = i; /* Only join the threads that exist. */
+      apg_jobs_free();
+      return false;
+    }
+  }
+  return true;
+}
+
+void apg_jobs_free( void ) {
+  if ( 0 == _jobs.n_threads ) { return; }
+  _apg_mutex_lock( &_jobs.sleep_mutex );
+  _apg_atomic_store( &_jobs.running, 0 );
+  _apg_cond_broadcast( &_jobs.wake_cond );
+  _apg_mutex_unlock( &_jobs.sleep_mutex );
+  for ( int i = 1; i < _jobs.n_threads; i++ ) { _apg_thread_join( _jobs.threads[i] ); }
+  _apg_cond_destroy( &_jobs.wake_cond );
+  _apg_mutex_destroy( &_jobs.sleep_mutex );
+  free( _jobs.deques_ptr );
+  _jobs.deques_ptr = NULL;
+  _jobs.n_threads  = 0;
+  _jobs_thread_idx = -1;
+}
+
+int apg_jobs_n_threads( void ) { return _jobs.n_threads; }
+
+int apg_jobs_thread_idx( void ) { return _jobs_thread_idx; }
+
+void apg_jobs_run( apg_job_func_t func_ptr, void* arg_ptr, apg_job_counter_t* counter_ptr ) {
+  assert( func_ptr );
+  _apg_job_t job = ( _apg_job_t ){ .func_ptr = func_ptr, .arg_ptr = arg_ptr, .counter_ptr = counter_ptr };
+  if ( counter_ptr ) { _apg_atomic_add( (_apg_atomic_t*)&counter_ptr->n_pending, 1 ); }
+  _apg_jobs_push( &job );
+}
+
+void apg_jobs_wait( apg_job_counter_t* counter_ptr ) {
+  assert( counter_ptr );
+  int thread_idx = _jobs_thread_idx;
+  while ( _apg_atomic_load( (_apg_atomic_t*)&counter_ptr->n_pending ) > 0 ) {
+    _apg_job_t job;
+    if ( thread_idx >= 0 && _jobs.n_threads > 0 && _apg_jobs_take( thread_idx, &job ) ) {
+      _apg_jobs_execute( &job );
+    } else {
+      _apg_thread_yield(); /* Everything left is running on other threads. */
+    }
+  }
+}
+
+void apg_jobs_parallel_for( int64_t begin, int64_t end, int64_t grain, apg_job_range_func_t func_ptr, void* arg_ptr ) {
+  assert( func_ptr && grain >= 1 );
+  if ( end <= begin ) { return; }
+  apg_job_counter_t counter = ( apg_job_counter_t ){ .n_pending = 1 };
+  _apg_job_t job            = ( _apg_job_t ){ .range_func_ptr = func_ptr, .arg_ptr = arg_ptr, .counter_ptr = &counter, .begin = begin, .end = end, .grain = APG_MAX( grain, 1 ) };
+  _apg_jobs_execute( &job );
+  apg_jobs_wait( &counter );
+}
+
+/*=================================================================================================
+COMPRESSION
+=================================================================================================*/
+
+void apg_rle_compress( const uint8_t* bytes_in, size_t sz_in, uint8_t* bytes_out, size_t* sz_out ) {
+  assert( sz_out );
+  if ( !sz_out ) { return; }
+  if ( !bytes_in || sz_in == 0 ) { *sz_out = 0; }
+
+  size_t out_n = 0;
+  for ( size_t i = 0; i < sz_in; i++ ) {
+    uint8_t count = 1;
+    if ( ( i < sz_in - 1 ) && ( bytes_in[i] == bytes_in[i + 1] ) ) { // WARNING clang-tidy "array access from bytes_in results in a null pointer dereference
+      count = 2;
+      for ( size_t j = i + 2; j < sz_in && count < UINT8_MAX; j++ ) {
+        if ( bytes_in[j] != bytes_in[i] ) { break; }
+        count++;
+      }
+    }
+    if ( bytes_out ) {
+      bytes_out[out_n] = bytes_in[i]; // WARNING clang-tidy "array access from bytes_in results in a null pointer dereference
+      if ( count >= 2 ) {             // eg convert AAA to AA3 and AAAA to AA4. AA expands to AA2. A alone stays A
+        bytes_out[out_n + 1] = bytes_in[i];
+        bytes_out[out_n + 2] = count;
+      }
+    }
+    out_n++;
+    if ( count >= 2 ) {
+      out_n += 2; // eg DDDD->DD4 so 3 total. D + D4 -> 1 + 2.
+      i += ( count - 1 );
+    }
+  }
+  *sz_out = out_n;
+}
+
+void apg_rle_decompress( const uint8_t* bytes_in, size_t sz_in, uint8_t* bytes_out, size_t* sz_out ) {
+  assert( sz_out );
+  if ( !sz_out ) { return; }
+  if ( !bytes_in || sz_in == 0 ) { *sz_out = 0; }
+
+  size_t out_n = 0;
+  for ( size_t i = 0; i < sz_in; i++ ) {
+    uint8_t count = 1;
+    // look for 2 in a row then expect a number
+    if ( ( i < sz_in - 2 ) && ( bytes_in[i] == bytes_in[i + 1] ) ) { count = bytes_in[i + 2]; }
+    if ( bytes_out ) {
+      for ( uint8_t j = 0; j < count; j++ ) { bytes_out[out_n + j] = bytes_in[i]; }
+    }
+    out_n += count;
+    if ( count > 1 ) { i += 2; }
+  }
+  *sz_out = out_n;
+}
+
+/*=================================================================================================
+HASH TABLE
+=================================================================================================*/
+
+apg_hash_table_t apg_hash_table_create( uint32_t table_n ) {
+  apg_hash_table_t table = (apg_hash_table_t){ .n = 0 };
+  if ( table_n == 0 ) { return table; }
+  table.list_ptr = calloc( table_n, sizeof( apg_hash_table_element_t ) );
+  if ( !table.list_ptr ) { return table; } // OOM error.
+  table.n = table_n;
+  return table;
+}
+
+void apg_hash_table_free( apg_hash_table_t* table_ptr ) {
+  if ( !table_ptr ) { return; }
+  // Free any allocated key strings.
+  for ( uint32_t i = 0; i < table_ptr->n; i++ ) {
+    if ( table_ptr->list_ptr[i].value_ptr ) {
+      if ( table_ptr->list_ptr[i].keystr ) { free( table_ptr->list_ptr[i].keystr ); }
+    }
+  }
+  if ( table_ptr->list_ptr ) { free( table_ptr->list_ptr ); }
+  *table_ptr = (apg_hash_table_t){ .n = 0 };
+}
+
+/** Return a hash index ( hash code ) for a single value key->table mapping.
+
+TODO(Anton) reusue this for a hash-set implementation?
+
+* Golden ratio is (1+sqrt(5))/2 = 1.618033988749...
+ *  The fractional part is useful as a multiplier.
+ *
+#define APG_GOLDEN_RATIO_FRAC 0.618033988749
+
+uint32_t apg_hashi( uint32_t key, uint32_t table_n ) {
+  double int_part     = 0.0;
+  uint32_t hash_index = (uint32_t)( (double)table_n * modf( (double)key * APG_GOLDEN_RATIO_FRAC, &int_part ) );
+  return hash_index;
+}
+*/
+
+uint32_t apg_hash( const char* keystr ) {
+  // sdbm based on http://www.cse.yorku.ca/~oz/hash.html
+  uint32_t hash = 0;
+  size_t len    = strlen( keystr );
+  for ( uint32_t i = 0; i < len; i++ ) { hash = keystr[i] + ( hash << 6 ) + ( hash << 16 ) - hash; }
+  return hash;
+}
+
+uint32_t apg_hash_rehash( const char* keystr ) {
+  // djb2 based on http://www.cse.yorku.ca/~oz/hash.html
+  uint32_t hash = 5381;
+  size_t len    = strlen( keystr );
+  for ( size_t i = 0; i < len; i++ ) { hash = ( ( hash << 5 ) + hash ) + keystr[i]; }
+  return hash;
+}
+
+bool apg_hash_store( const char* keystr, void* value_ptr, apg_hash_table_t* table_ptr, uint32_t* collision_ptr ) {
+  if ( !keystr || !value_ptr || !table_ptr ) { return false; }
+  if ( table_ptr->count_stored >= table_ptr->n ) { return false; } // Table full. Should resize before here.
+
+  uint32_t collisions = 0;
+  uint32_t hash       = apg_hash( keystr );
+  uint32_t idx        = hash % table_ptr->n;
+
+  // Check for best case scenario: landed on an empty index first try.
+  if ( NULL == table_ptr->list_ptr[idx].value_ptr ) { goto apg_hash_store_enter_key; }
+
+  // Otherwise, first try a rehash.
+  if ( strcmp( keystr, table_ptr->list_ptr[idx].keystr ) == 0 ) { return false; } // Key is already in table.
+  collisions++;
+  hash = apg_hash_rehash( keystr );
+  idx  = hash % table_ptr->n;
+
+  // Then proceed with linear probing from the rehashed index.
+  for ( uint32_t i = 0; i < table_ptr->n; i++ ) {
+    if ( NULL == table_ptr->list_ptr[idx].value_ptr ) { goto apg_hash_store_enter_key; } // Needs to be at top of loop since also covers rehash's first check.
+    if ( strcmp( keystr, table_ptr->list_ptr[idx].keystr ) == 0 ) { return false; }      // Key is already in table.
+    collisions++;
+    idx = ( idx + 1 ) % table_ptr->n;
+  }
+
+  assert( false && "Shouldn't get here because it means the table is full, and we DO check for that earlier." );
+  return false;
+
+apg_hash_store_enter_key:
+  table_ptr->list_ptr[idx]        = (apg_hash_table_element_t){ .value_ptr = value_ptr };
+  table_ptr->list_ptr[idx].keystr = strdup( keystr ); // NOTE(Anton) Could use strndup here to guard against unterminated strings.
+  table_ptr->count_stored++;
+  if ( collision_ptr ) { *collision_ptr = *collision_ptr + collisions; }
+  return true;
+}
+
+bool apg_hash_search( const char* keystr, apg_hash_table_t* table_ptr, uint32_t* idx_ptr, uint32_t* collision_ptr ) {
+  if ( !keystr || !table_ptr || !idx_ptr || table_ptr->count_stored == 0 ) { return false; }
+
+  uint32_t hash = apg_hash( keystr );
+  uint32_t idx  = hash % table_ptr->n;
+  if ( !table_ptr->list_ptr[idx].value_ptr ) { return false; }
+
+  if ( strcmp( keystr, table_ptr->list_ptr[idx].keystr ) == 0 ) {
+    *idx_ptr = idx;
+    return true;
+  }
+  // First do a rehash.
+  if ( collision_ptr ) { ( *collision_ptr )++; }
+  hash = apg_hash_rehash( keystr );
+  idx  = hash % table_ptr->n;
+  // With linear probing following on from there.
+  for ( uint32_t i = 0; i < table_ptr->n; i++ ) {
+    if ( !table_ptr->list_ptr[idx].value_ptr ) { return false; }
+    if ( strcmp( keystr, table_ptr->list_ptr[idx].keystr ) == 0 ) {
+      *idx_ptr = idx;
+      return true;
+    }
+    if ( collision_ptr ) { ( *collision_ptr )++; }
+    idx = ( idx + 1 ) % table_ptr->n;
+  }
+  return false; // This only happens if the table is full, and the key isn't in there.
+}
+
+bool apg_hash_auto_expand( apg_hash_table_t* table_ptr, size_t max_bytes ) {
+  if ( !table_ptr || 0 == max_bytes ) { return false; }
+  if ( table_ptr->count_stored < table_ptr->n / 2 ) { return true; } // Already big enough.
+  uint32_t tmp_n = table_ptr->n * 2;
+  if ( tmp_n < table_ptr->n ) { return false; } // Overflow check.
+  size_t tmp_bytes = tmp_n * sizeof( apg_hash_table_element_t );
+  if ( tmp_bytes >= max_bytes ) { return false; } // Too much memory would be used.
+
+  apg_hash_table_t tmp_table = apg_hash_table_create( tmp_n );
+  if ( !tmp_table.list_ptr ) { return false; } // OOM.
+
+  // Rehash valid entries to new table size.
+  for ( uint32_t i = 0; i < table_ptr->n; i++ ) {
+    if ( table_ptr->list_ptr[i].value_ptr ) {
+      if ( !apg_hash_store( table_ptr->list_ptr[i].keystr, table_ptr->list_ptr[i].value_ptr, &tmp_table, NULL ) ) {
+        apg_hash_table_free( &tmp_table );
+        return false;
+      }
+    }
+  }
+  apg_hash_table_free( table_ptr ); // free everything including allocated strings.
+  *table_ptr = tmp_table;           // allocated list_ptr, including allocated strings, n, count_stored.
+  return true;
+}
+
+/*=================================================================================================
+GREEDY BEST-FIRST SEARCH
+=================================================================================================*/
+
+// Called whenever we check if an item has been visited already. should return -ve if key < element.
+static int _apg_gbfs_search_vset_comp_cb( const void* key_ptr, const void* element_ptr ) { return (int)( *(int64_t*)key_ptr - *(int64_t*)element_ptr ); }
+
+bool apg_gbfs( int64_t start_key, int64_t target_key, int64_t ( *h_cb_ptr )( int64_t key, int64_t target_key ),
+  int64_t ( *neighs_cb_ptr )( int64_t key, int64_t target_key, int64_t* neighs ), int64_t* reverse_path_ptr, int64_t* path_n, int64_t max_path_steps,
+  apg_gbfs_node_t* evaluated_nodes_ptr, int64_t evaluated_nodes_max, int64_t* visited_set_ptr, int64_t visited_set_max, apg_gbfs_node_t* queue_ptr, int64_t queue_max ) {
+  int64_t n_visited_set = 1, n_queue = 1, n_evaluated_nodes = 0;
+  visited_set_ptr[0] = start_key;                                                                                           // Mark start as visited
+  queue_ptr[0]       = (apg_gbfs_node_t){ .h = h_cb_ptr( start_key, target_key ), .parent_idx = -1, .our_key = start_key }; // and add to queue.
+  while ( n_queue > 0 ) {
+    // curr is vertex in queue w/ smallest h. Smallest h is always at the end of the queue for easy deletion.
+    apg_gbfs_node_t curr = queue_ptr[--n_queue];
+
+    int64_t neigh_keys[APG_GBFS_NEIGHBOURS_MAX];
+    int64_t n_neighs = neighs_cb_ptr( curr.our_key, target_key, neigh_keys );
+    if ( n_neighs > APG_GBFS_NEIGHBOURS_MAX ) { return false; }
+    bool neigh_added = false, found_path = false;
+    for ( int64_t neigh_idx = 0; neigh_idx < n_neighs; neigh_idx++ ) {
+      if ( neigh_keys[neigh_idx] == target_key ) {
+        found_path = neigh_added = true; // Resolve path including the final item's key. Break here and flag so that we add the final node.
+        break;
+      }
+
+      if ( bsearch( &neigh_keys[neigh_idx], visited_set_ptr, n_visited_set, sizeof( int64_t ), _apg_gbfs_search_vset_comp_cb ) != NULL ) { continue; }
+
+      if ( n_visited_set >= visited_set_max || n_queue >= queue_max ) { return false; }
+      { // Custom sort
+        // can probably do better than qsort's worst case O(n^2) with our knowledge of the data -> O(n) with a memcpy
+        visited_set_ptr[n_visited_set] = neigh_keys[neigh_idx]; // avoids if (comparison not made) check
+        for ( int64_t i = 0; i < n_visited_set; i++ ) {
+          if ( neigh_keys[neigh_idx] < visited_set_ptr[i] ) {
+            // src and dst overlap so using memmove instead of memcpy
+            memmove( &visited_set_ptr[i + 1], &visited_set_ptr[i], ( n_visited_set - i ) * sizeof( int64_t ) );
+            visited_set_ptr[i] = neigh_keys[neigh_idx];
+            break;
+          }
+        } // endfor
+        n_visited_set++;
+
+        int64_t our_h      = h_cb_ptr( neigh_keys[neigh_idx], target_key );
+        queue_ptr[n_queue] = (apg_gbfs_node_t){ .h = our_h, .parent_idx = n_evaluated_nodes, .our_key = neigh_keys[neigh_idx] };
+        for ( int64_t i = 0; i < n_queue; i++ ) {
+          if ( our_h > queue_ptr[i].h ) {
+            memmove( &queue_ptr[i + 1], &queue_ptr[i], ( n_queue - i ) * sizeof( apg_gbfs_node_t ) );
+            queue_ptr[i] = (apg_gbfs_node_t){ .h = our_h, .parent_idx = n_evaluated_nodes, .our_key = neigh_keys[neigh_idx] };
+            break;
+          }
+        } // endfor
+        n_queue++;
+      } // endblock custom sort
+      neigh_added = true;
+    } // endfor neighbours
+    if ( neigh_added ) {
+      if ( n_evaluated_nodes >= evaluated_nodes_max ) { return false; }
+      evaluated_nodes_ptr[n_evaluated_nodes++] = curr;
+    }
+    if ( found_path ) {
+      int64_t tmp_path_n             = 0;
+      int64_t parent_eval_idx        = n_evaluated_nodes - 1;
+      reverse_path_ptr[tmp_path_n++] = target_key;
+      for ( int64_t i = 0; i < n_evaluated_nodes; i++ ) {     // Some sort of timeout in case of logic error.
+        if ( tmp_path_n >= max_path_steps ) { return false; } // Maxed out path length.
+        apg_gbfs_node_t path_tmp       = evaluated_nodes_ptr[parent_eval_idx];
+        reverse_path_ptr[tmp_path_n++] = path_tmp.our_key;
+        parent_eval_idx                = path_tmp.parent_idx;
+        if ( path_tmp.parent_idx == -1 ) {
+          *path_n = tmp_path_n;
+          return true;
+        }
+      }
+      assert( false && "failed to find path back to start" );
+      return false;
+    }
+  } // endwhile queue not empty
+  return false;
+}
+
+#endif /* APG_IMPLEMENTATION */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APG_H_ */
+
+/*
+-------------------------------------------------------------------------------------
+This software is available under two licences - you may use it under either licence.
+-------------------------------------------------------------------------------------
+FIRST LICENCE OPTION
+
+>                                  Apache License
+>                            Version 2.0, January 2004
+>                         http://www.apache.org/licenses/
+>    Copyright 2019 Anton Gerdelan.
+>    Licensed under the Apache License, Version 2.0 (the "License");
+>    you may not use this file except in compliance with the License.
+>    You may obtain a copy of the License at
+>        http://www.apache.org/licenses/LICENSE-2.0
+>    Unless required by applicable law or agreed to in writing, software
+>    distributed under the License is distributed on an "AS IS" BASIS,
+>    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+>    See the License for the specific language governing permissions and
+>    limitations under the License.
+-------------------------------------------------------------------------------------
+SECOND LICENCE OPTION
+
+> This is free and unencumbered software released into the public domain.
+>
+> Anyone is free to copy, modify, publish, use, compile, sell, or
+> distribute this software, either in source code form or as a compiled
+> binary, for any purpose, commercial or non-commercial, and by any
+> means.
+>
+> In jurisdictions that recognize copyright laws, the author or authors
+> of this software dedicate any and all copyright interest in the
+> software to the public domain. We make this dedication for the benefit
+> of the public at large and to the detriment of our heirs and
+> successors. We intend this dedication to be an overt act of
+> relinquishment in perpetuity of all present and future rights to this
+> software under copyright law.
+>
+> THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+> EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+> MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+> IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+> OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+> ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+> OTHER DEALINGS IN THE SOFTWARE.
+>
+> For more information, please refer to <http://unlicense.org>
+-------------------------------------------------------------------------------------
+*/
@@ -1,2 +1,2 @@
 #!/bin/bash
-gcc -g main.c apg_pixfont.c fps_view.c gfx.c maths.c minimap.c -I ./ -I glad/include/ glad/src/gl.c -lglfw -lm
+gcc -g -D_POSIX_C_SOURCE=200809L main.c apg_pixfont.c caster.c fps_view.c gfx.c maths.c minimap.c -I ./ -I glad/include/ glad/src/gl.c -lglfw -lm -pthread
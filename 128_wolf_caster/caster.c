@@ -0,0 +1,193 @@
+#include "caster.h"
+#include "apg.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRANSPOSE_BLOCK 32 // Pixels square, per block of the transpose into row-major.
+
+typedef struct render_job_t {
+  caster_t* caster_ptr;
+  const uint8_t* tiles_ptr;
+  int tiles_w, tiles_h;
+  vec2_t pos, dir;
+  const caster_texture_t* walls;
+} render_job_t;
+
+typedef struct transpose_job_t {
+  const caster_t* caster_ptr;
+  uint8_t* rgb_ptr;
+} transpose_job_t;
+
+bool caster_init( caster_t* caster_ptr, int w, int h, float fov_degs ) {
+  assert( caster_ptr && w > 0 && h > 0 );
+  *caster_ptr = (caster_t){ .w = w, .h = h, .ceiling_rgb = { 0x05, 0x05, 0x05 }, .floor_rgb = { 0x33, 0x22, 0x11 } };
+  caster_ptr->cols_ptr     = malloc( (size_t)w * h * 3 );
+  caster_ptr->col_rots_ptr = malloc( sizeof( vec2_t ) * w );
+  caster_ptr->hits_ptr     = malloc( sizeof( caster_hit_t ) * w );
+  if ( !caster_ptr->cols_ptr || !caster_ptr->col_rots_ptr || !caster_ptr->hits_ptr ) {
+    caster_free( caster_ptr );
+    return false;
+  }
+  for ( int x = 0; x < w; x++ ) {
+    float rads                  = DEGS_TO_RADS * ( -0.5f * fov_degs + x * fov_degs / w );
+    caster_ptr->col_rots_ptr[x] = (vec2_t){ cosf( rads ), sinf( rads ) };
+    caster_ptr->hits_ptr[x]     = (caster_hit_t){ .dist = FLT_MAX };
+  }
+  return true;
+}
+
+void caster_free( caster_t* caster_ptr ) {
+  if ( !caster_ptr ) { return; }
+  free( caster_ptr->cols_ptr );
+  free( caster_ptr->col_rots_ptr );
+  free( caster_ptr->hits_ptr );
+  *caster_ptr = (caster_t){ .w = 0 };
+}
+
+bool caster_texture_from_image( const uint8_t* img_ptr, int w, int h, int n, float brightness, caster_texture_t* tex_ptr ) {
+  assert( img_ptr && w > 0 && h > 0 && n >= 3 && tex_ptr );
+  *tex_ptr            = (caster_texture_t){ .w = w, .h = h };
+  tex_ptr->texels_ptr = malloc( (size_t)w * h * 3 );
+  if ( !tex_ptr->texels_ptr ) { return false; }
+  for ( int v = 0; v < h; v++ ) {
+    for ( int u = 0; u < w; u++ ) {
+      for ( int c = 0; c < 3; c++ ) {
+        float scaled                                     = img_ptr[( v * w + u ) * n + c] * brightness;
+        tex_ptr->texels_ptr[( (size_t)u * h + v ) * 3 + c] = (uint8_t)APG_CLAMP( scaled, 0.0f, 255.0f );
+      }
+    }
+  }
+  return true;
+}
+
+void caster_texture_free( caster_texture_t* tex_ptr ) {
+  if ( !tex_ptr ) { return; }
+  free( tex_ptr->texels_ptr );
+  *tex_ptr = (caster_texture_t){ .w = 0 };
+}
+
+vec2_t caster_ray_dir( const caster_t* caster_ptr, int x, vec2_t dir ) {
+  vec2_t rot = caster_ptr->col_rots_ptr[x];
+  return (vec2_t){ dir.x * rot.x - dir.y * rot.y, dir.x * rot.y + dir.y * rot.x };
+}
+
+// Walks the grid from pos until it hits a wall or leaves the map.
+static caster_hit_t _cast( const render_job_t* job_ptr, vec2_t ray ) {
+  int tile_x = (int)floorf( job_ptr->pos.x ), tile_y = (int)floorf( job_ptr->pos.y );
+  int step_x = ray.x < 0.0f ? -1 : 1, step_y = ray.y < 0.0f ? -1 : 1;
+  // Distance along the ray between gridlines on each axis, and to the next gridline on each axis.
+  float delta_x  = 0.0f != ray.x ? fabsf( 1.0f / ray.x ) : INFINITY;
+  float delta_y  = 0.0f != ray.y ? fabsf( 1.0f / ray.y ) : INFINITY;
+  float side_x   = 0.0f != ray.x ? ( ray.x < 0.0f ? job_ptr->pos.x - tile_x : tile_x + 1.0f - job_ptr->pos.x ) * delta_x : INFINITY;
+  float side_y   = 0.0f != ray.y ? ( ray.y < 0.0f ? job_ptr->pos.y - tile_y : tile_y + 1.0f - job_ptr->pos.y ) * delta_y : INFINITY;
+  int max_steps  = job_ptr->tiles_w + job_ptr->tiles_h + 2;
+  for ( int i = 0; i < max_steps; i++ ) {
+    float dist    = 0.0f;
+    bool vertical = side_x < side_y;
+    if ( vertical ) {
+      dist = side_x;
+      side_x += delta_x;
+      tile_x += step_x;
+    } else {
+      dist = side_y;
+      side_y += delta_y;
+      tile_y += step_y;
+    }
+    if ( tile_x < 0 || tile_x >= job_ptr->tiles_w || tile_y < 0 || tile_y >= job_ptr->tiles_h ) { break; }
+    if ( job_ptr->tiles_ptr[tile_y * job_ptr->tiles_w + tile_x] ) {
+      vec2_t hit_pos = add_vec2( job_ptr->pos, mul_vec2_f( ray, dist ) );
+      return (caster_hit_t){ .pos = hit_pos, .dist = dist, .vertical = vertical };
+    }
+  }
+  return (caster_hit_t){ .pos = job_ptr->pos, .dist = FLT_MAX };
+}
+
+// Writes the first pixel then doubles the span already written, so long spans are a few large memcpy()s rather than a byte loop.
+static void _fill_span( uint8_t* dst_ptr, int n, const uint8_t* rgb ) {
+  if ( n <= 0 ) { return; }
+  memcpy( dst_ptr, rgb, 3 );
+  size_t done = 3, total = (size_t)n * 3;
+  while ( done < total ) {
+    size_t len = APG_MIN( done, total - done );
+    memcpy( &dst_ptr[done], dst_ptr, len );
+    done += len;
+  }
+}
+
+static void _render_column( const render_job_t* job_ptr, int x ) {
+  caster_t* caster_ptr    = job_ptr->caster_ptr;
+  int h                   = caster_ptr->h;
+  uint8_t* col_ptr        = &caster_ptr->cols_ptr[(size_t)x * h * 3];
+  caster_hit_t hit        = _cast( job_ptr, caster_ray_dir( caster_ptr, x, job_ptr->dir ) );
+  caster_ptr->hits_ptr[x] = hit;
+  if ( FLT_MAX == hit.dist ) {
+    _fill_span( col_ptr, h / 2, caster_ptr->ceiling_rgb );
+    _fill_span( &col_ptr[( h / 2 ) * 3], h - h / 2, caster_ptr->floor_rgb );
+    return;
+  }
+
+  // Distance along the view direction, rather than the ray, corrects the fish-eye effect. The column's cos gives it directly.
+  float perp_dist                 = APG_MAX( hit.dist * caster_ptr->col_rots_ptr[x].x, 1e-4f );
+  float proj_h                    = h / perp_dist;
+  float top                       = ( h - proj_h ) * 0.5f;
+  int y_first                     = APG_CLAMP( (int)ceilf( top - 0.5f ), 0, h );
+  int y_end                       = APG_CLAMP( (int)ceilf( top + proj_h - 0.5f ), y_first, h );
+  const caster_texture_t* tex_ptr = &job_ptr->walls[hit.vertical ? 1 : 0];
+  float u                         = hit.vertical ? hit.pos.y - floorf( hit.pos.y ) : hit.pos.x - floorf( hit.pos.x );
+  int tex_col                     = APG_MIN( (int)( u * tex_ptr->w ), tex_ptr->w - 1 );
+  const uint8_t* texels_ptr       = &tex_ptr->texels_ptr[(size_t)tex_col * tex_ptr->h * 3];
+
+  _fill_span( col_ptr, y_first, caster_ptr->ceiling_rgb );
+  // Texture rows step down the wall in 16.16 fixed point, sampled at pixel centres.
+  float rows_per_px = tex_ptr->h / proj_h;
+  uint32_t v        = (uint32_t)( ( y_first + 0.5f - top ) * rows_per_px * 65536.0f );
+  uint32_t v_step   = (uint32_t)( rows_per_px * 65536.0f );
+  uint32_t v_max    = (uint32_t)tex_ptr->h - 1;
+  uint8_t* dst_ptr  = &col_ptr[y_first * 3];
+  for ( int y = y_first; y < y_end; y++, dst_ptr += 3, v += v_step ) {
+    const uint8_t* src_ptr = &texels_ptr[APG_MIN( v >> 16, v_max ) * 3];
+    dst_ptr[0] = src_ptr[0], dst_ptr[1] = src_ptr[1], dst_ptr[2] = src_ptr[2];
+  }
+  _fill_span( dst_ptr, h - y_end, caster_ptr->floor_rgb );
+}
+
+static void _render_columns( int64_t begin, int64_t end, void* arg_ptr ) {
+  for ( int64_t x = begin; x < end; x++ ) { _render_column( (const render_job_t*)arg_ptr, (int)x ); }
+}
+
+void caster_render( caster_t* caster_ptr, const uint8_t* tiles_ptr, int tiles_w, int tiles_h, vec2_t pos, vec2_t dir, const caster_texture_t walls[2] ) {
+  assert( caster_ptr && caster_ptr->cols_ptr && tiles_ptr && walls && walls[0].texels_ptr && walls[1].texels_ptr );
+  render_job_t job = (render_job_t){
+    .caster_ptr = caster_ptr, .tiles_ptr = tiles_ptr, .tiles_w = tiles_w, .tiles_h = tiles_h, .pos = pos, .dir = dir, .walls = walls };
+  int grain = APG_MAX( caster_ptr->w / ( APG_MAX( apg_jobs_n_threads(), 1 ) * 4 ), 16 );
+  apg_jobs_parallel_for( 0, caster_ptr->w, grain, _render_columns, &job );
+}
+
+// A band of TRANSPOSE_BLOCK rows, in blocks, so reads from the columns and writes to the rows both stay within a few cache lines.
+static void _transpose_bands( int64_t begin, int64_t end, void* arg_ptr ) {
+  const transpose_job_t* job_ptr = (const transpose_job_t*)arg_ptr;
+  const caster_t* caster_ptr     = job_ptr->caster_ptr;
+  int w = caster_ptr->w, h = caster_ptr->h;
+  for ( int64_t band = begin; band < end; band++ ) {
+    int y_first = (int)band * TRANSPOSE_BLOCK, y_end = APG_MIN( y_first + TRANSPOSE_BLOCK, h );
+    for ( int x_first = 0; x_first < w; x_first += TRANSPOSE_BLOCK ) {
+      int x_end = APG_MIN( x_first + TRANSPOSE_BLOCK, w );
+      for ( int y = y_first; y < y_end; y++ ) {
+        const uint8_t* src_ptr = &caster_ptr->cols_ptr[( (size_t)x_first * h + y ) * 3];
+        uint8_t* dst_ptr       = &job_ptr->rgb_ptr[( (size_t)y * w + x_first ) * 3];
+        for ( int x = x_first; x < x_end; x++, src_ptr += (size_t)h * 3, dst_ptr += 3 ) {
+          dst_ptr[0] = src_ptr[0], dst_ptr[1] = src_ptr[1], dst_ptr[2] = src_ptr[2];
+        }
+      }
+    }
+  }
+}
+
+void caster_to_row_major( const caster_t* caster_ptr, uint8_t* rgb_ptr ) {
+  assert( caster_ptr && caster_ptr->cols_ptr && rgb_ptr );
+  transpose_job_t job = (transpose_job_t){ .caster_ptr = caster_ptr, .rgb_ptr = rgb_ptr };
+  apg_jobs_parallel_for( 0, ( caster_ptr->h + TRANSPOSE_BLOCK - 1 ) / TRANSPOSE_BLOCK, 1, _transpose_bands, &job );
+}
@@ -0,0 +1,57 @@
+/* DDA raycasting core for the first-person view, kept free of OpenGL so it can run headless.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Each screen column's ray is the view direction rotated by a per-column (cos, sin) pair, computed once at init, so a frame has no trig.
+Rays walk the tile grid with an integer DDA: one compare and one add per gridline crossed, and the distance to the hit falls out of the
+walk, with no square roots.
+
+The framebuffer is column-major: a column's pixels are contiguous, top first, so a wall, ceiling, or floor span is a run of sequential
+writes. Wall textures are stored transposed the same way, so a span reads down one contiguous texture column. Columns are split over the
+apg.h job system. The demo uploads the frame as it is, as a texture h wide and w tall, and swaps texture coordinates when drawing it.
+caster_to_row_major() transposes it, in cache-sized blocks, for anything that needs an ordinary row-major image.
+*/
+
+#pragma once
+#include "maths.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// A wall texture, transposed: texel (u,v) is at ( u * h + v ) * 3, RGB.
+typedef struct caster_texture_t {
+  int w, h;
+  uint8_t* texels_ptr;
+} caster_texture_t;
+
+typedef struct caster_hit_t {
+  vec2_t pos;    // Where the ray hit a wall, in tiles.
+  float dist;    // Along the ray, which is unit length. FLT_MAX if the ray left the map.
+  bool vertical; // Hit a vertical gridline (x is a whole number), rather than a horizontal one.
+} caster_hit_t;
+
+typedef struct caster_t {
+  int w, h;
+  uint8_t* cols_ptr;      // Column-major RGB framebuffer.
+  vec2_t* col_rots_ptr;   // Per column, cos and sin of its angle from the view direction.
+  caster_hit_t* hits_ptr; // Per column, from the last caster_render().
+  uint8_t ceiling_rgb[3], floor_rgb[3];
+} caster_t;
+
+// Columns are spread at equal angles across fov_degs. Returns false if out of memory.
+bool caster_init( caster_t* caster_ptr, int w, int h, float fov_degs );
+
+void caster_free( caster_t* caster_ptr );
+
+// Transposes an image with n >= 3 channels, rows top-first, scaling its colours by brightness. Returns false if out of memory.
+bool caster_texture_from_image( const uint8_t* img_ptr, int w, int h, int n, float brightness, caster_texture_t* tex_ptr );
+
+void caster_texture_free( caster_texture_t* tex_ptr );
+
+// Casts every column from pos along dir (unit length) over a tiles_w x tiles_h grid, where non-zero tiles are walls.
+// Walls hit on horizontal gridlines use walls[0], and on vertical gridlines walls[1].
+void caster_render( caster_t* caster_ptr, const uint8_t* tiles_ptr, int tiles_w, int tiles_h, vec2_t pos, vec2_t dir, const caster_texture_t walls[2] );
+
+// The direction of column x's ray for a view direction dir.
+vec2_t caster_ray_dir( const caster_t* caster_ptr, int x, vec2_t dir );
+
+// Copies the framebuffer into a row-major w x h RGB image.
+void caster_to_row_major( const caster_t* caster_ptr, uint8_t* rgb_ptr );
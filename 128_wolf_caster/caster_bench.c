@@ -0,0 +1,229 @@
+/* Headless benchmark for the raycaster: ms per frame at the demo's resolution and at 1080p, without a window.
+Author:   Anton Gerdelan  antongerdelan.net
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L caster_bench.c caster.c maths.c -I ./ -lm -pthread -o caster_bench
+Run:
+  ./caster_bench [n_frames] [-ppm]
+
+Renders n_frames (default 120) walking and turning through the demo's 8x8 map, and through a 64x64 map of scattered pillars where rays
+travel further. `reference` is the original fps_view_update_image() loop: rotate_vec2() per column, stepping by comparing lengths, and
+row-major writes. `cast` is caster_render() into the column-major framebuffer. The demo uploads that as it is and swaps texture
+coordinates in its shader, so `speedup` is reference/cast. `transpose` is caster_to_row_major() after it, for anything that does need
+row-major pixels, such as the PPM. With -ppm the last 1080p frame of each map is written to caster_<map>.ppm.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include "caster.h"
+#include "maths.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FOV_DEGS 60.0f
+#define BIG_N 64
+
+static const int _resolutions[][2] = { { 320, 168 }, { 1920, 1080 } };
+
+static const uint8_t _demo_tiles[8 * 8] = {
+  1, 1, 1, 1, 1, 1, 1, 1, // 0
+  1, 0, 1, 0, 1, 0, 0, 1, // 1
+  2, 0, 1, 0, 1, 0, 0, 1, // 2
+  2, 0, 0, 0, 0, 0, 0, 1, // 3
+  3, 0, 0, 0, 1, 1, 1, 1, // 4
+  3, 0, 0, 1, 1, 0, 0, 1, // 5
+  1, 1, 0, 0, 0, 0, 0, 1, // 6
+  1, 1, 1, 1, 1, 1, 1, 1  // 7
+};
+
+typedef struct map_t {
+  const char* name;
+  const uint8_t* tiles_ptr;
+  int w, h;
+  vec2_t from, to; // The walk, along empty tiles.
+} map_t;
+
+typedef struct texture_rm_t {
+  uint8_t* img_ptr;
+  int w, h, n;
+} texture_rm_t;
+
+// The original fps_view_update_image() loop, without the minimap plots, for comparison.
+static void _reference_render( uint8_t* img_ptr, int w, int h, const map_t* map_ptr, vec2_t pos, vec2_t dir, const texture_rm_t walls[2] ) {
+  const uint8_t ceiling_colour[3] = { 0x05, 0x05, 0x05 }, floor_colour[3] = { 0x33, 0x22, 0x11 };
+  for ( int y = 0; y < h; y++ ) {
+    for ( int x = 0; x < w; x++ ) { memcpy( &img_ptr[( y * w + x ) * 3], y < h / 2 ? ceiling_colour : floor_colour, 3 ); }
+  }
+  vec2_t first_ray = rotate_vec2( dir, DEGS_TO_RADS * -FOV_DEGS * 0.5f );
+  for ( int col_x = 0; col_x < w; col_x++ ) {
+    vec2_t curr_ray       = rotate_vec2( first_ray, DEGS_TO_RADS * col_x * FOV_DEGS / w );
+    float player_to_horiz = pos.y - floorf( pos.y );
+    float player_to_vert  = pos.x - floorf( pos.x );
+    vec2_t ray_dir_mod    = (vec2_t){ 1.0f, 1.0f };
+    if ( curr_ray.x > 0 ) {
+      player_to_vert = 1.0f - player_to_vert;
+      ray_dir_mod.x  = -1.0f;
+    }
+    if ( curr_ray.y > 0 ) {
+      player_to_horiz = 1.0f - player_to_horiz;
+      ray_dir_mod.y   = -1.0f;
+    }
+    vec2_t curr_pos = pos;
+    float xs_per_y = 0.0f, ys_per_x = 0.0f;
+    if ( 0.0f != curr_ray.y ) { xs_per_y = fabsf( curr_ray.x / curr_ray.y ); }
+    if ( 0.0f != curr_ray.x ) { ys_per_x = fabsf( curr_ray.y / curr_ray.x ); }
+    vec2_t curr_horiz = { .x = curr_pos.x - player_to_horiz * xs_per_y * ray_dir_mod.x, .y = curr_pos.y - player_to_horiz * ray_dir_mod.y };
+    vec2_t curr_vert  = { .x = curr_pos.x - player_to_vert * ray_dir_mod.x, .y = curr_pos.y - player_to_vert * ys_per_x * ray_dir_mod.y };
+    for ( int step = 0; step < map_ptr->w + map_ptr->h; step++ ) {
+      float curr_horiz_dist  = length_vec2( sub_vec2( curr_horiz, curr_pos ) );
+      float curr_vert_dist   = length_vec2( sub_vec2( curr_vert, curr_pos ) );
+      bool curr_pos_is_horiz = curr_horiz_dist <= curr_vert_dist;
+      curr_pos               = curr_pos_is_horiz ? curr_horiz : curr_vert;
+      int curr_tile_x        = floorf( curr_pos.x - 0.0001f * ray_dir_mod.x );
+      int curr_tile_y        = floorf( curr_pos.y - 0.0001f * ray_dir_mod.y );
+      if ( curr_tile_x < 0 || curr_tile_x >= map_ptr->w || curr_tile_y < 0 || curr_tile_y >= map_ptr->h ) { break; }
+      if ( map_ptr->tiles_ptr[curr_tile_y * map_ptr->w + curr_tile_x] ) {
+        vec2_t vec_to_hit              = sub_vec2( curr_pos, pos );
+        float proj_wall_height         = h / length_vec2( project_vec2( vec_to_hit, normalise_vec2( dir ) ) );
+        int line_height                = APG_CLAMP( proj_wall_height, 0, h );
+        float prop_of_height_on_screen = h / proj_wall_height;
+        int actual_img_h               = APG_CLAMP( prop_of_height_on_screen, 0.0f, 1.0f ) * walls[0].h;
+        int actual_first_row_idx       = ( walls[0].h - actual_img_h ) / 2;
+        int half_gap                   = ( h - line_height ) / 2;
+        for ( int row_y = half_gap; row_y < h - half_gap; row_y++ ) {
+          float row_fac  = (float)( row_y - half_gap ) / (float)( line_height );
+          float prop_x   = curr_pos.x - floorf( curr_pos.x );
+          float prop_y   = curr_pos.y - floorf( curr_pos.y );
+          int img_col    = (int)( prop_y * (float)( walls[0].w - 1 ) );
+          int img_row    = (int)( row_fac * (float)( actual_img_h - 1 ) ) + actual_first_row_idx;
+          bool hit_horiz = false;
+          if ( prop_x > prop_y ) {
+            img_col   = (int)( prop_x * (float)( walls[0].w - 1 ) );
+            hit_horiz = true;
+          }
+          uint8_t wall_rgb[3];
+          const texture_rm_t* wall_ptr = &walls[hit_horiz ? 0 : 1];
+          memcpy( wall_rgb, &wall_ptr->img_ptr[( img_row * wall_ptr->h + img_col ) * wall_ptr->n], 3 );
+          if ( !hit_horiz ) {
+            wall_rgb[0] *= 0.66;
+            wall_rgb[1] *= 0.66;
+            wall_rgb[2] *= 0.66;
+          }
+          memcpy( &img_ptr[( row_y * w + col_x ) * 3], wall_rgb, 3 );
+        }
+        break;
+      }
+      curr_horiz = curr_pos_is_horiz ? (vec2_t){ curr_pos.x - xs_per_y * ray_dir_mod.x, curr_pos.y - 1.0f * ray_dir_mod.y } : curr_horiz;
+      curr_vert  = curr_pos_is_horiz ? curr_vert : (vec2_t){ curr_pos.x - 1.0f * ray_dir_mod.x, curr_pos.y - ys_per_x * ray_dir_mod.y };
+    }
+  }
+}
+
+// Walks from `from` to `to`, turning three full circles on the way.
+static void _view_on_path( const map_t* map_ptr, int frame, int n_frames, vec2_t* pos_ptr, vec2_t* dir_ptr ) {
+  float t    = (float)frame / n_frames;
+  *pos_ptr   = add_vec2( map_ptr->from, mul_vec2_f( sub_vec2( map_ptr->to, map_ptr->from ), t ) );
+  float rads = t * 3.0f * 2.0f * PI;
+  *dir_ptr   = (vec2_t){ cosf( rads ), sinf( rads ) };
+}
+
+static bool _write_ppm( const char* fn, const uint8_t* rgb_ptr, int w, int h ) {
+  FILE* f = fopen( fn, "wb" );
+  if ( !f ) { return false; }
+  bool ok = fprintf( f, "P6\n%i %i\n255\n", w, h ) > 0 && 1 == fwrite( rgb_ptr, (size_t)w * h * 3, 1, f );
+  return 0 == fclose( f ) && ok;
+}
+
+static bool _bench_map( const map_t* map_ptr, const texture_rm_t images[2], const caster_texture_t walls[2], int n_frames, bool write_ppm ) {
+  for ( int r = 0; r < (int)( sizeof( _resolutions ) / sizeof( _resolutions[0] ) ); r++ ) {
+    int w = _resolutions[r][0], h = _resolutions[r][1];
+    caster_t caster;
+    uint8_t* rgb_ptr = malloc( (size_t)w * h * 3 );
+    if ( !rgb_ptr || !caster_init( &caster, w, h, FOV_DEGS ) ) {
+      free( rgb_ptr );
+      return false;
+    }
+    double reference_s = 0.0, cast_s = 0.0, transpose_s = 0.0;
+    for ( int f = 0; f < n_frames; f++ ) {
+      vec2_t pos, dir;
+      _view_on_path( map_ptr, f, n_frames, &pos, &dir );
+      double t0 = apg_time_s();
+      _reference_render( rgb_ptr, w, h, map_ptr, pos, dir, images );
+      double t1 = apg_time_s();
+      caster_render( &caster, map_ptr->tiles_ptr, map_ptr->w, map_ptr->h, pos, dir, walls );
+      double t2 = apg_time_s();
+      caster_to_row_major( &caster, rgb_ptr );
+      double t3 = apg_time_s();
+      reference_s += t1 - t0;
+      cast_s += t2 - t1;
+      transpose_s += t3 - t2;
+    }
+    printf( "%-8s %4ix%-4i %7i %13.3f %9.3f %13.3f %8.1fx\n", map_ptr->name, w, h, APG_MAX( apg_jobs_n_threads(), 1 ), reference_s * 1000.0 / n_frames,
+      cast_s * 1000.0 / n_frames, transpose_s * 1000.0 / n_frames, reference_s / cast_s );
+    if ( write_ppm && 1080 == h ) {
+      char fn[256];
+      snprintf( fn, sizeof( fn ), "caster_%s.ppm", map_ptr->name );
+      if ( !_write_ppm( fn, rgb_ptr, w, h ) ) { fprintf( stderr, "ERROR: writing `%s`\n", fn ); }
+    }
+    caster_free( &caster );
+    free( rgb_ptr );
+  }
+  return true;
+}
+
+int main( int argc, char** argv ) {
+  int n_frames   = 120;
+  bool write_ppm = false;
+  for ( int i = 1; i < argc; i++ ) {
+    if ( 0 == strcmp( argv[i], "-ppm" ) ) {
+      write_ppm = true;
+    } else {
+      n_frames = APG_MAX( atoi( argv[i] ), 1 );
+    }
+  }
+  apg_time_init();
+  texture_rm_t images[2]     = { { NULL } };
+  caster_texture_t walls[2]  = { { 0 } };
+  const char* image_files[2] = { "data/greenwall.png", "data/greenwall_secret.png" };
+  for ( int i = 0; i < 2; i++ ) {
+    images[i].img_ptr = stbi_load( image_files[i], &images[i].w, &images[i].h, &images[i].n, 0 );
+    if ( !images[i].img_ptr || images[i].n < 3 ||
+         !caster_texture_from_image( images[i].img_ptr, images[i].w, images[i].h, images[i].n, 0 == i ? 1.0f : 0.66f, &walls[i] ) ) {
+      fprintf( stderr, "ERROR: loading `%s`\n", image_files[i] );
+      return 1;
+    }
+  }
+  // A bordered map of scattered pillars, with a clear row through the middle to walk along.
+  uint8_t* big_tiles_ptr = calloc( BIG_N * BIG_N, 1 );
+  if ( !big_tiles_ptr ) { return 1; }
+  apg_rand_t seed = 1;
+  for ( int y = 0; y < BIG_N; y++ ) {
+    for ( int x = 0; x < BIG_N; x++ ) {
+      bool border                  = 0 == x || 0 == y || BIG_N - 1 == x || BIG_N - 1 == y;
+      bool pillar                  = BIG_N / 2 != y && apg_rand_r( &seed ) % 100 < 4;
+      big_tiles_ptr[y * BIG_N + x] = border || pillar ? 1 : 0;
+    }
+  }
+  map_t maps[2] = { { .name = "demo", .tiles_ptr = _demo_tiles, .w = 8, .h = 8, .from = { 1.5f, 3.5f }, .to = { 6.5f, 3.5f } },
+    { .name = "pillars", .tiles_ptr = big_tiles_ptr, .w = BIG_N, .h = BIG_N, .from = { 1.5f, BIG_N / 2 + 0.5f }, .to = { BIG_N - 1.5f, BIG_N / 2 + 0.5f } } };
+
+  bool ok = true;
+  printf( "%i frames per run\n", n_frames );
+  printf( "%-8s %9s %7s %13s %9s %13s %9s\n", "map", "res", "threads", "reference ms", "cast ms", "transpose ms", "speedup" );
+  for ( int i = 0; ok && i < 2; i++ ) { ok = _bench_map( &maps[i], images, walls, n_frames, false ); } // before apg_jobs_init(), on this thread only
+  if ( !apg_jobs_init( 0 ) ) { return 1; }
+  for ( int i = 0; ok && i < 2; i++ ) { ok = _bench_map( &maps[i], images, walls, n_frames, write_ppm ); }
+  apg_jobs_free();
+
+  for ( int i = 0; i < 2; i++ ) {
+    stbi_image_free( images[i].img_ptr );
+    caster_texture_free( &walls[i] );
+  }
+  free( big_tiles_ptr );
+  return ok ? 0 : 1;
+}
@@ -1,183 +1,74 @@
 #include "game.h"
+#include <float.h>
 
 fps_view_t fps_view_init( int w, int h ) {
-  fps_view_t fps_view = (fps_view_t){ .img_ptr = NULL };
-  fps_view.img_ptr    = calloc( w * h * 3, 1 );
-
+  fps_view_t fps_view = (fps_view_t){ .tex.handle = 0 };
+  bool ret            = caster_init( &fps_view.caster, w, h, FOV_DEGS );
+  assert( ret );
   uint8_t colour[] = { 0x22, 0x22, 0x22 };
-  for ( int i = 0; i < w * h * 3; i += 3 ) { memcpy( &fps_view.img_ptr[i], colour, 3 ); }
-
-  fps_view.tex = gfx_create_texture_from_mem( w, h, 3, fps_view.img_ptr );
+  for ( int i = 0; i < w * h * 3; i += 3 ) { memcpy( &fps_view.caster.cols_ptr[i], colour, 3 ); }
+  memcpy( fps_view.caster.ceiling_rgb, &ceiling_colour.r, 3 );
+  memcpy( fps_view.caster.floor_rgb, &floor_colour.r, 3 );
+  // Walls on vertical gridlines use the second image, darkened.
+  assert( wall_images[0] && wall_images[1] && "load wall images before fps_view_init()" );
+  ret = caster_texture_from_image( wall_images[0], wall_img_w, wall_img_h, wall_img_n, 1.0f, &fps_view.walls[0] );
+  assert( ret );
+  ret = caster_texture_from_image( wall_images[1], wall_img_w, wall_img_h, wall_img_n, 0.66f, &fps_view.walls[1] );
+  assert( ret );
+
+  // The caster's framebuffer is column-major, so it goes up as it is, as a texture h wide and w tall, and transposed_shader turns it round.
+  fps_view.tex = gfx_create_texture_from_mem( h, w, 3, fps_view.caster.cols_ptr );
   return fps_view;
 }
 
 void fps_view_free( fps_view_t* fps_view_ptr ) {
   assert( fps_view_ptr );
-  if ( fps_view_ptr->img_ptr ) { free( fps_view_ptr->img_ptr ); }
+  caster_free( &fps_view_ptr->caster );
+  caster_texture_free( &fps_view_ptr->walls[0] );
+  caster_texture_free( &fps_view_ptr->walls[1] );
   glDeleteTextures( 1, &fps_view_ptr->tex.handle );
-  *fps_view_ptr = (fps_view_t){ .img_ptr = NULL };
+  *fps_view_ptr = (fps_view_t){ .tex.handle = 0 };
 }
 
-void fps_view_update_image( fps_view_t fps_view, const uint8_t* tiles_ptr, int tiles_w, int tiles_h, player_t player ) {
-  assert( tiles_ptr );
-  { // Draw ceiling and floor.
-    for ( int y = 0; y < fps_view.tex.h / 2; y++ ) {
-      for ( int x = 0; x < fps_view.tex.w; x++ ) {
-        int mem_idx = ( y * fps_view.tex.w + x ) * 3;
-        memcpy( &fps_view.img_ptr[mem_idx], &ceiling_colour.r, 3 );
-      }
-    }
-    for ( int y = fps_view.tex.h / 2; y < fps_view.tex.h; y++ ) {
-      for ( int x = 0; x < fps_view.tex.w; x++ ) {
-        int mem_idx = ( y * fps_view.tex.w + x ) * 3;
-        memcpy( &fps_view.img_ptr[mem_idx], &floor_colour.r, 3 );
-      }
+// Plots the middle column's ray on the minimap: lines to the nearest gridlines, each gridline crossing on the way, and the hit.
+static void _plot_middle_ray( fps_view_t fps_view, player_t player ) {
+  if ( !minimap_draw_rays ) { return; }
+  int col_x        = fps_view.caster.w / 2;
+  vec2_t ray       = caster_ray_dir( &fps_view.caster, col_x, player.dir );
+  caster_hit_t hit = fps_view.caster.hits_ptr[col_x];
+  // Distance to closest gridlines.
+  float player_to_horiz = ray.y > 0.0f ? ceilf( player.pos.y ) - player.pos.y : player.pos.y - floorf( player.pos.y );
+  float player_to_vert  = ray.x > 0.0f ? ceilf( player.pos.x ) - player.pos.x : player.pos.x - floorf( player.pos.x );
+  mmap_plot_line( player.pos, (vec2_t){ player.pos.x, player.pos.y + ( ray.y > 0.0f ? player_to_horiz : -player_to_horiz ) }, to_nearest_gridlines_colour );
+  mmap_plot_line( player.pos, (vec2_t){ player.pos.x + ( ray.x > 0.0f ? player_to_vert : -player_to_vert ), player.pos.y }, to_nearest_gridlines_colour );
+  float max_dist = APG_MIN( hit.dist, (float)( TILES_W + TILES_H ) );
+  if ( 0.0f != ray.y ) {
+    for ( float t = player_to_horiz / fabsf( ray.y ); t <= max_dist; t += 1.0f / fabsf( ray.y ) ) {
+      mmap_plot_cross( add_vec2( player.pos, mul_vec2_f( ray, t ) ), intersect_point_colour_a );
     }
   }
-  vec2_t first_ray = rotate_vec2( player.dir, DEGS_TO_RADS * -FOV_HALF_DEGS );
-  for ( int col_x = 0; col_x < fps_view.tex.w; col_x++ ) {
-    bool do_plot = ( col_x == fps_view.tex.w / 2 ); // Only plot this ray.
-
-    // Work out ray direction.
-    vec2_t curr_ray = rotate_vec2( first_ray, DEGS_TO_RADS * col_x * DEGS_PER_RAY );
-    // Distance to closest gridlines.
-    float player_to_horiz = player.pos.y - floorf( player.pos.y );
-    float player_to_vert  = player.pos.x - floorf( player.pos.x );
-    // Use the ray direction vector to determine which if rays are going l/r or u/d.
-    vec2_t ray_dir_mod = (vec2_t){ 1.0f, 1.0f };
-    if ( curr_ray.x > 0 ) {
-      player_to_vert = 1.0f - player_to_vert;
-      ray_dir_mod.x  = -1.0f;
+  if ( 0.0f != ray.x ) {
+    for ( float t = player_to_vert / fabsf( ray.x ); t <= max_dist; t += 1.0f / fabsf( ray.x ) ) {
+      mmap_plot_cross( add_vec2( player.pos, mul_vec2_f( ray, t ) ), intersect_point_colour_b );
     }
-    if ( curr_ray.y > 0 ) {
-      player_to_horiz = 1.0f - player_to_horiz;
-      ray_dir_mod.y   = -1.0f;
-    }
-    if ( do_plot ) {
-      // plot helper lines to show which nearest grid boundary. I use 'horiz,vert' to refer to gridlines as 'x,y' is very easily confused.
-      mmap_plot_line( player.pos, (vec2_t){ player.pos.x, player.pos.y - player_to_horiz * ray_dir_mod.y }, to_nearest_gridlines_colour );
-      mmap_plot_line( player.pos, (vec2_t){ player.pos.x - player_to_vert * ray_dir_mod.x, player.pos.y }, to_nearest_gridlines_colour );
-    }
-    vec2_t curr_pos = player.pos;
-    // Skip a whole lot of trig by using linear algebra to get ray gradient for both axes.
-    float xs_per_y = 0.0f, ys_per_x = 0.0f;
-    // TODO - handle error at start here for middle ray at 0.
-    if ( 0.0f != curr_ray.y ) { xs_per_y = fabsf( curr_ray.x / curr_ray.y ); }
-    if ( 0.0f != curr_ray.x ) { ys_per_x = fabsf( curr_ray.y / curr_ray.x ); }
-    // Got position of the 2 intersections.
-    float xs_to_horiz = player_to_horiz * xs_per_y;
-    vec2_t curr_horiz = { .x = curr_pos.x - xs_to_horiz * ray_dir_mod.x, .y = curr_pos.y - player_to_horiz * ray_dir_mod.y };
-    float ys_to_vert  = player_to_vert * ys_per_x;
-    vec2_t curr_vert  = { .x = curr_pos.x - player_to_vert * ray_dir_mod.x, .y = curr_pos.y - ys_to_vert * ray_dir_mod.y };
-
-    for ( int step = 0; step < RAY_STEPS_MAX; step++ ) {
-      if ( do_plot ) {
-        mmap_plot_cross( curr_horiz, intersect_point_colour_a );
-        mmap_plot_cross( curr_vert, intersect_point_colour_b );
-      }
-      float curr_horiz_dist = length_vec2( sub_vec2( curr_horiz, curr_pos ) );
-      float curr_vert_dist  = length_vec2( sub_vec2( curr_vert, curr_pos ) );
-      // Choose intersection with shortest path from player for first intersection.
-      vec2_t prev_pos        = curr_pos; // just used for plots.
-      curr_pos               = curr_horiz;
-      bool curr_pos_is_horiz = true;
-      if ( curr_horiz_dist <= curr_vert_dist ) {
-      } else {
-        curr_pos          = curr_vert;
-        curr_pos_is_horiz = false;
-      }
-
-      { // Work out if hit a wall.// Continue to next horiz and vert intersections.
-        int curr_tile_x = floorf( curr_pos.x - 0.0001f * ray_dir_mod.x );
-        int curr_tile_y = floorf( curr_pos.y - 0.0001f * ray_dir_mod.y );
-        if ( curr_tile_x < 0 || curr_tile_x >= TILES_W || curr_tile_y < 0 || curr_tile_y >= TILES_H ) { break; }
-        int curr_tile_idx  = curr_tile_y * TILES_W + curr_tile_x;
-        int curr_tile_type = tiles_ptr[curr_tile_idx];
-
-        bool hit          = true;
-        rgb_t wall_colour = error_colour;
-        switch ( curr_tile_type ) {
-        case 0: hit = false; break;
-        case 1: wall_colour = blue_tile_colour; break;
-        case 2: wall_colour = green_tile_colour; break;
-        case 3: wall_colour = red_tile_colour; break;
-        default: break;
-        } // endswith
-        if ( hit ) {
-          float wall_height = fps_view.tex.h;
-          vec2_t vec_to_hit = sub_vec2( curr_pos, player.pos );
-          // Using ray_dist_to_hit directly gives a fish-eye effect.
-          float ray_dist_to_hit  = length_vec2( vec_to_hit );
-          float proj_wall_height = ( wall_height / ray_dist_to_hit ); // * dist_player_to_viewplane
-
-          // correct fish-eye
-          {
-            vec2_t projected = project_vec2( vec_to_hit, normalise_vec2( player.dir ) );
-            float corrected  = length_vec2( projected );
-            proj_wall_height = ( wall_height / corrected ); // * dist_player_to_viewplane
-          }
-
-          int line_height = APG_CLAMP( proj_wall_height, 0, fps_view.tex.h );
-
-          // TODO magnification correction when top and bottom of wall are out of shot.
-        
-          float prop_of_height_on_screen = fps_view.tex.h / proj_wall_height;
-          int actual_img_h = APG_CLAMP( prop_of_height_on_screen, 0.0f, 1.0f ) * wall_img_h;
-          int actual_first_row_idx = (wall_img_h - actual_img_h) / 2;
-        //  printf( "%f %f\n", proj_wall_height, prop_of_height_on_screen );
-
-          int half_gap = ( fps_view.tex.h - line_height ) / 2;
-
-          for ( int row_y = half_gap; row_y < fps_view.tex.h - half_gap; row_y++ ) {
-            // Texture coords based on intersection point on tile.
-            float row_fac = (float)( row_y - half_gap)  / (float)( line_height);
-
-            float prop_x  = curr_pos.x - floorf( curr_pos.x );
-            float prop_y  = curr_pos.y - floorf( curr_pos.y );
-            int img_col = img_col = (int)( prop_y * (float)( wall_img_w - 1 ) );
-            int img_row           = (int)( row_fac * (float)( actual_img_h - 1 ) ) + actual_first_row_idx;
-            bool hit_horiz        = false;
-            if ( prop_x > prop_y ) {
-              img_col   = (int)( prop_x * (float)( wall_img_w - 1 ) );
-              hit_horiz = true;
-            }
-            // pick image a/b side based on intersection side.
-            uint8_t wall_rgb[3];
-            int img_idx       = ( img_row * wall_img_h + img_col ) * wall_img_n;
-            uint8_t* wall_img = hit_horiz ? wall_images[0] : wall_images[1];
-            memcpy( wall_rgb, &wall_img[img_idx], 3 );
-            // darken
-            if ( !hit_horiz ) {
-              wall_rgb[0] *= 0.66;
-              wall_rgb[1] *= 0.66;
-              wall_rgb[2] *= 0.66;
-            }
-
-            int mem_idx = ( row_y * fps_view.tex.w + col_x ) * 3;
-            memcpy( &fps_view.img_ptr[mem_idx], wall_rgb, 3 );
-            // memcpy( &fps_view.img_ptr[mem_idx], &wall_colour.r, 3 );
-          }
-          if ( do_plot ) { mmap_plot_line( player.pos, curr_pos, intersect_hit_colour ); }
-
-          continue;
-        }
-      } // endblock hit
+  }
+  if ( hit.dist < FLT_MAX ) { mmap_plot_line( player.pos, hit.pos, intersect_hit_colour ); }
+}
 
-      // Continue to next horiz and vert intersections.
-      curr_horiz = curr_pos_is_horiz ? (vec2_t){ curr_pos.x - xs_per_y * ray_dir_mod.x, curr_pos.y - 1.0f * ray_dir_mod.y } : curr_horiz;
-      curr_vert  = curr_pos_is_horiz ? curr_vert : (vec2_t){ curr_pos.x - 1.0f * ray_dir_mod.x, curr_pos.y - ys_per_x * ray_dir_mod.y };
-    } // endfor ray step
-  } // endfor columns
+void fps_view_update_image( fps_view_t fps_view, const uint8_t* tiles_ptr, int tiles_w, int tiles_h, player_t player ) {
+  assert( tiles_ptr );
+  caster_render( &fps_view.caster, tiles_ptr, tiles_w, tiles_h, player.pos, normalise_vec2( player.dir ), fps_view.walls );
+  _plot_middle_ray( fps_view, player );
 
-  gfx_update_texture_from_mem( &fps_view.tex, fps_view.img_ptr );
+  gfx_update_texture_from_mem( &fps_view.tex, fps_view.caster.cols_ptr );
 }
 
 void fps_view_draw( fps_view_t fps_view ) {
-  glUseProgram( textured_shader.program );
+  glUseProgram( transposed_shader.program );
   glBindVertexArray( quad_mesh.vao );
   glActiveTexture( GL_TEXTURE0 );
   glBindTexture( GL_TEXTURE_2D, fps_view.tex.handle );
-  glUniform2f( textured_shader.u_scale, 1.0f, 1.0f );
-  glUniform2f( textured_shader.u_pos, 0.0f, 0.0f );
+  glUniform2f( transposed_shader.u_scale, 1.0f, 1.0f );
+  glUniform2f( transposed_shader.u_pos, 0.0f, 0.0f );
   glDrawArrays( quad_mesh.primitive, 0, quad_mesh.n_points );
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "apg_pixfont.h"
+#include "caster.h"
 #include "gfx.h"
 #include "maths.h"
 #include <assert.h>
@@ -41,7 +42,8 @@ typedef struct player_t {
 
 typedef struct fps_view_t {
   texture_t tex;
-  uint8_t* img_ptr;
+  caster_t caster; // Its column-major framebuffer is uploaded to tex directly.
+  caster_texture_t walls[2];
 } fps_view_t;
 
 minimap_t mmap_init( int w, int h );
@@ -57,7 +59,7 @@ void fps_view_free( fps_view_t* fps_view_ptr );
 void fps_view_update_image( fps_view_t fps_view, const uint8_t* tiles_ptr, int tiles_w, int tiles_h, player_t player );
 void fps_view_draw( fps_view_t fps_view );
 
-extern minimap_t mmap;
+extern minimap_t minimap;
 extern const uint8_t tiles_ptr[TILES_W * TILES_H];
 
 extern rgb_t empty_tile_colour;
@@ -155,11 +155,39 @@ GLFWwindow* gfx_start( int win_w, int win_h, const char* title ) {
     }
   }
 
+  { // Same, but for column-major images uploaded as they are: texture rows are screen columns, so s and t swap.
+    const char* vertex_shader =
+      "#version 410 core\n"
+      "in vec2 vp;"
+      "uniform vec2 u_scale, u_pos;"
+      "out vec2 st;"
+      "void main() {"
+      "  vec2 uv = vp.xy * 0.5 + 0.5;"
+      "  st = vec2( 1.0 - uv.t, uv.s );"
+      "  gl_Position = vec4( vp * u_scale + u_pos, 0.0, 1.0 );"
+      "}";
+    const char* fragment_shader =
+      "#version 410 core\n"
+      "in vec2 st;"
+      "uniform sampler2D u_tex;"
+      "out vec4 frag_colour;"
+      "void main() {"
+      "  vec4 texel = texture( u_tex, st );"
+      "  frag_colour = vec4( pow(texel.rgb, vec3( 1.0 / 2.2 ) ), texel.a );"
+      "}";
+    transposed_shader = gfx_create_shader_from_strings( vertex_shader, fragment_shader );
+    if ( 0 == transposed_shader.program ) {
+      glfwTerminate();
+      return NULL;
+    }
+  }
+
   return window;
 }
 
 mesh_t quad_mesh;
 shader_t textured_shader;
+shader_t transposed_shader;
 
 void plot_line( int x_i, int y_i, int x_f, int y_f, uint8_t* rgb, uint8_t* img_ptr, int w, int h, int n_chans ) {
   int x = x_i, y = y_i, d_x = x_f - x_i, d_y = y_f - y_i, i_x = 1, i_y = 1;
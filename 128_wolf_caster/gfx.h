@@ -43,3 +43,4 @@ void plot_t_cross( int c_x, int c_y, int r, uint8_t* img_ptr, int w, int h, int
 
 extern mesh_t quad_mesh;
 extern shader_t textured_shader;
+extern shader_t transposed_shader; // Draws a column-major image, uploaded as a texture h wide and w tall, the right way round.
@@ -29,6 +29,9 @@ To do that you'd need to convert fps_view_update_image() into a fragment shader
   Turn it off with the tab key.
 */
 
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
 #include "game.h"
 #include "stb/stb_image.h"
 
@@ -47,7 +50,7 @@ rgb_t intersect_hit_colour        = { 0xFF, 0x00, 0x00 };
 rgb_t ceiling_colour              = { 0x05, 0x05, 0x05 };
 rgb_t floor_colour                = { 0x33, 0x22, 0x11 };
 float dir_line_length_tiles       = 0.25f;
-minimap_t mmap;
+minimap_t minimap;
 uint8_t* wall_images[16];
 texture_t portrait_tex[2];
 int wall_img_w = 0, wall_img_h = 0, wall_img_n = 0;
@@ -88,15 +91,16 @@ int main() {
   printf( "Wolfcaster 3-D\n" );
   GLFWwindow* window = gfx_start( WIN_W, WIN_H, "Wolfcaster 3-D" );
   if ( !window ) { return 1; }
-  mmap                = mmap_init( MINIMAP_W, MINIMAP_H );
+  if ( !apg_jobs_init( 0 ) ) { fprintf( stderr, "WARNING: could not start job threads. casting on this thread only\n" ); }
+  // wall_textures[0] = gfx_create_texture_from_file( "data/greenwall.png" );
+  wall_images[0]      = stbi_load( "data/greenwall.png", &wall_img_w, &wall_img_h, &wall_img_n, 0 );
+  wall_images[1]      = stbi_load( "data/greenwall_secret.png", &wall_img_w, &wall_img_h, &wall_img_n, 0 );
+  minimap             = mmap_init( MINIMAP_W, MINIMAP_H );
   fps_view_t fps_view = fps_view_init( FPS_W, FPS_H );
   player_t player     = (player_t){ .pos = (vec2_t){ 1.5f, 1.5f }, .heading = 0.0f, .dir = (vec2_t){ 1.0f, 0.0f } };
   debug_img_ptr       = calloc( DEBUG_W * DEBUG_H * 4, 1 );
   texture_t debug_tex = gfx_create_texture_from_mem( DEBUG_W, DEBUG_H, 4, debug_img_ptr );
 
-  // wall_textures[0] = gfx_create_texture_from_file( "data/greenwall.png" );
-  wall_images[0]  = stbi_load( "data/greenwall.png", &wall_img_w, &wall_img_h, &wall_img_n, 0 );
-  wall_images[1]  = stbi_load( "data/greenwall_secret.png", &wall_img_w, &wall_img_h, &wall_img_n, 0 );
   portrait_tex[0] = gfx_create_texture_from_file( "data/tim.png" );
   portrait_tex[1] = gfx_create_texture_from_file( "data/tim2.png" );
 
@@ -132,7 +136,7 @@ int main() {
     memset( debug_img_ptr, 0x00, debug_tex.w * debug_tex.h * debug_tex.n );
 
     // Wipes minimap. Call before FPS drawing as it adds lines.
-    if ( do_minimap_draw ) { mmap_update_image( mmap, tiles_ptr, TILES_W, TILES_H, player ); }
+    if ( do_minimap_draw ) { mmap_update_image( minimap, tiles_ptr, TILES_W, TILES_H, player ); }
 
     accum_s += elapsed_s;
     while ( accum_s >= timestep_s ) {
@@ -151,7 +155,7 @@ int main() {
     // 2D minimap viewport
     if ( do_minimap_draw ) {
       glViewport( WIN_W - MINIMAP_W, WIN_H - MINIMAP_H, MINIMAP_W, MINIMAP_H );
-      mmap_draw( mmap );
+      mmap_draw( minimap );
     }
 
     // User GUI on the bottom of the screen
@@ -187,7 +191,7 @@ int main() {
 
   free( debug_img_ptr );
   fps_view_free( &fps_view );
-  mmap_free( &mmap );
+  mmap_free( &minimap );
   glDeleteTextures( 1, &portrait_tex[0].handle );
   glDeleteTextures( 1, &portrait_tex[1].handle );
   for ( int i = 0; i < 16; i++ ) {
@@ -197,6 +201,7 @@ int main() {
       wall_images[i] = NULL;
     }
   }
+  apg_jobs_free();
   glfwTerminate();
   printf( "normal exit.\n" );
   return 0;
@@ -24,16 +24,16 @@ void mmap_free( minimap_t* map_ptr ) {
 
 void mmap_plot_line( vec2_t ori, vec2_t dest, rgb_t rgb ) {
   if ( !minimap_draw_rays ) { return; }
-  int tile_px_w = mmap.tex.w / TILES_W;
-  int tile_px_h = mmap.tex.h / TILES_H;
-  plot_line( ori.x * tile_px_w, ori.y * tile_px_h, dest.x * tile_px_w, dest.y * tile_px_h, &rgb.r, mmap.img_ptr, mmap.tex.w, mmap.tex.h, 3 );
+  int tile_px_w = minimap.tex.w / TILES_W;
+  int tile_px_h = minimap.tex.h / TILES_H;
+  plot_line( ori.x * tile_px_w, ori.y * tile_px_h, dest.x * tile_px_w, dest.y * tile_px_h, &rgb.r, minimap.img_ptr, minimap.tex.w, minimap.tex.h, 3 );
 }
 
 void mmap_plot_cross( vec2_t pos, rgb_t rgb ) {
   if ( !minimap_draw_rays ) { return; }
-  int tile_px_w = mmap.tex.w / TILES_W;
-  int tile_px_h = mmap.tex.h / TILES_H;
-  plot_t_cross( pos.x * tile_px_w, pos.y * tile_px_h, 2, mmap.img_ptr, mmap.tex.w, mmap.tex.h, 3, &rgb.r );
+  int tile_px_w = minimap.tex.w / TILES_W;
+  int tile_px_h = minimap.tex.h / TILES_H;
+  plot_t_cross( pos.x * tile_px_w, pos.y * tile_px_h, 2, minimap.img_ptr, minimap.tex.w, minimap.tex.h, 3, &rgb.r );
 }
 
 /*
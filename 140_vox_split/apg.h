@@ -5,6 +5,11 @@ Language: C89 interface, C99 implementation.
 
 Version History and Copyright
 -----------------------------
+  1.19.0 - 19 Oct 2026. Read-only memory-mapped files.
+  1.18.0 - 19 Oct 2026. Work-stealing job system with counters and parallel-for.
+  1.17.0 - 19 Oct 2026. Arena, double-buffered frame, and pool allocators with debug guard and poison modes.
+  1.16.0 - 19 Oct 2026. Scoped CPU profiler with per-frame stats and Chrome trace export.
+  1.15.0 - 19 Oct 2026. Asynchronous logging mode with a lock-free ring buffer and a writer thread.
   1.14.1 - 12 Jun 2025. Removed unsafe functions like ctime().
   1.13.1 - 16 Feb 2023. Added comments to confusing part of rand() functions.
   1.13.0 - 16 Feb 2023. Removed scratch mem functions.
@@ -156,6 +161,99 @@ double apg_time_s( void );
 /** NOTE: for linux -D_POSIX_C_SOURCE=199309L must be defined for glibc to get nanosleep(). */
 void apg_sleep_ms( int ms );
 
+/*=================================================================================================
+PROFILER
+Scoped CPU zones timed with apg_time_s(). Each thread records into its own ring buffer of events,
+so there is no locking on the hot path. Zones nest, up to APG_PROF_MAX_DEPTH deep.
+Define APG_PROFILER to turn the APG_PROF_*() macros on. Without it they compile away to nothing.
+
+Usage:
+  apg_time_init();
+  while ( running ) {
+    APG_PROF_BEGIN( "update" );
+    ...
+    APG_PROF_END();
+    APG_PROF_COUNTER( "n_chunks", n_chunks );
+    APG_PROF_FRAME_END();                         // Aggregate this frame's stats from all threads.
+  }
+  apg_prof_print_frame_stats( stdout );
+  apg_prof_write_chrome_trace( "trace.json" );    // Open in chrome://tracing or https://ui.perfetto.dev
+  apg_prof_free();
+
+A thread takes one of APG_PROF_MAX_THREADS slots on its first event, along with an APG_PROF_MAX_EVENTS ring of 32-byte events
+(8 MB at the defaults). Slots are never reclaimed when a thread exits, only by apg_prof_free(), so a program that keeps creating
+threads runs out: after the 64th thread, new threads record nothing. Lower APG_PROF_MAX_EVENTS if the memory matters.
+
+Define these before the #include to change the defaults:
+  APG_PROF_MAX_EVENTS  Events kept per thread before the oldest are overwritten. Default 262144.
+  APG_PROF_MAX_THREADS Threads that can ever record before apg_prof_free(). Default 64.
+  APG_PROF_MAX_ZONES   Distinct zone and counter names tracked in frame stats. Default 256.
+  APG_PROF_MAX_DEPTH   Default 32.
+=================================================================================================*/
+#ifdef APG_PROFILER
+#define APG_PROF_BEGIN( name ) apg_prof_begin( name )
+#define APG_PROF_END() apg_prof_end()
+#define APG_PROF_COUNTER( name, value ) apg_prof_counter( name, (double)( value ) )
+#define APG_PROF_FRAME_END() apg_prof_frame_end()
+#define APG_PROF_THREAD_NAME( name ) apg_prof_thread_name( name )
+#else
+#define APG_PROF_BEGIN( name ) ( (void)0 )
+#define APG_PROF_END() ( (void)0 )
+#define APG_PROF_COUNTER( name, value ) ( (void)0 )
+#define APG_PROF_FRAME_END() ( (void)0 )
+#define APG_PROF_THREAD_NAME( name ) ( (void)0 )
+#endif
+
+/** Per-zone or per-counter stats, aggregated over all threads by apg_prof_frame_end(). */
+typedef struct apg_prof_stat_t {
+  const char* name;
+  bool is_counter;
+  int depth;         /* Nesting depth the zone was last seen at. 0 is top-level. */
+  uint32_t calls;    /* Times the zone ended during the last frame. */
+  double ms;         /* Inclusive time spent in the zone during the last frame, summed over threads. */
+  double max_ms;     /* Longest single call during the last frame. */
+  double avg_ms;     /* Average of `ms` over every frame since the zone was first seen. */
+  double peak_ms;    /* Worst `ms` of any frame since the zone was first seen. */
+  double value;      /* Counters only. Most recent value. */
+  double frame_t0_s; /* Start time of the first call in the last frame. Used to sort stats into call order. */
+} apg_prof_stat_t;
+
+/** Start a timed zone on the calling thread.
+ * @param name Must point to memory that outlives the profiler, usually a string literal. Pointers are compared before strings.
+ */
+void apg_prof_begin( const char* name );
+
+/** End the most recently started zone on the calling thread. */
+void apg_prof_end( void );
+
+/** Record a named value, shown as a counter track in the trace. */
+void apg_prof_counter( const char* name, double value );
+
+/** Label the calling thread in the trace output. */
+void apg_prof_thread_name( const char* name );
+
+/** Mark the end of a frame. Call from one thread only, usually the main thread.
+ * Events from every thread since the previous call are aggregated into the per-frame stats.
+ */
+void apg_prof_frame_end( void );
+
+/** Copy the most recent frame's stats, sorted in call order.
+ * @return Number of stats written to stats_ptr.
+ */
+int apg_prof_frame_stats( apg_prof_stat_t* stats_ptr, int max_stats );
+
+/** Print the most recent frame's stats as an indented tree of zones. */
+void apg_prof_print_frame_stats( FILE* stream );
+
+/** Write the events currently held in every thread's buffer as Chrome trace_event JSON.
+ * @warning Other threads should not be recording events during this call.
+ * @return  false on file error.
+ */
+bool apg_prof_write_chrome_trace( const char* filename );
+
+/** Free all per-thread buffers and stats. Other threads must have stopped recording events. */
+void apg_prof_free( void );
+
 /*=================================================================================================
 STRINGS
 =================================================================================================*/
@@ -282,6 +380,17 @@ bool apg_read_entire_file( const char* filename, apg_file_t* record );
  */
 bool apg_file_to_str( const char* file_name, int64_t max_len, char* str_ptr );
 
+/** Maps a whole file into memory, read-only, rather than copying it. Pages are read from disk as they are first touched.
+ * @return
+ *   true on success. In this case record->data_ptr points to the mapped file, and must be released with apg_file_unmap(), not free().
+ *   false on any error, including empty files, which can't be mapped.
+ * @warning The mapping is undefined if the file is truncated or changed by another process while mapped.
+ */
+bool apg_file_map( const char* filename, apg_file_t* record );
+
+/** Releases a mapping made by apg_file_map(), and zeroes record. */
+void apg_file_unmap( apg_file_t* record );
+
 /*=================================================================================================
 LOG FILES
 =================================================================================================*/
@@ -305,6 +414,28 @@ void apg_log( const char* message, ... ) ATTRIB_PRINTF( 1, 2 );
 /** Write a log entry and print to stderr. */
 void apg_log_err( const char* message, ... ) ATTRIB_PRINTF( 1, 2 );
 
+/** Asynchronous logging mode.
+ * By default apg_log() and apg_log_err() open, write, and close the log file on the calling thread.
+ * After apg_log_async_start() is called they instead format the message into a slot in a lock-free, multi-producer ring buffer, and return.
+ * A background thread keeps the log file open and writes batches of messages, including the stderr copy for apg_log_err().
+ * If apg_start_crash_handler() is used then any messages still in the buffer are written out by the crash handler before the backtrace.
+ *
+ * Define these before the #include to change the defaults:
+ *   APG_LOG_ASYNC_SLOTS   Number of message slots in the ring buffer. Must be a power of two. Default 4096.
+ *   APG_LOG_ASYNC_MSG_MAX Maximum bytes per message, including the nul terminator. Longer messages are truncated. Default 256.
+ *
+ * @return false if the background thread could not be created. Logging then stays synchronous.
+ * @note   Call apg_log_start() first if you want a fresh log file. An atexit() handler calls apg_log_async_stop() on normal exit.
+ * @note   If the buffer is full the calling thread yields until the writer has made space, so messages are never dropped.
+ */
+bool apg_log_async_start( void );
+
+/** Write any buffered messages, stop the writer thread, and return to synchronous logging. */
+void apg_log_async_stop( void );
+
+/** Block until every message logged before this call has been written to the log file. Does nothing in synchronous mode. */
+void apg_log_flush( void );
+
 /*=================================================================================================
 BACKTRACES AND DUMPS
 =================================================================================================*/
@@ -340,6 +471,173 @@ MEMORY
 #define APG_MEGABYTES( value ) ( APG_KILOBYTES( value ) * 1024ULL )
 #define APG_GIGABYTES( value ) ( APG_MEGABYTES( value ) * 1024ULL )
 
+/** Memory allocators for hot paths that would otherwise malloc()/free() per call.
+ *
+ *  apg_arena_t       Bump allocator over one block. Take a mark, allocate freely, then reset to the mark to release everything after it at once.
+ *  apg_frame_alloc_t Two arenas that swap every frame. Allocations stay valid until the end of the following frame, so this frame's
+ *                    scratch can still be read while the next frame is being built (e.g. by a GPU upload or a worker thread).
+ *  apg_pool_t        Fixed-size blocks with a free-list. O(1) alloc and dealloc in any order.
+ *
+ *  None of these are thread-safe. Give each thread its own.
+ *
+ *  Debug modes. Define before the #include with APG_IMPLEMENTATION:
+ *    APG_ALLOC_GUARDS  Each allocation gets a hidden header and a trailing guard band. Overruns are detected by apg_arena_check(),
+ *                      which is also run on every reset, and by apg_pool_dealloc(), which also catches double-frees.
+ *    APG_ALLOC_POISON  New memory is filled with 0xCD and released memory with 0xDD, so reads of uninitialised or stale data stand out.
+ *                      Pool blocks are checked on alloc to catch writes after dealloc.
+ *    APG_ALLOC_DEBUG   Turns on both.
+ */
+#define APG_ARENA_ALIGN 16 /* Default alignment of arena and pool allocations. */
+
+typedef struct apg_arena_t {
+  uint8_t* base_ptr;
+  size_t sz;        /* Capacity in bytes. */
+  size_t used;      /* Bytes allocated so far, including alignment padding and any debug guards. */
+  size_t peak;      /* Highest `used` has been. Useful for tuning `sz`. */
+  size_t last_hdr;  /* APG_ALLOC_GUARDS only. Offset of the most recent allocation's header. */
+  bool owns_memory; /* False if the memory was supplied by the user in apg_arena_init_from_mem(). */
+} apg_arena_t;
+
+/** A position in an arena to roll back to with apg_arena_reset_to_mark(). */
+typedef struct apg_arena_mark_t {
+  size_t used;
+  size_t last_hdr;
+} apg_arena_mark_t;
+
+/** Allocate `sz` bytes for the arena's backing memory.
+ * @return false on out of memory, in which case the arena is left empty.
+ */
+bool apg_arena_init( apg_arena_t* arena_ptr, size_t sz );
+
+/** Use memory owned by the caller, e.g. a static or stack buffer, as the arena's backing memory. It is not freed by apg_arena_free(). */
+void apg_arena_init_from_mem( apg_arena_t* arena_ptr, void* mem_ptr, size_t sz );
+
+void apg_arena_free( apg_arena_t* arena_ptr );
+
+/** @return Address of `sz` bytes aligned to APG_ARENA_ALIGN, or NULL if the arena doesn't have room. Memory is not zeroed. */
+void* apg_arena_alloc( apg_arena_t* arena_ptr, size_t sz );
+
+/** As apg_arena_alloc() but with a specific alignment, which must be a power of two. */
+void* apg_arena_alloc_aligned( apg_arena_t* arena_ptr, size_t sz, size_t align );
+
+/** As apg_arena_alloc() but zeroes the memory. */
+void* apg_arena_calloc( apg_arena_t* arena_ptr, size_t n, size_t sz );
+
+apg_arena_mark_t apg_arena_mark( const apg_arena_t* arena_ptr );
+
+/** Release every allocation made after `mark` was taken. */
+void apg_arena_reset_to_mark( apg_arena_t* arena_ptr, apg_arena_mark_t mark );
+
+/** Release every allocation. */
+void apg_arena_reset( apg_arena_t* arena_ptr );
+
+/** Check every allocation's guard band. Always returns true unless built with APG_ALLOC_GUARDS.
+ * @return false if any allocation has been overrun. Details of the first bad allocation are printed to stderr.
+ */
+bool apg_arena_check( const apg_arena_t* arena_ptr );
+
+typedef struct apg_frame_alloc_t {
+  apg_arena_t arenas[2];
+  int curr_idx;
+} apg_frame_alloc_t;
+
+/** @param sz_per_frame Bytes available to each frame. Twice this is allocated. */
+bool apg_frame_alloc_init( apg_frame_alloc_t* frame_ptr, size_t sz_per_frame );
+
+void apg_frame_alloc_free( apg_frame_alloc_t* frame_ptr );
+
+/** @return Scratch memory that stays valid until the end of the next frame, or NULL if this frame's arena is full. */
+void* apg_frame_alloc( apg_frame_alloc_t* frame_ptr, size_t sz );
+
+/** The current frame's arena, for functions that take an apg_arena_t*. Don't reset it yourself. */
+apg_arena_t* apg_frame_arena( apg_frame_alloc_t* frame_ptr );
+
+/** Call once per frame. Switches to the other arena and releases what was allocated in it two frames ago. */
+void apg_frame_alloc_swap( apg_frame_alloc_t* frame_ptr );
+
+typedef struct apg_pool_t {
+  uint8_t* base_ptr;
+  void* free_list_ptr;
+  uint8_t* in_use_ptr; /* APG_ALLOC_GUARDS only. One byte per block to catch double-frees. */
+  size_t block_sz;     /* Size requested per block. */
+  size_t stride;       /* Bytes between blocks, including alignment padding and guards. */
+  size_t n_blocks;
+  size_t n_used;
+} apg_pool_t;
+
+/** @return false on out of memory. */
+bool apg_pool_init( apg_pool_t* pool_ptr, size_t block_sz, size_t n_blocks );
+
+void apg_pool_free( apg_pool_t* pool_ptr );
+
+/** @return An APG_ARENA_ALIGN-aligned block of `block_sz` bytes, or NULL if every block is in use. Memory is not zeroed. */
+void* apg_pool_alloc( apg_pool_t* pool_ptr );
+
+/** Return a block to the pool. `block_ptr` may be NULL. */
+void apg_pool_dealloc( apg_pool_t* pool_ptr, void* block_ptr );
+
+/*=================================================================================================
+JOB SYSTEM
+=================================================================================================*/
+/** Work-stealing job scheduler for fine-grained, nested parallelism.
+ *
+ *  Each thread has its own lock-free deque (Chase-Lev). A thread pushes and pops jobs at the bottom of its own deque, so recently spawned, cache-warm
+ *  work runs first, and idle threads steal from the top of other threads' deques. Fork-join is done with counters: every job run with a counter
+ *  increments it, and decrements it when finished. apg_jobs_wait() runs other jobs until the counter reaches zero rather than blocking, so a job may
+ *  spawn and wait for sub-jobs without deadlocking the pool.
+ *
+ *  Jobs may only be run from the thread that called apg_jobs_init(), or from inside another job.
+ *  Each thread can have up to APG_JOBS_MAX_QUEUED jobs waiting. Beyond that, apg_jobs_run() runs the job immediately on the calling thread.
+ *
+ *  apg_job_counter_t done = { 0 };
+ *  for ( int i = 0; i < n_meshes; i++ ) { apg_jobs_run( gen_mesh_job, &meshes[i], &done ); }
+ *  apg_jobs_wait( &done );
+ */
+#ifndef APG_JOBS_MAX_QUEUED
+#define APG_JOBS_MAX_QUEUED 4096 /* Per-thread deque capacity. Must be a power of two. */
+#endif
+#define APG_JOBS_MAX_THREADS 64
+
+typedef void ( *apg_job_func_t )( void* arg_ptr );
+
+/** Called with a sub-range [begin, end) of the full range given to apg_jobs_parallel_for(). */
+typedef void ( *apg_job_range_func_t )( int64_t begin, int64_t end, void* arg_ptr );
+
+/** Zero-initialise before use. Only touch it through apg_jobs_*() functions. */
+typedef struct apg_job_counter_t {
+  int64_t n_pending;
+} apg_job_counter_t;
+
+/** Start the worker threads.
+ * @param n_threads Total threads doing work, including the calling thread, so 1 means run everything on the caller.
+ *                  0 means one per logical CPU. Clamped to APG_JOBS_MAX_THREADS.
+ * @return false if already initialised, or if threads couldn't be created.
+ */
+bool apg_jobs_init( int n_threads );
+
+/** Waits for the workers to finish any running jobs, then stops them. Jobs still queued are not run. */
+void apg_jobs_free( void );
+
+/** @return Total threads doing work, including the caller of apg_jobs_init(), or 0 if not initialised. */
+int apg_jobs_n_threads( void );
+
+/** @return Index of the calling thread in the job system, from 0 to apg_jobs_n_threads() - 1. 0 is the thread that called apg_jobs_init().
+ * Handy for indexing per-thread scratch memory. -1 if called from an unrelated thread.
+ */
+int apg_jobs_thread_idx( void );
+
+/** Queue a job. If `counter_ptr` is not NULL it is incremented now, and decremented when the job has finished. */
+void apg_jobs_run( apg_job_func_t func_ptr, void* arg_ptr, apg_job_counter_t* counter_ptr );
+
+/** Run other jobs until `counter_ptr` reaches zero. */
+void apg_jobs_wait( apg_job_counter_t* counter_ptr );
+
+/** Call `func_ptr` over sub-ranges covering [begin, end), in parallel, and wait for all of them.
+ * The range is split recursively in halves, each half becoming a job that can be stolen, until a piece is no larger than `grain`.
+ * @param grain Largest sub-range passed to `func_ptr`. Pick it so one call does a few microseconds of work or more. Must be >= 1.
+ */
+void apg_jobs_parallel_for( int64_t begin, int64_t end, int64_t grain, apg_job_range_func_t func_ptr, void* arg_ptr );
+
 /*=================================================================================================
 COMPRESSION
 =================================================================================================*/
@@ -487,6 +785,8 @@ bool apg_gbfs( int64_t start_key, int64_t target_key, int64_t ( *h_cb_ptr )( int
 #endif
 #else
 #include <execinfo.h>
+#include <pthread.h> /* For the async log writer thread and job system. */
+#include <sched.h>   /* sched_yield() */
 #include <strings.h> /* For strcasecmp. */
 #include <unistd.h>  /* Linux-only? */
 #endif
@@ -511,6 +811,89 @@ bool apg_gbfs( int64_t start_key, int64_t target_key, int64_t ( *h_cb_ptr )( int
 #define strdup _strdup
 #endif
 
+/*=================================================================================================
+INTERNAL THREAD AND ATOMIC HELPERS
+=================================================================================================*/
+/* Just enough of a portable wrapper for the threads used in here. GCC/Clang builtins, or Interlocked*() on MSVC. */
+#ifdef _MSC_VER
+typedef volatile LONG64 _apg_atomic_t;
+#define _apg_atomic_load( ptr ) InterlockedCompareExchange64( ( ptr ), 0, 0 )
+#define _apg_atomic_store( ptr, val ) InterlockedExchange64( ( ptr ), ( val ) )
+#define _apg_atomic_add( ptr, val ) InterlockedExchangeAdd64( ( ptr ), ( val ) )
+#define _apg_atomic_load_ptr( ptr ) InterlockedCompareExchangePointer( (PVOID volatile*)( ptr ), NULL, NULL )
+#define _apg_atomic_store_ptr( ptr, val ) InterlockedExchangePointer( (PVOID volatile*)( ptr ), ( val ) )
+static bool _apg_atomic_cas( _apg_atomic_t* ptr, int64_t expected, int64_t desired ) { return InterlockedCompareExchange64( ptr, desired, expected ) == expected; }
+#define _apg_atomic_fence() MemoryBarrier()
+#define _APG_THREAD_LOCAL __declspec( thread )
+#else
+typedef int64_t _apg_atomic_t;
+#define _apg_atomic_load( ptr ) __atomic_load_n( ( ptr ), __ATOMIC_ACQUIRE )
+#define _apg_atomic_store( ptr, val ) __atomic_store_n( ( ptr ), ( val ), __ATOMIC_RELEASE )
+#define _apg_atomic_add( ptr, val ) __atomic_fetch_add( ( ptr ), ( val ), __ATOMIC_ACQ_REL )
+#define _apg_atomic_load_ptr( ptr ) __atomic_load_n( ( ptr ), __ATOMIC_ACQUIRE )
+#define _apg_atomic_store_ptr( ptr, val ) __atomic_store_n( ( ptr ), ( val ), __ATOMIC_RELEASE )
+static bool _apg_atomic_cas( _apg_atomic_t* ptr, int64_t expected, int64_t desired ) {
+  return __atomic_compare_exchange_n( ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE );
+}
+#define _apg_atomic_fence() __atomic_thread_fence( __ATOMIC_SEQ_CST ) /* Full barrier, for store-then-load orderings that acquire/release can't give. */
+#define _APG_THREAD_LOCAL __thread
+#endif
+
+#ifdef _WIN32
+typedef HANDLE _apg_thread_t;
+#define _APG_THREAD_FUNC( name ) static DWORD WINAPI name( LPVOID arg_ptr )
+#define _APG_THREAD_RETURN return 0
+static bool _apg_thread_create( _apg_thread_t* thread_ptr, LPTHREAD_START_ROUTINE func_ptr, void* arg_ptr ) {
+  *thread_ptr = CreateThread( NULL, 0, func_ptr, arg_ptr, 0, NULL );
+  return NULL != *thread_ptr;
+}
+static void _apg_thread_join( _apg_thread_t thread ) {
+  WaitForSingleObject( thread, INFINITE );
+  CloseHandle( thread );
+}
+static void _apg_thread_yield( void ) { SwitchToThread(); }
+typedef CRITICAL_SECTION _apg_mutex_t;
+typedef CONDITION_VARIABLE _apg_cond_t;
+static void _apg_mutex_init( _apg_mutex_t* mutex_ptr ) { InitializeCriticalSection( mutex_ptr ); }
+static void _apg_mutex_destroy( _apg_mutex_t* mutex_ptr ) { DeleteCriticalSection( mutex_ptr ); }
+static void _apg_mutex_lock( _apg_mutex_t* mutex_ptr ) { EnterCriticalSection( mutex_ptr ); }
+static void _apg_mutex_unlock( _apg_mutex_t* mutex_ptr ) { LeaveCriticalSection( mutex_ptr ); }
+static void _apg_cond_init( _apg_cond_t* cond_ptr ) { InitializeConditionVariable( cond_ptr ); }
+static void _apg_cond_destroy( _apg_cond_t* cond_ptr ) { APG_UNUSED( cond_ptr ); }
+static void _apg_cond_wait( _apg_cond_t* cond_ptr, _apg_mutex_t* mutex_ptr ) { SleepConditionVariableCS( cond_ptr, mutex_ptr, INFINITE ); }
+static void _apg_cond_signal( _apg_cond_t* cond_ptr ) { WakeConditionVariable( cond_ptr ); }
+static void _apg_cond_broadcast( _apg_cond_t* cond_ptr ) { WakeAllConditionVariable( cond_ptr ); }
+static int _apg_n_logical_cpus( void ) {
+  SYSTEM_INFO info;
+  GetSystemInfo( &info );
+  return (int)info.dwNumberOfProcessors;
+}
+#else
+typedef pthread_t _apg_thread_t;
+#define _APG_THREAD_FUNC( name ) static void* name( void* arg_ptr )
+#define _APG_THREAD_RETURN return NULL
+static bool _apg_thread_create( _apg_thread_t* thread_ptr, void* ( *func_ptr )( void* ), void* arg_ptr ) {
+  return 0 == pthread_create( thread_ptr, NULL, func_ptr, arg_ptr );
+}
+static void _apg_thread_join( _apg_thread_t thread ) { pthread_join( thread, NULL ); }
+static void _apg_thread_yield( void ) { sched_yield(); }
+typedef pthread_mutex_t _apg_mutex_t;
+typedef pthread_cond_t _apg_cond_t;
+static void _apg_mutex_init( _apg_mutex_t* mutex_ptr ) { pthread_mutex_init( mutex_ptr, NULL ); }
+static void _apg_mutex_destroy( _apg_mutex_t* mutex_ptr ) { pthread_mutex_destroy( mutex_ptr ); }
+static void _apg_mutex_lock( _apg_mutex_t* mutex_ptr ) { pthread_mutex_lock( mutex_ptr ); }
+static void _apg_mutex_unlock( _apg_mutex_t* mutex_ptr ) { pthread_mutex_unlock( mutex_ptr ); }
+static void _apg_cond_init( _apg_cond_t* cond_ptr ) { pthread_cond_init( cond_ptr, NULL ); }
+static void _apg_cond_destroy( _apg_cond_t* cond_ptr ) { pthread_cond_destroy( cond_ptr ); }
+static void _apg_cond_wait( _apg_cond_t* cond_ptr, _apg_mutex_t* mutex_ptr ) { pthread_cond_wait( cond_ptr, mutex_ptr ); }
+static void _apg_cond_signal( _apg_cond_t* cond_ptr ) { pthread_cond_signal( cond_ptr ); }
+static void _apg_cond_broadcast( _apg_cond_t* cond_ptr ) { pthread_cond_broadcast( cond_ptr ); }
+static int _apg_n_logical_cpus( void ) {
+  long n = sysconf( _SC_NPROCESSORS_ONLN );
+  return n > 0 ? (int)n : 1;
+}
+#endif
+
 /*=================================================================================================
 PSEUDO-RANDOM NUMBERS IMPLEMENTATION
 =================================================================================================*/
@@ -595,6 +978,265 @@ void apg_sleep_ms( int ms ) {
 #endif
 }
 
+/*=================================================================================================
+PROFILER IMPLEMENTATION
+=================================================================================================*/
+#ifndef APG_PROF_MAX_EVENTS
+#define APG_PROF_MAX_EVENTS 262144
+#endif
+#ifndef APG_PROF_MAX_THREADS
+#define APG_PROF_MAX_THREADS 64
+#endif
+#ifndef APG_PROF_MAX_ZONES
+#define APG_PROF_MAX_ZONES 256
+#endif
+#ifndef APG_PROF_MAX_DEPTH
+#define APG_PROF_MAX_DEPTH 32
+#endif
+
+typedef enum _apg_prof_event_type_t { _APG_PROF_ZONE, _APG_PROF_COUNTER, _APG_PROF_FRAME } _apg_prof_event_type_t;
+
+/* Zones are recorded when they end, so a child always appears in the buffer before its parent. */
+typedef struct _apg_prof_event_t {
+  const char* name;
+  double t0_s;
+  double x; /* End time in seconds for zones, or the value for counters. */
+  int32_t depth;
+  int32_t type;
+} _apg_prof_event_t;
+
+typedef struct _apg_prof_thread_t {
+  _apg_prof_event_t* events_ptr;
+  _apg_atomic_t n_written; /* Monotonic count of events recorded. Event i lives in slot i % APG_PROF_MAX_EVENTS. */
+  int64_t n_read;          /* Aggregation cursor. Only touched by apg_prof_frame_end(). */
+  int tid;
+  int depth;
+  const char* stack_names[APG_PROF_MAX_DEPTH];
+  double stack_t0_s[APG_PROF_MAX_DEPTH];
+  char name[32];
+} _apg_prof_thread_t;
+
+static _apg_prof_thread_t* _prof_threads[APG_PROF_MAX_THREADS]; /* Published with a release store once the buffer is set up. Read with acquire. */
+static _apg_atomic_t _prof_n_threads;
+static _APG_THREAD_LOCAL _apg_prof_thread_t* _prof_tls;
+static apg_prof_stat_t _prof_stats[APG_PROF_MAX_ZONES];
+static double _prof_stats_total_ms[APG_PROF_MAX_ZONES];
+static int64_t _prof_stats_first_frame[APG_PROF_MAX_ZONES];
+static int _prof_n_stats;
+static int64_t _prof_n_frames;
+static double _prof_frame_t0_s, _prof_frame_ms;
+
+/* Lazily create the calling thread's buffer. Returns NULL if out of thread slots or memory. */
+static _apg_prof_thread_t* _apg_prof_thread( void ) {
+  if ( _prof_tls ) { return _prof_tls; }
+  int64_t idx = _apg_atomic_add( &_prof_n_threads, 1 );
+  if ( idx >= APG_PROF_MAX_THREADS ) { return NULL; }
+  _apg_prof_thread_t* thread_ptr = calloc( 1, sizeof( _apg_prof_thread_t ) );
+  if ( !thread_ptr ) { return NULL; }
+  thread_ptr->events_ptr = malloc( sizeof( _apg_prof_event_t ) * APG_PROF_MAX_EVENTS );
+  if ( !thread_ptr->events_ptr ) {
+    free( thread_ptr );
+    return NULL;
+  }
+  thread_ptr->tid = (int)idx;
+  snprintf( thread_ptr->name, sizeof( thread_ptr->name ), "thread %i", (int)idx );
+  _apg_atomic_store_ptr( &_prof_threads[idx], thread_ptr ); /* The slot stays NULL, and readers skip it, until this is visible. */
+  _prof_tls = thread_ptr;
+  return thread_ptr;
+}
+
+static void _apg_prof_record( _apg_prof_thread_t* thread_ptr, _apg_prof_event_t event ) {
+  int64_t n                                       = thread_ptr->n_written;
+  thread_ptr->events_ptr[n % APG_PROF_MAX_EVENTS] = event;
+  _apg_atomic_store( &thread_ptr->n_written, n + 1 ); /* Publish to the aggregating thread. */
+}
+
+void apg_prof_begin( const char* name ) {
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( !thread_ptr ) { return; }
+  if ( thread_ptr->depth < APG_PROF_MAX_DEPTH ) {
+    thread_ptr->stack_names[thread_ptr->depth] = name;
+    thread_ptr->stack_t0_s[thread_ptr->depth]  = apg_time_s();
+  }
+  thread_ptr->depth++; /* Still counted past the max so begin/end stay paired. */
+}
+
+void apg_prof_end( void ) {
+  double t1_s                    = apg_time_s();
+  _apg_prof_thread_t* thread_ptr = _prof_tls;
+  if ( !thread_ptr || thread_ptr->depth <= 0 ) { return; }
+  int depth = --thread_ptr->depth;
+  if ( depth >= APG_PROF_MAX_DEPTH ) { return; }
+  _apg_prof_record( thread_ptr, ( _apg_prof_event_t ){
+                                  .name = thread_ptr->stack_names[depth], .t0_s = thread_ptr->stack_t0_s[depth], .x = t1_s, .depth = depth, .type = _APG_PROF_ZONE } );
+}
+
+void apg_prof_counter( const char* name, double value ) {
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( !thread_ptr ) { return; }
+  _apg_prof_record( thread_ptr, ( _apg_prof_event_t ){ .name = name, .t0_s = apg_time_s(), .x = value, .depth = thread_ptr->depth, .type = _APG_PROF_COUNTER } );
+}
+
+void apg_prof_thread_name( const char* name ) {
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( !thread_ptr || !name ) { return; }
+  thread_ptr->name[0] = '\0';
+  apg_strncat( thread_ptr->name, name, sizeof( thread_ptr->name ) - 1, sizeof( thread_ptr->name ) - 1 );
+}
+
+static apg_prof_stat_t* _apg_prof_find_stat( const char* name, bool is_counter ) {
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    if ( _prof_stats[i].name == name && _prof_stats[i].is_counter == is_counter ) { return &_prof_stats[i]; }
+  }
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    if ( _prof_stats[i].is_counter == is_counter && 0 == strcmp( _prof_stats[i].name, name ) ) { return &_prof_stats[i]; }
+  }
+  if ( _prof_n_stats >= APG_PROF_MAX_ZONES ) { return NULL; }
+  _prof_stats_total_ms[_prof_n_stats]    = 0.0;
+  _prof_stats_first_frame[_prof_n_stats] = _prof_n_frames;
+  _prof_stats[_prof_n_stats]             = ( apg_prof_stat_t ){ .name = name, .is_counter = is_counter };
+  return &_prof_stats[_prof_n_stats++];
+}
+
+void apg_prof_frame_end( void ) {
+  double t_s = apg_time_s();
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    _prof_stats[i].calls  = 0;
+    _prof_stats[i].ms     = 0.0;
+    _prof_stats[i].max_ms = 0.0;
+  }
+
+  int64_t n_threads = APG_MIN( _apg_atomic_load( &_prof_n_threads ), APG_PROF_MAX_THREADS );
+  for ( int64_t t = 0; t < n_threads; t++ ) {
+    _apg_prof_thread_t* thread_ptr = _apg_atomic_load_ptr( &_prof_threads[t] );
+    if ( !thread_ptr ) { continue; }
+    int64_t n_written = _apg_atomic_load( &thread_ptr->n_written );
+    if ( n_written - thread_ptr->n_read > APG_PROF_MAX_EVENTS ) { thread_ptr->n_read = n_written - APG_PROF_MAX_EVENTS; } /* Lapped - oldest were overwritten. */
+    for ( int64_t i = thread_ptr->n_read; i < n_written; i++ ) {
+      const _apg_prof_event_t* e_ptr = &thread_ptr->events_ptr[i % APG_PROF_MAX_EVENTS];
+      if ( _APG_PROF_FRAME == e_ptr->type ) { continue; }
+      apg_prof_stat_t* stat_ptr = _apg_prof_find_stat( e_ptr->name, _APG_PROF_COUNTER == e_ptr->type );
+      if ( !stat_ptr ) { continue; }
+      if ( 0 == stat_ptr->calls || e_ptr->t0_s < stat_ptr->frame_t0_s ) { stat_ptr->frame_t0_s = e_ptr->t0_s; }
+      stat_ptr->calls++;
+      stat_ptr->depth = e_ptr->depth;
+      if ( _APG_PROF_COUNTER == e_ptr->type ) {
+        stat_ptr->value = e_ptr->x;
+      } else {
+        double ms = ( e_ptr->x - e_ptr->t0_s ) * 1000.0;
+        stat_ptr->ms += ms;
+        stat_ptr->max_ms = APG_MAX( stat_ptr->max_ms, ms );
+      }
+    }
+    thread_ptr->n_read = n_written;
+  }
+
+  for ( int i = 0; i < _prof_n_stats; i++ ) {
+    _prof_stats_total_ms[i] += _prof_stats[i].ms;
+    _prof_stats[i].avg_ms  = _prof_stats_total_ms[i] / (double)( _prof_n_frames - _prof_stats_first_frame[i] + 1 );
+    _prof_stats[i].peak_ms = APG_MAX( _prof_stats[i].peak_ms, _prof_stats[i].ms );
+  }
+
+  /* Record the frame itself so it shows up as a parent span in the trace. The first call only starts the clock. */
+  _apg_prof_thread_t* thread_ptr = _apg_prof_thread();
+  if ( thread_ptr && _prof_n_frames > 0 ) {
+    _apg_prof_record( thread_ptr, ( _apg_prof_event_t ){ .name = "frame", .t0_s = _prof_frame_t0_s, .x = t_s, .depth = -1, .type = _APG_PROF_FRAME } );
+  }
+  _prof_frame_ms   = ( t_s - _prof_frame_t0_s ) * 1000.0;
+  _prof_frame_t0_s = t_s;
+  _prof_n_frames++;
+}
+
+static int _apg_prof_stat_cmp( const void* a, const void* b ) {
+  const apg_prof_stat_t* a_ptr = (const apg_prof_stat_t*)a;
+  const apg_prof_stat_t* b_ptr = (const apg_prof_stat_t*)b;
+  if ( a_ptr->frame_t0_s != b_ptr->frame_t0_s ) { return a_ptr->frame_t0_s < b_ptr->frame_t0_s ? -1 : 1; }
+  return a_ptr->depth - b_ptr->depth; /* Parent and child that started on the same tick. */
+}
+
+int apg_prof_frame_stats( apg_prof_stat_t* stats_ptr, int max_stats ) {
+  if ( !stats_ptr || max_stats <= 0 ) { return 0; }
+  int n = 0;
+  for ( int i = 0; i < _prof_n_stats && n < max_stats; i++ ) {
+    if ( _prof_stats[i].calls > 0 ) { stats_ptr[n++] = _prof_stats[i]; }
+  }
+  qsort( stats_ptr, n, sizeof( apg_prof_stat_t ), _apg_prof_stat_cmp );
+  return n;
+}
+
+void apg_prof_print_frame_stats( FILE* stream ) {
+  apg_prof_stat_t stats[APG_PROF_MAX_ZONES];
+  int n = apg_prof_frame_stats( stats, APG_PROF_MAX_ZONES );
+  fprintf( stream, "frame %lli: %.3f ms\n", (long long)_prof_n_frames, _prof_frame_ms );
+  for ( int i = 0; i < n; i++ ) {
+    int indent = 2 + 2 * APG_CLAMP( stats[i].depth, 0, 16 );
+    if ( stats[i].is_counter ) {
+      fprintf( stream, "%*s%-*s = %g\n", indent, "", 40 - indent, stats[i].name, stats[i].value );
+    } else {
+      fprintf( stream, "%*s%-*s %9.3f ms  x%-5u max %8.3f  avg %8.3f  peak %8.3f\n", indent, "", 40 - indent, stats[i].name, stats[i].ms, stats[i].calls,
+        stats[i].max_ms, stats[i].avg_ms, stats[i].peak_ms );
+    }
+  }
+}
+
+static void _apg_prof_write_json_str( FILE* f_ptr, const char* str ) {
+  fputc( '"', f_ptr );
+  for ( const char* c = str; c && *c; c++ ) {
+    if ( '"' == *c || '\\' == *c ) { fputc( '\\', f_ptr ); }
+    if ( (unsigned char)*c >= 0x20 ) { fputc( *c, f_ptr ); }
+  }
+  fputc( '"', f_ptr );
+}
+
+bool apg_prof_write_chrome_trace( const char* filename ) {
+  if ( !filename ) { return false; }
+  FILE* f_ptr = fopen( filename, "w" );
+  if ( !f_ptr ) { return false; }
+
+  fprintf( f_ptr, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+  bool first        = true;
+  int64_t n_threads = APG_MIN( _apg_atomic_load( &_prof_n_threads ), APG_PROF_MAX_THREADS );
+  for ( int64_t t = 0; t < n_threads; t++ ) {
+    _apg_prof_thread_t* thread_ptr = _apg_atomic_load_ptr( &_prof_threads[t] );
+    if ( !thread_ptr ) { continue; }
+    fprintf( f_ptr, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%i,\"args\":{\"name\":", first ? "" : ",\n", thread_ptr->tid );
+    _apg_prof_write_json_str( f_ptr, thread_ptr->name );
+    fprintf( f_ptr, "}}" );
+    first = false;
+
+    int64_t n_written = _apg_atomic_load( &thread_ptr->n_written );
+    int64_t start     = APG_MAX( 0, n_written - APG_PROF_MAX_EVENTS );
+    for ( int64_t i = start; i < n_written; i++ ) {
+      const _apg_prof_event_t* e_ptr = &thread_ptr->events_ptr[i % APG_PROF_MAX_EVENTS];
+      fprintf( f_ptr, ",\n{\"name\":" );
+      _apg_prof_write_json_str( f_ptr, e_ptr->name );
+      if ( _APG_PROF_COUNTER == e_ptr->type ) {
+        fprintf( f_ptr, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%i,\"args\":{\"value\":%g}}", e_ptr->t0_s * 1e6, thread_ptr->tid, e_ptr->x );
+      } else {
+        fprintf( f_ptr, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%i}", _APG_PROF_FRAME == e_ptr->type ? "frame" : "zone",
+          e_ptr->t0_s * 1e6, ( e_ptr->x - e_ptr->t0_s ) * 1e6, thread_ptr->tid );
+      }
+    }
+  }
+  fprintf( f_ptr, "\n]}\n" );
+  return 0 == fclose( f_ptr );
+}
+
+void apg_prof_free( void ) {
+  int64_t n_threads = APG_MIN( _apg_atomic_load( &_prof_n_threads ), APG_PROF_MAX_THREADS );
+  for ( int64_t t = 0; t < n_threads; t++ ) {
+    _apg_prof_thread_t* thread_ptr = _apg_atomic_load_ptr( &_prof_threads[t] );
+    if ( !thread_ptr ) { continue; }
+    free( thread_ptr->events_ptr );
+    free( thread_ptr );
+    _apg_atomic_store_ptr( &_prof_threads[t], NULL );
+  }
+  _apg_atomic_store( &_prof_n_threads, 0 );
+  _prof_tls      = NULL; /* NOTE(Anton) only resets the calling thread's pointer. Other threads must not record again after this. */
+  _prof_n_stats  = 0;
+  _prof_n_frames = 0;
+}
+
 /*=================================================================================================
 STRINGS IMPLEMENTATION
 =================================================================================================*/
@@ -637,6 +1279,10 @@ FILES IMPLEMENTATION
 #ifndef _MSC_VER
 #include <dirent.h> /* Directories. */
 #endif
+#ifndef _WIN32
+#include <fcntl.h>    /* open() */
+#include <sys/mman.h> /* mmap() */
+#endif
 
 bool apg_is_file( const char* path ) {
   struct apg_stat_t path_stat;
@@ -803,6 +1449,7 @@ bool apg_read_entire_file( const char* filename, apg_file_t* record ) {
   void* mem_ptr = NULL;
   int64_t sz    = 0;
 
+  APG_PROF_BEGIN( "apg_read_entire_file" );
   if ( !filename || !record ) { goto _apg_read_entire_file_fail; }
 
   sz = apg_file_size( filename );
@@ -820,10 +1467,13 @@ bool apg_read_entire_file( const char* filename, apg_file_t* record ) {
   record->sz       = (size_t)sz;
   record->data_ptr = mem_ptr;
 
+  APG_PROF_COUNTER( "apg_read_entire_file bytes", sz );
+  APG_PROF_END();
   return true;
 
 _apg_read_entire_file_fail:
   if ( mem_ptr ) { free( mem_ptr ); }
+  APG_PROF_END();
   return false;
 }
 
@@ -843,11 +1493,259 @@ bool apg_file_to_str( const char* filename, int64_t max_len, char* str_ptr ) {
   return true;
 }
 
+bool apg_file_map( const char* filename, apg_file_t* record ) {
+  if ( !filename || !record ) { return false; }
+  *record    = ( apg_file_t ){ .data_ptr = NULL };
+  int64_t sz = apg_file_size( filename );
+  if ( sz <= 0 || (uint64_t)sz > (uint64_t)SIZE_MAX ) { return false; }
+
+  APG_PROF_BEGIN( "apg_file_map" );
+#ifdef _WIN32
+  HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if ( INVALID_HANDLE_VALUE == file ) {
+    APG_PROF_END();
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+  CloseHandle( file );
+  if ( !mapping ) {
+    APG_PROF_END();
+    return false;
+  }
+  void* data_ptr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  CloseHandle( mapping ); /* The view keeps the mapping alive. */
+  if ( !data_ptr ) {
+    APG_PROF_END();
+    return false;
+  }
+#else
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 ) {
+    APG_PROF_END();
+    return false;
+  }
+  void* data_ptr = mmap( NULL, (size_t)sz, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd ); /* The mapping keeps the file open. */
+  if ( MAP_FAILED == data_ptr ) {
+    APG_PROF_END();
+    return false;
+  }
+#endif
+  record->data_ptr = data_ptr;
+  record->sz       = (size_t)sz;
+  APG_PROF_END();
+  return true;
+}
+
+void apg_file_unmap( apg_file_t* record ) {
+  if ( !record || !record->data_ptr ) { return; }
+#ifdef _WIN32
+  UnmapViewOfFile( record->data_ptr );
+#else
+  munmap( record->data_ptr, record->sz );
+#endif
+  *record = ( apg_file_t ){ .data_ptr = NULL };
+}
+
 /*=================================================================================================
 LOG FILES IMPLEMENTATION
 =================================================================================================*/
 #define APG_LOG_FILE "apg.log" /* file name for log */
 
+#ifndef APG_LOG_ASYNC_SLOTS
+#define APG_LOG_ASYNC_SLOTS 4096
+#endif
+#ifndef APG_LOG_ASYNC_MSG_MAX
+#define APG_LOG_ASYNC_MSG_MAX 256
+#endif
+#define APG_LOG_ASYNC_BATCH_MAX APG_KILOBYTES( 64 ) /* Writer thread accumulates messages up to this size before each fwrite(). */
+
+/* A message slot in the ring buffer. Bounded MPSC queue based on Dmitry Vyukov's sequence-numbered array design.
+ * seq == position    -> slot is free for the producer that claims `position`.
+ * seq == position+1  -> slot holds a complete message for the writer.
+ * The writer sets seq = position + APG_LOG_ASYNC_SLOTS when done, freeing it for the next lap around the ring. */
+typedef struct _apg_log_slot_t {
+  _apg_atomic_t seq;
+  int32_t len;
+  bool to_stderr;
+  char msg[APG_LOG_ASYNC_MSG_MAX];
+} _apg_log_slot_t;
+
+typedef struct _apg_log_async_t {
+  _apg_atomic_t enqueue_pos; /* Next position for producers to claim. */
+  char _pad0[64];            /* Keep the producer and consumer cursors on separate cache lines. */
+  _apg_atomic_t dequeue_pos; /* Next position to drain. Each message is claimed with a CAS on this, so the writer and crash handler never both write it. */
+  _apg_atomic_t written_pos; /* Every message before this position is in the log file. Set after the fwrite() and fflush() of its batch. */
+  char _pad1[64];
+  _apg_atomic_t running;          /* 1 while apg_log() calls go to the ring buffer. */
+  _apg_atomic_t active_producers; /* Callers currently between checking `running` and committing their slot. */
+  _apg_atomic_t stop_requested;
+  _apg_atomic_t writer_busy; /* Held by whoever is draining the ring: the writer thread, or the crash handler. */
+  _apg_log_slot_t* slots_ptr;
+  _apg_thread_t thread;
+  FILE* file_ptr;
+  size_t batch_len;
+  char batch[APG_LOG_ASYNC_BATCH_MAX];
+} _apg_log_async_t;
+
+static _apg_log_async_t _log_async;
+
+/* Returns false if async mode is off, in which case the caller should log synchronously. */
+static bool _apg_log_async_push( bool to_stderr, const char* message, va_list argptr ) {
+  _apg_atomic_add( &_log_async.active_producers, 1 );
+  if ( !_apg_atomic_load( &_log_async.running ) ) {
+    _apg_atomic_add( &_log_async.active_producers, -1 );
+    return false;
+  }
+
+  _apg_log_slot_t* slot_ptr = NULL;
+  int64_t pos               = _apg_atomic_load( &_log_async.enqueue_pos );
+  while ( true ) {
+    slot_ptr     = &_log_async.slots_ptr[pos & ( APG_LOG_ASYNC_SLOTS - 1 )];
+    int64_t diff = _apg_atomic_load( &slot_ptr->seq ) - pos;
+    if ( 0 == diff ) {
+      if ( _apg_atomic_cas( &_log_async.enqueue_pos, pos, pos + 1 ) ) { break; }
+    } else if ( diff < 0 ) {
+      _apg_thread_yield(); /* Ring is full - the writer hasn't freed this slot from the previous lap yet. */
+    }
+    pos = _apg_atomic_load( &_log_async.enqueue_pos );
+  }
+
+  int len = vsnprintf( slot_ptr->msg, APG_LOG_ASYNC_MSG_MAX, message, argptr );
+  if ( len < 0 ) { len = 0; }
+  if ( len >= APG_LOG_ASYNC_MSG_MAX ) { len = APG_LOG_ASYNC_MSG_MAX - 1; } /* Truncated. */
+  slot_ptr->len       = len;
+  slot_ptr->to_stderr = to_stderr;
+  _apg_atomic_store( &slot_ptr->seq, pos + 1 );
+
+  _apg_atomic_add( &_log_async.active_producers, -1 );
+  return true;
+}
+
+/* Write out the batch, then publish that every message before end_pos is in the file, for apg_log_flush(). */
+static void _apg_log_async_write_batch( FILE* file_ptr, int64_t end_pos ) {
+  if ( _log_async.batch_len > 0 && file_ptr ) {
+    fwrite( _log_async.batch, _log_async.batch_len, 1, file_ptr );
+    fflush( file_ptr );
+  }
+  _log_async.batch_len = 0;
+  _apg_atomic_store( &_log_async.written_pos, end_pos );
+}
+
+/* Copy every committed message into the batch buffer, then write the batch out. Caller must hold writer_busy to use the batch.
+ * If use_batch is false each message is written straight to the file instead, and the shared batch buffer isn't touched.
+ * The crash handler can end up draining alongside a stuck writer, so each message is claimed by advancing dequeue_pos before it's written.
+ * @return Number of messages drained. */
+static int64_t _apg_log_async_drain( FILE* file_ptr, bool use_batch ) {
+  int64_t n   = 0;
+  int64_t pos = _apg_atomic_load( &_log_async.dequeue_pos );
+  while ( true ) {
+    _apg_log_slot_t* slot_ptr = &_log_async.slots_ptr[pos & ( APG_LOG_ASYNC_SLOTS - 1 )];
+    if ( _apg_atomic_load( &slot_ptr->seq ) != pos + 1 ) { break; } /* Empty, or a producer has claimed the slot but not finished formatting yet. */
+    if ( !_apg_atomic_cas( &_log_async.dequeue_pos, pos, pos + 1 ) ) { /* The crash handler and a stuck writer can both be here - the other one took it. */
+      pos = _apg_atomic_load( &_log_async.dequeue_pos );
+      continue;
+    }
+
+    if ( !use_batch ) {
+      if ( file_ptr ) { fwrite( slot_ptr->msg, (size_t)slot_ptr->len, 1, file_ptr ); }
+    } else {
+      if ( _log_async.batch_len + (size_t)slot_ptr->len > APG_LOG_ASYNC_BATCH_MAX ) { _apg_log_async_write_batch( file_ptr, pos ); }
+      memcpy( &_log_async.batch[_log_async.batch_len], slot_ptr->msg, (size_t)slot_ptr->len );
+      _log_async.batch_len += (size_t)slot_ptr->len;
+    }
+    if ( slot_ptr->to_stderr ) { fwrite( slot_ptr->msg, (size_t)slot_ptr->len, 1, stderr ); }
+
+    _apg_atomic_store( &slot_ptr->seq, pos + APG_LOG_ASYNC_SLOTS );
+    pos++;
+    n++;
+  }
+  if ( use_batch ) { _apg_log_async_write_batch( file_ptr, pos ); }
+  return n;
+}
+
+_APG_THREAD_FUNC( _apg_log_async_writer_thread ) {
+  APG_UNUSED( arg_ptr );
+  while ( !_apg_atomic_load( &_log_async.stop_requested ) ) {
+    int64_t n = 0;
+    if ( _apg_atomic_cas( &_log_async.writer_busy, 0, 1 ) ) {
+      n = _apg_log_async_drain( _log_async.file_ptr, true );
+      _apg_atomic_store( &_log_async.writer_busy, 0 );
+    }
+    if ( 0 == n ) { apg_sleep_ms( 1 ); } /* Idle. Producers never block on the writer, so polling keeps them lock-free. */
+  }
+  if ( _apg_atomic_cas( &_log_async.writer_busy, 0, 1 ) ) {
+    _apg_log_async_drain( _log_async.file_ptr, true );
+    _apg_atomic_store( &_log_async.writer_busy, 0 );
+  }
+  _APG_THREAD_RETURN;
+}
+
+#ifndef APG_NO_BACKTRACES
+/* Called from the crash handler. Switches back to synchronous logging and writes out anything still buffered.
+ * If the writer thread doesn't let go within ~100ms it's either stuck or it's the thread that crashed, so drain anyway.
+ * Messages are written one at a time, not through the batch buffer, which the writer thread may still be using.
+ * Messages the writer already claimed into its batch are left to it, so nothing is written twice. */
+static void _apg_log_async_crash_flush( void ) {
+  if ( !_apg_atomic_cas( &_log_async.running, 1, 0 ) ) { return; }
+  for ( int i = 0; i < 100; i++ ) {
+    if ( _apg_atomic_cas( &_log_async.writer_busy, 0, 1 ) ) { break; }
+    apg_sleep_ms( 1 );
+  }
+  FILE* file_ptr = fopen( APG_LOG_FILE, "a" ); /* Don't trust the writer's FILE - it may be locked by the crashed thread. */
+  if ( !file_ptr ) { return; }
+  _apg_log_async_drain( file_ptr, false );
+  fclose( file_ptr );
+}
+#endif
+
+bool apg_log_async_start( void ) {
+  static bool registered_atexit = false;
+  if ( _apg_atomic_load( &_log_async.running ) ) { return true; }
+
+  _log_async.slots_ptr = malloc( sizeof( _apg_log_slot_t ) * APG_LOG_ASYNC_SLOTS );
+  if ( !_log_async.slots_ptr ) { return false; }
+  for ( int64_t i = 0; i < APG_LOG_ASYNC_SLOTS; i++ ) { _log_async.slots_ptr[i].seq = i; }
+  _log_async.enqueue_pos = _log_async.dequeue_pos = _log_async.written_pos = 0;
+  _log_async.stop_requested = _log_async.writer_busy = 0;
+  _log_async.batch_len                                 = 0;
+
+  _log_async.file_ptr = fopen( APG_LOG_FILE, "a" );
+  if ( !_log_async.file_ptr ) {
+    fprintf( stderr, "ERROR: could not open APG_LOG_FILE %s file for appending\n", APG_LOG_FILE );
+    goto _apg_log_async_start_fail;
+  }
+  if ( !_apg_thread_create( &_log_async.thread, _apg_log_async_writer_thread, NULL ) ) { goto _apg_log_async_start_fail; }
+  if ( !registered_atexit ) { registered_atexit = ( 0 == atexit( apg_log_async_stop ) ); }
+
+  _apg_atomic_store( &_log_async.running, 1 );
+  return true;
+
+_apg_log_async_start_fail:
+  if ( _log_async.file_ptr ) { fclose( _log_async.file_ptr ); }
+  free( _log_async.slots_ptr );
+  _log_async.file_ptr  = NULL;
+  _log_async.slots_ptr = NULL;
+  return false;
+}
+
+void apg_log_async_stop( void ) {
+  if ( !_apg_atomic_cas( &_log_async.running, 1, 0 ) ) { return; }
+  while ( _apg_atomic_load( &_log_async.active_producers ) > 0 ) { _apg_thread_yield(); } /* Let in-flight callers commit their slots. */
+  _apg_atomic_store( &_log_async.stop_requested, 1 );
+  _apg_thread_join( _log_async.thread );
+  fclose( _log_async.file_ptr );
+  free( _log_async.slots_ptr );
+  _log_async.file_ptr  = NULL;
+  _log_async.slots_ptr = NULL;
+}
+
+void apg_log_flush( void ) {
+  if ( !_apg_atomic_load( &_log_async.running ) ) { return; }
+  int64_t target = _apg_atomic_load( &_log_async.enqueue_pos );
+  while ( _apg_atomic_load( &_log_async.running ) && _apg_atomic_load( &_log_async.written_pos ) < target ) { _apg_thread_yield(); }
+}
+
 void apg_log_start( void ) {
   FILE* file = fopen( APG_LOG_FILE, "w" ); /* NOTE it was getting massive with "a" */
   if ( !file ) {
@@ -860,6 +1758,11 @@ void apg_log_start( void ) {
 
 void apg_log( const char* message, ... ) {
   va_list argptr;
+  va_start( argptr, message );
+  bool queued = _apg_log_async_push( false, message, argptr );
+  va_end( argptr );
+  if ( queued ) { return; }
+
   FILE* file = fopen( APG_LOG_FILE, "a" );
   if ( !file ) {
     fprintf( stderr, "ERROR: could not open APG_LOG_FILE %s file for appending\n", APG_LOG_FILE );
@@ -873,6 +1776,11 @@ void apg_log( const char* message, ... ) {
 
 void apg_log_err( const char* message, ... ) {
   va_list argptr;
+  va_start( argptr, message );
+  bool queued = _apg_log_async_push( true, message, argptr );
+  va_end( argptr );
+  if ( queued ) { return; }
+
   FILE* file = fopen( APG_LOG_FILE, "a" );
   if ( !file ) {
     fprintf( stderr, "ERROR: could not open APG_LOG_FILE %s file for appending\n", APG_LOG_FILE );
@@ -892,6 +1800,7 @@ BACKTRACES AND DUMPS IMPLEMENTATION
 =================================================================================================*/
 #ifndef APG_NO_BACKTRACES
 static void _crash_handler( int sig ) {
+  _apg_log_async_crash_flush();
   switch ( sig ) {
   case SIGSEGV: {
     apg_log_err( "FATAL ERROR: SIGSEGV- signal %i\nOut of bounds memory access or dereferencing a null pointer:\n", sig );
@@ -1022,6 +1931,508 @@ int apg_check_param( const char* check ) {
   return -1;
 }
 
+/*=================================================================================================
+MEMORY IMPLEMENTATION
+=================================================================================================*/
+#ifdef APG_ALLOC_DEBUG
+#define APG_ALLOC_GUARDS
+#define APG_ALLOC_POISON
+#endif
+
+#define _APG_ALLOC_NO_HDR SIZE_MAX
+#define _APG_ALLOC_GUARD_SZ 16
+#define _APG_ALLOC_GUARD_BYTE 0xFD
+#define _APG_ALLOC_UNINIT_BYTE 0xCD
+#define _APG_ALLOC_FREED_BYTE 0xDD
+#define _APG_ALLOC_MAGIC 0xA110CA7EDULL
+
+/* Hidden header placed directly before each arena allocation when APG_ALLOC_GUARDS is defined.
+ * Headers form a linked list back through the arena so apg_arena_check() can find every guard band. */
+typedef struct _apg_alloc_hdr_t {
+  size_t prev_hdr; /* Offset of the previous allocation's header, or _APG_ALLOC_NO_HDR. */
+  size_t user_sz;
+  uint64_t magic;
+  uint64_t _pad; /* Keeps the header a multiple of 16 bytes. */
+} _apg_alloc_hdr_t;
+
+static size_t _apg_align_up( size_t offset, size_t align ) { return ( offset + align - 1 ) & ~( align - 1 ); }
+
+#ifdef APG_ALLOC_GUARDS
+static bool _apg_guard_ok( const uint8_t* guard_ptr ) {
+  for ( int i = 0; i < _APG_ALLOC_GUARD_SZ; i++ ) {
+    if ( guard_ptr[i] != _APG_ALLOC_GUARD_BYTE ) { return false; }
+  }
+  return true;
+}
+#endif
+
+bool apg_arena_init( apg_arena_t* arena_ptr, size_t sz ) {
+  if ( !arena_ptr ) { return false; }
+  *arena_ptr = ( apg_arena_t ){ .last_hdr = _APG_ALLOC_NO_HDR };
+  if ( 0 == sz ) { return false; }
+  arena_ptr->base_ptr = malloc( sz );
+  if ( !arena_ptr->base_ptr ) { return false; }
+  arena_ptr->sz          = sz;
+  arena_ptr->owns_memory = true;
+#ifdef APG_ALLOC_POISON
+  memset( arena_ptr->base_ptr, _APG_ALLOC_FREED_BYTE, sz );
+#endif
+  return true;
+}
+
+void apg_arena_init_from_mem( apg_arena_t* arena_ptr, void* mem_ptr, size_t sz ) {
+  if ( !arena_ptr ) { return; }
+  *arena_ptr = ( apg_arena_t ){ .base_ptr = (uint8_t*)mem_ptr, .sz = mem_ptr ? sz : 0, .last_hdr = _APG_ALLOC_NO_HDR };
+}
+
+void apg_arena_free( apg_arena_t* arena_ptr ) {
+  if ( !arena_ptr ) { return; }
+  if ( arena_ptr->owns_memory ) { free( arena_ptr->base_ptr ); }
+  *arena_ptr = ( apg_arena_t ){ .last_hdr = _APG_ALLOC_NO_HDR };
+}
+
+void* apg_arena_alloc_aligned( apg_arena_t* arena_ptr, size_t sz, size_t align ) {
+  if ( !arena_ptr || !arena_ptr->base_ptr || 0 == align || ( align & ( align - 1 ) ) ) { return NULL; }
+  /* Align the absolute address, not just the offset, in case user-supplied memory isn't aligned. */
+  uintptr_t base = (uintptr_t)arena_ptr->base_ptr;
+#ifdef APG_ALLOC_GUARDS
+  align           = APG_MAX( align, sizeof( _apg_alloc_hdr_t ) );
+  size_t user_off = _apg_align_up( base + arena_ptr->used + sizeof( _apg_alloc_hdr_t ), align ) - base;
+  size_t end_off  = user_off + sz + _APG_ALLOC_GUARD_SZ;
+#else
+  size_t user_off = _apg_align_up( base + arena_ptr->used, align ) - base;
+  size_t end_off  = user_off + sz;
+#endif
+  if ( end_off > arena_ptr->sz || end_off < arena_ptr->used ) { return NULL; } /* Out of space, or size_t overflow. */
+
+  uint8_t* user_ptr = &arena_ptr->base_ptr[user_off];
+#ifdef APG_ALLOC_GUARDS
+  size_t hdr_off = user_off - sizeof( _apg_alloc_hdr_t );
+  _apg_alloc_hdr_t hdr = ( _apg_alloc_hdr_t ){ .prev_hdr = arena_ptr->last_hdr, .user_sz = sz, .magic = _APG_ALLOC_MAGIC };
+  memcpy( &arena_ptr->base_ptr[hdr_off], &hdr, sizeof( _apg_alloc_hdr_t ) );
+  memset( &user_ptr[sz], _APG_ALLOC_GUARD_BYTE, _APG_ALLOC_GUARD_SZ );
+  arena_ptr->last_hdr = hdr_off;
+#endif
+#ifdef APG_ALLOC_POISON
+  memset( user_ptr, _APG_ALLOC_UNINIT_BYTE, sz );
+#endif
+  arena_ptr->used = end_off;
+  arena_ptr->peak = APG_MAX( arena_ptr->peak, end_off );
+  return user_ptr;
+}
+
+void* apg_arena_alloc( apg_arena_t* arena_ptr, size_t sz ) { return apg_arena_alloc_aligned( arena_ptr, sz, APG_ARENA_ALIGN ); }
+
+void* apg_arena_calloc( apg_arena_t* arena_ptr, size_t n, size_t sz ) {
+  if ( sz && n > SIZE_MAX / sz ) { return NULL; }
+  void* mem_ptr = apg_arena_alloc( arena_ptr, n * sz );
+  if ( mem_ptr ) { memset( mem_ptr, 0, n * sz ); }
+  return mem_ptr;
+}
+
+apg_arena_mark_t apg_arena_mark( const apg_arena_t* arena_ptr ) {
+  if ( !arena_ptr ) { return ( apg_arena_mark_t ){ .last_hdr = _APG_ALLOC_NO_HDR }; }
+  return ( apg_arena_mark_t ){ .used = arena_ptr->used, .last_hdr = arena_ptr->last_hdr };
+}
+
+void apg_arena_reset_to_mark( apg_arena_t* arena_ptr, apg_arena_mark_t mark ) {
+  if ( !arena_ptr || mark.used > arena_ptr->used ) { return; }
+#ifdef APG_ALLOC_GUARDS
+  bool guards_ok = apg_arena_check( arena_ptr );
+  assert( guards_ok && "arena allocation overrun" );
+  APG_UNUSED( guards_ok );
+#endif
+#ifdef APG_ALLOC_POISON
+  memset( &arena_ptr->base_ptr[mark.used], _APG_ALLOC_FREED_BYTE, arena_ptr->used - mark.used );
+#endif
+  arena_ptr->used     = mark.used;
+  arena_ptr->last_hdr = mark.last_hdr;
+}
+
+void apg_arena_reset( apg_arena_t* arena_ptr ) { apg_arena_reset_to_mark( arena_ptr, ( apg_arena_mark_t ){ .used = 0, .last_hdr = _APG_ALLOC_NO_HDR } ); }
+
+bool apg_arena_check( const apg_arena_t* arena_ptr ) {
+  if ( !arena_ptr ) { return false; }
+#ifdef APG_ALLOC_GUARDS
+  for ( size_t hdr_off = arena_ptr->last_hdr; hdr_off != _APG_ALLOC_NO_HDR; ) {
+    _apg_alloc_hdr_t hdr;
+    memcpy( &hdr, &arena_ptr->base_ptr[hdr_off], sizeof( _apg_alloc_hdr_t ) );
+    size_t user_off = hdr_off + sizeof( _apg_alloc_hdr_t );
+    if ( hdr.magic != _APG_ALLOC_MAGIC ) {
+      fprintf( stderr, "ERROR: arena allocation header at offset %zu was overwritten. Underrun, or overrun of the previous allocation.\n", hdr_off );
+      return false;
+    }
+    if ( !_apg_guard_ok( &arena_ptr->base_ptr[user_off + hdr.user_sz] ) ) {
+      fprintf( stderr, "ERROR: arena allocation of %zu bytes at offset %zu was overrun.\n", hdr.user_sz, user_off );
+      return false;
+    }
+    hdr_off = hdr.prev_hdr;
+  }
+#endif
+  return true;
+}
+
+bool apg_frame_alloc_init( apg_frame_alloc_t* frame_ptr, size_t sz_per_frame ) {
+  if ( !frame_ptr ) { return false; }
+  *frame_ptr = ( apg_frame_alloc_t ){ .curr_idx = 0 };
+  if ( !apg_arena_init( &frame_ptr->arenas[0], sz_per_frame ) ) { return false; }
+  if ( !apg_arena_init( &frame_ptr->arenas[1], sz_per_frame ) ) {
+    apg_arena_free( &frame_ptr->arenas[0] );
+    return false;
+  }
+  return true;
+}
+
+void apg_frame_alloc_free( apg_frame_alloc_t* frame_ptr ) {
+  if ( !frame_ptr ) { return; }
+  apg_arena_free( &frame_ptr->arenas[0] );
+  apg_arena_free( &frame_ptr->arenas[1] );
+}
+
+void* apg_frame_alloc( apg_frame_alloc_t* frame_ptr, size_t sz ) {
+  if ( !frame_ptr ) { return NULL; }
+  return apg_arena_alloc( &frame_ptr->arenas[frame_ptr->curr_idx], sz );
+}
+
+apg_arena_t* apg_frame_arena( apg_frame_alloc_t* frame_ptr ) {
+  if ( !frame_ptr ) { return NULL; }
+  return &frame_ptr->arenas[frame_ptr->curr_idx];
+}
+
+void apg_frame_alloc_swap( apg_frame_alloc_t* frame_ptr ) {
+  if ( !frame_ptr ) { return; }
+  frame_ptr->curr_idx ^= 1;
+  apg_arena_reset( &frame_ptr->arenas[frame_ptr->curr_idx] );
+}
+
+bool apg_pool_init( apg_pool_t* pool_ptr, size_t block_sz, size_t n_blocks ) {
+  if ( !pool_ptr ) { return false; }
+  *pool_ptr = ( apg_pool_t ){ .block_sz = block_sz };
+  if ( 0 == block_sz || 0 == n_blocks ) { return false; }
+  size_t stride = APG_MAX( block_sz, sizeof( void* ) ); /* Free blocks store the free-list's next pointer in their first bytes. */
+#ifdef APG_ALLOC_GUARDS
+  stride += _APG_ALLOC_GUARD_SZ;
+  pool_ptr->in_use_ptr = calloc( n_blocks, 1 );
+  if ( !pool_ptr->in_use_ptr ) { return false; }
+#endif
+  stride = _apg_align_up( stride, APG_ARENA_ALIGN );
+  if ( n_blocks > SIZE_MAX / stride ) { goto _apg_pool_init_fail; }
+  pool_ptr->base_ptr = malloc( stride * n_blocks ); /* malloc() alignment is enough for APG_ARENA_ALIGN on 64-bit platforms. */
+  if ( !pool_ptr->base_ptr ) { goto _apg_pool_init_fail; }
+  pool_ptr->stride   = stride;
+  pool_ptr->n_blocks = n_blocks;
+
+  /* Thread the free-list through the blocks in address order so the first allocations are contiguous. */
+  for ( size_t i = 0; i < n_blocks; i++ ) {
+    uint8_t* block_ptr = &pool_ptr->base_ptr[i * stride];
+#ifdef APG_ALLOC_POISON
+    memset( block_ptr, _APG_ALLOC_FREED_BYTE, block_sz );
+#endif
+#ifdef APG_ALLOC_GUARDS
+    memset( &block_ptr[APG_MAX( block_sz, sizeof( void* ) )], _APG_ALLOC_GUARD_BYTE, _APG_ALLOC_GUARD_SZ );
+#endif
+    void* next_ptr = i + 1 < n_blocks ? &pool_ptr->base_ptr[( i + 1 ) * stride] : NULL;
+    memcpy( block_ptr, &next_ptr, sizeof( void* ) );
+  }
+  pool_ptr->free_list_ptr = pool_ptr->base_ptr;
+  return true;
+
+_apg_pool_init_fail:
+  free( pool_ptr->in_use_ptr );
+  *pool_ptr = ( apg_pool_t ){ .block_sz = 0 };
+  return false;
+}
+
+void apg_pool_free( apg_pool_t* pool_ptr ) {
+  if ( !pool_ptr ) { return; }
+  free( pool_ptr->base_ptr );
+  free( pool_ptr->in_use_ptr );
+  *pool_ptr = ( apg_pool_t ){ .block_sz = 0 };
+}
+
+void* apg_pool_alloc( apg_pool_t* pool_ptr ) {
+  if ( !pool_ptr || !pool_ptr->free_list_ptr ) { return NULL; }
+  uint8_t* block_ptr = (uint8_t*)pool_ptr->free_list_ptr;
+  memcpy( &pool_ptr->free_list_ptr, block_ptr, sizeof( void* ) );
+  pool_ptr->n_used++;
+#ifdef APG_ALLOC_POISON
+  for ( size_t i = sizeof( void* ); i < pool_ptr->block_sz; i++ ) {
+    if ( block_ptr[i] != _APG_ALLOC_FREED_BYTE ) {
+      fprintf( stderr, "ERROR: pool block %zu was written to after it was deallocated.\n", (size_t)( block_ptr - pool_ptr->base_ptr ) / pool_ptr->stride );
+      assert( false && "pool write after dealloc" );
+      break;
+    }
+  }
+  memset( block_ptr, _APG_ALLOC_UNINIT_BYTE, pool_ptr->block_sz );
+#endif
+#ifdef APG_ALLOC_GUARDS
+  pool_ptr->in_use_ptr[( block_ptr - pool_ptr->base_ptr ) / pool_ptr->stride] = 1;
+#endif
+  return block_ptr;
+}
+
+void apg_pool_dealloc( apg_pool_t* pool_ptr, void* block_ptr ) {
+  if ( !pool_ptr || !block_ptr ) { return; }
+  uint8_t* byte_ptr = (uint8_t*)block_ptr;
+  assert( byte_ptr >= pool_ptr->base_ptr && byte_ptr < pool_ptr->base_ptr + pool_ptr->stride * pool_ptr->n_blocks && "block is not from this pool" );
+#ifdef APG_ALLOC_GUARDS
+  size_t block_idx = (size_t)( byte_ptr - pool_ptr->base_ptr ) / pool_ptr->stride;
+  if ( !pool_ptr->in_use_ptr[block_idx] ) {
+    fprintf( stderr, "ERROR: pool block %zu was deallocated twice.\n", block_idx );
+    assert( false && "pool double dealloc" );
+    return;
+  }
+  if ( !_apg_guard_ok( &byte_ptr[APG_MAX( pool_ptr->block_sz, sizeof( void* ) )] ) ) {
+    fprintf( stderr, "ERROR: pool block %zu of %zu bytes was overrun.\n", block_idx, pool_ptr->block_sz );
+    assert( false && "pool block overrun" );
+  }
+  pool_ptr->in_use_ptr[block_idx] = 0;
+#endif
+#ifdef APG_ALLOC_POISON
+  memset( byte_ptr, _APG_ALLOC_FREED_BYTE, pool_ptr->block_sz );
+#endif
+  memcpy( byte_ptr, &pool_ptr->free_list_ptr, sizeof( void* ) );
+  pool_ptr->free_list_ptr = byte_ptr;
+  pool_ptr->n_used--;
+}
+
+/*=================================================================================================
+JOB SYSTEM IMPLEMENTATION
+=================================================================================================*/
+#define _APG_JOBS_IDLE_SPINS 64 /* Failed attempts to find work before a worker goes to sleep. */
+
+typedef struct _apg_job_t {
+  apg_job_func_t func_ptr;
+  apg_job_range_func_t range_func_ptr; /* If set, this is a piece of an apg_jobs_parallel_for() and func_ptr is unused. */
+  void* arg_ptr;
+  apg_job_counter_t* counter_ptr;
+  int64_t begin, end, grain;
+} _apg_job_t;
+
+/* Chase-Lev work-stealing deque, as in "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013, with a fixed-size ring.
+ * Only the owning thread touches `bottom`. Thieves race on `top` with a CAS. Top and bottom are kept on separate cache lines. */
+typedef struct _apg_jobs_deque_t {
+  _apg_atomic_t top;
+  uint8_t _pad_top[64 - sizeof( _apg_atomic_t )];
+  _apg_atomic_t bottom;
+  uint8_t _pad_bottom[64 - sizeof( _apg_atomic_t )];
+  _apg_job_t jobs[APG_JOBS_MAX_QUEUED];
+} _apg_jobs_deque_t;
+
+typedef struct _apg_jobs_t {
+  _apg_jobs_deque_t* deques_ptr; /* One per thread. Index 0 belongs to the thread that called apg_jobs_init(). */
+  _apg_thread_t threads[APG_JOBS_MAX_THREADS];
+  int thread_idxs[APG_JOBS_MAX_THREADS];
+  int n_threads;
+  _apg_atomic_t running;
+  _apg_atomic_t n_queued;   /* Jobs sitting in any deque. Lets idle workers decide to sleep without scanning every deque. */
+  _apg_atomic_t n_sleeping; /* Workers blocked on wake_cond. Pushers only take the mutex when this is non-zero. */
+  _apg_mutex_t sleep_mutex;
+  _apg_cond_t wake_cond;
+} _apg_jobs_t;
+
+static _apg_jobs_t _jobs;
+static _APG_THREAD_LOCAL int _jobs_thread_idx = -1;
+static _APG_THREAD_LOCAL uint32_t _jobs_steal_seed; /* xorshift state for picking a victim. */
+
+static bool _apg_jobs_deque_push( _apg_jobs_deque_t* deque_ptr, const _apg_job_t* job_ptr ) {
+  int64_t b = _apg_atomic_load( &deque_ptr->bottom );
+  int64_t t = _apg_atomic_load( &deque_ptr->top );
+  if ( b - t >= APG_JOBS_MAX_QUEUED ) { return false; }
+  deque_ptr->jobs[b & ( APG_JOBS_MAX_QUEUED - 1 )] = *job_ptr;
+  _apg_atomic_store( &deque_ptr->bottom, b + 1 ); /* Release, so a thief that sees the new bottom also sees the job. */
+  return true;
+}
+
+static bool _apg_jobs_deque_pop( _apg_jobs_deque_t* deque_ptr, _apg_job_t* job_ptr ) {
+  int64_t b = _apg_atomic_load( &deque_ptr->bottom ) - 1;
+  _apg_atomic_store( &deque_ptr->bottom, b );
+  _apg_atomic_fence(); /* The bottom store must be visible before top is read, or a thief and the owner could both take the last job. */
+  int64_t t = _apg_atomic_load( &deque_ptr->top );
+  if ( t > b ) { /* Empty. */
+    _apg_atomic_store( &deque_ptr->bottom, b + 1 );
+    return false;
+  }
+  *job_ptr = deque_ptr->jobs[b & ( APG_JOBS_MAX_QUEUED - 1 )];
+  if ( t < b ) { return true; } /* More than one job left, so no thief can be after this one. */
+  bool won = _apg_atomic_cas( &deque_ptr->top, t, t + 1 ); /* Last job. Race any thieves for it. */
+  _apg_atomic_store( &deque_ptr->bottom, b + 1 );
+  return won;
+}
+
+static bool _apg_jobs_deque_steal( _apg_jobs_deque_t* deque_ptr, _apg_job_t* job_ptr ) {
+  int64_t t = _apg_atomic_load( &deque_ptr->top );
+  _apg_atomic_fence();
+  int64_t b = _apg_atomic_load( &deque_ptr->bottom );
+  if ( t >= b ) { return false; }
+  /* Copy before claiming. If the CAS fails someone else took it and the copy, which may be torn, is thrown away. */
+  _apg_job_t job = deque_ptr->jobs[t & ( APG_JOBS_MAX_QUEUED - 1 )];
+  if ( !_apg_atomic_cas( &deque_ptr->top, t, t + 1 ) ) { return false; }
+  *job_ptr = job;
+  return true;
+}
+
+static bool _apg_jobs_take( int thread_idx, _apg_job_t* job_ptr ) {
+  if ( _apg_jobs_deque_pop( &_jobs.deques_ptr[thread_idx], job_ptr ) ) {
+    _apg_atomic_add( &_jobs.n_queued, -1 );
+    return true;
+  }
+  if ( _jobs.n_threads < 2 ) { return false; }
+  /* Start at a random victim so thieves spread out instead of all hitting thread 0. */
+  _jobs_steal_seed ^= _jobs_steal_seed << 13;
+  _jobs_steal_seed ^= _jobs_steal_seed >> 17;
+  _jobs_steal_seed ^= _jobs_steal_seed << 5;
+  int first = (int)( _jobs_steal_seed % (uint32_t)_jobs.n_threads );
+  for ( int i = 0; i < _jobs.n_threads; i++ ) {
+    int victim = ( first + i ) % _jobs.n_threads;
+    if ( victim == thread_idx ) { continue; }
+    if ( _apg_jobs_deque_steal( &_jobs.deques_ptr[victim], job_ptr ) ) {
+      _apg_atomic_add( &_jobs.n_queued, -1 );
+      return true;
+    }
+  }
+  return false;
+}
+
+static void _apg_jobs_execute( const _apg_job_t* job_ptr );
+
+static void _apg_jobs_push( const _apg_job_t* job_ptr ) {
+  int thread_idx = _jobs_thread_idx;
+  if ( _jobs.n_threads < 2 || thread_idx < 0 || !_apg_jobs_deque_push( &_jobs.deques_ptr[thread_idx], job_ptr ) ) {
+    _apg_jobs_execute( job_ptr ); /* Single-threaded, called from an unknown thread, or the deque is full. */
+    return;
+  }
+  _apg_atomic_add( &_jobs.n_queued, 1 );
+  _apg_atomic_fence(); /* Pairs with the fence in the worker's sleep path so a push can't slip between its check and its wait. */
+  if ( _apg_atomic_load( &_jobs.n_sleeping ) > 0 ) {
+    _apg_mutex_lock( &_jobs.sleep_mutex );
+    _apg_cond_signal( &_jobs.wake_cond );
+    _apg_mutex_unlock( &_jobs.sleep_mutex );
+  }
+}
+
+static void _apg_jobs_execute( const _apg_job_t* job_ptr ) {
+  if ( job_ptr->range_func_ptr ) {
+    /* Split off the upper half as a stealable job until what's left fits in one grain. */
+    int64_t begin = job_ptr->begin, end = job_ptr->end;
+    while ( end - begin > job_ptr->grain ) {
+      int64_t mid      = begin + ( end - begin ) / 2;
+      _apg_job_t upper = *job_ptr;
+      upper.begin      = mid;
+      upper.end        = end;
+      _apg_atomic_add( (_apg_atomic_t*)&job_ptr->counter_ptr->n_pending, 1 );
+      _apg_jobs_push( &upper );
+      end = mid;
+    }
+    job_ptr->range_func_ptr( begin, end, job_ptr->arg_ptr );
+  } else {
+    job_ptr->func_ptr( job_ptr->arg_ptr );
+  }
+  if ( job_ptr->counter_ptr ) { _apg_atomic_add( (_apg_atomic_t*)&job_ptr->counter_ptr->n_pending, -1 ); }
+}
+
+_APG_THREAD_FUNC( _apg_jobs_worker ) {
+  int thread_idx   = *(int*)arg_ptr;
+  _jobs_thread_idx = thread_idx;
+  _jobs_steal_seed = 2463534242u + (uint32_t)thread_idx * 7919u;
+  int n_idle_spins = 0;
+  while ( _apg_atomic_load( &_jobs.running ) ) {
+    _apg_job_t job;
+    if ( _apg_jobs_take( thread_idx, &job ) ) {
+      _apg_jobs_execute( &job );
+      n_idle_spins = 0;
+      continue;
+    }
+    if ( ++n_idle_spins < _APG_JOBS_IDLE_SPINS ) {
+      _apg_thread_yield();
+      continue;
+    }
+    _apg_mutex_lock( &_jobs.sleep_mutex );
+    _apg_atomic_add( &_jobs.n_sleeping, 1 );
+    _apg_atomic_fence();
+    while ( _apg_atomic_load( &_jobs.running ) && 0 == _apg_atomic_load( &_jobs.n_queued ) ) { _apg_cond_wait( &_jobs.wake_cond, &_jobs.sleep_mutex ); }
+    _apg_atomic_add( &_jobs.n_sleeping, -1 );
+    _apg_mutex_unlock( &_jobs.sleep_mutex );
+    n_idle_spins = 0;
+  }
+  _APG_THREAD_RETURN;
+}
+
+bool apg_jobs_init( int n_threads ) {
+  if ( _jobs.n_threads > 0 ) { return false; }
+  if ( n_threads <= 0 ) { n_threads = _apg_n_logical_cpus(); }
+  n_threads = APG_CLAMP( n_threads, 1, APG_JOBS_MAX_THREADS );
+
+  _jobs.deques_ptr = calloc( n_threads, sizeof( _apg_jobs_deque_t ) );
+  if ( !_jobs.deques_ptr ) { return false; }
+  _apg_atomic_store( &_jobs.running, 1 );
+  _apg_atomic_store( &_jobs.n_queued, 0 );
+  _apg_atomic_store( &_jobs.n_sleeping, 0 );
+  _apg_mutex_init( &_jobs.sleep_mutex );
+  _apg_cond_init( &_jobs.wake_cond );
+  _jobs_thread_idx = 0;
+  _jobs_steal_seed = 2463534242u;
+  _jobs.n_threads  = n_threads; /* Set before any worker starts, as they read it to pick victims. */
+  for ( int i = 1; i < n_threads; i++ ) {
+    _jobs.thread_idxs[i] = i;
+    if ( !_apg_thread_create( &_jobs.threads[i], _apg_jobs_worker, &_jobs.thread_idxs[i] ) ) {
+      fprintf( stderr, "ERROR: creating job system worker thread %i.\n", i );
+      _jobs.n_threads = i; /* Only join the threads that exist. */
+      apg_jobs_free();
+      return false;
+    }
+  }
+  return true;
+}
+
+void apg_jobs_free( void ) {
+  if ( 0 == _jobs.n_threads ) { return; }
+  _apg_mutex_lock( &_jobs.sleep_mutex );
+  _apg_atomic_store( &_jobs.running, 0 );
+  _apg_cond_broadcast( &_jobs.wake_cond );
+  _apg_mutex_unlock( &_jobs.sleep_mutex );
+  for ( int i = 1; i < _jobs.n_threads; i++ ) { _apg_thread_join( _jobs.threads[i] ); }
+  _apg_cond_destroy( &_jobs.wake_cond );
+  _apg_mutex_destroy( &_jobs.sleep_mutex );
+  free( _jobs.deques_ptr );
+  _jobs.deques_ptr = NULL;
+  _jobs.n_threads  = 0;
+  _jobs_thread_idx = -1;
+}
+
+int apg_jobs_n_threads( void ) { return _jobs.n_threads; }
+
+int apg_jobs_thread_idx( void ) { return _jobs_thread_idx; }
+
+void apg_jobs_run( apg_job_func_t func_ptr, void* arg_ptr, apg_job_counter_t* counter_ptr ) {
+  assert( func_ptr );
+  _apg_job_t job = ( _apg_job_t ){ .func_ptr = func_ptr, .arg_ptr = arg_ptr, .counter_ptr = counter_ptr };
+  if ( counter_ptr ) { _apg_atomic_add( (_apg_atomic_t*)&counter_ptr->n_pending, 1 ); }
+  _apg_jobs_push( &job );
+}
+
+void apg_jobs_wait( apg_job_counter_t* counter_ptr ) {
+  assert( counter_ptr );
+  int thread_idx = _jobs_thread_idx;
+  while ( _apg_atomic_load( (_apg_atomic_t*)&counter_ptr->n_pending ) > 0 ) {
+    _apg_job_t job;
+    if ( thread_idx >= 0 && _jobs.n_threads > 0 && _apg_jobs_take( thread_idx, &job ) ) {
+      _apg_jobs_execute( &job );
+    } else {
+      _apg_thread_yield(); /* Everything left is running on other threads. */
+    }
+  }
+}
+
+void apg_jobs_parallel_for( int64_t begin, int64_t end, int64_t grain, apg_job_range_func_t func_ptr, void* arg_ptr ) {
+  assert( func_ptr && grain >= 1 );
+  if ( end <= begin ) { return; }
+  apg_job_counter_t counter = ( apg_job_counter_t ){ .n_pending = 1 };
+  _apg_job_t job            = ( _apg_job_t ){ .range_func_ptr = func_ptr, .arg_ptr = arg_ptr, .counter_ptr = &counter, .begin = begin, .end = end, .grain = APG_MAX( grain, 1 ) };
+  _apg_jobs_execute( &job );
+  apg_jobs_wait( &counter );
+}
+
 /*=================================================================================================
 COMPRESSION
 =================================================================================================*/
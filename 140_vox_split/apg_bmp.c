@@ -1,7 +1,7 @@
 /*****************************************************************************\
 apg_bmp - BMP File Reader/Writer Implementation
 Anton Gerdelan
-Version: 3.4.0
+Version: 3.6.0
 Licence: see apg_bmp.h
 C99
 \*****************************************************************************/
@@ -13,6 +13,19 @@ C99
 #include <stdlib.h>
 #include <string.h>
 
+/* Row converters have SSE2, SSSE3, and AVX2 versions on x86 with GCC, Clang, and MSVC. They're compiled for their instruction set with
+   function attributes, so no -m flags are needed, and picked at run time with cpuid. Define APG_BMP_NO_SIMD to build the plain C ones only. */
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) ) && !defined( APG_BMP_NO_SIMD )
+#define _BMP_X86
+#include <immintrin.h>
+#define _BMP_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) ) && !defined( APG_BMP_NO_SIMD )
+#define _BMP_X86
+#include <immintrin.h>
+#include <intrin.h>
+#define _BMP_TARGET( isa )
+#endif
+
 /* Maximum pixel dimensions of width or height of an image. Should accommodate max used in graphics APIs.
    NOTE: 65536*65536 is the biggest number storable in 32 bits.
    This needs to be multiplied by n_channels so actual memory indices are not uint32 but size_t to avoid overflow.
@@ -127,15 +140,266 @@ static bool _validate_dib_hdr( _bmp_dib_BITMAPINFOHEADER_t* dib_hdr_ptr, size_t
   return true;
 }
 
-/* NOTE(Anton) This could have ifdef branches on different compilers for the intrinsics versions for perf. */
+/* Index of the lowest set bit, or 0 if none are set. */
 static uint32_t _bitscan( uint32_t dword ) {
+  if ( !dword ) { return 0; }
+#if defined( __GNUC__ ) || defined( __clang__ )
+  return (uint32_t)__builtin_ctz( dword );
+#elif defined( _MSC_VER )
+  unsigned long idx;
+  _BitScanForward( &idx, dword );
+  return (uint32_t)idx;
+#else
   for ( uint32_t i = 0; i < 32; i++ ) {
     if ( 1 & dword ) { return i; }
     dword = dword >> 1;
   }
   return 0;
+#endif
+}
+
+/* ---------------------------------------------------------------- Row converters ----------------------------------------------------------------
+Each converts n pixels of one row. The plain C versions are the reference; the others must give identical output. */
+
+/** Channel masks of a 32-bit BI_BITFIELDS image. Each output byte is ( ( pixel & mask ) >> shift ) truncated to 8 bits. */
+typedef struct _bmp_bitfields_t {
+  uint32_t masks[4];  // R, G, B, A.
+  uint32_t shifts[4]; // Lowest set bit of each mask.
+  bool bytewise;      // Every channel is a whole byte of the pixel, or 0, so conversion is a byte shuffle.
+  uint8_t shuffle[4]; // If bytewise, the source byte of each channel, or 0x80 for 0.
+} _bmp_bitfields_t;
+
+static _bmp_bitfields_t _bmp_bitfields( uint32_t mask_r, uint32_t mask_g, uint32_t mask_b ) {
+  _bmp_bitfields_t bf = ( _bmp_bitfields_t ){ .masks = { mask_r, mask_g, mask_b, ~( mask_r | mask_g | mask_b ) }, .bytewise = true };
+  for ( int c = 0; c < 4; c++ ) {
+    bf.shifts[c] = _bitscan( bf.masks[c] );
+    if ( 0 == bf.masks[c] ) {
+      bf.shuffle[c] = 0x80;
+    } else if ( 0 == bf.shifts[c] % 8 && 0xFF == ( ( bf.masks[c] >> bf.shifts[c] ) & 0xFF ) ) {
+      bf.shuffle[c] = (uint8_t)( bf.shifts[c] / 8 );
+    } else {
+      bf.bytewise = false;
+    }
+  }
+  return bf;
+}
+
+static void _bmp_bitfields_c( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr ) {
+  for ( uint32_t i = 0; i < n; i++ ) {
+    uint32_t pixel;
+    memcpy( &pixel, &src_ptr[i * 4], 4 );
+    // NOTE(Anton) The below assumes 32-bits is always RGBA 1 byte per channel. 10,10,10 RGB exists though and isn't handled.
+    for ( int c = 0; c < 4; c++ ) { dst_ptr[i * 4 + c] = (uint8_t)( ( pixel & bf_ptr->masks[c] ) >> bf_ptr->shifts[c] ); }
+  }
+}
+
+/** BGR to RGB. */
+static void _bmp_bgr_c( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n ) {
+  for ( uint32_t i = 0; i < n; i++ ) {
+    dst_ptr[i * 3 + 0] = src_ptr[i * 3 + 2];
+    dst_ptr[i * 3 + 1] = src_ptr[i * 3 + 1];
+    dst_ptr[i * 3 + 2] = src_ptr[i * 3 + 0];
+  }
+}
+
+/** 8-bit palette indices to RGB. palette_ptr has 256 entries, each R | G << 8 | B << 16. */
+static void _bmp_palette8_c( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const uint32_t* palette_ptr ) {
+  for ( uint32_t i = 0; i < n; i++ ) {
+    uint32_t rgb       = palette_ptr[src_ptr[i]];
+    dst_ptr[i * 3 + 0] = (uint8_t)rgb;
+    dst_ptr[i * 3 + 1] = (uint8_t)( rgb >> 8 );
+    dst_ptr[i * 3 + 2] = (uint8_t)( rgb >> 16 );
+  }
+}
+
+#ifdef _BMP_X86
+/* SSE2 and AVX2 bitfields do the plain C version's and-shift-truncate on 4 or 8 pixels at once, for masks that aren't whole bytes. */
+static _BMP_TARGET( "sse2" ) void _bmp_bitfields_sse2( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr ) {
+  __m128i masks[4], shifts[4], lo_byte = _mm_set1_epi32( 0xFF );
+  for ( int c = 0; c < 4; c++ ) {
+    masks[c]  = _mm_set1_epi32( (int)bf_ptr->masks[c] );
+    shifts[c] = _mm_cvtsi32_si128( (int)bf_ptr->shifts[c] );
+  }
+  uint32_t i = 0;
+  for ( ; i + 4 <= n; i += 4 ) {
+    __m128i px = _mm_loadu_si128( (const __m128i*)&src_ptr[i * 4] );
+    __m128i r  = _mm_and_si128( _mm_srl_epi32( _mm_and_si128( px, masks[0] ), shifts[0] ), lo_byte );
+    __m128i g  = _mm_and_si128( _mm_srl_epi32( _mm_and_si128( px, masks[1] ), shifts[1] ), lo_byte );
+    __m128i b  = _mm_and_si128( _mm_srl_epi32( _mm_and_si128( px, masks[2] ), shifts[2] ), lo_byte );
+    __m128i a  = _mm_and_si128( _mm_srl_epi32( _mm_and_si128( px, masks[3] ), shifts[3] ), lo_byte );
+    __m128i rgba = _mm_or_si128( _mm_or_si128( r, _mm_slli_epi32( g, 8 ) ), _mm_or_si128( _mm_slli_epi32( b, 16 ), _mm_slli_epi32( a, 24 ) ) );
+    _mm_storeu_si128( (__m128i*)&dst_ptr[i * 4], rgba );
+  }
+  _bmp_bitfields_c( &src_ptr[i * 4], &dst_ptr[i * 4], n - i, bf_ptr );
+}
+
+static _BMP_TARGET( "avx2" ) void _bmp_bitfields_avx2( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr ) {
+  __m256i masks[4], lo_byte = _mm256_set1_epi32( 0xFF );
+  __m128i shifts[4];
+  for ( int c = 0; c < 4; c++ ) {
+    masks[c]  = _mm256_set1_epi32( (int)bf_ptr->masks[c] );
+    shifts[c] = _mm_cvtsi32_si128( (int)bf_ptr->shifts[c] );
+  }
+  uint32_t i = 0;
+  for ( ; i + 8 <= n; i += 8 ) {
+    __m256i px = _mm256_loadu_si256( (const __m256i*)&src_ptr[i * 4] );
+    __m256i r  = _mm256_and_si256( _mm256_srl_epi32( _mm256_and_si256( px, masks[0] ), shifts[0] ), lo_byte );
+    __m256i g  = _mm256_and_si256( _mm256_srl_epi32( _mm256_and_si256( px, masks[1] ), shifts[1] ), lo_byte );
+    __m256i b  = _mm256_and_si256( _mm256_srl_epi32( _mm256_and_si256( px, masks[2] ), shifts[2] ), lo_byte );
+    __m256i a  = _mm256_and_si256( _mm256_srl_epi32( _mm256_and_si256( px, masks[3] ), shifts[3] ), lo_byte );
+    __m256i rgba =
+      _mm256_or_si256( _mm256_or_si256( r, _mm256_slli_epi32( g, 8 ) ), _mm256_or_si256( _mm256_slli_epi32( b, 16 ), _mm256_slli_epi32( a, 24 ) ) );
+    _mm256_storeu_si256( (__m256i*)&dst_ptr[i * 4], rgba );
+  }
+  _bmp_bitfields_c( &src_ptr[i * 4], &dst_ptr[i * 4], n - i, bf_ptr );
+}
+
+/* Whole-byte masks, such as those apg_bmp_write() uses, are one pshufb per 4 or 8 pixels. */
+static _BMP_TARGET( "ssse3" ) void _bmp_swizzle_ssse3( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr ) {
+  uint8_t ctrl[16];
+  for ( int p = 0; p < 4; p++ ) {
+    for ( int c = 0; c < 4; c++ ) { ctrl[p * 4 + c] = 0x80 == bf_ptr->shuffle[c] ? 0x80 : (uint8_t)( p * 4 + bf_ptr->shuffle[c] ); }
+  }
+  __m128i shuffle = _mm_loadu_si128( (const __m128i*)ctrl );
+  uint32_t i      = 0;
+  for ( ; i + 4 <= n; i += 4 ) {
+    __m128i px = _mm_loadu_si128( (const __m128i*)&src_ptr[i * 4] );
+    _mm_storeu_si128( (__m128i*)&dst_ptr[i * 4], _mm_shuffle_epi8( px, shuffle ) );
+  }
+  _bmp_bitfields_c( &src_ptr[i * 4], &dst_ptr[i * 4], n - i, bf_ptr );
+}
+
+static _BMP_TARGET( "avx2" ) void _bmp_swizzle_avx2( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr ) {
+  uint8_t ctrl[16];
+  for ( int p = 0; p < 4; p++ ) {
+    for ( int c = 0; c < 4; c++ ) { ctrl[p * 4 + c] = 0x80 == bf_ptr->shuffle[c] ? 0x80 : (uint8_t)( p * 4 + bf_ptr->shuffle[c] ); }
+  }
+  __m256i shuffle = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)ctrl ) ); // vpshufb works within each 16-byte lane.
+  uint32_t i      = 0;
+  for ( ; i + 8 <= n; i += 8 ) {
+    __m256i px = _mm256_loadu_si256( (const __m256i*)&src_ptr[i * 4] );
+    _mm256_storeu_si256( (__m256i*)&dst_ptr[i * 4], _mm256_shuffle_epi8( px, shuffle ) );
+  }
+  _bmp_bitfields_c( &src_ptr[i * 4], &dst_ptr[i * 4], n - i, bf_ptr );
 }
 
+/* 5 pixels per 16-byte load and store. Each store's last byte is garbage, overwritten by the next, so the last 6 pixels are done in C. */
+static _BMP_TARGET( "ssse3" ) void _bmp_bgr_ssse3( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n ) {
+  const __m128i shuffle = _mm_setr_epi8( 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15 );
+  uint32_t i            = 0;
+  for ( ; i + 6 <= n; i += 5 ) {
+    __m128i px = _mm_loadu_si128( (const __m128i*)&src_ptr[i * 3] );
+    _mm_storeu_si128( (__m128i*)&dst_ptr[i * 3], _mm_shuffle_epi8( px, shuffle ) );
+  }
+  _bmp_bgr_c( &src_ptr[i * 3], &dst_ptr[i * 3], n - i );
+}
+
+/* Palette entries are looked up as 32-bit words and packed down to 3 bytes each. The 16-byte stores overlap the same way as for BGR. */
+static _BMP_TARGET( "ssse3" ) void _bmp_palette8_ssse3( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const uint32_t* palette_ptr ) {
+  const __m128i pack = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+  uint32_t i         = 0;
+  for ( ; i + 6 <= n; i += 4 ) {
+    __m128i rgbx = _mm_setr_epi32(
+      (int)palette_ptr[src_ptr[i + 0]], (int)palette_ptr[src_ptr[i + 1]], (int)palette_ptr[src_ptr[i + 2]], (int)palette_ptr[src_ptr[i + 3]] );
+    _mm_storeu_si128( (__m128i*)&dst_ptr[i * 3], _mm_shuffle_epi8( rgbx, pack ) );
+  }
+  _bmp_palette8_c( &src_ptr[i], &dst_ptr[i * 3], n - i, palette_ptr );
+}
+
+/* 8 pixels per gather. Each 16-byte lane packs to 12 bytes, and the two lanes are stored overlapping. */
+static _BMP_TARGET( "avx2" ) void _bmp_palette8_avx2( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const uint32_t* palette_ptr ) {
+  const __m256i pack = _mm256_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+  uint32_t i         = 0;
+  for ( ; i + 10 <= n; i += 8 ) {
+    __m256i indices = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)&src_ptr[i] ) );
+    __m256i rgbx    = _mm256_shuffle_epi8( _mm256_i32gather_epi32( (const int*)palette_ptr, indices, 4 ), pack );
+    _mm_storeu_si128( (__m128i*)&dst_ptr[i * 3], _mm256_castsi256_si128( rgbx ) );
+    _mm_storeu_si128( (__m128i*)&dst_ptr[i * 3 + 12], _mm256_extracti128_si256( rgbx, 1 ) );
+  }
+  _bmp_palette8_c( &src_ptr[i], &dst_ptr[i * 3], n - i, palette_ptr );
+}
+#endif /* _BMP_X86 */
+
+/** The converters for one image. */
+typedef struct _bmp_converters_t {
+  void ( *bitfields )( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr );
+  void ( *swizzle )( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const _bmp_bitfields_t* bf_ptr ); // Bytewise bitfields only.
+  void ( *bgr )( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n );
+  void ( *palette8 )( const uint8_t* src_ptr, uint8_t* dst_ptr, uint32_t n, const uint32_t* palette_ptr );
+} _bmp_converters_t;
+
+static int _bmp_simd_max = APG_BMP_SIMD_AVX2;
+
+#ifdef _BMP_X86
+/** @returns The best instruction set this CPU and OS support, up to APG_BMP_SIMD_AVX2. */
+static int _bmp_cpu_simd( void ) {
+#if defined( __GNUC__ ) || defined( __clang__ )
+  __builtin_cpu_init(); // Also checks the OS saves AVX registers.
+  if ( __builtin_cpu_supports( "avx2" ) ) { return APG_BMP_SIMD_AVX2; }
+  if ( __builtin_cpu_supports( "ssse3" ) ) { return APG_BMP_SIMD_SSSE3; }
+  if ( __builtin_cpu_supports( "sse2" ) ) { return APG_BMP_SIMD_SSE2; }
+#else
+  int regs[4];
+  __cpuid( regs, 0 );
+  int n_leaves = regs[0];
+  __cpuid( regs, 1 );
+  bool ssse3 = ( regs[2] >> 9 ) & 1, sse2 = ( regs[3] >> 26 ) & 1, os_avx = ( ( regs[2] >> 27 ) & 1 ) && ( ( regs[2] >> 28 ) & 1 );
+  os_avx     = os_avx && 6 == ( _xgetbv( 0 ) & 6 ); // XMM and YMM state saved by the OS.
+  if ( n_leaves >= 7 && os_avx ) {
+    __cpuidex( regs, 7, 0 );
+    if ( ( regs[1] >> 5 ) & 1 ) { return APG_BMP_SIMD_AVX2; }
+  }
+  if ( ssse3 ) { return APG_BMP_SIMD_SSSE3; }
+  if ( sse2 ) { return APG_BMP_SIMD_SSE2; }
+#endif
+  return APG_BMP_SIMD_NONE;
+}
+#endif /* _BMP_X86 */
+
+static _bmp_converters_t _bmp_converters( void ) {
+  _bmp_converters_t conv = ( _bmp_converters_t ){ _bmp_bitfields_c, _bmp_bitfields_c, _bmp_bgr_c, _bmp_palette8_c };
+#ifdef _BMP_X86
+  int simd = _bmp_cpu_simd();
+  simd     = simd < _bmp_simd_max ? simd : _bmp_simd_max;
+  if ( simd >= APG_BMP_SIMD_SSE2 ) { conv.bitfields = conv.swizzle = _bmp_bitfields_sse2; }
+  if ( simd >= APG_BMP_SIMD_SSSE3 ) {
+    conv.swizzle  = _bmp_swizzle_ssse3;
+    conv.bgr      = _bmp_bgr_ssse3;
+    conv.palette8 = _bmp_palette8_ssse3;
+  }
+  if ( simd >= APG_BMP_SIMD_AVX2 ) {
+    conv.bitfields = _bmp_bitfields_avx2;
+    conv.swizzle   = _bmp_swizzle_avx2;
+    conv.palette8  = _bmp_palette8_avx2;
+  }
+#endif
+  return conv;
+}
+
+int apg_bmp_simd_max( int max_simd ) {
+  if ( max_simd >= APG_BMP_SIMD_NONE && max_simd <= APG_BMP_SIMD_AVX2 ) { _bmp_simd_max = max_simd; }
+#ifdef _BMP_X86
+  int simd = _bmp_cpu_simd();
+  return simd < _bmp_simd_max ? simd : _bmp_simd_max;
+#else
+  return APG_BMP_SIMD_NONE;
+#endif
+}
+
+/** Fills palette_rgb with R | G << 8 | B << 16 from a palette of BGR0 entries, which may be cut short by the end of the data at data_sz.
+ * @returns The number of entries, up to 256, whose colour ends before data_sz. The rest of palette_rgb is 0. */
+static uint32_t _bmp_palette_rgb( const uint8_t* palette_ptr, size_t palette_offset, size_t data_sz, uint32_t* palette_rgb ) {
+  uint32_t n = 0;
+  memset( palette_rgb, 0, 256 * sizeof( uint32_t ) );
+  for ( ; n < 256 && palette_offset + n * 4 + 2 < data_sz; n++ ) {
+    palette_rgb[n] = (uint32_t)palette_ptr[n * 4 + 2] | (uint32_t)palette_ptr[n * 4 + 1] << 8 | (uint32_t)palette_ptr[n * 4 + 0] << 16;
+  }
+  return n;
+}
+
+/** @returns The output row of the r-th row stored in the file. Rows are stored bottom-up unless the header's height is negative. */
+static inline size_t _bmp_dst_row( uint32_t r, uint32_t height, bool top_down ) { return top_down ? r : height - 1 - r; }
+
 unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int* n_chans ) {
   _entire_file_t record = ( _entire_file_t ){ .data = NULL };
   uint8_t* dst_img_ptr  = NULL;
@@ -153,9 +417,10 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
   _bmp_dib_BITMAPINFOHEADER_t* dib_hdr_ptr = (_bmp_dib_BITMAPINFOHEADER_t*)( (uint8_t*)record.data + _BMP_FILE_HDR_SZ );
   if ( !_validate_dib_hdr( dib_hdr_ptr, record.sz ) ) { goto apg_bmp_read_error; }
 
-  // Bitmaps can have negative dims to indicate the image should be flipped.
+  // Bitmaps can have negative dims to indicate the image should be flipped. Negative height means rows are stored top-down.
   uint32_t width = *w = abs( dib_hdr_ptr->w );
   uint32_t height = *h = abs( dib_hdr_ptr->h );
+  bool top_down        = dib_hdr_ptr->h < 0;
 
   // Channel count and palette are not well defined in the header so we make a good guess here.
   uint32_t n_dst_chans = 3, n_src_chans = 3;
@@ -213,15 +478,9 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
   }
 
   // Find which bit number each colour channel starts at, so we can separate colours out.
-  uint32_t bitshift_rgba[4] = { 0, 0, 0, 0 };
-  uint32_t bitmask_a        = 0;
-  if ( has_bitmasks ) {
-    bitmask_a        = ~( dib_hdr_ptr->bitmask_r | dib_hdr_ptr->bitmask_g | dib_hdr_ptr->bitmask_b );
-    bitshift_rgba[0] = _bitscan( dib_hdr_ptr->bitmask_r );
-    bitshift_rgba[1] = _bitscan( dib_hdr_ptr->bitmask_g );
-    bitshift_rgba[2] = _bitscan( dib_hdr_ptr->bitmask_b );
-    bitshift_rgba[3] = _bitscan( bitmask_a );
-  }
+  _bmp_bitfields_t bitfields = ( _bmp_bitfields_t ){ .bytewise = false };
+  if ( has_bitmasks ) { bitfields = _bmp_bitfields( dib_hdr_ptr->bitmask_r, dib_hdr_ptr->bitmask_g, dib_hdr_ptr->bitmask_b ); }
+  _bmp_converters_t conv = _bmp_converters();
 
   // Allocate memory for the output pixels block. Cast to size_t in case width and height are both the max of 65536 and n_dst_chans > 1.
   size_t dst_img_sz = (size_t)width * (size_t)height * (size_t)n_dst_chans;
@@ -237,20 +496,10 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
   if ( 32 == dib_hdr_ptr->bpp ) {
     // Check source image has enough data in it to read from.
     if ( (size_t)file_hdr_ptr->image_data_offset + (size_t)height * (size_t)width * (size_t)n_src_chans > record.sz ) { goto apg_bmp_read_error; }
-    size_t src_byte_idx = 0;
+    void ( *convert_row )( const uint8_t*, uint8_t*, uint32_t, const _bmp_bitfields_t* ) = bitfields.bytewise ? conv.swizzle : conv.bitfields;
     for ( uint32_t r = 0; r < height; r++ ) {
-      size_t dst_pixels_idx = ( height - 1 - r ) * dst_stride_sz;
-      for ( uint32_t c = 0; c < width; c++ ) {
-        uint32_t pixel;
-        memcpy( &pixel, &src_img_ptr[src_byte_idx], 4 );
-        // NOTE(Anton) The below assumes 32-bits is always RGBA 1 byte per channel. 10,10,10 RGB exists though and isn't handled.
-        dst_img_ptr[dst_pixels_idx++] = (uint8_t)( ( pixel & dib_hdr_ptr->bitmask_r ) >> bitshift_rgba[0] );
-        dst_img_ptr[dst_pixels_idx++] = (uint8_t)( ( pixel & dib_hdr_ptr->bitmask_g ) >> bitshift_rgba[1] );
-        dst_img_ptr[dst_pixels_idx++] = (uint8_t)( ( pixel & dib_hdr_ptr->bitmask_b ) >> bitshift_rgba[2] );
-        dst_img_ptr[dst_pixels_idx++] = (uint8_t)( ( pixel & bitmask_a ) >> bitshift_rgba[3] );
-        src_byte_idx += 4;
-      }
-      src_byte_idx += row_padding_sz;
+      uint8_t* dst_row_ptr = &dst_img_ptr[_bmp_dst_row( r, height, top_down ) * dst_stride_sz];
+      convert_row( &src_img_ptr[(size_t)r * ( unpadded_row_sz + row_padding_sz )], dst_row_ptr, width, &bitfields );
     }
 
     // == 8-bpp -> 24-bit RGB ==
@@ -258,9 +507,9 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
     if ( BI_RLE8 == dib_hdr_ptr->compression_method ) {
       // RLE Compressed:
       size_t row = 0, col = 0, byte_idx = 0;
-      size_t dst_pixels_idx = ( height - 1 - row ) * dst_stride_sz;
+      size_t dst_pixels_idx = _bmp_dst_row( row, height, top_down ) * dst_stride_sz;
       // Iterate over the "Colour-index array".
-      while ( byte_idx + 1 < record.sz ) {
+      while ( byte_idx + 1 < src_img_sz ) {
         uint8_t byte_a = src_img_ptr[byte_idx++];
         uint8_t byte_b = src_img_ptr[byte_idx++];
         // Absolute_mode run:
@@ -284,8 +533,8 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
         if ( 0x00 == byte_a && 0x00 == byte_b ) { // "End line".
           col = 0;
           row++;
-          if ( row >= height ) { goto apg_bmp_read_error; }
-          dst_pixels_idx = ( height - 1 - row ) * dst_stride_sz;
+          if ( row >= height ) { break; } // Encoders usually end the last line too, before "End of bitmap".
+          dst_pixels_idx = _bmp_dst_row( row, height, top_down ) * dst_stride_sz;
           continue;
         } else if ( 0x00 == byte_a && 0x01 == byte_b ) { // "End of bitmap".
           break;                                         // break `Iterate over the "Colour-index array".`
@@ -317,24 +566,23 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
       // Validate indices (body of image data) fits in file.
       if ( file_hdr_ptr->image_data_offset + height * width > record.sz ) { goto apg_bmp_read_error; }
 
-      size_t src_byte_idx = 0;
+      // "most palettes are 4 bytes in RGB0 order but 3 for..." - it was actually BRG0 in old images -- Anton
+      // Indices of entries that would run past the end of the file are invalid, and the image is returned as far as the first of those.
+      uint32_t palette_rgb[256];
+      uint32_t n_valid_indices = _bmp_palette_rgb( palette_data_ptr, palette_offset, record.sz, palette_rgb );
       for ( uint32_t r = 0; r < height; r++ ) {
-        size_t dst_pixels_idx = ( height - 1 - r ) * dst_stride_sz;
-        for ( uint32_t c = 0; c < width; c++ ) {
-          // "most palettes are 4 bytes in RGB0 order but 3 for..." - it was actually BRG0 in old images -- Anton
-          uint8_t index = src_img_ptr[src_byte_idx]; // 8-bit index value per pixel.
-
-          if ( palette_offset + index * 4 + 2 >= record.sz ) {
-            free( record.data );
-            return dst_img_ptr;
-          }
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[index * 4 + 2];
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[index * 4 + 1];
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[index * 4 + 0];
-          src_byte_idx++;
-        } // endfor col.
-        src_byte_idx += row_padding_sz;
-      }   // endfor row.
+        const uint8_t* src_row_ptr = &src_img_ptr[(size_t)r * ( unpadded_row_sz + row_padding_sz )];
+        uint32_t n_valid_pixels    = width;
+        if ( (size_t)r * ( unpadded_row_sz + row_padding_sz ) + width > src_img_sz ) { goto apg_bmp_read_error; }
+        if ( n_valid_indices < 256 ) {
+          for ( n_valid_pixels = 0; n_valid_pixels < width && src_row_ptr[n_valid_pixels] < n_valid_indices; n_valid_pixels++ ) { ; }
+        }
+        conv.palette8( src_row_ptr, &dst_img_ptr[_bmp_dst_row( r, height, top_down ) * dst_stride_sz], n_valid_pixels, palette_rgb );
+        if ( n_valid_pixels < width ) {
+          free( record.data );
+          return dst_img_ptr;
+        }
+      } // endfor row.
     }     // endif RLE/Uncompressed 24-bit RGB.
 
     // == 4-bpp (16-colour) -> 24-bit RGB ==
@@ -343,9 +591,9 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
       // RLE4 Compressed:
 
       size_t col = 0, row = 0, byte_idx = 0;
-      size_t dst_pixels_idx = ( height - 1 - row ) * dst_stride_sz;
+      size_t dst_pixels_idx = _bmp_dst_row( row, height, top_down ) * dst_stride_sz;
       // Iterate over the "Colour-index array".
-      while ( byte_idx + 1 < record.sz ) {
+      while ( byte_idx + 1 < src_img_sz ) {
         uint8_t byte_a = src_img_ptr[byte_idx++];
         uint8_t byte_b = src_img_ptr[byte_idx++];
 
@@ -387,8 +635,8 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
         if ( 0x00 == byte_a && 0x00 == byte_b ) { // "End line".
           col = 0;
           row++;
-          if ( row >= height ) { goto apg_bmp_read_error; }
-          dst_pixels_idx = ( height - 1 - row ) * dst_stride_sz;
+          if ( row >= height ) { break; } // Encoders usually end the last line too, before "End of bitmap".
+          dst_pixels_idx = _bmp_dst_row( row, height, top_down ) * dst_stride_sz;
           continue;
         } else if ( 0x00 == byte_a && 0x01 == byte_b ) { // "End of bitmap".
           break;                                         // break `Iterate over the "Colour-index array".`
@@ -437,53 +685,31 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
       }   // endwhile Iterate over the "Colour-index array".
 
     } else {
-      // 4-bit Uncompressed:
-      size_t src_byte_idx = 0;
+      // 4-bit Uncompressed: each row is unpacked to a byte per index, high 4 bits first, then looked up as for 8 bits.
+      uint32_t palette_rgb[256];
+      uint32_t n_valid_indices = _bmp_palette_rgb( palette_data_ptr, palette_offset, record.sz, palette_rgb );
+      uint8_t* indices_ptr     = malloc( width );
+      if ( !indices_ptr ) { goto apg_bmp_read_error; }
       for ( uint32_t r = 0; r < height; r++ ) {
-        size_t dst_pixels_idx = ( height - 1 - r ) * dst_stride_sz;
-        for ( uint32_t c = 0; c < width; c++ ) {
-          if ( file_hdr_ptr->image_data_offset + src_byte_idx > record.sz ) { goto apg_bmp_read_error; }
-          // Handle 2 pixels at a time.
-          uint8_t pixel_duo = src_img_ptr[src_byte_idx];
-          uint8_t a_index   = ( 0xFF & pixel_duo ) >> 4;
-          uint8_t b_index   = 0xF & pixel_duo;
-
-          if ( palette_offset + a_index * 4 + 2 >= record.sz ) { // Invalid src image.
-            free( record.data );
-            return dst_img_ptr;
-          }
-          if ( dst_pixels_idx + 3 > width * height * n_dst_chans ) { // Done.
-            free( record.data );
-            return dst_img_ptr;
-          }
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[a_index * 4 + 2];
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[a_index * 4 + 1];
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[a_index * 4 + 0];
-          if ( ++c >= width ) { // Advance a column.
-            c = 0;
-            r++;
-            if ( r >= height ) { // Done. no need to get second pixel. eg a 1x1 pixel image.
-              free( record.data );
-              return dst_img_ptr;
-            }
-            dst_pixels_idx = ( height - 1 - r ) * dst_stride_sz;
-          }
-
-          if ( palette_offset + b_index * 4 + 2 >= record.sz ) { // Invalid src image.
-            free( record.data );
-            return dst_img_ptr;
-          }
-          if ( dst_pixels_idx + 3 > width * height * n_dst_chans ) { // Done. Probably redundant check since checking r >= height.
-            free( record.data );
-            return dst_img_ptr;
-          }
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[b_index * 4 + 2];
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[b_index * 4 + 1];
-          dst_img_ptr[dst_pixels_idx++] = palette_data_ptr[b_index * 4 + 0];
-          src_byte_idx++;
-        } // endfor col.
-        src_byte_idx += row_padding_sz;
-      }   // endfor row.
+        const uint8_t* src_row_ptr = &src_img_ptr[(size_t)r * ( unpadded_row_sz + row_padding_sz )];
+        if ( (size_t)r * ( unpadded_row_sz + row_padding_sz ) + unpadded_row_sz > src_img_sz ) {
+          free( indices_ptr );
+          goto apg_bmp_read_error;
+        }
+        uint32_t n_valid_pixels = 0;
+        for ( ; n_valid_pixels < width; n_valid_pixels++ ) {
+          uint8_t index = ( src_row_ptr[n_valid_pixels / 2] >> ( 0 == n_valid_pixels % 2 ? 4 : 0 ) ) & 0xF;
+          if ( index >= n_valid_indices ) { break; } // Invalid src image.
+          indices_ptr[n_valid_pixels] = index;
+        }
+        conv.palette8( indices_ptr, &dst_img_ptr[_bmp_dst_row( r, height, top_down ) * dst_stride_sz], n_valid_pixels, palette_rgb );
+        if ( n_valid_pixels < width ) {
+          free( indices_ptr );
+          free( record.data );
+          return dst_img_ptr;
+        }
+      } // endfor row.
+      free( indices_ptr );
     }     // endif RLE4 or uncompressed 4-bit.
 
     // == 1-bpp -> 24-bit RGB ==
@@ -502,7 +728,7 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
     size_t src_byte_idx = 0;
     for ( uint32_t r = 0; r < height; r++ ) {
       uint8_t bit_idx       = 0; // Used in monochrome,
-      size_t dst_pixels_idx = ( height - 1 - r ) * dst_stride_sz;
+      size_t dst_pixels_idx = _bmp_dst_row( r, height, top_down ) * dst_stride_sz;
       for ( uint32_t c = 0; c < width; c++ ) {
         if ( 8 == bit_idx ) { // Start reading from the next byte,
           src_byte_idx++;
@@ -533,27 +759,11 @@ unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int*
   } else {
     // NOTE(Anton) this only supports 1 byte per channel.
     if ( file_hdr_ptr->image_data_offset + height * width * n_dst_chans > record.sz ) { goto apg_bmp_read_error; }
-    size_t src_byte_idx = 0;
     for ( uint32_t r = 0; r < height; r++ ) {
-      size_t dst_pixels_idx = ( height - 1 - r ) * dst_stride_sz;
-      for ( uint32_t c = 0; c < width; c++ ) {
-        // Re-orders from BGR to RGB.
-        if ( n_dst_chans > 3 ) {
-          if ( dst_pixels_idx > dst_img_sz || src_byte_idx + 3 > src_img_sz ) { goto apg_bmp_read_error; }
-          dst_img_ptr[dst_pixels_idx++] = src_img_ptr[src_byte_idx + 3];
-        }
-        if ( n_dst_chans > 2 ) {
-          if ( dst_pixels_idx > dst_img_sz || src_byte_idx + 2 > src_img_sz ) { goto apg_bmp_read_error; }
-          dst_img_ptr[dst_pixels_idx++] = src_img_ptr[src_byte_idx + 2];
-        }
-        if ( n_dst_chans > 1 ) {
-          if ( dst_pixels_idx > dst_img_sz || src_byte_idx + 1 > src_img_sz ) { goto apg_bmp_read_error; }
-          dst_img_ptr[dst_pixels_idx++] = src_img_ptr[src_byte_idx + 1];
-        }
-        dst_img_ptr[dst_pixels_idx++] = src_img_ptr[src_byte_idx];
-        src_byte_idx += n_src_chans;
-      }
-      src_byte_idx += row_padding_sz;
+      // Re-orders from BGR to RGB.
+      size_t src_byte_idx = (size_t)r * ( unpadded_row_sz + row_padding_sz );
+      if ( src_byte_idx + unpadded_row_sz > src_img_sz ) { goto apg_bmp_read_error; }
+      conv.bgr( &src_img_ptr[src_byte_idx], &dst_img_ptr[_bmp_dst_row( r, height, top_down ) * dst_stride_sz], width );
     }
   } // endif bpp
 
@@ -571,6 +781,236 @@ void apg_bmp_free( unsigned char* pixels_ptr ) {
   free( pixels_ptr );
 }
 
+/* ---------------------------------------------------------------- Streaming reader ----------------------------------------------------------------
+Rows are decoded in the order they're stored, through a fixed-size input buffer, so memory use doesn't depend on the image's height. RLE images
+are decoded a row of palette indices at a time, and every format goes through the same row converters as apg_bmp_read(). */
+
+#define _BMP_STREAM_BUF_SZ ( 256U * 1024U )
+
+struct apg_bmp_stream_t {
+  FILE* fp;
+  uint32_t width, height, n_dst_chans, bpp, compression;
+  bool top_down;
+  uint32_t row_sz;          // Bytes per stored row, with padding, for uncompressed images.
+  uint32_t n_rows_done;     // Stored rows decoded so far.
+  bool failed;              // Truncated or malformed data was found.
+  uint32_t rle_col;         // Column the next RLE row starts at, after a delta escape.
+  uint32_t rle_blank_rows;  // Whole rows skipped by a delta escape, still to emit.
+  bool rle_ended;           // Seen the end-of-bitmap escape. Any remaining rows are blank.
+  _bmp_bitfields_t bitfields;
+  _bmp_converters_t conv;
+  uint32_t palette_rgb[256]; // Entries past the end of the file's palette are black.
+  uint8_t* row_ptr;          // One stored row, for uncompressed images.
+  uint8_t* indices_ptr;      // One row of palette indices.
+  uint8_t* buf_ptr;          // Input buffer.
+  size_t buf_pos, buf_len;
+};
+
+/** Reads n bytes through the stream's buffer. @returns false if the file ends first. */
+static bool _bmp_stream_bytes( apg_bmp_stream_t* stream_ptr, uint8_t* dst_ptr, size_t n ) {
+  if ( n <= stream_ptr->buf_len - stream_ptr->buf_pos ) { // Usually all in the buffer already.
+    memcpy( dst_ptr, &stream_ptr->buf_ptr[stream_ptr->buf_pos], n );
+    stream_ptr->buf_pos += n;
+    return true;
+  }
+  while ( n > 0 ) {
+    if ( stream_ptr->buf_pos == stream_ptr->buf_len ) {
+      stream_ptr->buf_pos = 0;
+      stream_ptr->buf_len = fread( stream_ptr->buf_ptr, 1, _BMP_STREAM_BUF_SZ, stream_ptr->fp );
+      if ( 0 == stream_ptr->buf_len ) { return false; }
+    }
+    size_t avail = stream_ptr->buf_len - stream_ptr->buf_pos;
+    size_t sz    = n < avail ? n : avail;
+    memcpy( dst_ptr, &stream_ptr->buf_ptr[stream_ptr->buf_pos], sz );
+    stream_ptr->buf_pos += sz;
+    dst_ptr += sz;
+    n -= sz;
+  }
+  return true;
+}
+
+/** Decodes the next stored row of an RLE8 or RLE4 image into indices_ptr. Pixels the row doesn't set are palette entry 0.
+ * @returns false on truncated or malformed data. */
+static bool _bmp_stream_rle_row( apg_bmp_stream_t* stream_ptr ) {
+  uint8_t* indices_ptr = stream_ptr->indices_ptr;
+  uint32_t width = stream_ptr->width, col = stream_ptr->rle_col;
+  bool rle4            = BI_RLE4 == stream_ptr->compression;
+  memset( indices_ptr, 0, width );
+  stream_ptr->rle_col = 0;
+  if ( stream_ptr->rle_blank_rows > 0 ) {
+    stream_ptr->rle_blank_rows--;
+    stream_ptr->rle_col = col; // The delta's column carries on to the row after the skipped ones.
+    return true;
+  }
+  if ( stream_ptr->rle_ended ) { return true; }
+  for ( ;; ) {
+    uint8_t pair[2];
+    if ( !_bmp_stream_bytes( stream_ptr, pair, 2 ) ) { return false; }
+    if ( 0x00 == pair[0] && 0x00 == pair[1] ) { return true; } // "End line".
+    if ( 0x00 == pair[0] && 0x01 == pair[1] ) {                 // "End of bitmap".
+      stream_ptr->rle_ended = true;
+      return true;
+    }
+    if ( 0x00 == pair[0] && 0x02 == pair[1] ) { // "Delta position": right and up (the next stored rows) by the following 2 bytes.
+      uint8_t delta[2];
+      if ( !_bmp_stream_bytes( stream_ptr, delta, 2 ) ) { return false; }
+      col += delta[0];
+      if ( col > width ) { return false; }
+      if ( delta[1] > 0 ) {
+        stream_ptr->rle_col        = col;
+        stream_ptr->rle_blank_rows = delta[1] - 1U;
+        return true;
+      }
+      continue;
+    }
+    if ( 0x00 == pair[0] ) { // Absolute mode run: pair[1] indices follow, padded to a 16-bit word.
+      uint32_t n_pixels = pair[1], n_bytes = rle4 ? ( n_pixels + 1 ) / 2 : n_pixels;
+      uint8_t run[256];
+      if ( col + n_pixels > width ) { return false; }
+      if ( !_bmp_stream_bytes( stream_ptr, rle4 ? run : &indices_ptr[col], n_bytes ) ) { return false; }
+      if ( 0 != n_bytes % 2 && !_bmp_stream_bytes( stream_ptr, run + 128, 1 ) ) { return false; }
+      if ( rle4 ) {
+        for ( uint32_t i = 0; i < n_pixels; i++ ) { indices_ptr[col + i] = ( run[i / 2] >> ( 0 == i % 2 ? 4 : 0 ) ) & 0xF; }
+      }
+      col += n_pixels;
+      continue;
+    }
+    // Encoded mode: pair[0] pixels of index pair[1], or for RLE4 alternating its high and low 4 bits.
+    if ( col + pair[0] > width ) { return false; }
+    if ( !rle4 ) {
+      memset( &indices_ptr[col], pair[1], pair[0] );
+      col += pair[0];
+      continue;
+    }
+    for ( uint32_t i = 0; i < pair[0]; i++ ) { indices_ptr[col++] = ( pair[1] >> ( 0 == i % 2 ? 4 : 0 ) ) & 0xF; }
+  }
+}
+
+/** Decodes the next stored row into dst_ptr. @returns false on truncated or malformed data. */
+static bool _bmp_stream_row( apg_bmp_stream_t* stream_ptr, uint8_t* dst_ptr ) {
+  uint32_t width = stream_ptr->width;
+  if ( BI_RLE8 == stream_ptr->compression || BI_RLE4 == stream_ptr->compression ) {
+    if ( !_bmp_stream_rle_row( stream_ptr ) ) { return false; }
+    stream_ptr->conv.palette8( stream_ptr->indices_ptr, dst_ptr, width, stream_ptr->palette_rgb );
+    return true;
+  }
+  uint8_t* row_ptr = stream_ptr->row_ptr;
+  if ( !_bmp_stream_bytes( stream_ptr, row_ptr, stream_ptr->row_sz ) ) { return false; }
+  switch ( stream_ptr->bpp ) {
+  case 32: {
+    const _bmp_bitfields_t* bf_ptr = &stream_ptr->bitfields;
+    ( bf_ptr->bytewise ? stream_ptr->conv.swizzle : stream_ptr->conv.bitfields )( row_ptr, dst_ptr, width, bf_ptr );
+  } break;
+  case 24: stream_ptr->conv.bgr( row_ptr, dst_ptr, width ); break;
+  case 8: stream_ptr->conv.palette8( row_ptr, dst_ptr, width, stream_ptr->palette_rgb ); break;
+  case 4: // Unpack indices to a byte each, high 4 bits first, then look them up as for 8 bits.
+    for ( uint32_t c = 0; c < width; c++ ) { stream_ptr->indices_ptr[c] = ( row_ptr[c / 2] >> ( 0 == c % 2 ? 4 : 0 ) ) & 0xF; }
+    stream_ptr->conv.palette8( stream_ptr->indices_ptr, dst_ptr, width, stream_ptr->palette_rgb );
+    break;
+  case 1: // Most significant bit first.
+    for ( uint32_t c = 0; c < width; c++ ) { stream_ptr->indices_ptr[c] = ( row_ptr[c / 8] >> ( 7 - c % 8 ) ) & 1; }
+    stream_ptr->conv.palette8( stream_ptr->indices_ptr, dst_ptr, width, stream_ptr->palette_rgb );
+    break;
+  default: return false;
+  }
+  return true;
+}
+
+apg_bmp_stream_t* apg_bmp_stream_open( const char* filename, int* w, int* h, unsigned int* n_chans ) {
+  if ( !filename || !w || !h || !n_chans ) { return NULL; }
+  FILE* fp = fopen( filename, "rb" );
+  if ( !fp ) { return NULL; }
+  apg_bmp_stream_t* stream_ptr = NULL;
+  fseek( fp, 0L, SEEK_END );
+  long file_sz = ftell( fp );
+  rewind( fp );
+
+  // Same header checks as apg_bmp_read(), on the headers and masks read into a zeroed struct, so a header that ends at 40 bytes has no masks.
+  uint8_t hdrs[_BMP_FILE_HDR_SZ + sizeof( _bmp_dib_BITMAPINFOHEADER_t )] = { 0 };
+  if ( file_sz < (long)_BMP_MIN_HDR_SZ || 1 != fread( hdrs, _BMP_MIN_HDR_SZ, 1, fp ) ) { goto apg_bmp_stream_open_error; }
+  _bmp_file_header_t file_hdr;
+  _bmp_dib_BITMAPINFOHEADER_t dib_hdr = ( _bmp_dib_BITMAPINFOHEADER_t ){ .this_header_sz = 0 };
+  memcpy( &file_hdr, hdrs, _BMP_FILE_HDR_SZ );
+  memcpy( &dib_hdr, &hdrs[_BMP_FILE_HDR_SZ], _BMP_MIN_DIB_HDR_SZ );
+  if ( !_validate_file_hdr( &file_hdr, (size_t)file_sz ) || !_validate_dib_hdr( &dib_hdr, (size_t)file_sz ) ) { goto apg_bmp_stream_open_error; }
+  bool has_bitmasks       = BI_BITFIELDS == dib_hdr.compression_method || BI_ALPHABITFIELDS == dib_hdr.compression_method;
+  bool rle                = BI_RLE8 == dib_hdr.compression_method || BI_RLE4 == dib_hdr.compression_method;
+  uint32_t palette_offset = (uint32_t)_BMP_FILE_HDR_SZ + dib_hdr.this_header_sz + ( has_bitmasks ? 12 : 0 );
+  if ( has_bitmasks ) {
+    if ( 1 != fread( &hdrs[_BMP_MIN_HDR_SZ], 12, 1, fp ) ) { goto apg_bmp_stream_open_error; }
+    memcpy( &dib_hdr, &hdrs[_BMP_FILE_HDR_SZ], sizeof( _bmp_dib_BITMAPINFOHEADER_t ) );
+  }
+  uint32_t bpp = dib_hdr.bpp;
+  if ( 32 != bpp && 24 != bpp && 8 != bpp && 4 != bpp && 1 != bpp ) { goto apg_bmp_stream_open_error; }
+  if ( ( BI_RLE8 == dib_hdr.compression_method && 8 != bpp ) || ( BI_RLE4 == dib_hdr.compression_method && 4 != bpp ) ) { goto apg_bmp_stream_open_error; }
+  if ( rle && dib_hdr.h < 0 ) { goto apg_bmp_stream_open_error; } // RLE images can only be bottom-up.
+  uint32_t width = (uint32_t)labs( dib_hdr.w ), height = (uint32_t)labs( dib_hdr.h );
+  uint32_t row_sz = ( (uint32_t)( ( (uint64_t)width * bpp + 7 ) / 8 ) + 3 ) & ~3U;
+  if ( !rle && (uint64_t)file_hdr.image_data_offset + (uint64_t)row_sz * height > (uint64_t)file_sz ) { goto apg_bmp_stream_open_error; }
+
+  // One allocation for the state, one stored row, one row of indices, and the input buffer.
+  size_t state_sz = ( sizeof( apg_bmp_stream_t ) + 15 ) & ~(size_t)15, row_buf_sz = ( (size_t)row_sz + 15 ) & ~(size_t)15;
+  stream_ptr      = calloc( 1, state_sz + row_buf_sz + ( ( (size_t)width + 15 ) & ~(size_t)15 ) + _BMP_STREAM_BUF_SZ );
+  if ( !stream_ptr ) { goto apg_bmp_stream_open_error; }
+  stream_ptr->fp          = fp;
+  stream_ptr->width       = width;
+  stream_ptr->height      = height;
+  stream_ptr->n_dst_chans = 32 == bpp ? 4 : 3;
+  stream_ptr->bpp         = bpp;
+  stream_ptr->compression = dib_hdr.compression_method;
+  stream_ptr->top_down    = dib_hdr.h < 0;
+  stream_ptr->row_sz      = row_sz;
+  stream_ptr->conv        = _bmp_converters();
+  stream_ptr->row_ptr     = (uint8_t*)stream_ptr + state_sz;
+  stream_ptr->indices_ptr = stream_ptr->row_ptr + row_buf_sz;
+  stream_ptr->buf_ptr     = stream_ptr->indices_ptr + ( ( (size_t)width + 15 ) & ~(size_t)15 );
+  if ( has_bitmasks ) { stream_ptr->bitfields = _bmp_bitfields( dib_hdr.bitmask_r, dib_hdr.bitmask_g, dib_hdr.bitmask_b ); }
+
+  // The palette is whatever entries fit between the headers and the image data, up to 256.
+  if ( bpp <= 8 && file_hdr.image_data_offset > palette_offset ) {
+    uint32_t palette_sz = file_hdr.image_data_offset - palette_offset;
+    uint8_t bgrx[1024];
+    palette_sz = palette_sz < sizeof( bgrx ) ? palette_sz : (uint32_t)sizeof( bgrx );
+    if ( 0 != fseek( fp, (long)palette_offset, SEEK_SET ) || 1 != fread( bgrx, palette_sz, 1, fp ) ) { goto apg_bmp_stream_open_error; }
+    _bmp_palette_rgb( bgrx, 0, palette_sz, stream_ptr->palette_rgb );
+  }
+  if ( 0 != fseek( fp, (long)file_hdr.image_data_offset, SEEK_SET ) ) { goto apg_bmp_stream_open_error; }
+
+  *w       = (int)width;
+  *h       = (int)height;
+  *n_chans = stream_ptr->n_dst_chans;
+  return stream_ptr;
+
+apg_bmp_stream_open_error:
+  free( stream_ptr );
+  fclose( fp );
+  return NULL;
+}
+
+int apg_bmp_stream_read_rows( apg_bmp_stream_t* stream_ptr, unsigned char* dst_ptr, int n_rows, int* y_ptr ) {
+  if ( !stream_ptr || !dst_ptr || n_rows < 0 || !y_ptr ) { return -1; }
+  if ( stream_ptr->failed ) { return -1; }
+  uint32_t n_left = stream_ptr->height - stream_ptr->n_rows_done;
+  uint32_t n      = (uint32_t)n_rows < n_left ? (uint32_t)n_rows : n_left;
+  size_t stride   = (size_t)stream_ptr->width * stream_ptr->n_dst_chans;
+  // Bottom-up rows are written from the end of dst_ptr backwards, so dst_ptr always holds rows top-down.
+  for ( uint32_t i = 0; i < n; i++ ) {
+    if ( !_bmp_stream_row( stream_ptr, &dst_ptr[( stream_ptr->top_down ? i : n - 1 - i ) * stride] ) ) {
+      stream_ptr->failed = true;
+      return -1;
+    }
+  }
+  *y_ptr = (int)( stream_ptr->top_down ? stream_ptr->n_rows_done : stream_ptr->height - stream_ptr->n_rows_done - n );
+  stream_ptr->n_rows_done += n;
+  return (int)n;
+}
+
+void apg_bmp_stream_close( apg_bmp_stream_t* stream_ptr ) {
+  if ( !stream_ptr ) { return; }
+  fclose( stream_ptr->fp );
+  free( stream_ptr );
+}
+
 unsigned int apg_bmp_write( const char* filename, unsigned char* pixels_ptr, int w, int h, unsigned int n_chans ) {
   if ( !filename || !pixels_ptr ) { return 0; }
   if ( 0 == w || 0 == h ) { return 0; }
@@ -624,7 +1064,7 @@ unsigned int apg_bmp_write( const char* filename, unsigned char* pixels_ptr, int
     uint8_t bgra[4]     = { 0, 0, 0, 0 };
 
     for ( uint32_t row = 0; row < height; row++ ) {
-      size_t src_byte_idx = ( height - 1 - row ) * n_chans * width;
+      size_t src_byte_idx = _bmp_dst_row( row, height, h < 0 ) * n_chans * width;
       for ( uint32_t col = 0; col < width; col++ ) {
         for ( uint32_t chan = 0; chan < n_chans; chan++ ) { rgba[chan] = pixels_ptr[src_byte_idx++]; }
         if ( 3 == n_chans ) {
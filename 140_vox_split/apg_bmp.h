@@ -36,13 +36,19 @@ Features
   - Reader handles indexed BMP images using a colour palette.
   - Reader supports 8-bit and 4-bit RLE compression.
   - Writer supports 32bpp RGBA and 24bpp uncompressed RGB images.
+  - Streaming reader decodes a few rows at a time into a caller's buffer, with
+    memory use independent of image height, for images too big to hold twice.
+  - Reader converts 32bpp, 24bpp, and uncompressed 8bpp rows with SSE2, SSSE3,
+    or AVX2 on x86, picked at run time for the CPU. Define APG_BMP_NO_SIMD
+    when building apg_bmp.c to use plain C only.
 
 Current Limitations
 -------------------------------------------------------------------------------
   - Because I don't have any samples to test on, the following are not supported:
     - 16-bit images.
     - Interleaved channel bit layouts; e.g. RGB101010 RGB555 RGB565.
-    - Delta position escape codes in RLE.
+    - Delta position escape codes in RLE, in apg_bmp_read(). The streaming
+      reader supports them, and leaves skipped pixels as palette entry 0.
   - Alpha channels are written in BITMAPINFOHEADER, which covers most cases,
     and supports older software. For wider alpha support in other apps the v5
     header could be used.
@@ -80,6 +86,9 @@ Not desired:   Build systems, language & code style changes, large PRs.
 
 Version History
 -------------------------------------------------------------------------------
+  3.6.0   - 2026 Oct. 19. Streaming reader. apg_bmp_read() and apg_bmp_write()
+                          honour top-down (negative height) images.
+  3.5.0   - 2026 Oct. 19. Vectorised row conversion, and apg_bmp_simd_max().
   3.4.0   - 2023 May. 31. 8-bit and 4-bit RLE compression support added.
   3.3.1   - 2023 Feb.  1. Fixed type casting warnings from MSVC.
   3.3     - 2023 Jan. 11. Fixed bug: images with alpha channel were y-flipped.
@@ -109,6 +118,40 @@ extern "C" {
  */
 APG_BMP_EXPORT unsigned char* apg_bmp_read( const char* filename, int* w, int* h, unsigned int* n_chans );
 
+/** A BMP file open for reading a few rows at a time. */
+typedef struct apg_bmp_stream_t apg_bmp_stream_t;
+
+/** Opens a bitmap for reading with apg_bmp_stream_read_rows(), reading only its headers and palette. Supports the same formats as apg_bmp_read().
+ * @param w,h     Retrieves the width and height of the BMP in pixels.
+ * @param n_chans Retrieves the number of channels the rows will have.
+ * @returns       NULL on any error. Otherwise must be closed with apg_bmp_stream_close().
+ */
+APG_BMP_EXPORT apg_bmp_stream_t* apg_bmp_stream_open( const char* filename, int* w, int* h, unsigned int* n_chans );
+
+/** Decodes the next rows of a bitmap, in the order they're stored in the file: bottom band first for most images, and top band first for
+ * images with a negative height in the header. A stream can be read on any one thread at a time, e.g. a loader thread handing bands to the
+ * render thread for upload while the next band decodes.
+ * @param dst_ptr Receives the rows, tightly-packed and top-down, in RGBA order. Must have room for n_rows*w*n_chans bytes.
+ * @param n_rows  Most rows to decode.
+ * @param y_ptr   Retrieves the row of the image, counting from the top, that the first row in dst_ptr belongs at.
+ * @returns       The number of rows decoded, which is less than n_rows only at the end of the image, and 0 after the end.
+ *                -1 on truncated or malformed data, after which dst_ptr's contents are undefined and the stream can only be closed.
+ */
+APG_BMP_EXPORT int apg_bmp_stream_read_rows( apg_bmp_stream_t* stream_ptr, unsigned char* dst_ptr, int n_rows, int* y_ptr );
+
+/** Closes the file and frees a stream from apg_bmp_stream_open(). */
+APG_BMP_EXPORT void apg_bmp_stream_close( apg_bmp_stream_t* stream_ptr );
+
+/** Instruction sets apg_bmp_read() can convert pixels with, in increasing order. */
+typedef enum apg_bmp_simd_t { APG_BMP_SIMD_NONE = 0, APG_BMP_SIMD_SSE2, APG_BMP_SIMD_SSSE3, APG_BMP_SIMD_AVX2 } apg_bmp_simd_t;
+
+/** Limits the instruction sets apg_bmp_read() uses. By default it uses the best the CPU supports.
+ * Intended for comparing the plain C and vector paths. Not thread-safe: call before reading on other threads.
+ * @param max_simd One of apg_bmp_simd_t. Any other value leaves the limit as it was.
+ * @returns        The instruction set apg_bmp_read() will now use on this CPU.
+ */
+APG_BMP_EXPORT int apg_bmp_simd_max( int max_simd );
+
 /** Calls free() on memory created by apg_bmp_read. */
 APG_BMP_EXPORT void apg_bmp_free( unsigned char* pixels_ptr );
 
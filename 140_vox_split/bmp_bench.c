@@ -0,0 +1,221 @@
+/* Benchmark for apg_bmp_read() with each instruction set its row converters can use, and for the streaming reader.
+Author:   Anton Gerdelan  antongerdelan.net
+Licence:  See apg_bmp.h
+
+Build:
+  gcc -O2 bmp_bench.c apg_bmp.c -o bmp_bench
+Run:
+  ./bmp_bench [max_side]
+
+Writes square images of 4096, 8192, and 16384 pixels a side, up to max_side (default 8192), in each of these formats:
+  24-bit             BGR, as apg_bmp_write() writes 3 channels.
+  32-bit             BI_BITFIELDS with whole-byte masks, as apg_bmp_write() writes 4 channels.
+  32-bit 10:10:10:2  BI_BITFIELDS with masks that aren't whole bytes, so each channel is the low 8 bits of its field.
+  8-bit palette      256 BGR0 palette entries.
+  8-bit RLE          BI_RLE8 runs of 1 to 16 pixels. apg_bmp_read() decodes RLE in plain C only.
+Each is read back with plain C, then with SSE2, SSSE3, and AVX2 as far as the CPU supports, taking the best of several reads. Times
+include reading the file from the OS cache. The output of every instruction set must match plain C's.
+Each is then read with apg_bmp_stream_read_rows(), STREAM_ROWS rows at a time, which must also match. `memory` is the stream's buffers
+plus one band of rows, which is all the streaming reader needs, against the whole image and file for apg_bmp_read().
+*/
+
+#include "apg_bmp.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FN "bmp_bench.bmp"
+#define N_REPEATS 3
+#define STREAM_ROWS 64
+#define STREAM_BUFFERS_SZ ( 256 * 1024 ) // apg_bmp_stream_t's input buffer, which is most of its memory.
+
+typedef enum format_t { FORMAT_24 = 0, FORMAT_32, FORMAT_32_1010102, FORMAT_8_PALETTE, FORMAT_8_RLE, FORMAT_MAX } format_t;
+static const char* _format_names[FORMAT_MAX] = { "24-bit", "32-bit", "32-bit 10:10:10:2", "8-bit palette", "8-bit RLE" };
+static const char* _simd_names[]             = { "C", "SSE2", "SSSE3", "AVX2" };
+
+static double _time_s( void ) {
+  struct timespec ts;
+  timespec_get( &ts, TIME_UTC );
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t _xorshift( uint32_t* state_ptr ) {
+  uint32_t x = *state_ptr;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state_ptr = x;
+}
+
+static void _put_u16( FILE* fp, uint32_t v ) {
+  uint8_t b[2] = { (uint8_t)v, (uint8_t)( v >> 8 ) };
+  fwrite( b, 2, 1, fp );
+}
+
+static void _put_u32( FILE* fp, uint32_t v ) {
+  uint8_t b[4] = { (uint8_t)v, (uint8_t)( v >> 8 ), (uint8_t)( v >> 16 ), (uint8_t)( v >> 24 ) };
+  fwrite( b, 4, 1, fp );
+}
+
+/* Writes the file and DIB headers, the BI_BITFIELDS masks or palette, and rows of noise with smooth gradients through it. */
+static bool _write_bmp( const char* filename, int side, format_t format ) {
+  bool palette    = FORMAT_8_PALETTE == format || FORMAT_8_RLE == format;
+  uint32_t bpp    = FORMAT_24 == format ? 24 : ( palette ? 8 : 32 );
+  uint32_t row_sz = ( side * bpp / 8 + 3 ) & ~3u, extra_sz = palette ? 1024 : ( 32 == bpp ? 12 : 0 );
+  uint32_t offset = 14 + 40 + extra_sz;
+  FILE* fp        = fopen( filename, "wb" );
+  if ( !fp ) { return false; }
+  fwrite( "BM", 2, 1, fp );
+  _put_u32( fp, offset + row_sz * side );
+  _put_u32( fp, 0 );
+  _put_u32( fp, offset );
+  _put_u32( fp, 40 );
+  _put_u32( fp, side );
+  _put_u32( fp, side );
+  _put_u16( fp, 1 );
+  _put_u16( fp, bpp );
+  _put_u32( fp, 32 == bpp ? 3 : ( FORMAT_8_RLE == format ? 1 : 0 ) ); // BI_BITFIELDS, BI_RLE8, or BI_RGB.
+  for ( int i = 0; i < 5; i++ ) { _put_u32( fp, palette && 3 == i ? 256 : 0 ); }
+  if ( FORMAT_32 == format ) {
+    _put_u32( fp, 0xFF000000 );
+    _put_u32( fp, 0x00FF0000 );
+    _put_u32( fp, 0x0000FF00 );
+  } else if ( FORMAT_32_1010102 == format ) {
+    _put_u32( fp, 0x3FF00000 );
+    _put_u32( fp, 0x000FFC00 );
+    _put_u32( fp, 0x000003FF );
+  } else if ( palette ) {
+    for ( uint32_t i = 0; i < 256; i++ ) { _put_u32( fp, ( i * 0x010305u ) & 0xFFFFFF ); }
+  }
+  uint8_t* row_ptr = calloc( FORMAT_8_RLE == format ? 2 * (uint32_t)side + 4 : row_sz, 1 );
+  if ( !row_ptr ) {
+    fclose( fp );
+    return false;
+  }
+  uint32_t state = 0x12345678;
+  if ( FORMAT_8_RLE == format ) { // Encoded runs, an "End line" for each row, and "End of bitmap". The sizes in the header are then fixed.
+    uint32_t data_sz = 0;
+    for ( int y = 0; y < side; y++ ) {
+      uint32_t n = 0;
+      for ( int x = 0; x < side; ) {
+        int run    = 1 + ( _xorshift( &state ) & 15 );
+        run        = run < side - x ? run : side - x;
+        row_ptr[n++] = (uint8_t)run;
+        row_ptr[n++] = (uint8_t)( ( x + y ) / 7 + ( _xorshift( &state ) & 15 ) );
+        x += run;
+      }
+      row_ptr[n++] = 0;
+      row_ptr[n++] = 0;
+      fwrite( row_ptr, n, 1, fp );
+      data_sz += n;
+    }
+    fwrite( "\0\1", 2, 1, fp );
+    fseek( fp, 2, SEEK_SET );
+    _put_u32( fp, offset + data_sz + 2 );
+    fseek( fp, 34, SEEK_SET );
+    _put_u32( fp, data_sz + 2 );
+    free( row_ptr );
+    return 0 == fclose( fp );
+  }
+  for ( int y = 0; y < side; y++ ) {
+    for ( uint32_t i = 0; i < (uint32_t)side * bpp / 8; i++ ) { row_ptr[i] = (uint8_t)( ( i + y ) / 7 + ( _xorshift( &state ) & 15 ) ); }
+    fwrite( row_ptr, row_sz, 1, fp );
+  }
+  free( row_ptr );
+  return 0 == fclose( fp );
+}
+
+static size_t _file_sz( const char* filename ) {
+  FILE* fp = fopen( filename, "rb" );
+  if ( !fp ) { return 0; }
+  fseek( fp, 0L, SEEK_END );
+  size_t sz = (size_t)ftell( fp );
+  fclose( fp );
+  return sz;
+}
+
+/* Reads the file STREAM_ROWS at a time, checking each band against ref_ptr. RETURNS the best time of several reads. */
+static double _stream( const unsigned char* ref_ptr, bool* ok_ptr, size_t* mem_sz_ptr ) {
+  double best_s = 1e9;
+  for ( int rep = 0; rep < N_REPEATS && *ok_ptr; rep++ ) {
+    int w = 0, h = 0, y = 0, n_rows = 0, n_read = 0;
+    unsigned int n_chans       = 0;
+    double t                   = _time_s();
+    apg_bmp_stream_t* stream_ptr = apg_bmp_stream_open( BENCH_FN, &w, &h, &n_chans );
+    if ( !stream_ptr ) {
+      *ok_ptr = false;
+      break;
+    }
+    size_t stride    = (size_t)w * n_chans;
+    uint8_t* rows_ptr = malloc( stride * STREAM_ROWS );
+    while ( rows_ptr && ( n_rows = apg_bmp_stream_read_rows( stream_ptr, rows_ptr, STREAM_ROWS, &y ) ) > 0 ) {
+      *ok_ptr = *ok_ptr && 0 == memcmp( rows_ptr, &ref_ptr[(size_t)y * stride], (size_t)n_rows * stride );
+      n_read += n_rows;
+    }
+    apg_bmp_stream_close( stream_ptr );
+    free( rows_ptr );
+    double s    = _time_s() - t;
+    best_s      = s < best_s ? s : best_s;
+    *ok_ptr     = *ok_ptr && n_read == h;
+    *mem_sz_ptr = STREAM_BUFFERS_SZ + stride * ( STREAM_ROWS + 1 );
+  }
+  return best_s;
+}
+
+int main( int argc, char** argv ) {
+  int max_side = argc > 1 ? atoi( argv[1] ) : 8192;
+  int best     = apg_bmp_simd_max( APG_BMP_SIMD_AVX2 );
+  bool ok      = true;
+  printf( "%-18s %-7s %-6s %9s %9s\n", "format", "side", "with", "MP/s", "speedup" );
+  for ( int side = 4096; side <= max_side && ok; side *= 2 ) {
+    for ( int format = 0; format < FORMAT_MAX && ok; format++ ) {
+      if ( !_write_bmp( BENCH_FN, side, format ) ) {
+        fprintf( stderr, "ERROR: could not write %s\n", BENCH_FN );
+        return 1;
+      }
+      unsigned char* ref_ptr = NULL;
+      size_t img_sz          = 0;
+      double c_s             = 0.0;
+      int last_simd          = FORMAT_8_RLE == format ? APG_BMP_SIMD_NONE : best;
+      for ( int simd = APG_BMP_SIMD_NONE; simd <= last_simd && ok; simd++ ) {
+        apg_bmp_simd_max( simd );
+        double best_s = 1e9;
+        for ( int rep = 0; rep < N_REPEATS && ok; rep++ ) {
+          int w = 0, h = 0;
+          unsigned int n_chans = 0;
+          double t             = _time_s();
+          unsigned char* img_ptr = apg_bmp_read( BENCH_FN, &w, &h, &n_chans );
+          double s               = _time_s() - t;
+          best_s                 = s < best_s ? s : best_s;
+          if ( !img_ptr ) {
+            fprintf( stderr, "ERROR: could not read %s\n", BENCH_FN );
+            ok = false;
+          } else if ( !ref_ptr ) {
+            ref_ptr = img_ptr;
+            img_sz  = (size_t)w * h * n_chans;
+          } else {
+            ok = 0 == memcmp( ref_ptr, img_ptr, img_sz );
+            apg_bmp_free( img_ptr );
+          }
+        }
+        if ( APG_BMP_SIMD_NONE == simd ) { c_s = best_s; }
+        printf( "%-18s %-7d %-6s %9.1f %8.2fx %s\n", _format_names[format], side, _simd_names[simd], (double)side * side / best_s * 1e-6, c_s / best_s,
+          ok ? "" : "DIFFERENT" );
+      }
+      apg_bmp_simd_max( best );
+      if ( ok ) {
+        size_t stream_mem_sz = 0;
+        double s             = _stream( ref_ptr, &ok, &stream_mem_sz );
+        printf( "%-18s %-7d %-6s %9.1f %8.2fx %s memory %.1f MB, against %.1f MB\n", _format_names[format], side, "stream", (double)side * side / s * 1e-6,
+          c_s / s, ok ? "" : "DIFFERENT", stream_mem_sz / ( 1024.0 * 1024.0 ), ( img_sz + _file_sz( BENCH_FN ) ) / ( 1024.0 * 1024.0 ) );
+      }
+      apg_bmp_free( ref_ptr );
+    }
+  }
+  apg_bmp_simd_max( APG_BMP_SIMD_AVX2 );
+  remove( BENCH_FN );
+  return ok ? 0 : 1;
+}
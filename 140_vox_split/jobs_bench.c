@@ -0,0 +1,121 @@
+/* Scaling benchmark for the apg.h job system.
+Author:   Anton Gerdelan  antongerdelan.net
+Licence:  See apg.h
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L jobs_bench.c -pthread -lm -o jobs_bench
+Run:
+  ./jobs_bench [max_threads]
+
+Runs each workload with 1, 2, 4... up to max_threads (default: one per logical CPU) and prints the time and speedup over 1 thread.
+  parallel_for - a flat loop over a large array in grains of 4096 elements.
+  fork_join    - a recursive tree of small jobs, each spawning two children and waiting on them, to stress nested stealing and wait-by-helping.
+Results are checked against the 1-thread run.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N_ELEMENTS ( 1 << 24 )
+#define GRAIN 4096
+#define TREE_DEPTH 18 /* 2^18 leaf jobs. */
+#define N_REPEATS 5
+
+static float* _src_ptr;
+static float* _dst_ptr;
+
+static void _loop_body( int64_t begin, int64_t end, void* arg_ptr ) {
+  APG_UNUSED( arg_ptr );
+  for ( int64_t i = begin; i < end; i++ ) { _dst_ptr[i] = sqrtf( _src_ptr[i] ) * sinf( _src_ptr[i] ) + cosf( _src_ptr[i] * 0.5f ); }
+}
+
+typedef struct tree_node_t {
+  int depth;
+  uint64_t result;
+} tree_node_t;
+
+static void _tree_job( void* arg_ptr ) {
+  tree_node_t* node_ptr = (tree_node_t*)arg_ptr;
+  if ( 0 == node_ptr->depth ) {
+    uint64_t h = 1469598103934665603ULL; /* A little busy-work per leaf so the job isn't only overhead. */
+    for ( int i = 0; i < 64; i++ ) { h = ( h ^ (uint64_t)i ) * 1099511628211ULL; }
+    node_ptr->result = h & 1;
+    return;
+  }
+  tree_node_t children[2]   = { { .depth = node_ptr->depth - 1 }, { .depth = node_ptr->depth - 1 } };
+  apg_job_counter_t counter = { 0 };
+  apg_jobs_run( _tree_job, &children[0], &counter );
+  apg_jobs_run( _tree_job, &children[1], &counter );
+  apg_jobs_wait( &counter );
+  node_ptr->result = children[0].result + children[1].result;
+}
+
+static double _run_parallel_for( void ) {
+  double best_s = 1e9;
+  for ( int r = 0; r < N_REPEATS; r++ ) {
+    double start_s = apg_time_s();
+    apg_jobs_parallel_for( 0, N_ELEMENTS, GRAIN, _loop_body, NULL );
+    best_s = APG_MIN( best_s, apg_time_s() - start_s );
+  }
+  return best_s;
+}
+
+static double _run_fork_join( uint64_t* result_ptr ) {
+  double best_s = 1e9;
+  for ( int r = 0; r < N_REPEATS; r++ ) {
+    tree_node_t root = { .depth = TREE_DEPTH };
+    double start_s   = apg_time_s();
+    _tree_job( &root );
+    best_s      = APG_MIN( best_s, apg_time_s() - start_s );
+    *result_ptr = root.result;
+  }
+  return best_s;
+}
+
+int main( int argc, char** argv ) {
+  int max_threads = argc > 1 ? atoi( argv[1] ) : 0;
+  if ( max_threads <= 0 ) {
+    if ( !apg_jobs_init( 0 ) ) { return 1; }
+    max_threads = apg_jobs_n_threads();
+    apg_jobs_free();
+  }
+  apg_time_init();
+
+  _src_ptr       = malloc( sizeof( float ) * N_ELEMENTS );
+  _dst_ptr       = malloc( sizeof( float ) * N_ELEMENTS );
+  float* ref_ptr = malloc( sizeof( float ) * N_ELEMENTS );
+  if ( !_src_ptr || !_dst_ptr || !ref_ptr ) { return 1; }
+  for ( int i = 0; i < N_ELEMENTS; i++ ) { _src_ptr[i] = (float)( i % 1000 ) * 0.01f; }
+
+  printf( "%-8s %14s %9s %14s %9s\n", "threads", "parallel_for", "speedup", "fork_join", "speedup" );
+  double base_for_s = 0.0, base_tree_s = 0.0;
+  uint64_t ref_tree_result = 0;
+  bool all_ok              = true;
+  for ( int n_threads = 1; n_threads <= max_threads; n_threads = n_threads * 2 > max_threads && n_threads < max_threads ? max_threads : n_threads * 2 ) {
+    if ( !apg_jobs_init( n_threads ) ) { return 1; }
+    double for_s         = _run_parallel_for();
+    uint64_t tree_result = 0;
+    double tree_s        = _run_fork_join( &tree_result );
+    apg_jobs_free();
+
+    if ( 1 == n_threads ) {
+      base_for_s      = for_s;
+      base_tree_s     = tree_s;
+      ref_tree_result = tree_result;
+      memcpy( ref_ptr, _dst_ptr, sizeof( float ) * N_ELEMENTS );
+    } else if ( tree_result != ref_tree_result || 0 != memcmp( ref_ptr, _dst_ptr, sizeof( float ) * N_ELEMENTS ) ) {
+      fprintf( stderr, "ERROR: results with %i threads differ from 1 thread.\n", n_threads );
+      all_ok = false;
+    }
+    printf( "%-8i %12.2fms %8.2fx %12.2fms %8.2fx\n", n_threads, for_s * 1000.0, base_for_s / for_s, tree_s * 1000.0, base_tree_s / tree_s );
+  }
+
+  free( _src_ptr );
+  free( _dst_ptr );
+  free( ref_ptr );
+  return all_ok ? 0 : 1;
+}
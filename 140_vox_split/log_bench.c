@@ -0,0 +1,76 @@
+/* Benchmark for apg_log() in synchronous and asynchronous modes.
+Author:   Anton Gerdelan  antongerdelan.net
+Licence:  See apg.h
+
+Build:
+  gcc -O2 -D_POSIX_C_SOURCE=200809L log_bench.c -pthread -lm -o log_bench
+Run:
+  ./log_bench [messages_per_thread]
+
+N_THREADS threads each log the same number of messages as fast as they can.
+Reports total messages per second, and the worst-case time any single apg_log() call took on the caller's thread.
+Timing is inclusive of the final flush to disk, so async throughput isn't flattered by messages still sitting in the ring.
+*/
+
+#define APG_IMPLEMENTATION
+#define APG_NO_BACKTRACES
+#include "apg.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N_THREADS 8
+
+typedef struct bench_thread_t {
+  pthread_t thread;
+  int idx;
+  int n_messages;
+  double worst_s;
+} bench_thread_t;
+
+static void* _bench_thread( void* arg_ptr ) {
+  bench_thread_t* bt_ptr = (bench_thread_t*)arg_ptr;
+  for ( int i = 0; i < bt_ptr->n_messages; i++ ) {
+    double t0 = apg_time_s();
+    apg_log( "thread %i message %i value %f\n", bt_ptr->idx, i, (double)i * 0.5 );
+    double elapsed = apg_time_s() - t0;
+    if ( elapsed > bt_ptr->worst_s ) { bt_ptr->worst_s = elapsed; }
+  }
+  return NULL;
+}
+
+static void _run( const char* label, int n_per_thread ) {
+  bench_thread_t threads[N_THREADS];
+  apg_log_start();
+  double t0 = apg_time_s();
+  for ( int i = 0; i < N_THREADS; i++ ) {
+    threads[i] = ( bench_thread_t ){ .idx = i, .n_messages = n_per_thread };
+    pthread_create( &threads[i].thread, NULL, _bench_thread, &threads[i] );
+  }
+  double worst_s = 0.0;
+  for ( int i = 0; i < N_THREADS; i++ ) {
+    pthread_join( threads[i].thread, NULL );
+    if ( threads[i].worst_s > worst_s ) { worst_s = threads[i].worst_s; }
+  }
+  apg_log_flush();
+  double total_s = apg_time_s() - t0;
+  int64_t n      = (int64_t)n_per_thread * N_THREADS;
+  printf( "%-6s %i threads: %9lli msgs in %7.3fs = %12.0f msgs/s. worst caller latency %9.3f us\n", label, N_THREADS, (long long)n, total_s, (double)n / total_s,
+    worst_s * 1e6 );
+}
+
+int main( int argc, char** argv ) {
+  int n_per_thread = argc > 1 ? atoi( argv[1] ) : 20000;
+  apg_time_init();
+
+  _run( "sync", n_per_thread );
+
+  if ( !apg_log_async_start() ) {
+    fprintf( stderr, "ERROR: could not start async logging\n" );
+    return 1;
+  }
+  _run( "async", n_per_thread );
+  apg_log_async_stop();
+
+  return 0;
+}
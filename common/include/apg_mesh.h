@@ -0,0 +1,1327 @@
+/*==============================================================
+Single-Header cooked binary mesh file reader/writer
+Language: C99
+Author:   Anton Gerdelan - @capnramses
+Contact:  <antonofnote@gmail.com>
+Website:  https://github.com/capnramses/apg - antongerdelan.net/
+Licence:  See bottom of this file.
+
+Text meshes (PLY, OBJ) are parsed once, offline or on first load, and "cooked" into a file that is mapped into memory and used in
+place, so loading is bounded by disk bandwidth rather than by parsing.
+
+Instructions:
+1. Include this header in one, and only one, source file.
+2. #define APG_MESH_IMPLEMENTATION above #include "apg_mesh.h"
+3. Write a cook function that reads the source file with your usual loader, fills in an apg_mesh_desc_t, and calls apg_mesh_write():
+
+int my_cook( const char* src_filename, const char* mesh_filename, const apg_mesh_source_t* source_ptr, void* user_ptr ) {
+  apg_ply_t ply = apg_ply_read( src_filename );
+  if ( !ply.loaded ) { return 0; }
+  apg_mesh_desc_t desc = { .n_vertices = ply.n_vertices, .n_streams = 1 };
+  desc.streams[0]      = ( apg_mesh_stream_desc_t ){ APG_MESH_POSITION, APG_MESH_F32, 3, ply.positions_ptr };
+  int ok               = apg_mesh_write( mesh_filename, &desc, source_ptr );
+  apg_ply_delete( &ply );
+  return ok;
+}
+
+apg_mesh_t mesh;
+if ( apg_mesh_open_cached( "my.ply", "my.ply.mesh", my_cook, NULL, &mesh ) ) {
+  int n_comps, type;
+  const float* positions_ptr = apg_mesh_stream( &mesh, APG_MESH_POSITION, &n_comps, &type );
+  // ... upload to the GPU etc. ...
+  apg_mesh_close( &mesh );
+}
+
+File layout, version 2. All values are little-endian, and files are only read on machines of the same endianness as the cook.
+  apg_mesh_header_t                128 bytes.
+  apg_mesh_stream_t[n_streams]     72 bytes each.
+  each stream's vertex data        n_vertices * stride bytes, or fewer if encoded, starting on a 64-byte boundary.
+  index buffer                     n_indices uint16_t or uint32_t, or fewer bytes if encoded, starting on a 64-byte boundary. absent if
+                                   index_sz is 0.
+The header holds the axis-aligned bounds of the positions, an XXH64 hash of every byte after the header, and the size, modification
+time, and XXH64 hash of the source file.
+
+Compression:
+  Streams can be stored quantised, so they're smaller on disk and in GPU memory, and used as they are by the vertex shader:
+    apg_mesh_quantise_unorm()     1 to 4 floats per vertex to 8 or 16-bit unsigned integers spanning their bounds, recorded in the
+                                  stream as range_min and range_extent. For positions at 16 bits the error is under 1/131070 of the bounds.
+                                  Declare the attribute normalised, then `value = range_min + range_extent * attribute`.
+    apg_mesh_encode_octahedral()  unit normals folded onto an octahedron: 2 signed 8 or 16-bit integers, within 0.64 and 0.003 degrees.
+                                  Unfold them in the shader as _apg_mesh_oct_unfold() does.
+  Vertex streams and triangle indices can also be encoded with APG_MESH_CODEC_DELTA, which is lossless:
+  - Each vertex component is replaced by its difference from the previous vertex's, zig-zagged so small negative differences are small
+    too, and the bytes of blocks of 256 vertices are regrouped so each byte of the component sits together. Every run of 16 of those
+    bytes is then stored with 0, 2, 4, or 8 bits each, whichever is the fewest that fit. Neighbouring vertices of a mesh optimised for
+    the vertex cache and vertex fetch are close in space, so the upper bytes are mostly zero and cost nothing. Decoding unpacks,
+    un-zig-zags, and sums 16 bytes at a time with SSE2. #define APG_MESH_NO_SIMD to use the plain C decoder, which gives the same results.
+  - Each triangle is a byte naming an edge it shares with a recent triangle, and the vertex that isn't on it: new, recently used, or
+    else an index difference. An optimised mesh takes 1.2 to 2 bytes per triangle.
+  Both leave byte-aligned, repetitive data, which a general compressor such as zstd shrinks further. Encoded streams aren't usable in
+  place: apg_mesh_stream() returns NULL for them, and apg_mesh_decode_stream() and apg_mesh_decode_indices() decode them into memory.
+
+Stale caches:
+  apg_mesh_open_cached() compares the source file's size and modification time with those recorded in the cache. If either differs it
+  hashes the source, and only if the hash differs too is the mesh cooked again, so touching or checking out a file doesn't recook it.
+  A cache that fails to open or verify, for example from an older version of this file, is also cooked again. If the source is missing,
+  the cache is used as it is, so cooked meshes can be shipped without their sources.
+
+History:
+19/10/2026 - Version 2 files. Quantised and octahedral streams, and delta encoding of vertices and indices.
+19/10/2026 - First version.
+==============================================================*/
+
+#ifndef APG_MESH_H
+#define APG_MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APG_MESH_VERSION 2
+#define APG_MESH_MAX_STREAMS 8
+#define APG_MESH_ALIGN 64 /* vertex streams and indices start on multiples of this many bytes from the start of the file. */
+
+/* Flag for apg_mesh_open(). Skips hashing the mesh, so pages are only read from disk as they're used. The header is still checked. */
+#define APG_MESH_NO_VERIFY 1
+
+typedef enum apg_mesh_attrib_t {
+  APG_MESH_POSITION = 0,
+  APG_MESH_NORMAL,
+  APG_MESH_TEXCOORD,
+  APG_MESH_COLOUR,
+  APG_MESH_EDGE, /* custom attribute for voxel outlines. */
+  APG_MESH_ATTRIB_MAX
+} apg_mesh_attrib_t;
+
+typedef enum apg_mesh_type_t { APG_MESH_F32 = 0, APG_MESH_U8, APG_MESH_U16, APG_MESH_U32, APG_MESH_I8, APG_MESH_I16, APG_MESH_TYPE_MAX } apg_mesh_type_t;
+
+/* How a stream's components map back to floats. */
+typedef enum apg_mesh_quant_t {
+  APG_MESH_QUANT_NONE = 0, /* stored as they're used. */
+  APG_MESH_QUANT_UNORM,    /* U8 or U16 spanning range_min to range_min + range_extent. see apg_mesh_quantise_unorm(). */
+  APG_MESH_QUANT_OCT,      /* 2 I8 or I16 of a unit vector folded onto an octahedron. see apg_mesh_encode_octahedral(). */
+  APG_MESH_QUANT_MAX
+} apg_mesh_quant_t;
+
+typedef enum apg_mesh_codec_t {
+  APG_MESH_CODEC_NONE = 0, /* stored as they're used, so they can be used in place. */
+  APG_MESH_CODEC_DELTA,    /* lossless delta encoding. see "Compression" above. */
+  APG_MESH_CODEC_MAX
+} apg_mesh_codec_t;
+
+typedef struct apg_mesh_header_t {
+  char magic[8];         /* "APGMESH" */
+  uint32_t version;      /* APG_MESH_VERSION */
+  uint32_t endian;       /* 0x01020304, as written by the cook. */
+  uint64_t file_sz;      /* of the whole file, in bytes. */
+  uint64_t payload_hash; /* XXH64 of the file_sz - 128 bytes after the header. */
+  uint64_t source_hash;  /* XXH64 of the source file's contents. 0 with source_sz if there wasn't one. */
+  uint64_t source_sz;
+  int64_t source_mtime; /* seconds since the epoch. */
+  uint32_t n_vertices, n_indices, index_sz, n_streams;
+  uint64_t indices_offset; /* from the start of the file. 0 if index_sz is 0. */
+  float bounds_min[3], bounds_max[3]; /* of the first 3 components of positions. all 0 if there are no positions. */
+  uint32_t index_codec;                /* apg_mesh_codec_t */
+  uint32_t reserved_u32;
+  uint64_t indices_sz; /* bytes in the file. n_indices * index_sz, unless encoded. */
+  uint8_t reserved[8];
+} apg_mesh_header_t;
+
+typedef struct apg_mesh_stream_t {
+  uint32_t attrib;  /* apg_mesh_attrib_t */
+  uint32_t type;    /* apg_mesh_type_t */
+  uint32_t n_comps; /* 1 to 4. */
+  uint32_t stride;  /* bytes per vertex, once decoded: n_comps * the type's size. */
+  uint64_t offset;  /* of the stream's first vertex, from the start of the file. */
+  uint64_t sz;      /* bytes in the file. n_vertices * stride, unless encoded. */
+  uint32_t quant;   /* apg_mesh_quant_t */
+  uint32_t codec;   /* apg_mesh_codec_t */
+  float range_min[4], range_extent[4]; /* for APG_MESH_QUANT_UNORM. */
+} apg_mesh_stream_t;
+
+/* A stream to write. data_ptr is n_vertices tightly packed vertices of n_comps components of type. The remaining members may be left 0.
+codec is applied by apg_mesh_write(). The data must already be quantised as quant says, and range_min and range_extent filled in for
+APG_MESH_QUANT_UNORM, as apg_mesh_quantise_unorm() does. */
+typedef struct apg_mesh_stream_desc_t {
+  int attrib, type, n_comps;
+  const void* data_ptr;
+  int quant, codec;
+  float range_min[4], range_extent[4];
+} apg_mesh_stream_desc_t;
+
+/* A mesh to write. indices_ptr is NULL, with n_indices and index_sz 0, for meshes where every 3 vertices make a triangle. */
+typedef struct apg_mesh_desc_t {
+  apg_mesh_stream_desc_t streams[APG_MESH_MAX_STREAMS];
+  int n_streams;
+  uint32_t n_vertices;
+  const void* indices_ptr;
+  uint32_t n_indices;
+  int index_sz;    /* 2 or 4. */
+  int index_codec; /* apg_mesh_codec_t, applied by apg_mesh_write(). */
+} apg_mesh_desc_t;
+
+/* Identifies the source file a mesh was cooked from. */
+typedef struct apg_mesh_source_t {
+  uint64_t hash, sz;
+  int64_t mtime;
+} apg_mesh_source_t;
+
+/* An open mesh file. All pointers point into the mapped file, and are invalid after apg_mesh_close(). */
+typedef struct apg_mesh_t {
+  const apg_mesh_header_t* header_ptr;
+  const apg_mesh_stream_t* streams_ptr; /* header_ptr->n_streams of them. */
+  const void* indices_ptr;              /* NULL if not indexed, or if the indices are encoded. */
+  uint32_t n_vertices, n_indices, index_sz;
+  int cooked; /* set by apg_mesh_open_cached() if it had to cook the mesh. */
+  void* map_ptr;
+  size_t map_sz;
+} apg_mesh_t;
+
+/* Reads the source file and writes its mesh with apg_mesh_write(), passing on source_ptr.
+RETURNS 1 on success, 0 on error. */
+typedef int ( *apg_mesh_cook_func_t )( const char* src_filename, const char* mesh_filename, const apg_mesh_source_t* source_ptr, void* user_ptr );
+
+/* XXH64 of sz bytes. */
+uint64_t apg_mesh_hash( const void* data_ptr, size_t sz, uint64_t seed );
+
+/* Fills in source_ptr with the size and modification time of a file, and if hash is non-zero, the XXH64 of its contents.
+RETURNS 1 on success, 0 if the file can't be read. */
+int apg_mesh_source_info( const char* filename, int hash, apg_mesh_source_t* source_ptr );
+
+/* Writes a mesh file. The file is written under a temporary name and renamed when complete, so a failed write never leaves a truncated
+mesh behind. source_ptr may be NULL for meshes with no source file.
+RETURNS 1 on success, 0 on error or an invalid desc. */
+int apg_mesh_write( const char* filename, const apg_mesh_desc_t* desc_ptr, const apg_mesh_source_t* source_ptr );
+
+/* Maps a mesh file and checks its header and stream table. Unless flags has APG_MESH_NO_VERIFY, the payload hash is checked too.
+RETURNS 1 on success, 0 on error, in which case mesh_ptr is zeroed. */
+int apg_mesh_open( const char* filename, int flags, apg_mesh_t* mesh_ptr );
+
+/* Opens mesh_filename, first cooking it from src_filename with cook_func if it's missing, invalid, or stale. See "Stale caches" above.
+RETURNS 1 on success, 0 on error. */
+int apg_mesh_open_cached( const char* src_filename, const char* mesh_filename, apg_mesh_cook_func_t cook_func, void* user_ptr, apg_mesh_t* mesh_ptr );
+
+/* Unmaps the file and zeroes mesh_ptr. */
+void apg_mesh_close( apg_mesh_t* mesh_ptr );
+
+/* RETURNS A pointer to the first stream of the given attribute, and its n_comps and type, or NULL if the mesh doesn't have one or it's
+encoded. Quantised streams are returned as they're stored. */
+const void* apg_mesh_stream( const apg_mesh_t* mesh_ptr, int attrib, int* n_comps_ptr, int* type_ptr );
+
+/* RETURNS The first stream table entry of the given attribute, for its quantisation and codec, or NULL if the mesh doesn't have one. */
+const apg_mesh_stream_t* apg_mesh_stream_info( const apg_mesh_t* mesh_ptr, int attrib );
+
+/* Decodes a stream of an open mesh into dst_ptr, which has room for n_vertices * stride bytes. Unencoded streams are copied. Quantised
+streams stay quantised; see apg_mesh_dequantise().
+RETURNS 1 on success, 0 if the stored data is invalid. */
+int apg_mesh_decode_stream( const apg_mesh_t* mesh_ptr, const apg_mesh_stream_t* stream_ptr, void* dst_ptr );
+
+/* Decodes the indices of an open mesh into dst_ptr, which has room for n_indices * index_sz bytes. Unencoded indices are copied.
+RETURNS 1 on success, 0 if the mesh isn't indexed or the stored indices are invalid. */
+int apg_mesh_decode_indices( const apg_mesh_t* mesh_ptr, void* dst_ptr );
+
+/* Converts n decoded vertices of a stream to floats, n_comps per vertex for unquantised and APG_MESH_QUANT_UNORM streams, or 3 for
+APG_MESH_QUANT_OCT. For CPU-side use of quantised meshes; the GPU can use them as they're stored.
+RETURNS 1 on success, 0 for an unsupported type. */
+int apg_mesh_dequantise( const apg_mesh_stream_t* stream_ptr, const void* src_ptr, uint32_t n, float* dst_ptr );
+
+/* Quantises n vectors of n_comps (1 to 4) floats, src_stride floats apart, to bits (8 or 16) bit unsigned integers spanning their bounds.
+The bounds are written to range_min and range_extent, for the stream desc. Values round to the nearest step, so the error is at most half
+a step: range_extent / 510 at 8 bits, or / 131070 at 16. Non-finite values are stored as range_min. */
+void apg_mesh_quantise_unorm( const float* src_ptr, int n_comps, int src_stride, uint32_t n, int bits, void* dst_ptr, float* range_min, float* range_extent );
+
+/* Folds n unit vectors, src_stride floats apart, onto an octahedron and stores each as 2 signed normalised integers of bits (8 or 16)
+each, as an APG_MESH_I8 or APG_MESH_I16 stream of 2 components with APG_MESH_QUANT_OCT. Vectors needn't be exactly unit length. Of
+the 4 nearest integer pairs, the one that decodes closest to the vector is kept. */
+void apg_mesh_encode_octahedral( const float* src_ptr, int src_stride, uint32_t n, int bits, void* dst_ptr );
+
+/* Unfolds n octahedral normals of bits (8 or 16) bits into 3 floats each, of unit length. */
+void apg_mesh_decode_octahedral( const void* src_ptr, int bits, uint32_t n, float* dst_ptr );
+
+/* RETURNS The most bytes apg_mesh_encode_vertex_buffer() can write for n vertices of stride bytes. */
+size_t apg_mesh_encode_vertex_buffer_bound( uint32_t n, uint32_t stride );
+
+/* Delta encodes n vertices of stride (up to 64) bytes, made of components comp_sz (1, 2, or 4) bytes each, into dst_ptr. See "Compression" above.
+RETURNS The number of bytes written, or 0 if dst_sz is too small or the arguments are invalid. */
+size_t apg_mesh_encode_vertex_buffer( void* dst_ptr, size_t dst_sz, const void* vertices_ptr, uint32_t n, uint32_t stride, uint32_t comp_sz );
+
+/* Decodes the output of apg_mesh_encode_vertex_buffer(), with the same n, stride, and comp_sz, into dst_ptr, which has room for n * stride bytes.
+RETURNS 1 on success, 0 if src_ptr is too short or invalid. */
+int apg_mesh_decode_vertex_buffer( void* dst_ptr, uint32_t n, uint32_t stride, uint32_t comp_sz, const void* src_ptr, size_t src_sz );
+
+/* RETURNS The most bytes apg_mesh_encode_index_buffer() can write for n indices. */
+size_t apg_mesh_encode_index_buffer_bound( uint32_t n );
+
+/* Encodes a triangle list of n indices, a multiple of 3, of index_sz (2 or 4) bytes. Triangles in the order apg_ply_optimise() leaves them
+encode best.
+RETURNS The number of bytes written, or 0 if dst_sz is too small or the arguments are invalid. */
+size_t apg_mesh_encode_index_buffer( void* dst_ptr, size_t dst_sz, const void* indices_ptr, uint32_t n, uint32_t index_sz );
+
+/* Decodes the output of apg_mesh_encode_index_buffer(), with the same n and index_sz, into dst_ptr, which has room for n * index_sz bytes.
+RETURNS 1 on success, 0 if src_ptr is too short or invalid. */
+int apg_mesh_decode_index_buffer( void* dst_ptr, uint32_t n, uint32_t index_sz, const void* src_ptr, size_t src_sz );
+
+/* RETURNS The size in bytes of one component of type, or 0 if it's not a valid type. */
+int apg_mesh_type_sz( int type );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APG_MESH_H */
+/*==============================================================
+End of Header
+==============================================================*/
+
+#ifdef APG_MESH_IMPLEMENTATION
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) ) && !defined( APG_MESH_NO_SIMD )
+#define _APG_MESH_SSE2
+#include <emmintrin.h>
+#endif
+
+#define _APG_MESH_ENDIAN 0x01020304u
+#define _APG_MESH_HASH_BLOCK ( 1 << 20 ) /* bytes read at a time when hashing a source file. */
+#define _APG_MESH_BLOCK 256     /* vertices per block of the delta codec. */
+#define _APG_MESH_GROUP 16      /* bytes in each run of the same bit width in the delta codec. */
+#define _APG_MESH_MAX_STRIDE 64 /* bytes per vertex the delta codec accepts. */
+
+typedef char _apg_mesh_header_sz_check[sizeof( apg_mesh_header_t ) == 128 ? 1 : -1];
+typedef char _apg_mesh_stream_sz_check[sizeof( apg_mesh_stream_t ) == 72 ? 1 : -1];
+
+static const uint64_t _xxh_p1 = 11400714785074694791ull, _xxh_p2 = 14029467366897019727ull, _xxh_p3 = 1609587929392839161ull;
+static const uint64_t _xxh_p4 = 9650029242287828579ull, _xxh_p5 = 2870177450012600261ull;
+
+/* XXH64, fed in pieces of any size. */
+typedef struct _apg_mesh_hasher_t {
+  uint64_t v[4], total_sz, seed;
+  uint8_t buf[32];
+  size_t buf_sz;
+} _apg_mesh_hasher_t;
+
+static uint64_t _xxh_rotl( uint64_t x, int r ) { return ( x << r ) | ( x >> ( 64 - r ) ); }
+
+static uint64_t _xxh_read64( const uint8_t* p ) {
+  uint64_t v;
+  memcpy( &v, p, sizeof( v ) );
+  return v;
+}
+
+static uint32_t _xxh_read32( const uint8_t* p ) {
+  uint32_t v;
+  memcpy( &v, p, sizeof( v ) );
+  return v;
+}
+
+static uint64_t _xxh_round( uint64_t acc, uint64_t input ) { return _xxh_rotl( acc + input * _xxh_p2, 31 ) * _xxh_p1; }
+
+static uint64_t _xxh_merge( uint64_t acc, uint64_t v ) { return ( acc ^ _xxh_round( 0, v ) ) * _xxh_p1 + _xxh_p4; }
+
+static void _apg_mesh_hash_init( _apg_mesh_hasher_t* h_ptr, uint64_t seed ) {
+  memset( h_ptr, 0, sizeof( _apg_mesh_hasher_t ) );
+  h_ptr->seed = seed;
+  h_ptr->v[0] = seed + _xxh_p1 + _xxh_p2;
+  h_ptr->v[1] = seed + _xxh_p2;
+  h_ptr->v[2] = seed;
+  h_ptr->v[3] = seed - _xxh_p1;
+}
+
+static void _apg_mesh_hash_update( _apg_mesh_hasher_t* h_ptr, const void* data_ptr, size_t sz ) {
+  const uint8_t* p   = (const uint8_t*)data_ptr;
+  const uint8_t* end = p + sz;
+  h_ptr->total_sz += sz;
+  if ( h_ptr->buf_sz + sz < 32 ) {
+    if ( sz ) { memcpy( &h_ptr->buf[h_ptr->buf_sz], p, sz ); }
+    h_ptr->buf_sz += sz;
+    return;
+  }
+  if ( h_ptr->buf_sz ) {
+    size_t n = 32 - h_ptr->buf_sz;
+    memcpy( &h_ptr->buf[h_ptr->buf_sz], p, n );
+    for ( int i = 0; i < 4; i++ ) { h_ptr->v[i] = _xxh_round( h_ptr->v[i], _xxh_read64( &h_ptr->buf[i * 8] ) ); }
+    p += n;
+    h_ptr->buf_sz = 0;
+  }
+  uint64_t v0 = h_ptr->v[0], v1 = h_ptr->v[1], v2 = h_ptr->v[2], v3 = h_ptr->v[3];
+  for ( ; end - p >= 32; p += 32 ) {
+    v0 = _xxh_round( v0, _xxh_read64( p ) );
+    v1 = _xxh_round( v1, _xxh_read64( p + 8 ) );
+    v2 = _xxh_round( v2, _xxh_read64( p + 16 ) );
+    v3 = _xxh_round( v3, _xxh_read64( p + 24 ) );
+  }
+  h_ptr->v[0] = v0, h_ptr->v[1] = v1, h_ptr->v[2] = v2, h_ptr->v[3] = v3;
+  if ( p < end ) {
+    memcpy( h_ptr->buf, p, (size_t)( end - p ) );
+    h_ptr->buf_sz = (size_t)( end - p );
+  }
+}
+
+static uint64_t _apg_mesh_hash_digest( const _apg_mesh_hasher_t* h_ptr ) {
+  uint64_t h;
+  if ( h_ptr->total_sz >= 32 ) {
+    h = _xxh_rotl( h_ptr->v[0], 1 ) + _xxh_rotl( h_ptr->v[1], 7 ) + _xxh_rotl( h_ptr->v[2], 12 ) + _xxh_rotl( h_ptr->v[3], 18 );
+    for ( int i = 0; i < 4; i++ ) { h = _xxh_merge( h, h_ptr->v[i] ); }
+  } else {
+    h = h_ptr->seed + _xxh_p5;
+  }
+  h += h_ptr->total_sz;
+  const uint8_t* p   = h_ptr->buf;
+  const uint8_t* end = p + h_ptr->buf_sz;
+  for ( ; end - p >= 8; p += 8 ) { h = _xxh_rotl( h ^ _xxh_round( 0, _xxh_read64( p ) ), 27 ) * _xxh_p1 + _xxh_p4; }
+  if ( end - p >= 4 ) {
+    h = _xxh_rotl( h ^ ( (uint64_t)_xxh_read32( p ) * _xxh_p1 ), 23 ) * _xxh_p2 + _xxh_p3;
+    p += 4;
+  }
+  for ( ; p < end; p++ ) { h = _xxh_rotl( h ^ ( *p * _xxh_p5 ), 11 ) * _xxh_p1; }
+  h ^= h >> 33;
+  h *= _xxh_p2;
+  h ^= h >> 29;
+  h *= _xxh_p3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t apg_mesh_hash( const void* data_ptr, size_t sz, uint64_t seed ) {
+  _apg_mesh_hasher_t hasher;
+  _apg_mesh_hash_init( &hasher, seed );
+  _apg_mesh_hash_update( &hasher, data_ptr, sz );
+  return _apg_mesh_hash_digest( &hasher );
+}
+
+int apg_mesh_type_sz( int type ) {
+  switch ( type ) {
+  case APG_MESH_F32: return 4;
+  case APG_MESH_U8: return 1;
+  case APG_MESH_U16: return 2;
+  case APG_MESH_U32: return 4;
+  case APG_MESH_I8: return 1;
+  case APG_MESH_I16: return 2;
+  default: return 0;
+  }
+}
+
+/* ---------------------------------------------------------------- quantisation ---------------------------------------------------------------- */
+
+void apg_mesh_quantise_unorm( const float* src_ptr, int n_comps, int src_stride, uint32_t n, int bits, void* dst_ptr, float* range_min, float* range_extent ) {
+  if ( !src_ptr || !dst_ptr || n_comps < 1 || n_comps > 4 || ( 8 != bits && 16 != bits ) ) { return; }
+  float mins[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX }, maxs[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX }, scales[4] = { 0.0f };
+  for ( uint32_t v = 0; v < n; v++ ) {
+    for ( int c = 0; c < n_comps; c++ ) {
+      float f = src_ptr[(size_t)v * src_stride + c];
+      if ( !isfinite( f ) ) { continue; }
+      if ( f < mins[c] ) { mins[c] = f; }
+      if ( f > maxs[c] ) { maxs[c] = f; }
+    }
+  }
+  float max_q = 8 == bits ? 255.0f : 65535.0f;
+  for ( int c = 0; c < n_comps; c++ ) {
+    if ( mins[c] > maxs[c] ) { mins[c] = maxs[c] = 0.0f; } // no finite values.
+    range_min[c]    = mins[c];
+    range_extent[c] = maxs[c] - mins[c];
+    scales[c]       = range_extent[c] > 0.0f ? max_q / range_extent[c] : 0.0f;
+  }
+  for ( uint32_t v = 0; v < n; v++ ) {
+    for ( int c = 0; c < n_comps; c++ ) {
+      float f = ( src_ptr[(size_t)v * src_stride + c] - mins[c] ) * scales[c] + 0.5f;
+      f       = f >= 0.0f ? ( f <= max_q ? f : max_q ) : 0.0f; // also catches NaN.
+      if ( 8 == bits ) {
+        ( (uint8_t*)dst_ptr )[(size_t)v * n_comps + c] = (uint8_t)f;
+      } else {
+        ( (uint16_t*)dst_ptr )[(size_t)v * n_comps + c] = (uint16_t)f;
+      }
+    }
+  }
+}
+
+static void _apg_mesh_oct_unfold( float x, float y, float* xyz ) {
+  float z = 1.0f - fabsf( x ) - fabsf( y );
+  float t = z < 0.0f ? -z : 0.0f;
+  x += x >= 0.0f ? -t : t;
+  y += y >= 0.0f ? -t : t;
+  float len = sqrtf( x * x + y * y + z * z );
+  xyz[0] = x / len, xyz[1] = y / len, xyz[2] = z / len;
+}
+
+void apg_mesh_encode_octahedral( const float* src_ptr, int src_stride, uint32_t n, int bits, void* dst_ptr ) {
+  if ( !src_ptr || !dst_ptr || ( 8 != bits && 16 != bits ) ) { return; }
+  float max_q = 8 == bits ? 127.0f : 32767.0f;
+  for ( uint32_t v = 0; v < n; v++ ) {
+    const float* n_ptr = &src_ptr[(size_t)v * src_stride];
+    float l1           = fabsf( n_ptr[0] ) + fabsf( n_ptr[1] ) + fabsf( n_ptr[2] );
+    float x = 0.0f, y = 0.0f; // zero-length vectors become +z.
+    if ( l1 > 0.0f && isfinite( l1 ) ) {
+      x = n_ptr[0] / l1, y = n_ptr[1] / l1;
+      if ( n_ptr[2] < 0.0f ) { // fold the lower half over the diagonals.
+        float fx = ( 1.0f - fabsf( y ) ) * ( x >= 0.0f ? 1.0f : -1.0f );
+        y        = ( 1.0f - fabsf( x ) ) * ( y >= 0.0f ? 1.0f : -1.0f );
+        x        = fx;
+      }
+    }
+    // rounding each component on its own isn't always closest once unfolded, so try all 4 neighbours. they're compared by distance in
+    // double, as at 16 bits the differences are below float precision of a dot product.
+    double len = 0.0 == l1 || !isfinite( l1 ) ? 0.0 : sqrt( (double)n_ptr[0] * n_ptr[0] + (double)n_ptr[1] * n_ptr[1] + (double)n_ptr[2] * n_ptr[2] );
+    double unit[3] = { 0.0, 0.0, 1.0 }, best_dist = DBL_MAX;
+    if ( len > 0.0 ) { unit[0] = n_ptr[0] / len, unit[1] = n_ptr[1] / len, unit[2] = n_ptr[2] / len; }
+    float base_x = floorf( x * max_q ), base_y = floorf( y * max_q );
+    int best_qx = 0, best_qy = 0;
+    for ( int i = 0; i < 4; i++ ) {
+      float qx = base_x + ( i & 1 ), qy = base_y + ( i >> 1 );
+      qx       = qx < -max_q ? -max_q : ( qx > max_q ? max_q : qx );
+      qy       = qy < -max_q ? -max_q : ( qy > max_q ? max_q : qy );
+      float xyz[3];
+      _apg_mesh_oct_unfold( qx / max_q, qy / max_q, xyz );
+      double dx = xyz[0] - unit[0], dy = xyz[1] - unit[1], dz = xyz[2] - unit[2], dist = dx * dx + dy * dy + dz * dz;
+      if ( dist < best_dist ) { best_dist = dist, best_qx = (int)qx, best_qy = (int)qy; }
+    }
+    if ( 8 == bits ) {
+      ( (int8_t*)dst_ptr )[v * 2 + 0] = (int8_t)best_qx;
+      ( (int8_t*)dst_ptr )[v * 2 + 1] = (int8_t)best_qy;
+    } else {
+      ( (int16_t*)dst_ptr )[v * 2 + 0] = (int16_t)best_qx;
+      ( (int16_t*)dst_ptr )[v * 2 + 1] = (int16_t)best_qy;
+    }
+  }
+}
+
+void apg_mesh_decode_octahedral( const void* src_ptr, int bits, uint32_t n, float* dst_ptr ) {
+  if ( !src_ptr || !dst_ptr || ( 8 != bits && 16 != bits ) ) { return; }
+  for ( uint32_t v = 0; v < n; v++ ) {
+    // as for a normalised attribute in GL: the most negative integer is clamped to -1.
+    float x = 8 == bits ? ( (const int8_t*)src_ptr )[v * 2] / 127.0f : ( (const int16_t*)src_ptr )[v * 2] / 32767.0f;
+    float y = 8 == bits ? ( (const int8_t*)src_ptr )[v * 2 + 1] / 127.0f : ( (const int16_t*)src_ptr )[v * 2 + 1] / 32767.0f;
+    _apg_mesh_oct_unfold( x < -1.0f ? -1.0f : x, y < -1.0f ? -1.0f : y, &dst_ptr[(size_t)v * 3] );
+  }
+}
+
+int apg_mesh_dequantise( const apg_mesh_stream_t* stream_ptr, const void* src_ptr, uint32_t n, float* dst_ptr ) {
+  if ( !stream_ptr || !src_ptr || !dst_ptr ) { return 0; }
+  int type = (int)stream_ptr->type, n_comps = (int)stream_ptr->n_comps;
+  if ( APG_MESH_QUANT_OCT == stream_ptr->quant ) {
+    if ( 2 != n_comps || ( APG_MESH_I8 != type && APG_MESH_I16 != type ) ) { return 0; }
+    apg_mesh_decode_octahedral( src_ptr, APG_MESH_I8 == type ? 8 : 16, n, dst_ptr );
+    return 1;
+  }
+  int unorm = APG_MESH_QUANT_UNORM == stream_ptr->quant;
+  if ( ( unorm && APG_MESH_U8 != type && APG_MESH_U16 != type ) || n_comps < 1 || n_comps > 4 ) { return 0; }
+  for ( size_t i = 0; i < (size_t)n * n_comps; i++ ) {
+    float f = 0.0f;
+    switch ( type ) {
+    case APG_MESH_F32: memcpy( &f, (const uint8_t*)src_ptr + i * 4, 4 ); break;
+    case APG_MESH_U8: f = (float)( (const uint8_t*)src_ptr )[i]; break;
+    case APG_MESH_U16: f = (float)( (const uint16_t*)src_ptr )[i]; break;
+    case APG_MESH_U32: f = (float)( (const uint32_t*)src_ptr )[i]; break;
+    case APG_MESH_I8: f = (float)( (const int8_t*)src_ptr )[i]; break;
+    case APG_MESH_I16: f = (float)( (const int16_t*)src_ptr )[i]; break;
+    default: return 0;
+    }
+    if ( unorm ) {
+      int c = (int)( i % n_comps );
+      f     = stream_ptr->range_min[c] + stream_ptr->range_extent[c] * ( f / ( APG_MESH_U8 == type ? 255.0f : 65535.0f ) );
+    }
+    dst_ptr[i] = f;
+  }
+  return 1;
+}
+
+/* ---------------------------------------------------------------- delta codec ---------------------------------------------------------------- */
+/* Per block of up to 256 vertices, per byte of the vertex: a 2-bit width for each run of 16 bytes, 4 to a byte (0, 2, 4, or 8 bits), then
+the runs packed at those widths. 2-bit runs hold values 4i to 4i+3 in bits 0-1, 2-3, 4-5, 6-7 of byte i, and 4-bit runs values 2i and 2i+1
+in the low and high nibbles. The last run of a short block is padded with zeroes, which decode as repeats of the last vertex. */
+
+static uint32_t _apg_mesh_zigzag( uint32_t d, uint32_t comp_sz ) {
+  uint32_t mask = 4 == comp_sz ? 0xFFFFFFFFu : ( 1u << ( comp_sz * 8 ) ) - 1u;
+  d &= mask;
+  return ( ( d << 1 ) ^ ( 0u - ( d >> ( comp_sz * 8 - 1 ) ) ) ) & mask;
+}
+
+static uint32_t _apg_mesh_unzigzag( uint32_t z ) { return ( z >> 1 ) ^ ( 0u - ( z & 1u ) ); }
+
+static size_t _apg_mesh_lane_bound( uint32_t n_in_block ) {
+  uint32_t n_groups = ( n_in_block + _APG_MESH_GROUP - 1 ) / _APG_MESH_GROUP;
+  return ( n_groups + 3 ) / 4 + (size_t)n_groups * _APG_MESH_GROUP;
+}
+
+size_t apg_mesh_encode_vertex_buffer_bound( uint32_t n, uint32_t stride ) {
+  uint32_t rem = n % _APG_MESH_BLOCK;
+  return (size_t)stride * ( ( n / _APG_MESH_BLOCK ) * _apg_mesh_lane_bound( _APG_MESH_BLOCK ) + ( rem ? _apg_mesh_lane_bound( rem ) : 0 ) );
+}
+
+/* packs one byte of every vertex of a block. RETURNS the end of what was written. */
+static uint8_t* _apg_mesh_pack_lane( uint8_t* dst_ptr, const uint8_t* lane_ptr, uint32_t n_groups ) {
+  uint8_t* widths_ptr = dst_ptr;
+  memset( widths_ptr, 0, ( n_groups + 3 ) / 4 );
+  dst_ptr += ( n_groups + 3 ) / 4;
+  for ( uint32_t g = 0; g < n_groups; g++ ) {
+    const uint8_t* z_ptr = &lane_ptr[g * _APG_MESH_GROUP];
+    uint8_t all          = 0;
+    for ( int i = 0; i < _APG_MESH_GROUP; i++ ) { all |= z_ptr[i]; }
+    int code = 0 == all ? 0 : ( all < 4 ? 1 : ( all < 16 ? 2 : 3 ) );
+    widths_ptr[g / 4] |= (uint8_t)( code << ( ( g % 4 ) * 2 ) );
+    if ( 1 == code ) {
+      for ( int i = 0; i < 4; i++ ) { *dst_ptr++ = (uint8_t)( z_ptr[i * 4] | z_ptr[i * 4 + 1] << 2 | z_ptr[i * 4 + 2] << 4 | z_ptr[i * 4 + 3] << 6 ); }
+    } else if ( 2 == code ) {
+      for ( int i = 0; i < 8; i++ ) { *dst_ptr++ = (uint8_t)( z_ptr[i * 2] | z_ptr[i * 2 + 1] << 4 ); }
+    } else if ( 3 == code ) {
+      memcpy( dst_ptr, z_ptr, _APG_MESH_GROUP );
+      dst_ptr += _APG_MESH_GROUP;
+    }
+  }
+  return dst_ptr;
+}
+
+/* unpacks one byte of every vertex of a block into lane_ptr. RETURNS the end of what was read, or NULL if it runs past end_ptr. */
+static const uint8_t* _apg_mesh_unpack_lane( uint8_t* lane_ptr, const uint8_t* src_ptr, const uint8_t* end_ptr, uint32_t n_groups ) {
+  const uint8_t* widths_ptr = src_ptr;
+  if ( (size_t)( end_ptr - src_ptr ) < ( n_groups + 3 ) / 4 ) { return NULL; }
+  src_ptr += ( n_groups + 3 ) / 4;
+  for ( uint32_t g = 0; g < n_groups; g++ ) {
+    int code  = ( widths_ptr[g / 4] >> ( ( g % 4 ) * 2 ) ) & 3;
+    size_t sz = code ? (size_t)2 << code : 0;
+    if ( (size_t)( end_ptr - src_ptr ) < sz ) { return NULL; }
+    uint8_t* z_ptr = &lane_ptr[g * _APG_MESH_GROUP];
+#ifdef _APG_MESH_SSE2
+    __m128i z = _mm_setzero_si128();
+    if ( 1 == code ) {
+      int32_t packed;
+      memcpy( &packed, src_ptr, 4 );
+      __m128i x = _mm_cvtsi32_si128( packed ), three = _mm_set1_epi8( 3 );
+      __m128i a = _mm_and_si128( x, three ), b = _mm_and_si128( _mm_srli_epi16( x, 2 ), three );
+      __m128i c = _mm_and_si128( _mm_srli_epi16( x, 4 ), three ), d = _mm_and_si128( _mm_srli_epi16( x, 6 ), three );
+      z         = _mm_unpacklo_epi16( _mm_unpacklo_epi8( a, b ), _mm_unpacklo_epi8( c, d ) );
+    } else if ( 2 == code ) {
+      __m128i x = _mm_loadl_epi64( (const __m128i*)src_ptr ), fifteen = _mm_set1_epi8( 15 );
+      z         = _mm_unpacklo_epi8( _mm_and_si128( x, fifteen ), _mm_and_si128( _mm_srli_epi16( x, 4 ), fifteen ) );
+    } else if ( 3 == code ) {
+      z = _mm_loadu_si128( (const __m128i*)src_ptr );
+    }
+    _mm_storeu_si128( (__m128i*)z_ptr, z );
+#else
+    if ( 0 == code ) {
+      memset( z_ptr, 0, _APG_MESH_GROUP );
+    } else if ( 1 == code ) {
+      for ( int i = 0; i < _APG_MESH_GROUP; i++ ) { z_ptr[i] = ( src_ptr[i / 4] >> ( ( i % 4 ) * 2 ) ) & 3; }
+    } else if ( 2 == code ) {
+      for ( int i = 0; i < _APG_MESH_GROUP; i++ ) { z_ptr[i] = ( src_ptr[i / 2] >> ( ( i % 2 ) * 4 ) ) & 15; }
+    } else {
+      memcpy( z_ptr, src_ptr, _APG_MESH_GROUP );
+    }
+#endif
+    src_ptr += sz;
+  }
+  return src_ptr;
+}
+
+size_t apg_mesh_encode_vertex_buffer( void* dst_ptr, size_t dst_sz, const void* vertices_ptr, uint32_t n, uint32_t stride, uint32_t comp_sz ) {
+  if ( !dst_ptr || ( !vertices_ptr && n ) || ( 1 != comp_sz && 2 != comp_sz && 4 != comp_sz ) || 0 == stride || stride > _APG_MESH_MAX_STRIDE ||
+       0 != stride % comp_sz || dst_sz < apg_mesh_encode_vertex_buffer_bound( n, stride ) ) {
+    return 0;
+  }
+  uint8_t lanes[_APG_MESH_MAX_STRIDE * _APG_MESH_BLOCK];
+  uint32_t prev[_APG_MESH_MAX_STRIDE] = { 0 };
+  const uint8_t* src_ptr              = (const uint8_t*)vertices_ptr;
+  uint8_t* out_ptr                    = (uint8_t*)dst_ptr;
+  uint32_t n_comps                    = stride / comp_sz;
+  for ( uint32_t first = 0; first < n; first += _APG_MESH_BLOCK ) {
+    uint32_t n_in_block = n - first < _APG_MESH_BLOCK ? n - first : _APG_MESH_BLOCK;
+    uint32_t n_groups   = ( n_in_block + _APG_MESH_GROUP - 1 ) / _APG_MESH_GROUP;
+    memset( lanes, 0, (size_t)stride * _APG_MESH_BLOCK );
+    for ( uint32_t v = 0; v < n_in_block; v++ ) {
+      const uint8_t* vertex_ptr = &src_ptr[( (size_t)first + v ) * stride];
+      for ( uint32_t c = 0; c < n_comps; c++ ) {
+        uint32_t value = 0;
+        memcpy( &value, &vertex_ptr[c * comp_sz], comp_sz ); // little-endian only, as is the file.
+        uint32_t z = _apg_mesh_zigzag( value - prev[c], comp_sz );
+        prev[c]    = value;
+        for ( uint32_t b = 0; b < comp_sz; b++ ) { lanes[( c * comp_sz + b ) * _APG_MESH_BLOCK + v] = (uint8_t)( z >> ( b * 8 ) ); }
+      }
+    }
+    for ( uint32_t k = 0; k < stride; k++ ) { out_ptr = _apg_mesh_pack_lane( out_ptr, &lanes[k * _APG_MESH_BLOCK], n_groups ); }
+  }
+  return (size_t)( out_ptr - (uint8_t*)dst_ptr );
+}
+
+#ifdef _APG_MESH_SSE2
+static __m128i _apg_mesh_unzigzag8( __m128i z ) {
+  __m128i half = _mm_and_si128( _mm_srli_epi16( z, 1 ), _mm_set1_epi8( 0x7F ) );
+  return _mm_xor_si128( half, _mm_sub_epi8( _mm_setzero_si128(), _mm_and_si128( z, _mm_set1_epi8( 1 ) ) ) );
+}
+static __m128i _apg_mesh_unzigzag16( __m128i z ) {
+  return _mm_xor_si128( _mm_srli_epi16( z, 1 ), _mm_sub_epi16( _mm_setzero_si128(), _mm_and_si128( z, _mm_set1_epi16( 1 ) ) ) );
+}
+static __m128i _apg_mesh_unzigzag32( __m128i z ) {
+  return _mm_xor_si128( _mm_srli_epi32( z, 1 ), _mm_sub_epi32( _mm_setzero_si128(), _mm_and_si128( z, _mm_set1_epi32( 1 ) ) ) );
+}
+#endif
+
+/* turns the lanes of one component of a block back into values, in vals_ptr, comp_sz bytes each. */
+static void _apg_mesh_rebuild( uint8_t* vals_ptr, const uint8_t* lanes_ptr, uint32_t n_groups, uint32_t comp_sz, uint32_t* prev_ptr ) {
+#ifdef _APG_MESH_SSE2
+  if ( 1 == comp_sz ) {
+    __m128i carry = _mm_set1_epi8( (char)*prev_ptr );
+    for ( uint32_t g = 0; g < n_groups; g++ ) {
+      // prefix sum of 16 bytes in 4 shifted adds, then add the last value of the previous 16.
+      __m128i x = _apg_mesh_unzigzag8( _mm_loadu_si128( (const __m128i*)&lanes_ptr[g * 16] ) );
+      x         = _mm_add_epi8( x, _mm_slli_si128( x, 1 ) );
+      x         = _mm_add_epi8( x, _mm_slli_si128( x, 2 ) );
+      x         = _mm_add_epi8( x, _mm_slli_si128( x, 4 ) );
+      x         = _mm_add_epi8( _mm_add_epi8( x, _mm_slli_si128( x, 8 ) ), carry );
+      carry     = _mm_unpackhi_epi8( x, x );
+      carry     = _mm_shuffle_epi32( _mm_unpackhi_epi16( carry, carry ), 0xFF );
+      _mm_storeu_si128( (__m128i*)&vals_ptr[g * 16], x );
+    }
+    *prev_ptr = (uint32_t)_mm_cvtsi128_si32( carry ) & 0xFF;
+    return;
+  }
+  if ( 2 == comp_sz ) {
+    __m128i carry = _mm_set1_epi16( (short)*prev_ptr );
+    for ( uint32_t g = 0; g < n_groups; g++ ) {
+      __m128i lo = _mm_loadu_si128( (const __m128i*)&lanes_ptr[g * 16] );
+      __m128i hi = _mm_loadu_si128( (const __m128i*)&lanes_ptr[_APG_MESH_BLOCK + g * 16] );
+      __m128i x[2] = { _mm_unpacklo_epi8( lo, hi ), _mm_unpackhi_epi8( lo, hi ) };
+      for ( int h = 0; h < 2; h++ ) {
+        x[h]  = _apg_mesh_unzigzag16( x[h] );
+        x[h]  = _mm_add_epi16( x[h], _mm_slli_si128( x[h], 2 ) );
+        x[h]  = _mm_add_epi16( x[h], _mm_slli_si128( x[h], 4 ) );
+        x[h]  = _mm_add_epi16( _mm_add_epi16( x[h], _mm_slli_si128( x[h], 8 ) ), carry );
+        carry = _mm_shuffle_epi32( _mm_shufflehi_epi16( x[h], 0xFF ), 0xFF );
+        _mm_storeu_si128( (__m128i*)&vals_ptr[g * 32 + h * 16], x[h] );
+      }
+    }
+    *prev_ptr = (uint32_t)_mm_cvtsi128_si32( carry ) & 0xFFFF;
+    return;
+  }
+  __m128i carry = _mm_set1_epi32( (int)*prev_ptr );
+  for ( uint32_t g = 0; g < n_groups; g++ ) {
+    __m128i b[4];
+    for ( int i = 0; i < 4; i++ ) { b[i] = _mm_loadu_si128( (const __m128i*)&lanes_ptr[i * _APG_MESH_BLOCK + g * 16] ); }
+    __m128i ab_lo = _mm_unpacklo_epi8( b[0], b[1] ), ab_hi = _mm_unpackhi_epi8( b[0], b[1] );
+    __m128i cd_lo = _mm_unpacklo_epi8( b[2], b[3] ), cd_hi = _mm_unpackhi_epi8( b[2], b[3] );
+    __m128i x[4]  = { _mm_unpacklo_epi16( ab_lo, cd_lo ), _mm_unpackhi_epi16( ab_lo, cd_lo ), _mm_unpacklo_epi16( ab_hi, cd_hi ),
+       _mm_unpackhi_epi16( ab_hi, cd_hi ) };
+    for ( int q = 0; q < 4; q++ ) {
+      x[q]  = _apg_mesh_unzigzag32( x[q] );
+      x[q]  = _mm_add_epi32( x[q], _mm_slli_si128( x[q], 4 ) );
+      x[q]  = _mm_add_epi32( _mm_add_epi32( x[q], _mm_slli_si128( x[q], 8 ) ), carry );
+      carry = _mm_shuffle_epi32( x[q], 0xFF );
+      _mm_storeu_si128( (__m128i*)&vals_ptr[g * 64 + q * 16], x[q] );
+    }
+  }
+  *prev_ptr = (uint32_t)_mm_cvtsi128_si32( carry );
+#else
+  uint32_t prev = *prev_ptr, mask = 4 == comp_sz ? 0xFFFFFFFFu : ( 1u << ( comp_sz * 8 ) ) - 1u;
+  for ( uint32_t v = 0; v < n_groups * _APG_MESH_GROUP; v++ ) {
+    uint32_t z = 0;
+    for ( uint32_t b = 0; b < comp_sz; b++ ) { z |= (uint32_t)lanes_ptr[b * _APG_MESH_BLOCK + v] << ( b * 8 ); }
+    prev = ( prev + _apg_mesh_unzigzag( z ) ) & mask;
+    memcpy( &vals_ptr[v * comp_sz], &prev, comp_sz );
+  }
+  *prev_ptr = prev;
+#endif
+}
+
+int apg_mesh_decode_vertex_buffer( void* dst_ptr, uint32_t n, uint32_t stride, uint32_t comp_sz, const void* src_ptr, size_t src_sz ) {
+  if ( !dst_ptr || ( !src_ptr && src_sz ) || ( 1 != comp_sz && 2 != comp_sz && 4 != comp_sz ) || 0 == stride || stride > _APG_MESH_MAX_STRIDE ||
+       0 != stride % comp_sz ) {
+    return 0;
+  }
+  uint8_t lanes[_APG_MESH_MAX_STRIDE * _APG_MESH_BLOCK], vals[_APG_MESH_MAX_STRIDE * _APG_MESH_BLOCK];
+  uint32_t prev[_APG_MESH_MAX_STRIDE] = { 0 };
+  const uint8_t* in_ptr               = (const uint8_t*)src_ptr;
+  const uint8_t* end_ptr              = in_ptr + src_sz;
+  uint8_t* out_ptr                    = (uint8_t*)dst_ptr;
+  uint32_t n_comps                    = stride / comp_sz;
+  for ( uint32_t first = 0; first < n; first += _APG_MESH_BLOCK ) {
+    uint32_t n_in_block = n - first < _APG_MESH_BLOCK ? n - first : _APG_MESH_BLOCK;
+    uint32_t n_groups   = ( n_in_block + _APG_MESH_GROUP - 1 ) / _APG_MESH_GROUP;
+    for ( uint32_t k = 0; k < stride; k++ ) {
+      in_ptr = _apg_mesh_unpack_lane( &lanes[k * _APG_MESH_BLOCK], in_ptr, end_ptr, n_groups );
+      if ( !in_ptr ) { return 0; }
+    }
+    for ( uint32_t c = 0; c < n_comps; c++ ) {
+      _apg_mesh_rebuild( &vals[c * comp_sz * _APG_MESH_BLOCK], &lanes[c * comp_sz * _APG_MESH_BLOCK], n_groups, comp_sz, &prev[c] );
+    }
+    // interleave the components. fixed-size copies, so they compile to single moves.
+    uint8_t* block_ptr = &out_ptr[(size_t)first * stride];
+    for ( uint32_t v = 0; v < n_in_block; v++ ) {
+      uint8_t* vertex_ptr = &block_ptr[(size_t)v * stride];
+      for ( uint32_t c = 0; c < n_comps; c++ ) {
+        const uint8_t* val_ptr = &vals[( c * _APG_MESH_BLOCK + v ) * comp_sz];
+        switch ( comp_sz ) {
+        case 1: vertex_ptr[c] = *val_ptr; break;
+        case 2: memcpy( &vertex_ptr[c * 2], val_ptr, 2 ); break;
+        default: memcpy( &vertex_ptr[c * 4], val_ptr, 4 ); break;
+        }
+      }
+    }
+  }
+  return in_ptr == end_ptr;
+}
+
+/* Triangles are coded one at a time against a FIFO of the last 5 edges seen and a FIFO of the last 14 vertices, kept the same way by
+both ends. The edges of a mesh's neighbouring triangles are shared in the opposite direction, so each triangle adds its edges reversed.
+A code byte's high nibble is 3 * the edge's FIFO slot + which of the triangle's 3 edges it is, and its low nibble the remaining vertex.
+15 means no edge matched: the low nibble is the first vertex, and a second byte holds the second and third. Vertex nibbles are 0 for
+a new vertex, one past the highest index so far, 1 to 14 for a vertex FIFO slot, and 15 for any other, with the zig-zagged difference
+from the new vertex following as a LEB128 varint. Triangles that match an edge don't add it again, as it's now shared by both. */
+
+#define _APG_MESH_EDGE_FIFO 5
+#define _APG_MESH_VERTEX_FIFO 14
+
+typedef struct _apg_mesh_fifos_t {
+  uint32_t edges[_APG_MESH_EDGE_FIFO][2], vertices[_APG_MESH_VERTEX_FIFO];
+  uint32_t edge_head, vertex_head, next;
+} _apg_mesh_fifos_t;
+
+static void _apg_mesh_push_vertex( _apg_mesh_fifos_t* f_ptr, uint32_t v ) {
+  f_ptr->vertices[f_ptr->vertex_head] = v;
+  f_ptr->vertex_head                  = ( f_ptr->vertex_head + 1 ) % _APG_MESH_VERTEX_FIFO;
+}
+
+/* slot 0 is the newest. */
+static uint32_t _apg_mesh_vertex_slot( const _apg_mesh_fifos_t* f_ptr, uint32_t slot ) {
+  return f_ptr->vertices[( f_ptr->vertex_head + _APG_MESH_VERTEX_FIFO - 1 - slot ) % _APG_MESH_VERTEX_FIFO];
+}
+
+static const uint32_t* _apg_mesh_edge_slot( const _apg_mesh_fifos_t* f_ptr, uint32_t slot ) {
+  return f_ptr->edges[( f_ptr->edge_head + _APG_MESH_EDGE_FIFO - 1 - slot ) % _APG_MESH_EDGE_FIFO];
+}
+
+/* adds the triangle's edges, reversed, except for the one it matched, if any. */
+static void _apg_mesh_push_edges( _apg_mesh_fifos_t* f_ptr, const uint32_t* tri, int matched ) {
+  for ( int k = 0; k < 3; k++ ) {
+    if ( k == matched ) { continue; }
+    f_ptr->edges[f_ptr->edge_head][0] = tri[( k + 1 ) % 3];
+    f_ptr->edges[f_ptr->edge_head][1] = tri[k];
+    f_ptr->edge_head                  = ( f_ptr->edge_head + 1 ) % _APG_MESH_EDGE_FIFO;
+  }
+}
+
+/* RETURNS the nibble for vertex v, appending a varint to *extra_ptr if needed, and updates the vertex FIFO. */
+static uint8_t _apg_mesh_code_vertex( _apg_mesh_fifos_t* f_ptr, uint32_t v, uint8_t** extra_ptr ) {
+  uint8_t code = 15;
+  if ( v == f_ptr->next ) {
+    code = 0;
+  } else {
+    for ( uint32_t s = 0; s < _APG_MESH_VERTEX_FIFO; s++ ) {
+      if ( _apg_mesh_vertex_slot( f_ptr, s ) == v ) {
+        code = (uint8_t)( 1 + s );
+        break;
+      }
+    }
+  }
+  if ( 15 == code ) {
+    for ( uint32_t z = _apg_mesh_zigzag( v - f_ptr->next, 4 );; z >>= 7 ) {
+      *( *extra_ptr )++ = (uint8_t)( ( z & 0x7F ) | ( z > 0x7F ? 0x80 : 0 ) );
+      if ( z <= 0x7F ) { break; }
+    }
+  }
+  if ( 0 == code || 15 == code ) { _apg_mesh_push_vertex( f_ptr, v ); }
+  if ( v >= f_ptr->next ) { f_ptr->next = v + 1; }
+  return code;
+}
+
+/* the inverse of _apg_mesh_code_vertex(). RETURNS 0 if a varint runs past end_ptr. */
+static int _apg_mesh_decode_vertex( _apg_mesh_fifos_t* f_ptr, uint32_t code, const uint8_t** src_ptr, const uint8_t* end_ptr, uint32_t* v_ptr ) {
+  uint32_t v = f_ptr->next;
+  if ( code >= 1 && code <= _APG_MESH_VERTEX_FIFO ) {
+    v = _apg_mesh_vertex_slot( f_ptr, code - 1 );
+  } else if ( 15 == code ) {
+    uint32_t z = 0;
+    for ( int shift = 0;; shift += 7 ) {
+      if ( *src_ptr >= end_ptr || shift > 28 ) { return 0; }
+      uint8_t b = *( *src_ptr )++;
+      z |= (uint32_t)( b & 0x7F ) << shift;
+      if ( !( b & 0x80 ) ) { break; }
+    }
+    v = f_ptr->next + _apg_mesh_unzigzag( z );
+  }
+  if ( 0 == code || 15 == code ) { _apg_mesh_push_vertex( f_ptr, v ); }
+  if ( v >= f_ptr->next ) { f_ptr->next = v + 1; }
+  *v_ptr = v;
+  return 1;
+}
+
+size_t apg_mesh_encode_index_buffer_bound( uint32_t n ) { return (size_t)( n / 3 ) * 17; } // 2 code bytes and 3 5-byte varints.
+
+size_t apg_mesh_encode_index_buffer( void* dst_ptr, size_t dst_sz, const void* indices_ptr, uint32_t n, uint32_t index_sz ) {
+  if ( !dst_ptr || ( 2 != index_sz && 4 != index_sz ) || ( !indices_ptr && n ) || 0 != n % 3 || dst_sz < apg_mesh_encode_index_buffer_bound( n ) ) {
+    return 0;
+  }
+  _apg_mesh_fifos_t fifos;
+  memset( &fifos, 0, sizeof( fifos ) );
+  uint8_t* out_ptr = (uint8_t*)dst_ptr;
+  for ( uint32_t t = 0; t < n; t += 3 ) {
+    uint32_t tri[3];
+    for ( int k = 0; k < 3; k++ ) { tri[k] = 2 == index_sz ? ( (const uint16_t*)indices_ptr )[t + k] : ( (const uint32_t*)indices_ptr )[t + k]; }
+    int slot = -1, which = -1;
+    for ( int s = 0; s < _APG_MESH_EDGE_FIFO && slot < 0; s++ ) {
+      const uint32_t* edge = _apg_mesh_edge_slot( &fifos, (uint32_t)s );
+      for ( int k = 0; k < 3; k++ ) {
+        if ( edge[0] == tri[k] && edge[1] == tri[( k + 1 ) % 3] ) {
+          slot = s, which = k;
+          break;
+        }
+      }
+    }
+    uint8_t* code_ptr = out_ptr;
+    if ( slot >= 0 ) {
+      out_ptr++;
+      *code_ptr = (uint8_t)( ( slot * 3 + which ) << 4 | _apg_mesh_code_vertex( &fifos, tri[( which + 2 ) % 3], &out_ptr ) );
+    } else {
+      out_ptr += 2;
+      code_ptr[0] = (uint8_t)( 0xF0 | _apg_mesh_code_vertex( &fifos, tri[0], &out_ptr ) );
+      code_ptr[1] = (uint8_t)( _apg_mesh_code_vertex( &fifos, tri[1], &out_ptr ) << 4 );
+      code_ptr[1] |= _apg_mesh_code_vertex( &fifos, tri[2], &out_ptr );
+    }
+    _apg_mesh_push_edges( &fifos, tri, which );
+  }
+  return (size_t)( out_ptr - (uint8_t*)dst_ptr );
+}
+
+int apg_mesh_decode_index_buffer( void* dst_ptr, uint32_t n, uint32_t index_sz, const void* src_ptr, size_t src_sz ) {
+  if ( !dst_ptr || ( 2 != index_sz && 4 != index_sz ) || ( !src_ptr && src_sz ) || 0 != n % 3 ) { return 0; }
+  _apg_mesh_fifos_t fifos;
+  memset( &fifos, 0, sizeof( fifos ) );
+  const uint8_t* in_ptr  = (const uint8_t*)src_ptr;
+  const uint8_t* end_ptr = in_ptr + src_sz;
+  for ( uint32_t t = 0; t < n; t += 3 ) {
+    if ( in_ptr >= end_ptr ) { return 0; }
+    uint32_t code = *in_ptr++, tri[3];
+    int which     = -1;
+    if ( code >> 4 < 15 ) {
+      const uint32_t* edge = _apg_mesh_edge_slot( &fifos, ( code >> 4 ) / 3 );
+      which                = (int)( ( code >> 4 ) % 3 );
+      tri[which]           = edge[0];
+      tri[( which + 1 ) % 3] = edge[1];
+      if ( !_apg_mesh_decode_vertex( &fifos, code & 15, &in_ptr, end_ptr, &tri[( which + 2 ) % 3] ) ) { return 0; }
+    } else {
+      if ( in_ptr >= end_ptr ) { return 0; }
+      uint32_t codes_bc = *in_ptr++;
+      if ( !_apg_mesh_decode_vertex( &fifos, code & 15, &in_ptr, end_ptr, &tri[0] ) ||
+           !_apg_mesh_decode_vertex( &fifos, codes_bc >> 4, &in_ptr, end_ptr, &tri[1] ) ||
+           !_apg_mesh_decode_vertex( &fifos, codes_bc & 15, &in_ptr, end_ptr, &tri[2] ) ) {
+        return 0;
+      }
+    }
+    _apg_mesh_push_edges( &fifos, tri, which );
+    for ( int k = 0; k < 3; k++ ) {
+      if ( 2 == index_sz ) {
+        ( (uint16_t*)dst_ptr )[t + k] = (uint16_t)tri[k];
+      } else {
+        ( (uint32_t*)dst_ptr )[t + k] = tri[k];
+      }
+    }
+  }
+  return in_ptr == end_ptr;
+}
+
+static int _apg_mesh_stat( const char* filename, uint64_t* sz_ptr, int64_t* mtime_ptr ) {
+#ifdef _WIN32
+  struct _stat64 st;
+  if ( 0 != _stat64( filename, &st ) ) { return 0; }
+#else
+  struct stat st;
+  if ( 0 != stat( filename, &st ) ) { return 0; }
+#endif
+  *sz_ptr    = (uint64_t)st.st_size;
+  *mtime_ptr = (int64_t)st.st_mtime;
+  return 1;
+}
+
+int apg_mesh_source_info( const char* filename, int hash, apg_mesh_source_t* source_ptr ) {
+  if ( !filename || !source_ptr ) { return 0; }
+  memset( source_ptr, 0, sizeof( apg_mesh_source_t ) );
+  if ( !_apg_mesh_stat( filename, &source_ptr->sz, &source_ptr->mtime ) ) { return 0; }
+  if ( !hash ) { return 1; }
+
+  FILE* f_ptr = fopen( filename, "rb" );
+  if ( !f_ptr ) { return 0; }
+  uint8_t* block_ptr = (uint8_t*)malloc( _APG_MESH_HASH_BLOCK );
+  if ( !block_ptr ) {
+    fclose( f_ptr );
+    return 0;
+  }
+  _apg_mesh_hasher_t hasher;
+  _apg_mesh_hash_init( &hasher, 0 );
+  size_t n = 0;
+  while ( ( n = fread( block_ptr, 1, _APG_MESH_HASH_BLOCK, f_ptr ) ) > 0 ) { _apg_mesh_hash_update( &hasher, block_ptr, n ); }
+  int ok = !ferror( f_ptr );
+  free( block_ptr );
+  fclose( f_ptr );
+  source_ptr->hash = _apg_mesh_hash_digest( &hasher );
+  return ok;
+}
+
+static uint64_t _apg_mesh_align( uint64_t offset ) { return ( offset + APG_MESH_ALIGN - 1 ) & ~(uint64_t)( APG_MESH_ALIGN - 1 ); }
+
+/* writes sz bytes, and adds them to the payload hash. data_ptr NULL writes zeroes. */
+static int _apg_mesh_put( FILE* f_ptr, _apg_mesh_hasher_t* h_ptr, const void* data_ptr, size_t sz ) {
+  static const uint8_t zeroes[APG_MESH_ALIGN] = { 0 };
+  if ( !data_ptr ) {
+    if ( sz > APG_MESH_ALIGN ) { return 0; }
+    data_ptr = zeroes;
+  }
+  if ( sz && 1 != fwrite( data_ptr, sz, 1, f_ptr ) ) { return 0; }
+  _apg_mesh_hash_update( h_ptr, data_ptr, sz );
+  return 1;
+}
+
+/* RETURNS 1 if a stream's type, quantisation, and codec go together. */
+static int _apg_mesh_valid_stream( int attrib, int type, int n_comps, int quant, int codec ) {
+  if ( attrib < 0 || attrib >= APG_MESH_ATTRIB_MAX || !apg_mesh_type_sz( type ) || n_comps < 1 || n_comps > 4 ) { return 0; }
+  if ( codec < 0 || codec >= APG_MESH_CODEC_MAX ) { return 0; }
+  switch ( quant ) {
+  case APG_MESH_QUANT_NONE: return 1;
+  case APG_MESH_QUANT_UNORM: return APG_MESH_U8 == type || APG_MESH_U16 == type;
+  case APG_MESH_QUANT_OCT: return 2 == n_comps && ( APG_MESH_I8 == type || APG_MESH_I16 == type );
+  default: return 0;
+  }
+}
+
+int apg_mesh_write( const char* filename, const apg_mesh_desc_t* desc_ptr, const apg_mesh_source_t* source_ptr ) {
+  if ( !filename || !desc_ptr || desc_ptr->n_streams < 0 || desc_ptr->n_streams > APG_MESH_MAX_STREAMS ) { return 0; }
+  if ( desc_ptr->indices_ptr ? ( 2 != desc_ptr->index_sz && 4 != desc_ptr->index_sz ) : ( 0 != desc_ptr->n_indices ) ) { return 0; }
+  if ( desc_ptr->index_codec < 0 || desc_ptr->index_codec >= APG_MESH_CODEC_MAX ) { return 0; }
+
+  apg_mesh_header_t header;
+  apg_mesh_stream_t streams[APG_MESH_MAX_STREAMS];
+  memset( &header, 0, sizeof( header ) );
+  memset( streams, 0, sizeof( streams ) );
+  memcpy( header.magic, "APGMESH", 8 );
+  header.version    = APG_MESH_VERSION;
+  header.endian     = _APG_MESH_ENDIAN;
+  header.n_vertices = desc_ptr->n_vertices;
+  header.n_streams  = (uint32_t)desc_ptr->n_streams;
+  if ( source_ptr ) {
+    header.source_hash  = source_ptr->hash;
+    header.source_sz    = source_ptr->sz;
+    header.source_mtime = source_ptr->mtime;
+  }
+  for ( int i = 0; i < desc_ptr->n_streams; i++ ) {
+    const apg_mesh_stream_desc_t* s_ptr = &desc_ptr->streams[i];
+    if ( !_apg_mesh_valid_stream( s_ptr->attrib, s_ptr->type, s_ptr->n_comps, s_ptr->quant, s_ptr->codec ) ) { return 0; }
+    if ( !s_ptr->data_ptr && desc_ptr->n_vertices ) { return 0; }
+  }
+
+  // encoded streams and indices are encoded up front, so the layout is known before anything is written.
+  const void* payloads[APG_MESH_MAX_STREAMS + 1] = { NULL };
+  void* encoded[APG_MESH_MAX_STREAMS + 1]        = { NULL };
+  int ok                                         = 1;
+  uint64_t offset = sizeof( apg_mesh_header_t ) + sizeof( apg_mesh_stream_t ) * desc_ptr->n_streams;
+  for ( int i = 0; ok && i < desc_ptr->n_streams; i++ ) {
+    const apg_mesh_stream_desc_t* s_ptr = &desc_ptr->streams[i];
+    int type_sz                         = apg_mesh_type_sz( s_ptr->type );
+    offset                              = _apg_mesh_align( offset );
+    streams[i].attrib                   = (uint32_t)s_ptr->attrib;
+    streams[i].type                     = (uint32_t)s_ptr->type;
+    streams[i].n_comps                  = (uint32_t)s_ptr->n_comps;
+    streams[i].stride                   = (uint32_t)( type_sz * s_ptr->n_comps );
+    streams[i].offset                   = offset;
+    streams[i].sz                       = (uint64_t)streams[i].stride * desc_ptr->n_vertices;
+    streams[i].quant                    = (uint32_t)s_ptr->quant;
+    streams[i].codec                    = (uint32_t)s_ptr->codec;
+    if ( APG_MESH_QUANT_UNORM == s_ptr->quant ) {
+      memcpy( streams[i].range_min, s_ptr->range_min, sizeof( float ) * s_ptr->n_comps );
+      memcpy( streams[i].range_extent, s_ptr->range_extent, sizeof( float ) * s_ptr->n_comps );
+    }
+    payloads[i] = s_ptr->data_ptr;
+    if ( APG_MESH_CODEC_DELTA == s_ptr->codec ) {
+      size_t bound  = apg_mesh_encode_vertex_buffer_bound( desc_ptr->n_vertices, streams[i].stride );
+      payloads[i]   = encoded[i] = malloc( bound ? bound : 1 );
+      streams[i].sz = 0;
+      if ( encoded[i] ) {
+        streams[i].sz = apg_mesh_encode_vertex_buffer( encoded[i], bound, s_ptr->data_ptr, desc_ptr->n_vertices, streams[i].stride, (uint32_t)type_sz );
+      }
+      ok = encoded[i] && ( streams[i].sz || 0 == desc_ptr->n_vertices );
+    }
+    offset += streams[i].sz;
+  }
+  if ( ok && desc_ptr->indices_ptr ) {
+    header.n_indices      = desc_ptr->n_indices;
+    header.index_sz       = (uint32_t)desc_ptr->index_sz;
+    header.index_codec    = (uint32_t)desc_ptr->index_codec;
+    header.indices_offset = offset = _apg_mesh_align( offset );
+    header.indices_sz              = (uint64_t)desc_ptr->n_indices * desc_ptr->index_sz;
+    payloads[APG_MESH_MAX_STREAMS] = desc_ptr->indices_ptr;
+    if ( APG_MESH_CODEC_DELTA == desc_ptr->index_codec ) {
+      size_t bound   = apg_mesh_encode_index_buffer_bound( desc_ptr->n_indices );
+      void* buf_ptr  = malloc( bound ? bound : 1 );
+      header.indices_sz = 0;
+      if ( buf_ptr ) { header.indices_sz = apg_mesh_encode_index_buffer( buf_ptr, bound, desc_ptr->indices_ptr, desc_ptr->n_indices, header.index_sz ); }
+      ok                             = buf_ptr && ( header.indices_sz || 0 == desc_ptr->n_indices );
+      payloads[APG_MESH_MAX_STREAMS] = encoded[APG_MESH_MAX_STREAMS] = buf_ptr;
+    }
+    offset += header.indices_sz;
+  }
+  header.file_sz = offset;
+
+  // bounds of the first positions stream.
+  for ( int i = 0; i < desc_ptr->n_streams; i++ ) {
+    const apg_mesh_stream_desc_t* s_ptr = &desc_ptr->streams[i];
+    if ( APG_MESH_POSITION != s_ptr->attrib || 0 == desc_ptr->n_vertices ) { continue; }
+    int n = s_ptr->n_comps < 3 ? s_ptr->n_comps : 3;
+    if ( APG_MESH_QUANT_UNORM == s_ptr->quant ) {
+      for ( int c = 0; c < n; c++ ) {
+        header.bounds_min[c] = s_ptr->range_min[c];
+        header.bounds_max[c] = s_ptr->range_min[c] + s_ptr->range_extent[c];
+      }
+    } else if ( APG_MESH_F32 == s_ptr->type && APG_MESH_QUANT_NONE == s_ptr->quant ) {
+      const float* p_ptr = (const float*)s_ptr->data_ptr;
+      for ( int c = 0; c < n; c++ ) { header.bounds_min[c] = header.bounds_max[c] = p_ptr[c]; }
+      for ( uint32_t v = 1; v < desc_ptr->n_vertices; v++ ) {
+        for ( int c = 0; c < n; c++ ) {
+          float f = p_ptr[(size_t)v * s_ptr->n_comps + c];
+          if ( f < header.bounds_min[c] ) { header.bounds_min[c] = f; }
+          if ( f > header.bounds_max[c] ) { header.bounds_max[c] = f; }
+        }
+      }
+    }
+    break;
+  }
+
+  size_t len   = strlen( filename );
+  char* tmp_fn = ok ? (char*)malloc( len + 5 ) : NULL;
+  FILE* f_ptr  = NULL;
+  if ( tmp_fn ) {
+    memcpy( tmp_fn, filename, len );
+    memcpy( &tmp_fn[len], ".tmp", 5 );
+    f_ptr = fopen( tmp_fn, "wb" );
+  }
+  if ( !f_ptr ) {
+    for ( int i = 0; i <= APG_MESH_MAX_STREAMS; i++ ) { free( encoded[i] ); }
+    free( tmp_fn );
+    return 0;
+  }
+  _apg_mesh_hasher_t hasher;
+  _apg_mesh_hash_init( &hasher, 0 );
+  ok               = 1 == fwrite( &header, sizeof( header ), 1, f_ptr ); // rewritten with the payload hash at the end.
+  uint64_t written = sizeof( header );
+  ok               = ok && _apg_mesh_put( f_ptr, &hasher, streams, sizeof( apg_mesh_stream_t ) * desc_ptr->n_streams );
+  written += sizeof( apg_mesh_stream_t ) * desc_ptr->n_streams;
+  for ( int i = 0; ok && i < desc_ptr->n_streams; i++ ) {
+    ok      = _apg_mesh_put( f_ptr, &hasher, NULL, (size_t)( streams[i].offset - written ) );
+    ok      = ok && _apg_mesh_put( f_ptr, &hasher, payloads[i], (size_t)streams[i].sz );
+    written = streams[i].offset + streams[i].sz;
+  }
+  if ( ok && desc_ptr->indices_ptr ) {
+    ok = _apg_mesh_put( f_ptr, &hasher, NULL, (size_t)( header.indices_offset - written ) );
+    ok = ok && _apg_mesh_put( f_ptr, &hasher, payloads[APG_MESH_MAX_STREAMS], (size_t)header.indices_sz );
+  }
+  for ( int i = 0; i <= APG_MESH_MAX_STREAMS; i++ ) { free( encoded[i] ); }
+  header.payload_hash = _apg_mesh_hash_digest( &hasher );
+  ok                  = ok && 0 == fseek( f_ptr, 0L, SEEK_SET ) && 1 == fwrite( &header, sizeof( header ), 1, f_ptr );
+  ok                  = 0 == fclose( f_ptr ) && ok;
+#ifdef _WIN32
+  if ( ok ) { remove( filename ); } // rename() won't replace an existing file on Windows.
+#endif
+  ok = ok && 0 == rename( tmp_fn, filename );
+  if ( !ok ) { remove( tmp_fn ); }
+  free( tmp_fn );
+  return ok;
+}
+
+void apg_mesh_close( apg_mesh_t* mesh_ptr ) {
+  if ( !mesh_ptr ) { return; }
+  if ( mesh_ptr->map_ptr ) {
+#ifdef _WIN32
+    UnmapViewOfFile( mesh_ptr->map_ptr );
+#else
+    munmap( mesh_ptr->map_ptr, mesh_ptr->map_sz );
+#endif
+  }
+  memset( mesh_ptr, 0, sizeof( apg_mesh_t ) );
+}
+
+static int _apg_mesh_map( const char* filename, apg_mesh_t* mesh_ptr ) {
+  uint64_t sz   = 0;
+  int64_t mtime = 0;
+  if ( !_apg_mesh_stat( filename, &sz, &mtime ) || sz < sizeof( apg_mesh_header_t ) || sz > (uint64_t)SIZE_MAX ) { return 0; }
+#ifdef _WIN32
+  HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if ( INVALID_HANDLE_VALUE == file ) { return 0; }
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+  CloseHandle( file );
+  if ( !mapping ) { return 0; }
+  mesh_ptr->map_ptr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  CloseHandle( mapping ); // the view keeps the mapping alive.
+  if ( !mesh_ptr->map_ptr ) { return 0; }
+#else
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 ) { return 0; }
+  void* ptr = mmap( NULL, (size_t)sz, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd ); // the mapping keeps the file open.
+  if ( MAP_FAILED == ptr ) { return 0; }
+  mesh_ptr->map_ptr = ptr;
+#endif
+  mesh_ptr->map_sz = (size_t)sz;
+  return 1;
+}
+
+int apg_mesh_open( const char* filename, int flags, apg_mesh_t* mesh_ptr ) {
+  if ( !mesh_ptr ) { return 0; }
+  memset( mesh_ptr, 0, sizeof( apg_mesh_t ) );
+  if ( !filename || !_apg_mesh_map( filename, mesh_ptr ) ) { return 0; }
+
+  const uint8_t* base_ptr          = (const uint8_t*)mesh_ptr->map_ptr;
+  const apg_mesh_header_t* hdr_ptr = (const apg_mesh_header_t*)base_ptr;
+  uint64_t sz                      = mesh_ptr->map_sz;
+  int ok = 0 == memcmp( hdr_ptr->magic, "APGMESH", 8 ) && APG_MESH_VERSION == hdr_ptr->version && _APG_MESH_ENDIAN == hdr_ptr->endian &&
+           sz == hdr_ptr->file_sz && hdr_ptr->n_streams <= APG_MESH_MAX_STREAMS &&
+           sizeof( apg_mesh_header_t ) + sizeof( apg_mesh_stream_t ) * hdr_ptr->n_streams <= sz;
+  const apg_mesh_stream_t* streams_ptr = (const apg_mesh_stream_t*)( base_ptr + sizeof( apg_mesh_header_t ) );
+  for ( uint32_t i = 0; ok && i < hdr_ptr->n_streams; i++ ) {
+    const apg_mesh_stream_t* s_ptr = &streams_ptr[i];
+    ok = s_ptr->attrib < APG_MESH_ATTRIB_MAX && s_ptr->type < APG_MESH_TYPE_MAX && s_ptr->n_comps <= 4 && s_ptr->quant < APG_MESH_QUANT_MAX &&
+         s_ptr->codec < APG_MESH_CODEC_MAX;
+    ok = ok && _apg_mesh_valid_stream( (int)s_ptr->attrib, (int)s_ptr->type, (int)s_ptr->n_comps, (int)s_ptr->quant, (int)s_ptr->codec ) &&
+         s_ptr->stride == (uint64_t)apg_mesh_type_sz( (int)s_ptr->type ) * s_ptr->n_comps;
+    uint64_t max_sz = APG_MESH_CODEC_NONE == s_ptr->codec ? (uint64_t)s_ptr->stride * hdr_ptr->n_vertices :
+                                                            apg_mesh_encode_vertex_buffer_bound( hdr_ptr->n_vertices, s_ptr->stride );
+    ok = ok && ( APG_MESH_CODEC_NONE == s_ptr->codec ? s_ptr->sz == max_sz : s_ptr->sz <= max_sz ) && 0 == s_ptr->offset % APG_MESH_ALIGN &&
+         s_ptr->offset <= sz && s_ptr->sz <= sz - s_ptr->offset;
+  }
+  if ( ok && hdr_ptr->index_sz ) {
+    uint64_t decoded_sz = (uint64_t)hdr_ptr->n_indices * hdr_ptr->index_sz;
+    ok = ( 2 == hdr_ptr->index_sz || 4 == hdr_ptr->index_sz ) && hdr_ptr->index_codec < APG_MESH_CODEC_MAX &&
+         ( APG_MESH_CODEC_NONE == hdr_ptr->index_codec ? hdr_ptr->indices_sz == decoded_sz :
+                                                         hdr_ptr->indices_sz <= apg_mesh_encode_index_buffer_bound( hdr_ptr->n_indices ) ) &&
+         0 == hdr_ptr->indices_offset % APG_MESH_ALIGN && hdr_ptr->indices_offset <= sz && hdr_ptr->indices_sz <= sz - hdr_ptr->indices_offset;
+  } else if ( ok ) {
+    ok = 0 == hdr_ptr->n_indices;
+  }
+  if ( ok && !( flags & APG_MESH_NO_VERIFY ) ) {
+    ok = hdr_ptr->payload_hash == apg_mesh_hash( base_ptr + sizeof( apg_mesh_header_t ), (size_t)( sz - sizeof( apg_mesh_header_t ) ), 0 );
+  }
+  if ( !ok ) {
+    apg_mesh_close( mesh_ptr );
+    return 0;
+  }
+  mesh_ptr->header_ptr  = hdr_ptr;
+  mesh_ptr->streams_ptr = streams_ptr;
+  mesh_ptr->indices_ptr = hdr_ptr->index_sz && APG_MESH_CODEC_NONE == hdr_ptr->index_codec ? base_ptr + hdr_ptr->indices_offset : NULL;
+  mesh_ptr->n_vertices  = hdr_ptr->n_vertices;
+  mesh_ptr->n_indices   = hdr_ptr->n_indices;
+  mesh_ptr->index_sz    = hdr_ptr->index_sz;
+  return 1;
+}
+
+int apg_mesh_open_cached( const char* src_filename, const char* mesh_filename, apg_mesh_cook_func_t cook_func, void* user_ptr, apg_mesh_t* mesh_ptr ) {
+  if ( !src_filename || !mesh_filename || !cook_func || !mesh_ptr ) { return 0; }
+  apg_mesh_source_t source;
+  int have_source = apg_mesh_source_info( src_filename, 0, &source );
+  if ( apg_mesh_open( mesh_filename, 0, mesh_ptr ) ) {
+    const apg_mesh_header_t* hdr_ptr = mesh_ptr->header_ptr;
+    if ( !have_source || ( hdr_ptr->source_sz == source.sz && hdr_ptr->source_mtime == source.mtime ) ) { return 1; }
+    // size or time differ. only the contents matter.
+    if ( apg_mesh_source_info( src_filename, 1, &source ) && hdr_ptr->source_sz == source.sz && hdr_ptr->source_hash == source.hash ) { return 1; }
+    apg_mesh_close( mesh_ptr );
+  }
+  if ( !have_source ) { return 0; }
+  if ( !source.hash && !apg_mesh_source_info( src_filename, 1, &source ) ) { return 0; }
+  if ( !cook_func( src_filename, mesh_filename, &source, user_ptr ) ) { return 0; }
+  if ( !apg_mesh_open( mesh_filename, 0, mesh_ptr ) ) { return 0; }
+  mesh_ptr->cooked = 1;
+  return 1;
+}
+
+const apg_mesh_stream_t* apg_mesh_stream_info( const apg_mesh_t* mesh_ptr, int attrib ) {
+  if ( !mesh_ptr || !mesh_ptr->header_ptr ) { return NULL; }
+  for ( uint32_t i = 0; i < mesh_ptr->header_ptr->n_streams; i++ ) {
+    if ( (uint32_t)attrib == mesh_ptr->streams_ptr[i].attrib ) { return &mesh_ptr->streams_ptr[i]; }
+  }
+  return NULL;
+}
+
+const void* apg_mesh_stream( const apg_mesh_t* mesh_ptr, int attrib, int* n_comps_ptr, int* type_ptr ) {
+  const apg_mesh_stream_t* s_ptr = apg_mesh_stream_info( mesh_ptr, attrib );
+  if ( !s_ptr || APG_MESH_CODEC_NONE != s_ptr->codec ) { return NULL; }
+  if ( n_comps_ptr ) { *n_comps_ptr = (int)s_ptr->n_comps; }
+  if ( type_ptr ) { *type_ptr = (int)s_ptr->type; }
+  return (const uint8_t*)mesh_ptr->map_ptr + s_ptr->offset;
+}
+
+int apg_mesh_decode_stream( const apg_mesh_t* mesh_ptr, const apg_mesh_stream_t* stream_ptr, void* dst_ptr ) {
+  if ( !mesh_ptr || !mesh_ptr->header_ptr || !stream_ptr || !dst_ptr ) { return 0; }
+  const uint8_t* src_ptr = (const uint8_t*)mesh_ptr->map_ptr + stream_ptr->offset;
+  if ( APG_MESH_CODEC_NONE == stream_ptr->codec ) {
+    memcpy( dst_ptr, src_ptr, (size_t)stream_ptr->sz );
+    return 1;
+  }
+  uint32_t comp_sz = (uint32_t)apg_mesh_type_sz( (int)stream_ptr->type );
+  return apg_mesh_decode_vertex_buffer( dst_ptr, mesh_ptr->n_vertices, stream_ptr->stride, comp_sz, src_ptr, (size_t)stream_ptr->sz );
+}
+
+int apg_mesh_decode_indices( const apg_mesh_t* mesh_ptr, void* dst_ptr ) {
+  if ( !mesh_ptr || !mesh_ptr->header_ptr || !dst_ptr || !mesh_ptr->index_sz ) { return 0; }
+  const apg_mesh_header_t* hdr_ptr = mesh_ptr->header_ptr;
+  const uint8_t* src_ptr           = (const uint8_t*)mesh_ptr->map_ptr + hdr_ptr->indices_offset;
+  if ( APG_MESH_CODEC_NONE == hdr_ptr->index_codec ) {
+    memcpy( dst_ptr, src_ptr, (size_t)hdr_ptr->indices_sz );
+    return 1;
+  }
+  return apg_mesh_decode_index_buffer( dst_ptr, hdr_ptr->n_indices, hdr_ptr->index_sz, src_ptr, (size_t)hdr_ptr->indices_sz );
+}
+
+#endif /* APG_MESH_IMPLEMENTATION */
+
+/*
+-------------------------------------------------------------------------------------
+This software is available under two licences - you may use it under either licence.
+-------------------------------------------------------------------------------------
+FIRST LICENCE OPTION
+
+                                 Apache License
+                           Version 2.0, January 2004
+                        http://www.apache.org/licenses/
+   Copyright 2019 Anton Gerdelan.
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+-------------------------------------------------------------------------------------
+SECOND LICENCE OPTION
+
+Public Domain (www.unlicense.org)
+This is free and unencumbered software released into the public domain.
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+software, either in source code form or as a compiled binary, for any purpose,
+commercial or non-commercial, and by any means.
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------------
+*/